@@ -0,0 +1,108 @@
+#pragma once
+
+#include "Utils.h"
+#include <string>
+#include <vector>
+#include <functional>
+#include <cstdint>
+
+/**
+ * Immutable, memory-mapped integrity baseline
+ * Entries are sorted by path. Paths live in a front-coded string pool with a
+ * full path every BlockSize entries, so a lookup is a binary search over
+ * those restart points plus a short scan, and opening a million-entry
+ * baseline costs one mmap and a header check. SHA-256 and BLAKE3 digests and
+ * file metadata sit in a fixed-width table in path order; Merkle trees and
+ * other hash strings go to a separate blob section.
+ */
+class BaselineIndex {
+public:
+    static const uint32_t BlockSize = 16;
+
+    struct Entry {
+        std::string path;
+        std::string hash;          // Hex SHA-256, BLAKE3 id, serialized Merkle tree, or any other hash text
+        bool hasMetadata;
+        uint64_t size;
+        int64_t mtimeNs;
+        uint32_t mode;             // Permission bits
+
+        Entry() : hasMetadata(false), size(0), mtimeNs(0), mode(0) {}
+    };
+
+    struct CompileStats {
+        uint64_t linesRead;
+        uint64_t linesSkipped;     // Comments and lines without a path:hash pair
+        uint64_t entries;
+        uint64_t duplicates;       // Later entries for the same path replace earlier ones
+        uint64_t pathBytes;        // Before prefix compression
+        uint64_t poolBytes;        // After
+
+        CompileStats() : linesRead(0), linesSkipped(0), entries(0), duplicates(0), pathBytes(0), poolBytes(0) {}
+    };
+
+    BaselineIndex();
+    BaselineIndex(const BaselineIndex&) = delete;
+    BaselineIndex& operator=(const BaselineIndex&) = delete;
+
+    /**
+     * Write entries as a baseline. The file is written to a temporary name
+     * and renamed into place, so readers never observe a partial baseline.
+     * @param generation Stored in the header; promoted baselines count up from the one they replace
+     */
+    static bool Compile(std::vector<Entry> entries, const std::string& indexFile,
+                        CompileStats* stats = nullptr, std::string* error = nullptr, uint32_t generation = 1);
+
+    /**
+     * Convert a text baseline ("path:hash" lines, '#' comments) into the binary format
+     * The hash is taken after the last ':', so paths may contain colons.
+     */
+    static bool ConvertText(const std::string& textFile, const std::string& indexFile,
+                            CompileStats* stats = nullptr, std::string* error = nullptr);
+
+    // Parses one text baseline line; false for comments and malformed lines
+    static bool ParseTextLine(const std::string& line, std::string& path, std::string& hash);
+
+    // True if the file starts with the binary baseline magic
+    static bool IsIndexFile(const std::string& file);
+
+    // Map a baseline; validates the header checksum and section bounds only
+    bool Open(const std::string& indexFile);
+    void Close();
+    bool IsOpen() const { return file_.IsOpen(); }
+    std::string GetLastError() const { return lastError_; }
+
+    uint64_t GetCount() const { return count_; }
+    uint32_t GetGeneration() const { return generation_; }
+    int64_t GetCreatedNs() const { return createdNs_; }
+
+    // O(log n): binary search over restart points, then at most BlockSize entries
+    // @param ordinal Receives the entry's position in path order
+    bool Find(const std::string& path, Entry& entry, uint64_t* ordinal = nullptr) const;
+
+    // Hash and metadata of the entry at ordinal in path order; entry.path is left as it is
+    bool GetMetadata(uint64_t ordinal, Entry& entry) const;
+
+    // Visits every entry in path order, decoding the pool sequentially
+    void ForEach(const std::function<void(const Entry&)>& visit) const;
+
+private:
+    struct Record;
+
+    Utils::MappedFile file_;
+    const Record* records_;
+    const uint64_t* restarts_;
+    const uint8_t* pool_;
+    const char* blob_;
+    uint64_t count_;
+    uint64_t restartCount_;
+    uint64_t poolSize_;
+    uint64_t blobSize_;
+    uint32_t generation_;
+    int64_t createdNs_;
+    std::string lastError_;
+
+    // Decodes the pool entry at offset on top of path (the previous path); false if malformed
+    bool DecodePath(uint64_t& offset, std::string& path) const;
+    void DecodeEntry(size_t index, Entry& entry) const;
+};
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * Streaming BLAKE3 (unkeyed, 256-bit output)
+ * Input is cut into 1 KiB chunks that hash independently and are joined as
+ * a binary tree, which parallelizes two ways: SIMD lanes hash 4, 8 or 16
+ * chunks at once (SSE4.1, AVX2 or AVX-512, picked at runtime), and subtrees
+ * of one large input can be hashed on different threads and joined at the
+ * end. Used for the fast integrity mode; SHA-256 stays the default.
+ */
+class Blake3 {
+public:
+    static const size_t DigestSize = 32;
+    static const size_t BlockSize = 64;
+    static const size_t ChunkSize = 1024;
+
+    enum class Implementation {
+        Portable,
+        Sse41,      // 4 chunks per step
+        Avx2,       // 8
+        Avx512      // 16
+    };
+
+    // Bytes of an input that hash to one chaining value regardless of the rest of it
+    struct Subtree {
+        uint64_t offset;
+        uint64_t length;
+    };
+
+    Blake3();
+
+    void Reset();
+    void Update(const void* data, size_t size);
+    void Final(uint8_t digest[DigestSize]);
+    std::string HexDigest();                 // Final(), as lowercase hex
+
+    static std::string Hash(const void* data, size_t size);
+    static std::string ToHex(const uint8_t digest[DigestSize]);
+
+    // "blake3/<hex>", the form baselines store so it is never mistaken for a SHA-256 hash
+    static std::string ToId(const uint8_t digest[DigestSize]);
+    static bool IsId(const std::string& hash);
+    static bool ParseId(const std::string& id, uint8_t digest[DigestSize]);
+
+    // Hashes count independent messages; those up to 16 KiB share SIMD lanes chunk by chunk
+    static void HashMany(const uint8_t* const* data, const size_t* sizes, size_t count, uint8_t (*digests)[DigestSize]);
+
+    /**
+     * Tree-parallel hashing of one input
+     * SplitSubtrees cuts it into subtrees of at most maxLength bytes (rounded
+     * down to a power-of-two number of chunks), HashSubtree hashes each on any
+     * thread, and CombineSubtrees joins their chaining values, in split order,
+     * into the digest Hash would give. A single subtree has nothing to join:
+     * hash such an input with Update.
+     */
+    static std::vector<Subtree> SplitSubtrees(uint64_t size, uint64_t maxLength);
+    static void HashSubtree(const uint8_t* input, const Subtree& subtree, uint8_t chainingValue[DigestSize]);
+    static void CombineSubtrees(uint64_t size, uint64_t maxLength, const uint8_t (*chainingValues)[DigestSize],
+                                uint8_t digest[DigestSize]);
+
+    // Split, hash the subtrees on a temporary pool and combine; 0 threads = one per hardware thread
+    static void HashParallel(const void* data, size_t size, uint8_t digest[DigestSize], unsigned threads = 0);
+
+    static bool IsSupported(Implementation implementation);
+    static Implementation GetImplementation();
+    // For benchmarks and tests; returns false if the CPU lacks it. Narrower kernels stay in use for leftovers
+    static bool SetImplementation(Implementation implementation);
+    static const char* GetImplementationName(Implementation implementation);
+
+private:
+    static const size_t MaxDepth = 54;       // Chunk counters stay below 2^54
+
+    uint32_t chunkValue_[8];                 // Chaining value of the chunk in progress
+    uint8_t block_[BlockSize];
+    uint8_t blockLength_;
+    uint8_t blocksCompressed_;
+    uint64_t chunkCounter_;
+    uint64_t firstChunk_;                    // Nonzero when hashing a subtree
+    uint32_t stack_[MaxDepth][8];            // Chaining values of complete subtrees, left to right
+    size_t stackSize_;
+
+    void Start(uint64_t firstChunk);
+    size_t ChunkLength() const { return blocksCompressed_ * BlockSize + blockLength_; }
+    void UpdateChunk(const uint8_t* data, size_t size);
+    void PushSubtree(const uint32_t chainingValue[8], uint64_t chunks);
+    void Finish(bool root, uint8_t out[DigestSize]) const;
+};
@@ -0,0 +1,153 @@
+#pragma once
+
+#include "ThreatProtection.h"
+#include "SecurityMonitor.h"
+#include "NetworkMonitor.h"
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <queue>
+#include <functional>
+#include <mutex>
+#include <chrono>
+#include <cstdint>
+
+// Normalised input event for CorrelationEngine
+struct CorrelationEvent {
+    enum Key : uint8_t {
+        Pid,
+        Ip,
+        User,
+        KeyCount
+    };
+
+    std::chrono::system_clock::time_point timestamp;
+    std::string stream;            // "security", "network" or "file"
+    std::string type;              // e.g. PROCESS, CONNECTION, MODIFIED
+    std::string description;
+    std::string keys[KeyCount];
+    int severity;
+
+    CorrelationEvent() : severity(1) {}
+};
+
+/**
+ * Cross-source event correlation
+ * A rule is a set of steps that must all be seen for the same key (pid, IP or
+ * user) within a time window, in order or in any order. Each partially
+ * matched (rule, key) pair keeps the events that advanced it; partial matches
+ * expire with their window, and when the entry or memory cap is reached the
+ * ones closest to expiry are evicted first. Time is taken from the events
+ * themselves, so replayed input correlates exactly like live input.
+ */
+class CorrelationEngine {
+public:
+    typedef CorrelationEvent Event;
+    typedef CorrelationEvent::Key Key;
+
+    // Empty fields match anything; type and text comparisons ignore case
+    struct Step {
+        std::string stream;
+        std::string type;
+        std::string contains;      // Substring of the description
+        bool rareIp;               // Ip key seen in no more than Options::rareIpThreshold network events
+
+        Step(const std::string& s = "", const std::string& t = "", const std::string& c = "", bool rare = false)
+            : stream(s), type(t), contains(c), rareIp(rare) {}
+    };
+
+    struct Rule {
+        std::string id;
+        std::string type;          // Threat type raised on a full match
+        std::string description;
+        int severity;
+        Key key;
+        std::chrono::seconds window;
+        bool ordered;
+        std::vector<Step> steps;   // At most 32
+
+        Rule() : severity(4), key(Event::Pid), window(30), ordered(true) {}
+    };
+
+    struct Options {
+        size_t maxPartialMatches;
+        size_t maxMemoryBytes;
+        size_t maxEventsPerMatch;  // Evidence kept per partial match
+        uint32_t rareIpThreshold;
+        size_t maxTrackedIps;      // Frequency table size before counts are halved
+
+        Options() : maxPartialMatches(65536), maxMemoryBytes(32 * 1024 * 1024), maxEventsPerMatch(16),
+                    rareIpThreshold(3), maxTrackedIps(65536) {}
+    };
+
+    struct Statistics {
+        uint64_t events;
+        uint64_t started;
+        uint64_t completed;
+        uint64_t expired;
+        uint64_t evicted;
+        size_t active;
+        size_t memoryBytes;
+    };
+
+    explicit CorrelationEngine(const Options& options = Options());
+
+    bool AddRule(const Rule& rule);
+    // Process start -> outbound connection to a rare IP -> config change, per pid within 30s
+    void AddDefaultRules();
+
+    // Appends a threat for every rule the event completes
+    void Process(const Event& event, std::vector<ThreatProtection::ThreatInfo>& threats);
+    // Drops partial matches whose window closed before the given time
+    void Expire(std::chrono::system_clock::time_point now);
+    void Clear();
+
+    Statistics GetStatistics() const;
+    size_t GetRuleCount() const;
+    std::string GetLastError() const { return lastError_; }
+
+    // Keys are taken from structured fields where the source has them; free-text
+    // sources contribute "pid <n>", "user <name>" and a source that is an address
+    static Event FromSecurityEvent(const SecurityMonitor::SecurityEvent& event);
+    static Event FromNetworkLog(const NetworkMonitor::NetworkLog& log);
+    static Event FromConnection(const NetworkMonitor::NetworkConnection& connection);
+    static Event FromFileChange(const std::string& path, const std::string& change, int pid = 0,
+                                const std::string& user = "");
+
+private:
+    struct Partial {
+        uint32_t seen;             // Bit per completed step
+        std::chrono::system_clock::time_point start;
+        std::vector<Event> events;
+        size_t bytes;
+        uint64_t generation;
+    };
+
+    struct Deadline {
+        std::chrono::system_clock::time_point when;
+        uint32_t rule;
+        std::string key;
+        uint64_t generation;
+
+        bool operator>(const Deadline& other) const { return when > other.when; }
+    };
+
+    Options options_;
+    std::string lastError_;
+    mutable std::mutex mutex_;
+    std::vector<Rule> rules_;
+    std::vector<std::unordered_map<std::string, Partial>> partials_;   // Per rule, by key value
+    std::priority_queue<Deadline, std::vector<Deadline>, std::greater<Deadline>> deadlines_;
+    std::unordered_map<std::string, uint32_t> ipCounts_;
+    std::chrono::system_clock::time_point watermark_;
+    uint64_t nextGeneration_;
+    Statistics stats_;
+
+    uint32_t MatchSteps(const Rule& rule, const Event& event) const;
+    void Start(uint32_t rule, const std::string& key, const Event& event, uint32_t step);
+    void Remove(uint32_t rule, std::unordered_map<std::string, Partial>::iterator it);
+    void ExpireLocked(std::chrono::system_clock::time_point now);
+    void EnforceLimits();
+    void CountIp(const std::string& ip);
+    static size_t EventBytes(const Event& event);
+};
@@ -4,6 +4,7 @@
 #include <vector>
 #include <memory>
 #include <chrono>
+#include "RiskScorer.h"
 
 class SecurityApp;
 
@@ -33,15 +34,20 @@ public:
     void AddMetric(const SecurityMetric& metric);
     void UpdateMetric(const std::string& name, const std::string& value, const std::string& status);
 
+    // Risk ranking; not owned, must outlive the dashboard or be detached with nullptr
+    void SetRiskScorer(const RiskScorer* scorer);
+    std::vector<RiskScorer::Entity> GetRiskiestEntities(size_t count = 5) const;
+
     // Status
     std::string GetOverallStatus() const;
-    int GetThreatLevel() const; // 1-5 scale
+    int GetThreatLevel() const; // 1-5 scale, the host's decayed risk level
 
 private:
     std::vector<SecurityMetric> metrics_;
     std::string overallStatus_;
     int threatLevel_;
     std::chrono::system_clock::time_point lastUpdate_;
+    const RiskScorer* riskScorer_;
     
     void CalculateOverallStatus();
 };
\ No newline at end of file
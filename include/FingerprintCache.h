@@ -0,0 +1,84 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <chrono>
+#include <mutex>
+#include <cstdint>
+
+#ifdef __linux__
+struct statx;
+#endif
+
+/**
+ * Persistent map from file identity and metadata to the last verified hash
+ * A fingerprint is (device, inode, size, mtime, ctime) in nanoseconds, plus the
+ * birth time where statx provides it. ctime cannot be set from user space, so
+ * a file whose fingerprint is unchanged has not been written through the
+ * filesystem since it was hashed; periodic full rehash passes cover the rest.
+ */
+class FingerprintCache {
+public:
+    struct Fingerprint {
+        uint64_t device;
+        uint64_t inode;         // 0 when the platform has no inode numbers
+        uint64_t size;
+        int64_t mtimeNs;
+        int64_t ctimeNs;
+        int64_t birthNs;        // 0 when unknown
+        uint32_t mode;          // st_mode, 0 when unknown; not compared, a chmod changes ctime
+
+        bool operator==(const Fingerprint& other) const {
+            return device == other.device && inode == other.inode && size == other.size &&
+                   mtimeNs == other.mtimeNs && ctimeNs == other.ctimeNs && birthNs == other.birthNs;
+        }
+        bool operator!=(const Fingerprint& other) const { return !(*this == other); }
+    };
+
+    FingerprintCache();
+
+    // Regular files only; symlinks are followed
+    static bool Stat(const std::string& path, Fingerprint& fingerprint, bool birthTime = true);
+#ifdef __linux__
+    // For statx results obtained elsewhere (io_uring); false if not a regular file
+    static bool FromStatx(const struct statx& sx, Fingerprint& fingerprint, bool birthTime = true);
+#endif
+
+    bool Lookup(const Fingerprint& fingerprint, std::string& hash) const;
+    void Store(const Fingerprint& fingerprint, const std::string& hash);
+    // Drops entries no Lookup or Store has touched since the previous prune
+    size_t PruneUntouched();
+    void Clear();
+    size_t Size() const;
+
+    // Time of the last pass that rehashed everything; persisted with the entries
+    std::chrono::system_clock::time_point GetLastFullRehash() const;
+    void SetLastFullRehash(std::chrono::system_clock::time_point when);
+
+    bool Load(const std::string& file);
+    // Written to a temporary file and renamed over the old one
+    bool Save(const std::string& file) const;
+
+private:
+    struct Key {
+        uint64_t device;
+        uint64_t inode;
+        bool operator==(const Key& other) const { return device == other.device && inode == other.inode; }
+    };
+
+    struct KeyHash {
+        size_t operator()(const Key& key) const {
+            return static_cast<size_t>(key.inode * 0x9E3779B97F4A7C15ULL ^ key.device);
+        }
+    };
+
+    struct Entry {
+        Fingerprint fingerprint;
+        std::string hash;
+        mutable bool touched;
+    };
+
+    mutable std::mutex mutex_;
+    std::unordered_map<Key, Entry, KeyHash> entries_;
+    std::chrono::system_clock::time_point lastFullRehash_;
+};
@@ -0,0 +1,197 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <unordered_map>
+#include <queue>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstdint>
+
+/**
+ * Firewall backend interface
+ * A driver applies one batch of set-membership changes as a single
+ * transaction; either every operation in the batch lands or none does.
+ */
+class FirewallDriver {
+public:
+    enum class Action { Add, Remove };
+
+    struct Operation {
+        Action action;
+        uint8_t addr[16];
+        bool isIPv6;
+        std::chrono::milliseconds ttl;   // Zero = no expiry
+        std::string ip;                  // Normalised text form
+    };
+
+    virtual ~FirewallDriver() = default;
+
+    virtual std::string GetName() const = 0;
+    // Create whatever tables/sets the driver needs; called once before Apply
+    virtual bool Initialize(std::string& error) = 0;
+    virtual bool Apply(const std::vector<Operation>& batch, std::string& error) = 0;
+};
+
+// Accepts every batch without touching the system (Windows, or enforcement disabled)
+class NullFirewallDriver : public FirewallDriver {
+public:
+    std::string GetName() const override { return "none"; }
+    bool Initialize(std::string&) override { return true; }
+    bool Apply(const std::vector<Operation>&, std::string&) override { return true; }
+};
+
+// Records every batch it is given so enforcement can be tested without root
+class MockFirewallDriver : public FirewallDriver {
+public:
+    MockFirewallDriver() : failNext_(false) {}
+
+    std::string GetName() const override { return "mock"; }
+    bool Initialize(std::string&) override { return true; }
+    bool Apply(const std::vector<Operation>& batch, std::string& error) override;
+
+    std::vector<std::vector<Operation>> GetBatches() const;
+    void FailNextBatch() { std::lock_guard<std::mutex> lock(mutex_); failNext_ = true; }
+
+private:
+    mutable std::mutex mutex_;
+    std::vector<std::vector<Operation>> batches_;
+    bool failNext_;
+};
+
+#ifdef __linux__
+/**
+ * nf_tables driver speaking netlink directly
+ * Owns table "inet <table>" with sets <set>_v4/<set>_v6 and an input chain
+ * dropping traffic from either set. Each Apply is one netlink batch
+ * (NFNL_MSG_BATCH_BEGIN ... END), i.e. one nftables transaction. Deletes
+ * use the destroy operation where the kernel has it, so an element whose
+ * kernel timeout already ran out does not abort the batch; elsewhere a
+ * batch failing with ENOENT is retried with each delete on its own.
+ */
+class NftablesFirewallDriver : public FirewallDriver {
+public:
+    explicit NftablesFirewallDriver(const std::string& table = "security_sentinel",
+                                    const std::string& set = "blocked");
+    ~NftablesFirewallDriver() override;
+
+    std::string GetName() const override { return "nftables"; }
+    bool Initialize(std::string& error) override;
+    bool Apply(const std::vector<Operation>& batch, std::string& error) override;
+
+private:
+    std::string table_;
+    std::string set_;
+    int socket_;
+    uint32_t sequence_;
+    int errorCode_;             // errno of the last failed send, 0 after a success
+    bool destroySupported_;
+
+    bool Open(std::string& error);
+    bool SendBatch(std::vector<uint8_t>& buffer, uint32_t firstSeq, uint32_t messages, std::string& error);
+    // One transaction of element-list messages for the batch, in order
+    bool SendElements(const std::vector<Operation>& batch, std::string& error);
+};
+#endif
+
+/**
+ * Queued, batched IP blocking with TTL expiry
+ * Block/Unblock only enqueue. A worker thread coalesces pending requests per
+ * address and hands them to the driver in batches of up to maxBatch
+ * operations, so thousands of blocks per second cost a handful of firewall
+ * transactions rather than one rule change each. A failed batch is rolled
+ * back locally and its requests retried with exponential backoff.
+ */
+class FirewallEnforcer {
+public:
+    struct Options {
+        size_t maxBatch;                        // Operations per driver transaction
+        std::chrono::milliseconds batchDelay;   // How long to gather requests before applying
+        std::chrono::milliseconds defaultTtl;   // Used when Block() is given no TTL
+        size_t maxQueued;                       // Requests beyond this are dropped
+
+        Options()
+            : maxBatch(1024), batchDelay(20), defaultTtl(std::chrono::hours(1)), maxQueued(1 << 20) {}
+    };
+
+    struct Statistics {
+        uint64_t requested;
+        uint64_t coalesced;     // Requests superseded before they were applied
+        uint64_t dropped;
+        uint64_t applied;       // Operations accepted by the driver
+        uint64_t batches;
+        uint64_t failedBatches;
+        uint64_t retried;       // Requests queued again after their batch failed
+        uint64_t expired;
+        size_t activeBlocks;
+    };
+
+    // The driver must already be initialised; null means track-only
+    FirewallEnforcer(std::unique_ptr<FirewallDriver> driver, const Options& options = Options());
+    ~FirewallEnforcer();
+    FirewallEnforcer(const FirewallEnforcer&) = delete;
+    FirewallEnforcer& operator=(const FirewallEnforcer&) = delete;
+
+    // Driver chosen from [firewall] driver in the config (nftables on Linux by default).
+    // The first call sets the driver up, so monitors make it at startup outside their locks
+    static FirewallEnforcer& Instance();
+
+    bool Block(const std::string& ip, std::chrono::milliseconds ttl = std::chrono::milliseconds(-1));
+    bool Unblock(const std::string& ip);
+    // Reflects the latest request, including ones still queued for the driver
+    bool IsBlocked(const std::string& ip) const;
+    std::vector<std::string> GetBlockedIPs() const;
+
+    // Wait until every queued request has been handed to the driver
+    bool Flush(std::chrono::milliseconds timeout = std::chrono::seconds(5));
+
+    Statistics GetStatistics() const;
+    std::string GetDriverName() const;
+    std::string GetLastError() const;
+
+private:
+    struct Request {
+        FirewallDriver::Action action;
+        std::chrono::milliseconds ttl;
+    };
+
+    struct Expiry {
+        std::chrono::steady_clock::time_point when;
+        std::string ip;
+        bool operator>(const Expiry& other) const { return when > other.when; }
+    };
+
+    // One request taken into a batch, with what to restore if the batch fails
+    struct Change {
+        std::string ip;
+        Request request;
+        bool hadActive;
+        std::chrono::steady_clock::time_point previous;
+    };
+
+    std::unique_ptr<FirewallDriver> driver_;
+    Options options_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable idle_;
+    std::deque<std::string> order_;                        // Addresses in arrival order
+    std::unordered_map<std::string, Request> pending_;     // Latest request per address
+    std::unordered_map<std::string, std::chrono::steady_clock::time_point> active_;
+    std::priority_queue<Expiry, std::vector<Expiry>, std::greater<Expiry>> expiries_;
+    bool applying_;
+    bool stopping_;
+    std::string lastError_;
+    unsigned failures_;                                    // Consecutive failed batches
+    std::chrono::steady_clock::time_point retryAt_;        // Backoff after a failed batch
+    Statistics stats_;
+    std::thread worker_;
+
+    void WorkerLoop();
+    void CollectExpired(std::chrono::steady_clock::time_point now);
+    static bool Normalize(const std::string& ip, std::string& normalized);
+};
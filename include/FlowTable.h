@@ -0,0 +1,124 @@
+#pragma once
+
+#include <vector>
+#include <list>
+#include <unordered_map>
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * Bidirectional flow aggregation
+ * Packets (or connection observations) sharing a 5-tuple in either direction
+ * fold into one record with per-direction byte/packet counts and TCP flags.
+ * Records leave the table on idle timeout, active timeout, TCP teardown or
+ * capacity eviction; the caller exports whatever Expire() returns.
+ * Not synchronised; the owner serialises access.
+ */
+class FlowTable {
+public:
+    // IPFIX flowEndReason values (RFC 7011 / IANA IE 136)
+    enum EndReason : uint8_t {
+        IdleTimeout = 1,
+        ActiveTimeout = 2,
+        EndOfFlow = 3,
+        ForcedEnd = 4,
+        LackOfResources = 5
+    };
+
+    struct Observation {
+        uint64_t timestampNs;
+        uint8_t ipVersion;       // 4 or 6
+        uint8_t protocol;
+        uint8_t tcpFlags;
+        uint8_t srcAddr[16];
+        uint8_t dstAddr[16];
+        uint16_t srcPort;
+        uint16_t dstPort;
+        uint64_t bytes;
+        uint64_t packets;        // 0 for a connection-table observation
+    };
+
+    // Oriented initiator -> responder; "reverse" counters are responder -> initiator
+    struct FlowRecord {
+        uint8_t ipVersion;
+        uint8_t protocol;
+        uint8_t srcAddr[16];
+        uint8_t dstAddr[16];
+        uint16_t srcPort;
+        uint16_t dstPort;
+        uint64_t startNs;
+        uint64_t endNs;
+        uint64_t packets;
+        uint64_t bytes;
+        uint64_t reversePackets;
+        uint64_t reverseBytes;
+        uint16_t tcpFlags;
+        uint16_t reverseTcpFlags;
+        uint8_t endReason;
+    };
+
+    struct Statistics {
+        uint64_t observations;
+        uint64_t flowsCreated;
+        uint64_t flowsExpired;
+        uint64_t evictions;
+        size_t activeFlows;
+        size_t activeTimers;     // Flows queued for the active timeout, never more than activeFlows
+    };
+
+    FlowTable(uint64_t idleTimeoutNs, uint64_t activeTimeoutNs, size_t maxFlows = 262144);
+
+    void Observe(const Observation& observation);
+
+    /**
+     * Append records due at nowNs to out. Active-timeout records restart
+     * counting in place; force ends every flow (shutdown, end of replay).
+     */
+    void Expire(uint64_t nowNs, std::vector<FlowRecord>& out, bool force = false);
+
+    Statistics GetStatistics() const;
+    size_t Size() const { return flows_.size(); }
+
+private:
+    struct FlowKey {
+        uint8_t lowAddr[16];
+        uint8_t highAddr[16];
+        uint16_t lowPort;
+        uint16_t highPort;
+        uint8_t ipVersion;
+        uint8_t protocol;
+
+        bool operator==(const FlowKey& other) const;
+    };
+
+    struct FlowKeyHash {
+        size_t operator()(const FlowKey& key) const;
+    };
+
+    typedef std::list<std::pair<uint64_t, FlowKey>> ActiveOrder;   // (startNs, key) in start order
+
+    struct Entry {
+        FlowRecord record;
+        bool initiatorIsLow;               // Which key endpoint sent the first packet
+        bool lowFin;
+        bool highFin;
+        bool ended;
+        bool restartPending;               // Exported on active timeout; next packet restarts it
+        std::list<FlowKey>::iterator lru;
+        ActiveOrder::iterator active;      // activeOrder_.end() while restartPending
+    };
+
+    uint64_t idleTimeoutNs_;
+    uint64_t activeTimeoutNs_;
+    size_t maxFlows_;
+    std::unordered_map<FlowKey, Entry, FlowKeyHash> flows_;
+    std::list<FlowKey> lru_;                                // Least recently seen first
+    ActiveOrder activeOrder_;                               // One node per flow, removed with it
+    std::vector<FlowKey> ended_;                            // TCP teardown seen
+    std::vector<FlowRecord> evicted_;                       // Pushed out by capacity
+    Statistics stats_;
+
+    static bool MakeKey(const Observation& observation, FlowKey& key);
+    void Emit(Entry& entry, uint8_t reason, std::vector<FlowRecord>& out);
+    void Erase(std::unordered_map<FlowKey, Entry, FlowKeyHash>::iterator it);
+};
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "Utils.h"
+#include <string>
+#include <vector>
+#include <cstdint>
+
+/**
+ * Memory-mapped prefix -> (country, ASN, organisation) database
+ * CSV inputs are compiled offline into boundary tables: sorted range starts
+ * with a record index each, plus a /16 jump table for IPv4. A lookup is a
+ * short binary search over the mapped file and never allocates.
+ */
+class GeoIpDatabase {
+public:
+    // Points into the mapped file; valid while the database stays open
+    struct GeoInfo {
+        char country[3];           // ISO 3166 alpha-2, "" when unknown
+        uint32_t asn;              // 0 when unknown
+        const char* organization;  // Never null
+
+        GeoInfo() : country{0, 0, 0}, asn(0), organization("") {}
+    };
+
+    struct CompileStats {
+        uint64_t linesRead;
+        uint64_t linesSkipped;
+        uint64_t countryRanges;
+        uint64_t asnRanges;
+        uint64_t v4Boundaries;
+        uint64_t v6Boundaries;
+        uint64_t records;
+
+        CompileStats()
+            : linesRead(0), linesSkipped(0), countryRanges(0), asnRanges(0),
+              v4Boundaries(0), v6Boundaries(0), records(0) {}
+    };
+
+    GeoIpDatabase();
+    ~GeoIpDatabase();
+    GeoIpDatabase(const GeoIpDatabase&) = delete;
+    GeoIpDatabase& operator=(const GeoIpDatabase&) = delete;
+
+    /**
+     * Compile CSV sources into a database file (written atomically).
+     * Each source is "country:<file>" or "asn:<file>". Rows start with a CIDR
+     * or a "first,last" address pair, followed by the country code, or by the
+     * AS number and organisation (DB-IP / iptoasn layouts, comma or tab).
+     */
+    static bool Compile(const std::vector<std::string>& sources, const std::string& databaseFile,
+                        CompileStats* stats = nullptr, std::string* error = nullptr);
+
+    // Rejects files whose header offsets or jump table do not fit the boundary lists
+    bool Open(const std::string& databaseFile);
+    bool IsOpen() const { return file_.IsOpen(); }
+    std::string GetLastError() const { return lastError_; }
+
+    bool Lookup(const uint8_t addr[16], bool isIPv6, GeoInfo& info) const;
+    bool Lookup(const std::string& ip, GeoInfo& info) const;
+
+    /**
+     * Lookup through a small per-thread, direct-mapped cache so repeat
+     * addresses (the common case for connection tables) skip the search
+     */
+    bool LookupCached(const uint8_t addr[16], bool isIPv6, GeoInfo& info) const;
+
+    uint64_t GetBoundaryCount() const { return v4Count_ + v6Count_; }
+
+private:
+    struct Record;
+
+    Utils::MappedFile file_;
+    const uint32_t* v4Starts_;
+    const uint32_t* v4Values_;
+    const uint32_t* v4Jump_;       // 65537 entries: first boundary index per /16
+    const uint8_t* v6Starts_;      // 16 bytes each
+    const uint32_t* v6Values_;
+    const Record* records_;
+    const char* strings_;
+    uint64_t v4Count_;
+    uint64_t v6Count_;
+    uint64_t recordCount_;
+    uint64_t stringsSize_;
+    uint64_t instanceId_;          // Distinguishes databases in the thread cache
+    std::string lastError_;
+
+    bool Fill(uint32_t value, GeoInfo& info) const;
+};
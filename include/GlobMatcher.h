@@ -0,0 +1,50 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <bitset>
+#include <unordered_set>
+#include <cstddef>
+
+/**
+ * Set of exclude globs compiled once and matched against relative paths
+ * A pattern without '/' matches a file or directory name at any depth
+ * ("*.log", "node_modules"); a pattern with '/' matches the whole path
+ * relative to the walk root ("var/log/syslog.[0-9]", "etc/ssh/ssh_host_?sa_key"). '*' and '?' do not
+ * cross '/', '**' does, and [a-z] / [!a-z] are character classes.
+ * Plain names and "*.ext" patterns, the common cases, are answered with hash
+ * lookups; only the remaining patterns run the wildcard matcher.
+ */
+class GlobMatcher {
+public:
+    GlobMatcher();
+    explicit GlobMatcher(const std::vector<std::string>& patterns);
+
+    // False for an empty pattern or an unterminated character class
+    bool Add(const std::string& pattern);
+
+    // relativePath uses '/' separators and has no leading '/'
+    bool Matches(const std::string& relativePath) const;
+    bool Matches(const char* relativePath, size_t length) const;
+
+    size_t GetPatternCount() const { return patternCount_; }
+    bool Empty() const { return patternCount_ == 0; }
+
+private:
+    struct Token {
+        enum Kind { Literal, Any, AnyPath, One, Class } kind;
+        std::string text;          // Literal
+        std::bitset<256> set;      // Class, already negated if needed
+    };
+
+    using Program = std::vector<Token>;
+
+    std::unordered_set<std::string> names_;        // Exact names
+    std::unordered_set<std::string> extensions_;   // "*.ext" as ".ext"
+    std::vector<Program> namePrograms_;
+    std::vector<Program> pathPrograms_;
+    size_t patternCount_;
+
+    static bool Compile(const std::string& pattern, Program& program);
+    static bool Run(const Program& program, size_t token, const char* text, size_t length, size_t position);
+};
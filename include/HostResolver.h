@@ -0,0 +1,137 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <list>
+#include <map>
+#include <unordered_map>
+#include <deque>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+#include <cstdint>
+
+/**
+ * Asynchronous reverse-DNS resolver
+ * Answers immediately from a sharded LRU cache (positive and negative entries
+ * with TTLs) and resolves misses on a bounded pool of worker threads, so the
+ * monitoring loop never blocks on name resolution
+ */
+class HostResolver {
+public:
+    enum class Status {
+        Resolved,
+        NotFound,   // Cached negative answer
+        Pending     // Queued or in flight; ask again later
+    };
+
+    struct Result {
+        Status status;
+        std::string hostname;
+    };
+
+    struct Options {
+        size_t maxInFlight;                 // Worker threads resolving concurrently
+        size_t maxQueued;                   // Misses beyond this are dropped until the queue drains
+        size_t cacheCapacity;               // Total entries across all shards
+        std::chrono::seconds positiveTtl;
+        std::chrono::seconds negativeTtl;
+        std::string hostsFile;              // Empty to skip hosts file lookups
+        bool useSystemResolver;             // getnameinfo() after the hosts file
+
+        Options()
+            : maxInFlight(4), maxQueued(1024), cacheCapacity(16384),
+              positiveTtl(std::chrono::hours(1)), negativeTtl(std::chrono::minutes(5)),
+#ifdef _WIN32
+              hostsFile("C:\\Windows\\System32\\drivers\\etc\\hosts"),
+#else
+              hostsFile("/etc/hosts"),
+#endif
+              useSystemResolver(true) {}
+    };
+
+    struct Statistics {
+        uint64_t cacheHits;
+        uint64_t negativeHits;
+        uint64_t pendingHits;
+        uint64_t resolved;
+        uint64_t failed;
+        uint64_t dropped;
+    };
+
+    // Stub resolver hook: return true and fill hostname on success
+    using ResolveFunction = std::function<bool(const std::string& ip, std::string& hostname)>;
+
+    explicit HostResolver(const Options& options = Options());
+    ~HostResolver();
+    HostResolver(const HostResolver&) = delete;
+    HostResolver& operator=(const HostResolver&) = delete;
+
+    static HostResolver& Instance();
+
+    /**
+     * Non-blocking lookup. A miss queues the address and returns Pending.
+     */
+    Result Lookup(const std::string& ip);
+
+    // Replace the system resolver, e.g. with a stub for offline testing
+    void SetResolveFunction(ResolveFunction resolver);
+    bool ReloadHostsFile();
+
+    // Block until nothing is queued or in flight (testing and shutdown)
+    bool WaitForIdle(std::chrono::milliseconds timeout);
+    void ClearCache();
+    Statistics GetStatistics() const;
+
+private:
+    static constexpr size_t SHARD_COUNT = 16;
+
+    enum class EntryState { Resolved, NotFound, Pending };
+
+    struct CacheEntry {
+        std::string key;
+        std::string hostname;
+        EntryState state;
+        std::chrono::steady_clock::time_point expires;
+    };
+
+    struct Shard {
+        std::mutex mutex;
+        std::list<CacheEntry> lru;   // Front = most recently used
+        std::unordered_map<std::string, std::list<CacheEntry>::iterator> index;
+    };
+
+    Options options_;
+    size_t shardCapacity_;
+    Shard shards_[SHARD_COUNT];
+
+    mutable std::mutex queueMutex_;
+    std::condition_variable queueCondition_;
+    std::condition_variable idleCondition_;
+    std::deque<std::string> queue_;
+    size_t inFlight_;
+    bool stopping_;
+    std::vector<std::thread> workers_;
+
+    mutable std::mutex resolverMutex_;
+    ResolveFunction resolver_;
+    std::map<std::string, std::string> hosts_;
+
+    std::atomic<uint64_t> cacheHits_;
+    std::atomic<uint64_t> negativeHits_;
+    std::atomic<uint64_t> pendingHits_;
+    std::atomic<uint64_t> resolved_;
+    std::atomic<uint64_t> failed_;
+    std::atomic<uint64_t> dropped_;
+
+    Shard& ShardFor(const std::string& key);
+    void Store(const std::string& key, const std::string& hostname, EntryState state,
+               std::chrono::steady_clock::duration ttl);
+    void Forget(const std::string& key);
+    void WorkerLoop();
+    bool ResolveAddress(const std::string& ip, std::string& hostname);
+    static bool SystemResolve(const std::string& ip, std::string& hostname);
+};
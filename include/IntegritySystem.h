@@ -1,8 +1,13 @@
 #pragma once
 
+#include "MerkleTree.h"
+#include "TreeWalker.h"
 #include <string>
 #include <vector>
 #include <map>
+#include <ostream>
+#include <functional>
+#include <cstdint>
 
 /**
  * Self-protection and integrity verification system
@@ -15,20 +20,93 @@ namespace IntegritySystem {
         std::string actualHash;
         bool isValid;
         bool exists;
+        std::vector<MerkleTree::ByteRange> changedRanges;  // Merkle files that fail verification
         
         FileInfo(const std::string& p, const std::string& expected) 
             : path(p), expectedHash(expected), isValid(false), exists(false) {}
     };
     
+    enum class HashAlgorithm {
+        Sha256,     // Plain hex digests and Merkle trees; the externally verifiable default
+        Blake3      // "blake3/<hex>"; several times faster on bulk data
+    };
+    
+    struct PassStatistics {
+        uint64_t cacheHits;                 // Unchanged fingerprint, hash taken from the cache
+        uint64_t cacheMisses;
+        uint64_t bytesHashed;
+        uint64_t bytesSkipped;              // Not read thanks to the cache
+        uint64_t sharedHardLinks;           // Paths that reused another path's hash of the same inode
+        bool fullRehash;                    // The cache was ignored for this pass
+        bool ioUring;                       // Small files were read through io_uring
+        
+        double HitRate() const {
+            return cacheHits + cacheMisses ? static_cast<double>(cacheHits) / (cacheHits + cacheMisses) : 0.0;
+        }
+    };
+    
     struct IntegrityReport {
         bool overallValid;
-        std::vector<FileInfo> files;
+        std::vector<FileInfo> files;        // In completion order
         std::vector<std::string> warnings;
         std::vector<std::string> errors;
+        PassStatistics statistics;
+        
+        IntegrityReport() : overallValid(true), statistics{} {}
+    };
+    
+    enum class ChangeKind {
+        Added,                  // Monitored, not in the baseline
+        Removed,                // In the baseline, gone from disk
+        Modified,               // Contents differ; the modes say whether permissions changed too
+        PermissionsChanged      // Same contents, different permission bits
+    };
+    
+    struct FileChange {
+        ChangeKind kind;
+        std::string path;
+        std::string expectedHash;           // Empty for added files
+        std::string actualHash;             // Empty for removed files
+        uint32_t expectedMode;              // Permission bits, or kUnknownMode
+        uint32_t actualMode;
+        std::vector<MerkleTree::ByteRange> changedRanges;
+        
+        static const uint32_t kUnknownMode = 0xFFFFFFFF;
+        
+        FileChange(ChangeKind k, const std::string& p)
+            : kind(k), path(p), expectedMode(kUnknownMode), actualMode(kUnknownMode) {}
+    };
+    
+    struct DiffSummary {
+        uint64_t filesChecked;
+        uint64_t unchanged;
+        uint64_t added;
+        uint64_t removed;
+        uint64_t modified;
+        uint64_t permissionsChanged;        // Same contents only; modified files count as modified
+    };
+    
+    struct DiffReport {
+        bool clean;                         // No changes and no errors
+        uint32_t baselineGeneration;        // The generation compared against; 0 without a binary baseline
+        uint32_t promotedGeneration;        // 0 unless the pass was promoted
+        std::vector<FileChange> changes;    // Sorted by path
+        std::vector<std::string> warnings;
+        std::vector<std::string> errors;    // Files that could not be hashed
+        DiffSummary summary;
+        PassStatistics statistics;
         
-        IntegrityReport() : overallValid(true) {}
+        DiffReport() : clean(true), baselineGeneration(0), promotedGeneration(0), summary{}, statistics{} {}
+    };
+    
+    struct VerifyProgress {
+        size_t filesDone;
+        size_t filesTotal;
+        uint64_t bytesHashed;
     };
     
+    using ProgressCallback = std::function<void(const VerifyProgress&)>;
+    
     /**
      * Initialize integrity system with known good hashes
      */
@@ -37,16 +115,132 @@ namespace IntegritySystem {
     /**
      * Add a file to the integrity check list
      * @param filePath Path to the file to monitor
-     * @param expectedHash Expected SHA-256 hash (empty to calculate on first run)
+     * @param expectedHash Expected SHA-256 hash, BLAKE3 id or serialized Merkle tree (empty to calculate on first run)
      */
     void AddFileToCheck(const std::string& filePath, const std::string& expectedHash = "");
     
+    /**
+     * Add every regular file under the given roots to the integrity check list
+     * Trees are walked in parallel; excludes are globs relative to each root.
+     * @param oneFileSystem Do not descend into other mounted filesystems
+     * @param stats Receives the walk statistics (files/sec, excluded, ...)
+     * @return Number of files found
+     */
+    size_t AddScanPaths(const std::vector<std::string>& roots, const std::vector<std::string>& excludePatterns,
+                        bool oneFileSystem = true, TreeWalker::Statistics* stats = nullptr);
+    
+    /**
+     * AddScanPaths with checks.file_integrity scan_paths, exclude_patterns and one_filesystem
+     * @return Number of files found; 0 if no scan paths are configured
+     */
+    size_t AddConfiguredScanPaths(TreeWalker::Statistics* stats = nullptr);
+    
+    /**
+     * Paths of every monitored file, baseline entries included
+     */
+    std::vector<std::string> GetMonitoredFiles();
+    
+    /**
+     * Remove every file from the integrity check list
+     */
+    void ClearFilesToCheck();
+    
     /**
      * Perform comprehensive integrity check
      * @return IntegrityReport with detailed results
      */
     IntegrityReport PerformIntegrityCheck();
     
+    /**
+     * Perform integrity check on a work-stealing pool
+     * Small files are hashed in batches, large files as a sequence of chunk tasks.
+     * @param progress Called on the calling thread about every 100 ms and once at the end
+     * @param parallelism Worker threads; 0 = all cores. Capped by [integrity] max_parallelism
+     * @return IntegrityReport with detailed results
+     */
+    IntegrityReport PerformIntegrityCheck(const ProgressCallback& progress, unsigned parallelism = 0);
+    
+    struct DiffOptions {
+        bool promote;                       // Make the verified state the next baseline generation
+        std::string baselineFile;           // Promotion target; empty = the loaded binary baseline
+        unsigned parallelism;               // As for PerformIntegrityCheck
+        ProgressCallback progress;
+        
+        DiffOptions() : promote(false), parallelism(0) {}
+    };
+    
+    /**
+     * Integrity check that reports only what changed since the loaded baseline
+     * Runs the same pass as PerformIntegrityCheck, but unchanged files are only
+     * counted, so the report grows with the changes instead of the baseline.
+     * Permission changes are found against the modes a binary baseline records.
+     * With promote set and no file failing to hash, the hashes and metadata of
+     * the pass are written as the next baseline generation (temporary file and
+     * rename) and become the loaded baseline.
+     */
+    DiffReport PerformIntegrityDiff(const DiffOptions& options = DiffOptions());
+    
+    /**
+     * Stream a diff report through JsonReporting::ReportWriter
+     * A summary result comes first, then one result per change and per error.
+     * @return false if the stream failed
+     */
+    bool WriteDiffReport(const DiffReport& report, std::ostream& out);
+    
+    /**
+     * Configure the stat-fingerprint cache used to skip unchanged files
+     * Defaults come from [integrity] fingerprint_cache, full_rehash_hours and birth_time.
+     * @param cacheFile Where the cache persists between runs; empty (the default) keeps it in memory
+     * @param fullRehashHours Hours between passes that rehash everything; 0 = every pass
+     */
+    void ConfigureFingerprintCache(const std::string& cacheFile, int fullRehashHours);
+    
+    /**
+     * Make the next integrity check ignore the fingerprint cache
+     */
+    void RequestFullRehash();
+    
+    /**
+     * Configure Merkle mode for large files
+     * Files of at least minFileSize bytes without a plain baseline hash are hashed
+     * as a tree of chunkSize chunks; the tree is stored in the baseline so a
+     * mismatch reports the byte ranges that differ. Not used for new files in
+     * BLAKE3 mode. Defaults come from [integrity] merkle_min_size_mb and merkle_chunk_kb.
+     * @param minFileSize Smallest file hashed as a tree; 0 disables Merkle mode
+     */
+    void ConfigureMerkle(uint64_t minFileSize, size_t chunkSize = MerkleTree::DefaultChunkSize);
+    
+    /**
+     * Configure the io_uring read path for small files
+     * Files up to 64 KiB are stat'ed, opened, read and closed as io_uring requests,
+     * queueDepth files at a time, into buffers registered once and reused. Kernels
+     * without io_uring, or with it disabled, keep the read() path. Defaults come
+     * from [integrity] io_uring and io_uring_depth.
+     */
+    void ConfigureIoUring(bool enabled, unsigned queueDepth = 128);
+    
+    /**
+     * Choose the hash for files without a baseline hash and for new baselines
+     * Every other file is verified with the algorithm of its baseline entry, so
+     * SHA-256 and BLAKE3 entries coexist in one baseline. In BLAKE3 mode files of
+     * 64 MiB and more are split into subtrees hashed across the verification pool.
+     * Defaults to [integrity] hash_algorithm, "sha256" or "blake3".
+     */
+    void ConfigureHashAlgorithm(HashAlgorithm algorithm);
+    
+    /**
+     * Algorithm a hash was made with: BLAKE3 for blake3/ ids, SHA-256 for hex digests and Merkle trees
+     */
+    HashAlgorithm HashAlgorithmOf(const std::string& hash);
+    
+    /**
+     * Re-verify a monitored file after a watcher reported writes to some of its bytes
+     * Merkle files rehash only the chunks overlapping the dirty ranges and reuse the
+     * rest of the tree from their last verification; other files are rehashed whole.
+     * @return The updated entry; exists is false if the path is not monitored
+     */
+    FileInfo VerifyFileRanges(const std::string& filePath, const std::vector<MerkleTree::ByteRange>& dirty);
+    
     /**
      * Quick integrity check for startup verification
      * @return true if all critical files are valid
@@ -54,11 +248,11 @@ namespace IntegritySystem {
     bool QuickIntegrityCheck();
     
     /**
-     * Calculate SHA-256 hash of a file
+     * Calculate the hash of a file
      * @param filePath Path to the file
-     * @return Hex-encoded SHA-256 hash or empty string on error
+     * @return Hex-encoded SHA-256 hash, BLAKE3 id, or empty string on error
      */
-    std::string CalculateFileHash(const std::string& filePath);
+    std::string CalculateFileHash(const std::string& filePath, HashAlgorithm algorithm = HashAlgorithm::Sha256);
     
     /**
      * Verify digital signature (Windows only)
@@ -69,6 +263,7 @@ namespace IntegritySystem {
     
     /**
      * Generate integrity baseline file
+     * Written in the binary BaselineIndex format with each file's size, mtime and permissions.
      * @param baselineFile Path where to save the baseline
      * @return true on success
      */
@@ -76,6 +271,7 @@ namespace IntegritySystem {
     
     /**
      * Load integrity baseline from file
+     * Binary baselines are memory-mapped; text "path:hash" baselines are still read.
      * @param baselineFile Path to baseline file
      * @return true on success
      */
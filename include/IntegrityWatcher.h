@@ -0,0 +1,124 @@
+#pragma once
+
+#include "IntegritySystem.h"
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+#include <functional>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <cstdint>
+
+/**
+ * Event-driven continuous integrity verification
+ * The parent directory of every monitored file is watched with inotify for
+ * writes, close-after-write, renames and deletions. A changed file joins a
+ * dirty set and is re-verified once it has been quiet for the debounce
+ * interval (or after maxDelay under continuous writes), so steady-state I/O
+ * follows churn rather than the size of the baseline. A low-frequency full
+ * pass catches anything the events missed, and runs at once after the event
+ * queue overflows. When fanotify is available (CAP_SYS_ADMIN) the same
+ * directories are marked for modify events too, which name the writing pid.
+ *
+ * The watcher thread calls into IntegritySystem, which serialises its passes
+ * against calls from other threads; files added after Start are not watched
+ * until the next Start.
+ */
+class IntegrityWatcher {
+public:
+    struct Options {
+        std::chrono::milliseconds debounce;       // Quiet time before a dirty file is rehashed
+        std::chrono::milliseconds maxDelay;       // Rehash a file still being written after this long
+        std::chrono::minutes sweepInterval;       // Full verification pass; 0 = only after overflows
+
+        Options() : debounce(500), maxDelay(10000), sweepInterval(360) {}
+    };
+
+    struct Statistics {
+        uint64_t events;                  // Events naming a monitored file
+        uint64_t filesRehashed;           // Targeted re-verifications of dirty files
+        uint64_t mismatches;              // Reported files that failed verification
+        uint64_t sweeps;
+        uint64_t overflows;               // Event queue overflows, each followed by a sweep
+        uint64_t watchedDirectories;
+        uint64_t unwatchedDirectories;    // Left to the sweep: missing, or out of watches
+
+        Statistics() : events(0), filesRehashed(0), mismatches(0), sweeps(0), overflows(0),
+                       watchedDirectories(0), unwatchedDirectories(0) {}
+    };
+
+    /**
+     * Called on the watcher thread for every rehashed file and for new sweep mismatches
+     * @param change MODIFY, REPLACE (renamed or recreated over), DELETE or SWEEP
+     * @param pid last process seen writing the file, 0 when unknown
+     */
+    using ChangeCallback =
+        std::function<void(const IntegritySystem::FileInfo& file, const std::string& change, int pid)>;
+
+    explicit IntegrityWatcher(const Options& options = Options());
+    ~IntegrityWatcher();
+    IntegrityWatcher(const IntegrityWatcher&) = delete;
+    IntegrityWatcher& operator=(const IntegrityWatcher&) = delete;
+
+    void SetChangeCallback(ChangeCallback callback) { callback_ = callback; }
+
+    /**
+     * Watch the files IntegritySystem monitors now and start the watcher thread
+     * Without inotify (non-Linux) only the periodic sweep runs.
+     */
+    bool Start();
+    void Stop();
+    bool IsRunning() const { return running_.load(); }
+
+    // Queue a file as if an event had named it
+    void MarkDirty(const std::string& path, const std::string& change = "MODIFY", int pid = 0);
+
+    Statistics GetStatistics() const;
+    std::string GetLastError() const { return lastError_; }
+
+private:
+    struct Dirty {
+        std::chrono::steady_clock::time_point first;
+        std::chrono::steady_clock::time_point last;
+        std::string change;
+        int pid;
+    };
+
+    Options options_;
+    ChangeCallback callback_;
+    std::string lastError_;
+    std::atomic<bool> running_;
+    std::thread thread_;
+    int notifyFd_;
+    int wakeFd_;
+    int writerFd_;                                                        // fanotify, -1 without privileges
+
+    // Monitored file names by parent directory, and the directories of each watch
+    // (one directory reached through two spellings, "." and its absolute path, shares a watch)
+    std::unordered_map<std::string, std::unordered_set<std::string>> directories_;
+    std::unordered_map<int, std::vector<std::string>> watches_;
+    std::unordered_set<std::string> unwatched_;
+    std::unordered_map<std::string, std::string> canonical_;             // Resolved path -> monitored spelling
+
+    std::mutex dirtyMutex_;
+    std::unordered_map<std::string, Dirty> dirty_;
+    std::unordered_map<std::string, std::string> reported_;   // Path -> hash of the last reported mismatch
+    std::chrono::steady_clock::time_point nextSweep_;
+
+    mutable std::mutex statsMutex_;
+    Statistics stats_;
+
+    // An empty change keeps the queued one; pid 0 keeps the known writer
+    void Queue(const std::string& path, const std::string& change, int pid = 0);
+    void WatchDirectories();
+    void WatchLoop();
+    void ReadEvents();
+    void ReadWriters();
+    void RehashReady(std::chrono::steady_clock::time_point now);
+    void Sweep();
+    void Report(const IntegritySystem::FileInfo& file, const std::string& change, int pid);
+    std::chrono::steady_clock::time_point NextDeadline();
+};
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+
+/**
+ * Multi-pattern indicator matcher
+ * All indicator strings compile into one Aho-Corasick automaton. While the
+ * automaton sits in its root state a SIMD prefilter (SSSE3/AVX2 nibble
+ * lookup on the first byte, then a byte-pair bitmap) skips ahead to the next
+ * position where any pattern could start, so text without indicators is
+ * scanned at memory speed. Compile once, then scan from any thread.
+ */
+class IocMatcher {
+public:
+    struct Match {
+        uint32_t patternId;
+        size_t start;       // Byte offsets into the scanned text, [start, end)
+        size_t end;
+    };
+
+    struct Options {
+        bool caseInsensitive;   // ASCII case folding for patterns and text
+
+        Options() : caseInsensitive(true) {}
+    };
+
+    explicit IocMatcher(const Options& options = Options());
+
+    // Returns the pattern id; repeated patterns share one id. Only before Compile().
+    uint32_t AddPattern(std::string_view pattern);
+    // One indicator per line; blank lines and '#' comments are skipped
+    bool LoadPatterns(const std::string& file);
+    void Compile();
+
+    void Scan(std::string_view text, std::vector<Match>& matches) const;
+    bool Contains(std::string_view text) const;
+
+    const std::string& GetPattern(uint32_t id) const { return patterns_[id]; }
+    size_t GetPatternCount() const { return patterns_.size(); }
+    size_t GetStateCount() const { return edgeStart_.size(); }
+    bool IsCompiled() const { return compiled_; }
+    std::string GetLastError() const { return lastError_; }
+
+    // Prefilter implementation chosen for this CPU: "avx2", "ssse3" or "scalar"
+    static const char* GetPrefilterName();
+
+private:
+    Options options_;
+    bool compiled_;
+    std::string lastError_;
+    std::vector<std::string> patterns_;
+    std::unordered_map<std::string, uint32_t> patternIds_;   // Folded text -> id
+
+    // Trie, flattened after Compile(): edges of a state are sorted by byte
+    std::vector<uint32_t> edgeStart_;
+    std::vector<uint16_t> edgeCount_;
+    std::vector<uint8_t> edgeBytes_;
+    std::vector<uint32_t> edgeTargets_;
+    std::vector<uint32_t> fail_;
+    std::vector<uint32_t> outputStart_;      // Pattern ids ending exactly at a state
+    std::vector<uint32_t> outputCount_;
+    std::vector<uint32_t> outputs_;
+    std::vector<uint32_t> dictionaryLink_;   // Nearest fail ancestor with outputs, 0 = none
+    std::vector<uint32_t> patternLength_;
+    uint32_t rootNext_[256];                 // Dense root transitions
+    uint8_t fold_[256];
+
+    // Prefilter: possible first bytes as shufti nibble tables, then first-pair bitmap
+    alignas(16) uint8_t nibbleLow_[16];
+    alignas(16) uint8_t nibbleHigh_[16];
+    bool firstByte_[256];
+    std::vector<uint64_t> pairBits_;          // 65536 bits over folded byte pairs
+
+    uint32_t Next(uint32_t state, uint8_t byte) const;
+    size_t NextCandidate(const uint8_t* data, size_t position, size_t length) const;
+    template <typename Emit>
+    void Run(std::string_view text, Emit emit) const;
+};
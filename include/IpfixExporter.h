@@ -0,0 +1,78 @@
+#pragma once
+
+#include "FlowTable.h"
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdint>
+
+/**
+ * IPFIX (RFC 7011) exporter over UDP
+ * Sends bidirectional flow records (RFC 5103 reverse elements) using one
+ * template per address family. Records are packed into as few datagrams as
+ * the MTU allows, and templates are resent periodically as UDP requires.
+ */
+class IpfixExporter {
+public:
+    static constexpr uint16_t TEMPLATE_IPV4 = 256;
+    static constexpr uint16_t TEMPLATE_IPV6 = 257;
+    static constexpr size_t RECORD_LENGTH_IPV4 = 66;
+    static constexpr size_t RECORD_LENGTH_IPV6 = 90;
+
+    struct Options {
+        uint32_t observationDomainId;
+        size_t maxDatagram;                       // Bytes per message, headers included
+        std::chrono::seconds templateRefresh;
+
+        Options() : observationDomainId(1), maxDatagram(1400), templateRefresh(60) {}
+    };
+
+    struct Statistics {
+        uint64_t messages;
+        uint64_t records;
+        uint64_t templates;
+        uint64_t bytes;
+        uint64_t sendErrors;
+    };
+
+    explicit IpfixExporter(const Options& options = Options());
+    ~IpfixExporter();
+    IpfixExporter(const IpfixExporter&) = delete;
+    IpfixExporter& operator=(const IpfixExporter&) = delete;
+
+    // Collector as "host:port" or "[v6addr]:port"
+    bool Open(const std::string& collector);
+    void Close();
+    bool IsOpen() const;
+
+    // Queue records; full datagrams are sent as they fill
+    void Export(const std::vector<FlowTable::FlowRecord>& records);
+    // Send the partially filled datagram, if any
+    void Flush();
+
+    Statistics GetStatistics() const { return stats_; }
+    std::string GetLastError() const { return lastError_; }
+
+private:
+    Options options_;
+#ifdef _WIN32
+    uintptr_t socket_;
+#else
+    int socket_;
+#endif
+    std::vector<uint8_t> message_;
+    size_t setOffset_;           // Start of the open data set, 0 when none
+    uint16_t setTemplate_;
+    uint32_t messageRecords_;
+    uint32_t sequence_;          // Data records sent before the current message
+    std::chrono::steady_clock::time_point lastTemplates_;
+    bool templatesDue_;
+    Statistics stats_;
+    std::string lastError_;
+
+    void BeginMessage();
+    void AppendTemplates();
+    void CloseSet();
+    void AppendRecord(const FlowTable::FlowRecord& record);
+    void Send();
+};
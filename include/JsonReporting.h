@@ -4,6 +4,7 @@
 #include <map>
 #include <vector>
 #include <chrono>
+#include <ostream>
 
 /**
  * JSON Report System for standardized security check output
@@ -60,6 +61,27 @@ namespace JsonReporting {
      */
     std::string SecurityReportToJson(const SecurityReport& report);
     
+    /**
+     * Writes a SecurityReport one result at a time
+     * Gives the same document as SecurityReportToJson without holding every
+     * result in memory: Begin with the report's header fields, Write each
+     * result as it is produced, then End.
+     */
+    class ReportWriter {
+    public:
+        explicit ReportWriter(std::ostream& out);
+        
+        // Writes everything but report.results
+        void Begin(const SecurityReport& report);
+        void Write(const CheckResult& result);
+        // False if the stream failed
+        bool End();
+        
+    private:
+        std::ostream& out_;
+        size_t written_;
+    };
+    
     /**
      * Parse JSON string to CheckResult
      */
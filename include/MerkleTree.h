@@ -0,0 +1,67 @@
+#pragma once
+
+#include "Sha256.h"
+#include <array>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+/**
+ * SHA-256 Merkle tree over fixed-size chunks of a file
+ * Leaves are SHA-256(0x00 || chunk) and interior nodes SHA-256(0x01 || left || right),
+ * with an odd last node promoted unchanged. Because every chunk has its own
+ * leaf, a changed file can be re-verified by rehashing only the chunks known
+ * to be dirty, and two trees of the same file can be compared by descending
+ * only into subtrees whose hashes differ, which yields the changed byte ranges.
+ */
+class MerkleTree {
+public:
+    static const size_t DefaultChunkSize = 1024 * 1024;
+
+    using Digest = std::array<uint8_t, Sha256::DigestSize>;
+
+    struct ByteRange {
+        uint64_t offset;
+        uint64_t length;
+    };
+
+    MerkleTree();
+
+    // Sizes the leaf level for a file of fileSize bytes; leaves must then be hashed
+    void Reset(uint64_t fileSize, size_t chunkSize = DefaultChunkSize);
+
+    // Distinct chunks may be hashed concurrently; call Finish once all are done
+    void HashChunk(size_t index, const uint8_t* data, size_t length);
+    // Recomputes the interior levels from the leaves
+    void Finish();
+
+    size_t GetChunkCount() const { return levels_.empty() ? 0 : levels_[0].size(); }
+    size_t GetChunkSize() const { return chunkSize_; }
+    uint64_t GetFileSize() const { return fileSize_; }
+    ByteRange GetChunkRange(size_t index) const;
+    Digest GetRoot() const;
+
+    // "merkle/<chunk size>/<root hex>", used wherever a plain file hash would be
+    std::string GetId() const;
+    // GetId() followed by "/<file size>/<leaf hashes>"
+    std::string Serialize() const;
+    // Rejects text whose leaves do not reproduce the root it names
+    static bool Parse(const std::string& text, MerkleTree& tree);
+    static bool IsMerkleId(const std::string& hash);
+    // Chunk size named by a Merkle id or serialized tree; 0 if it is not one
+    static size_t ChunkSizeOf(const std::string& hash);
+
+    // Sorted chunk indices overlapping any of the ranges
+    std::vector<size_t> ChunksIn(const std::vector<ByteRange>& ranges) const;
+
+    // Byte ranges where actual differs from expected, adjacent chunks merged
+    static std::vector<ByteRange> Diff(const MerkleTree& expected, const MerkleTree& actual);
+
+private:
+    size_t chunkSize_;
+    uint64_t fileSize_;
+    std::vector<std::vector<Digest>> levels_;   // levels_[0] are the leaves, back() the root
+
+    static void AddRange(std::vector<ByteRange>& ranges, uint64_t offset, uint64_t length);
+    void DiffNode(const MerkleTree& other, size_t level, size_t index, std::vector<ByteRange>& ranges) const;
+};
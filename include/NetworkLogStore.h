@@ -0,0 +1,134 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <unordered_map>
+#include <chrono>
+#include <cstdint>
+
+/**
+ * Column-oriented, chunked ring store for network logs
+ * Rows are kept as parallel columns (timestamps, binary addresses, interned
+ * protocol/threat/status codes) in fixed-size chunks. Filters run as tight
+ * per-column loops the compiler can vectorise, and the oldest chunk is
+ * evicted whole once the row budget is reached. Interned non-IP addresses
+ * are reference counted per row and dropped with the last chunk using them.
+ * Not synchronised; the owner serialises access.
+ */
+class NetworkLogStore {
+public:
+    struct Row {
+        uint64_t id;
+        std::chrono::system_clock::time_point timestamp;
+        std::string sourceIp;
+        std::string destinationIp;
+        std::string protocol;
+        std::string threat;
+        std::string status;
+    };
+
+    struct Query {
+        std::chrono::system_clock::time_point from;
+        std::chrono::system_clock::time_point to;
+        std::string ip;          // Matches source or destination; empty = any
+        std::string protocol;    // Exact match; empty = any
+        std::string threat;
+        std::string status;
+        size_t limit;            // Newest matches first
+
+        Query()
+            : from(std::chrono::system_clock::time_point::min()),
+              to(std::chrono::system_clock::time_point::max()), limit(100) {}
+    };
+
+    static constexpr size_t CHUNK_ROWS = 4096;
+
+    explicit NetworkLogStore(size_t maxRows = 262144);
+
+    void Append(std::chrono::system_clock::time_point timestamp,
+                const std::string& sourceIp, const std::string& destinationIp,
+                const std::string& protocol, const std::string& threat, const std::string& status);
+
+    // Most recent rows in chronological order
+    std::vector<Row> Tail(size_t count) const;
+    std::vector<Row> Select(const Query& query) const;
+    size_t Count(const Query& query) const;
+
+    size_t Size() const;
+    size_t Capacity() const { return maxChunks_ * CHUNK_ROWS; }
+    uint64_t NextId() const { return nextId_; }
+    // Distinct non-IP addresses still referenced by stored rows
+    size_t InternedAddresses() const { return addresses_.Size(); }
+    void Clear();
+
+private:
+    enum AddressKind : uint8_t { IPv4 = 0, IPv6 = 1, Text = 2 };
+
+    struct Chunk {
+        uint64_t firstId;
+        size_t rows;
+        int64_t minTime;
+        int64_t maxTime;
+        int64_t timeNs[CHUNK_ROWS];
+        uint64_t srcHi[CHUNK_ROWS];
+        uint64_t srcLo[CHUNK_ROWS];
+        uint64_t dstHi[CHUNK_ROWS];
+        uint64_t dstLo[CHUNK_ROWS];
+        uint8_t srcKind[CHUNK_ROWS];
+        uint8_t dstKind[CHUNK_ROWS];
+        uint16_t protocol[CHUNK_ROWS];
+        uint16_t threat[CHUNK_ROWS];
+        uint16_t status[CHUNK_ROWS];
+    };
+
+    // String interning for low-cardinality columns and non-IP addresses
+    class Dictionary {
+    public:
+        explicit Dictionary(uint32_t maxCodes = UINT32_MAX) : maxCodes_(maxCodes) {}
+        uint32_t Intern(const std::string& value);
+        // Intern plus one reference; the code is freed for reuse when Release drops it to zero
+        uint32_t Acquire(const std::string& value);
+        void Release(uint32_t code);
+        bool Find(const std::string& value, uint32_t& code) const;
+        const std::string& Get(uint32_t code) const { return values_[code]; }
+        size_t Size() const { return codes_.size(); }
+        void Clear();
+    private:
+        std::vector<std::string> values_;
+        std::unordered_map<std::string, uint32_t> codes_;
+        std::vector<uint32_t> references_;   // Only maintained through Acquire/Release
+        std::vector<uint32_t> freeCodes_;
+        uint32_t maxCodes_;
+    };
+
+    struct AddressKey {
+        uint64_t hi;
+        uint64_t lo;
+        uint8_t kind;
+    };
+
+    size_t maxChunks_;
+    uint64_t nextId_;
+    std::deque<std::unique_ptr<Chunk>> chunks_;
+    std::unique_ptr<Chunk> spare_;
+    Dictionary protocols_;
+    Dictionary threats_;
+    Dictionary statuses_;
+    Dictionary addresses_;
+
+    AddressKey EncodeAddress(const std::string& address);
+    bool LookupAddress(const std::string& address, AddressKey& key) const;
+    std::string DecodeAddress(uint64_t hi, uint64_t lo, uint8_t kind) const;
+    Row MaterializeRow(const Chunk& chunk, size_t index) const;
+
+    // Resolve filter strings to column codes; false when nothing can match
+    bool CompileFilter(const Query& query, int64_t& from, int64_t& to, AddressKey& ip, bool& hasIp,
+                       int32_t& protocol, int32_t& threat, int32_t& status) const;
+    // Sets mask[i] = 1 for matching rows and returns the match count
+    size_t ScanChunk(const Chunk& chunk, int64_t from, int64_t to, const AddressKey* ip,
+                     int32_t protocol, int32_t threat, int32_t status, uint8_t* mask) const;
+
+    static int64_t ToNanoseconds(std::chrono::system_clock::time_point time);
+};
@@ -1,5 +1,8 @@
 #pragma once
 
+#include "FlowTable.h"
+#include "NetworkLogStore.h"
+#include "ProcessAttribution.h"
 #include <string>
 #include <vector>
 #include <memory>
@@ -8,7 +11,14 @@
 #include <thread>
 #include <mutex>
 #include <set>
+#include <functional>
+#include <filesystem>
 #include <algorithm>
+#include <cstdint>
+
+class ReputationIndex;
+class GeoIpDatabase;
+class IpfixExporter;
 
 /**
  * Network monitoring and analysis component
@@ -25,6 +35,10 @@ public:
         std::string state;
         std::string processName;
         int processId;
+        uint64_t socketInode;      // 0 when unknown (TIME_WAIT, replayed traffic)
+        std::string country;       // Remote address GeoIP context, empty/0 when unknown
+        uint32_t asn;
+        std::string organization;
         std::chrono::system_clock::time_point timestamp;
     };
 
@@ -36,6 +50,23 @@ public:
         std::string protocol;
         std::string threat;
         std::string status;
+        std::string country;       // Source address GeoIP context, resolved on read
+        uint32_t asn;
+    };
+
+    // Decoded packet as produced by live capture or offline replay
+    struct PacketInfo {
+        uint64_t timestampNs;      // Capture time, nanoseconds since epoch
+        uint32_t capturedLength;
+        uint32_t originalLength;
+        uint8_t ipVersion;         // 4 or 6, 0 when the frame is not IP
+        uint8_t protocol;          // IP protocol number (6 = TCP, 17 = UDP)
+        uint8_t tcpFlags;
+        uint8_t srcAddr[16];
+        uint8_t dstAddr[16];
+        uint16_t srcPort;
+        uint16_t dstPort;
+        uint32_t payloadLength;
     };
 
     struct TrafficStats {
@@ -59,6 +90,8 @@ public:
     // Connection tracking
     std::vector<NetworkConnection> GetActiveConnections() const;
     std::vector<NetworkLog> GetNetworkLogs(int limit = 100) const;
+    std::vector<NetworkLog> QueryNetworkLogs(const NetworkLogStore::Query& query) const;
+    size_t CountNetworkLogs(const NetworkLogStore::Query& query) const;
     
     // Traffic analysis
     TrafficStats GetCurrentStats() const;
@@ -76,37 +109,105 @@ public:
     std::string AnalyzeTrafficPattern(const std::string& ip) const;
     void UpdateThreatDatabase();
 
+    // Reputation feeds: the index is swapped atomically, lookups never block
+    bool LoadReputationIndex(const std::string& indexFile);
+    void SetReputationIndex(std::shared_ptr<const ReputationIndex> index);
+    bool IsIPListed(const std::string& ip, std::string* feed = nullptr) const;
+
+    // GeoIP/ASN enrichment from a compiled database, swapped like the reputation index
+    bool LoadGeoDatabase(const std::string& databaseFile);
+    void SetGeoDatabase(std::shared_ptr<const GeoIpDatabase> database);
+
+    // Called for every log entry as it is written, outside internal locks
+    using LogCallback = std::function<void(const NetworkLog&)>;
+    void SetLogCallback(LogCallback callback);
+    
+    // Called for every newly observed connection after attribution and enrichment
+    using ConnectionCallback = std::function<void(const NetworkConnection&)>;
+    void SetConnectionCallback(ConnectionCallback callback);
+
+    // Feed observations through the same analysis stages as live scanning
+    void ProcessConnection(const NetworkConnection& conn);
+    void ProcessPacket(const PacketInfo& packet);
+
+    // Bidirectional flows, exported over IPFIX when a collector is configured
+    bool SetFlowCollector(const std::string& collector);
+    void ExportFlows(bool force = false);
+    FlowTable::Statistics GetFlowStatistics() const;
+
 private:
     bool isMonitoring_;
     std::thread monitoringThread_;
-    int nextLogId_;
     
     mutable std::mutex connectionsMutex_;
     std::vector<NetworkConnection> connections_;
+    ConnectionCallback connectionCallback_;
+    ProcessAttribution attribution_;   // Monitoring thread only
     
     mutable std::mutex logsMutex_;
-    std::vector<NetworkLog> logs_;
+    NetworkLogStore logs_;
+    LogCallback logCallback_;
     
     mutable std::mutex statsMutex_;
     std::vector<TrafficStats> statsHistory_;
     
-    std::set<std::string> blockedIPs_;
+    mutable std::mutex threatMutex_;
+    mutable std::set<std::string> blockedIPs_;     // Pruned in GetBlockedIPs once the enforcer lets a block lapse
     std::set<std::string> suspiciousIPs_;
-    std::map<std::string, int> ipActivity_;
+    std::map<std::string, int> ipActivity_;         // Inbound attempts per source
+    // Distinct local ports each source has tried within the scan window
+    struct PortSweep {
+        std::chrono::system_clock::time_point windowStart;
+        std::vector<uint16_t> ports;                // Capped one past the scan threshold
+    };
+    std::map<std::string, PortSweep> portSweeps_;
+    std::chrono::system_clock::time_point portSweepsPruned_;
+    std::chrono::seconds scanWindow_;
+    // Immutable after construction
+    struct LocalNetwork {
+        uint8_t address[16];
+        bool isIPv6;
+        int prefixLength;
+    };
+    std::vector<LocalNetwork> localNetworks_;
+    std::set<std::string> hostAddresses_;           // This host's interface addresses
+    std::shared_ptr<const ReputationIndex> reputation_;
+    // The index UpdateThreatDatabase last mapped and the file it came from; monitoring thread only
+    std::weak_ptr<const ReputationIndex> reputationLoaded_;
+    std::string reputationPath_;
+    std::filesystem::file_time_type reputationTime_;
+    uintmax_t reputationSize_;
+    std::shared_ptr<const GeoIpDatabase> geo_;
+    std::set<std::string> watchCountries_;
+    std::set<uint32_t> watchAsns_;
+    std::set<std::string> geoAlertedIPs_;
+    
+    mutable std::mutex flowsMutex_;
+    FlowTable flows_;
+    std::unique_ptr<IpfixExporter> flowExporter_;
+    uint64_t nextFlowSweepNs_;
 
     // Monitoring implementation
     void MonitoringLoop();
     void ScanActiveConnections();
+    void AttributeConnections(std::vector<NetworkConnection>& table,
+                              const std::vector<NetworkConnection>& previous);
     void AnalyzeTraffic();
     void DetectThreats();
     
     // Windows API integration
-    void GetTcpTable();
-    void GetUdpTable();
+    void GetTcpTable(std::vector<NetworkConnection>& table);
+    void GetUdpTable(std::vector<NetworkConnection>& table);
     void GetNetworkStatistics();
     
     // Threat analysis
-    void AnalyzeConnectionPattern(const NetworkConnection& conn);
+    void AnalyzeConnectionPattern(const NetworkConnection& conn, bool inbound);
+    bool IsInbound(const std::string& localAddress, const std::string& remoteAddress) const;
+    void TrackDestinationPort(const NetworkConnection& conn);
+    void EnrichConnection(NetworkConnection& conn, const uint8_t* remoteAddr = nullptr,
+                          bool isIPv6 = false) const;
+    void ObserveConnectionFlow(const NetworkConnection& conn);
+    void SweepFlows(uint64_t nowNs, bool force);
     bool IsPortScanDetected(const std::string& ip) const;
     bool IsDDoSDetected(const std::string& ip) const;
     
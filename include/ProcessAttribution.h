@@ -0,0 +1,77 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+
+/**
+ * Incremental socket-inode to process index (Linux /proc)
+ * Each refresh re-reads fd symlinks only for processes that are new, whose
+ * fd count changed, or whose start time shows the pid was reused, so
+ * steady-state cost is one directory count and one stat read per process
+ * instead of one readlink per open descriptor
+ */
+class ProcessAttribution {
+public:
+    struct Owner {
+        int pid;
+        std::string name;   // /proc/<pid>/comm
+        std::string exe;    // /proc/<pid>/exe target
+    };
+
+    struct RefreshStats {
+        uint64_t processesSeen;
+        uint64_t processesRescanned;
+        uint64_t processesExited;
+        uint64_t linksRead;
+        double elapsedMs;
+    };
+
+    explicit ProcessAttribution(const std::string& procRoot = "/proc");
+
+    /**
+     * Incremental pass over the process table.
+     * Every fullRescanInterval refreshes all processes are re-read, which
+     * catches a descriptor swapped for another with the same fd count.
+     */
+    RefreshStats Refresh();
+
+    // Index lookup only; never touches /proc except for cached name/exe
+    bool Resolve(uint64_t inode, Owner& owner);
+
+    /**
+     * Attribute a batch of socket inodes. Refreshes at most once, and only
+     * when some inode is not yet in the index.
+     * @return number of inodes attributed
+     */
+    size_t ResolveBatch(const std::vector<uint64_t>& inodes, std::vector<Owner>& owners);
+
+    void SetFullRescanInterval(int refreshes) { fullRescanInterval_ = refreshes; }
+    size_t GetIndexedSocketCount() const { return inodeOwner_.size(); }
+    size_t GetTrackedProcessCount() const { return processes_.size(); }
+
+private:
+    struct ProcessState {
+        size_t fdCount;
+        std::vector<uint64_t> inodes;
+        std::string name;
+        std::string exe;
+        bool infoLoaded;
+        uint64_t startTime;   // Field 22 of /proc/<pid>/stat; a change means the pid was reused
+        uint64_t generation;
+    };
+
+    std::string procRoot_;
+    bool realProc_;
+    uint64_t generation_;
+    int fullRescanInterval_;
+    std::unordered_map<int, ProcessState> processes_;
+    std::unordered_map<uint64_t, int> inodeOwner_;
+
+    bool CountDescriptors(int pid, size_t& count) const;
+    uint64_t ReadStartTime(int pid) const;
+    uint64_t ReadSocketLinks(int pid, std::vector<uint64_t>& inodes) const;
+    void DropInodes(int pid, const ProcessState& state);
+    void LoadProcessInfo(int pid, ProcessState& state) const;
+};
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "Utils.h"
+#include <string>
+#include <vector>
+#include <cstdint>
+
+/**
+ * Immutable, memory-mapped IP reputation index
+ * Feeds (plain IP/CIDR lists or CSV with the address in the first column) are
+ * compiled offline into sorted, non-overlapping ranges behind a Bloom filter,
+ * so opening a multi-million entry index costs a single mmap
+ */
+class ReputationIndex {
+public:
+    struct CompileStats {
+        uint64_t linesRead;
+        uint64_t linesSkipped;     // Comments, headers and unparseable entries
+        uint64_t entriesParsed;
+        uint64_t v4Ranges;
+        uint64_t v6Ranges;
+
+        CompileStats() : linesRead(0), linesSkipped(0), entriesParsed(0), v4Ranges(0), v6Ranges(0) {}
+    };
+
+    ReputationIndex();
+    ~ReputationIndex();
+    ReputationIndex(const ReputationIndex&) = delete;
+    ReputationIndex& operator=(const ReputationIndex&) = delete;
+
+    /**
+     * Compile feed files into an index. The index is written to a temporary
+     * file and renamed into place, so readers never observe a partial file.
+     * @return true on success; error describes the failure otherwise
+     */
+    static bool Compile(const std::vector<std::string>& feedFiles, const std::string& indexFile,
+                        CompileStats* stats = nullptr, std::string* error = nullptr);
+
+    // Map a compiled index; validates the header and section bounds only
+    bool Open(const std::string& indexFile);
+    bool IsOpen() const { return file_.IsOpen(); }
+    std::string GetLastError() const { return lastError_; }
+
+    /**
+     * Look up an address. Most misses are rejected by the Bloom filter
+     * without touching the range tables.
+     * @param feed Receives the name of the feed that listed the address
+     */
+    bool Lookup(const uint8_t addr[16], bool isIPv6, std::string* feed = nullptr) const;
+    bool Contains(const std::string& ip, std::string* feed = nullptr) const;
+
+    uint64_t GetRangeCount() const { return v4Count_ + v6Count_; }
+
+private:
+    struct V4Range;
+    struct V6Range;
+
+    Utils::MappedFile file_;
+    const V4Range* v4Ranges_;
+    const V6Range* v6Ranges_;
+    const uint64_t* bloom_;
+    const char* tags_;
+    uint64_t v4Count_;
+    uint64_t v6Count_;
+    uint64_t bloomMask_;
+    uint64_t tagCount_;
+    uint32_t bloomHashes_;
+    uint64_t v4Prefixes_;
+    uint64_t v6Prefixes_[3];
+    std::string lastError_;
+
+    bool BloomMayContain(const uint8_t addr[16], int prefixLength, bool isIPv6) const;
+    std::string TagName(uint32_t tag) const;
+};
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <string>
+#include <functional>
+#include <chrono>
+#include <mutex>
+#include <map>
+#include <cstdint>
+
+/**
+ * Caps the agent's own CPU and disk impact
+ * Each protection level (1 = Low ... 4 = Maximum) maps to a CPU-time budget
+ * (percent of one core) and an I/O budget (bytes per second), both enforced
+ * with token buckets shared by every background thread. Work charges what it
+ * used; a thread that overdraws a bucket sleeps until the debt is repaid, and
+ * those deferrals are counted and reported. Only threads that entered
+ * background mode are governed, so interactive commands run at full speed.
+ */
+class ResourceGovernor {
+public:
+    struct Budget {
+        double cpuPercent;          // Of one core; 0 = unlimited
+        uint64_t ioBytesPerSecond;  // 0 = unlimited
+
+        Budget(double cpu = 0, uint64_t io = 0) : cpuPercent(cpu), ioBytesPerSecond(io) {}
+    };
+
+    struct Deferral {
+        std::string work;           // e.g. "signature scan", "file hashing"
+        std::string resource;       // "cpu" or "io"
+        uint64_t count;             // Deferrals since the previous report
+        double seconds;             // Time spent waiting since the previous report
+        int level;
+    };
+
+    struct Statistics {
+        int level;
+        uint64_t cpuNanosCharged;
+        uint64_t ioBytesCharged;
+        uint64_t deferrals;
+        double deferredSeconds;
+    };
+
+    using DeferralCallback = std::function<void(const Deferral&)>;
+
+    static ResourceGovernor& Instance();
+
+    void SetLevel(int level);
+    int GetLevel() const;
+    // Budgets come from [governor] <level>_cpu_percent / <level>_io_mb_per_second
+    static Budget GetBudgetForLevel(int level);
+    void SetBudget(const Budget& budget);   // Overrides the level budget until the next SetLevel
+    Budget GetBudget() const;
+
+    // SCHED_IDLE and idle I/O priority for the calling thread (background
+    // priority on Windows); budgets apply to it from now on. Threads it
+    // creates inherit the scheduling class, not the budget: call this in them too.
+    static bool EnterBackgroundMode();
+    static bool IsBackgroundThread();
+
+    // Both return immediately for threads outside background mode
+    void ChargeIo(uint64_t bytes, const char* work);
+    void ChargeCpu(const char* work);       // CPU used by this thread since its last charge
+
+    // Called at most once per report interval, with deferrals aggregated per work item
+    void SetDeferralCallback(DeferralCallback callback);
+    Statistics GetStatistics() const;
+
+private:
+    class TokenBucket {
+    public:
+        TokenBucket() : rate_(0), tokens_(0), last_(std::chrono::steady_clock::now()) {}
+        void SetRate(double rate);
+        // Takes the amount, going into debt if needed; returns how long to wait it off
+        std::chrono::nanoseconds Take(double amount);
+
+    private:
+        std::mutex mutex_;
+        double rate_;               // Units per second, 0 = unlimited
+        double tokens_;
+        std::chrono::steady_clock::time_point last_;
+    };
+
+    mutable std::mutex mutex_;
+    int level_;
+    Budget budget_;
+    TokenBucket cpu_;
+    TokenBucket io_;
+    Statistics stats_;
+    DeferralCallback callback_;
+    std::chrono::steady_clock::time_point lastReport_;
+    std::map<std::pair<std::string, std::string>, Deferral> pending_;   // By (work, resource)
+
+    ResourceGovernor();
+    void Wait(std::chrono::nanoseconds delay, const char* work, const char* resource);
+};
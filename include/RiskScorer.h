@@ -0,0 +1,110 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <chrono>
+#include <mutex>
+#include <cstdint>
+
+struct CorrelationEvent;
+
+/**
+ * Incremental per-entity risk scores
+ * Every event adds weight(type) * weight(severity) to the host, IP, process
+ * and user it names, and scores decay exponentially with a configurable half
+ * life. Scores are kept pre-scaled by exp(lambda * t), so decay never changes
+ * their order: an update is one hash probe plus a sift-up in an indexed
+ * max-heap, and the N riskiest entities come off the top of that heap without
+ * looking at the rest. Time is taken from the events, as in CorrelationEngine.
+ */
+class RiskScorer {
+public:
+    enum class EntityKind : uint8_t {
+        Host,
+        Ip,
+        Process,
+        User
+    };
+
+    struct Entity {
+        EntityKind kind;
+        std::string id;
+        double score;              // Decayed to the time of the query
+        uint64_t events;
+        std::chrono::system_clock::time_point lastSeen;
+    };
+
+    struct Options {
+        double halfLifeSeconds;
+        size_t maxEntities;        // Past this, a low scorer among a few sampled entities is evicted
+        std::string host;          // Entity credited with local events; the host name when empty
+
+        Options() : halfLifeSeconds(900), maxEntities(65536) {}
+    };
+
+    struct Statistics {
+        uint64_t events;
+        uint64_t evicted;
+        size_t entities;
+        size_t memoryBytes;
+    };
+
+    explicit RiskScorer(const Options& options = Options());
+
+    // Unlisted types weigh 1; severity 1 (informational) weighs nothing
+    void SetTypeWeight(const std::string& type, double weight);
+    static double SeverityWeight(int severity);
+
+    void Observe(const CorrelationEvent& event);
+    void Add(EntityKind kind, const std::string& id, double weight, std::chrono::system_clock::time_point when);
+
+    double GetScore(EntityKind kind, const std::string& id,
+                    std::chrono::system_clock::time_point now = std::chrono::system_clock::now()) const;
+    std::vector<Entity> GetTop(size_t count,
+                               std::chrono::system_clock::time_point now = std::chrono::system_clock::now()) const;
+    // 1-5 from the host's score, for callers that still want a single level
+    int GetHostLevel(std::chrono::system_clock::time_point now = std::chrono::system_clock::now()) const;
+    const std::string& GetHost() const { return options_.host; }
+
+    void Clear();
+    Statistics GetStatistics() const;
+
+    static const char* KindName(EntityKind kind);
+
+private:
+    struct Node {
+        std::string key;           // Kind byte followed by the id
+        double scaled;             // score * exp(lambda * (lastSeen - base_))
+        uint32_t hash;
+        uint32_t heapIndex;
+        uint64_t events;
+        std::chrono::system_clock::time_point lastSeen;
+    };
+
+    Options options_;
+    double lambda_;                // Decay per second
+    mutable std::mutex mutex_;
+    std::vector<Node> nodes_;
+    std::vector<uint32_t> slots_;  // Open addressing, linear probing: node index + 1, 0 = empty
+    std::vector<uint32_t> heap_;   // Node indices, max-heap on scaled
+    std::unordered_map<std::string, double> typeWeights_;
+    std::chrono::system_clock::time_point base_;
+    bool hasBase_;
+    uint64_t events_;
+    uint64_t evicted_;
+    uint64_t sampleState_;
+
+    void Credit(EntityKind kind, const std::string& id, double weight, std::chrono::system_clock::time_point when);
+    double Scale(std::chrono::system_clock::time_point when);
+    double Decay(std::chrono::system_clock::time_point now) const;
+    size_t FindSlot(const std::string& key, uint32_t hash) const;
+    void Grow();
+    void Evict();
+    void RemoveSlot(size_t slot);
+    void SiftUp(size_t index);
+    void SiftDown(size_t index);
+    void SwapHeap(size_t a, size_t b);
+    static std::string MakeKey(EntityKind kind, const std::string& id);
+    static uint32_t Hash(const std::string& key);
+};
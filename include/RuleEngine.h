@@ -0,0 +1,122 @@
+#pragma once
+
+#include "SecurityMonitor.h"
+#include "NetworkMonitor.h"
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <chrono>
+#include <cstdint>
+
+/**
+ * Declarative detection rules over SecurityEvent and NetworkLog streams
+ *
+ * Rules are JSON:
+ *   {"rules": [{
+ *       "id": "ssh-bruteforce", "type": "Brute Force", "severity": 4,
+ *       "description": "Repeated SSH failures",
+ *       "match": {"all": [{"field": "stream", "eq": "network"},
+ *                         {"field": "protocol", "in": ["TCP", "SSH"]},
+ *                         {"not": {"field": "source", "cidr": "10.0.0.0/8"}}]},
+ *       "threshold": {"count": 5, "window_seconds": 60, "group_by": "source"}}]}
+ *
+ * Operators: eq, ne, in, contains, prefix, suffix, cidr, gt, ge, lt, le;
+ * combinators: all, any, not. Identical predicates are shared across rules
+ * and evaluated at most once per event; eq/in predicates are answered by one
+ * hash lookup per field and also select which rules need running at all.
+ * Each rule is a short jump-threaded program over the predicate results.
+ * A reload compiles a new rule set and swaps it in atomically, so events in
+ * flight finish on the old set and threshold windows carry over by rule id.
+ */
+class RuleEngine {
+public:
+    enum StringField : uint8_t {
+        Stream,          // "security" or "network"
+        Type,
+        Source,
+        Destination,
+        Protocol,
+        Description,     // SecurityEvent description / NetworkLog threat
+        Status,
+        Country,
+        StringFieldCount
+    };
+
+    enum NumericField : uint8_t {
+        Severity,
+        Asn,
+        NumericFieldCount
+    };
+
+    // Views into the caller's event; valid for the duration of Evaluate()
+    struct Event {
+        std::chrono::system_clock::time_point timestamp;
+        std::string_view strings[StringFieldCount];
+        int64_t numbers[NumericFieldCount];
+
+        Event() : numbers{0, 0} {}
+    };
+
+    struct Match {
+        std::string ruleId;
+        std::string type;
+        std::string source;
+        std::string description;
+        int severity;
+        uint32_t count;            // Events counted in the window (1 without a threshold)
+        std::chrono::system_clock::time_point timestamp;
+    };
+
+    struct Statistics {
+        uint64_t events;
+        uint64_t rulesEvaluated;     // Candidate rules actually run
+        uint64_t predicateEvaluations;
+        uint64_t matches;
+        uint64_t reloads;
+        size_t rules;
+        size_t predicates;
+    };
+
+    RuleEngine();
+    ~RuleEngine();
+    RuleEngine(const RuleEngine&) = delete;
+    RuleEngine& operator=(const RuleEngine&) = delete;
+
+    static Event FromSecurityEvent(const SecurityMonitor::SecurityEvent& event);
+    static Event FromNetworkLog(const NetworkMonitor::NetworkLog& log);
+
+    // On failure the current rule set stays active and GetLastError() explains why
+    bool LoadRules(const std::string& file);
+    bool LoadRulesFromString(const std::string& json);
+    // Reload the last file loaded if its modification time changed; error is
+    // set only when a changed file failed to compile
+    bool ReloadIfChanged(std::string* error = nullptr);
+
+    // Appends any matches; safe to call from several threads at once
+    void Evaluate(const Event& event, std::vector<Match>& matches);
+
+    size_t GetRuleCount() const;
+    Statistics GetStatistics() const;
+    std::string GetLastError() const;
+
+private:
+    struct RuleSet;
+    struct WindowState;
+
+    std::shared_ptr<const RuleSet> rules_;
+    mutable std::mutex loadMutex_;     // Serialises loads; never taken by Evaluate
+    std::string rulesFile_;
+    int64_t rulesFileTime_;
+    std::string lastError_;
+
+    std::atomic<uint64_t> events_;
+    std::atomic<uint64_t> rulesEvaluated_;
+    std::atomic<uint64_t> predicateEvaluations_;
+    std::atomic<uint64_t> matches_;
+    std::atomic<uint64_t> reloads_;
+
+    bool Compile(const std::string& json, std::shared_ptr<RuleSet>& result, std::string& error) const;
+};
@@ -10,6 +10,9 @@
 class ViewManager;
 class GeminiClient;
 class SecurityMonitor;
+class NetworkMonitor;
+class ThreatProtection;
+class IntegrityWatcher;
 
 /**
  * Main security application class for Windows 11 & Linux Security Sentinel
@@ -32,11 +35,15 @@ public:
     // Getters for components
     GeminiClient* GetGeminiClient() const { return geminiClient_.get(); }
     SecurityMonitor* GetSecurityMonitor() const { return securityMonitor_.get(); }
+    ThreatProtection* GetThreatProtection() const { return threatProtection_.get(); }
 
 private:
     std::unique_ptr<ViewManager> viewManager_;
     std::unique_ptr<GeminiClient> geminiClient_;
     std::unique_ptr<SecurityMonitor> securityMonitor_;
+    std::unique_ptr<NetworkMonitor> networkMonitor_;     // Feeds new connections to correlation
+    std::unique_ptr<ThreatProtection> threatProtection_;
+    std::unique_ptr<IntegrityWatcher> integrityWatcher_;
     
     bool isRunning_;
     std::string statusMessage_;
@@ -8,6 +8,8 @@
 #include <thread>
 #include <atomic>
 #include <mutex>
+#include <unordered_set>
+#include "RiskScorer.h"
 
 /**
  * Core security monitoring system
@@ -50,9 +52,12 @@ public:
     SystemMetrics GetCurrentMetrics() const;
     std::vector<SystemMetrics> GetMetricsHistory(int minutes = 60) const;
 
-    // Threat analysis
+    // Threat analysis: every event updates decayed risk scores for the host and
+    // the IPs, processes and users it names; the level follows the host's score
     int GetThreatLevel() const; // 1-5 scale
     std::string GetThreatSummary() const;
+    std::vector<RiskScorer::Entity> GetRiskiestEntities(size_t count = 10) const;
+    RiskScorer& GetRiskScorer() { return risk_; }
 
 private:
     std::atomic<bool> isMonitoring_;
@@ -65,6 +70,12 @@ private:
     mutable std::mutex metricsMutex_;
     std::vector<SystemMetrics> metricsHistory_;
 
+    RiskScorer risk_;
+
+    // Pids seen by the last process scan (monitoring thread only)
+    std::unordered_set<int> knownPids_;
+    bool processesScanned_;
+
     // Monitoring methods
     void MonitoringLoop();
     void CheckProcesses();
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * Streaming SHA-256 (FIPS 180-4)
+ * The compression function is picked at runtime: SHA-NI where the CPU has the
+ * SHA extensions, otherwise portable code. AVX2 cannot speed up a single
+ * stream, so it is used to hash eight independent messages at once in
+ * HashMany, which is how batches of small files are hashed.
+ */
+class Sha256 {
+public:
+    static const size_t DigestSize = 32;
+    static const size_t BlockSize = 64;
+
+    enum class Implementation {
+        Portable,
+        Avx2,       // Eight-lane multi-buffer; single streams use portable code
+        ShaNi
+    };
+
+    Sha256();
+
+    void Reset();
+    void Update(const void* data, size_t size);
+    void Final(uint8_t digest[DigestSize]);
+    std::string HexDigest();                 // Final(), as lowercase hex
+
+    static std::string Hash(const void* data, size_t size);
+    static std::string ToHex(const uint8_t digest[DigestSize]);
+
+    // Hashes count independent messages, eight at a time where AVX2 is available
+    static void HashMany(const uint8_t* const* data, const size_t* sizes, size_t count, uint8_t (*digests)[DigestSize]);
+
+    static bool IsSupported(Implementation implementation);
+    static Implementation GetImplementation();
+    // For benchmarks and tests; returns false if the CPU lacks it
+    static bool SetImplementation(Implementation implementation);
+    static const char* GetImplementationName(Implementation implementation);
+
+private:
+    uint32_t state_[8];
+    uint8_t buffer_[BlockSize];
+    size_t buffered_;
+    uint64_t length_;
+};
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "IocMatcher.h"
+#include "JsonReporting.h"
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <cstdint>
+
+/**
+ * File content scanner for YARA-style signature rules
+ * Supported subset: text strings (nocase, ascii, wide, fullword), hex strings
+ * with ?? / nibble wildcards and bounded [n-m] jumps, and conditions built from
+ * and/or/not, $a, #a, @a[i], "at", "in", "N of (...)", filesize, uintXX(offset)
+ * and references to earlier rules. Every string contributes its most specific
+ * fixed bytes as an atom to one Aho-Corasick automaton; atom hits are verified
+ * against the full string. Jumps are walked under a step budget per hit and
+ * per byte scanned; candidates past it count as no match. Files are
+ * memory-mapped and scanned on all cores.
+ */
+class SignatureScanner {
+public:
+    struct StringMatch {
+        std::string identifier;
+        uint64_t offset;
+        uint32_t length;
+    };
+
+    struct RuleMatch {
+        std::string rule;
+        std::vector<std::string> tags;
+        std::vector<std::pair<std::string, std::string>> meta;
+        std::vector<StringMatch> strings;   // First few occurrences of each matched string
+    };
+
+    struct Options {
+        uint64_t maxFileSize;    // Larger files are skipped, not truncated
+        unsigned threads;        // 0 = one per hardware thread
+
+        Options() : maxFileSize(64ULL * 1024 * 1024), threads(0) {}
+    };
+
+    struct Statistics {
+        uint64_t filesScanned;
+        uint64_t filesSkipped;   // Over the size cap
+        uint64_t filesFailed;    // Unreadable or vanished during the scan
+        uint64_t bytesScanned;
+        uint64_t ruleMatches;
+        double elapsedSeconds;
+        double megabytesPerSecond;
+    };
+
+    enum class FileStatus {
+        Scanned,
+        TooLarge,
+        Failed
+    };
+
+    explicit SignatureScanner(const Options& options = Options());
+    ~SignatureScanner();
+
+    // Compile a rule file; the previous rule set stays active on failure
+    bool LoadRules(const std::string& file);
+    bool LoadRulesFromString(const std::string& source);
+
+    void ScanBuffer(std::string_view data, std::vector<RuleMatch>& matches) const;
+    FileStatus ScanFile(const std::string& path, std::vector<RuleMatch>& matches, uint64_t* size = nullptr) const;
+
+    // Walks directories recursively (symlinks are not followed) and returns one
+    // FAIL result per rule match plus a SIGNATURE_SCAN summary with throughput
+    std::vector<JsonReporting::CheckResult> ScanPaths(const std::vector<std::string>& paths,
+                                                      Statistics* statistics = nullptr) const;
+
+    size_t GetRuleCount() const;
+    size_t GetStringCount() const;
+    std::string GetLastError() const { return lastError_; }
+
+    // checks.directory_analysis.scan_directories, with %VAR%, $VAR and ~ expanded
+    static std::vector<std::string> GetConfiguredDirectories();
+
+private:
+    struct Compiled;
+
+    Options options_;
+    std::string lastError_;
+    std::shared_ptr<const Compiled> compiled_;
+};
@@ -1,12 +1,24 @@
 #pragma once
 
+#include "RuleEngine.h"
+#include "JsonReporting.h"
 #include <string>
 #include <vector>
 #include <memory>
 #include <chrono>
 #include <set>
+#include <list>
+#include <unordered_map>
+#include <mutex>
+#include <atomic>
+#include <thread>
 
 class SecurityApp;
+class ThreatStore;
+class IocMatcher;
+class SignatureScanner;
+class CorrelationEngine;
+struct CorrelationEvent;
 
 /**
  * Threat Protection component for active security measures
@@ -22,6 +34,11 @@ public:
         int severity; // 1-5 scale
         std::chrono::system_clock::time_point detected;
         bool mitigated;
+        std::vector<std::string> evidence;   // Contributing events of a correlated threat, oldest first
+        std::chrono::system_clock::time_point lastSeen;   // Latest repeat; detected until the first one
+        uint32_t occurrences;                             // Detections folded into this threat
+
+        ThreatInfo() : severity(1), mitigated(false), occurrences(1) {}
     };
 
     enum class ProtectionLevel {
@@ -42,7 +59,9 @@ public:
 
     // Threat management
     std::vector<ThreatInfo> GetActiveThreats() const;
-    std::vector<ThreatInfo> GetThreatHistory(int limit = 100) const;
+    std::vector<ThreatInfo> GetThreatHistory(int limit = 100) const;   // Newest first
+    std::vector<ThreatInfo> GetThreatsBySource(const std::string& source) const;
+    std::vector<ThreatInfo> GetThreatsByType(const std::string& type) const;
     bool MitigateThreat(const std::string& threatId);
     
     // Protection settings
@@ -54,18 +73,71 @@ public:
     void UnblockIP(const std::string& ip);
     std::vector<std::string> GetBlockedIPs() const;
     
+    // Detection rules: events are evaluated against the compiled rule set and
+    // matches become active threats. The rule file is re-read when it changes.
+    bool LoadDetectionRules(const std::string& file);
+    void InspectEvent(const RuleEngine::Event& event);
+    RuleEngine& GetRuleEngine() { return rules_; }
+    
+    // Indicators of compromise (tool names, paths, domains), one per line. Event
+    // text and, on Linux, process command lines are matched against all of them.
+    bool LoadIndicators(const std::string& file);
+    void SetIndicators(std::shared_ptr<const IocMatcher> matcher);
+    
+    // File content signatures (YARA subset). The protection thread sweeps the
+    // configured scan directories every [scan] interval_seconds.
+    bool LoadSignatures(const std::string& file);
+    std::vector<JsonReporting::CheckResult> ScanFiles(const std::vector<std::string>& paths);
+    SignatureScanner& GetSignatureScanner() { return *signatures_; }
+    
+    // Cross-source correlation: events from the monitors and file watchers are
+    // joined per pid, IP or user, and completed sequences become threats
+    void CorrelateEvent(const CorrelationEvent& event);
+    CorrelationEngine& GetCorrelationEngine() { return *correlation_; }
+    
     // Status
     bool IsProtectionActive() const;
     int GetThreatCount() const;
 
 private:
-    bool protectionActive_;
-    ProtectionLevel protectionLevel_;
-    std::vector<ThreatInfo> activeThreats_;
-    std::vector<ThreatInfo> threatHistory_;
-    std::set<std::string> blockedIPs_;
+    std::atomic<bool> protectionActive_;
+    std::atomic<ProtectionLevel> protectionLevel_;
+    std::unique_ptr<ThreatStore> threats_;
+    RuleEngine rules_;
+    std::atomic<int64_t> nextRuleCheck_;
+    std::thread protectionThread_;
+    
+    std::shared_ptr<const IocMatcher> indicators_;
+    mutable std::mutex indicatorsMutex_;     // Guards the file bookkeeping, not lookups
+    std::string indicatorsFile_;
+    int64_t indicatorsFileTime_;
+    std::set<std::pair<int, uint32_t>> reportedProcessIndicators_;   // Scan thread only
+    // "source\nindicator" -> threat id, least recently seen first; the oldest is forgotten at the cap
+    struct IndicatorThreat {
+        std::string id;
+        std::list<std::string>::iterator recent;
+    };
+    std::mutex indicatorThreatsMutex_;
+    std::unordered_map<std::string, IndicatorThreat> indicatorThreats_;
+    std::list<std::string> indicatorRecency_;
+    
+    std::unique_ptr<SignatureScanner> signatures_;
+    mutable std::mutex signaturesMutex_;     // Guards the file bookkeeping
+    std::string signaturesFile_;
+    int64_t signaturesFileTime_;
+    std::set<std::string> reportedSignatureMatches_;   // Scan thread only
+    
+    std::unique_ptr<CorrelationEngine> correlation_;
+    
+    mutable std::mutex blockedMutex_;
+    mutable std::set<std::string> blockedIPs_;     // Lapsed blocks are erased on read
     
+    void ProtectionLoop();
     void ScanForThreats();
+    void ScanProcessCommandLines(const IocMatcher& matcher);
+    void ReloadDetectionContent();
+    void SweepSignatureDirectories();
+    void ReportIndicators(const IocMatcher& matcher, std::string_view text, const std::string& source,
+                          const std::string& context, std::chrono::system_clock::time_point detected);
     void ProcessThreat(const ThreatInfo& threat);
-    std::string GenerateThreatId();
 };
\ No newline at end of file
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "ThreatProtection.h"
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <shared_mutex>
+#include <cstdint>
+
+/**
+ * Concurrent store for active and mitigated threats
+ * Active threats live in a slot table indexed by id, source and type; every
+ * index removal is a swap-and-pop, so mitigation is O(1). Mitigated threats
+ * move into a fixed-capacity ring that is read newest first. Readers share a
+ * lock; detection and mitigation take it exclusively only for the update.
+ */
+class ThreatStore {
+public:
+    using ThreatInfo = ThreatProtection::ThreatInfo;
+
+    explicit ThreatStore(size_t historyCapacity = 10000);
+
+    /**
+     * Unique, time-sortable id: "THREAT_" followed by 16 hex digits holding
+     * milliseconds since the epoch and a 20-bit sequence. Ids generated in
+     * one process are strictly increasing, so they sort in detection order.
+     */
+    static std::string GenerateId();
+
+    // Assigns an id when threat.id is empty; returns "" if the id is already active
+    std::string Add(ThreatInfo threat);
+    bool Mitigate(const std::string& id);
+    // Folds a repeat detection into an active threat; false once it is mitigated
+    bool Refresh(const std::string& id, std::chrono::system_clock::time_point seen);
+    bool Get(const std::string& id, ThreatInfo& threat) const;
+    bool IsActive(const std::string& id) const;
+
+    // Active threats oldest first
+    std::vector<ThreatInfo> GetActive() const;
+    std::vector<ThreatInfo> FindBySource(const std::string& source) const;
+    std::vector<ThreatInfo> FindByType(const std::string& type) const;
+
+    // Mitigated threats, newest first
+    std::vector<ThreatInfo> GetHistory(size_t limit) const;
+
+    size_t ActiveCount() const;
+    size_t HistoryCount() const;
+    void Clear();
+
+private:
+    struct Slot {
+        ThreatInfo threat;
+        uint32_t sourcePosition;     // Index within bySource_[threat.source]
+        uint32_t typePosition;
+        bool used;
+    };
+
+    using Index = std::unordered_map<std::string, std::vector<uint32_t>>;
+
+    mutable std::shared_mutex mutex_;
+    std::vector<Slot> slots_;
+    std::vector<uint32_t> freeSlots_;
+    std::unordered_map<std::string, uint32_t> byId_;
+    Index bySource_;
+    Index byType_;
+
+    std::vector<ThreatInfo> history_;   // Ring of historyCapacity_ entries
+    size_t historyCapacity_;
+    size_t historyNext_;
+    size_t historyCount_;
+
+    static uint32_t Append(Index& index, const std::string& key, uint32_t slot);
+    void Remove(Index& index, const std::string& key, uint32_t position, bool isSource);
+    std::vector<ThreatInfo> Collect(const Index& index, const std::string& key) const;
+};
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "GlobMatcher.h"
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstdint>
+
+class WorkStealingPool;
+
+/**
+ * Parallel directory tree walker collecting regular files
+ * On Linux each directory is opened with openat() relative to its parent's
+ * descriptor and read with getdents64, so no path is resolved twice and
+ * d_type avoids a stat per entry. Every subtree below the first levels is
+ * walked depth-first from a stack of directory descriptors; the first levels
+ * become separate tasks on a work-stealing pool so subtrees run in parallel.
+ * Symlinks are never followed and excluded directories are not entered.
+ */
+class TreeWalker {
+public:
+    struct Options {
+        bool oneFileSystem;        // Skip directories on another device than their root
+        unsigned threads;          // 0 = one per hardware thread
+
+        Options() : oneFileSystem(true), threads(0) {}
+    };
+
+    struct Statistics {
+        uint64_t files;
+        uint64_t directories;
+        uint64_t excluded;         // Files and directories matched by an exclude glob
+        uint64_t mountsSkipped;    // Directories left because they are on another filesystem
+        uint64_t errors;           // Missing roots and unreadable directories
+        double elapsedSeconds;
+
+        Statistics() : files(0), directories(0), excluded(0), mountsSkipped(0), errors(0), elapsedSeconds(0) {}
+        double FilesPerSecond() const { return elapsedSeconds > 0 ? files / elapsedSeconds : 0.0; }
+    };
+
+    explicit TreeWalker(const Options& options = Options());
+
+    // Globs are matched against paths relative to the root being walked
+    void SetExcludes(const GlobMatcher& excludes) { excludes_ = excludes; }
+
+    /**
+     * Collect the regular files under each root, sorted
+     * A root that is itself a file is returned as given.
+     */
+    std::vector<std::string> Walk(const std::vector<std::string>& roots, Statistics* statistics = nullptr) const;
+
+private:
+    struct Directory;
+    struct State;
+
+    Options options_;
+    GlobMatcher excludes_;
+
+    void WalkSubtree(State& state, Directory start) const;
+};
@@ -0,0 +1,93 @@
+#pragma once
+
+#include "FingerprintCache.h"
+#include <string>
+#include <vector>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include <cstdint>
+
+/**
+ * Small-file reader on io_uring
+ * For trees of small files an integrity pass is dominated by syscalls, not
+ * hashing: statx, open, read, close and a second statx per file. Here each
+ * of those is an io_uring request, hundreds of files are in flight at once,
+ * and a single io_uring_enter submits and reaps a whole batch. Contents land
+ * in buffers registered with the kernel once per reader and recycled through
+ * Release, so hashing workers can keep a buffer while the ring reuses the
+ * others. Built on the raw syscalls; Initialize fails cleanly on kernels
+ * without io_uring or the needed opcodes, and callers keep their read() path.
+ */
+class UringFileReader {
+public:
+    struct Options {
+        unsigned queueDepth;       // Files in flight
+        unsigned buffers;          // Registered buffers; more than queueDepth so hashing can hold some
+        size_t bufferSize;         // Largest file read
+        bool birthTime;            // Request birth times in the fingerprints
+
+        Options() : queueDepth(128), buffers(256), bufferSize(64 * 1024), birthTime(true) {}
+    };
+
+    struct Completion {
+        size_t index;
+        bool read;                                 // StatCallback accepted the file
+        int error;                                 // errno of the failed request; EFBIG if the file outgrew its buffer,
+                                                   // ECANCELED if the ring failed before the file was done
+        FingerprintCache::Fingerprint before;      // Valid when read is true
+        FingerprintCache::Fingerprint after;       // Taken after the read; equal to before if the file did not change
+        const uint8_t* data;                       // Null on error
+        size_t length;
+        uint32_t buffer;                           // Hand back with Release when data is no longer needed
+    };
+
+    // Called after the first statx; false skips the file without a Completion
+    using StatCallback = std::function<bool(size_t index, const FingerprintCache::Fingerprint& fingerprint)>;
+    using CompletionCallback = std::function<void(const Completion& completion)>;
+
+    explicit UringFileReader(const Options& options = Options());
+    ~UringFileReader();
+    UringFileReader(const UringFileReader&) = delete;
+    UringFileReader& operator=(const UringFileReader&) = delete;
+
+    // Sets up the ring and registers the buffers; false if io_uring is unusable here
+    bool Initialize();
+    bool IsInitialized() const { return ringFd_ >= 0; }
+    std::string GetLastError() const { return lastError_; }
+    const Options& GetOptions() const { return options_; }
+
+    /**
+     * Stat and read files [0, count) on the calling thread
+     * Paths must stay valid until Run returns. Callbacks run on the calling
+     * thread; onPoll, if given, after each batch of completions.
+     * @return Files started; less than count only if the ring failed, and the rest are left to the caller
+     */
+    size_t Run(size_t count, const std::function<const char*(size_t)>& pathOf, const StatCallback& onStat,
+               const CompletionCallback& onComplete, const std::function<void()>& onPoll = nullptr);
+
+    // Returns a Completion's buffer; any thread
+    void Release(uint32_t buffer);
+
+private:
+    struct Slot;
+    struct Ring;
+
+    Options options_;
+    std::string lastError_;
+    int ringFd_;
+    Ring* ring_;
+    uint8_t* memory_;
+    size_t memorySize_;
+
+    std::mutex buffersMutex_;
+    std::condition_variable buffersFree_;
+    std::vector<uint32_t> freeBuffers_;
+    unsigned outstanding_;                 // Buffers acquired and not yet released
+
+    bool AcquireBuffer(uint32_t& buffer, bool wait);
+    // Tears down the ring only; buffers stay valid for completions already delivered
+    void CloseRing();
+    // Also unmaps the buffers, once every one has been released
+    void Cleanup();
+};
@@ -5,6 +5,8 @@
 #include <chrono>
 #include <set>
 #include <map>
+#include <cstdint>
+#include <cstddef>
 
 /**
  * Utility functions for the Security Sentinel application
@@ -31,6 +33,11 @@ namespace Utils {
     std::string GetHostname(const std::string& ip);
     std::string GetLocalIP();
 
+    // Binary address helpers. Addresses are stored as 16 bytes; IPv4 uses the
+    // first four bytes and leaves the rest zeroed.
+    bool ParseIP(const std::string& ip, uint8_t out[16], bool& isIPv6);
+    std::string FormatIP(const uint8_t addr[16], bool isIPv6);
+
     // File utilities
     bool FileExists(const std::string& filename);
     std::string ReadFile(const std::string& filename);
@@ -38,6 +45,33 @@ namespace Utils {
     std::string GetExecutableDirectory();
     std::string GetConfigDirectory();
 
+    /**
+     * Read-only memory mapping of a whole file.
+     * Falls back to reading the file into memory where mmap is unavailable.
+     */
+    class MappedFile {
+    public:
+        MappedFile();
+        ~MappedFile();
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+        MappedFile(MappedFile&& other) noexcept;
+        MappedFile& operator=(MappedFile&& other) noexcept;
+
+        bool Open(const std::string& filename);
+        void Close();
+        bool IsOpen() const { return opened_; }
+
+        const uint8_t* Data() const { return data_; }
+        size_t Size() const { return size_; }
+
+    private:
+        const uint8_t* data_;
+        size_t size_;
+        bool opened_;
+        std::vector<uint8_t> fallback_;
+    };
+
     // JSON utilities
     std::string EscapeJson(const std::string& str);
     std::string CreateJsonString(const std::map<std::string, std::string>& data);
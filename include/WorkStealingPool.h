@@ -0,0 +1,60 @@
+#pragma once
+
+#include <functional>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <memory>
+
+/**
+ * Fixed-size thread pool with per-worker task deques
+ * A worker runs its own newest task first and, when its deque is empty,
+ * steals the oldest task of another worker, so tasks that fan out (a batch
+ * that discovers a large file, a chunk that queues the next chunk) stay on
+ * the worker that created them while idle workers balance the load.
+ * Workers of a pool created on a governed background thread are governed too.
+ */
+class WorkStealingPool {
+public:
+    using Task = std::function<void()>;
+
+    // 0 threads = one per hardware thread
+    explicit WorkStealingPool(unsigned threads = 0);
+    ~WorkStealingPool();
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    // From a worker the task goes to that worker's deque, otherwise round-robin
+    void Submit(Task task);
+    // Blocks until every submitted task, including tasks they submitted, has run
+    void Wait();
+    bool WaitFor(std::chrono::milliseconds timeout);
+
+    unsigned GetThreadCount() const { return static_cast<unsigned>(workers_.size()); }
+    uint64_t GetStealCount() const { return steals_.load(); }
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    std::vector<std::unique_ptr<Queue>> queues_;
+    std::vector<std::thread> workers_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable idle_;
+    std::atomic<size_t> pending_;      // Submitted but not finished
+    std::atomic<size_t> queued_;       // Submitted but not started
+    std::atomic<unsigned> nextQueue_;
+    std::atomic<uint64_t> steals_;
+    bool stopping_;
+
+    void WorkerLoop(unsigned index, bool background);
+    bool TakeTask(unsigned index, Task& task);
+};
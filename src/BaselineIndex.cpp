@@ -0,0 +1,459 @@
+#include "BaselineIndex.h"
+#include "Blake3.h"
+#include "MerkleTree.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+namespace {
+    constexpr char INDEX_MAGIC[8] = {'S', 'S', 'B', 'A', 'S', 'E', 'L', 'N'};
+    constexpr uint32_t INDEX_VERSION = 2;     // Version 1 files are still written when they have no BLAKE3 entries
+
+    enum HashKind : uint8_t {
+        HASH_SHA256 = 0,           // Digest holds the hash
+        HASH_MERKLE = 1,           // Digest holds the root, the blob the serialized tree
+        HASH_TEXT = 2,             // Blob holds the hash text as given
+        HASH_BLAKE3 = 3            // Digest holds the hash; version 2
+    };
+
+    constexpr uint8_t FLAG_METADATA = 1;
+
+    struct IndexHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t headerSize;
+        uint64_t fileSize;
+        uint64_t count;
+        uint64_t recordOffset;
+        uint64_t restartCount;
+        uint64_t restartOffset;
+        uint64_t poolOffset;
+        uint64_t poolSize;
+        uint64_t blobOffset;
+        uint64_t blobSize;
+        uint32_t blockSize;
+        uint32_t generation;       // 0 in files written before generations were numbered
+        int64_t createdNs;
+        uint64_t checksum;         // FNV-1a of this header with checksum = 0
+    };
+
+    uint64_t Fnv1a(const void* data, size_t length) {
+        const uint8_t* bytes = static_cast<const uint8_t*>(data);
+        uint64_t hash = 0xcbf29ce484222325ULL;
+        for (size_t i = 0; i < length; ++i) {
+            hash ^= bytes[i];
+            hash *= 0x100000001b3ULL;
+        }
+        return hash;
+    }
+
+    uint64_t HeaderChecksum(const IndexHeader& header) {
+        IndexHeader copy = header;
+        copy.checksum = 0;
+        return Fnv1a(&copy, sizeof(copy));
+    }
+
+    inline uint64_t Align8(uint64_t value) {
+        return (value + 7) & ~static_cast<uint64_t>(7);
+    }
+
+    void PutVarint(std::string& out, uint64_t value) {
+        while (value >= 0x80) {
+            out.push_back(static_cast<char>((value & 0x7F) | 0x80));
+            value >>= 7;
+        }
+        out.push_back(static_cast<char>(value));
+    }
+
+    bool GetVarint(const uint8_t* data, uint64_t size, uint64_t& offset, uint64_t& value) {
+        value = 0;
+        for (int shift = 0; shift < 64 && offset < size; shift += 7) {
+            uint8_t byte = data[offset++];
+            value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool ParseHexDigest(const std::string& hex, uint8_t digest[32]) {
+        if (hex.size() != 64) {
+            return false;
+        }
+        for (size_t i = 0; i < 64; ++i) {
+            char c = hex[i];
+            int value = c >= '0' && c <= '9' ? c - '0' : c >= 'a' && c <= 'f' ? c - 'a' + 10 : -1;
+            if (value < 0) {
+                return false;   // Upper case would not round-trip, so it stays text
+            }
+            digest[i / 2] = static_cast<uint8_t>(i % 2 ? digest[i / 2] | value : value << 4);
+        }
+        return true;
+    }
+}
+
+struct BaselineIndex::Record {
+    uint8_t digest[32];
+    uint64_t size;
+    int64_t mtimeNs;
+    uint64_t blobOffset;
+    uint32_t blobLength;
+    uint8_t kind;
+    uint8_t flags;
+    uint16_t mode;
+};
+
+BaselineIndex::BaselineIndex()
+    : records_(nullptr), restarts_(nullptr), pool_(nullptr), blob_(nullptr),
+      count_(0), restartCount_(0), poolSize_(0), blobSize_(0), generation_(0), createdNs_(0) {
+}
+
+bool BaselineIndex::Compile(std::vector<Entry> entries, const std::string& indexFile,
+                            CompileStats* stats, std::string* error, uint32_t generation) {
+    CompileStats localStats = stats ? *stats : CompileStats();
+
+    // Sort by path; of several entries for one path the last one wins
+    std::stable_sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.path < b.path; });
+    std::vector<Entry> unique;
+    unique.reserve(entries.size());
+    for (auto& entry : entries) {
+        if (!unique.empty() && unique.back().path == entry.path) {
+            unique.back() = std::move(entry);
+            localStats.duplicates++;
+        } else {
+            unique.push_back(std::move(entry));
+        }
+    }
+    entries.clear();
+
+    std::vector<Record> records(unique.size());
+    std::vector<uint64_t> restarts;
+    std::string pool;
+    std::string blob;
+    bool blake3 = false;
+    for (size_t i = 0; i < unique.size(); ++i) {
+        const Entry& entry = unique[i];
+        size_t shared = 0;
+        if (i % BlockSize == 0) {
+            restarts.push_back(pool.size());
+        } else {
+            const std::string& previous = unique[i - 1].path;
+            size_t limit = std::min(previous.size(), entry.path.size());
+            while (shared < limit && previous[shared] == entry.path[shared]) {
+                ++shared;
+            }
+        }
+        PutVarint(pool, shared);
+        PutVarint(pool, entry.path.size() - shared);
+        pool.append(entry.path, shared, std::string::npos);
+        localStats.pathBytes += entry.path.size();
+
+        Record& record = records[i];
+        std::memset(&record, 0, sizeof(record));
+        MerkleTree tree;
+        if (ParseHexDigest(entry.hash, record.digest)) {
+            record.kind = HASH_SHA256;
+        } else if (Blake3::ParseId(entry.hash, record.digest)) {
+            record.kind = HASH_BLAKE3;
+            blake3 = true;
+        } else {
+            record.kind = MerkleTree::IsMerkleId(entry.hash) && MerkleTree::Parse(entry.hash, tree) ? HASH_MERKLE : HASH_TEXT;
+            if (record.kind == HASH_MERKLE) {
+                MerkleTree::Digest root = tree.GetRoot();
+                std::memcpy(record.digest, root.data(), root.size());
+            }
+            record.blobOffset = blob.size();
+            record.blobLength = static_cast<uint32_t>(entry.hash.size());
+            blob += entry.hash;
+        }
+        if (entry.hasMetadata) {
+            record.flags |= FLAG_METADATA;
+            record.size = entry.size;
+            record.mtimeNs = entry.mtimeNs;
+            record.mode = static_cast<uint16_t>(entry.mode & 07777);
+        }
+    }
+
+    IndexHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, INDEX_MAGIC, sizeof(INDEX_MAGIC));
+    header.version = blake3 ? INDEX_VERSION : 1;
+    header.headerSize = sizeof(IndexHeader);
+    header.count = records.size();
+    header.recordOffset = Align8(sizeof(IndexHeader));
+    header.restartCount = restarts.size();
+    header.restartOffset = header.recordOffset + header.count * sizeof(Record);
+    header.poolOffset = header.restartOffset + header.restartCount * sizeof(uint64_t);
+    header.poolSize = pool.size();
+    header.blobOffset = header.poolOffset + header.poolSize;
+    header.blobSize = blob.size();
+    header.fileSize = header.blobOffset + header.blobSize;
+    header.blockSize = BlockSize;
+    header.generation = generation;
+    header.createdNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    header.checksum = HeaderChecksum(header);
+
+    std::string tempFile = indexFile + ".tmp";
+    {
+        std::ofstream out(tempFile, std::ios::binary | std::ios::trunc);
+        if (!out.is_open()) {
+            if (error) *error = "Cannot create baseline file: " + tempFile;
+            return false;
+        }
+        const char padding[8] = {0};
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(padding, static_cast<std::streamsize>(header.recordOffset - sizeof(header)));
+        out.write(reinterpret_cast<const char*>(records.data()),
+                  static_cast<std::streamsize>(records.size() * sizeof(Record)));
+        out.write(reinterpret_cast<const char*>(restarts.data()),
+                  static_cast<std::streamsize>(restarts.size() * sizeof(uint64_t)));
+        out.write(pool.data(), static_cast<std::streamsize>(pool.size()));
+        out.write(blob.data(), static_cast<std::streamsize>(blob.size()));
+        if (!out.good()) {
+            if (error) *error = "Failed to write baseline file: " + tempFile;
+            out.close();
+            std::remove(tempFile.c_str());
+            return false;
+        }
+    }
+
+#ifdef _WIN32
+    std::remove(indexFile.c_str());
+#endif
+    if (std::rename(tempFile.c_str(), indexFile.c_str()) != 0) {
+        if (error) *error = "Failed to move baseline into place: " + indexFile;
+        std::remove(tempFile.c_str());
+        return false;
+    }
+
+    localStats.entries = records.size();
+    localStats.poolBytes = pool.size();
+    if (stats) {
+        *stats = localStats;
+    }
+    return true;
+}
+
+bool BaselineIndex::ParseTextLine(const std::string& line, std::string& path, std::string& hash) {
+    if (line.empty() || line[0] == '#') {
+        return false;
+    }
+    size_t end = line.size();
+    if (line[end - 1] == '\r') {
+        --end;
+    }
+    size_t colon = line.rfind(':', end);
+    if (colon == std::string::npos || colon == 0 || colon + 1 >= end) {
+        return false;
+    }
+    // Hashes never contain ':', so the last one ends the path
+    path = line.substr(0, colon);
+    hash = line.substr(colon + 1, end - colon - 1);
+    return true;
+}
+
+bool BaselineIndex::ConvertText(const std::string& textFile, const std::string& indexFile,
+                                CompileStats* stats, std::string* error) {
+    std::ifstream in(textFile);
+    if (!in.is_open()) {
+        if (error) *error = "Cannot open text baseline: " + textFile;
+        return false;
+    }
+    CompileStats localStats;
+    std::vector<Entry> entries;
+    std::string line;
+    while (std::getline(in, line)) {
+        localStats.linesRead++;
+        Entry entry;
+        if (!ParseTextLine(line, entry.path, entry.hash)) {
+            localStats.linesSkipped++;
+            continue;
+        }
+        entries.push_back(std::move(entry));
+    }
+    if (!Compile(std::move(entries), indexFile, &localStats, error)) {
+        return false;
+    }
+    if (stats) {
+        *stats = localStats;
+    }
+    return true;
+}
+
+bool BaselineIndex::IsIndexFile(const std::string& file) {
+    std::ifstream in(file, std::ios::binary);
+    char magic[sizeof(INDEX_MAGIC)];
+    return in.read(magic, sizeof(magic)) && std::memcmp(magic, INDEX_MAGIC, sizeof(magic)) == 0;
+}
+
+bool BaselineIndex::Open(const std::string& indexFile) {
+    Close();
+    if (!file_.Open(indexFile)) {
+        lastError_ = "Cannot open baseline: " + indexFile;
+        return false;
+    }
+
+    IndexHeader header;
+    if (file_.Size() < sizeof(header)) {
+        lastError_ = "Baseline too small: " + indexFile;
+        file_.Close();
+        return false;
+    }
+    std::memcpy(&header, file_.Data(), sizeof(header));
+
+    uint64_t expectedRestarts = (header.count + BlockSize - 1) / BlockSize;
+    bool valid = std::memcmp(header.magic, INDEX_MAGIC, sizeof(INDEX_MAGIC)) == 0 &&
+                 header.version >= 1 && header.version <= INDEX_VERSION &&
+                 header.headerSize == sizeof(IndexHeader) &&
+                 header.checksum == HeaderChecksum(header) &&
+                 header.fileSize == file_.Size() &&
+                 header.blockSize == BlockSize &&
+                 header.restartCount == expectedRestarts &&
+                 header.recordOffset % 8 == 0 && header.recordOffset >= sizeof(IndexHeader) &&
+                 header.count <= (header.fileSize - header.recordOffset) / sizeof(Record) &&
+                 header.restartOffset == header.recordOffset + header.count * sizeof(Record) &&
+                 header.poolOffset == header.restartOffset + header.restartCount * sizeof(uint64_t) &&
+                 header.blobOffset == header.poolOffset + header.poolSize &&
+                 header.blobOffset <= header.fileSize &&
+                 header.blobSize == header.fileSize - header.blobOffset;
+    if (!valid) {
+        lastError_ = "Invalid or corrupt baseline: " + indexFile;
+        file_.Close();
+        return false;
+    }
+
+    const uint8_t* base = file_.Data();
+    records_ = reinterpret_cast<const Record*>(base + header.recordOffset);
+    restarts_ = reinterpret_cast<const uint64_t*>(base + header.restartOffset);
+    pool_ = base + header.poolOffset;
+    blob_ = reinterpret_cast<const char*>(base + header.blobOffset);
+    count_ = header.count;
+    restartCount_ = header.restartCount;
+    poolSize_ = header.poolSize;
+    blobSize_ = header.blobSize;
+    generation_ = header.generation;
+    createdNs_ = header.createdNs;
+    lastError_.clear();
+    return true;
+}
+
+void BaselineIndex::Close() {
+    file_.Close();
+    records_ = nullptr;
+    restarts_ = nullptr;
+    pool_ = nullptr;
+    blob_ = nullptr;
+    count_ = restartCount_ = poolSize_ = blobSize_ = 0;
+    generation_ = 0;
+    createdNs_ = 0;
+}
+
+bool BaselineIndex::DecodePath(uint64_t& offset, std::string& path) const {
+    uint64_t shared = 0;
+    uint64_t length = 0;
+    if (!GetVarint(pool_, poolSize_, offset, shared) || !GetVarint(pool_, poolSize_, offset, length) ||
+        shared > path.size() || length > poolSize_ - offset) {
+        return false;
+    }
+    path.resize(static_cast<size_t>(shared));
+    path.append(reinterpret_cast<const char*>(pool_ + offset), static_cast<size_t>(length));
+    offset += length;
+    return true;
+}
+
+void BaselineIndex::DecodeEntry(size_t index, Entry& entry) const {
+    const Record& record = records_[index];
+    if (record.kind == HASH_SHA256) {
+        static const char digits[] = "0123456789abcdef";
+        entry.hash.resize(64);
+        for (size_t i = 0; i < 32; ++i) {
+            entry.hash[2 * i] = digits[record.digest[i] >> 4];
+            entry.hash[2 * i + 1] = digits[record.digest[i] & 15];
+        }
+    } else if (record.kind == HASH_BLAKE3) {
+        entry.hash = Blake3::ToId(record.digest);
+    } else if (record.blobOffset <= blobSize_ && record.blobLength <= blobSize_ - record.blobOffset) {
+        entry.hash.assign(blob_ + record.blobOffset, record.blobLength);
+    } else {
+        entry.hash.clear();
+    }
+    entry.hasMetadata = (record.flags & FLAG_METADATA) != 0;
+    entry.size = record.size;
+    entry.mtimeNs = record.mtimeNs;
+    entry.mode = record.mode;
+}
+
+bool BaselineIndex::GetMetadata(uint64_t ordinal, Entry& entry) const {
+    if (ordinal >= count_) {
+        return false;
+    }
+    DecodeEntry(static_cast<size_t>(ordinal), entry);
+    return true;
+}
+
+bool BaselineIndex::Find(const std::string& path, Entry& entry, uint64_t* ordinal) const {
+    if (!IsOpen() || count_ == 0) {
+        return false;
+    }
+    // Last block whose first path is <= path; restart entries are stored whole
+    uint64_t low = 0;
+    uint64_t high = restartCount_;
+    while (high - low > 1) {
+        uint64_t middle = low + (high - low) / 2;
+        uint64_t offset = restarts_[middle];
+        uint64_t shared = 0;
+        uint64_t length = 0;
+        if (offset >= poolSize_ || !GetVarint(pool_, poolSize_, offset, shared) ||
+            !GetVarint(pool_, poolSize_, offset, length) || length > poolSize_ - offset) {
+            return false;
+        }
+        size_t common = static_cast<size_t>(std::min<uint64_t>(length, path.size()));
+        int order = std::memcmp(pool_ + offset, path.data(), common);
+        if (order < 0 || (order == 0 && length <= path.size())) {
+            low = middle;
+        } else {
+            high = middle;
+        }
+    }
+
+    uint64_t offset = restarts_[low];
+    std::string current;
+    uint64_t end = std::min<uint64_t>(count_, (low + 1) * BlockSize);
+    for (uint64_t i = low * BlockSize; i < end; ++i) {
+        if (offset >= poolSize_ || !DecodePath(offset, current)) {
+            return false;
+        }
+        int order = current.compare(path);
+        if (order == 0) {
+            entry.path = current;
+            DecodeEntry(static_cast<size_t>(i), entry);
+            if (ordinal) {
+                *ordinal = i;
+            }
+            return true;
+        }
+        if (order > 0) {
+            return false;
+        }
+    }
+    return false;
+}
+
+void BaselineIndex::ForEach(const std::function<void(const Entry&)>& visit) const {
+    Entry entry;
+    uint64_t offset = 0;
+    for (uint64_t i = 0; i < count_; ++i) {
+        if (i % BlockSize == 0) {
+            offset = restarts_[i / BlockSize];
+        }
+        if (offset >= poolSize_ || !DecodePath(offset, entry.path)) {
+            return;
+        }
+        DecodeEntry(static_cast<size_t>(i), entry);
+        visit(entry);
+    }
+}
@@ -0,0 +1,783 @@
+#include "Blake3.h"
+#include "WorkStealingPool.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <numeric>
+#include <thread>
+#include <type_traits>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#include <immintrin.h>
+#define BLAKE3_X86_DISPATCH 1
+#endif
+
+namespace {
+    const uint32_t IV[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+    };
+
+    const uint32_t CHUNK_START = 1;
+    const uint32_t CHUNK_END = 2;
+    const uint32_t PARENT = 4;
+    const uint32_t ROOT = 8;
+
+    // Message word order of each round: the permutation applied 0 to 6 times
+    constexpr uint8_t kSchedule[7][16] = {
+        {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15},
+        {2, 6, 3, 10, 7, 0, 4, 13, 1, 11, 12, 5, 9, 14, 15, 8},
+        {3, 4, 10, 12, 13, 2, 7, 14, 6, 5, 9, 0, 11, 15, 8, 1},
+        {10, 7, 12, 9, 14, 3, 13, 15, 4, 0, 11, 2, 5, 8, 1, 6},
+        {12, 13, 9, 11, 15, 10, 14, 8, 7, 2, 5, 3, 0, 1, 6, 4},
+        {9, 14, 11, 5, 8, 12, 15, 1, 13, 3, 0, 10, 2, 6, 4, 7},
+        {11, 15, 5, 0, 1, 9, 8, 6, 14, 10, 2, 12, 3, 4, 7, 13}
+    };
+
+    // Subtrees are hashed in these steps so the SIMD kernels get whole groups of chunks
+    const size_t kChunksPerStep = 64;
+    const size_t kManyChunks = 16;           // Longest message HashMany runs in lockstep with others, in chunks
+    const size_t kManyMessages = 256;        // Messages in lockstep at once
+
+    // HashParallel leaves at least this much to each task
+    const uint64_t kMinSubtreeLength = 256 * 1024;
+
+    inline uint32_t LoadLittleEndian(const uint8_t* p) {
+        return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+               (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+    }
+
+    inline void StoreLittleEndian(uint8_t* p, uint32_t value) {
+        p[0] = static_cast<uint8_t>(value);
+        p[1] = static_cast<uint8_t>(value >> 8);
+        p[2] = static_cast<uint8_t>(value >> 16);
+        p[3] = static_cast<uint8_t>(value >> 24);
+    }
+
+    inline void LoadBlock(const uint8_t* block, uint32_t m[16]) {
+        for (int i = 0; i < 16; ++i) {
+            m[i] = LoadLittleEndian(block + 4 * i);
+        }
+    }
+
+    // The round function is written once over V, either uint32_t or a GCC vector of lanes. The
+    // helpers are force-inlined so the vector code is compiled for the target of the kernel using it.
+#define BLAKE3_INLINE inline __attribute__((always_inline))
+
+    // Byte shuffles that rotate every 32-bit lane right by 8 and by 16
+    alignas(32) constexpr uint8_t kRotate8[32] = {
+        1, 2, 3, 0, 5, 6, 7, 4, 9, 10, 11, 8, 13, 14, 15, 12,
+        17, 18, 19, 16, 21, 22, 23, 20, 25, 26, 27, 24, 29, 30, 31, 28
+    };
+    alignas(32) constexpr uint8_t kRotate16[32] = {
+        2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13,
+        18, 19, 16, 17, 22, 23, 20, 21, 26, 27, 24, 25, 30, 31, 28, 29
+    };
+
+    template <int N, typename V>
+    BLAKE3_INLINE void RotateRight(V& x) {
+        // SSE and AVX2 have no rotate; whole-byte rotations are one shuffle instead of two shifts and an or.
+        // AVX-512 has one, and no byte shuffle without AVX512BW.
+        if constexpr ((N == 8 || N == 16) && (sizeof(V) == 16 || sizeof(V) == 32)) {
+            typedef uint8_t Bytes16 __attribute__((vector_size(16)));
+            typedef uint8_t Bytes32 __attribute__((vector_size(32)));
+            using Bytes = typename std::conditional<sizeof(V) == 16, Bytes16, Bytes32>::type;
+            Bytes mask;
+            std::memcpy(&mask, N == 8 ? kRotate8 : kRotate16, sizeof(mask));
+            x = reinterpret_cast<V>(__builtin_shuffle(reinterpret_cast<Bytes>(x), mask));
+        } else {
+            x = (x >> N) | (x << (32 - N));
+        }
+    }
+
+    template <typename V>
+    BLAKE3_INLINE void Splat(V& out, uint32_t value) {
+        out = V{} + value;
+    }
+
+    template <typename V>
+    BLAKE3_INLINE void G(V& a, V& b, V& c, V& d, const V& x, const V& y) {
+        a = a + b + x; d ^= a; RotateRight<16>(d);
+        c = c + d;     b ^= c; RotateRight<12>(b);
+        a = a + b + y; d ^= a; RotateRight<8>(d);
+        c = c + d;     b ^= c; RotateRight<7>(b);
+    }
+
+    // Compresses one block per lane into cv
+    template <typename V>
+    BLAKE3_INLINE void CompressLanes(V cv[8], const V m[16], const V& counterLow, const V& counterHigh,
+                                     uint32_t blockLength, uint32_t flags) {
+        V v[16]{};
+        for (int i = 0; i < 8; ++i) {
+            v[i] = cv[i];
+        }
+        for (int i = 0; i < 4; ++i) {
+            Splat(v[8 + i], IV[i]);
+        }
+        v[12] = counterLow;
+        v[13] = counterHigh;
+        Splat(v[14], blockLength);
+        Splat(v[15], flags);
+#pragma GCC unroll 7
+        for (int r = 0; r < 7; ++r) {
+            const uint8_t* s = kSchedule[r];
+            G(v[0], v[4], v[8], v[12], m[s[0]], m[s[1]]);
+            G(v[1], v[5], v[9], v[13], m[s[2]], m[s[3]]);
+            G(v[2], v[6], v[10], v[14], m[s[4]], m[s[5]]);
+            G(v[3], v[7], v[11], v[15], m[s[6]], m[s[7]]);
+            G(v[0], v[5], v[10], v[15], m[s[8]], m[s[9]]);
+            G(v[1], v[6], v[11], v[12], m[s[10]], m[s[11]]);
+            G(v[2], v[7], v[8], v[13], m[s[12]], m[s[13]]);
+            G(v[3], v[4], v[9], v[14], m[s[14]], m[s[15]]);
+        }
+        for (int i = 0; i < 8; ++i) {
+            cv[i] = v[i] ^ v[i + 8];
+        }
+    }
+
+    void Compress(uint32_t cv[8], const uint32_t m[16], uint32_t blockLength, uint64_t counter, uint32_t flags) {
+        CompressLanes<uint32_t>(cv, m, static_cast<uint32_t>(counter), static_cast<uint32_t>(counter >> 32),
+                                blockLength, flags);
+    }
+
+    void ParentValue(const uint32_t left[8], const uint32_t right[8], uint32_t out[8], uint32_t flags = 0) {
+        uint32_t m[16];
+        std::memcpy(m, left, 8 * sizeof(uint32_t));
+        std::memcpy(m + 8, right, 8 * sizeof(uint32_t));
+        std::memcpy(out, IV, sizeof(IV));
+        Compress(out, m, Blake3::BlockSize, 0, PARENT | flags);
+    }
+
+    // Chaining value of the first blocks whole blocks of one input
+    void HashOne(const uint8_t* input, size_t blocks, uint64_t counter, uint32_t flagsStart, uint32_t flagsEnd,
+                 uint8_t out[Blake3::DigestSize]) {
+        uint32_t cv[8];
+        std::memcpy(cv, IV, sizeof(IV));
+        uint32_t flags = flagsStart;
+        for (size_t b = 0; b < blocks; ++b, input += Blake3::BlockSize) {
+            if (b + 1 == blocks) {
+                flags |= flagsEnd;
+            }
+            uint32_t m[16];
+            LoadBlock(input, m);
+            Compress(cv, m, Blake3::BlockSize, counter, flags);
+            flags = 0;
+        }
+        for (int i = 0; i < 8; ++i) {
+            StoreLittleEndian(out + 4 * i, cv[i]);
+        }
+    }
+
+#ifdef BLAKE3_X86_DISPATCH
+    typedef uint32_t Lanes4 __attribute__((vector_size(16)));
+    typedef uint32_t Lanes8 __attribute__((vector_size(32)));
+    typedef uint32_t Lanes16 __attribute__((vector_size(64)));
+
+    template <typename V, size_t Lanes>
+    BLAKE3_INLINE void LaneCounters(uint64_t counter, bool increment, V& low, V& high) {
+        for (size_t lane = 0; lane < Lanes; ++lane) {
+            uint64_t value = counter + (increment ? lane : 0);
+            low[lane] = static_cast<uint32_t>(value);
+            high[lane] = static_cast<uint32_t>(value >> 32);
+        }
+    }
+
+    template <typename V, size_t Lanes>
+    BLAKE3_INLINE void StoreLanes(const V cv[8], uint8_t* out) {
+        for (size_t lane = 0; lane < Lanes; ++lane) {
+            for (int i = 0; i < 8; ++i) {
+                StoreLittleEndian(out + Blake3::DigestSize * lane + 4 * i, cv[i][lane]);
+            }
+        }
+    }
+
+    // Four inputs at once; each 16-byte quarter of the block is a 4x4 transpose
+    __attribute__((target("sse4.1")))
+    void HashMany4(const uint8_t* const* inputs, size_t blocks, uint64_t counter, bool increment,
+                   uint32_t flagsStart, uint32_t flagsEnd, uint8_t* out) {
+        Lanes4 cv[8], counterLow, counterHigh;
+        for (int i = 0; i < 8; ++i) {
+            Splat(cv[i], IV[i]);
+        }
+        LaneCounters<Lanes4, 4>(counter, increment, counterLow, counterHigh);
+        uint32_t flags = flagsStart;
+        for (size_t b = 0; b < blocks; ++b) {
+            if (b + 1 == blocks) {
+                flags |= flagsEnd;
+            }
+            Lanes4 m[16];
+            for (size_t quarter = 0; quarter < 4; ++quarter) {
+                size_t offset = b * Blake3::BlockSize + 16 * quarter;
+                __m128i r0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(inputs[0] + offset));
+                __m128i r1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(inputs[1] + offset));
+                __m128i r2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(inputs[2] + offset));
+                __m128i r3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(inputs[3] + offset));
+                __m128i t0 = _mm_unpacklo_epi32(r0, r1), t1 = _mm_unpackhi_epi32(r0, r1);
+                __m128i t2 = _mm_unpacklo_epi32(r2, r3), t3 = _mm_unpackhi_epi32(r2, r3);
+                m[4 * quarter] = reinterpret_cast<Lanes4>(_mm_unpacklo_epi64(t0, t2));
+                m[4 * quarter + 1] = reinterpret_cast<Lanes4>(_mm_unpackhi_epi64(t0, t2));
+                m[4 * quarter + 2] = reinterpret_cast<Lanes4>(_mm_unpacklo_epi64(t1, t3));
+                m[4 * quarter + 3] = reinterpret_cast<Lanes4>(_mm_unpackhi_epi64(t1, t3));
+            }
+            CompressLanes(cv, m, counterLow, counterHigh, Blake3::BlockSize, flags);
+            flags = 0;
+        }
+        StoreLanes<Lanes4, 4>(cv, out);
+    }
+
+    // Eight inputs at once; each half of the block is an 8x8 transpose
+    __attribute__((target("avx2")))
+    void HashMany8(const uint8_t* const* inputs, size_t blocks, uint64_t counter, bool increment,
+                   uint32_t flagsStart, uint32_t flagsEnd, uint8_t* out) {
+        Lanes8 cv[8], counterLow, counterHigh;
+        for (int i = 0; i < 8; ++i) {
+            Splat(cv[i], IV[i]);
+        }
+        LaneCounters<Lanes8, 8>(counter, increment, counterLow, counterHigh);
+        uint32_t flags = flagsStart;
+        for (size_t b = 0; b < blocks; ++b) {
+            if (b + 1 == blocks) {
+                flags |= flagsEnd;
+            }
+            Lanes8 m[16];
+            for (size_t half = 0; half < 2; ++half) {
+                __m256i r[8];
+                for (int lane = 0; lane < 8; ++lane) {
+                    r[lane] = _mm256_loadu_si256(
+                        reinterpret_cast<const __m256i*>(inputs[lane] + b * Blake3::BlockSize + 32 * half));
+                }
+                __m256i t0 = _mm256_unpacklo_epi32(r[0], r[1]), t1 = _mm256_unpackhi_epi32(r[0], r[1]);
+                __m256i t2 = _mm256_unpacklo_epi32(r[2], r[3]), t3 = _mm256_unpackhi_epi32(r[2], r[3]);
+                __m256i t4 = _mm256_unpacklo_epi32(r[4], r[5]), t5 = _mm256_unpackhi_epi32(r[4], r[5]);
+                __m256i t6 = _mm256_unpacklo_epi32(r[6], r[7]), t7 = _mm256_unpackhi_epi32(r[6], r[7]);
+                __m256i u0 = _mm256_unpacklo_epi64(t0, t2), u1 = _mm256_unpackhi_epi64(t0, t2);
+                __m256i u2 = _mm256_unpacklo_epi64(t1, t3), u3 = _mm256_unpackhi_epi64(t1, t3);
+                __m256i u4 = _mm256_unpacklo_epi64(t4, t6), u5 = _mm256_unpackhi_epi64(t4, t6);
+                __m256i u6 = _mm256_unpacklo_epi64(t5, t7), u7 = _mm256_unpackhi_epi64(t5, t7);
+                Lanes8* words = m + 8 * half;
+                words[0] = reinterpret_cast<Lanes8>(_mm256_permute2x128_si256(u0, u4, 0x20));
+                words[1] = reinterpret_cast<Lanes8>(_mm256_permute2x128_si256(u1, u5, 0x20));
+                words[2] = reinterpret_cast<Lanes8>(_mm256_permute2x128_si256(u2, u6, 0x20));
+                words[3] = reinterpret_cast<Lanes8>(_mm256_permute2x128_si256(u3, u7, 0x20));
+                words[4] = reinterpret_cast<Lanes8>(_mm256_permute2x128_si256(u0, u4, 0x31));
+                words[5] = reinterpret_cast<Lanes8>(_mm256_permute2x128_si256(u1, u5, 0x31));
+                words[6] = reinterpret_cast<Lanes8>(_mm256_permute2x128_si256(u2, u6, 0x31));
+                words[7] = reinterpret_cast<Lanes8>(_mm256_permute2x128_si256(u3, u7, 0x31));
+            }
+            CompressLanes(cv, m, counterLow, counterHigh, Blake3::BlockSize, flags);
+            flags = 0;
+        }
+        StoreLanes<Lanes8, 8>(cv, out);
+    }
+
+    // Index vectors of one 16x16 transpose step: rows i and i + step trade their off-diagonal blocks
+    struct TransposeStep {
+        uint32_t low[16];
+        uint32_t high[16];
+    };
+
+    constexpr TransposeStep MakeTransposeStep(uint32_t step) {
+        TransposeStep indices{};
+        for (uint32_t c = 0; c < 16; ++c) {
+            indices.low[c] = (c & step) ? 16 + c - step : c;
+            indices.high[c] = (c & step) ? 16 + c : c + step;
+        }
+        return indices;
+    }
+
+    alignas(64) constexpr TransposeStep kTransposeSteps[4] = {
+        MakeTransposeStep(8), MakeTransposeStep(4), MakeTransposeStep(2), MakeTransposeStep(1)
+    };
+
+    // Sixteen inputs at once; the whole block is a 16x16 transpose
+    __attribute__((target("avx512f")))
+    void HashMany16(const uint8_t* const* inputs, size_t blocks, uint64_t counter, bool increment,
+                    uint32_t flagsStart, uint32_t flagsEnd, uint8_t* out) {
+        Lanes16 cv[8], counterLow, counterHigh;
+        for (int i = 0; i < 8; ++i) {
+            Splat(cv[i], IV[i]);
+        }
+        LaneCounters<Lanes16, 16>(counter, increment, counterLow, counterHigh);
+        __m512i low[4], high[4];
+        for (int step = 0; step < 4; ++step) {
+            low[step] = _mm512_load_si512(kTransposeSteps[step].low);
+            high[step] = _mm512_load_si512(kTransposeSteps[step].high);
+        }
+        uint32_t flags = flagsStart;
+        for (size_t b = 0; b < blocks; ++b) {
+            if (b + 1 == blocks) {
+                flags |= flagsEnd;
+            }
+            __m512i r[16];
+            for (int lane = 0; lane < 16; ++lane) {
+                r[lane] = _mm512_loadu_si512(inputs[lane] + b * Blake3::BlockSize);
+            }
+            for (int step = 0, size = 8; step < 4; ++step, size >>= 1) {
+                for (int i = 0; i < 16; ++i) {
+                    if (i & size) {
+                        continue;
+                    }
+                    __m512i top = r[i];
+                    r[i] = _mm512_permutex2var_epi32(top, low[step], r[i + size]);
+                    r[i + size] = _mm512_permutex2var_epi32(top, high[step], r[i + size]);
+                }
+            }
+            Lanes16 m[16];
+            for (int i = 0; i < 16; ++i) {
+                m[i] = reinterpret_cast<Lanes16>(r[i]);
+            }
+            CompressLanes(cv, m, counterLow, counterHigh, Blake3::BlockSize, flags);
+            flags = 0;
+        }
+        StoreLanes<Lanes16, 16>(cv, out);
+    }
+#endif
+
+    bool Supported(Blake3::Implementation implementation) {
+        switch (implementation) {
+            case Blake3::Implementation::Portable:
+                return true;
+#ifdef BLAKE3_X86_DISPATCH
+            case Blake3::Implementation::Sse41:
+                __builtin_cpu_init();
+                return __builtin_cpu_supports("sse4.1");
+            case Blake3::Implementation::Avx2:
+                __builtin_cpu_init();
+                return __builtin_cpu_supports("avx2");
+            case Blake3::Implementation::Avx512:
+                __builtin_cpu_init();
+                return __builtin_cpu_supports("avx512f");
+#endif
+            default:
+                return false;
+        }
+    }
+
+    std::atomic<Blake3::Implementation>& Selected() {
+        static std::atomic<Blake3::Implementation> selected([] {
+            for (auto implementation : {Blake3::Implementation::Avx512, Blake3::Implementation::Avx2,
+                                        Blake3::Implementation::Sse41}) {
+                if (Supported(implementation)) {
+                    return implementation;
+                }
+            }
+            return Blake3::Implementation::Portable;
+        }());
+        return selected;
+    }
+
+    size_t LanesOf(Blake3::Implementation implementation) {
+        switch (implementation) {
+            case Blake3::Implementation::Avx512: return 16;
+            case Blake3::Implementation::Avx2: return 8;
+            case Blake3::Implementation::Sse41: return 4;
+            default: return 1;
+        }
+    }
+
+    // Chaining values of count inputs of blocks whole blocks each, as wide as the selected kernel allows
+    // @param out 8 words per input
+    void HashChunks(const uint8_t* const* inputs, size_t count, size_t blocks, uint64_t counter, bool increment,
+                    uint32_t flagsStart, uint32_t flagsEnd, uint8_t* out) {
+        Blake3::Implementation implementation = Selected().load(std::memory_order_relaxed);
+        while (count > 0) {
+            size_t done = 1;
+#ifdef BLAKE3_X86_DISPATCH
+            if (implementation >= Blake3::Implementation::Avx512 && count >= 16) {
+                HashMany16(inputs, blocks, counter, increment, flagsStart, flagsEnd, out);
+                done = 16;
+            } else if (implementation >= Blake3::Implementation::Avx2 && count >= 8) {
+                HashMany8(inputs, blocks, counter, increment, flagsStart, flagsEnd, out);
+                done = 8;
+            } else if (implementation >= Blake3::Implementation::Sse41 && count >= 4) {
+                HashMany4(inputs, blocks, counter, increment, flagsStart, flagsEnd, out);
+                done = 4;
+            } else
+#endif
+            {
+                HashOne(inputs[0], blocks, counter, flagsStart, flagsEnd, out);
+            }
+            inputs += done;
+            count -= done;
+            out += Blake3::DigestSize * done;
+            if (increment) {
+                counter += done;
+            }
+        }
+    }
+
+    uint64_t RoundDownToPowerOfTwo(uint64_t value) {
+        uint64_t power = 1;
+        while (power <= value / 2) {
+            power *= 2;
+        }
+        return power;
+    }
+
+    // Size of the left subtree of a node over length bytes (more than one chunk): the largest
+    // power-of-two number of chunks that leaves at least one byte on the right
+    uint64_t LeftLength(uint64_t length) {
+        return RoundDownToPowerOfTwo((length - 1) / Blake3::ChunkSize) * Blake3::ChunkSize;
+    }
+
+    uint64_t SubtreeLimit(uint64_t maxLength) {
+        return RoundDownToPowerOfTwo(std::max<uint64_t>(1, maxLength / Blake3::ChunkSize)) * Blake3::ChunkSize;
+    }
+
+    void Split(uint64_t offset, uint64_t length, uint64_t limit, std::vector<Blake3::Subtree>& subtrees) {
+        if (length <= limit) {
+            subtrees.push_back(Blake3::Subtree{offset, length});
+            return;
+        }
+        uint64_t left = LeftLength(length);
+        Split(offset, left, limit, subtrees);
+        Split(offset + left, length - left, limit, subtrees);
+    }
+
+    void Join(uint64_t length, uint64_t limit, const uint8_t (*values)[Blake3::DigestSize], size_t& next,
+              uint32_t out[8], uint32_t flags) {
+        if (length <= limit) {
+            for (int i = 0; i < 8; ++i) {
+                out[i] = LoadLittleEndian(values[next] + 4 * i);
+            }
+            next++;
+            return;
+        }
+        uint64_t left = LeftLength(length);
+        uint32_t children[16];
+        Join(left, limit, values, next, children, 0);
+        Join(length - left, limit, values, next, children + 8, 0);
+        ParentValue(children, children + 8, out, flags);
+    }
+}
+
+Blake3::Blake3() {
+    Reset();
+}
+
+void Blake3::Reset() {
+    Start(0);
+}
+
+void Blake3::Start(uint64_t firstChunk) {
+    std::memcpy(chunkValue_, IV, sizeof(IV));
+    std::memset(block_, 0, sizeof(block_));
+    blockLength_ = 0;
+    blocksCompressed_ = 0;
+    chunkCounter_ = firstChunk;
+    firstChunk_ = firstChunk;
+    stackSize_ = 0;
+}
+
+void Blake3::UpdateChunk(const uint8_t* data, size_t size) {
+    while (size > 0) {
+        // A full block waits for more input: the chunk's last block is compressed with CHUNK_END
+        if (blockLength_ == BlockSize) {
+            uint32_t m[16];
+            LoadBlock(block_, m);
+            Compress(chunkValue_, m, BlockSize, chunkCounter_, blocksCompressed_ == 0 ? CHUNK_START : 0);
+            blocksCompressed_++;
+            blockLength_ = 0;
+            std::memset(block_, 0, sizeof(block_));
+        }
+        size_t take = std::min(BlockSize - blockLength_, size);
+        std::memcpy(block_ + blockLength_, data, take);
+        blockLength_ = static_cast<uint8_t>(blockLength_ + take);
+        data += take;
+        size -= take;
+    }
+}
+
+void Blake3::PushSubtree(const uint32_t chainingValue[8], uint64_t chunks) {
+    // The stack mirrors the binary chunk count: every carry completes one more subtree
+    uint32_t value[8];
+    std::memcpy(value, chainingValue, sizeof(value));
+    for (uint64_t total = (chunkCounter_ - firstChunk_ + chunks) / chunks; (total & 1) == 0; total >>= 1) {
+        ParentValue(stack_[--stackSize_], value, value);
+    }
+    std::memcpy(stack_[stackSize_++], value, sizeof(value));
+    chunkCounter_ += chunks;
+}
+
+void Blake3::Update(const void* data, size_t size) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    while (size > 0) {
+        // Only once more input arrives is a full chunk known not to be the root
+        if (ChunkLength() == ChunkSize) {
+            uint32_t m[16];
+            uint32_t value[8];
+            LoadBlock(block_, m);
+            std::memcpy(value, chunkValue_, sizeof(value));
+            Compress(value, m, BlockSize, chunkCounter_, (blocksCompressed_ == 0 ? CHUNK_START : 0) | CHUNK_END);
+            PushSubtree(value, 1);
+            std::memcpy(chunkValue_, IV, sizeof(IV));
+            std::memset(block_, 0, sizeof(block_));
+            blockLength_ = 0;
+            blocksCompressed_ = 0;
+        }
+        if (ChunkLength() == 0 && size > ChunkSize) {
+            // Whole chunks short of the last form a complete subtree: the SIMD kernels hash the chunks
+            // side by side, then each level of parents, so only its root joins the stack
+            uint64_t done = chunkCounter_ - firstChunk_;
+            size_t limit = std::min((size - 1) / ChunkSize, kChunksPerStep);
+            size_t chunks = 1;
+            while (chunks * 2 <= limit && done % (chunks * 2) == 0) {
+                chunks *= 2;
+            }
+            const uint8_t* inputs[kChunksPerStep];
+            uint8_t values[kChunksPerStep][DigestSize];
+            for (size_t i = 0; i < chunks; ++i) {
+                inputs[i] = bytes + i * ChunkSize;
+            }
+            HashChunks(inputs, chunks, ChunkSize / BlockSize, chunkCounter_, true, CHUNK_START, CHUNK_END, values[0]);
+            for (size_t width = chunks / 2; width > 0; width /= 2) {
+                for (size_t i = 0; i < width; ++i) {
+                    inputs[i] = values[2 * i];
+                }
+                uint8_t parents[kChunksPerStep / 2][DigestSize];
+                HashChunks(inputs, width, 1, 0, false, PARENT, 0, parents[0]);
+                std::memcpy(values, parents, width * DigestSize);
+            }
+            uint32_t value[8];
+            for (int i = 0; i < 8; ++i) {
+                value[i] = LoadLittleEndian(values[0] + 4 * i);
+            }
+            PushSubtree(value, chunks);
+            bytes += chunks * ChunkSize;
+            size -= chunks * ChunkSize;
+            continue;
+        }
+        size_t take = std::min(ChunkSize - ChunkLength(), size);
+        UpdateChunk(bytes, take);
+        bytes += take;
+        size -= take;
+    }
+}
+
+void Blake3::Finish(bool root, uint8_t out[DigestSize]) const {
+    uint32_t value[8];
+    uint32_t m[16];
+    std::memcpy(value, chunkValue_, sizeof(value));
+    LoadBlock(block_, m);
+    uint32_t blockLength = blockLength_;
+    uint64_t counter = chunkCounter_;
+    uint32_t flags = (blocksCompressed_ == 0 ? CHUNK_START : 0) | CHUNK_END;
+    // The chunk in progress is the rightmost leaf; fold it up through the pending subtrees
+    for (size_t i = stackSize_; i > 0; --i) {
+        Compress(value, m, blockLength, counter, flags);
+        std::memcpy(m, stack_[i - 1], 8 * sizeof(uint32_t));
+        std::memcpy(m + 8, value, 8 * sizeof(uint32_t));
+        std::memcpy(value, IV, sizeof(IV));
+        blockLength = BlockSize;
+        counter = 0;
+        flags = PARENT;
+    }
+    Compress(value, m, blockLength, counter, flags | (root ? ROOT : 0));
+    for (int i = 0; i < 8; ++i) {
+        StoreLittleEndian(out + 4 * i, value[i]);
+    }
+}
+
+void Blake3::Final(uint8_t digest[DigestSize]) {
+    Finish(true, digest);
+    Reset();
+}
+
+std::string Blake3::HexDigest() {
+    uint8_t digest[DigestSize];
+    Final(digest);
+    return ToHex(digest);
+}
+
+std::string Blake3::Hash(const void* data, size_t size) {
+    Blake3 blake;
+    blake.Update(data, size);
+    return blake.HexDigest();
+}
+
+std::string Blake3::ToHex(const uint8_t digest[DigestSize]) {
+    static const char digits[] = "0123456789abcdef";
+    std::string hex(2 * DigestSize, '0');
+    for (size_t i = 0; i < DigestSize; ++i) {
+        hex[2 * i] = digits[digest[i] >> 4];
+        hex[2 * i + 1] = digits[digest[i] & 15];
+    }
+    return hex;
+}
+
+std::string Blake3::ToId(const uint8_t digest[DigestSize]) {
+    return "blake3/" + ToHex(digest);
+}
+
+bool Blake3::IsId(const std::string& hash) {
+    uint8_t digest[DigestSize];
+    return ParseId(hash, digest);
+}
+
+bool Blake3::ParseId(const std::string& id, uint8_t digest[DigestSize]) {
+    if (id.size() != 7 + 2 * DigestSize || id.compare(0, 7, "blake3/") != 0) {
+        return false;
+    }
+    for (size_t i = 0; i < 2 * DigestSize; ++i) {
+        char c = id[7 + i];
+        int value = c >= '0' && c <= '9' ? c - '0' : c >= 'a' && c <= 'f' ? c - 'a' + 10 : -1;
+        if (value < 0) {
+            return false;
+        }
+        digest[i / 2] = static_cast<uint8_t>(i % 2 ? digest[i / 2] | value : value << 4);
+    }
+    return true;
+}
+
+void Blake3::HashMany(const uint8_t* const* data, const size_t* sizes, size_t count, uint8_t (*digests)[DigestSize]) {
+    size_t lanes = LanesOf(Selected().load(std::memory_order_relaxed));
+    std::vector<size_t> batched;
+    for (size_t message = 0; message < count; ++message) {
+        if (lanes > 1 && sizes[message] <= kManyChunks * ChunkSize) {
+            batched.push_back(message);
+            continue;
+        }
+        // Long messages fill the lanes with their own chunks
+        Blake3 blake;
+        blake.Update(data[message], sizes[message]);
+        blake.Final(digests[message]);
+    }
+    if (batched.empty()) {
+        return;
+    }
+
+    // Messages run in lockstep: chunk k of every message shares counter k, so those go through the
+    // lanes together; last chunks are grouped by counter and length, since they stop at their last block
+    auto fullChunks = [sizes](size_t message) { return sizes[message] > 0 ? (sizes[message] - 1) / ChunkSize : 0; };
+    std::sort(batched.begin(), batched.end(), [&](size_t a, size_t b) {
+        return fullChunks(a) != fullChunks(b) ? fullChunks(a) > fullChunks(b) : sizes[a] < sizes[b];
+    });
+    std::vector<Blake3> hashers(std::min(batched.size(), kManyMessages));
+    std::vector<const uint8_t*> inputs(hashers.size());
+    std::vector<uint8_t> values(hashers.size() * DigestSize);
+    for (size_t first = 0; first < batched.size(); first += kManyMessages) {
+        const size_t* slice = &batched[first];
+        size_t sliceSize = std::min(kManyMessages, batched.size() - first);
+        for (size_t i = 0; i < sliceSize; ++i) {
+            hashers[i].Reset();
+        }
+        for (size_t chunk = 0, members = sliceSize; chunk < fullChunks(slice[0]); ++chunk) {
+            while (fullChunks(slice[members - 1]) <= chunk) {
+                members--;
+            }
+            for (size_t i = 0; i < members; ++i) {
+                inputs[i] = data[slice[i]] + chunk * ChunkSize;
+            }
+            HashChunks(inputs.data(), members, ChunkSize / BlockSize, chunk, false, CHUNK_START, CHUNK_END, values.data());
+            for (size_t i = 0; i < members; ++i) {
+                uint32_t value[8];
+                for (int j = 0; j < 8; ++j) {
+                    value[j] = LoadLittleEndian(&values[i * DigestSize + 4 * j]);
+                }
+                hashers[i].PushSubtree(value, 1);
+            }
+        }
+
+        for (size_t group = 0; group < sliceSize;) {
+            size_t chunk = fullChunks(slice[group]);
+            size_t firstSize = sizes[slice[group]] - chunk * ChunkSize;
+            size_t shared = firstSize > BlockSize ? (firstSize - 1) / BlockSize : 0;
+            size_t members = 1;
+            while (group + members < sliceSize && members < lanes && fullChunks(slice[group + members]) == chunk) {
+                members++;
+            }
+            for (size_t i = 0; i < members; ++i) {
+                inputs[i] = data[slice[group + i]] + chunk * ChunkSize;
+            }
+            if (shared > 0) {
+                HashChunks(inputs.data(), members, shared, chunk, false, CHUNK_START, 0, values.data());
+            }
+            for (size_t i = 0; i < members; ++i) {
+                size_t message = slice[group + i];
+                Blake3& blake = hashers[group + i];
+                if (shared > 0) {
+                    for (int j = 0; j < 8; ++j) {
+                        blake.chunkValue_[j] = LoadLittleEndian(&values[i * DigestSize + 4 * j]);
+                    }
+                    blake.blocksCompressed_ = static_cast<uint8_t>(shared);
+                }
+                blake.UpdateChunk(inputs[i] + shared * BlockSize, sizes[message] - chunk * ChunkSize - shared * BlockSize);
+                blake.Final(digests[message]);
+            }
+            group += members;
+        }
+    }
+}
+
+std::vector<Blake3::Subtree> Blake3::SplitSubtrees(uint64_t size, uint64_t maxLength) {
+    std::vector<Subtree> subtrees;
+    Split(0, size, SubtreeLimit(maxLength), subtrees);
+    return subtrees;
+}
+
+void Blake3::HashSubtree(const uint8_t* input, const Subtree& subtree, uint8_t chainingValue[DigestSize]) {
+    Blake3 blake;
+    blake.Start(subtree.offset / ChunkSize);
+    blake.Update(input + subtree.offset, static_cast<size_t>(subtree.length));
+    blake.Finish(false, chainingValue);
+}
+
+void Blake3::CombineSubtrees(uint64_t size, uint64_t maxLength, const uint8_t (*chainingValues)[DigestSize],
+                             uint8_t digest[DigestSize]) {
+    uint32_t value[8];
+    size_t next = 0;
+    Join(size, SubtreeLimit(maxLength), chainingValues, next, value, ROOT);
+    for (int i = 0; i < 8; ++i) {
+        StoreLittleEndian(digest + 4 * i, value[i]);
+    }
+}
+
+void Blake3::HashParallel(const void* data, size_t size, uint8_t digest[DigestSize], unsigned threads) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    // A few subtrees per thread so work stealing can even out the last ones
+    uint64_t maxLength = std::max<uint64_t>(kMinSubtreeLength, size / (4 * threads));
+    std::vector<Subtree> subtrees = SplitSubtrees(size, maxLength);
+    if (subtrees.size() < 2 || threads == 1) {
+        Blake3 blake;
+        blake.Update(bytes, size);
+        blake.Final(digest);
+        return;
+    }
+    std::vector<uint8_t[DigestSize]> values(subtrees.size());
+    {
+        WorkStealingPool pool(static_cast<unsigned>(std::min<size_t>(threads, subtrees.size())));
+        for (size_t i = 0; i < subtrees.size(); ++i) {
+            pool.Submit([&, i] { HashSubtree(bytes, subtrees[i], values[i]); });
+        }
+        pool.Wait();
+    }
+    CombineSubtrees(size, maxLength, values.data(), digest);
+}
+
+bool Blake3::IsSupported(Implementation implementation) {
+    return Supported(implementation);
+}
+
+Blake3::Implementation Blake3::GetImplementation() {
+    return Selected().load();
+}
+
+bool Blake3::SetImplementation(Implementation implementation) {
+    if (!Supported(implementation)) {
+        return false;
+    }
+    Selected().store(implementation);
+    return true;
+}
+
+const char* Blake3::GetImplementationName(Implementation implementation) {
+    switch (implementation) {
+        case Implementation::Portable: return "portable";
+        case Implementation::Sse41: return "sse4.1";
+        case Implementation::Avx2: return "avx2";
+        case Implementation::Avx512: return "avx512";
+    }
+    return "unknown";
+}
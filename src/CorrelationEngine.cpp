@@ -0,0 +1,373 @@
+#include "CorrelationEngine.h"
+#include "Utils.h"
+#include <algorithm>
+#include <cctype>
+
+namespace {
+    const char* const kKeyNames[CorrelationEvent::KeyCount] = {"pid", "ip", "user"};
+
+    bool EqualsIgnoreCase(const std::string& a, const std::string& b) {
+        return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin(), [](char x, char y) {
+            return std::tolower(static_cast<unsigned char>(x)) == std::tolower(static_cast<unsigned char>(y));
+        });
+    }
+
+    bool ContainsIgnoreCase(const std::string& text, const std::string& needle) {
+        return std::search(text.begin(), text.end(), needle.begin(), needle.end(), [](char x, char y) {
+            return std::tolower(static_cast<unsigned char>(x)) == std::tolower(static_cast<unsigned char>(y));
+        }) != text.end();
+    }
+
+    // Value of "<label> <token>" in free text, e.g. "pid 1234" or "user alice"
+    std::string LabelledToken(const std::string& text, const std::string& label, bool digitsOnly) {
+        for (size_t pos = text.find(label); pos != std::string::npos; pos = text.find(label, pos + 1)) {
+            if (pos > 0 && std::isalnum(static_cast<unsigned char>(text[pos - 1]))) {
+                continue;
+            }
+            size_t begin = pos + label.size();
+            size_t end = begin;
+            while (end < text.size() && (digitsOnly ? std::isdigit(static_cast<unsigned char>(text[end]))
+                                                    : !std::isspace(static_cast<unsigned char>(text[end])) &&
+                                                      text[end] != ',' && text[end] != ')')) {
+                ++end;
+            }
+            if (end > begin) {
+                return text.substr(begin, end - begin);
+            }
+        }
+        return "";
+    }
+
+    bool IsAddress(const std::string& text) {
+        uint8_t address[16];
+        bool isIPv6 = false;
+        return Utils::ParseIP(text, address, isIPv6);
+    }
+
+    inline uint32_t LowestBit(uint32_t mask) {
+        return mask & (~mask + 1);
+    }
+}
+
+CorrelationEngine::CorrelationEngine(const Options& options)
+    : options_(options), nextGeneration_(1), stats_{} {
+}
+
+bool CorrelationEngine::AddRule(const Rule& rule) {
+    if (rule.id.empty() || rule.steps.empty() || rule.steps.size() > 32 || rule.key >= Event::KeyCount ||
+        rule.window.count() <= 0) {
+        lastError_ = "Correlation rule '" + rule.id + "' needs an id, 1-32 steps, a key and a positive window";
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& existing : rules_) {
+        if (existing.id == rule.id) {
+            lastError_ = "Duplicate correlation rule '" + rule.id + "'";
+            return false;
+        }
+    }
+    rules_.push_back(rule);
+    partials_.emplace_back();
+    lastError_.clear();
+    return true;
+}
+
+void CorrelationEngine::AddDefaultRules() {
+    Rule rule;
+    rule.id = "process-beacon-config";
+    rule.type = "Correlated Intrusion";
+    rule.description = "New process connected to a rare address and modified configuration";
+    rule.severity = 5;
+    rule.key = Event::Pid;
+    rule.window = std::chrono::seconds(30);
+    rule.ordered = true;
+    rule.steps = {Step("security", "PROCESS"), Step("network", "CONNECTION", "", true), Step("file", "", "/etc/")};
+    AddRule(rule);
+}
+
+void CorrelationEngine::Process(const Event& event, std::vector<ThreatProtection::ThreatInfo>& threats) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ++stats_.events;
+    if (event.timestamp > watermark_) {
+        watermark_ = event.timestamp;
+        ExpireLocked(watermark_);
+    }
+    if (event.stream == "network" && !event.keys[Event::Ip].empty()) {
+        CountIp(event.keys[Event::Ip]);
+    }
+
+    for (uint32_t r = 0; r < rules_.size(); ++r) {
+        const Rule& rule = rules_[r];
+        const std::string& key = event.keys[rule.key];
+        if (key.empty()) {
+            continue;
+        }
+        uint32_t matched = MatchSteps(rule, event);
+        if (matched == 0) {
+            continue;
+        }
+        const uint32_t all = rule.steps.size() == 32 ? ~0u : (1u << rule.steps.size()) - 1;
+
+        auto& partials = partials_[r];
+        auto it = partials.find(key);
+        if (it != partials.end() && event.timestamp - it->second.start > rule.window) {
+            ++stats_.expired;
+            Remove(r, it);
+            it = partials.end();
+        }
+        if (it == partials.end()) {
+            uint32_t first = rule.ordered ? (matched & 1u) : LowestBit(matched);
+            if (first == 0) {
+                continue;
+            }
+            Start(r, key, event, first);
+            it = partials.find(key);
+        } else {
+            Partial& partial = it->second;
+            uint32_t open = all & ~partial.seen;
+            uint32_t next = matched & (rule.ordered ? LowestBit(open) : open);
+            if (next == 0) {
+                // A fresh first step re-anchors a match that has not progressed yet
+                if (rule.ordered && (matched & 1u) && partial.seen == 1u) {
+                    Remove(r, it);
+                    Start(r, key, event, 1u);
+                }
+                continue;
+            }
+            partial.seen |= LowestBit(next);
+            if (partial.events.size() < options_.maxEventsPerMatch) {
+                size_t bytes = EventBytes(event);
+                partial.events.push_back(event);
+                partial.bytes += bytes;
+                stats_.memoryBytes += bytes;
+            }
+        }
+
+        if (it->second.seen == all) {
+            const Partial& partial = it->second;
+            ThreatProtection::ThreatInfo threat;
+            threat.type = rule.type.empty() ? "Correlation" : rule.type;
+            threat.source = std::string(kKeyNames[rule.key]) + " " + key;
+            threat.description = rule.description + " (" + rule.id + ", " +
+                std::to_string(std::chrono::duration_cast<std::chrono::seconds>(
+                    event.timestamp - partial.start).count()) + "s)";
+            threat.severity = rule.severity;
+            threat.detected = event.timestamp;
+            threat.mitigated = false;
+            for (const auto& step : partial.events) {
+                std::string evidence = Utils::FormatTime(step.timestamp) + " [" + step.stream + "/" + step.type + "] " +
+                                       step.description;
+                for (int k = 0; k < Event::KeyCount; ++k) {
+                    if (k != rule.key && !step.keys[k].empty()) {
+                        evidence += std::string(" ") + kKeyNames[k] + "=" + step.keys[k];
+                    }
+                }
+                threat.evidence.push_back(std::move(evidence));
+            }
+            threats.push_back(std::move(threat));
+            ++stats_.completed;
+            Remove(r, it);
+        }
+    }
+    EnforceLimits();
+}
+
+void CorrelationEngine::Expire(std::chrono::system_clock::time_point now) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ExpireLocked(now);
+}
+
+void CorrelationEngine::Clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& partials : partials_) {
+        partials.clear();
+    }
+    deadlines_ = decltype(deadlines_)();
+    ipCounts_.clear();
+    stats_.active = 0;
+    stats_.memoryBytes = 0;
+}
+
+CorrelationEngine::Statistics CorrelationEngine::GetStatistics() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+size_t CorrelationEngine::GetRuleCount() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return rules_.size();
+}
+
+uint32_t CorrelationEngine::MatchSteps(const Rule& rule, const Event& event) const {
+    uint32_t matched = 0;
+    for (size_t i = 0; i < rule.steps.size(); ++i) {
+        const Step& step = rule.steps[i];
+        if ((!step.stream.empty() && step.stream != event.stream) ||
+            (!step.type.empty() && !EqualsIgnoreCase(step.type, event.type)) ||
+            (!step.contains.empty() && !ContainsIgnoreCase(event.description, step.contains))) {
+            continue;
+        }
+        if (step.rareIp) {
+            auto it = ipCounts_.find(event.keys[Event::Ip]);
+            if (event.keys[Event::Ip].empty() || (it != ipCounts_.end() && it->second > options_.rareIpThreshold)) {
+                continue;
+            }
+        }
+        matched |= 1u << i;
+    }
+    return matched;
+}
+
+void CorrelationEngine::Start(uint32_t rule, const std::string& key, const Event& event, uint32_t step) {
+    Partial partial;
+    partial.seen = step;
+    partial.start = event.timestamp;
+    partial.events.push_back(event);
+    partial.bytes = sizeof(Partial) + key.size() * 2 + sizeof(Deadline) + EventBytes(event);
+    partial.generation = nextGeneration_++;
+    deadlines_.push(Deadline{event.timestamp + rules_[rule].window, rule, key, partial.generation});
+    stats_.memoryBytes += partial.bytes;
+    ++stats_.active;
+    ++stats_.started;
+    partials_[rule].emplace(key, std::move(partial));
+}
+
+void CorrelationEngine::Remove(uint32_t rule, std::unordered_map<std::string, Partial>::iterator it) {
+    stats_.memoryBytes -= it->second.bytes;
+    --stats_.active;
+    partials_[rule].erase(it);
+}
+
+void CorrelationEngine::ExpireLocked(std::chrono::system_clock::time_point now) {
+    while (!deadlines_.empty() && deadlines_.top().when < now) {
+        const Deadline& top = deadlines_.top();
+        auto& partials = partials_[top.rule];
+        auto it = partials.find(top.key);
+        if (it != partials.end() && it->second.generation == top.generation) {
+            ++stats_.expired;
+            Remove(top.rule, it);
+        }
+        deadlines_.pop();
+    }
+}
+
+void CorrelationEngine::EnforceLimits() {
+    // Evict the partial matches closest to expiry; stale heap entries are skipped
+    while (!deadlines_.empty() &&
+           (stats_.active > options_.maxPartialMatches || stats_.memoryBytes > options_.maxMemoryBytes)) {
+        const Deadline& top = deadlines_.top();
+        auto& partials = partials_[top.rule];
+        auto it = partials.find(top.key);
+        if (it != partials.end() && it->second.generation == top.generation) {
+            ++stats_.evicted;
+            Remove(top.rule, it);
+        }
+        deadlines_.pop();
+    }
+
+    // Completed and re-anchored matches leave stale deadlines behind; rebuild when they dominate
+    if (deadlines_.size() > 2 * stats_.active + 1024) {
+        std::vector<Deadline> live;
+        live.reserve(stats_.active);
+        for (uint32_t r = 0; r < partials_.size(); ++r) {
+            for (const auto& entry : partials_[r]) {
+                live.push_back(Deadline{entry.second.start + rules_[r].window, r, entry.first, entry.second.generation});
+            }
+        }
+        deadlines_ = decltype(deadlines_)(std::greater<Deadline>(), std::move(live));
+    }
+}
+
+void CorrelationEngine::CountIp(const std::string& ip) {
+    auto it = ipCounts_.find(ip);
+    if (it != ipCounts_.end()) {
+        if (it->second < UINT32_MAX) {
+            ++it->second;
+        }
+        return;
+    }
+    if (ipCounts_.size() >= options_.maxTrackedIps) {
+        // Age the table: halve every count and forget addresses that fall to zero
+        for (auto entry = ipCounts_.begin(); entry != ipCounts_.end();) {
+            entry->second /= 2;
+            entry = entry->second == 0 ? ipCounts_.erase(entry) : std::next(entry);
+        }
+    }
+    ipCounts_.emplace(ip, 1);
+}
+
+size_t CorrelationEngine::EventBytes(const Event& event) {
+    size_t bytes = sizeof(Event) + event.stream.capacity() + event.type.capacity() + event.description.capacity();
+    for (const auto& key : event.keys) {
+        bytes += key.capacity();
+    }
+    return bytes;
+}
+
+CorrelationEngine::Event CorrelationEngine::FromSecurityEvent(const SecurityMonitor::SecurityEvent& event) {
+    Event result;
+    result.timestamp = event.timestamp;
+    result.stream = "security";
+    result.type = event.type;
+    result.description = event.description;
+    result.severity = event.severity;
+    result.keys[Event::Pid] = LabelledToken(event.source, "pid ", true);
+    if (result.keys[Event::Pid].empty()) {
+        result.keys[Event::Pid] = LabelledToken(event.description, "pid ", true);
+    }
+    result.keys[Event::User] = LabelledToken(event.source, "user ", false);
+    if (result.keys[Event::User].empty()) {
+        result.keys[Event::User] = LabelledToken(event.description, "user ", false);
+    }
+    if (IsAddress(event.source)) {
+        result.keys[Event::Ip] = event.source;
+    }
+    return result;
+}
+
+CorrelationEngine::Event CorrelationEngine::FromNetworkLog(const NetworkMonitor::NetworkLog& log) {
+    Event result;
+    result.timestamp = log.timestamp;
+    result.stream = "network";
+    result.type = "LOG";
+    result.description = log.threat + " (" + log.protocol + " " + log.sourceIp + " -> " + log.destinationIp +
+                         ", " + log.status + ")";
+    result.severity = log.status == "BLOCKED" ? 4 : 3;
+    if (IsAddress(log.sourceIp)) {
+        result.keys[Event::Ip] = log.sourceIp;
+    }
+    return result;
+}
+
+CorrelationEngine::Event CorrelationEngine::FromConnection(const NetworkMonitor::NetworkConnection& connection) {
+    Event result;
+    result.timestamp = connection.timestamp;
+    result.stream = "network";
+    result.type = "CONNECTION";
+    result.description = connection.protocol + " " + connection.localAddress + ":" +
+                         std::to_string(connection.localPort) + " -> " + connection.remoteAddress + ":" +
+                         std::to_string(connection.remotePort);
+    if (!connection.processName.empty()) {
+        result.description += " (" + connection.processName + ")";
+    }
+    result.keys[Event::Ip] = connection.remoteAddress;
+    if (connection.processId != 0) {
+        result.keys[Event::Pid] = std::to_string(connection.processId);
+    }
+    return result;
+}
+
+CorrelationEngine::Event CorrelationEngine::FromFileChange(const std::string& path, const std::string& change, int pid,
+                                                           const std::string& user) {
+    Event result;
+    result.timestamp = std::chrono::system_clock::now();
+    result.stream = "file";
+    result.type = Utils::ToUpper(change);
+    result.description = path;
+    result.severity = 2;
+    if (pid != 0) {
+        result.keys[Event::Pid] = std::to_string(pid);
+    }
+    result.keys[Event::User] = user;
+    return result;
+}
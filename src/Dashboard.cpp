@@ -1,7 +1,7 @@
 #include "Dashboard.h"
 #include <algorithm>
 
-Dashboard::Dashboard() : overallStatus_("Unknown"), threatLevel_(1) {
+Dashboard::Dashboard() : overallStatus_("Unknown"), threatLevel_(1), riskScorer_(nullptr) {
     lastUpdate_ = std::chrono::system_clock::now();
 }
 
@@ -55,6 +55,18 @@ void Dashboard::UpdateMetric(const std::string& name, const std::string& value,
     }
 }
 
+void Dashboard::SetRiskScorer(const RiskScorer* scorer) {
+    riskScorer_ = scorer;
+    CalculateOverallStatus();
+}
+
+std::vector<RiskScorer::Entity> Dashboard::GetRiskiestEntities(size_t count) const {
+    if (!riskScorer_) {
+        return {};
+    }
+    return riskScorer_->GetTop(count);
+}
+
 std::string Dashboard::GetOverallStatus() const {
     return overallStatus_;
 }
@@ -64,22 +76,21 @@ int Dashboard::GetThreatLevel() const {
 }
 
 void Dashboard::CalculateOverallStatus() {
-    int criticalCount = 0;
-    int warningCount = 0;
+    // The threat level is the host's decayed risk score; metric health only
+    // sets a floor, so a critical metric still shows without any events
+    int level = riskScorer_ ? riskScorer_->GetHostLevel(lastUpdate_) : 1;
     
     for (const auto& metric : metrics_) {
-        if (metric.status == "critical") criticalCount++;
-        else if (metric.status == "warning") warningCount++;
+        if (metric.status == "critical") level = std::max(level, 5);
+        else if (metric.status == "warning") level = std::max(level, 3);
     }
     
-    if (criticalCount > 0) {
+    threatLevel_ = level;
+    if (level >= 4) {
         overallStatus_ = "Critical";
-        threatLevel_ = 5;
-    } else if (warningCount > 0) {
+    } else if (level >= 3) {
         overallStatus_ = "Warning";
-        threatLevel_ = 3;
     } else {
         overallStatus_ = "Good";
-        threatLevel_ = 1;
     }
-}
\ No newline at end of file
+}
@@ -0,0 +1,204 @@
+#include "FingerprintCache.h"
+#include <cerrno>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <sys/stat.h>
+#endif
+
+namespace {
+    const char* kHeader = "# Security Sentinel fingerprint cache v1";
+}
+
+FingerprintCache::FingerprintCache() {
+}
+
+#ifdef __linux__
+bool FingerprintCache::FromStatx(const struct statx& sx, Fingerprint& fingerprint, bool birthTime) {
+    if (!S_ISREG(sx.stx_mode)) {
+        return false;
+    }
+    fingerprint.device = (static_cast<uint64_t>(sx.stx_dev_major) << 32) | sx.stx_dev_minor;
+    fingerprint.inode = sx.stx_ino;
+    fingerprint.size = sx.stx_size;
+    fingerprint.mtimeNs = sx.stx_mtime.tv_sec * 1000000000LL + sx.stx_mtime.tv_nsec;
+    fingerprint.ctimeNs = sx.stx_ctime.tv_sec * 1000000000LL + sx.stx_ctime.tv_nsec;
+    fingerprint.birthNs = birthTime && (sx.stx_mask & STATX_BTIME)
+                              ? sx.stx_btime.tv_sec * 1000000000LL + sx.stx_btime.tv_nsec : 0;
+    fingerprint.mode = sx.stx_mode;
+    return true;
+}
+#endif
+
+bool FingerprintCache::Stat(const std::string& path, Fingerprint& fingerprint, bool birthTime) {
+#ifdef __linux__
+#ifdef STATX_BTIME
+    struct statx sx;
+    if (statx(AT_FDCWD, path.c_str(), 0, STATX_BASIC_STATS | (birthTime ? STATX_BTIME : 0), &sx) == 0) {
+        return FromStatx(sx, fingerprint, birthTime);
+    }
+    if (errno != ENOSYS) {
+        return false;
+    }
+#endif
+    // Kernels before 4.11 have no statx and no birth time
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0 || !S_ISREG(st.st_mode)) {
+        return false;
+    }
+    fingerprint.device = st.st_dev;
+    fingerprint.inode = st.st_ino;
+    fingerprint.size = static_cast<uint64_t>(st.st_size);
+    fingerprint.mtimeNs = st.st_mtim.tv_sec * 1000000000LL + st.st_mtim.tv_nsec;
+    fingerprint.ctimeNs = st.st_ctim.tv_sec * 1000000000LL + st.st_ctim.tv_nsec;
+    fingerprint.birthNs = 0;
+    fingerprint.mode = st.st_mode;
+    return true;
+#else
+    (void)birthTime;
+    std::error_code ec;
+    if (!std::filesystem::is_regular_file(path, ec)) {
+        return false;
+    }
+    fingerprint.device = 0;
+    fingerprint.inode = 0;
+    fingerprint.size = std::filesystem::file_size(path, ec);
+    auto written = std::filesystem::last_write_time(path, ec);
+    if (ec) {
+        return false;
+    }
+    fingerprint.mtimeNs = std::chrono::duration_cast<std::chrono::nanoseconds>(written.time_since_epoch()).count();
+    fingerprint.ctimeNs = 0;
+    fingerprint.birthNs = 0;
+    fingerprint.mode = 0;
+    return true;
+#endif
+}
+
+bool FingerprintCache::Lookup(const Fingerprint& fingerprint, std::string& hash) const {
+    if (fingerprint.inode == 0) {
+        return false;   // Without an inode the identity is too weak to trust
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = entries_.find(Key{fingerprint.device, fingerprint.inode});
+    if (it == entries_.end()) {
+        return false;
+    }
+    it->second.touched = true;
+    if (it->second.fingerprint != fingerprint) {
+        return false;
+    }
+    hash = it->second.hash;
+    return true;
+}
+
+void FingerprintCache::Store(const Fingerprint& fingerprint, const std::string& hash) {
+    if (fingerprint.inode == 0 || hash.empty()) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries_[Key{fingerprint.device, fingerprint.inode}] = Entry{fingerprint, hash, true};
+}
+
+size_t FingerprintCache::PruneUntouched() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t removed = 0;
+    for (auto it = entries_.begin(); it != entries_.end();) {
+        if (!it->second.touched) {
+            it = entries_.erase(it);
+            removed++;
+        } else {
+            it->second.touched = false;
+            ++it;
+        }
+    }
+    return removed;
+}
+
+void FingerprintCache::Clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries_.clear();
+    lastFullRehash_ = std::chrono::system_clock::time_point();
+}
+
+size_t FingerprintCache::Size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return entries_.size();
+}
+
+std::chrono::system_clock::time_point FingerprintCache::GetLastFullRehash() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return lastFullRehash_;
+}
+
+void FingerprintCache::SetLastFullRehash(std::chrono::system_clock::time_point when) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    lastFullRehash_ = when;
+}
+
+bool FingerprintCache::Load(const std::string& file) {
+    std::ifstream in(file);
+    if (!in.is_open()) {
+        return false;
+    }
+    std::string line;
+    if (!std::getline(in, line) || line != kHeader) {
+        return false;
+    }
+    std::unordered_map<Key, Entry, KeyHash> loaded;
+    int64_t lastFull = 0;
+    while (std::getline(in, line)) {
+        if (line.empty()) {
+            continue;
+        }
+        std::istringstream fields(line);
+        if (line[0] == '#') {
+            std::string tag;
+            fields >> tag >> tag;
+            if (tag == "full_rehash") {
+                fields >> lastFull;
+            }
+            continue;
+        }
+        Entry entry;
+        entry.touched = false;
+        Fingerprint& f = entry.fingerprint;
+        f.mode = 0;
+        if (fields >> f.device >> f.inode >> f.size >> f.mtimeNs >> f.ctimeNs >> f.birthNs >> entry.hash) {
+            loaded[Key{f.device, f.inode}] = entry;
+        }
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries_.swap(loaded);
+    lastFullRehash_ = std::chrono::system_clock::time_point(std::chrono::seconds(lastFull));
+    return true;
+}
+
+bool FingerprintCache::Save(const std::string& file) const {
+    std::string temporary = file + ".tmp";
+    {
+        std::ofstream out(temporary, std::ios::trunc);
+        if (!out.is_open()) {
+            return false;
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        out << kHeader << "\n";
+        out << "# full_rehash " << std::chrono::duration_cast<std::chrono::seconds>(
+                                       lastFullRehash_.time_since_epoch()).count() << "\n";
+        for (const auto& entry : entries_) {
+            const Fingerprint& f = entry.second.fingerprint;
+            out << f.device << ' ' << f.inode << ' ' << f.size << ' ' << f.mtimeNs << ' ' << f.ctimeNs << ' '
+                << f.birthNs << ' ' << entry.second.hash << '\n';
+        }
+        if (!out.flush()) {
+            return false;
+        }
+    }
+    std::error_code ec;
+    std::filesystem::rename(temporary, file, ec);
+    return !ec;
+}
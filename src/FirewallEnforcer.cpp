@@ -0,0 +1,754 @@
+#include "FirewallEnforcer.h"
+#include "Utils.h"
+#include <algorithm>
+#include <iostream>
+#include <cstring>
+
+#ifdef __linux__
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <linux/netlink.h>
+#include <linux/netfilter.h>
+#include <linux/netfilter/nfnetlink.h>
+#include <linux/netfilter/nf_tables.h>
+#include <cerrno>
+#endif
+
+bool MockFirewallDriver::Apply(const std::vector<Operation>& batch, std::string& error) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (failNext_) {
+        failNext_ = false;
+        error = "mock driver: injected failure";
+        return false;
+    }
+    batches_.push_back(batch);
+    return true;
+}
+
+std::vector<std::vector<FirewallDriver::Operation>> MockFirewallDriver::GetBatches() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return batches_;
+}
+
+#ifdef __linux__
+
+namespace {
+    // Grace added to the kernel-side element timeout. The enforcer removes
+    // expired entries itself; the kernel timeout only cleans up after a crash.
+    const uint64_t KERNEL_TIMEOUT_GRACE_MS = 60000;
+    const uint32_t SET_ID_V4 = 1;
+    const uint32_t SET_ID_V6 = 2;
+    // Deletes an element if present (Linux 6.3+); not in older uapi headers
+    const uint16_t MSG_DESTROYSETELEM = 30;
+
+    /**
+     * Minimal netlink message builder for nfnetlink batches.
+     * Attributes are appended in place; Nest/EndNest patch the nested length.
+     */
+    class NetlinkBuilder {
+    public:
+        explicit NetlinkBuilder(std::vector<uint8_t>& buffer) : buffer_(buffer), message_(0) {}
+
+        void Begin(uint16_t type, uint16_t flags, uint32_t seq, uint8_t family, uint16_t resId) {
+            message_ = buffer_.size();
+            nlmsghdr header;
+            std::memset(&header, 0, sizeof(header));
+            header.nlmsg_type = type;
+            header.nlmsg_flags = static_cast<uint16_t>(NLM_F_REQUEST | flags);
+            header.nlmsg_seq = seq;
+            Append(&header, sizeof(header));
+
+            nfgenmsg gen;
+            gen.nfgen_family = family;
+            gen.version = NFNETLINK_V0;
+            gen.res_id = htons(resId);
+            Append(&gen, sizeof(gen));
+        }
+
+        void End() {
+            uint32_t length = static_cast<uint32_t>(buffer_.size() - message_);
+            std::memcpy(&buffer_[message_], &length, sizeof(length));
+        }
+
+        void Put(uint16_t type, const void* data, size_t length) {
+            nlattr attr;
+            attr.nla_len = static_cast<uint16_t>(NLA_HDRLEN + length);
+            attr.nla_type = type;
+            Append(&attr, sizeof(attr));
+            Append(data, length);
+            Pad();
+        }
+
+        void PutString(uint16_t type, const std::string& value) { Put(type, value.c_str(), value.size() + 1); }
+        void PutU32(uint16_t type, uint32_t value) { uint32_t be = htonl(value); Put(type, &be, sizeof(be)); }
+        void PutU64(uint16_t type, uint64_t value) {
+            uint8_t be[8];
+            for (int i = 0; i < 8; ++i) be[i] = static_cast<uint8_t>(value >> (56 - 8 * i));
+            Put(type, be, sizeof(be));
+        }
+
+        size_t Nest(uint16_t type) {
+            size_t offset = buffer_.size();
+            nlattr attr;
+            attr.nla_len = 0;
+            attr.nla_type = static_cast<uint16_t>(type | NLA_F_NESTED);
+            Append(&attr, sizeof(attr));
+            return offset;
+        }
+
+        void EndNest(size_t offset) {
+            uint16_t length = static_cast<uint16_t>(buffer_.size() - offset);
+            std::memcpy(&buffer_[offset], &length, sizeof(length));
+        }
+
+        size_t MessageSize() const { return buffer_.size() - message_; }
+
+    private:
+        std::vector<uint8_t>& buffer_;
+        size_t message_;
+
+        void Append(const void* data, size_t length) {
+            const uint8_t* bytes = static_cast<const uint8_t*>(data);
+            buffer_.insert(buffer_.end(), bytes, bytes + length);
+        }
+
+        void Pad() { buffer_.resize(NLA_ALIGN(buffer_.size()), 0); }
+    };
+
+    void PutExpression(NetlinkBuilder& nl, const char* name) {
+        nl.PutString(NFTA_EXPR_NAME, name);
+    }
+
+    // meta nfproto == <proto>; payload <offset,len> -> reg1; lookup @set; drop
+    void PutDropRule(NetlinkBuilder& nl, const std::string& table, const std::string& set,
+                     uint32_t setId, uint8_t nfproto, uint32_t offset, uint32_t length) {
+        nl.PutString(NFTA_RULE_TABLE, table);
+        nl.PutString(NFTA_RULE_CHAIN, "input");
+        size_t expressions = nl.Nest(NFTA_RULE_EXPRESSIONS);
+
+        size_t elem = nl.Nest(NFTA_LIST_ELEM);
+        PutExpression(nl, "meta");
+        size_t data = nl.Nest(NFTA_EXPR_DATA);
+        nl.PutU32(NFTA_META_DREG, NFT_REG_1);
+        nl.PutU32(NFTA_META_KEY, NFT_META_NFPROTO);
+        nl.EndNest(data);
+        nl.EndNest(elem);
+
+        elem = nl.Nest(NFTA_LIST_ELEM);
+        PutExpression(nl, "cmp");
+        data = nl.Nest(NFTA_EXPR_DATA);
+        nl.PutU32(NFTA_CMP_SREG, NFT_REG_1);
+        nl.PutU32(NFTA_CMP_OP, NFT_CMP_EQ);
+        size_t value = nl.Nest(NFTA_CMP_DATA);
+        nl.Put(NFTA_DATA_VALUE, &nfproto, 1);
+        nl.EndNest(value);
+        nl.EndNest(data);
+        nl.EndNest(elem);
+
+        elem = nl.Nest(NFTA_LIST_ELEM);
+        PutExpression(nl, "payload");
+        data = nl.Nest(NFTA_EXPR_DATA);
+        nl.PutU32(NFTA_PAYLOAD_DREG, NFT_REG_1);
+        nl.PutU32(NFTA_PAYLOAD_BASE, NFT_PAYLOAD_NETWORK_HEADER);
+        nl.PutU32(NFTA_PAYLOAD_OFFSET, offset);
+        nl.PutU32(NFTA_PAYLOAD_LEN, length);
+        nl.EndNest(data);
+        nl.EndNest(elem);
+
+        elem = nl.Nest(NFTA_LIST_ELEM);
+        PutExpression(nl, "lookup");
+        data = nl.Nest(NFTA_EXPR_DATA);
+        nl.PutString(NFTA_LOOKUP_SET, set);
+        nl.PutU32(NFTA_LOOKUP_SREG, NFT_REG_1);
+        nl.PutU32(NFTA_LOOKUP_SET_ID, setId);
+        nl.EndNest(data);
+        nl.EndNest(elem);
+
+        elem = nl.Nest(NFTA_LIST_ELEM);
+        PutExpression(nl, "immediate");
+        data = nl.Nest(NFTA_EXPR_DATA);
+        nl.PutU32(NFTA_IMMEDIATE_DREG, NFT_REG_VERDICT);
+        size_t immediate = nl.Nest(NFTA_IMMEDIATE_DATA);
+        size_t verdict = nl.Nest(NFTA_DATA_VERDICT);
+        nl.PutU32(NFTA_VERDICT_CODE, NF_DROP);
+        nl.EndNest(verdict);
+        nl.EndNest(immediate);
+        nl.EndNest(data);
+        nl.EndNest(elem);
+
+        nl.EndNest(expressions);
+    }
+}
+
+NftablesFirewallDriver::NftablesFirewallDriver(const std::string& table, const std::string& set)
+    : table_(table), set_(set), socket_(-1), sequence_(static_cast<uint32_t>(time(nullptr))),
+      errorCode_(0), destroySupported_(false) {
+}
+
+NftablesFirewallDriver::~NftablesFirewallDriver() {
+    if (socket_ >= 0) {
+        close(socket_);
+    }
+}
+
+bool NftablesFirewallDriver::Open(std::string& error) {
+    if (socket_ >= 0) {
+        return true;
+    }
+    socket_ = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_NETFILTER);
+    if (socket_ < 0) {
+        error = std::string("netlink socket: ") + std::strerror(errno);
+        return false;
+    }
+    sockaddr_nl local;
+    std::memset(&local, 0, sizeof(local));
+    local.nl_family = AF_NETLINK;
+    if (bind(socket_, reinterpret_cast<sockaddr*>(&local), sizeof(local)) != 0) {
+        error = std::string("netlink bind: ") + std::strerror(errno);
+        close(socket_);
+        socket_ = -1;
+        return false;
+    }
+
+    // Large batches go out in one sendmsg; SO_SNDBUFFORCE ignores wmem_max (needs CAP_NET_ADMIN)
+    int bufferSize = 4 * 1024 * 1024;
+    if (setsockopt(socket_, SOL_SOCKET, SO_SNDBUFFORCE, &bufferSize, sizeof(bufferSize)) != 0) {
+        setsockopt(socket_, SOL_SOCKET, SO_SNDBUF, &bufferSize, sizeof(bufferSize));
+    }
+    timeval timeout = {2, 0};
+    setsockopt(socket_, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    return true;
+}
+
+bool NftablesFirewallDriver::SendBatch(std::vector<uint8_t>& buffer, uint32_t firstSeq, uint32_t messages,
+                                       std::string& error) {
+    sockaddr_nl kernel;
+    std::memset(&kernel, 0, sizeof(kernel));
+    kernel.nl_family = AF_NETLINK;
+    ssize_t sent = sendto(socket_, buffer.data(), buffer.size(), 0,
+                          reinterpret_cast<sockaddr*>(&kernel), sizeof(kernel));
+    if (sent != static_cast<ssize_t>(buffer.size())) {
+        errorCode_ = errno;
+        error = std::string("netlink send: ") + std::strerror(errno);
+        return false;
+    }
+
+    // Every message carries NLM_F_ACK: success is one zero-error ack per message,
+    // while an aborted transaction reports the failing message and stops
+    uint32_t acked = 0;
+    std::vector<uint8_t> reply(64 * 1024);
+    while (acked < messages) {
+        ssize_t received = recv(socket_, reply.data(), reply.size(), 0);
+        if (received < 0) {
+            errorCode_ = errno;
+            error = std::string("netlink receive: ") + std::strerror(errno);
+            return false;
+        }
+        int remaining = static_cast<int>(received);
+        for (nlmsghdr* header = reinterpret_cast<nlmsghdr*>(reply.data()); NLMSG_OK(header, remaining);
+             header = NLMSG_NEXT(header, remaining)) {
+            if (header->nlmsg_seq < firstSeq || header->nlmsg_type != NLMSG_ERROR) {
+                continue;
+            }
+            const nlmsgerr* status = static_cast<const nlmsgerr*>(NLMSG_DATA(header));
+            if (status->error != 0) {
+                errorCode_ = -status->error;
+                error = "nftables transaction rejected at message " + std::to_string(header->nlmsg_seq - firstSeq) +
+                        ": " + std::strerror(-status->error);
+                return false;
+            }
+            acked++;
+        }
+    }
+    errorCode_ = 0;
+    return true;
+}
+
+bool NftablesFirewallDriver::Initialize(std::string& error) {
+    if (!Open(error)) {
+        return false;
+    }
+
+    std::vector<uint8_t> buffer;
+    NetlinkBuilder nl(buffer);
+    uint32_t firstSeq = ++sequence_;
+    uint32_t seq = firstSeq;
+    uint32_t messages = 0;
+    const uint16_t create = NLM_F_CREATE | NLM_F_ACK;
+    auto type = [](int msg) { return static_cast<uint16_t>((NFNL_SUBSYS_NFTABLES << 8) | msg); };
+
+    nl.Begin(NFNL_MSG_BATCH_BEGIN, 0, seq++, AF_UNSPEC, NFNL_SUBSYS_NFTABLES);
+    nl.End();
+
+    // add table; delete table; add table - recreates it empty whether or not it existed
+    nl.Begin(type(NFT_MSG_NEWTABLE), create, seq++, NFPROTO_INET, 0);
+    nl.PutString(NFTA_TABLE_NAME, table_);
+    nl.End();
+    nl.Begin(type(NFT_MSG_DELTABLE), NLM_F_ACK, seq++, NFPROTO_INET, 0);
+    nl.PutString(NFTA_TABLE_NAME, table_);
+    nl.End();
+    nl.Begin(type(NFT_MSG_NEWTABLE), create, seq++, NFPROTO_INET, 0);
+    nl.PutString(NFTA_TABLE_NAME, table_);
+    nl.End();
+
+    const struct { const char* suffix; uint32_t id; uint32_t keyType; uint32_t keyLength; } sets[] = {
+        {"_v4", SET_ID_V4, 7 /* ipv4_addr */, 4},
+        {"_v6", SET_ID_V6, 8 /* ipv6_addr */, 16},
+    };
+    for (const auto& set : sets) {
+        nl.Begin(type(NFT_MSG_NEWSET), create, seq++, NFPROTO_INET, 0);
+        nl.PutString(NFTA_SET_TABLE, table_);
+        nl.PutString(NFTA_SET_NAME, set_ + set.suffix);
+        nl.PutU32(NFTA_SET_FLAGS, NFT_SET_TIMEOUT);
+        nl.PutU32(NFTA_SET_KEY_TYPE, set.keyType);
+        nl.PutU32(NFTA_SET_KEY_LEN, set.keyLength);
+        nl.PutU32(NFTA_SET_ID, set.id);
+        nl.End();
+    }
+
+    nl.Begin(type(NFT_MSG_NEWCHAIN), create, seq++, NFPROTO_INET, 0);
+    nl.PutString(NFTA_CHAIN_TABLE, table_);
+    nl.PutString(NFTA_CHAIN_NAME, "input");
+    size_t hook = nl.Nest(NFTA_CHAIN_HOOK);
+    nl.PutU32(NFTA_HOOK_HOOKNUM, NF_INET_LOCAL_IN);
+    nl.PutU32(NFTA_HOOK_PRIORITY, static_cast<uint32_t>(-10)); // Ahead of the default filter chains
+    nl.EndNest(hook);
+    nl.PutU32(NFTA_CHAIN_POLICY, NF_ACCEPT);
+    nl.PutString(NFTA_CHAIN_TYPE, "filter");
+    nl.End();
+
+    nl.Begin(type(NFT_MSG_NEWRULE), create | NLM_F_APPEND, seq++, NFPROTO_INET, 0);
+    PutDropRule(nl, table_, set_ + "_v4", SET_ID_V4, NFPROTO_IPV4, 12, 4);
+    nl.End();
+    nl.Begin(type(NFT_MSG_NEWRULE), create | NLM_F_APPEND, seq++, NFPROTO_INET, 0);
+    PutDropRule(nl, table_, set_ + "_v6", SET_ID_V6, NFPROTO_IPV6, 8, 16);
+    nl.End();
+    messages = seq - firstSeq - 1;
+
+    nl.Begin(NFNL_MSG_BATCH_END, 0, seq++, AF_UNSPEC, NFNL_SUBSYS_NFTABLES);
+    nl.End();
+    sequence_ = seq;
+
+    if (!SendBatch(buffer, firstSeq, messages, error)) {
+        return false;
+    }
+
+    // Kernels that know the destroy operation accept it for an element that is not there
+    Operation probe;
+    std::memset(probe.addr, 0, sizeof(probe.addr));
+    probe.action = Action::Remove;
+    probe.isIPv6 = false;
+    probe.ttl = std::chrono::milliseconds(0);
+    std::string ignored;
+    destroySupported_ = true;
+    destroySupported_ = SendElements({probe}, ignored);
+    return true;
+}
+
+bool NftablesFirewallDriver::Apply(const std::vector<Operation>& batch, std::string& error) {
+    if (batch.empty()) {
+        return true;
+    }
+    if (!Open(error)) {
+        return false;
+    }
+    if (SendElements(batch, error)) {
+        return true;
+    }
+    if (destroySupported_ || errorCode_ != ENOENT) {
+        return false;
+    }
+
+    // A delete of an element whose kernel timeout already ran out aborts the whole
+    // transaction. Deletes go one per transaction, where ENOENT means already gone,
+    // then the adds together; a refresh's delete still precedes its add
+    std::vector<Operation> adds;
+    for (const auto& op : batch) {
+        if (op.action == Action::Add) {
+            adds.push_back(op);
+        } else if (!SendElements({op}, error) && errorCode_ != ENOENT) {
+            return false;
+        }
+    }
+    return SendElements(adds, error);
+}
+
+bool NftablesFirewallDriver::SendElements(const std::vector<Operation>& batch, std::string& error) {
+    if (batch.empty()) {
+        errorCode_ = 0;
+        return true;
+    }
+    std::vector<uint8_t> buffer;
+    buffer.reserve(256 + batch.size() * 64);
+    NetlinkBuilder nl(buffer);
+    uint32_t firstSeq = ++sequence_;
+    uint32_t seq = firstSeq;
+
+    nl.Begin(NFNL_MSG_BATCH_BEGIN, 0, seq++, AF_UNSPEC, NFNL_SUBSYS_NFTABLES);
+    nl.End();
+
+    // Consecutive operations of the same kind on the same set share one
+    // element-list message, split before a message nears the 64KB attribute limit
+    size_t i = 0;
+    while (i < batch.size()) {
+        const Operation& first = batch[i];
+        uint16_t msg = first.action == Action::Add ? static_cast<uint16_t>(NFT_MSG_NEWSETELEM)
+                     : destroySupported_               ? MSG_DESTROYSETELEM
+                                                       : static_cast<uint16_t>(NFT_MSG_DELSETELEM);
+        uint16_t flags = first.action == Action::Add ? (NLM_F_CREATE | NLM_F_ACK) : NLM_F_ACK;
+        nl.Begin(static_cast<uint16_t>((NFNL_SUBSYS_NFTABLES << 8) | msg), flags, seq++, NFPROTO_INET, 0);
+        nl.PutString(NFTA_SET_ELEM_LIST_TABLE, table_);
+        nl.PutString(NFTA_SET_ELEM_LIST_SET, set_ + (first.isIPv6 ? "_v6" : "_v4"));
+        size_t elements = nl.Nest(NFTA_SET_ELEM_LIST_ELEMENTS);
+
+        while (i < batch.size() && batch[i].action == first.action && batch[i].isIPv6 == first.isIPv6 &&
+               nl.MessageSize() < 60000) {
+            const Operation& op = batch[i++];
+            size_t elem = nl.Nest(NFTA_LIST_ELEM);
+            size_t key = nl.Nest(NFTA_SET_ELEM_KEY);
+            nl.Put(NFTA_DATA_VALUE, op.addr, op.isIPv6 ? 16 : 4);
+            nl.EndNest(key);
+            if (op.action == Action::Add && op.ttl.count() > 0) {
+                nl.PutU64(NFTA_SET_ELEM_TIMEOUT, static_cast<uint64_t>(op.ttl.count()) + KERNEL_TIMEOUT_GRACE_MS);
+            }
+            nl.EndNest(elem);
+        }
+        nl.EndNest(elements);
+        nl.End();
+    }
+    uint32_t messages = seq - firstSeq - 1;
+
+    nl.Begin(NFNL_MSG_BATCH_END, 0, seq++, AF_UNSPEC, NFNL_SUBSYS_NFTABLES);
+    nl.End();
+    sequence_ = seq;
+
+    return SendBatch(buffer, firstSeq, messages, error);
+}
+
+#endif
+
+FirewallEnforcer::FirewallEnforcer(std::unique_ptr<FirewallDriver> driver, const Options& options)
+    : driver_(std::move(driver)), options_(options), applying_(false), stopping_(false), failures_(0) {
+    if (!driver_) {
+        driver_.reset(new NullFirewallDriver());
+    }
+    if (options_.maxBatch == 0) {
+        options_.maxBatch = 1;
+    }
+    stats_ = Statistics{0, 0, 0, 0, 0, 0, 0, 0, 0};
+    worker_ = std::thread(&FirewallEnforcer::WorkerLoop, this);
+}
+
+FirewallEnforcer::~FirewallEnforcer() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    if (worker_.joinable()) {
+        worker_.join();
+    }
+}
+
+FirewallEnforcer& FirewallEnforcer::Instance() {
+    static FirewallEnforcer instance([] {
+        auto& config = Utils::Config::Instance();
+#ifdef __linux__
+        std::string name = config.GetString("firewall", "driver", "nftables");
+#else
+        std::string name = config.GetString("firewall", "driver", "none");
+#endif
+        std::unique_ptr<FirewallDriver> driver;
+#ifdef __linux__
+        if (name == "nftables") {
+            driver.reset(new NftablesFirewallDriver(config.GetString("firewall", "table", "security_sentinel")));
+        }
+#endif
+        std::string error;
+        if (driver && !driver->Initialize(error)) {
+            std::cerr << "Firewall driver " << name << " unavailable (" << error
+                      << "); blocks are tracked but not enforced" << std::endl;
+            driver.reset();
+        }
+        return driver;
+    }(), [] {
+        Options options;
+        options.defaultTtl = std::chrono::seconds(
+            Utils::Config::Instance().GetInt("firewall", "block_ttl_seconds", 3600));
+        return options;
+    }());
+    return instance;
+}
+
+bool FirewallEnforcer::Normalize(const std::string& ip, std::string& normalized) {
+    uint8_t addr[16];
+    bool isIPv6 = false;
+    if (!Utils::ParseIP(ip, addr, isIPv6)) {
+        return false;
+    }
+    normalized = Utils::FormatIP(addr, isIPv6);
+    return !normalized.empty();
+}
+
+bool FirewallEnforcer::Block(const std::string& ip, std::chrono::milliseconds ttl) {
+    std::string key;
+    if (!Normalize(ip, key)) {
+        return false;
+    }
+    if (ttl.count() < 0) {
+        ttl = options_.defaultTtl;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stats_.requested++;
+        auto it = pending_.find(key);
+        if (it != pending_.end()) {
+            it->second = Request{FirewallDriver::Action::Add, ttl};
+            stats_.coalesced++;
+            return true;
+        }
+        if (order_.size() >= options_.maxQueued) {
+            stats_.dropped++;
+            return false;
+        }
+        pending_.emplace(key, Request{FirewallDriver::Action::Add, ttl});
+        order_.push_back(key);
+    }
+    wake_.notify_one();
+    return true;
+}
+
+bool FirewallEnforcer::Unblock(const std::string& ip) {
+    std::string key;
+    if (!Normalize(ip, key)) {
+        return false;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stats_.requested++;
+        auto it = pending_.find(key);
+        if (it != pending_.end()) {
+            it->second = Request{FirewallDriver::Action::Remove, std::chrono::milliseconds(0)};
+            stats_.coalesced++;
+            return true;
+        }
+        if (order_.size() >= options_.maxQueued) {
+            stats_.dropped++;
+            return false;
+        }
+        pending_.emplace(key, Request{FirewallDriver::Action::Remove, std::chrono::milliseconds(0)});
+        order_.push_back(key);
+    }
+    wake_.notify_one();
+    return true;
+}
+
+bool FirewallEnforcer::IsBlocked(const std::string& ip) const {
+    std::string key;
+    if (!Normalize(ip, key)) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    // A queued request wins over the applied state, so a fresh block shows at once
+    auto pending = pending_.find(key);
+    if (pending != pending_.end()) {
+        return pending->second.action == FirewallDriver::Action::Add;
+    }
+    return active_.find(key) != active_.end();
+}
+
+std::vector<std::string> FirewallEnforcer::GetBlockedIPs() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<std::string> result;
+    result.reserve(active_.size() + pending_.size());
+    for (const auto& entry : active_) {
+        auto pending = pending_.find(entry.first);
+        if (pending == pending_.end() || pending->second.action == FirewallDriver::Action::Add) {
+            result.push_back(entry.first);
+        }
+    }
+    for (const auto& entry : pending_) {
+        if (entry.second.action == FirewallDriver::Action::Add && active_.find(entry.first) == active_.end()) {
+            result.push_back(entry.first);
+        }
+    }
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+bool FirewallEnforcer::Flush(std::chrono::milliseconds timeout) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    wake_.notify_one();
+    return idle_.wait_for(lock, timeout, [this] { return order_.empty() && !applying_; });
+}
+
+void FirewallEnforcer::CollectExpired(std::chrono::steady_clock::time_point now) {
+    while (!expiries_.empty() && expiries_.top().when <= now) {
+        Expiry expiry = expiries_.top();
+        expiries_.pop();
+
+        // Stale heap entries (re-blocked or unblocked since) are skipped
+        auto it = active_.find(expiry.ip);
+        if (it == active_.end() || it->second != expiry.when || pending_.count(expiry.ip) != 0) {
+            continue;
+        }
+        pending_.emplace(expiry.ip, Request{FirewallDriver::Action::Remove, std::chrono::milliseconds(0)});
+        order_.push_back(expiry.ip);
+        stats_.expired++;
+    }
+}
+
+void FirewallEnforcer::WorkerLoop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        if (order_.empty()) {
+            idle_.notify_all();
+            if (stopping_) {
+                break;
+            }
+            if (expiries_.empty()) {
+                wake_.wait(lock, [this] { return stopping_ || !order_.empty(); });
+            } else {
+                auto next = expiries_.top().when;
+                wake_.wait_until(lock, next, [this] { return stopping_ || !order_.empty(); });
+            }
+        }
+
+        // Give a burst a moment to accumulate so it lands in one transaction
+        if (!stopping_ && !order_.empty() && order_.size() < options_.maxBatch) {
+            wake_.wait_for(lock, options_.batchDelay, [this] {
+                return stopping_ || order_.size() >= options_.maxBatch;
+            });
+        }
+
+        // After a failed batch, hold off before handing the driver anything else
+        if (!stopping_ && std::chrono::steady_clock::now() < retryAt_) {
+            wake_.wait_until(lock, retryAt_, [this] { return stopping_; });
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        CollectExpired(now);
+        if (order_.empty()) {
+            continue;
+        }
+
+        // Turn the latest request per address into driver operations
+        std::vector<FirewallDriver::Operation> batch;
+        std::vector<Change> changes;
+        while (!order_.empty() && batch.size() < options_.maxBatch) {
+            std::string ip = std::move(order_.front());
+            order_.pop_front();
+            auto pending = pending_.find(ip);
+            Request request = pending->second;
+            pending_.erase(pending);
+
+            FirewallDriver::Operation op;
+            op.isIPv6 = false;
+            Utils::ParseIP(ip, op.addr, op.isIPv6);
+            op.ip = ip;
+            op.ttl = request.ttl;
+
+            auto active = active_.find(ip);
+            Change change{ip, request, active != active_.end(), std::chrono::steady_clock::time_point()};
+            if (change.hadActive) {
+                change.previous = active->second;
+            }
+            if (request.action == FirewallDriver::Action::Add) {
+                auto expires = request.ttl.count() > 0 ? now + request.ttl : std::chrono::steady_clock::time_point::max();
+                bool refresh = active != active_.end();
+                if (refresh) {
+                    if (expires <= active->second) {
+                        continue; // Already blocked for at least as long
+                    }
+                    // Re-adding does not extend a kernel-side timeout; replace the element
+                    op.action = FirewallDriver::Action::Remove;
+                    batch.push_back(op);
+                }
+                op.action = FirewallDriver::Action::Add;
+                batch.push_back(op);
+                active_[ip] = expires;
+                if (request.ttl.count() > 0) {
+                    expiries_.push(Expiry{expires, ip});
+                }
+            } else {
+                if (active == active_.end()) {
+                    continue; // Nothing to remove
+                }
+                // Stays in active_ until the driver confirms the removal
+                op.action = FirewallDriver::Action::Remove;
+                batch.push_back(op);
+            }
+            changes.push_back(std::move(change));
+        }
+        if (batch.empty()) {
+            continue;
+        }
+
+        applying_ = true;
+        lock.unlock();
+        std::string error;
+        bool ok = driver_->Apply(batch, error);
+        lock.lock();
+        applying_ = false;
+
+        stats_.batches++;
+        if (ok) {
+            stats_.applied += batch.size();
+            failures_ = 0;
+            for (const auto& change : changes) {
+                if (change.request.action == FirewallDriver::Action::Remove) {
+                    active_.erase(change.ip);
+                }
+            }
+        } else {
+            // The transaction was rolled back: put the local state back the
+            // way the kernel still has it and queue the requests again
+            stats_.failedBatches++;
+            lastError_ = error;
+            for (auto change = changes.rbegin(); change != changes.rend(); ++change) {
+                if (change->request.action == FirewallDriver::Action::Add) {
+                    if (!change->hadActive) {
+                        active_.erase(change->ip);
+                    } else {
+                        active_[change->ip] = change->previous;
+                        if (change->previous != std::chrono::steady_clock::time_point::max()) {
+                            expiries_.push(Expiry{change->previous, change->ip});
+                        }
+                    }
+                }
+                // A newer request for the address supersedes the failed one
+                if (!stopping_ && pending_.find(change->ip) == pending_.end()) {
+                    pending_.emplace(change->ip, change->request);
+                    order_.push_front(change->ip);
+                    stats_.retried++;
+                }
+            }
+            failures_ = std::min(failures_ + 1, 16u);
+            auto backoff = std::min(std::chrono::milliseconds(100) * (1 << std::min(failures_ - 1, 9u)),
+                                    std::chrono::milliseconds(30000));
+            retryAt_ = std::chrono::steady_clock::now() + backoff;
+            std::cerr << "Firewall batch of " << batch.size() << " operations failed: " << error
+                      << "; retrying in " << backoff.count() << "ms" << std::endl;
+        }
+    }
+}
+
+FirewallEnforcer::Statistics FirewallEnforcer::GetStatistics() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Statistics stats = stats_;
+    stats.activeBlocks = active_.size();
+    return stats;
+}
+
+std::string FirewallEnforcer::GetDriverName() const {
+    return driver_->GetName();
+}
+
+std::string FirewallEnforcer::GetLastError() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return lastError_;
+}
@@ -0,0 +1,208 @@
+#include "FlowTable.h"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+    const uint8_t TCP_FIN = 0x01;
+    const uint8_t TCP_RST = 0x04;
+
+    inline uint64_t Load64(const uint8_t* bytes) {
+        uint64_t value;
+        std::memcpy(&value, bytes, sizeof(value));
+        return value;
+    }
+
+    inline uint64_t Mix(uint64_t hash, uint64_t value) {
+        hash ^= value + 0x9e3779b97f4a7c15ULL + (hash << 6) + (hash >> 2);
+        return hash * 0xff51afd7ed558ccdULL;
+    }
+}
+
+bool FlowTable::FlowKey::operator==(const FlowKey& other) const {
+    return lowPort == other.lowPort && highPort == other.highPort && protocol == other.protocol &&
+           ipVersion == other.ipVersion && std::memcmp(lowAddr, other.lowAddr, 16) == 0 &&
+           std::memcmp(highAddr, other.highAddr, 16) == 0;
+}
+
+size_t FlowTable::FlowKeyHash::operator()(const FlowKey& key) const {
+    uint64_t hash = Mix(key.protocol, (static_cast<uint64_t>(key.lowPort) << 16) | key.highPort);
+    hash = Mix(hash, Load64(key.lowAddr));
+    hash = Mix(hash, Load64(key.lowAddr + 8));
+    hash = Mix(hash, Load64(key.highAddr));
+    hash = Mix(hash, Load64(key.highAddr + 8));
+    return static_cast<size_t>(hash ^ (hash >> 29));
+}
+
+FlowTable::FlowTable(uint64_t idleTimeoutNs, uint64_t activeTimeoutNs, size_t maxFlows)
+    : idleTimeoutNs_(idleTimeoutNs), activeTimeoutNs_(activeTimeoutNs), maxFlows_(std::max<size_t>(1, maxFlows)) {
+    stats_ = Statistics{0, 0, 0, 0, 0, 0};
+    flows_.reserve(std::min<size_t>(maxFlows_, 65536));
+}
+
+bool FlowTable::MakeKey(const Observation& observation, FlowKey& key) {
+    const size_t length = observation.ipVersion == 6 ? 16 : 4;
+    uint8_t src[16] = {0};
+    uint8_t dst[16] = {0};
+    std::memcpy(src, observation.srcAddr, length);
+    std::memcpy(dst, observation.dstAddr, length);
+
+    // Canonical order makes both directions of a conversation share one key
+    int order = std::memcmp(src, dst, 16);
+    bool srcIsLow = order < 0 || (order == 0 && observation.srcPort <= observation.dstPort);
+    std::memcpy(key.lowAddr, srcIsLow ? src : dst, 16);
+    std::memcpy(key.highAddr, srcIsLow ? dst : src, 16);
+    key.lowPort = srcIsLow ? observation.srcPort : observation.dstPort;
+    key.highPort = srcIsLow ? observation.dstPort : observation.srcPort;
+    key.ipVersion = observation.ipVersion;
+    key.protocol = observation.protocol;
+    return srcIsLow;
+}
+
+void FlowTable::Observe(const Observation& observation) {
+    if (observation.ipVersion != 4 && observation.ipVersion != 6) {
+        return;
+    }
+    stats_.observations++;
+
+    FlowKey key;
+    bool srcIsLow = MakeKey(observation, key);
+    auto it = flows_.find(key);
+    if (it == flows_.end()) {
+        if (flows_.size() >= maxFlows_) {
+            auto victim = flows_.find(lru_.front());
+            if (!victim->second.restartPending) {
+                Emit(victim->second, LackOfResources, evicted_);
+            }
+            Erase(victim);
+            stats_.evictions++;
+        }
+
+        Entry entry;
+        FlowRecord& record = entry.record;
+        record.ipVersion = observation.ipVersion;
+        record.protocol = observation.protocol;
+        std::memcpy(record.srcAddr, srcIsLow ? key.lowAddr : key.highAddr, 16);
+        std::memcpy(record.dstAddr, srcIsLow ? key.highAddr : key.lowAddr, 16);
+        record.srcPort = observation.srcPort;
+        record.dstPort = observation.dstPort;
+        record.startNs = observation.timestampNs;
+        record.endNs = observation.timestampNs;
+        record.packets = record.bytes = record.reversePackets = record.reverseBytes = 0;
+        record.tcpFlags = record.reverseTcpFlags = 0;
+        record.endReason = 0;
+        entry.initiatorIsLow = srcIsLow;
+        entry.lowFin = entry.highFin = entry.ended = entry.restartPending = false;
+        entry.lru = lru_.insert(lru_.end(), key);
+        entry.active = activeOrder_.insert(activeOrder_.end(), std::make_pair(observation.timestampNs, key));
+
+        it = flows_.emplace(key, entry).first;
+        stats_.flowsCreated++;
+    } else {
+        lru_.splice(lru_.end(), lru_, it->second.lru);
+    }
+
+    Entry& entry = it->second;
+    FlowRecord& record = entry.record;
+    if (entry.restartPending) {
+        entry.restartPending = false;
+        record.startNs = observation.timestampNs;
+        entry.active = activeOrder_.insert(activeOrder_.end(), std::make_pair(observation.timestampNs, key));
+    }
+    record.endNs = std::max(record.endNs, observation.timestampNs);
+
+    if (srcIsLow == entry.initiatorIsLow) {
+        record.packets += observation.packets;
+        record.bytes += observation.bytes;
+        record.tcpFlags |= observation.tcpFlags;
+    } else {
+        record.reversePackets += observation.packets;
+        record.reverseBytes += observation.bytes;
+        record.reverseTcpFlags |= observation.tcpFlags;
+    }
+
+    // A reset, or a FIN from both sides, ends the flow at the next Expire()
+    if (observation.protocol == 6 && !entry.ended) {
+        if (observation.tcpFlags & TCP_FIN) {
+            (srcIsLow ? entry.lowFin : entry.highFin) = true;
+        }
+        if ((observation.tcpFlags & TCP_RST) || (entry.lowFin && entry.highFin)) {
+            entry.ended = true;
+            ended_.push_back(key);
+        }
+    }
+}
+
+void FlowTable::Emit(Entry& entry, uint8_t reason, std::vector<FlowRecord>& out) {
+    entry.record.endReason = reason;
+    out.push_back(entry.record);
+    stats_.flowsExpired++;
+}
+
+void FlowTable::Erase(std::unordered_map<FlowKey, Entry, FlowKeyHash>::iterator it) {
+    lru_.erase(it->second.lru);
+    if (it->second.active != activeOrder_.end()) {
+        activeOrder_.erase(it->second.active);
+    }
+    flows_.erase(it);
+}
+
+void FlowTable::Expire(uint64_t nowNs, std::vector<FlowRecord>& out, bool force) {
+    out.insert(out.end(), evicted_.begin(), evicted_.end());
+    evicted_.clear();
+
+    if (force) {
+        for (auto& flow : flows_) {
+            if (!flow.second.restartPending) {
+                Emit(flow.second, ForcedEnd, out);
+            }
+        }
+        flows_.clear();
+        lru_.clear();
+        activeOrder_.clear();
+        ended_.clear();
+        return;
+    }
+
+    for (const FlowKey& key : ended_) {
+        auto it = flows_.find(key);
+        if (it != flows_.end() && it->second.ended) {
+            if (!it->second.restartPending) {
+                Emit(it->second, EndOfFlow, out);
+            }
+            Erase(it);
+        }
+    }
+    ended_.clear();
+
+    // The LRU front is always the flow idle the longest
+    while (!lru_.empty()) {
+        auto it = flows_.find(lru_.front());
+        if (it->second.record.endNs + idleTimeoutNs_ > nowNs) {
+            break;
+        }
+        if (!it->second.restartPending) {
+            Emit(it->second, IdleTimeout, out);
+        }
+        Erase(it);
+    }
+
+    // Long-lived flows report periodically and keep their table slot
+    // (every node belongs to a live flow that has not yet reported)
+    while (!activeOrder_.empty() && activeOrder_.front().first + activeTimeoutNs_ <= nowNs) {
+        auto it = flows_.find(activeOrder_.front().second);
+        activeOrder_.pop_front();
+        Entry& entry = it->second;
+        entry.active = activeOrder_.end();
+        Emit(entry, ActiveTimeout, out);
+        entry.record.packets = entry.record.bytes = entry.record.reversePackets = entry.record.reverseBytes = 0;
+        entry.record.tcpFlags = entry.record.reverseTcpFlags = 0;
+        entry.restartPending = true;
+    }
+}
+
+FlowTable::Statistics FlowTable::GetStatistics() const {
+    Statistics stats = stats_;
+    stats.activeFlows = flows_.size();
+    stats.activeTimers = activeOrder_.size();
+    return stats;
+}
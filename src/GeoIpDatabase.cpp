@@ -0,0 +1,638 @@
+#include "GeoIpDatabase.h"
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+
+namespace {
+    constexpr char DATABASE_MAGIC[8] = {'S', 'S', 'G', 'E', 'O', 'I', 'D', 'X'};
+    constexpr uint32_t DATABASE_VERSION = 1;
+    constexpr size_t V4_JUMP_ENTRIES = 65537;
+    constexpr size_t CACHE_SLOTS = 256;
+
+    struct DatabaseHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t headerSize;
+        uint64_t fileSize;
+        uint64_t v4Count;
+        uint64_t v4StartsOffset;
+        uint64_t v4ValuesOffset;
+        uint64_t v4JumpOffset;
+        uint64_t v6Count;
+        uint64_t v6StartsOffset;
+        uint64_t v6ValuesOffset;
+        uint64_t recordCount;
+        uint64_t recordsOffset;
+        uint64_t stringsSize;
+        uint64_t stringsOffset;
+        uint64_t checksum;         // FNV-1a of this header with checksum = 0
+    };
+
+    uint64_t Fnv1a(const void* data, size_t length) {
+        const uint8_t* bytes = static_cast<const uint8_t*>(data);
+        uint64_t hash = 0xcbf29ce484222325ULL;
+        for (size_t i = 0; i < length; ++i) {
+            hash ^= bytes[i];
+            hash *= 0x100000001b3ULL;
+        }
+        return hash;
+    }
+
+    uint64_t HeaderChecksum(const DatabaseHeader& header) {
+        DatabaseHeader copy = header;
+        copy.checksum = 0;
+        return Fnv1a(&copy, sizeof(copy));
+    }
+
+    inline uint64_t Align8(uint64_t value) {
+        return (value + 7) & ~static_cast<uint64_t>(7);
+    }
+
+    inline uint32_t ToV4(const uint8_t addr[16]) {
+        return (static_cast<uint32_t>(addr[0]) << 24) | (static_cast<uint32_t>(addr[1]) << 16) |
+               (static_cast<uint32_t>(addr[2]) << 8) | static_cast<uint32_t>(addr[3]);
+    }
+
+    // IPv6 build key; IPv4 keys are uint64_t so that last + 1 never overflows
+    struct V6Key {
+        uint8_t bytes[16];
+        bool operator<(const V6Key& other) const { return std::memcmp(bytes, other.bytes, 16) < 0; }
+        bool operator==(const V6Key& other) const { return std::memcmp(bytes, other.bytes, 16) == 0; }
+        bool operator<=(const V6Key& other) const { return !(other < *this); }
+    };
+
+    inline bool Next(uint64_t key, uint64_t& next) {
+        next = key + 1;
+        return true;
+    }
+
+    inline bool Next(const V6Key& key, V6Key& next) {
+        next = key;
+        for (int i = 15; i >= 0; --i) {
+            if (++next.bytes[i] != 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    template <typename Key>
+    struct Span {
+        Key first;
+        Key last;
+        uint32_t value;
+        uint32_t order;    // Input order; earlier sources win on overlap
+    };
+
+    template <typename Key>
+    void MakeDisjoint(std::vector<Span<Key>>& spans) {
+        std::sort(spans.begin(), spans.end(), [](const Span<Key>& a, const Span<Key>& b) {
+            return a.first < b.first || (a.first == b.first && a.order < b.order);
+        });
+        std::vector<Span<Key>> result;
+        result.reserve(spans.size());
+        for (auto span : spans) {
+            if (!result.empty() && span.first <= result.back().last) {
+                if (span.last <= result.back().last || !Next(result.back().last, span.first)) {
+                    continue;
+                }
+            }
+            result.push_back(span);
+        }
+        spans.swap(result);
+    }
+
+    // Value of the span covering point, advancing a forward-only cursor
+    template <typename Key>
+    uint32_t ValueAt(const std::vector<Span<Key>>& spans, size_t& cursor, const Key& point) {
+        while (cursor < spans.size() && spans[cursor].last < point) {
+            ++cursor;
+        }
+        return cursor < spans.size() && spans[cursor].first <= point ? spans[cursor].value : 0;
+    }
+
+    /**
+     * Merge the country and ASN span lists into boundary points, each mapped
+     * to a (country, ASN) record. Consecutive equal records collapse.
+     */
+    template <typename Key, typename RecordFor>
+    void BuildBoundaries(std::vector<Span<Key>>& countries, std::vector<Span<Key>>& asns,
+                         std::vector<Key>& starts, std::vector<uint32_t>& values, RecordFor recordFor) {
+        MakeDisjoint(countries);
+        MakeDisjoint(asns);
+
+        std::vector<Key> points;
+        points.reserve((countries.size() + asns.size()) * 2);
+        for (const auto* spans : {&countries, &asns}) {
+            for (const auto& span : *spans) {
+                points.push_back(span.first);
+                Key next;
+                if (Next(span.last, next)) {
+                    points.push_back(next);
+                }
+            }
+        }
+        std::sort(points.begin(), points.end());
+        points.erase(std::unique(points.begin(), points.end()), points.end());
+
+        size_t countryCursor = 0;
+        size_t asnCursor = 0;
+        uint32_t previous = 0;
+        for (const Key& point : points) {
+            uint32_t country = ValueAt(countries, countryCursor, point);
+            uint32_t asn = ValueAt(asns, asnCursor, point);
+            uint32_t record = (country || asn) ? recordFor(country, asn) : 0;
+            if (record != previous || starts.empty()) {
+                starts.push_back(point);
+                values.push_back(record);
+                previous = record;
+            }
+        }
+    }
+
+    // Split a CSV/TSV line, honouring double quotes
+    void SplitFields(const char* line, size_t length, std::vector<std::string>& fields) {
+        fields.clear();
+        std::string field;
+        bool quoted = false;
+        for (size_t i = 0; i < length; ++i) {
+            char c = line[i];
+            if (c == '"') {
+                quoted = !quoted;
+            } else if (!quoted && (c == ',' || c == '\t')) {
+                fields.push_back(Utils::Trim(field));
+                field.clear();
+            } else if (c != '\r') {
+                field += c;
+            }
+        }
+        fields.push_back(Utils::Trim(field));
+    }
+
+    // Parses "a.b.c.d/n" or a single address into an inclusive range
+    bool ParseRangeStart(const std::string& text, uint8_t first[16], uint8_t last[16], bool& isIPv6) {
+        std::string address = text;
+        int prefixLength = -1;
+        size_t slash = text.find('/');
+        if (slash != std::string::npos) {
+            address = text.substr(0, slash);
+            char* end = nullptr;
+            long value = std::strtol(text.c_str() + slash + 1, &end, 10);
+            if (end == text.c_str() + slash + 1 || *end != '\0' || value < 0) {
+                return false;
+            }
+            prefixLength = static_cast<int>(value);
+        }
+        if (!Utils::ParseIP(address, first, isIPv6)) {
+            return false;
+        }
+        int fullLength = isIPv6 ? 128 : 32;
+        if (prefixLength > fullLength) {
+            return false;
+        }
+        if (prefixLength < 0) {
+            prefixLength = fullLength;
+        }
+        int addressBytes = isIPv6 ? 16 : 4;
+        std::memcpy(last, first, 16);
+        for (int i = 0; i < addressBytes; ++i) {
+            int bits = prefixLength - i * 8;
+            if (bits <= 0) {
+                first[i] = 0;
+                last[i] = 0xFF;
+            } else if (bits < 8) {
+                first[i] = static_cast<uint8_t>(first[i] & (0xFF << (8 - bits)));
+                last[i] = static_cast<uint8_t>(first[i] | (0xFF >> bits));
+            }
+        }
+        return true;
+    }
+
+    uint64_t CacheSlot(const uint8_t addr[16], bool isIPv6) {
+        uint64_t lo;
+        uint64_t hi;
+        std::memcpy(&lo, addr, 8);
+        std::memcpy(&hi, addr + 8, 8);
+        uint64_t x = lo ^ (hi * 0x9e3779b97f4a7c15ULL) ^ (isIPv6 ? 1 : 0);
+        x ^= x >> 33;
+        x *= 0xff51afd7ed558ccdULL;
+        x ^= x >> 33;
+        return x & (CACHE_SLOTS - 1);
+    }
+
+    std::atomic<uint64_t> nextInstanceId(1);
+}
+
+struct GeoIpDatabase::Record {
+    char country[2];
+    uint16_t reserved;
+    uint32_t asn;
+    uint32_t organization;   // Offset into the string pool
+};
+
+GeoIpDatabase::GeoIpDatabase()
+    : v4Starts_(nullptr), v4Values_(nullptr), v4Jump_(nullptr), v6Starts_(nullptr), v6Values_(nullptr),
+      records_(nullptr), strings_(nullptr), v4Count_(0), v6Count_(0), recordCount_(0), stringsSize_(0),
+      instanceId_(0) {
+}
+
+GeoIpDatabase::~GeoIpDatabase() {
+}
+
+bool GeoIpDatabase::Compile(const std::vector<std::string>& sources, const std::string& databaseFile,
+                            CompileStats* stats, std::string* error) {
+    CompileStats localStats;
+    std::vector<Span<uint64_t>> v4Countries, v4Asns;
+    std::vector<Span<V6Key>> v6Countries, v6Asns;
+
+    // ASN entries are interned as (asn, organisation) pairs; span values are index + 1
+    std::vector<std::pair<uint32_t, uint32_t>> asnEntries;
+    std::map<std::pair<uint32_t, std::string>, uint32_t> asnIndex;
+    std::string strings(1, '\0');
+    std::map<std::string, uint32_t> stringIndex;
+    stringIndex[""] = 0;
+
+    uint32_t order = 0;
+    std::vector<std::string> fields;
+    for (const auto& source : sources) {
+        size_t colon = source.find(':');
+        std::string kind = colon == std::string::npos ? "" : source.substr(0, colon);
+        std::string path = colon == std::string::npos ? source : source.substr(colon + 1);
+        if (kind != "country" && kind != "asn") {
+            if (error) *error = "GeoIP source must be country:<file> or asn:<file>: " + source;
+            return false;
+        }
+        bool isCountry = kind == "country";
+
+        Utils::MappedFile input;
+        if (!input.Open(path)) {
+            if (error) *error = "Cannot open GeoIP source: " + path;
+            return false;
+        }
+
+        const char* data = reinterpret_cast<const char*>(input.Data());
+        size_t size = input.Size();
+        size_t lineStart = 0;
+        while (lineStart < size) {
+            const char* newline = static_cast<const char*>(std::memchr(data + lineStart, '\n', size - lineStart));
+            size_t lineEnd = newline ? static_cast<size_t>(newline - data) : size;
+            const char* line = data + lineStart;
+            size_t lineLength = lineEnd - lineStart;
+            lineStart = lineEnd + 1;
+            localStats.linesRead++;
+
+            if (lineLength == 0 || line[0] == '#') {
+                localStats.linesSkipped++;
+                continue;
+            }
+            SplitFields(line, lineLength, fields);
+
+            uint8_t first[16];
+            uint8_t last[16];
+            bool isIPv6 = false;
+            if (fields.size() < 2 || !ParseRangeStart(fields[0], first, last, isIPv6)) {
+                localStats.linesSkipped++;   // Header rows land here too
+                continue;
+            }
+            size_t next = 1;
+            uint8_t end[16];
+            bool endIsIPv6 = false;
+            if (fields[0].find('/') == std::string::npos && Utils::ParseIP(fields[1], end, endIsIPv6)) {
+                if (endIsIPv6 != isIPv6) {
+                    localStats.linesSkipped++;
+                    continue;
+                }
+                std::memcpy(last, end, 16);
+                next = 2;
+            }
+            if (std::memcmp(first, last, 16) > 0 || next >= fields.size()) {
+                localStats.linesSkipped++;
+                continue;
+            }
+
+            uint32_t value = 0;
+            if (isCountry) {
+                const std::string& code = fields[next];
+                if (code.size() != 2 || !std::isalpha(static_cast<unsigned char>(code[0])) ||
+                    !std::isalpha(static_cast<unsigned char>(code[1])) || code == "ZZ") {
+                    localStats.linesSkipped++;
+                    continue;
+                }
+                value = (static_cast<uint32_t>(std::toupper(code[0])) << 8) | static_cast<uint32_t>(std::toupper(code[1]));
+                localStats.countryRanges++;
+            } else {
+                std::string number = fields[next];
+                if (number.size() > 2 && (number[0] == 'A' || number[0] == 'a') && (number[1] == 'S' || number[1] == 's')) {
+                    number = number.substr(2);
+                }
+                char* parsed = nullptr;
+                unsigned long asn = std::strtoul(number.c_str(), &parsed, 10);
+                if (number.empty() || *parsed != '\0' || asn == 0 || asn > UINT32_MAX) {
+                    localStats.linesSkipped++;   // AS0 marks unrouted space in iptoasn
+                    continue;
+                }
+                // iptoasn rows carry a country code between the AS number and description
+                std::string organization;
+                if (fields.size() > next + 2 && fields[next + 1].size() <= 4) {
+                    organization = fields[next + 2];
+                } else if (fields.size() > next + 1) {
+                    organization = fields[next + 1];
+                }
+
+                auto key = std::make_pair(static_cast<uint32_t>(asn), organization);
+                auto it = asnIndex.find(key);
+                if (it == asnIndex.end()) {
+                    auto str = stringIndex.find(organization);
+                    if (str == stringIndex.end()) {
+                        str = stringIndex.emplace(organization, static_cast<uint32_t>(strings.size())).first;
+                        strings.append(organization);
+                        strings.push_back('\0');
+                    }
+                    asnEntries.emplace_back(static_cast<uint32_t>(asn), str->second);
+                    it = asnIndex.emplace(key, static_cast<uint32_t>(asnEntries.size())).first;
+                }
+                value = it->second;
+                localStats.asnRanges++;
+            }
+
+            if (isIPv6) {
+                Span<V6Key> span;
+                std::memcpy(span.first.bytes, first, 16);
+                std::memcpy(span.last.bytes, last, 16);
+                span.value = value;
+                span.order = order++;
+                (isCountry ? v6Countries : v6Asns).push_back(span);
+            } else {
+                Span<uint64_t> span{ToV4(first), ToV4(last), value, order++};
+                (isCountry ? v4Countries : v4Asns).push_back(span);
+            }
+        }
+    }
+
+    // Record 0 is "unknown"; others are unique (country, ASN entry) pairs
+    std::vector<Record> records(1);
+    std::memset(&records[0], 0, sizeof(Record));
+    std::map<std::pair<uint32_t, uint32_t>, uint32_t> recordIndex;
+    auto recordFor = [&](uint32_t country, uint32_t asn) {
+        auto key = std::make_pair(country, asn);
+        auto it = recordIndex.find(key);
+        if (it != recordIndex.end()) {
+            return it->second;
+        }
+        Record record;
+        record.country[0] = static_cast<char>(country >> 8);
+        record.country[1] = static_cast<char>(country & 0xFF);
+        record.reserved = 0;
+        record.asn = asn ? asnEntries[asn - 1].first : 0;
+        record.organization = asn ? asnEntries[asn - 1].second : 0;
+        records.push_back(record);
+        uint32_t index = static_cast<uint32_t>(records.size() - 1);
+        recordIndex.emplace(key, index);
+        return index;
+    };
+
+    std::vector<uint64_t> v4Points;
+    std::vector<uint32_t> v4Values;
+    BuildBoundaries(v4Countries, v4Asns, v4Points, v4Values, recordFor);
+    std::vector<V6Key> v6Points;
+    std::vector<uint32_t> v6Values;
+    BuildBoundaries(v6Countries, v6Asns, v6Points, v6Values, recordFor);
+
+    std::vector<uint32_t> v4Starts(v4Points.begin(), v4Points.end());
+    std::vector<uint32_t> v4Jump(V4_JUMP_ENTRIES);
+    size_t boundary = 0;
+    for (size_t block = 0; block < V4_JUMP_ENTRIES; ++block) {
+        uint64_t blockStart = static_cast<uint64_t>(block) << 16;
+        while (boundary < v4Starts.size() && v4Starts[boundary] < blockStart) {
+            ++boundary;
+        }
+        v4Jump[block] = static_cast<uint32_t>(boundary);
+    }
+
+    DatabaseHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, DATABASE_MAGIC, sizeof(DATABASE_MAGIC));
+    header.version = DATABASE_VERSION;
+    header.headerSize = sizeof(DatabaseHeader);
+    header.v4Count = v4Starts.size();
+    header.v4StartsOffset = Align8(sizeof(DatabaseHeader));
+    header.v4ValuesOffset = Align8(header.v4StartsOffset + header.v4Count * sizeof(uint32_t));
+    header.v4JumpOffset = Align8(header.v4ValuesOffset + header.v4Count * sizeof(uint32_t));
+    header.v6Count = v6Points.size();
+    header.v6StartsOffset = Align8(header.v4JumpOffset + V4_JUMP_ENTRIES * sizeof(uint32_t));
+    header.v6ValuesOffset = Align8(header.v6StartsOffset + header.v6Count * 16);
+    header.recordCount = records.size();
+    header.recordsOffset = Align8(header.v6ValuesOffset + header.v6Count * sizeof(uint32_t));
+    header.stringsSize = strings.size();
+    header.stringsOffset = header.recordsOffset + header.recordCount * sizeof(Record);
+    header.fileSize = header.stringsOffset + header.stringsSize;
+    header.checksum = HeaderChecksum(header);
+
+    std::string tempFile = databaseFile + ".tmp";
+    {
+        std::ofstream out(tempFile, std::ios::binary | std::ios::trunc);
+        if (!out.is_open()) {
+            if (error) *error = "Cannot create GeoIP database: " + tempFile;
+            return false;
+        }
+
+        const char padding[8] = {0};
+        auto padTo = [&out, &padding](uint64_t offset) {
+            uint64_t current = static_cast<uint64_t>(out.tellp());
+            if (offset > current) {
+                out.write(padding, static_cast<std::streamsize>(offset - current));
+            }
+        };
+        auto write = [&out](const void* data, size_t length) {
+            out.write(static_cast<const char*>(data), static_cast<std::streamsize>(length));
+        };
+
+        write(&header, sizeof(header));
+        padTo(header.v4StartsOffset);
+        write(v4Starts.data(), v4Starts.size() * sizeof(uint32_t));
+        padTo(header.v4ValuesOffset);
+        write(v4Values.data(), v4Values.size() * sizeof(uint32_t));
+        padTo(header.v4JumpOffset);
+        write(v4Jump.data(), v4Jump.size() * sizeof(uint32_t));
+        padTo(header.v6StartsOffset);
+        for (const auto& point : v6Points) {
+            write(point.bytes, 16);
+        }
+        padTo(header.v6ValuesOffset);
+        write(v6Values.data(), v6Values.size() * sizeof(uint32_t));
+        padTo(header.recordsOffset);
+        write(records.data(), records.size() * sizeof(Record));
+        write(strings.data(), strings.size());
+
+        if (!out.good()) {
+            if (error) *error = "Failed to write GeoIP database: " + tempFile;
+            out.close();
+            std::remove(tempFile.c_str());
+            return false;
+        }
+    }
+
+#ifdef _WIN32
+    std::remove(databaseFile.c_str());
+#endif
+    if (std::rename(tempFile.c_str(), databaseFile.c_str()) != 0) {
+        if (error) *error = "Failed to move GeoIP database into place: " + databaseFile;
+        std::remove(tempFile.c_str());
+        return false;
+    }
+
+    localStats.v4Boundaries = v4Starts.size();
+    localStats.v6Boundaries = v6Points.size();
+    localStats.records = records.size() - 1;
+    if (stats) {
+        *stats = localStats;
+    }
+    return true;
+}
+
+bool GeoIpDatabase::Open(const std::string& databaseFile) {
+    if (!file_.Open(databaseFile)) {
+        lastError_ = "Cannot open GeoIP database: " + databaseFile;
+        return false;
+    }
+
+    DatabaseHeader header;
+    if (file_.Size() < sizeof(header)) {
+        lastError_ = "GeoIP database too small: " + databaseFile;
+        file_.Close();
+        return false;
+    }
+    std::memcpy(&header, file_.Data(), sizeof(header));
+
+    bool valid = std::memcmp(header.magic, DATABASE_MAGIC, sizeof(DATABASE_MAGIC)) == 0 &&
+                 header.version == DATABASE_VERSION &&
+                 header.headerSize == sizeof(DatabaseHeader) &&
+                 header.checksum == HeaderChecksum(header) &&
+                 header.fileSize == file_.Size() &&
+                 header.recordCount > 0 && header.stringsSize > 0 &&
+                 header.v4StartsOffset + header.v4Count * sizeof(uint32_t) <= header.v4ValuesOffset &&
+                 header.v4ValuesOffset + header.v4Count * sizeof(uint32_t) <= header.v4JumpOffset &&
+                 header.v4JumpOffset + V4_JUMP_ENTRIES * sizeof(uint32_t) <= header.v6StartsOffset &&
+                 header.v6StartsOffset + header.v6Count * 16 <= header.v6ValuesOffset &&
+                 header.v6ValuesOffset + header.v6Count * sizeof(uint32_t) <= header.recordsOffset &&
+                 header.recordsOffset + header.recordCount * sizeof(Record) <= header.stringsOffset &&
+                 header.stringsOffset + header.stringsSize <= header.fileSize;
+    if (valid) {
+        // Lookup trusts the jump table for its search bounds, so every entry
+        // must be in order and inside the v4 boundary list
+        const uint32_t* jump = reinterpret_cast<const uint32_t*>(file_.Data() + header.v4JumpOffset);
+        for (size_t block = 0; block < V4_JUMP_ENTRIES && valid; ++block) {
+            valid = jump[block] <= header.v4Count && (block == 0 || jump[block - 1] <= jump[block]);
+        }
+    }
+    if (!valid) {
+        lastError_ = "Corrupt or incompatible GeoIP database: " + databaseFile;
+        file_.Close();
+        return false;
+    }
+
+    const uint8_t* base = file_.Data();
+    v4Starts_ = reinterpret_cast<const uint32_t*>(base + header.v4StartsOffset);
+    v4Values_ = reinterpret_cast<const uint32_t*>(base + header.v4ValuesOffset);
+    v4Jump_ = reinterpret_cast<const uint32_t*>(base + header.v4JumpOffset);
+    v6Starts_ = base + header.v6StartsOffset;
+    v6Values_ = reinterpret_cast<const uint32_t*>(base + header.v6ValuesOffset);
+    records_ = reinterpret_cast<const Record*>(base + header.recordsOffset);
+    strings_ = reinterpret_cast<const char*>(base + header.stringsOffset);
+    v4Count_ = header.v4Count;
+    v6Count_ = header.v6Count;
+    recordCount_ = header.recordCount;
+    stringsSize_ = header.stringsSize;
+    instanceId_ = nextInstanceId++;
+    return true;
+}
+
+bool GeoIpDatabase::Fill(uint32_t value, GeoInfo& info) const {
+    info = GeoInfo();
+    if (value == 0 || value >= recordCount_) {
+        return false;
+    }
+    const Record& record = records_[value];
+    info.country[0] = record.country[0];
+    info.country[1] = record.country[1];
+    info.asn = record.asn;
+    // The pool is NUL-terminated at the end, so any in-range offset is a valid C string
+    if (record.organization < stringsSize_ && strings_[stringsSize_ - 1] == '\0') {
+        info.organization = strings_ + record.organization;
+    }
+    return true;
+}
+
+bool GeoIpDatabase::Lookup(const uint8_t addr[16], bool isIPv6, GeoInfo& info) const {
+    if (!IsOpen()) {
+        info = GeoInfo();
+        return false;
+    }
+
+    uint32_t value = 0;
+    if (isIPv6) {
+        // Last boundary whose start <= addr
+        size_t low = 0;
+        size_t high = v6Count_;
+        while (low < high) {
+            size_t mid = low + (high - low) / 2;
+            if (std::memcmp(v6Starts_ + mid * 16, addr, 16) <= 0) {
+                low = mid + 1;
+            } else {
+                high = mid;
+            }
+        }
+        value = low > 0 ? v6Values_[low - 1] : 0;
+    } else {
+        uint32_t address = ToV4(addr);
+        uint32_t block = address >> 16;
+        const uint32_t* begin = v4Starts_ + v4Jump_[block];
+        const uint32_t* end = v4Starts_ + v4Jump_[block + 1];
+        const uint32_t* it = std::upper_bound(begin, end, address);
+        // it == begin falls back to the last boundary of an earlier block
+        size_t index = static_cast<size_t>(it - v4Starts_);
+        value = index > 0 && index <= v4Count_ ? v4Values_[index - 1] : 0;
+    }
+    return Fill(value, info);
+}
+
+bool GeoIpDatabase::Lookup(const std::string& ip, GeoInfo& info) const {
+    uint8_t addr[16];
+    bool isIPv6 = false;
+    if (!Utils::ParseIP(ip, addr, isIPv6)) {
+        info = GeoInfo();
+        return false;
+    }
+    return LookupCached(addr, isIPv6, info);
+}
+
+bool GeoIpDatabase::LookupCached(const uint8_t addr[16], bool isIPv6, GeoInfo& info) const {
+    struct Slot {
+        uint64_t instance;
+        uint8_t addr[16];
+        bool isIPv6;
+        bool found;
+        GeoInfo info;
+    };
+    thread_local Slot cache[CACHE_SLOTS];
+
+    Slot& slot = cache[CacheSlot(addr, isIPv6)];
+    if (slot.instance == instanceId_ && instanceId_ != 0 && slot.isIPv6 == isIPv6 &&
+        std::memcmp(slot.addr, addr, 16) == 0) {
+        info = slot.info;
+        return slot.found;
+    }
+
+    bool found = Lookup(addr, isIPv6, info);
+    slot.instance = instanceId_;
+    std::memcpy(slot.addr, addr, 16);
+    slot.isIPv6 = isIPv6;
+    slot.found = found;
+    slot.info = info;
+    return found;
+}
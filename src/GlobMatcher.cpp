@@ -0,0 +1,182 @@
+#include "GlobMatcher.h"
+#include <cstring>
+
+GlobMatcher::GlobMatcher() : patternCount_(0) {
+}
+
+GlobMatcher::GlobMatcher(const std::vector<std::string>& patterns) : patternCount_(0) {
+    for (const auto& pattern : patterns) {
+        Add(pattern);
+    }
+}
+
+bool GlobMatcher::Compile(const std::string& pattern, Program& program) {
+    program.clear();
+    for (size_t i = 0; i < pattern.size(); ++i) {
+        char c = pattern[i];
+        if (c == '*') {
+            bool path = i + 1 < pattern.size() && pattern[i + 1] == '*';
+            if (path) {
+                ++i;
+                // "**/" also matches no directories at all
+                if (i + 1 < pattern.size() && pattern[i + 1] == '/') {
+                    ++i;
+                    program.push_back(Token{Token::AnyPath, "/", {}});
+                    continue;
+                }
+            }
+            program.push_back(Token{path ? Token::AnyPath : Token::Any, "", {}});
+        } else if (c == '?') {
+            program.push_back(Token{Token::One, "", {}});
+        } else if (c == '[') {
+            size_t j = i + 1;
+            bool negate = j < pattern.size() && (pattern[j] == '!' || pattern[j] == '^');
+            if (negate) {
+                ++j;
+            }
+            std::bitset<256> set;
+            bool first = true;
+            for (; j < pattern.size() && (first || pattern[j] != ']'); ++j, first = false) {
+                unsigned char low = static_cast<unsigned char>(pattern[j]);
+                unsigned char high = low;
+                if (j + 2 < pattern.size() && pattern[j + 1] == '-' && pattern[j + 2] != ']') {
+                    high = static_cast<unsigned char>(pattern[j + 2]);
+                    j += 2;
+                }
+                for (unsigned value = low; value <= high; ++value) {
+                    set.set(value);
+                }
+            }
+            if (j >= pattern.size()) {
+                return false;
+            }
+            if (negate) {
+                set.flip();
+            }
+            set.reset('/');
+            program.push_back(Token{Token::Class, "", set});
+            i = j;
+        } else {
+            if (c == '\\' && i + 1 < pattern.size()) {
+                c = pattern[++i];
+            }
+            if (program.empty() || program.back().kind != Token::Literal) {
+                program.push_back(Token{Token::Literal, "", {}});
+            }
+            program.back().text += c;
+        }
+    }
+    return !program.empty();
+}
+
+bool GlobMatcher::Add(const std::string& pattern) {
+    std::string trimmed = pattern;
+    while (!trimmed.empty() && trimmed[0] == '/') {
+        trimmed.erase(0, 1);
+    }
+    if (trimmed.size() >= 2 && trimmed.compare(0, 2, "./") == 0) {
+        trimmed.erase(0, 2);
+    }
+    Program program;
+    if (!Compile(trimmed, program)) {
+        return false;
+    }
+    patternCount_++;
+
+    if (trimmed.find('/') != std::string::npos) {
+        pathPrograms_.push_back(std::move(program));
+    } else if (program.size() == 1 && program[0].kind == Token::Literal) {
+        names_.insert(program[0].text);
+    } else if (program.size() == 2 && program[0].kind == Token::Any && program[1].kind == Token::Literal &&
+               program[1].text[0] == '.' && program[1].text.find('.', 1) == std::string::npos) {
+        extensions_.insert(program[1].text);
+    } else {
+        namePrograms_.push_back(std::move(program));
+    }
+    return true;
+}
+
+bool GlobMatcher::Run(const Program& program, size_t token, const char* text, size_t length, size_t position) {
+    for (; token < program.size(); ++token) {
+        const Token& current = program[token];
+        switch (current.kind) {
+            case Token::Literal:
+                if (length - position < current.text.size() ||
+                    std::memcmp(text + position, current.text.data(), current.text.size()) != 0) {
+                    return false;
+                }
+                position += current.text.size();
+                break;
+            case Token::One:
+                if (position >= length || text[position] == '/') {
+                    return false;
+                }
+                ++position;
+                break;
+            case Token::Class:
+                if (position >= length || !current.set.test(static_cast<unsigned char>(text[position]))) {
+                    return false;
+                }
+                ++position;
+                break;
+            case Token::Any:
+            case Token::AnyPath:
+                // Try every split point, shortest first; '*' stops at a separator
+                for (size_t end = position; end <= length; ++end) {
+                    if (current.text == "/" && end > position && text[end - 1] != '/') {
+                        continue;   // "**/" consumes whole directories only
+                    }
+                    if (Run(program, token + 1, text, length, end)) {
+                        return true;
+                    }
+                    if (end < length && current.kind == Token::Any && text[end] == '/') {
+                        break;
+                    }
+                }
+                return false;
+        }
+    }
+    return position == length;
+}
+
+bool GlobMatcher::Matches(const std::string& relativePath) const {
+    return Matches(relativePath.data(), relativePath.size());
+}
+
+bool GlobMatcher::Matches(const char* relativePath, size_t length) const {
+    if (patternCount_ == 0) {
+        return false;
+    }
+    size_t nameStart = length;
+    while (nameStart > 0 && relativePath[nameStart - 1] != '/') {
+        --nameStart;
+    }
+    const char* name = relativePath + nameStart;
+    size_t nameLength = length - nameStart;
+
+    if (!names_.empty() && names_.count(std::string(name, nameLength))) {
+        return true;
+    }
+    if (!extensions_.empty()) {
+        const char* dot = static_cast<const char*>(std::memchr(name, '.', nameLength));
+        // Only the last extension counts: "a.tar.gz" is "*.gz"
+        for (const char* next = dot; next; next = static_cast<const char*>(
+                 std::memchr(next + 1, '.', nameLength - (next + 1 - name)))) {
+            dot = next;
+        }
+        if (dot && extensions_.count(std::string(dot, nameLength - (dot - name)))) {
+            return true;
+        }
+    }
+    for (const auto& program : namePrograms_) {
+        if (Run(program, 0, name, nameLength, 0)) {
+            return true;
+        }
+    }
+    for (const auto& program : pathPrograms_) {
+        if (Run(program, 0, relativePath, length, 0)) {
+            return true;
+        }
+    }
+    return false;
+}
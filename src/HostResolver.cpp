@@ -0,0 +1,311 @@
+#include "HostResolver.h"
+#include "Utils.h"
+#include <algorithm>
+#include <sstream>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netdb.h>
+#endif
+#include <cstring>
+
+namespace {
+    // Canonical text form so "::0001" and "::1" share a cache entry
+    bool NormalizeAddress(const std::string& ip, std::string& normalized) {
+        uint8_t addr[16];
+        bool isIPv6 = false;
+        if (!Utils::ParseIP(ip, addr, isIPv6)) {
+            return false;
+        }
+        normalized = Utils::FormatIP(addr, isIPv6);
+        return !normalized.empty();
+    }
+}
+
+HostResolver::HostResolver(const Options& options)
+    : options_(options), inFlight_(0), stopping_(false),
+      cacheHits_(0), negativeHits_(0), pendingHits_(0), resolved_(0), failed_(0), dropped_(0) {
+    if (options_.maxInFlight == 0) {
+        options_.maxInFlight = 1;
+    }
+    shardCapacity_ = std::max<size_t>(1, options_.cacheCapacity / SHARD_COUNT);
+
+    if (options_.useSystemResolver) {
+        resolver_ = &HostResolver::SystemResolve;
+    }
+    ReloadHostsFile();
+
+    for (size_t i = 0; i < options_.maxInFlight; ++i) {
+        workers_.emplace_back(&HostResolver::WorkerLoop, this);
+    }
+}
+
+HostResolver::~HostResolver() {
+    {
+        std::lock_guard<std::mutex> lock(queueMutex_);
+        stopping_ = true;
+        queue_.clear();
+    }
+    queueCondition_.notify_all();
+    for (auto& worker : workers_) {
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+}
+
+HostResolver& HostResolver::Instance() {
+    static HostResolver instance;
+    return instance;
+}
+
+HostResolver::Shard& HostResolver::ShardFor(const std::string& key) {
+    return shards_[std::hash<std::string>()(key) % SHARD_COUNT];
+}
+
+HostResolver::Result HostResolver::Lookup(const std::string& ip) {
+    std::string key;
+    if (!NormalizeAddress(ip, key)) {
+        return Result{Status::NotFound, ""};
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    Shard& shard = ShardFor(key);
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto it = shard.index.find(key);
+        if (it != shard.index.end()) {
+            CacheEntry& entry = *it->second;
+            if (entry.state == EntryState::Pending) {
+                pendingHits_++;
+                return Result{Status::Pending, ""};
+            }
+            if (entry.expires > now) {
+                shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+                if (entry.state == EntryState::Resolved) {
+                    cacheHits_++;
+                    return Result{Status::Resolved, entry.hostname};
+                }
+                negativeHits_++;
+                return Result{Status::NotFound, ""};
+            }
+            // Expired: fall through and refresh it
+            shard.lru.erase(it->second);
+            shard.index.erase(it);
+        }
+
+        // Mark pending before queueing so concurrent callers do not enqueue twice
+        shard.lru.push_front(CacheEntry{key, "", EntryState::Pending, now});
+        shard.index[key] = shard.lru.begin();
+    }
+
+    bool queued = false;
+    {
+        std::lock_guard<std::mutex> lock(queueMutex_);
+        if (!stopping_ && queue_.size() < options_.maxQueued) {
+            queue_.push_back(key);
+            queued = true;
+        }
+    }
+
+    if (!queued) {
+        dropped_++;
+        Forget(key);
+        return Result{Status::Pending, ""};
+    }
+
+    queueCondition_.notify_one();
+    return Result{Status::Pending, ""};
+}
+
+void HostResolver::Store(const std::string& key, const std::string& hostname, EntryState state,
+                         std::chrono::steady_clock::duration ttl) {
+    Shard& shard = ShardFor(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    auto it = shard.index.find(key);
+    if (it != shard.index.end()) {
+        shard.lru.erase(it->second);
+        shard.index.erase(it);
+    }
+
+    shard.lru.push_front(CacheEntry{key, hostname, state, std::chrono::steady_clock::now() + ttl});
+    shard.index[key] = shard.lru.begin();
+
+    // Evict least recently used, skipping entries still being resolved
+    auto victim = shard.lru.end();
+    while (shard.index.size() > shardCapacity_ && victim != shard.lru.begin()) {
+        --victim;
+        if (victim->state == EntryState::Pending) {
+            continue;
+        }
+        shard.index.erase(victim->key);
+        victim = shard.lru.erase(victim);
+    }
+}
+
+void HostResolver::Forget(const std::string& key) {
+    Shard& shard = ShardFor(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.index.find(key);
+    if (it != shard.index.end()) {
+        shard.lru.erase(it->second);
+        shard.index.erase(it);
+    }
+}
+
+void HostResolver::WorkerLoop() {
+    while (true) {
+        std::string key;
+        {
+            std::unique_lock<std::mutex> lock(queueMutex_);
+            queueCondition_.wait(lock, [this] { return stopping_ || !queue_.empty(); });
+            if (stopping_) {
+                return;
+            }
+            key = queue_.front();
+            queue_.pop_front();
+            inFlight_++;
+        }
+
+        std::string hostname;
+        if (ResolveAddress(key, hostname)) {
+            resolved_++;
+            Store(key, hostname, EntryState::Resolved, options_.positiveTtl);
+        } else {
+            failed_++;
+            Store(key, "", EntryState::NotFound, options_.negativeTtl);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(queueMutex_);
+            inFlight_--;
+            if (queue_.empty() && inFlight_ == 0) {
+                idleCondition_.notify_all();
+            }
+        }
+    }
+}
+
+bool HostResolver::ResolveAddress(const std::string& ip, std::string& hostname) {
+    ResolveFunction resolver;
+    {
+        std::lock_guard<std::mutex> lock(resolverMutex_);
+        auto it = hosts_.find(ip);
+        if (it != hosts_.end()) {
+            hostname = it->second;
+            return true;
+        }
+        resolver = resolver_;
+    }
+    return resolver && resolver(ip, hostname) && !hostname.empty();
+}
+
+bool HostResolver::SystemResolve(const std::string& ip, std::string& hostname) {
+#ifdef _WIN32
+    static bool winsockReady = [] {
+        WSADATA data;
+        return WSAStartup(MAKEWORD(2, 2), &data) == 0;
+    }();
+    if (!winsockReady) {
+        return false;
+    }
+#endif
+    uint8_t addr[16];
+    bool isIPv6 = false;
+    if (!Utils::ParseIP(ip, addr, isIPv6)) {
+        return false;
+    }
+
+    sockaddr_storage storage;
+    std::memset(&storage, 0, sizeof(storage));
+    socklen_t length;
+    if (isIPv6) {
+        auto* sin6 = reinterpret_cast<sockaddr_in6*>(&storage);
+        sin6->sin6_family = AF_INET6;
+        std::memcpy(&sin6->sin6_addr, addr, 16);
+        length = sizeof(sockaddr_in6);
+    } else {
+        auto* sin = reinterpret_cast<sockaddr_in*>(&storage);
+        sin->sin_family = AF_INET;
+        std::memcpy(&sin->sin_addr, addr, 4);
+        length = sizeof(sockaddr_in);
+    }
+
+    char host[NI_MAXHOST] = "";
+    if (getnameinfo(reinterpret_cast<sockaddr*>(&storage), length, host, sizeof(host),
+                    nullptr, 0, NI_NAMEREQD) != 0) {
+        return false;
+    }
+    hostname = host;
+    return true;
+}
+
+void HostResolver::SetResolveFunction(ResolveFunction resolver) {
+    std::lock_guard<std::mutex> lock(resolverMutex_);
+    resolver_ = std::move(resolver);
+}
+
+bool HostResolver::ReloadHostsFile() {
+    std::map<std::string, std::string> hosts;
+    bool loaded = false;
+
+    if (!options_.hostsFile.empty() && Utils::FileExists(options_.hostsFile)) {
+        std::istringstream stream(Utils::ReadFile(options_.hostsFile));
+        std::string line;
+        while (std::getline(stream, line)) {
+            size_t comment = line.find('#');
+            if (comment != std::string::npos) {
+                line.erase(comment);
+            }
+            std::istringstream fields(line);
+            std::string address;
+            std::string name;
+            std::string key;
+            if (fields >> address >> name && NormalizeAddress(address, key)) {
+                // The first name listed for an address is the canonical one
+                hosts.emplace(key, name);
+            }
+        }
+        loaded = true;
+    }
+
+    std::lock_guard<std::mutex> lock(resolverMutex_);
+    hosts_.swap(hosts);
+    return loaded;
+}
+
+bool HostResolver::WaitForIdle(std::chrono::milliseconds timeout) {
+    std::unique_lock<std::mutex> lock(queueMutex_);
+    return idleCondition_.wait_for(lock, timeout, [this] { return queue_.empty() && inFlight_ == 0; });
+}
+
+void HostResolver::ClearCache() {
+    for (auto& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        // Keep pending markers so in-flight results still land
+        for (auto it = shard.lru.begin(); it != shard.lru.end();) {
+            if (it->state == EntryState::Pending) {
+                ++it;
+            } else {
+                shard.index.erase(it->key);
+                it = shard.lru.erase(it);
+            }
+        }
+    }
+}
+
+HostResolver::Statistics HostResolver::GetStatistics() const {
+    Statistics stats;
+    stats.cacheHits = cacheHits_.load();
+    stats.negativeHits = negativeHits_.load();
+    stats.pendingHits = pendingHits_.load();
+    stats.resolved = resolved_.load();
+    stats.failed = failed_.load();
+    stats.dropped = dropped_.load();
+    return stats;
+}
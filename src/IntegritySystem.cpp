@@ -1,9 +1,27 @@
 #include "IntegritySystem.h"
+#include "BaselineIndex.h"
+#include "Blake3.h"
+#include "FingerprintCache.h"
+#include "JsonReporting.h"
+#include "ResourceGovernor.h"
+#include "Sha256.h"
+#include "UringFileReader.h"
 #include "Utils.h"
+#include "WorkStealingPool.h"
 #include <iostream>
 #include <fstream>
 #include <sstream>
 #include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <atomic>
+#include <mutex>
+#include <memory>
+#include <new>
+#include <thread>
+#include <unordered_map>
 #include <unordered_set>
 
 #ifdef _WIN32
@@ -16,10 +34,69 @@
 
 namespace IntegritySystem {
     
+    // Files at least this large are memory-mapped instead of read
+    static const size_t kMapThreshold = 8 * 1024 * 1024;
+    static const size_t kReadChunk = 1024 * 1024;
+    static const size_t kReadAlignment = 4096;
+    
+    struct AlignedBuffer {
+        uint8_t* data;
+        AlignedBuffer() : data(static_cast<uint8_t*>(::operator new(kReadChunk, std::align_val_t(kReadAlignment)))) {}
+        ~AlignedBuffer() { ::operator delete(data, std::align_val_t(kReadAlignment)); }
+    };
+    
+    // Verification work units: small files are read whole and hashed together,
+    // large files are hashed in chunk tasks so no single file pins a worker
+    static const size_t kFilesPerTask = 64;
+    static const uint64_t kBatchedFileLimit = 64 * 1024;
+    static const uint64_t kChunkedFileThreshold = 64 * 1024 * 1024;
+    static const size_t kHashChunk = 8 * 1024 * 1024;
+    
     static std::vector<FileInfo> monitoredFiles;
+    static std::unordered_map<std::string, size_t> monitoredIndex;
+    
+    // A binary baseline stays mapped. Once materialized its entries are monitoredFiles[0, count)
+    // in path order and are found by binary search; monitoredIndex holds only the other files.
+    static BaselineIndex baseline;
+    static std::string baselinePath;
+    static bool baselinePending = false;                          // Mapped, entries not yet in monitoredFiles
+    static std::unordered_map<uint64_t, std::string> baselineOverrides;  // Hashes given after loading
+    
+    static FingerprintCache fingerprintCache;
+    static bool fingerprintCacheConfigured = false;
+    static std::string fingerprintCacheFile;
+    static std::chrono::hours fullRehashInterval(24);
+    static bool fullRehashRequested = false;
+    static bool useBirthTime = true;
+    
+    // Baseline and last verified trees of Merkle files, by path
+    struct MerkleEntry {
+        std::shared_ptr<const MerkleTree> expected;
+        std::shared_ptr<const MerkleTree> current;
+    };
+    static std::unordered_map<std::string, MerkleEntry> merkleTrees;
+    static std::mutex merkleMutex;
+    static bool merkleConfigured = false;
+    static uint64_t merkleMinSize = 0;
+    static size_t merkleChunkSize = MerkleTree::DefaultChunkSize;
+    
+    // Small files are read through io_uring where the kernel allows it; the reader and its
+    // registered buffers are kept from one pass to the next
+    static std::unique_ptr<UringFileReader> uringReader;
+    static bool uringConfigured = false;
+    static bool uringEnabled = true;
+    static unsigned uringQueueDepth = 128;
+    static bool uringUnavailable = false;
+    static bool hashAlgorithmConfigured = false;
+    static HashAlgorithm hashAlgorithm = HashAlgorithm::Sha256;
     static bool initialized = false;
     
+    // Held by every pass and every change to the state above, so the integrity watcher's
+    // thread and UI-driven calls never interleave; pool workers never take it
+    static std::recursive_mutex stateMutex;
+    
     bool Initialize() {
+        std::lock_guard<std::recursive_mutex> stateLock(stateMutex);
         if (initialized) {
             return true;
         }
@@ -31,75 +108,1179 @@ namespace IntegritySystem {
             AddFileToCheck(file);
         }
         
+        TreeWalker::Statistics walk;
+        if (AddConfiguredScanPaths(&walk) > 0) {
+            std::cout << "Integrity scan paths: " << walk.files << " files in " << walk.directories
+                      << " directories (" << static_cast<uint64_t>(walk.FilesPerSecond()) << " files/sec, "
+                      << walk.excluded << " excluded)" << std::endl;
+        }
+        
         // Try to load existing baseline
         LoadBaseline();
         
         initialized = true;
-        std::cout << "Integrity system initialized with " << monitoredFiles.size() 
+        std::cout << "Integrity system initialized with "
+                  << monitoredFiles.size() + (baselinePending ? baseline.GetCount() : 0)
                   << " files under monitoring." << std::endl;
         
         return true;
     }
     
+    size_t AddScanPaths(const std::vector<std::string>& roots, const std::vector<std::string>& excludePatterns,
+                        bool oneFileSystem, TreeWalker::Statistics* stats) {
+        GlobMatcher excludes;
+        for (const auto& pattern : excludePatterns) {
+            if (!excludes.Add(pattern)) {
+                std::cerr << "Integrity: ignoring invalid exclude pattern '" << pattern << "'" << std::endl;
+            }
+        }
+        TreeWalker::Options options;
+        options.oneFileSystem = oneFileSystem;
+        TreeWalker walker(options);
+        walker.SetExcludes(excludes);
+        
+        std::vector<std::string> files = walker.Walk(roots, stats);
+        for (const auto& file : files) {
+            AddFileToCheck(file);
+        }
+        return files.size();
+    }
+    
+    size_t AddConfiguredScanPaths(TreeWalker::Statistics* stats) {
+        const auto& config = Utils::Config::Instance();
+        std::vector<std::string> roots = config.GetStringArray("checks.file_integrity", "scan_paths");
+        if (roots.empty()) {
+            return 0;
+        }
+        const char* home = std::getenv("HOME");
+        for (auto& root : roots) {
+            if (home && !root.empty() && root[0] == '~') {
+                root = home + root.substr(1);
+            }
+        }
+        return AddScanPaths(roots, config.GetStringArray("checks.file_integrity", "exclude_patterns"),
+                            config.GetBool("checks.file_integrity", "one_filesystem", true), stats);
+    }
+    
+    // A serialized tree is kept aside; the monitored entry holds the tree's id
+    static std::string AdoptExpectedHash(const std::string& filePath, const std::string& expectedHash) {
+        if (!MerkleTree::IsMerkleId(expectedHash)) {
+            return expectedHash;
+        }
+        auto tree = std::make_shared<MerkleTree>();
+        if (!MerkleTree::Parse(expectedHash, *tree)) {
+            return expectedHash;
+        }
+        std::lock_guard<std::mutex> lock(merkleMutex);
+        merkleTrees[filePath].expected = tree;
+        return tree->GetId();
+    }
+    
+    // Copies a pending baseline into monitoredFiles; files added before it was loaded follow it
+    static void MaterializeBaseline() {
+        if (!baselinePending) {
+            return;
+        }
+        baselinePending = false;
+        std::vector<FileInfo> others;
+        others.swap(monitoredFiles);
+        monitoredFiles.reserve(baseline.GetCount() + others.size());
+        baseline.ForEach([](const BaselineIndex::Entry& entry) {
+            auto override = baselineOverrides.find(monitoredFiles.size());
+            const std::string& hash = override == baselineOverrides.end() ? entry.hash : override->second;
+            monitoredFiles.emplace_back(entry.path, AdoptExpectedHash(entry.path, hash));
+        });
+        baselineOverrides.clear();
+        
+        monitoredIndex.clear();
+        BaselineIndex::Entry entry;
+        for (auto& file : others) {
+            // As with text baselines, the baseline's hash replaces one given earlier
+            if (!baseline.Find(file.path, entry)) {
+                monitoredIndex.emplace(file.path, monitoredFiles.size());
+                monitoredFiles.push_back(std::move(file));
+            }
+        }
+    }
+    
+    // Position of a monitored path in monitoredFiles; the baseline must be materialized
+    static bool FindMonitored(const std::string& filePath, size_t& index) {
+        BaselineIndex::Entry entry;
+        uint64_t ordinal = 0;
+        if (baseline.IsOpen() && baseline.Find(filePath, entry, &ordinal)) {
+            index = static_cast<size_t>(ordinal);
+            return true;
+        }
+        auto it = monitoredIndex.find(filePath);
+        if (it == monitoredIndex.end()) {
+            return false;
+        }
+        index = it->second;
+        return true;
+    }
+    
     void AddFileToCheck(const std::string& filePath, const std::string& expectedHash) {
-        // Check if file already exists in the list
-        for (auto& file : monitoredFiles) {
-            if (file.path == filePath) {
-                if (!expectedHash.empty()) {
-                    file.expectedHash = expectedHash;
-                }
+        std::lock_guard<std::recursive_mutex> stateLock(stateMutex);
+        std::string hash = AdoptExpectedHash(filePath, expectedHash);
+        
+        // Entries of a mapped baseline are updated in place, or once they are materialized
+        BaselineIndex::Entry entry;
+        uint64_t ordinal = 0;
+        if (baseline.IsOpen() && baseline.Find(filePath, entry, &ordinal)) {
+            if (hash.empty()) {
                 return;
             }
+            if (baselinePending) {
+                baselineOverrides[ordinal] = hash;
+            } else {
+                monitoredFiles[static_cast<size_t>(ordinal)].expectedHash = hash;
+            }
+            return;
+        }
+        
+        // Check if file already exists in the list
+        auto it = monitoredIndex.find(filePath);
+        if (it != monitoredIndex.end()) {
+            if (!hash.empty()) {
+                monitoredFiles[it->second].expectedHash = hash;
+            }
+            return;
         }
         
         // Add new file
-        monitoredFiles.emplace_back(filePath, expectedHash);
+        monitoredIndex.emplace(filePath, monitoredFiles.size());
+        monitoredFiles.emplace_back(filePath, hash);
     }
     
-    IntegrityReport PerformIntegrityCheck() {
-        IntegrityReport report;
+    std::vector<std::string> GetMonitoredFiles() {
+        std::lock_guard<std::recursive_mutex> stateLock(stateMutex);
+        MaterializeBaseline();
+        std::vector<std::string> paths;
+        paths.reserve(monitoredFiles.size());
+        for (const auto& file : monitoredFiles) {
+            paths.push_back(file.path);
+        }
+        return paths;
+    }
+    
+    void ClearFilesToCheck() {
+        std::lock_guard<std::recursive_mutex> stateLock(stateMutex);
+        monitoredFiles.clear();
+        monitoredIndex.clear();
+        baseline.Close();
+        baselinePath.clear();
+        baselinePending = false;
+        baselineOverrides.clear();
+        std::lock_guard<std::mutex> lock(merkleMutex);
+        merkleTrees.clear();
+    }
+    
+    void ConfigureMerkle(uint64_t minFileSize, size_t chunkSize) {
+        std::lock_guard<std::recursive_mutex> stateLock(stateMutex);
+        merkleConfigured = true;
+        merkleMinSize = minFileSize;
+        merkleChunkSize = std::max<size_t>(4096, chunkSize);
+    }
+    
+    static void EnsureMerkle() {
+        if (merkleConfigured) {
+            return;
+        }
+        auto& config = Utils::Config::Instance();
+        ConfigureMerkle(static_cast<uint64_t>(std::max(0, config.GetInt("integrity", "merkle_min_size_mb", 0))) << 20,
+                        static_cast<size_t>(std::max(4, config.GetInt("integrity", "merkle_chunk_kb", 1024))) << 10);
+    }
+    
+    void ConfigureIoUring(bool enabled, unsigned queueDepth) {
+        std::lock_guard<std::recursive_mutex> stateLock(stateMutex);
+        uringConfigured = true;
+        uringEnabled = enabled;
+        uringQueueDepth = std::max(1u, queueDepth);
+        uringReader.reset();
+        uringUnavailable = false;
+    }
+    
+    // Null when disabled or unsupported; the failure is reported once
+    static UringFileReader* GetUringReader() {
+        if (!uringConfigured) {
+            auto& config = Utils::Config::Instance();
+            ConfigureIoUring(config.GetBool("integrity", "io_uring", true),
+                             static_cast<unsigned>(std::max(1, config.GetInt("integrity", "io_uring_depth", 128))));
+        }
+        if (!uringEnabled || uringUnavailable) {
+            return nullptr;
+        }
+        if (!uringReader || !uringReader->IsInitialized()) {
+            UringFileReader::Options options;
+            options.queueDepth = uringQueueDepth;
+            options.buffers = uringQueueDepth * 2;
+            options.bufferSize = kBatchedFileLimit;
+            options.birthTime = useBirthTime;
+            uringReader.reset(new UringFileReader(options));
+            if (!uringReader->Initialize()) {
+                std::cerr << "Integrity: " << uringReader->GetLastError() << "; reading files with read()" << std::endl;
+                uringReader.reset();
+                uringUnavailable = true;
+                return nullptr;
+            }
+        }
+        return uringReader.get();
+    }
+    
+    void ConfigureHashAlgorithm(HashAlgorithm algorithm) {
+        std::lock_guard<std::recursive_mutex> stateLock(stateMutex);
+        hashAlgorithmConfigured = true;
+        hashAlgorithm = algorithm;
+    }
+    
+    static void EnsureHashAlgorithm() {
+        if (hashAlgorithmConfigured) {
+            return;
+        }
+        std::string name = Utils::Config::Instance().GetString("integrity", "hash_algorithm", "sha256");
+        if (name != "sha256" && name != "blake3") {
+            std::cerr << "Integrity: unknown hash_algorithm '" << name << "', using sha256" << std::endl;
+        }
+        ConfigureHashAlgorithm(name == "blake3" ? HashAlgorithm::Blake3 : HashAlgorithm::Sha256);
+    }
+    
+    HashAlgorithm HashAlgorithmOf(const std::string& hash) {
+        return Blake3::IsId(hash) ? HashAlgorithm::Blake3 : HashAlgorithm::Sha256;
+    }
+    
+    // Algorithm a file is hashed with: the baseline's wins, new files follow the configuration
+    static HashAlgorithm AlgorithmFor(const FileInfo& file) {
+        return file.expectedHash.empty() ? hashAlgorithm : HashAlgorithmOf(file.expectedHash);
+    }
+    
+    // Chunk size a file is hashed with: the baseline's scheme wins, new files follow the configuration
+    static size_t MerkleChunkSizeFor(const FileInfo& file, uint64_t size) {
+        if (!file.expectedHash.empty()) {
+            return MerkleTree::ChunkSizeOf(file.expectedHash);
+        }
+        return hashAlgorithm == HashAlgorithm::Sha256 && merkleMinSize > 0 && size >= merkleMinSize ? merkleChunkSize : 0;
+    }
+    
+    static std::shared_ptr<const MerkleTree> GetCurrentTree(const std::string& path) {
+        std::lock_guard<std::mutex> lock(merkleMutex);
+        auto it = merkleTrees.find(path);
+        return it == merkleTrees.end() ? nullptr : it->second.current;
+    }
+    
+    static void SetCurrentTree(const std::string& path, std::shared_ptr<const MerkleTree> tree) {
+        std::lock_guard<std::mutex> lock(merkleMutex);
+        merkleTrees[path].current = std::move(tree);
+    }
+    
+    static std::vector<MerkleTree::ByteRange> ChangedRanges(const std::string& path) {
+        std::lock_guard<std::mutex> lock(merkleMutex);
+        auto it = merkleTrees.find(path);
+        if (it == merkleTrees.end() || !it->second.expected || !it->second.current) {
+            return {};
+        }
+        return MerkleTree::Diff(*it->second.expected, *it->second.current);
+    }
+    
+    static std::string DescribeRanges(const std::vector<MerkleTree::ByteRange>& ranges) {
+        if (ranges.empty()) {
+            return "";
+        }
+        std::ostringstream text;
+        text << " (bytes ";
+        for (size_t i = 0; i < ranges.size() && i < 4; ++i) {
+            text << (i ? ", " : "") << ranges[i].offset << "-" << ranges[i].offset + ranges[i].length - 1;
+        }
+        if (ranges.size() > 4) {
+            text << " and " << ranges.size() - 4 << " more ranges";
+        }
+        text << ")";
+        return text.str();
+    }
+    
+    // Hashes the listed chunks of a file into tree on a temporary pool; the other leaves are left as they are
+    static bool HashMerkleChunks(const std::string& path, MerkleTree& tree, const std::vector<size_t>& chunks) {
+        static const uint8_t empty = 0;
+        Utils::MappedFile mapped;
+        if (tree.GetFileSize() > 0 && (!mapped.Open(path) || mapped.Size() != tree.GetFileSize())) {
+            return false;
+        }
+        const uint8_t* data = tree.GetFileSize() > 0 ? mapped.Data() : &empty;
+        size_t perTask = std::max<size_t>(1, kHashChunk / tree.GetChunkSize());
+        size_t tasks = (chunks.size() + perTask - 1) / perTask;
+        WorkStealingPool pool(static_cast<unsigned>(std::max<size_t>(1, std::min<size_t>(
+            std::max(1u, std::thread::hardware_concurrency()), tasks))));
+        for (size_t begin = 0; begin < chunks.size(); begin += perTask) {
+            size_t end = std::min(chunks.size(), begin + perTask);
+            pool.Submit([&, begin, end] {
+                for (size_t i = begin; i < end; ++i) {
+                    MerkleTree::ByteRange range = tree.GetChunkRange(chunks[i]);
+                    ResourceGovernor::Instance().ChargeIo(range.length, "file hashing");
+                    tree.HashChunk(chunks[i], data + range.offset, static_cast<size_t>(range.length));
+                    ResourceGovernor::Instance().ChargeCpu("file hashing");
+                }
+            });
+        }
+        pool.Wait();
+        tree.Finish();
+        return true;
+    }
+    
+    static bool BuildMerkleTree(const std::string& path, size_t chunkSize, MerkleTree& tree) {
+        std::error_code ec;
+        uintmax_t size = std::filesystem::file_size(path, ec);
+        if (ec) {
+            return false;
+        }
+        tree.Reset(size, chunkSize);
+        std::vector<size_t> chunks(tree.GetChunkCount());
+        for (size_t i = 0; i < chunks.size(); ++i) {
+            chunks[i] = i;
+        }
+        return HashMerkleChunks(path, tree, chunks);
+    }
+    
+    void ConfigureFingerprintCache(const std::string& cacheFile, int fullRehashHours) {
+        std::lock_guard<std::recursive_mutex> stateLock(stateMutex);
+        fingerprintCacheConfigured = true;
+        fingerprintCacheFile = cacheFile;
+        fullRehashInterval = std::chrono::hours(std::max(0, fullRehashHours));
+        fingerprintCache.Clear();
+        if (!cacheFile.empty()) {
+            fingerprintCache.Load(cacheFile);
+        }
+    }
+    
+    void RequestFullRehash() {
+        std::lock_guard<std::recursive_mutex> stateLock(stateMutex);
+        fullRehashRequested = true;
+    }
+    
+    static void EnsureFingerprintCache() {
+        if (fingerprintCacheConfigured) {
+            return;
+        }
+        auto& config = Utils::Config::Instance();
+        useBirthTime = config.GetBool("integrity", "birth_time", true);
+        // Persisting is opt-in: a relative default would land in whatever directory the process runs from
+        ConfigureFingerprintCache(config.GetString("integrity", "fingerprint_cache", ""),
+                                  config.GetInt("integrity", "full_rehash_hours", 24));
+    }
+    
+    // Every path of an inode waits for the first one seen in the pass
+    struct InodeClaim {
+        bool done;
+        std::string hash;
+        std::vector<size_t> followers;
+    };
+    
+    struct InodeKeyHash {
+        size_t operator()(const std::pair<uint64_t, uint64_t>& key) const {
+            return static_cast<size_t>(key.second * 0x9E3779B97F4A7C15ULL ^ key.first);
+        }
+    };
+    
+    // What a diff pass keeps instead of the full file list
+    struct DiffState {
+        DiffReport* report;
+        std::vector<FingerprintCache::Fingerprint> fingerprints;   // By monitored index, when promoting
+    };
+    
+    struct CheckState {
+        WorkStealingPool* pool;
+        IntegrityReport* report;
+        DiffState* diff;
+        bool fullRehash;
+        std::mutex mutex;
+        std::atomic<size_t> filesDone;
+        std::atomic<uint64_t> bytesHashed;
+        std::atomic<uint64_t> bytesSkipped;
+        std::atomic<uint64_t> cacheHits;
+        std::atomic<uint64_t> cacheMisses;
+        std::atomic<uint64_t> sharedHardLinks;
+        std::mutex claimsMutex;
+        std::unordered_map<std::pair<uint64_t, uint64_t>, InodeClaim, InodeKeyHash> claims;
         
-        for (auto& fileInfo : monitoredFiles) {
-            fileInfo.exists = Utils::FileExists(fileInfo.path);
-            
-            if (!fileInfo.exists) {
-                fileInfo.isValid = false;
-                report.errors.push_back("File missing: " + fileInfo.path);
-                report.overallValid = false;
+        CheckState(WorkStealingPool* p, IntegrityReport* r, DiffState* d, bool full)
+            : pool(p), report(r), diff(d), fullRehash(full), filesDone(0), bytesHashed(0), bytesSkipped(0),
+              cacheHits(0), cacheMisses(0), sharedHardLinks(0) {}
+    };
+    
+    // Sets the verdict on a monitored entry and returns the line it adds to a report, if any
+    static std::string Evaluate(FileInfo& monitored, bool exists, const std::string& actualHash, bool& error) {
+        monitored.exists = exists;
+        monitored.actualHash = actualHash;
+        monitored.changedRanges.clear();
+        monitored.isValid = false;
+        error = true;
+        
+        if (!exists) {
+            return "File missing: " + monitored.path;
+        }
+        if (actualHash.empty()) {
+            return "Failed to calculate hash for: " + monitored.path;
+        }
+        error = false;
+        if (monitored.expectedHash.empty()) {
+            // If no expected hash, use the current one as baseline
+            monitored.expectedHash = actualHash;
+            monitored.isValid = true;
+            std::lock_guard<std::mutex> lock(merkleMutex);
+            auto it = merkleTrees.find(monitored.path);
+            if (it != merkleTrees.end()) {
+                it->second.expected = it->second.current;
+            }
+            return "No baseline hash for: " + monitored.path + ", using current";
+        }
+        monitored.isValid = (actualHash == monitored.expectedHash);
+        if (monitored.isValid) {
+            return "";
+        }
+        error = true;
+        monitored.changedRanges = ChangedRanges(monitored.path);
+        return "Hash mismatch for: " + monitored.path + DescribeRanges(monitored.changedRanges);
+    }
+    
+    // Permission bits the baseline recorded for a monitored file
+    static uint32_t BaselineMode(size_t index) {
+        BaselineIndex::Entry entry;
+        if (!baseline.IsOpen() || !baseline.GetMetadata(index, entry) || !entry.hasMetadata) {
+            return FileChange::kUnknownMode;
+        }
+        return entry.mode & 07777;
+    }
+    
+    // Diff passes keep changed files only; the rest are counted
+    static void RecordChange(CheckState& state, size_t index, bool added, const FingerprintCache::Fingerprint* fingerprint,
+                             const std::string& message) {
+        const FileInfo& monitored = monitoredFiles[index];
+        DiffReport& report = *state.diff->report;
+        if (fingerprint && !state.diff->fingerprints.empty()) {
+            state.diff->fingerprints[index] = *fingerprint;
+        }
+        if (added && !monitored.exists) {
+            return;                                 // Gone before it was ever part of a baseline
+        }
+        report.summary.filesChecked++;
+        if (monitored.exists && monitored.actualHash.empty()) {
+            report.errors.push_back(message);
+            return;
+        }
+        
+        FileChange change(ChangeKind::Modified, monitored.path);
+        change.expectedHash = added ? "" : monitored.expectedHash;
+        change.actualHash = monitored.actualHash;
+        change.expectedMode = added ? FileChange::kUnknownMode : BaselineMode(index);
+        change.actualMode = fingerprint && fingerprint->mode != 0 ? fingerprint->mode & 07777 : FileChange::kUnknownMode;
+        change.changedRanges = monitored.changedRanges;
+        if (added) {
+            change.kind = ChangeKind::Added;
+            report.summary.added++;
+        } else if (!monitored.exists) {
+            change.kind = ChangeKind::Removed;
+            report.summary.removed++;
+        } else if (!monitored.isValid) {
+            report.summary.modified++;
+        } else if (change.expectedMode != FileChange::kUnknownMode && change.actualMode != FileChange::kUnknownMode &&
+                   change.expectedMode != change.actualMode) {
+            change.kind = ChangeKind::PermissionsChanged;
+            report.summary.permissionsChanged++;
+        } else {
+            report.summary.unchanged++;
+            return;
+        }
+        report.changes.push_back(std::move(change));
+    }
+    
+    // Compares one result against the monitored entry and streams it into the report
+    // @param fingerprint The stat the hash belongs to; null if the file could not be stat'ed
+    static void RecordResult(CheckState& state, size_t index, bool exists, const std::string& actualHash,
+                             const FingerprintCache::Fingerprint* fingerprint) {
+        FileInfo& monitored = monitoredFiles[index];
+        std::lock_guard<std::mutex> lock(state.mutex);
+        IntegrityReport& report = *state.report;
+        bool added = monitored.expectedHash.empty();
+        bool error = false;
+        std::string message = Evaluate(monitored, exists, actualHash, error);
+        if (state.diff) {
+            RecordChange(state, index, added, fingerprint, message);
+            if (added) {
+                monitored.expectedHash.clear();     // Added until a baseline generation includes it
+            }
+            state.filesDone.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        if (error) {
+            report.errors.push_back(message);
+            report.overallValid = false;
+        } else if (!message.empty()) {
+            report.warnings.push_back(message);
+        }
+        report.files.push_back(monitored);
+        state.filesDone.fetch_add(1, std::memory_order_relaxed);
+    }
+    
+    // False when another path of the same inode owns the hash; this one is recorded with it
+    static bool ClaimInode(CheckState& state, const FingerprintCache::Fingerprint& fingerprint, size_t index) {
+        if (fingerprint.inode == 0) {
+            return true;
+        }
+        std::unique_lock<std::mutex> lock(state.claimsMutex);
+        auto inserted = state.claims.emplace(std::make_pair(fingerprint.device, fingerprint.inode), InodeClaim{false, "", {}});
+        if (inserted.second) {
+            return true;
+        }
+        state.sharedHardLinks.fetch_add(1, std::memory_order_relaxed);
+        InodeClaim& claim = inserted.first->second;
+        if (!claim.done) {
+            claim.followers.push_back(index);
+            return false;
+        }
+        std::string hash = claim.hash;
+        lock.unlock();
+        RecordResult(state, index, true, hash, &fingerprint);
+        return false;
+    }
+    
+    // Caches a fresh hash if the file did not change while it was read, then records every path of the inode
+    // @param after A stat taken after the read, if the caller has one
+    static void CompleteFile(CheckState& state, size_t index, const FingerprintCache::Fingerprint& fingerprint,
+                             const std::string& hash, bool fresh, const FingerprintCache::Fingerprint* after = nullptr) {
+        if (fresh && !hash.empty()) {
+            FingerprintCache::Fingerprint now;
+            if (after ? *after == fingerprint
+                      : FingerprintCache::Stat(monitoredFiles[index].path, now, useBirthTime) && now == fingerprint) {
+                fingerprintCache.Store(fingerprint, hash);
+            }
+        }
+        std::vector<size_t> followers;
+        if (fingerprint.inode != 0) {
+            std::lock_guard<std::mutex> lock(state.claimsMutex);
+            InodeClaim& claim = state.claims[std::make_pair(fingerprint.device, fingerprint.inode)];
+            claim.done = true;
+            claim.hash = hash;
+            followers.swap(claim.followers);
+        }
+        RecordResult(state, index, true, hash, &fingerprint);
+        for (size_t follower : followers) {
+            RecordResult(state, follower, true, hash, &fingerprint);
+        }
+    }
+    
+    static bool ReadSmallFile(const std::string& path, uint64_t size, std::string& contents) {
+        std::FILE* file = std::fopen(path.c_str(), "rb");
+        if (!file) {
+            return false;
+        }
+        contents.resize(static_cast<size_t>(size));
+        size_t read = size ? std::fread(&contents[0], 1, contents.size(), file) : 0;
+        contents.resize(read);
+        // A file that grew since the stat is hashed as it is now
+        char more[4096];
+        size_t extra;
+        while (read == size && (extra = std::fread(more, 1, sizeof(more), file)) > 0) {
+            contents.append(more, extra);
+        }
+        bool failed = std::ferror(file) != 0;
+        std::fclose(file);
+        return !failed;
+    }
+    
+    struct ChunkedFile {
+        size_t index;
+        FingerprintCache::Fingerprint fingerprint;
+        Utils::MappedFile mapped;
+        Sha256 sha;
+        size_t offset;
+    };
+    
+    // Hashes one chunk, then queues the next on the same worker; idle workers steal other work
+    static void HashChunk(CheckState& state, std::shared_ptr<ChunkedFile> file) {
+        size_t length = std::min(kHashChunk, file->mapped.Size() - file->offset);
+        ResourceGovernor::Instance().ChargeIo(length, "integrity check");
+        file->sha.Update(file->mapped.Data() + file->offset, length);
+        ResourceGovernor::Instance().ChargeCpu("integrity check");
+        file->offset += length;
+        state.bytesHashed.fetch_add(length, std::memory_order_relaxed);
+        if (file->offset < file->mapped.Size()) {
+            state.pool->Submit([&state, file] { HashChunk(state, file); });
+            return;
+        }
+        std::string hash = file->sha.HexDigest();
+        file->mapped.Close();
+        CompleteFile(state, file->index, file->fingerprint, hash, true);
+    }
+    
+    struct MerkleFile {
+        size_t index;
+        FingerprintCache::Fingerprint fingerprint;
+        Utils::MappedFile mapped;
+        MerkleTree tree;
+        std::atomic<size_t> remaining;
+    };
+    
+    // Hashes a run of leaves; the task finishing the last run completes the file
+    static void HashMerkleRun(CheckState& state, std::shared_ptr<MerkleFile> file, size_t first, size_t last) {
+        static const uint8_t empty = 0;
+        for (size_t chunk = first; chunk < last; ++chunk) {
+            MerkleTree::ByteRange range = file->tree.GetChunkRange(chunk);
+            const uint8_t* data = file->mapped.IsOpen() ? file->mapped.Data() + range.offset : &empty;
+            ResourceGovernor::Instance().ChargeIo(range.length, "integrity check");
+            file->tree.HashChunk(chunk, data, static_cast<size_t>(range.length));
+            ResourceGovernor::Instance().ChargeCpu("integrity check");
+            state.bytesHashed.fetch_add(range.length, std::memory_order_relaxed);
+        }
+        if (file->remaining.fetch_sub(1) != 1) {
+            return;
+        }
+        file->tree.Finish();
+        file->mapped.Close();
+        std::string id = file->tree.GetId();
+        SetCurrentTree(monitoredFiles[file->index].path, std::make_shared<MerkleTree>(std::move(file->tree)));
+        CompleteFile(state, file->index, file->fingerprint, id, true);
+    }
+    
+    // Leaves are queued in runs on the current worker so idle workers can steal them
+    static void StartMerkleFile(CheckState& state, size_t index, const FingerprintCache::Fingerprint& fingerprint,
+                                size_t chunkSize) {
+        auto file = std::make_shared<MerkleFile>();
+        file->index = index;
+        file->fingerprint = fingerprint;
+        file->tree.Reset(fingerprint.size, chunkSize);
+        if (fingerprint.size > 0 &&
+            (!file->mapped.Open(monitoredFiles[index].path) || file->mapped.Size() != fingerprint.size)) {
+            CompleteFile(state, index, fingerprint, "", false);
+            return;
+        }
+        size_t chunks = file->tree.GetChunkCount();
+        size_t perTask = std::max<size_t>(1, kHashChunk / chunkSize);
+        file->remaining = (chunks + perTask - 1) / perTask;
+        for (size_t first = 0; first < chunks; first += perTask) {
+            size_t last = std::min(chunks, first + perTask);
+            state.pool->Submit([&state, file, first, last] { HashMerkleRun(state, file, first, last); });
+        }
+    }
+    
+    struct Blake3File {
+        size_t index;
+        FingerprintCache::Fingerprint fingerprint;
+        Utils::MappedFile mapped;
+        std::vector<Blake3::Subtree> subtrees;
+        std::vector<uint8_t> values;             // Chaining value of each subtree
+        std::atomic<size_t> remaining;
+    };
+    
+    // Hashes one subtree; the task finishing the last one joins them into the file's hash
+    static void HashBlake3Subtree(CheckState& state, std::shared_ptr<Blake3File> file, size_t subtree) {
+        const Blake3::Subtree& range = file->subtrees[subtree];
+        ResourceGovernor::Instance().ChargeIo(range.length, "integrity check");
+        Blake3::HashSubtree(file->mapped.Data(), range, &file->values[subtree * Blake3::DigestSize]);
+        ResourceGovernor::Instance().ChargeCpu("integrity check");
+        state.bytesHashed.fetch_add(range.length, std::memory_order_relaxed);
+        if (file->remaining.fetch_sub(1) != 1) {
+            return;
+        }
+        uint8_t digest[Blake3::DigestSize];
+        Blake3::CombineSubtrees(file->mapped.Size(), kHashChunk,
+                                reinterpret_cast<const uint8_t(*)[Blake3::DigestSize]>(file->values.data()), digest);
+        file->mapped.Close();
+        CompleteFile(state, file->index, file->fingerprint, Blake3::ToId(digest), true);
+    }
+    
+    // A large BLAKE3 file is one subtree task per kHashChunk, queued on the current worker for idle ones to steal
+    static void StartBlake3File(CheckState& state, size_t index, const FingerprintCache::Fingerprint& fingerprint) {
+        auto file = std::make_shared<Blake3File>();
+        file->index = index;
+        file->fingerprint = fingerprint;
+        if (!file->mapped.Open(monitoredFiles[index].path) || file->mapped.Size() != fingerprint.size) {
+            CompleteFile(state, index, fingerprint, "", false);
+            return;
+        }
+        file->subtrees = Blake3::SplitSubtrees(fingerprint.size, kHashChunk);
+        file->values.resize(file->subtrees.size() * Blake3::DigestSize);
+        file->remaining = file->subtrees.size();
+        for (size_t subtree = 0; subtree < file->subtrees.size(); ++subtree) {
+            state.pool->Submit([&state, file, subtree] { HashBlake3Subtree(state, file, subtree); });
+        }
+    }
+    
+    static void HashWholeFile(CheckState& state, size_t index, const FingerprintCache::Fingerprint& fingerprint) {
+        std::string hash = CalculateFileHash(monitoredFiles[index].path, AlgorithmFor(monitoredFiles[index]));
+        state.bytesHashed.fetch_add(hash.empty() ? 0 : fingerprint.size, std::memory_order_relaxed);
+        CompleteFile(state, index, fingerprint, hash, true);
+    }
+    
+    // Settles cache hits and hard-link followers and queues bigger files; true leaves a small file for the caller to read
+    static bool DispatchFile(CheckState& state, size_t i, const FingerprintCache::Fingerprint& fingerprint) {
+        if (!ClaimInode(state, fingerprint, i)) {
+            return false;
+        }
+        HashAlgorithm algorithm = AlgorithmFor(monitoredFiles[i]);
+        size_t chunkSize = MerkleChunkSizeFor(monitoredFiles[i], fingerprint.size);
+        std::string cached;
+        if (!state.fullRehash && fingerprintCache.Lookup(fingerprint, cached) &&
+            MerkleTree::ChunkSizeOf(cached) == chunkSize && HashAlgorithmOf(cached) == algorithm) {
+            state.cacheHits.fetch_add(1, std::memory_order_relaxed);
+            state.bytesSkipped.fetch_add(fingerprint.size, std::memory_order_relaxed);
+            CompleteFile(state, i, fingerprint, cached, false);
+            return false;
+        }
+        state.cacheMisses.fetch_add(1, std::memory_order_relaxed);
+        
+        uint64_t size = fingerprint.size;
+        if (chunkSize > 0) {
+            StartMerkleFile(state, i, fingerprint, chunkSize);
+        } else if (size >= kChunkedFileThreshold && algorithm == HashAlgorithm::Blake3) {
+            StartBlake3File(state, i, fingerprint);
+        } else if (size >= kChunkedFileThreshold) {
+            auto file = std::make_shared<ChunkedFile>();
+            file->index = i;
+            file->fingerprint = fingerprint;
+            file->offset = 0;
+            if (!file->mapped.Open(monitoredFiles[i].path) || file->mapped.Size() == 0) {
+                CompleteFile(state, i, fingerprint, "", false);
+                return false;
+            }
+            state.pool->Submit([&state, file] { HashChunk(state, file); });
+        } else if (size <= kBatchedFileLimit) {
+            return true;
+        } else {
+            state.pool->Submit([&state, i, fingerprint] { HashWholeFile(state, i, fingerprint); });
+        }
+        return false;
+    }
+    
+    struct SmallFile {
+        size_t index;
+        FingerprintCache::Fingerprint fingerprint;
+        bool afterKnown;
+        FingerprintCache::Fingerprint after;     // Stat taken by the io_uring reader after the read
+        std::string contents;                    // read() path
+        const uint8_t* data;                     // io_uring path: a registered buffer
+        size_t size;
+        uint32_t buffer;
+    };
+    
+    // Small files go through the multi-buffer hashers together, SHA-256 files first
+    static void HashSmallFiles(CheckState& state, std::vector<SmallFile>& files, UringFileReader* reader) {
+        size_t sha256Files = static_cast<size_t>(std::stable_partition(files.begin(), files.end(), [](const SmallFile& file) {
+            return AlgorithmFor(monitoredFiles[file.index]) == HashAlgorithm::Sha256;
+        }) - files.begin());
+        std::vector<const uint8_t*> data(files.size());
+        std::vector<size_t> sizes(files.size());
+        std::vector<uint8_t[Sha256::DigestSize]> digests(files.size());
+        uint64_t bytes = 0;
+        for (size_t j = 0; j < files.size(); ++j) {
+            data[j] = files[j].data ? files[j].data : reinterpret_cast<const uint8_t*>(files[j].contents.data());
+            sizes[j] = files[j].data ? files[j].size : files[j].contents.size();
+            bytes += sizes[j];
+        }
+        Sha256::HashMany(data.data(), sizes.data(), sha256Files, digests.data());
+        Blake3::HashMany(data.data() + sha256Files, sizes.data() + sha256Files, files.size() - sha256Files,
+                         digests.data() + sha256Files);
+        ResourceGovernor::Instance().ChargeCpu("integrity check");
+        state.bytesHashed.fetch_add(bytes, std::memory_order_relaxed);
+        for (const auto& file : files) {
+            if (file.data) {
+                reader->Release(file.buffer);
+            }
+        }
+        for (size_t j = 0; j < files.size(); ++j) {
+            std::string hash = j < sha256Files ? Sha256::ToHex(digests[j]) : Blake3::ToId(digests[j]);
+            CompleteFile(state, files[j].index, files[j].fingerprint, hash, true,
+                         files[j].afterKnown ? &files[j].after : nullptr);
+        }
+    }
+    
+    static void VerifyBatch(CheckState& state, size_t begin, size_t end) {
+        std::vector<SmallFile> batched;
+        for (size_t i = begin; i < end; ++i) {
+            const std::string& path = monitoredFiles[i].path;
+            FingerprintCache::Fingerprint fingerprint;
+            if (!FingerprintCache::Stat(path, fingerprint, useBirthTime)) {
+                RecordResult(state, i, Utils::FileExists(path), "", nullptr);
                 continue;
             }
-            
-            // Calculate current hash
-            fileInfo.actualHash = CalculateFileHash(fileInfo.path);
-            
-            if (fileInfo.actualHash.empty()) {
-                fileInfo.isValid = false;
-                report.errors.push_back("Failed to calculate hash for: " + fileInfo.path);
-                report.overallValid = false;
+            if (!DispatchFile(state, i, fingerprint)) {
                 continue;
             }
-            
-            // If no expected hash, use the current one as baseline
-            if (fileInfo.expectedHash.empty()) {
-                fileInfo.expectedHash = fileInfo.actualHash;
-                fileInfo.isValid = true;
-                report.warnings.push_back("No baseline hash for: " + fileInfo.path + ", using current");
-            } else {
-                // Compare hashes
-                fileInfo.isValid = (fileInfo.actualHash == fileInfo.expectedHash);
-                
-                if (!fileInfo.isValid) {
-                    report.errors.push_back("Hash mismatch for: " + fileInfo.path);
-                    report.overallValid = false;
+            SmallFile file{i, fingerprint, false, {}, "", nullptr, 0, 0};
+            if (!ReadSmallFile(path, fingerprint.size, file.contents)) {
+                CompleteFile(state, i, fingerprint, "", false);
+                continue;
+            }
+            ResourceGovernor::Instance().ChargeIo(file.contents.size(), "integrity check");
+            batched.push_back(std::move(file));
+        }
+        HashSmallFiles(state, batched, nullptr);
+    }
+    
+    // Files per hashing task on the io_uring path; the reader has spare buffers for one pending batch
+    static const size_t kUringHashBatch = 32;
+    
+    // Stats and reads on the calling thread through io_uring; the pool hashes completed batches
+    static void VerifyWithUring(CheckState& state, UringFileReader& reader, const std::function<void()>& onPoll) {
+        std::vector<SmallFile> batch;
+        auto flush = [&]() {
+            if (batch.empty()) {
+                return;
+            }
+            auto files = std::make_shared<std::vector<SmallFile>>(std::move(batch));
+            batch.clear();
+            state.pool->Submit([&state, &reader, files] { HashSmallFiles(state, *files, &reader); });
+        };
+        auto onStat = [&state](size_t index, const FingerprintCache::Fingerprint& fingerprint) {
+            return DispatchFile(state, index, fingerprint);
+        };
+        auto onComplete = [&](const UringFileReader::Completion& completion) {
+            size_t index = completion.index;
+            if (!completion.read) {
+                if (completion.error == ECANCELED) {
+                    state.pool->Submit([&state, index] { VerifyBatch(state, index, index + 1); });
+                } else {
+                    RecordResult(state, index, Utils::FileExists(monitoredFiles[index].path), "", nullptr);
+                }
+                return;
+            }
+            if (completion.error != 0) {
+                // Grew past the buffer or failed to read here: the read() path decides
+                FingerprintCache::Fingerprint fingerprint = completion.before;
+                state.pool->Submit([&state, index, fingerprint] { HashWholeFile(state, index, fingerprint); });
+                return;
+            }
+            ResourceGovernor::Instance().ChargeIo(completion.length, "integrity check");
+            batch.push_back(SmallFile{index, completion.before, true, completion.after, "", completion.data,
+                                      completion.length, completion.buffer});
+            if (batch.size() >= kUringHashBatch) {
+                flush();
+            }
+        };
+        size_t started = reader.Run(monitoredFiles.size(), [](size_t index) { return monitoredFiles[index].path.c_str(); },
+                                    onStat, onComplete, onPoll);
+        flush();
+        if (started < monitoredFiles.size()) {
+            std::cerr << "Integrity: " << reader.GetLastError() << "; reading the remaining files with read()" << std::endl;
+            uringUnavailable = true;
+        }
+        for (size_t begin = started; begin < monitoredFiles.size(); begin += kFilesPerTask) {
+            size_t end = std::min(monitoredFiles.size(), begin + kFilesPerTask);
+            state.pool->Submit([&state, begin, end] { VerifyBatch(state, begin, end); });
+        }
+    }
+    
+    IntegrityReport PerformIntegrityCheck() {
+        return PerformIntegrityCheck(nullptr);
+    }
+    
+    // One verification pass over monitoredFiles; with diff set, changes go there instead of report.files
+    static void RunCheck(IntegrityReport& report, DiffState* diff, const ProgressCallback& progress, unsigned parallelism) {
+        MaterializeBaseline();
+        if (!diff) {
+            report.files.reserve(monitoredFiles.size());
+        }
+        
+        unsigned cap = static_cast<unsigned>(std::max(0, Utils::Config::Instance().GetInt("integrity", "max_parallelism", 0)));
+        if (parallelism == 0) {
+            parallelism = std::max(1u, std::thread::hardware_concurrency());
+        }
+        if (cap > 0) {
+            parallelism = std::min(parallelism, cap);
+        }
+        size_t tasks = (monitoredFiles.size() + kFilesPerTask - 1) / kFilesPerTask;
+        parallelism = static_cast<unsigned>(std::max<size_t>(1, std::min<size_t>(parallelism, tasks)));
+        
+        EnsureFingerprintCache();
+        EnsureMerkle();
+        EnsureHashAlgorithm();
+        auto started = std::chrono::system_clock::now();
+        bool fullRehash = fullRehashRequested || fullRehashInterval.count() == 0 ||
+                          started - fingerprintCache.GetLastFullRehash() >= fullRehashInterval;
+        fullRehashRequested = false;
+        
+        WorkStealingPool pool(parallelism);
+        CheckState state(&pool, &report, diff, fullRehash);
+        auto snapshot = [&]() {
+            return VerifyProgress{state.filesDone.load(), monitoredFiles.size(), state.bytesHashed.load()};
+        };
+        UringFileReader* reader = GetUringReader();
+        if (reader) {
+            auto lastProgress = std::chrono::steady_clock::now();
+            VerifyWithUring(state, *reader, [&]() {
+                auto now = std::chrono::steady_clock::now();
+                if (progress && now - lastProgress >= std::chrono::milliseconds(100)) {
+                    progress(snapshot());
+                    lastProgress = now;
+                }
+            });
+        } else {
+            for (size_t begin = 0; begin < monitoredFiles.size(); begin += kFilesPerTask) {
+                size_t end = std::min(monitoredFiles.size(), begin + kFilesPerTask);
+                pool.Submit([&state, begin, end] { VerifyBatch(state, begin, end); });
+            }
+        }
+        
+        while (!pool.WaitFor(std::chrono::milliseconds(100))) {
+            if (progress) {
+                progress(snapshot());
+            }
+        }
+        if (progress) {
+            progress(snapshot());
+        }
+        
+        report.statistics.cacheHits = state.cacheHits.load();
+        report.statistics.cacheMisses = state.cacheMisses.load();
+        report.statistics.bytesHashed = state.bytesHashed.load();
+        report.statistics.bytesSkipped = state.bytesSkipped.load();
+        report.statistics.sharedHardLinks = state.sharedHardLinks.load();
+        report.statistics.fullRehash = fullRehash;
+        report.statistics.ioUring = reader != nullptr;
+        
+        // Every monitored file was looked up, so untouched entries belong to files no longer checked
+        fingerprintCache.PruneUntouched();
+        if (fullRehash) {
+            fingerprintCache.SetLastFullRehash(started);
+        }
+        if (!fingerprintCacheFile.empty() && !fingerprintCache.Save(fingerprintCacheFile)) {
+            report.warnings.push_back("Failed to save fingerprint cache: " + fingerprintCacheFile);
+        }
+    }
+    
+    IntegrityReport PerformIntegrityCheck(const ProgressCallback& progress, unsigned parallelism) {
+        std::lock_guard<std::recursive_mutex> stateLock(stateMutex);
+        IntegrityReport report;
+        RunCheck(report, nullptr, progress, parallelism);
+        return report;
+    }
+    
+    // Serialized tree behind a Merkle id, from the last verification or the baseline
+    static std::string SerializedTree(const std::string& path, const std::string& id) {
+        std::lock_guard<std::mutex> lock(merkleMutex);
+        auto it = merkleTrees.find(path);
+        if (it == merkleTrees.end()) {
+            return "";
+        }
+        for (const auto& tree : {it->second.current, it->second.expected}) {
+            if (tree && tree->GetId() == id) {
+                return tree->Serialize();
+            }
+        }
+        return "";
+    }
+    
+    // Baseline entry with the metadata of the stat its hash was taken with
+    static BaselineIndex::Entry MakeBaselineEntry(const std::string& path, const FingerprintCache::Fingerprint& fingerprint) {
+        BaselineIndex::Entry entry;
+        entry.path = path;
+        entry.hasMetadata = fingerprint.mode != 0;
+        entry.size = fingerprint.size;
+        entry.mtimeNs = fingerprint.mtimeNs;
+        entry.mode = fingerprint.mode & 07777;
+        return entry;
+    }
+    
+    // Writes what a diff pass verified as the next baseline generation and loads it in place of the old one
+    static bool PromoteBaseline(const DiffState& diff, const std::string& baselineFile, uint32_t generation,
+                                std::string& error) {
+        std::vector<BaselineIndex::Entry> entries;
+        entries.reserve(monitoredFiles.size());
+        for (size_t i = 0; i < monitoredFiles.size(); ++i) {
+            const FileInfo& file = monitoredFiles[i];
+            if (!file.exists || file.actualHash.empty()) {
+                continue;
+            }
+            BaselineIndex::Entry entry = MakeBaselineEntry(file.path, diff.fingerprints[i]);
+            entry.hash = file.actualHash;
+            if (MerkleTree::IsMerkleId(file.actualHash)) {
+                // The tree itself goes into the baseline; a cache hit left only its id
+                entry.hash = SerializedTree(file.path, file.actualHash);
+                MerkleTree tree;
+                if (entry.hash.empty() && BuildMerkleTree(file.path, MerkleTree::ChunkSizeOf(file.actualHash), tree) &&
+                    tree.GetId() == file.actualHash) {
+                    entry.hash = tree.Serialize();
+                }
+                if (entry.hash.empty()) {
+                    error = "Changed while promoting: " + file.path;
+                    return false;
                 }
             }
+            entries.push_back(std::move(entry));
+        }
+        if (!BaselineIndex::Compile(std::move(entries), baselineFile, nullptr, &error, generation)) {
+            return false;
         }
         
-        report.files = monitoredFiles;
+        // Files gone from the new generation are no longer monitored
+        monitoredFiles.clear();
+        monitoredIndex.clear();
+        baselineOverrides.clear();
+        baseline.Close();
+        {
+            std::lock_guard<std::mutex> lock(merkleMutex);
+            merkleTrees.clear();
+        }
+        if (!baseline.Open(baselineFile)) {
+            error = baseline.GetLastError();
+            return false;
+        }
+        baselinePath = baselineFile;
+        baselinePending = true;
+        return true;
+    }
+    
+    DiffReport PerformIntegrityDiff(const DiffOptions& options) {
+        std::lock_guard<std::recursive_mutex> stateLock(stateMutex);
+        MaterializeBaseline();
+        DiffReport report;
+        report.baselineGeneration = baseline.IsOpen() ? baseline.GetGeneration() : 0;
+        DiffState diff{&report, {}};
+        if (options.promote) {
+            diff.fingerprints.assign(monitoredFiles.size(), FingerprintCache::Fingerprint{});
+        }
+        IntegrityReport pass;
+        RunCheck(pass, &diff, options.progress, options.parallelism);
+        report.warnings = std::move(pass.warnings);
+        report.statistics = pass.statistics;
+        std::sort(report.changes.begin(), report.changes.end(),
+                  [](const FileChange& a, const FileChange& b) { return a.path < b.path; });
+        report.clean = report.changes.empty() && report.errors.empty();
         
+        if (options.promote) {
+            std::string target = options.baselineFile.empty() ? baselinePath : options.baselineFile;
+            std::string error;
+            if (target.empty()) {
+                report.warnings.push_back("Not promoted: no binary baseline is loaded and no file was given");
+            } else if (!report.errors.empty()) {
+                report.warnings.push_back("Not promoted: " + std::to_string(report.errors.size()) + " files could not be hashed");
+            } else if (!PromoteBaseline(diff, target, report.baselineGeneration + 1, error)) {
+                report.errors.push_back("Failed to promote baseline: " + error);
+                report.clean = false;
+            } else {
+                report.promotedGeneration = report.baselineGeneration + 1;
+            }
+        }
         return report;
     }
     
+    static std::string FormatMode(uint32_t mode) {
+        if (mode == FileChange::kUnknownMode) {
+            return "unknown";
+        }
+        char text[16];
+        std::snprintf(text, sizeof(text), "%04o", mode);
+        return text;
+    }
+    
+    bool WriteDiffReport(const DiffReport& report, std::ostream& out) {
+        using namespace JsonReporting;
+        SecurityReport header;
+        header.reportId = "integrity-diff-" + std::to_string(std::chrono::duration_cast<std::chrono::seconds>(
+                                                  header.generatedAt.time_since_epoch()).count());
+        header.systemInfo["baseline_generation"] = std::to_string(report.baselineGeneration);
+        if (report.promotedGeneration > 0) {
+            header.systemInfo["promoted_generation"] = std::to_string(report.promotedGeneration);
+        }
+        ReportWriter writer(out);
+        writer.Begin(header);
+        
+        const DiffSummary& summary = report.summary;
+        CheckResult result = CreateCheckResult("integrity.summary", report.clean ? Status::PASS : Status::FAIL,
+                                               report.clean ? Severity::INFO : Severity::HIGH,
+                                               std::to_string(report.changes.size()) + " changes in " +
+                                                   std::to_string(summary.filesChecked) + " files");
+        result.details["files_checked"] = std::to_string(summary.filesChecked);
+        result.details["unchanged"] = std::to_string(summary.unchanged);
+        result.details["added"] = std::to_string(summary.added);
+        result.details["removed"] = std::to_string(summary.removed);
+        result.details["modified"] = std::to_string(summary.modified);
+        result.details["permissions_changed"] = std::to_string(summary.permissionsChanged);
+        result.details["errors"] = std::to_string(report.errors.size());
+        result.details["bytes_hashed"] = std::to_string(report.statistics.bytesHashed);
+        result.details["cache_hits"] = std::to_string(report.statistics.cacheHits);
+        writer.Write(result);
+        
+        for (const auto& change : report.changes) {
+            static const struct {
+                const char* id;
+                Severity severity;
+                const char* description;
+            } kinds[] = {
+                {"integrity.added", Severity::LOW, "File added: "},
+                {"integrity.removed", Severity::HIGH, "File removed: "},
+                {"integrity.modified", Severity::HIGH, "File modified: "},
+                {"integrity.permissions", Severity::MEDIUM, "Permissions changed: "},
+            };
+            const auto& kind = kinds[static_cast<int>(change.kind)];
+            CheckResult entry = CreateCheckResult(kind.id, change.kind == ChangeKind::Added ? Status::WARNING : Status::FAIL,
+                                                  kind.severity, kind.description + change.path);
+            entry.details["path"] = change.path;
+            if (!change.expectedHash.empty()) {
+                entry.details["expected_hash"] = change.expectedHash;
+            }
+            if (!change.actualHash.empty()) {
+                entry.details["actual_hash"] = change.actualHash;
+            }
+            if (change.expectedMode != change.actualMode) {
+                entry.details["expected_mode"] = FormatMode(change.expectedMode);
+                entry.details["actual_mode"] = FormatMode(change.actualMode);
+            }
+            if (!change.changedRanges.empty()) {
+                std::string ranges;
+                for (const auto& range : change.changedRanges) {
+                    ranges += (ranges.empty() ? "" : ",") + std::to_string(range.offset) + "-" +
+                              std::to_string(range.offset + range.length - 1);
+                }
+                entry.details["changed_ranges"] = ranges;
+            }
+            writer.Write(entry);
+        }
+        for (const auto& error : report.errors) {
+            writer.Write(CreateCheckResult("integrity.error", Status::ERROR, Severity::MEDIUM, error));
+        }
+        return writer.End();
+    }
+    
+    FileInfo VerifyFileRanges(const std::string& filePath, const std::vector<MerkleTree::ByteRange>& dirty) {
+        std::lock_guard<std::recursive_mutex> stateLock(stateMutex);
+        EnsureMerkle();
+        EnsureHashAlgorithm();
+        MaterializeBaseline();
+        size_t index = 0;
+        if (!FindMonitored(filePath, index)) {
+            return FileInfo(filePath, "");
+        }
+        FileInfo& monitored = monitoredFiles[index];
+        FingerprintCache::Fingerprint fingerprint;
+        if (!FingerprintCache::Stat(filePath, fingerprint, useBirthTime)) {
+            bool error = false;
+            Evaluate(monitored, Utils::FileExists(filePath), "", error);
+            return monitored;
+        }
+        
+        std::string hash;
+        size_t chunkSize = MerkleChunkSizeFor(monitored, fingerprint.size);
+        if (chunkSize == 0) {
+            hash = CalculateFileHash(filePath, AlgorithmFor(monitored));
+        } else {
+            // Leaves outside the dirty ranges are trusted from the last verification of the same layout
+            auto previous = GetCurrentTree(filePath);
+            auto tree = std::make_shared<MerkleTree>();
+            bool hashed;
+            if (previous && previous->GetChunkSize() == chunkSize && previous->GetFileSize() == fingerprint.size) {
+                *tree = *previous;
+                hashed = HashMerkleChunks(filePath, *tree, tree->ChunksIn(dirty));
+            } else {
+                hashed = BuildMerkleTree(filePath, chunkSize, *tree);
+            }
+            if (hashed) {
+                hash = tree->GetId();
+                SetCurrentTree(filePath, tree);
+            }
+        }
+        bool error = false;
+        Evaluate(monitored, true, hash, error);
+        return monitored;
+    }
+    
     bool QuickIntegrityCheck() {
         // Quick check focusing only on the main executable
         std::string execPath = Utils::GetExecutableDirectory() + "/SecuritySentinel";
@@ -120,8 +1301,57 @@ namespace IntegritySystem {
         return true;
     }
     
-    std::string CalculateFileHash(const std::string& filePath) {
-        return Utils::HashString(filePath); // Placeholder - Utils::HashString should calculate file hash
+    // Streams a file into hasher: mapped if large, otherwise read in aligned chunks
+    template <typename Hasher>
+    static bool HashFileContents(const std::string& filePath, Hasher& hasher) {
+        auto& governor = ResourceGovernor::Instance();
+        
+        std::error_code ec;
+        uintmax_t size = std::filesystem::file_size(filePath, ec);
+        if (!ec && size >= kMapThreshold) {
+            Utils::MappedFile mapped;
+            if (!mapped.Open(filePath)) {
+                return false;
+            }
+            for (size_t offset = 0; offset < mapped.Size(); offset += kReadChunk) {
+                size_t length = std::min(kReadChunk, mapped.Size() - offset);
+                governor.ChargeIo(length, "file hashing");
+                hasher.Update(mapped.Data() + offset, length);
+                governor.ChargeCpu("file hashing");
+            }
+            return true;
+        }
+        
+        std::FILE* file = std::fopen(filePath.c_str(), "rb");
+        if (!file) {
+            return false;
+        }
+        // Unbuffered: reads go straight into the aligned chunk
+        std::setvbuf(file, nullptr, _IONBF, 0);
+        thread_local AlignedBuffer buffer;
+        size_t read;
+        while ((read = std::fread(buffer.data, 1, kReadChunk, file)) > 0) {
+            governor.ChargeIo(read, "file hashing");
+            hasher.Update(buffer.data, read);
+            governor.ChargeCpu("file hashing");
+        }
+        bool failed = std::ferror(file) != 0;
+        std::fclose(file);
+        return !failed;
+    }
+    
+    std::string CalculateFileHash(const std::string& filePath, HashAlgorithm algorithm) {
+        if (algorithm == HashAlgorithm::Blake3) {
+            Blake3 blake;
+            uint8_t digest[Blake3::DigestSize];
+            if (!HashFileContents(filePath, blake)) {
+                return "";
+            }
+            blake.Final(digest);
+            return Blake3::ToId(digest);
+        }
+        Sha256 sha;
+        return HashFileContents(filePath, sha) ? sha.HexDigest() : "";
     }
     
     bool VerifyDigitalSignature(const std::string& filePath) {
@@ -166,41 +1396,69 @@ namespace IntegritySystem {
     }
     
     bool GenerateBaseline(const std::string& baselineFile) {
-        try {
-            std::ofstream file(baselineFile);
-            if (!file.is_open()) {
-                std::cerr << "Failed to create baseline file: " << baselineFile << std::endl;
-                return false;
+        std::lock_guard<std::recursive_mutex> stateLock(stateMutex);
+        EnsureMerkle();
+        EnsureHashAlgorithm();
+        MaterializeBaseline();
+        std::vector<BaselineIndex::Entry> entries;
+        entries.reserve(monitoredFiles.size());
+        for (const auto& fileInfo : monitoredFiles) {
+            // Same stat as a verification pass, so promoted generations record metadata alike
+            FingerprintCache::Fingerprint fingerprint;
+            if (!FingerprintCache::Stat(fileInfo.path, fingerprint, useBirthTime)) {
+                continue;
             }
+            BaselineIndex::Entry entry = MakeBaselineEntry(fileInfo.path, fingerprint);
             
-            file << "# Security Sentinel Integrity Baseline\n";
-            file << "# Generated at: " << Utils::FormatTime(std::chrono::system_clock::now()) << "\n\n";
-            
-            for (const auto& fileInfo : monitoredFiles) {
-                if (Utils::FileExists(fileInfo.path)) {
-                    std::string hash = CalculateFileHash(fileInfo.path);
-                    if (!hash.empty()) {
-                        file << fileInfo.path << ":" << hash << "\n";
-                    }
-                }
+            size_t chunkSize = MerkleChunkSizeFor(FileInfo(fileInfo.path, ""), entry.size);
+            MerkleTree tree;
+            if (chunkSize == 0) {
+                entry.hash = CalculateFileHash(fileInfo.path, hashAlgorithm);
+            } else if (BuildMerkleTree(fileInfo.path, chunkSize, tree)) {
+                entry.hash = tree.Serialize();
             }
-            
-            file.close();
-            std::cout << "Integrity baseline generated: " << baselineFile << std::endl;
-            return true;
-            
-        } catch (const std::exception& e) {
-            std::cerr << "Error generating baseline: " << e.what() << std::endl;
+            if (!entry.hash.empty()) {
+                entries.push_back(std::move(entry));
+            }
+        }
+        
+        std::string error;
+        if (!BaselineIndex::Compile(std::move(entries), baselineFile, nullptr, &error)) {
+            std::cerr << error << std::endl;
             return false;
         }
+        std::cout << "Integrity baseline generated: " << baselineFile << std::endl;
+        return true;
     }
     
     bool LoadBaseline(const std::string& baselineFile) {
+        std::lock_guard<std::recursive_mutex> stateLock(stateMutex);
         if (!Utils::FileExists(baselineFile)) {
             std::cout << "No existing baseline found, will generate on next check." << std::endl;
             return false;
         }
         
+        if (BaselineIndex::IsIndexFile(baselineFile)) {
+            // Entries of a baseline loaded earlier become ordinary monitored files
+            MaterializeBaseline();
+            if (baseline.IsOpen()) {
+                for (size_t i = 0; i < baseline.GetCount(); ++i) {
+                    monitoredIndex.emplace(monitoredFiles[i].path, i);
+                }
+                baseline.Close();
+            }
+            // Only the header is read here; entries are copied when a check first needs them
+            if (!baseline.Open(baselineFile)) {
+                std::cerr << baseline.GetLastError() << std::endl;
+                return false;
+            }
+            baselinePath = baselineFile;
+            baselinePending = true;
+            std::cout << "Loaded " << baseline.GetCount() << " file hashes from baseline." << std::endl;
+            return true;
+        }
+        
+        // Text baselines from older versions; convert with --convert-baseline
         try {
             std::ifstream file(baselineFile);
             if (!file.is_open()) {
@@ -211,29 +1469,11 @@ namespace IntegritySystem {
             int loadedCount = 0;
             
             while (std::getline(file, line)) {
-                // Skip comments and empty lines
-                if (line.empty() || line[0] == '#') {
-                    continue;
-                }
-                
-                size_t colonPos = line.find(':');
-                if (colonPos != std::string::npos) {
-                    std::string path = line.substr(0, colonPos);
-                    std::string hash = line.substr(colonPos + 1);
-                    
+                std::string path;
+                std::string hash;
+                if (BaselineIndex::ParseTextLine(line, path, hash)) {
                     // Update existing entry or add new one
-                    bool found = false;
-                    for (auto& fileInfo : monitoredFiles) {
-                        if (fileInfo.path == path) {
-                            fileInfo.expectedHash = hash;
-                            found = true;
-                            break;
-                        }
-                    }
-                    
-                    if (!found) {
-                        AddFileToCheck(path, hash);
-                    }
+                    AddFileToCheck(path, hash);
                     
                     loadedCount++;
                 }
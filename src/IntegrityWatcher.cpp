@@ -0,0 +1,365 @@
+#include "IntegrityWatcher.h"
+#include <algorithm>
+#include <filesystem>
+#include <limits>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <limits.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/fanotify.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace {
+    const std::chrono::milliseconds kMaxWait(1000);
+
+#ifdef __linux__
+    const uint32_t kWatchMask = IN_MODIFY | IN_CLOSE_WRITE | IN_MOVED_FROM | IN_MOVED_TO | IN_CREATE | IN_DELETE |
+                                IN_ONLYDIR;
+    const uint64_t kWriterMask = FAN_MODIFY | FAN_CLOSE_WRITE | FAN_EVENT_ON_CHILD;
+#endif
+
+    std::string JoinPath(const std::string& directory, const std::string& name) {
+        return directory == "/" ? "/" + name : directory + "/" + name;
+    }
+}
+
+IntegrityWatcher::IntegrityWatcher(const Options& options)
+    : options_(options), running_(false), notifyFd_(-1), wakeFd_(-1), writerFd_(-1),
+      nextSweep_(std::chrono::steady_clock::time_point::max()) {
+}
+
+IntegrityWatcher::~IntegrityWatcher() {
+    Stop();
+}
+
+bool IntegrityWatcher::Start() {
+    if (running_.load()) {
+        return true;
+    }
+
+    directories_.clear();
+    watches_.clear();
+    unwatched_.clear();
+    canonical_.clear();
+    for (const auto& path : IntegritySystem::GetMonitoredFiles()) {
+        std::filesystem::path file(path);
+        std::string directory = file.parent_path().string();
+        directories_[directory.empty() ? "." : directory].insert(file.filename().string());
+        std::error_code ec;
+        auto resolved = std::filesystem::weakly_canonical(file, ec);
+        if (!ec) {
+            canonical_[resolved.string()] = path;
+        }
+    }
+
+#ifdef __linux__
+    notifyFd_ = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (notifyFd_ < 0) {
+        lastError_ = "inotify_init1 failed";
+        return false;
+    }
+    wakeFd_ = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wakeFd_ < 0) {
+        ::close(notifyFd_);
+        notifyFd_ = -1;
+        lastError_ = "eventfd failed";
+        return false;
+    }
+    // Writer pids need CAP_SYS_ADMIN; without it changes are reported with pid 0
+    writerFd_ = ::fanotify_init(FAN_CLASS_NOTIF | FAN_CLOEXEC | FAN_NONBLOCK, O_RDONLY | O_LARGEFILE);
+#endif
+    for (const auto& directory : directories_) {
+        unwatched_.insert(directory.first);
+    }
+    WatchDirectories();
+
+    {
+        std::lock_guard<std::mutex> lock(dirtyMutex_);
+        dirty_.clear();
+    }
+    reported_.clear();
+    nextSweep_ = options_.sweepInterval.count() > 0 ? std::chrono::steady_clock::now() + options_.sweepInterval
+                                                    : std::chrono::steady_clock::time_point::max();
+    running_.store(true);
+    thread_ = std::thread(&IntegrityWatcher::WatchLoop, this);
+    return true;
+}
+
+void IntegrityWatcher::Stop() {
+    if (!running_.load()) {
+        return;
+    }
+    running_.store(false);
+#ifdef __linux__
+    uint64_t one = 1;
+    (void)::write(wakeFd_, &one, sizeof(one));
+#endif
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+#ifdef __linux__
+    ::close(notifyFd_);
+    ::close(wakeFd_);
+    if (writerFd_ >= 0) {
+        ::close(writerFd_);
+    }
+#endif
+    notifyFd_ = -1;
+    wakeFd_ = -1;
+    writerFd_ = -1;
+    watches_.clear();
+}
+
+void IntegrityWatcher::MarkDirty(const std::string& path, const std::string& change, int pid) {
+    Queue(path, change, pid);
+#ifdef __linux__
+    if (wakeFd_ >= 0) {
+        uint64_t one = 1;
+        (void)::write(wakeFd_, &one, sizeof(one));
+    }
+#endif
+}
+
+void IntegrityWatcher::Queue(const std::string& path, const std::string& change, int pid) {
+    auto now = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> lock(dirtyMutex_);
+    auto inserted = dirty_.emplace(path, Dirty{now, now, change.empty() ? "MODIFY" : change, pid});
+    if (!inserted.second) {
+        Dirty& dirty = inserted.first->second;
+        dirty.last = now;
+        if (!change.empty()) {
+            dirty.change = change;
+        }
+        if (pid != 0) {
+            dirty.pid = pid;
+        }
+    }
+}
+
+IntegrityWatcher::Statistics IntegrityWatcher::GetStatistics() const {
+    std::lock_guard<std::mutex> lock(statsMutex_);
+    return stats_;
+}
+
+void IntegrityWatcher::WatchDirectories() {
+    uint64_t watched = 0;
+    for (auto it = unwatched_.begin(); it != unwatched_.end();) {
+#ifdef __linux__
+        int wd = ::inotify_add_watch(notifyFd_, it->c_str(), kWatchMask);
+        if (wd >= 0) {
+            if (writerFd_ >= 0) {
+                (void)::fanotify_mark(writerFd_, FAN_MARK_ADD, kWriterMask, AT_FDCWD, it->c_str());
+            }
+            watches_[wd].push_back(*it);
+            it = unwatched_.erase(it);
+            watched++;
+            continue;
+        }
+#endif
+        ++it;
+    }
+    std::lock_guard<std::mutex> lock(statsMutex_);
+    stats_.watchedDirectories += watched;
+    stats_.unwatchedDirectories = unwatched_.size();
+}
+
+std::chrono::steady_clock::time_point IntegrityWatcher::NextDeadline() {
+    auto deadline = nextSweep_;
+    std::lock_guard<std::mutex> lock(dirtyMutex_);
+    for (const auto& entry : dirty_) {
+        deadline = std::min(deadline, std::min(entry.second.last + options_.debounce,
+                                               entry.second.first + options_.maxDelay));
+    }
+    return deadline;
+}
+
+void IntegrityWatcher::WatchLoop() {
+    while (running_.load()) {
+        auto now = std::chrono::steady_clock::now();
+        auto deadline = NextDeadline();
+        auto wait = deadline <= now ? std::chrono::milliseconds(0)
+                                    : std::min(kMaxWait, std::chrono::duration_cast<std::chrono::milliseconds>(
+                                                             deadline - now + std::chrono::milliseconds(1)));
+#ifdef __linux__
+        pollfd fds[3] = {{wakeFd_, POLLIN, 0}, {writerFd_, POLLIN, 0}, {notifyFd_, POLLIN, 0}};
+        if (::poll(fds, 3, static_cast<int>(wait.count())) > 0) {
+            if (fds[0].revents & POLLIN) {
+                uint64_t count;
+                (void)::read(wakeFd_, &count, sizeof(count));
+            }
+            if (fds[1].revents & POLLIN) {
+                ReadWriters();
+            }
+            if (fds[2].revents & POLLIN) {
+                ReadEvents();
+            }
+        }
+#else
+        std::this_thread::sleep_for(wait);
+#endif
+        if (!running_.load()) {
+            break;
+        }
+        now = std::chrono::steady_clock::now();
+        RehashReady(now);
+        if (now >= nextSweep_) {
+            Sweep();
+        }
+    }
+}
+
+void IntegrityWatcher::ReadEvents() {
+#ifdef __linux__
+    alignas(inotify_event) char buffer[64 * 1024];
+    for (;;) {
+        ssize_t length = ::read(notifyFd_, buffer, sizeof(buffer));
+        if (length <= 0) {
+            break;
+        }
+        for (ssize_t offset = 0; offset < length;) {
+            const inotify_event* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+            offset += sizeof(inotify_event) + event->len;
+
+            if (event->mask & IN_Q_OVERFLOW) {
+                // Events were lost; only a full pass can tell what changed
+                nextSweep_ = std::chrono::steady_clock::now();
+                std::lock_guard<std::mutex> lock(statsMutex_);
+                stats_.overflows++;
+                continue;
+            }
+            auto watch = watches_.find(event->wd);
+            if (watch == watches_.end()) {
+                continue;
+            }
+            if (event->mask & IN_IGNORED) {
+                // The directory itself went away; its files are gone until a sweep re-watches it
+                for (const auto& directory : watch->second) {
+                    for (const auto& name : directories_[directory]) {
+                        Queue(JoinPath(directory, name), "DELETE");
+                    }
+                    unwatched_.insert(directory);
+                }
+                watches_.erase(watch);
+                continue;
+            }
+            if (event->len == 0) {
+                continue;
+            }
+            const char* change = (event->mask & (IN_DELETE | IN_MOVED_FROM)) ? "DELETE"
+                                 : (event->mask & (IN_CREATE | IN_MOVED_TO)) ? "REPLACE"
+                                                                             : "MODIFY";
+            bool monitored = false;
+            for (const auto& directory : watch->second) {
+                if (directories_[directory].count(event->name)) {
+                    Queue(JoinPath(directory, event->name), change);
+                    monitored = true;
+                }
+            }
+            if (!monitored) {
+                continue;
+            }
+            std::lock_guard<std::mutex> lock(statsMutex_);
+            stats_.events++;
+        }
+    }
+#endif
+}
+
+void IntegrityWatcher::ReadWriters() {
+#ifdef __linux__
+    alignas(fanotify_event_metadata) char buffer[16 * 1024];
+    for (;;) {
+        ssize_t length = ::read(writerFd_, buffer, sizeof(buffer));
+        if (length <= 0) {
+            break;
+        }
+        const fanotify_event_metadata* event = reinterpret_cast<const fanotify_event_metadata*>(buffer);
+        for (; FAN_EVENT_OK(event, length); event = FAN_EVENT_NEXT(event, length)) {
+            if (event->fd < 0) {
+                continue;
+            }
+            char target[PATH_MAX];
+            std::string link = "/proc/self/fd/" + std::to_string(event->fd);
+            ssize_t size = ::readlink(link.c_str(), target, sizeof(target) - 1);
+            ::close(event->fd);
+            if (size <= 0) {
+                continue;
+            }
+            // Only the writer is taken from here; inotify still decides what changed
+            auto monitored = canonical_.find(std::string(target, static_cast<size_t>(size)));
+            if (monitored != canonical_.end()) {
+                Queue(monitored->second, "", event->pid);
+            }
+        }
+    }
+#endif
+}
+
+void IntegrityWatcher::RehashReady(std::chrono::steady_clock::time_point now) {
+    std::vector<std::pair<std::string, Dirty>> ready;
+    {
+        std::lock_guard<std::mutex> lock(dirtyMutex_);
+        for (auto it = dirty_.begin(); it != dirty_.end();) {
+            if (now >= it->second.last + options_.debounce || now >= it->second.first + options_.maxDelay) {
+                ready.emplace_back(it->first, it->second);
+                it = dirty_.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+    // inotify does not say which bytes changed, so Merkle files are rehashed whole
+    const std::vector<MerkleTree::ByteRange> wholeFile{{0, std::numeric_limits<uint64_t>::max()}};
+    for (const auto& entry : ready) {
+        IntegritySystem::FileInfo file = IntegritySystem::VerifyFileRanges(entry.first, wholeFile);
+        {
+            std::lock_guard<std::mutex> lock(statsMutex_);
+            stats_.filesRehashed++;
+        }
+        Report(file, entry.second.change, entry.second.pid);
+    }
+}
+
+void IntegrityWatcher::Sweep() {
+    auto started = std::chrono::steady_clock::now();
+    WatchDirectories();
+    IntegritySystem::IntegrityReport report = IntegritySystem::PerformIntegrityCheck();
+    for (const auto& file : report.files) {
+        auto known = reported_.find(file.path);
+        if (file.isValid) {
+            if (known != reported_.end()) {
+                reported_.erase(known);
+            }
+        } else if (known == reported_.end() || known->second != file.actualHash) {
+            Report(file, "SWEEP", 0);
+        }
+    }
+    {
+        // Everything changed before the pass started has just been verified
+        std::lock_guard<std::mutex> lock(dirtyMutex_);
+        for (auto it = dirty_.begin(); it != dirty_.end();) {
+            it = it->second.last < started ? dirty_.erase(it) : std::next(it);
+        }
+    }
+    nextSweep_ = options_.sweepInterval.count() > 0 ? std::chrono::steady_clock::now() + options_.sweepInterval
+                                                    : std::chrono::steady_clock::time_point::max();
+    std::lock_guard<std::mutex> lock(statsMutex_);
+    stats_.sweeps++;
+}
+
+void IntegrityWatcher::Report(const IntegritySystem::FileInfo& file, const std::string& change, int pid) {
+    if (file.isValid) {
+        reported_.erase(file.path);
+    } else {
+        reported_[file.path] = file.actualHash;
+        std::lock_guard<std::mutex> lock(statsMutex_);
+        stats_.mismatches++;
+    }
+    if (callback_) {
+        callback_(file, change, pid);
+    }
+}
@@ -0,0 +1,344 @@
+#include "IocMatcher.h"
+#include "Utils.h"
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <sstream>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#include <immintrin.h>
+#define IOC_X86_DISPATCH 1
+#endif
+
+namespace {
+    struct PrefilterTables {
+        const uint8_t* nibbleLow;
+        const uint8_t* nibbleHigh;
+        const bool* firstByte;
+        const uint64_t* pairBits;
+        const uint8_t* fold;
+    };
+
+    // The byte at position can start a match only if its pair with the next byte can
+    inline bool PairPossible(const PrefilterTables& tables, const uint8_t* data, size_t position, size_t length) {
+        if (position + 1 >= length) {
+            return true;
+        }
+        uint32_t pair = (static_cast<uint32_t>(tables.fold[data[position]]) << 8) | tables.fold[data[position + 1]];
+        return (tables.pairBits[pair >> 6] >> (pair & 63)) & 1;
+    }
+
+    size_t ScalarCandidate(const PrefilterTables& tables, const uint8_t* data, size_t position, size_t length) {
+        for (; position < length; ++position) {
+            if (tables.firstByte[data[position]] && PairPossible(tables, data, position, length)) {
+                return position;
+            }
+        }
+        return length;
+    }
+
+#ifdef IOC_X86_DISPATCH
+    // Shufti: a byte is a candidate when nibbleLow[b & 15] & nibbleHigh[b >> 4] is non-zero
+    __attribute__((target("ssse3")))
+    size_t Ssse3Candidate(const PrefilterTables& tables, const uint8_t* data, size_t position, size_t length) {
+        const __m128i low = _mm_load_si128(reinterpret_cast<const __m128i*>(tables.nibbleLow));
+        const __m128i high = _mm_load_si128(reinterpret_cast<const __m128i*>(tables.nibbleHigh));
+        const __m128i nibble = _mm_set1_epi8(0x0F);
+        const __m128i zero = _mm_setzero_si128();
+        while (position + 16 <= length) {
+            __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + position));
+            __m128i lowHits = _mm_shuffle_epi8(low, _mm_and_si128(bytes, nibble));
+            __m128i highHits = _mm_shuffle_epi8(high, _mm_and_si128(_mm_srli_epi16(bytes, 4), nibble));
+            uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(lowHits, highHits), zero))) ^ 0xFFFFu;
+            while (mask) {
+                size_t candidate = position + static_cast<size_t>(__builtin_ctz(mask));
+                if (tables.firstByte[data[candidate]] && PairPossible(tables, data, candidate, length)) {
+                    return candidate;
+                }
+                mask &= mask - 1;
+            }
+            position += 16;
+        }
+        return ScalarCandidate(tables, data, position, length);
+    }
+
+    __attribute__((target("avx2")))
+    size_t Avx2Candidate(const PrefilterTables& tables, const uint8_t* data, size_t position, size_t length) {
+        const __m256i low = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(tables.nibbleLow)));
+        const __m256i high = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(tables.nibbleHigh)));
+        const __m256i nibble = _mm256_set1_epi8(0x0F);
+        const __m256i zero = _mm256_setzero_si256();
+        while (position + 32 <= length) {
+            __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + position));
+            __m256i lowHits = _mm256_shuffle_epi8(low, _mm256_and_si256(bytes, nibble));
+            __m256i highHits = _mm256_shuffle_epi8(high, _mm256_and_si256(_mm256_srli_epi16(bytes, 4), nibble));
+            uint32_t mask = ~static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_and_si256(lowHits, highHits), zero)));
+            while (mask) {
+                size_t candidate = position + static_cast<size_t>(__builtin_ctz(mask));
+                if (tables.firstByte[data[candidate]] && PairPossible(tables, data, candidate, length)) {
+                    return candidate;
+                }
+                mask &= mask - 1;
+            }
+            position += 32;
+        }
+        return ScalarCandidate(tables, data, position, length);
+    }
+#endif
+
+    using CandidateFunction = size_t (*)(const PrefilterTables&, const uint8_t*, size_t, size_t);
+
+    struct PrefilterChoice {
+        CandidateFunction function;
+        const char* name;
+    };
+
+    const PrefilterChoice& SelectPrefilter() {
+        static const PrefilterChoice choice = [] {
+#ifdef IOC_X86_DISPATCH
+            __builtin_cpu_init();
+            if (__builtin_cpu_supports("avx2")) {
+                return PrefilterChoice{Avx2Candidate, "avx2"};
+            }
+            if (__builtin_cpu_supports("ssse3")) {
+                return PrefilterChoice{Ssse3Candidate, "ssse3"};
+            }
+#endif
+            return PrefilterChoice{ScalarCandidate, "scalar"};
+        }();
+        return choice;
+    }
+}
+
+IocMatcher::IocMatcher(const Options& options)
+    : options_(options), compiled_(false), pairBits_(1024, 0) {
+    for (int i = 0; i < 256; ++i) {
+        fold_[i] = static_cast<uint8_t>(options_.caseInsensitive && i >= 'A' && i <= 'Z' ? i + 32 : i);
+        rootNext_[i] = 0;
+        firstByte_[i] = false;
+    }
+    std::memset(nibbleLow_, 0, sizeof(nibbleLow_));
+    std::memset(nibbleHigh_, 0, sizeof(nibbleHigh_));
+}
+
+const char* IocMatcher::GetPrefilterName() {
+    return SelectPrefilter().name;
+}
+
+uint32_t IocMatcher::AddPattern(std::string_view pattern) {
+    std::string folded(pattern);
+    for (auto& c : folded) {
+        c = static_cast<char>(fold_[static_cast<uint8_t>(c)]);
+    }
+    auto it = patternIds_.find(folded);
+    if (it != patternIds_.end()) {
+        return it->second;
+    }
+    uint32_t id = static_cast<uint32_t>(patterns_.size());
+    patterns_.emplace_back(pattern);
+    patternIds_.emplace(std::move(folded), id);
+    compiled_ = false;
+    return id;
+}
+
+bool IocMatcher::LoadPatterns(const std::string& file) {
+    if (!Utils::FileExists(file)) {
+        lastError_ = "Indicator file not found: " + file;
+        return false;
+    }
+    std::istringstream lines(Utils::ReadFile(file));
+    std::string line;
+    while (std::getline(lines, line)) {
+        line = Utils::Trim(line);
+        if (!line.empty() && line[0] != '#') {
+            AddPattern(line);
+        }
+    }
+    return true;
+}
+
+void IocMatcher::Compile() {
+    // Build the trie with per-state child lists, then flatten
+    std::vector<std::vector<std::pair<uint8_t, uint32_t>>> children(1);
+    std::vector<std::vector<uint32_t>> ownOutputs(1);
+    patternLength_.assign(patterns_.size(), 0);
+
+    auto child = [&children](uint32_t state, uint8_t byte) -> uint32_t {
+        for (const auto& edge : children[state]) {
+            if (edge.first == byte) {
+                return edge.second;
+            }
+        }
+        return 0;
+    };
+
+    for (const auto& entry : patternIds_) {
+        const std::string& folded = entry.first;
+        patternLength_[entry.second] = static_cast<uint32_t>(folded.size());
+        if (folded.empty()) {
+            continue;
+        }
+        uint32_t state = 0;
+        for (char c : folded) {
+            uint8_t byte = static_cast<uint8_t>(c);
+            uint32_t next = child(state, byte);
+            if (next == 0) {
+                next = static_cast<uint32_t>(children.size());
+                children[state].emplace_back(byte, next);
+                children.emplace_back();
+                ownOutputs.emplace_back();
+            }
+            state = next;
+        }
+        ownOutputs[state].push_back(entry.second);
+    }
+
+    const size_t states = children.size();
+    fail_.assign(states, 0);
+    dictionaryLink_.assign(states, 0);
+
+    // Breadth-first: a state's fail link is resolved before its children's
+    std::deque<uint32_t> queue;
+    for (const auto& edge : children[0]) {
+        queue.push_back(edge.second);
+    }
+    while (!queue.empty()) {
+        uint32_t state = queue.front();
+        queue.pop_front();
+        for (const auto& edge : children[state]) {
+            uint32_t fallback = fail_[state];
+            uint32_t target = child(fallback, edge.first);
+            while (fallback != 0 && target == 0) {
+                fallback = fail_[fallback];
+                target = child(fallback, edge.first);
+            }
+            fail_[edge.second] = target;
+            dictionaryLink_[edge.second] = !ownOutputs[target].empty() ? target : dictionaryLink_[target];
+            queue.push_back(edge.second);
+        }
+    }
+
+    edgeStart_.assign(states, 0);
+    edgeCount_.assign(states, 0);
+    edgeBytes_.clear();
+    edgeTargets_.clear();
+    outputStart_.assign(states, 0);
+    outputCount_.assign(states, 0);
+    outputs_.clear();
+    for (size_t state = 0; state < states; ++state) {
+        auto& edges = children[state];
+        std::sort(edges.begin(), edges.end());
+        edgeStart_[state] = static_cast<uint32_t>(edgeBytes_.size());
+        edgeCount_[state] = static_cast<uint16_t>(edges.size());
+        for (const auto& edge : edges) {
+            edgeBytes_.push_back(edge.first);
+            edgeTargets_.push_back(edge.second);
+        }
+        outputStart_[state] = static_cast<uint32_t>(outputs_.size());
+        outputCount_[state] = static_cast<uint32_t>(ownOutputs[state].size());
+        outputs_.insert(outputs_.end(), ownOutputs[state].begin(), ownOutputs[state].end());
+    }
+
+    // Root transitions and prefilter tables
+    std::fill(std::begin(rootNext_), std::end(rootNext_), 0);
+    std::fill(std::begin(firstByte_), std::end(firstByte_), false);
+    std::fill(pairBits_.begin(), pairBits_.end(), 0);
+    std::memset(nibbleLow_, 0, sizeof(nibbleLow_));
+    std::memset(nibbleHigh_, 0, sizeof(nibbleHigh_));
+    auto setPair = [this](uint32_t pair) { pairBits_[pair >> 6] |= 1ULL << (pair & 63); };
+    for (const auto& edge : children[0]) {
+        rootNext_[edge.first] = edge.second;
+        for (int raw = 0; raw < 256; ++raw) {
+            if (fold_[raw] != edge.first) {
+                continue;
+            }
+            firstByte_[raw] = true;
+            uint8_t bucket = static_cast<uint8_t>(1u << ((raw >> 4) & 7));
+            nibbleLow_[raw & 15] |= bucket;
+            nibbleHigh_[raw >> 4] |= bucket;
+        }
+        // Single-byte patterns match whatever follows
+        bool anyNext = !ownOutputs[edge.second].empty();
+        for (const auto& second : children[edge.second]) {
+            setPair((static_cast<uint32_t>(edge.first) << 8) | second.first);
+        }
+        if (anyNext) {
+            for (uint32_t next = 0; next < 256; ++next) {
+                setPair((static_cast<uint32_t>(edge.first) << 8) | next);
+            }
+        }
+    }
+    compiled_ = true;
+}
+
+inline uint32_t IocMatcher::Next(uint32_t state, uint8_t byte) const {
+    while (state != 0) {
+        const uint32_t start = edgeStart_[state];
+        const uint32_t count = edgeCount_[state];
+        const uint8_t* bytes = edgeBytes_.data() + start;
+        if (count <= 8) {
+            for (uint32_t i = 0; i < count; ++i) {
+                if (bytes[i] == byte) {
+                    return edgeTargets_[start + i];
+                }
+            }
+        } else {
+            const uint8_t* found = std::lower_bound(bytes, bytes + count, byte);
+            if (found != bytes + count && *found == byte) {
+                return edgeTargets_[start + static_cast<uint32_t>(found - bytes)];
+            }
+        }
+        state = fail_[state];
+    }
+    return rootNext_[byte];
+}
+
+template <typename Emit>
+void IocMatcher::Run(std::string_view text, Emit emit) const {
+    if (!compiled_ || patternIds_.empty()) {
+        return;
+    }
+    const uint8_t* data = reinterpret_cast<const uint8_t*>(text.data());
+    const size_t length = text.size();
+    const PrefilterTables tables{nibbleLow_, nibbleHigh_, firstByte_, pairBits_.data(), fold_};
+    const CandidateFunction candidate = SelectPrefilter().function;
+
+    uint32_t state = 0;
+    size_t position = 0;
+    while (position < length) {
+        if (state == 0) {
+            // Nothing in flight: skip straight to the next byte that can start a pattern
+            position = candidate(tables, data, position, length);
+            if (position >= length) {
+                break;
+            }
+        }
+        state = Next(state, fold_[data[position]]);
+        ++position;
+        for (uint32_t output = outputCount_[state] ? state : dictionaryLink_[state]; output != 0;
+             output = dictionaryLink_[output]) {
+            for (uint32_t i = 0; i < outputCount_[output]; ++i) {
+                uint32_t id = outputs_[outputStart_[output] + i];
+                if (!emit(id, position - patternLength_[id], position)) {
+                    return;
+                }
+            }
+        }
+    }
+}
+
+void IocMatcher::Scan(std::string_view text, std::vector<Match>& matches) const {
+    Run(text, [&matches](uint32_t id, size_t start, size_t end) {
+        matches.push_back(Match{id, start, end});
+        return true;
+    });
+}
+
+bool IocMatcher::Contains(std::string_view text) const {
+    bool found = false;
+    Run(text, [&found](uint32_t, size_t, size_t) {
+        found = true;
+        return false;
+    });
+    return found;
+}
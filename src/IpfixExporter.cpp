@@ -0,0 +1,302 @@
+#include "IpfixExporter.h"
+#include <algorithm>
+#include <cstring>
+#include <ctime>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <sys/socket.h>
+#include <netdb.h>
+#include <unistd.h>
+#endif
+
+namespace {
+    const uint16_t IPFIX_VERSION = 10;
+    const uint16_t TEMPLATE_SET_ID = 2;
+    const size_t MESSAGE_HEADER_LENGTH = 16;
+    const uint32_t REVERSE_PEN = 29305;    // RFC 5103 reverse information elements
+
+    struct Field {
+        uint16_t id;
+        uint16_t length;
+        bool reverse;
+    };
+
+    // Field order here defines the data record layout written by AppendRecord
+    const Field FIELDS_IPV4[] = {
+        {152, 8, false},  // flowStartMilliseconds
+        {153, 8, false},  // flowEndMilliseconds
+        {8, 4, false},    // sourceIPv4Address
+        {12, 4, false},   // destinationIPv4Address
+        {7, 2, false},    // sourceTransportPort
+        {11, 2, false},   // destinationTransportPort
+        {4, 1, false},    // protocolIdentifier
+        {6, 2, false},    // tcpControlBits
+        {136, 1, false},  // flowEndReason
+        {1, 8, false},    // octetDeltaCount
+        {2, 8, false},    // packetDeltaCount
+        {1, 8, true},     // reverseOctetDeltaCount
+        {2, 8, true},     // reversePacketDeltaCount
+        {6, 2, true},     // reverseTcpControlBits
+    };
+
+    const Field FIELDS_IPV6[] = {
+        {152, 8, false}, {153, 8, false},
+        {27, 16, false},  // sourceIPv6Address
+        {28, 16, false},  // destinationIPv6Address
+        {7, 2, false}, {11, 2, false}, {4, 1, false}, {6, 2, false}, {136, 1, false},
+        {1, 8, false}, {2, 8, false}, {1, 8, true}, {2, 8, true}, {6, 2, true},
+    };
+
+    void Put16(std::vector<uint8_t>& out, uint16_t value) {
+        out.push_back(static_cast<uint8_t>(value >> 8));
+        out.push_back(static_cast<uint8_t>(value));
+    }
+
+    void Put32(std::vector<uint8_t>& out, uint32_t value) {
+        for (int shift = 24; shift >= 0; shift -= 8) {
+            out.push_back(static_cast<uint8_t>(value >> shift));
+        }
+    }
+
+    void Put64(std::vector<uint8_t>& out, uint64_t value) {
+        for (int shift = 56; shift >= 0; shift -= 8) {
+            out.push_back(static_cast<uint8_t>(value >> shift));
+        }
+    }
+
+    void Patch16(std::vector<uint8_t>& out, size_t offset, uint16_t value) {
+        out[offset] = static_cast<uint8_t>(value >> 8);
+        out[offset + 1] = static_cast<uint8_t>(value);
+    }
+
+    void Patch32(std::vector<uint8_t>& out, size_t offset, uint32_t value) {
+        for (int i = 0; i < 4; ++i) {
+            out[offset + i] = static_cast<uint8_t>(value >> (24 - 8 * i));
+        }
+    }
+
+    template <size_t N>
+    void PutTemplate(std::vector<uint8_t>& out, uint16_t templateId, const Field (&fields)[N]) {
+        Put16(out, templateId);
+        Put16(out, static_cast<uint16_t>(N));
+        for (const Field& field : fields) {
+            Put16(out, static_cast<uint16_t>(field.reverse ? (field.id | 0x8000) : field.id));
+            Put16(out, field.length);
+            if (field.reverse) {
+                Put32(out, REVERSE_PEN);
+            }
+        }
+    }
+
+#ifdef _WIN32
+    const uintptr_t NO_SOCKET = static_cast<uintptr_t>(INVALID_SOCKET);
+#else
+    const int NO_SOCKET = -1;
+#endif
+}
+
+IpfixExporter::IpfixExporter(const Options& options)
+    : options_(options), socket_(NO_SOCKET), setOffset_(0), setTemplate_(0), messageRecords_(0),
+      sequence_(0), templatesDue_(true) {
+    stats_ = Statistics{0, 0, 0, 0, 0};
+    // Never smaller than one header, one template set and one record
+    options_.maxDatagram = std::max<size_t>(options_.maxDatagram, 512);
+}
+
+IpfixExporter::~IpfixExporter() {
+    Flush();
+    Close();
+}
+
+bool IpfixExporter::Open(const std::string& collector) {
+    Close();
+#ifdef _WIN32
+    static bool winsockReady = [] {
+        WSADATA data;
+        return WSAStartup(MAKEWORD(2, 2), &data) == 0;
+    }();
+    if (!winsockReady) {
+        lastError_ = "WSAStartup failed";
+        return false;
+    }
+#endif
+
+    std::string host;
+    std::string port;
+    size_t colon = collector.rfind(':');
+    if (colon == std::string::npos || colon + 1 >= collector.size()) {
+        lastError_ = "Collector must be host:port: " + collector;
+        return false;
+    }
+    host = collector.substr(0, colon);
+    port = collector.substr(colon + 1);
+    if (host.size() >= 2 && host.front() == '[' && host.back() == ']') {
+        host = host.substr(1, host.size() - 2);
+    }
+
+    addrinfo hints;
+    std::memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_DGRAM;
+    addrinfo* result = nullptr;
+    int status = getaddrinfo(host.c_str(), port.c_str(), &hints, &result);
+    if (status != 0) {
+        lastError_ = "Cannot resolve collector " + collector + ": " + gai_strerror(status);
+        return false;
+    }
+
+    for (addrinfo* ai = result; ai; ai = ai->ai_next) {
+        auto fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (fd == static_cast<decltype(fd)>(NO_SOCKET)) {
+            continue;
+        }
+        if (connect(fd, ai->ai_addr, static_cast<int>(ai->ai_addrlen)) == 0) {
+            socket_ = fd;
+            break;
+        }
+#ifdef _WIN32
+        closesocket(fd);
+#else
+        close(fd);
+#endif
+    }
+    freeaddrinfo(result);
+
+    if (socket_ == NO_SOCKET) {
+        lastError_ = "Cannot connect to collector " + collector;
+        return false;
+    }
+    templatesDue_ = true;
+    return true;
+}
+
+void IpfixExporter::Close() {
+    if (socket_ == NO_SOCKET) {
+        return;
+    }
+#ifdef _WIN32
+    closesocket(socket_);
+#else
+    close(socket_);
+#endif
+    socket_ = NO_SOCKET;
+}
+
+bool IpfixExporter::IsOpen() const {
+    return socket_ != NO_SOCKET;
+}
+
+void IpfixExporter::BeginMessage() {
+    message_.clear();
+    message_.resize(MESSAGE_HEADER_LENGTH, 0);
+    setOffset_ = 0;
+    messageRecords_ = 0;
+
+    auto now = std::chrono::steady_clock::now();
+    if (templatesDue_ || now - lastTemplates_ >= options_.templateRefresh) {
+        AppendTemplates();
+        lastTemplates_ = now;
+        templatesDue_ = false;
+    }
+}
+
+void IpfixExporter::AppendTemplates() {
+    size_t start = message_.size();
+    Put16(message_, TEMPLATE_SET_ID);
+    Put16(message_, 0);
+    PutTemplate(message_, TEMPLATE_IPV4, FIELDS_IPV4);
+    PutTemplate(message_, TEMPLATE_IPV6, FIELDS_IPV6);
+    Patch16(message_, start + 2, static_cast<uint16_t>(message_.size() - start));
+    stats_.templates += 2;
+}
+
+void IpfixExporter::CloseSet() {
+    if (setOffset_ != 0) {
+        Patch16(message_, setOffset_ + 2, static_cast<uint16_t>(message_.size() - setOffset_));
+        setOffset_ = 0;
+    }
+}
+
+void IpfixExporter::AppendRecord(const FlowTable::FlowRecord& record) {
+    const bool isIPv6 = record.ipVersion == 6;
+    const uint16_t templateId = isIPv6 ? TEMPLATE_IPV6 : TEMPLATE_IPV4;
+    const size_t length = isIPv6 ? RECORD_LENGTH_IPV6 : RECORD_LENGTH_IPV4;
+
+    if (message_.empty()) {
+        BeginMessage();
+    }
+    bool continueSet = setOffset_ != 0 && setTemplate_ == templateId;
+    if (message_.size() + length + (continueSet ? 0 : 4) > options_.maxDatagram) {
+        Send();
+        BeginMessage();
+        continueSet = false;
+    }
+    if (!continueSet) {
+        CloseSet();
+        setOffset_ = message_.size();
+        setTemplate_ = templateId;
+        Put16(message_, templateId);
+        Put16(message_, 0);
+    }
+
+    Put64(message_, record.startNs / 1000000);
+    Put64(message_, record.endNs / 1000000);
+    const size_t addressLength = isIPv6 ? 16 : 4;
+    message_.insert(message_.end(), record.srcAddr, record.srcAddr + addressLength);
+    message_.insert(message_.end(), record.dstAddr, record.dstAddr + addressLength);
+    Put16(message_, record.srcPort);
+    Put16(message_, record.dstPort);
+    message_.push_back(record.protocol);
+    Put16(message_, record.tcpFlags);
+    message_.push_back(record.endReason);
+    Put64(message_, record.bytes);
+    Put64(message_, record.packets);
+    Put64(message_, record.reverseBytes);
+    Put64(message_, record.reversePackets);
+    Put16(message_, record.reverseTcpFlags);
+    messageRecords_++;
+}
+
+void IpfixExporter::Send() {
+    if (message_.empty()) {
+        return;
+    }
+    CloseSet();
+    Patch16(message_, 0, IPFIX_VERSION);
+    Patch16(message_, 2, static_cast<uint16_t>(message_.size()));
+    Patch32(message_, 4, static_cast<uint32_t>(std::time(nullptr)));
+    Patch32(message_, 8, sequence_);
+    Patch32(message_, 12, options_.observationDomainId);
+
+    // Sequence numbers count data records, sent or not, so collectors can detect loss
+    sequence_ += messageRecords_;
+    auto sent = send(socket_, reinterpret_cast<const char*>(message_.data()), static_cast<int>(message_.size()), 0);
+    if (sent >= 0 && static_cast<size_t>(sent) == message_.size()) {
+        stats_.messages++;
+        stats_.records += messageRecords_;
+        stats_.bytes += message_.size();
+    } else {
+        stats_.sendErrors++;
+    }
+    message_.clear();
+    setOffset_ = 0;
+    messageRecords_ = 0;
+}
+
+void IpfixExporter::Export(const std::vector<FlowTable::FlowRecord>& records) {
+    if (!IsOpen()) {
+        return;
+    }
+    for (const auto& record : records) {
+        AppendRecord(record);
+    }
+}
+
+void IpfixExporter::Flush() {
+    if (IsOpen() && messageRecords_ > 0) {
+        Send();
+    }
+}
@@ -80,48 +80,65 @@ namespace JsonReporting {
         return json.str();
     }
     
-    std::string SecurityReportToJson(const SecurityReport& report) {
-        std::ostringstream json;
-        json << "{\n";
-        json << "  \"report_id\": \"" << Utils::EscapeJson(report.reportId) << "\",\n";
-        json << "  \"version\": \"" << Utils::EscapeJson(report.version) << "\",\n";
+    ReportWriter::ReportWriter(std::ostream& out) : out_(out), written_(0) {
+    }
+    
+    void ReportWriter::Begin(const SecurityReport& report) {
+        written_ = 0;
+        out_ << "{\n";
+        out_ << "  \"report_id\": \"" << Utils::EscapeJson(report.reportId) << "\",\n";
+        out_ << "  \"version\": \"" << Utils::EscapeJson(report.version) << "\",\n";
         
         // Generated timestamp
         auto time_t = std::chrono::system_clock::to_time_t(report.generatedAt);
-        json << "  \"generated_at\": " << time_t << ",\n";
+        out_ << "  \"generated_at\": " << time_t << ",\n";
         
         // System information
         if (!report.systemInfo.empty()) {
-            json << "  \"system_info\": {\n";
+            out_ << "  \"system_info\": {\n";
             bool first = true;
             for (const auto& pair : report.systemInfo) {
-                if (!first) json << ",\n";
-                json << "    \"" << Utils::EscapeJson(pair.first) << "\": \"" 
+                if (!first) out_ << ",\n";
+                out_ << "    \"" << Utils::EscapeJson(pair.first) << "\": \"" 
                      << Utils::EscapeJson(pair.second) << "\"";
                 first = false;
             }
-            json << "\n  },\n";
+            out_ << "\n  },\n";
         }
         
-        // Results
-        json << "  \"results\": [\n";
-        for (size_t i = 0; i < report.results.size(); ++i) {
-            if (i > 0) json << ",\n";
-            
-            // Indent the check result JSON
-            std::string checkJson = CheckResultToJson(report.results[i]);
-            std::istringstream iss(checkJson);
-            std::string line;
-            bool firstLine = true;
-            while (std::getline(iss, line)) {
-                if (!firstLine) json << "\n";
-                json << "    " << line;
-                firstLine = false;
-            }
-        }
-        json << "\n  ]\n";
-        json << "}";
+        out_ << "  \"results\": [\n";
+    }
+    
+    void ReportWriter::Write(const CheckResult& result) {
+        if (written_++ > 0) out_ << ",\n";
         
+        // Indent the check result JSON
+        std::string checkJson = CheckResultToJson(result);
+        std::istringstream iss(checkJson);
+        std::string line;
+        bool firstLine = true;
+        while (std::getline(iss, line)) {
+            if (!firstLine) out_ << "\n";
+            out_ << "    " << line;
+            firstLine = false;
+        }
+    }
+    
+    bool ReportWriter::End() {
+        out_ << "\n  ]\n";
+        out_ << "}";
+        out_.flush();
+        return static_cast<bool>(out_);
+    }
+    
+    std::string SecurityReportToJson(const SecurityReport& report) {
+        std::ostringstream json;
+        ReportWriter writer(json);
+        writer.Begin(report);
+        for (const auto& result : report.results) {
+            writer.Write(result);
+        }
+        writer.End();
         return json.str();
     }
     
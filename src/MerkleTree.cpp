@@ -0,0 +1,227 @@
+#include "MerkleTree.h"
+#include <algorithm>
+#include <cstdlib>
+
+namespace {
+    const char* kPrefix = "merkle/";
+    const uint8_t kLeafTag = 0x00;
+    const uint8_t kNodeTag = 0x01;
+
+    int HexValue(char c) {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        return -1;
+    }
+
+    bool ParseDigest(const std::string& text, size_t offset, MerkleTree::Digest& digest) {
+        if (offset + 2 * digest.size() > text.size()) {
+            return false;
+        }
+        for (size_t i = 0; i < digest.size(); ++i) {
+            int high = HexValue(text[offset + 2 * i]);
+            int low = HexValue(text[offset + 2 * i + 1]);
+            if (high < 0 || low < 0) {
+                return false;
+            }
+            digest[i] = static_cast<uint8_t>(high << 4 | low);
+        }
+        return true;
+    }
+
+    // Splits "merkle/a/b/..." into its fields after the prefix
+    std::vector<std::string> SplitFields(const std::string& text) {
+        std::vector<std::string> fields;
+        if (text.compare(0, 7, kPrefix) != 0) {
+            return fields;
+        }
+        size_t start = 7;
+        for (;;) {
+            size_t slash = text.find('/', start);
+            fields.push_back(text.substr(start, slash - start));
+            if (slash == std::string::npos) {
+                return fields;
+            }
+            start = slash + 1;
+        }
+    }
+}
+
+MerkleTree::MerkleTree() : chunkSize_(DefaultChunkSize), fileSize_(0) {
+}
+
+void MerkleTree::Reset(uint64_t fileSize, size_t chunkSize) {
+    chunkSize_ = std::max<size_t>(1, chunkSize);
+    fileSize_ = fileSize;
+    // An empty file still has one (empty) chunk so every tree has a root
+    size_t chunks = static_cast<size_t>(std::max<uint64_t>(1, (fileSize + chunkSize_ - 1) / chunkSize_));
+    levels_.assign(1, std::vector<Digest>(chunks));
+}
+
+void MerkleTree::HashChunk(size_t index, const uint8_t* data, size_t length) {
+    Sha256 sha;
+    sha.Update(&kLeafTag, 1);
+    sha.Update(data, length);
+    sha.Final(levels_[0][index].data());
+}
+
+void MerkleTree::Finish() {
+    levels_.resize(1);
+    while (levels_.back().size() > 1) {
+        const std::vector<Digest>& below = levels_.back();
+        std::vector<Digest> level((below.size() + 1) / 2);
+        for (size_t i = 0; i < level.size(); ++i) {
+            if (2 * i + 1 == below.size()) {
+                level[i] = below[2 * i];
+                continue;
+            }
+            Sha256 sha;
+            sha.Update(&kNodeTag, 1);
+            sha.Update(below[2 * i].data(), below[2 * i].size());
+            sha.Update(below[2 * i + 1].data(), below[2 * i + 1].size());
+            sha.Final(level[i].data());
+        }
+        levels_.push_back(std::move(level));
+    }
+}
+
+MerkleTree::ByteRange MerkleTree::GetChunkRange(size_t index) const {
+    uint64_t offset = static_cast<uint64_t>(index) * chunkSize_;
+    return ByteRange{offset, std::min<uint64_t>(chunkSize_, fileSize_ - std::min(fileSize_, offset))};
+}
+
+MerkleTree::Digest MerkleTree::GetRoot() const {
+    return levels_.empty() ? Digest{} : levels_.back()[0];
+}
+
+std::string MerkleTree::GetId() const {
+    return kPrefix + std::to_string(chunkSize_) + "/" + Sha256::ToHex(GetRoot().data());
+}
+
+std::string MerkleTree::Serialize() const {
+    std::string text = GetId() + "/" + std::to_string(fileSize_) + "/";
+    text.reserve(text.size() + GetChunkCount() * 2 * Sha256::DigestSize);
+    for (size_t i = 0; i < GetChunkCount(); ++i) {
+        text += Sha256::ToHex(levels_[0][i].data());
+    }
+    return text;
+}
+
+bool MerkleTree::Parse(const std::string& text, MerkleTree& tree) {
+    std::vector<std::string> fields = SplitFields(text);
+    if (fields.size() != 4) {
+        return false;
+    }
+    char* end = nullptr;
+    unsigned long long chunkSize = std::strtoull(fields[0].c_str(), &end, 10);
+    if (chunkSize == 0 || *end != '\0') {
+        return false;
+    }
+    unsigned long long fileSize = std::strtoull(fields[2].c_str(), &end, 10);
+    if (*end != '\0') {
+        return false;
+    }
+    Digest root;
+    if (fields[1].size() != 2 * root.size() || !ParseDigest(fields[1], 0, root)) {
+        return false;
+    }
+    MerkleTree parsed;
+    parsed.Reset(fileSize, static_cast<size_t>(chunkSize));
+    const std::string& leaves = fields[3];
+    if (leaves.size() != parsed.GetChunkCount() * 2 * root.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < parsed.GetChunkCount(); ++i) {
+        if (!ParseDigest(leaves, i * 2 * root.size(), parsed.levels_[0][i])) {
+            return false;
+        }
+    }
+    parsed.Finish();
+    if (parsed.GetRoot() != root) {
+        return false;
+    }
+    tree = std::move(parsed);
+    return true;
+}
+
+bool MerkleTree::IsMerkleId(const std::string& hash) {
+    return ChunkSizeOf(hash) != 0;
+}
+
+size_t MerkleTree::ChunkSizeOf(const std::string& hash) {
+    std::vector<std::string> fields = SplitFields(hash);
+    if (fields.size() < 2 || fields[0].empty()) {
+        return 0;
+    }
+    char* end = nullptr;
+    unsigned long long chunkSize = std::strtoull(fields[0].c_str(), &end, 10);
+    return *end == '\0' ? static_cast<size_t>(chunkSize) : 0;
+}
+
+std::vector<size_t> MerkleTree::ChunksIn(const std::vector<ByteRange>& ranges) const {
+    std::vector<size_t> chunks;
+    for (const auto& range : ranges) {
+        if (range.length == 0 || range.offset >= fileSize_) {
+            continue;
+        }
+        uint64_t last = std::min(fileSize_, range.offset + range.length) - 1;
+        for (uint64_t chunk = range.offset / chunkSize_; chunk <= last / chunkSize_; ++chunk) {
+            chunks.push_back(static_cast<size_t>(chunk));
+        }
+    }
+    std::sort(chunks.begin(), chunks.end());
+    chunks.erase(std::unique(chunks.begin(), chunks.end()), chunks.end());
+    return chunks;
+}
+
+void MerkleTree::AddRange(std::vector<ByteRange>& ranges, uint64_t offset, uint64_t length) {
+    if (length == 0) {
+        return;
+    }
+    if (!ranges.empty() && ranges.back().offset + ranges.back().length == offset) {
+        ranges.back().length += length;
+    } else {
+        ranges.push_back(ByteRange{offset, length});
+    }
+}
+
+void MerkleTree::DiffNode(const MerkleTree& other, size_t level, size_t index, std::vector<ByteRange>& ranges) const {
+    if (levels_[level][index] == other.levels_[level][index]) {
+        return;
+    }
+    if (level == 0) {
+        ByteRange range = GetChunkRange(index);
+        AddRange(ranges, range.offset, range.length);
+        return;
+    }
+    DiffNode(other, level - 1, 2 * index, ranges);
+    if (2 * index + 1 < levels_[level - 1].size()) {
+        DiffNode(other, level - 1, 2 * index + 1, ranges);
+    }
+}
+
+std::vector<MerkleTree::ByteRange> MerkleTree::Diff(const MerkleTree& expected, const MerkleTree& actual) {
+    std::vector<ByteRange> ranges;
+    uint64_t longest = std::max(expected.fileSize_, actual.fileSize_);
+    if (expected.chunkSize_ != actual.chunkSize_ || expected.levels_.empty() || actual.levels_.empty()) {
+        AddRange(ranges, 0, longest);
+        return ranges;
+    }
+    if (expected.fileSize_ == actual.fileSize_) {
+        // Same shape: skip every subtree whose hashes agree
+        expected.DiffNode(actual, expected.levels_.size() - 1, 0, ranges);
+        return ranges;
+    }
+    // Different lengths: compare the shared chunks, then everything past the shorter file
+    uint64_t shortest = std::min(expected.fileSize_, actual.fileSize_);
+    size_t fullChunks = static_cast<size_t>(shortest / expected.chunkSize_);
+    for (size_t i = 0; i < fullChunks; ++i) {
+        if (expected.levels_[0][i] != actual.levels_[0][i]) {
+            ByteRange range = expected.GetChunkRange(i);
+            AddRange(ranges, range.offset, range.length);
+        }
+    }
+    uint64_t tail = static_cast<uint64_t>(fullChunks) * expected.chunkSize_;
+    AddRange(ranges, tail, longest - tail);
+    return ranges;
+}
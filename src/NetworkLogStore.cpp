@@ -0,0 +1,337 @@
+#include "NetworkLogStore.h"
+#include "Utils.h"
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+uint32_t NetworkLogStore::Dictionary::Intern(const std::string& value) {
+    auto it = codes_.find(value);
+    if (it != codes_.end()) {
+        return it->second;
+    }
+    // Once the code space is exhausted new values share one overflow code
+    if (values_.size() + 1 >= maxCodes_) {
+        const std::string overflow = "(other)";
+        if (codes_.find(overflow) == codes_.end()) {
+            codes_.emplace(overflow, static_cast<uint32_t>(values_.size()));
+            values_.push_back(overflow);
+        }
+        return codes_[overflow];
+    }
+    uint32_t code = 0;
+    if (!freeCodes_.empty()) {
+        code = freeCodes_.back();
+        freeCodes_.pop_back();
+        values_[code] = value;
+    } else {
+        code = static_cast<uint32_t>(values_.size());
+        values_.push_back(value);
+    }
+    codes_.emplace(value, code);
+    return code;
+}
+
+uint32_t NetworkLogStore::Dictionary::Acquire(const std::string& value) {
+    uint32_t code = Intern(value);
+    if (code >= references_.size()) {
+        references_.resize(values_.size(), 0);
+    }
+    references_[code]++;
+    return code;
+}
+
+void NetworkLogStore::Dictionary::Release(uint32_t code) {
+    if (code >= references_.size() || references_[code] == 0 || --references_[code] > 0) {
+        return;
+    }
+    codes_.erase(values_[code]);
+    std::string().swap(values_[code]);
+    freeCodes_.push_back(code);
+}
+
+void NetworkLogStore::Dictionary::Clear() {
+    values_.clear();
+    codes_.clear();
+    references_.clear();
+    freeCodes_.clear();
+}
+
+bool NetworkLogStore::Dictionary::Find(const std::string& value, uint32_t& code) const {
+    auto it = codes_.find(value);
+    if (it == codes_.end()) {
+        return false;
+    }
+    code = it->second;
+    return true;
+}
+
+NetworkLogStore::NetworkLogStore(size_t maxRows)
+    : nextId_(1), protocols_(UINT16_MAX), threats_(UINT16_MAX), statuses_(UINT16_MAX) {
+    // At least two chunks so evicting one never empties the store
+    maxChunks_ = std::max<size_t>(2, (maxRows + CHUNK_ROWS - 1) / CHUNK_ROWS);
+}
+
+int64_t NetworkLogStore::ToNanoseconds(std::chrono::system_clock::time_point time) {
+    if (time == std::chrono::system_clock::time_point::min()) {
+        return std::numeric_limits<int64_t>::min();
+    }
+    if (time == std::chrono::system_clock::time_point::max()) {
+        return std::numeric_limits<int64_t>::max();
+    }
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count();
+}
+
+NetworkLogStore::AddressKey NetworkLogStore::EncodeAddress(const std::string& address) {
+    AddressKey key;
+    uint8_t addr[16];
+    bool isIPv6 = false;
+    if (Utils::ParseIP(address, addr, isIPv6)) {
+        std::memcpy(&key.hi, addr, 8);
+        std::memcpy(&key.lo, addr + 8, 8);
+        key.kind = isIPv6 ? IPv6 : IPv4;
+    } else {
+        // Pseudo-addresses such as "SYSTEM" are interned, one reference per row
+        key.hi = 0;
+        key.lo = addresses_.Acquire(address);
+        key.kind = Text;
+    }
+    return key;
+}
+
+bool NetworkLogStore::LookupAddress(const std::string& address, AddressKey& key) const {
+    uint8_t addr[16];
+    bool isIPv6 = false;
+    if (Utils::ParseIP(address, addr, isIPv6)) {
+        std::memcpy(&key.hi, addr, 8);
+        std::memcpy(&key.lo, addr + 8, 8);
+        key.kind = isIPv6 ? IPv6 : IPv4;
+        return true;
+    }
+    uint32_t code = 0;
+    if (!addresses_.Find(address, code)) {
+        return false;
+    }
+    key.hi = 0;
+    key.lo = code;
+    key.kind = Text;
+    return true;
+}
+
+std::string NetworkLogStore::DecodeAddress(uint64_t hi, uint64_t lo, uint8_t kind) const {
+    if (kind == Text) {
+        return addresses_.Get(static_cast<uint32_t>(lo));
+    }
+    uint8_t addr[16];
+    std::memcpy(addr, &hi, 8);
+    std::memcpy(addr + 8, &lo, 8);
+    return Utils::FormatIP(addr, kind == IPv6);
+}
+
+void NetworkLogStore::Append(std::chrono::system_clock::time_point timestamp,
+                             const std::string& sourceIp, const std::string& destinationIp,
+                             const std::string& protocol, const std::string& threat, const std::string& status) {
+    if (chunks_.empty() || chunks_.back()->rows == CHUNK_ROWS) {
+        if (chunks_.size() >= maxChunks_) {
+            spare_ = std::move(chunks_.front());
+            chunks_.pop_front();
+            for (size_t i = 0; i < spare_->rows; ++i) {
+                if (spare_->srcKind[i] == Text) addresses_.Release(static_cast<uint32_t>(spare_->srcLo[i]));
+                if (spare_->dstKind[i] == Text) addresses_.Release(static_cast<uint32_t>(spare_->dstLo[i]));
+            }
+        }
+        std::unique_ptr<Chunk> chunk = spare_ ? std::move(spare_) : std::unique_ptr<Chunk>(new Chunk);
+        chunk->firstId = nextId_;
+        chunk->rows = 0;
+        chunk->minTime = std::numeric_limits<int64_t>::max();
+        chunk->maxTime = std::numeric_limits<int64_t>::min();
+        chunks_.push_back(std::move(chunk));
+    }
+
+    Chunk& chunk = *chunks_.back();
+    size_t row = chunk.rows;
+    int64_t time = ToNanoseconds(timestamp);
+    AddressKey src = EncodeAddress(sourceIp);
+    AddressKey dst = EncodeAddress(destinationIp);
+
+    chunk.timeNs[row] = time;
+    chunk.srcHi[row] = src.hi;
+    chunk.srcLo[row] = src.lo;
+    chunk.srcKind[row] = src.kind;
+    chunk.dstHi[row] = dst.hi;
+    chunk.dstLo[row] = dst.lo;
+    chunk.dstKind[row] = dst.kind;
+    chunk.protocol[row] = static_cast<uint16_t>(protocols_.Intern(protocol));
+    chunk.threat[row] = static_cast<uint16_t>(threats_.Intern(threat));
+    chunk.status[row] = static_cast<uint16_t>(statuses_.Intern(status));
+    chunk.minTime = std::min(chunk.minTime, time);
+    chunk.maxTime = std::max(chunk.maxTime, time);
+    chunk.rows++;
+    nextId_++;
+}
+
+NetworkLogStore::Row NetworkLogStore::MaterializeRow(const Chunk& chunk, size_t index) const {
+    Row row;
+    row.id = chunk.firstId + index;
+    row.timestamp = std::chrono::system_clock::time_point(
+        std::chrono::duration_cast<std::chrono::system_clock::duration>(
+            std::chrono::nanoseconds(chunk.timeNs[index])));
+    row.sourceIp = DecodeAddress(chunk.srcHi[index], chunk.srcLo[index], chunk.srcKind[index]);
+    row.destinationIp = DecodeAddress(chunk.dstHi[index], chunk.dstLo[index], chunk.dstKind[index]);
+    row.protocol = protocols_.Get(chunk.protocol[index]);
+    row.threat = threats_.Get(chunk.threat[index]);
+    row.status = statuses_.Get(chunk.status[index]);
+    return row;
+}
+
+std::vector<NetworkLogStore::Row> NetworkLogStore::Tail(size_t count) const {
+    std::vector<Row> result;
+    count = std::min(count, Size());
+    result.reserve(count);
+
+    // Walk back to the chunk holding the first requested row, then forward
+    size_t skip = Size() - count;
+    for (const auto& chunk : chunks_) {
+        if (skip >= chunk->rows) {
+            skip -= chunk->rows;
+            continue;
+        }
+        for (size_t i = skip; i < chunk->rows; ++i) {
+            result.push_back(MaterializeRow(*chunk, i));
+        }
+        skip = 0;
+    }
+    return result;
+}
+
+bool NetworkLogStore::CompileFilter(const Query& query, int64_t& from, int64_t& to, AddressKey& ip, bool& hasIp,
+                                    int32_t& protocol, int32_t& threat, int32_t& status) const {
+    from = ToNanoseconds(query.from);
+    to = ToNanoseconds(query.to);
+    hasIp = !query.ip.empty();
+    protocol = threat = status = -1;
+
+    if (hasIp && !LookupAddress(query.ip, ip)) {
+        return false;
+    }
+
+    uint32_t code = 0;
+    if (!query.protocol.empty()) {
+        if (!protocols_.Find(query.protocol, code)) return false;
+        protocol = static_cast<int32_t>(code);
+    }
+    if (!query.threat.empty()) {
+        if (!threats_.Find(query.threat, code)) return false;
+        threat = static_cast<int32_t>(code);
+    }
+    if (!query.status.empty()) {
+        if (!statuses_.Find(query.status, code)) return false;
+        status = static_cast<int32_t>(code);
+    }
+    return from <= to;
+}
+
+size_t NetworkLogStore::ScanChunk(const Chunk& chunk, int64_t from, int64_t to, const AddressKey* ip,
+                                  int32_t protocol, int32_t threat, int32_t status, uint8_t* mask) const {
+    const size_t rows = chunk.rows;
+
+    // Each predicate is a branch-free pass over one column
+    for (size_t i = 0; i < rows; ++i) {
+        mask[i] = static_cast<uint8_t>((chunk.timeNs[i] >= from) & (chunk.timeNs[i] <= to));
+    }
+    if (ip) {
+        const uint64_t hi = ip->hi;
+        const uint64_t lo = ip->lo;
+        const uint8_t kind = ip->kind;
+        for (size_t i = 0; i < rows; ++i) {
+            uint8_t src = static_cast<uint8_t>((chunk.srcHi[i] == hi) & (chunk.srcLo[i] == lo) & (chunk.srcKind[i] == kind));
+            uint8_t dst = static_cast<uint8_t>((chunk.dstHi[i] == hi) & (chunk.dstLo[i] == lo) & (chunk.dstKind[i] == kind));
+            mask[i] &= static_cast<uint8_t>(src | dst);
+        }
+    }
+    if (protocol >= 0) {
+        const uint16_t code = static_cast<uint16_t>(protocol);
+        for (size_t i = 0; i < rows; ++i) {
+            mask[i] &= static_cast<uint8_t>(chunk.protocol[i] == code);
+        }
+    }
+    if (threat >= 0) {
+        const uint16_t code = static_cast<uint16_t>(threat);
+        for (size_t i = 0; i < rows; ++i) {
+            mask[i] &= static_cast<uint8_t>(chunk.threat[i] == code);
+        }
+    }
+    if (status >= 0) {
+        const uint16_t code = static_cast<uint16_t>(status);
+        for (size_t i = 0; i < rows; ++i) {
+            mask[i] &= static_cast<uint8_t>(chunk.status[i] == code);
+        }
+    }
+
+    size_t matches = 0;
+    for (size_t i = 0; i < rows; ++i) {
+        matches += mask[i];
+    }
+    return matches;
+}
+
+std::vector<NetworkLogStore::Row> NetworkLogStore::Select(const Query& query) const {
+    std::vector<Row> result;
+    int64_t from, to;
+    AddressKey ip;
+    bool hasIp = false;
+    int32_t protocol, threat, status;
+    if (query.limit == 0 || !CompileFilter(query, from, to, ip, hasIp, protocol, threat, status)) {
+        return result;
+    }
+
+    uint8_t mask[CHUNK_ROWS];
+    for (auto it = chunks_.rbegin(); it != chunks_.rend() && result.size() < query.limit; ++it) {
+        const Chunk& chunk = **it;
+        if (chunk.rows == 0 || chunk.maxTime < from || chunk.minTime > to) {
+            continue;
+        }
+        if (ScanChunk(chunk, from, to, hasIp ? &ip : nullptr, protocol, threat, status, mask) == 0) {
+            continue;
+        }
+        for (size_t i = chunk.rows; i-- > 0 && result.size() < query.limit;) {
+            if (mask[i]) {
+                result.push_back(MaterializeRow(chunk, i));
+            }
+        }
+    }
+    return result;
+}
+
+size_t NetworkLogStore::Count(const Query& query) const {
+    int64_t from, to;
+    AddressKey ip;
+    bool hasIp = false;
+    int32_t protocol, threat, status;
+    if (!CompileFilter(query, from, to, ip, hasIp, protocol, threat, status)) {
+        return 0;
+    }
+
+    size_t total = 0;
+    uint8_t mask[CHUNK_ROWS];
+    for (const auto& chunk : chunks_) {
+        if (chunk->rows == 0 || chunk->maxTime < from || chunk->minTime > to) {
+            continue;
+        }
+        total += ScanChunk(*chunk, from, to, hasIp ? &ip : nullptr, protocol, threat, status, mask);
+    }
+    return total;
+}
+
+size_t NetworkLogStore::Size() const {
+    size_t total = 0;
+    for (const auto& chunk : chunks_) {
+        total += chunk->rows;
+    }
+    return total;
+}
+
+void NetworkLogStore::Clear() {
+    chunks_.clear();
+    spare_.reset();
+    addresses_.Clear();
+}
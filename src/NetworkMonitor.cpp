@@ -1,15 +1,166 @@
 #include "NetworkMonitor.h"
+#include "FirewallEnforcer.h"
+#include "GeoIpDatabase.h"
+#include "IpfixExporter.h"
+#include "ReputationIndex.h"
 #include "Utils.h"
+#include <filesystem>
 #include <thread>
 #include <mutex>
 #include <random>
 #include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <unordered_map>
+#include <unordered_set>
+#include <cstring>
+#include <iostream>
 
-NetworkMonitor::NetworkMonitor() : isMonitoring_(false), nextLogId_(1) {
+#ifdef __linux__
+#include <ifaddrs.h>
+#include <netinet/in.h>
+#endif
+
+namespace {
+    // More distinct local ports than this from one source within the window is a scan
+    const size_t kPortScanThreshold = 20;
+
+    NetworkMonitor::NetworkLog ToNetworkLog(NetworkLogStore::Row&& row) {
+        NetworkMonitor::NetworkLog log;
+        log.id = static_cast<int>(row.id);
+        log.timestamp = row.timestamp;
+        log.sourceIp = std::move(row.sourceIp);
+        log.destinationIp = std::move(row.destinationIp);
+        log.protocol = std::move(row.protocol);
+        log.threat = std::move(row.threat);
+        log.status = std::move(row.status);
+        log.asn = 0;
+        return log;
+    }
+
+#ifdef __linux__
+    const char* TcpStateName(int state) {
+        static const char* names[] = {
+            "UNKNOWN", "ESTABLISHED", "SYN_SENT", "SYN_RECEIVED", "FIN_WAIT1", "FIN_WAIT2",
+            "TIME_WAIT", "CLOSED", "CLOSE_WAIT", "LAST_ACK", "LISTENING", "CLOSING"
+        };
+        return state > 0 && state < 12 ? names[state] : names[0];
+    }
+
+    // "0100007F:0016" - the address is written as 32-bit words in host byte order
+    bool ParseProcAddress(const std::string& field, bool isIPv6, std::string& address, int& port) {
+        size_t colon = field.find(':');
+        size_t hexLength = isIPv6 ? 32 : 8;
+        if (colon != hexLength) {
+            return false;
+        }
+        uint8_t addr[16] = {0};
+        for (size_t word = 0; word < hexLength / 8; ++word) {
+            uint32_t value = static_cast<uint32_t>(std::strtoul(field.substr(word * 8, 8).c_str(), nullptr, 16));
+            std::memcpy(addr + word * 4, &value, 4);
+        }
+        address = Utils::FormatIP(addr, isIPv6);
+        port = static_cast<int>(std::strtol(field.c_str() + colon + 1, nullptr, 16));
+        return !address.empty();
+    }
+
+    void ReadProcNetTable(const std::string& path, const std::string& protocol, bool isIPv6,
+                          std::vector<NetworkMonitor::NetworkConnection>& table) {
+        std::ifstream file(path);
+        std::string line;
+        std::getline(file, line); // Header
+        auto now = std::chrono::system_clock::now();
+        while (std::getline(file, line)) {
+            std::istringstream fields(line);
+            std::string slot, local, remote, state, queues, timer, retransmits, uid, timeout;
+            uint64_t inode = 0;
+            if (!(fields >> slot >> local >> remote >> state >> queues >> timer >> retransmits >> uid >> timeout >> inode)) {
+                continue;
+            }
+
+            NetworkMonitor::NetworkConnection conn;
+            if (!ParseProcAddress(local, isIPv6, conn.localAddress, conn.localPort) ||
+                !ParseProcAddress(remote, isIPv6, conn.remoteAddress, conn.remotePort)) {
+                continue;
+            }
+            conn.protocol = protocol;
+            conn.state = protocol == "TCP" ? TcpStateName(static_cast<int>(std::strtol(state.c_str(), nullptr, 16))) : "";
+            conn.processId = 0;
+            conn.socketInode = inode;
+            conn.asn = 0;
+            conn.timestamp = now;
+            table.push_back(std::move(conn));
+        }
+    }
+#endif
+}
+
+NetworkMonitor::NetworkMonitor()
+    : isMonitoring_(false),
+      logs_(static_cast<size_t>(Utils::Config::Instance().GetInt("network", "log_capacity", 262144))),
+      scanWindow_(Utils::Config::Instance().GetInt("network", "scan_window_seconds", 60)),
+      reputationSize_(0),
+      flows_(static_cast<uint64_t>(Utils::Config::Instance().GetInt("flows", "idle_timeout_seconds", 15)) * 1000000000ULL,
+             static_cast<uint64_t>(Utils::Config::Instance().GetInt("flows", "active_timeout_seconds", 300)) * 1000000000ULL,
+             static_cast<size_t>(Utils::Config::Instance().GetInt("flows", "max_flows", 262144))),
+      nextFlowSweepNs_(0) {
+    std::string collector = Utils::Config::Instance().GetString("flows", "ipfix_collector", "");
+    if (!collector.empty()) {
+        SetFlowCollector(collector);
+    }
+    
+    auto& config = Utils::Config::Instance();
+    for (const auto& country : config.GetStringArray("geoip", "watch_countries")) {
+        watchCountries_.insert(Utils::ToUpper(country));
+    }
+    for (const auto& asn : config.GetStringArray("geoip", "watch_asns")) {
+        std::string number = asn.size() > 2 && (asn[0] == 'A' || asn[0] == 'a') ? asn.substr(2) : asn;
+        watchAsns_.insert(static_cast<uint32_t>(std::strtoul(number.c_str(), nullptr, 10)));
+    }
+    
+    // Traffic counts as inbound when it is addressed to this host or to one of
+    // these networks, so captures from a span port are judged the same way
+    std::vector<std::string> networks = config.GetStringArray("network", "local_networks");
+    if (networks.empty()) {
+        networks = {"10.0.0.0/8", "172.16.0.0/12", "192.168.0.0/16", "fc00::/7", "fe80::/10"};
+    }
+    for (const auto& network : networks) {
+        size_t slash = network.find('/');
+        LocalNetwork local;
+        if (!Utils::ParseIP(network.substr(0, slash), local.address, local.isIPv6)) {
+            continue;
+        }
+        int maxLength = local.isIPv6 ? 128 : 32;
+        local.prefixLength = slash == std::string::npos ? maxLength : std::atoi(network.c_str() + slash + 1);
+        if (local.prefixLength >= 0 && local.prefixLength <= maxLength) {
+            localNetworks_.push_back(local);
+        }
+    }
+    
+    hostAddresses_ = {"127.0.0.1", "::1"};
+#ifdef __linux__
+    ifaddrs* interfaces = nullptr;
+    if (getifaddrs(&interfaces) == 0) {
+        for (ifaddrs* it = interfaces; it; it = it->ifa_next) {
+            if (!it->ifa_addr) {
+                continue;
+            }
+            if (it->ifa_addr->sa_family == AF_INET) {
+                auto* address = reinterpret_cast<sockaddr_in*>(it->ifa_addr);
+                hostAddresses_.insert(Utils::FormatIP(reinterpret_cast<uint8_t*>(&address->sin_addr), false));
+            } else if (it->ifa_addr->sa_family == AF_INET6) {
+                auto* address = reinterpret_cast<sockaddr_in6*>(it->ifa_addr);
+                hostAddresses_.insert(Utils::FormatIP(address->sin6_addr.s6_addr, true));
+            }
+        }
+        freeifaddrs(interfaces);
+    }
+#endif
 }
 
 NetworkMonitor::~NetworkMonitor() {
     StopMonitoring();
+    ExportFlows(true);
 }
 
 bool NetworkMonitor::StartMonitoring() {
@@ -17,6 +168,9 @@ bool NetworkMonitor::StartMonitoring() {
         return true;
     }
     
+    // Bring the firewall driver up now: its setup talks to the kernel and
+    // must not run on the first block, under threatMutex_
+    FirewallEnforcer::Instance();
     isMonitoring_ = true;
     monitoringThread_ = std::thread(&NetworkMonitor::MonitoringLoop, this);
     return true;
@@ -43,18 +197,52 @@ std::vector<NetworkMonitor::NetworkConnection> NetworkMonitor::GetActiveConnecti
 }
 
 std::vector<NetworkMonitor::NetworkLog> NetworkMonitor::GetNetworkLogs(int limit) const {
-    std::lock_guard<std::mutex> lock(logsMutex_);
+    std::vector<NetworkLogStore::Row> rows;
+    {
+        std::lock_guard<std::mutex> lock(logsMutex_);
+        rows = logs_.Tail(static_cast<size_t>(std::max(limit, 0)));
+    }
     
     std::vector<NetworkLog> result;
-    int count = std::min(limit, static_cast<int>(logs_.size()));
-    
-    if (count > 0) {
-        result.assign(logs_.end() - count, logs_.end());
+    result.reserve(rows.size());
+    auto geo = std::atomic_load(&geo_);
+    for (auto& row : rows) {
+        result.push_back(ToNetworkLog(std::move(row)));
+        GeoIpDatabase::GeoInfo info;
+        if (geo && geo->Lookup(result.back().sourceIp, info)) {
+            result.back().country = info.country;
+            result.back().asn = info.asn;
+        }
+    }
+    return result;
+}
+
+std::vector<NetworkMonitor::NetworkLog> NetworkMonitor::QueryNetworkLogs(const NetworkLogStore::Query& query) const {
+    std::vector<NetworkLogStore::Row> rows;
+    {
+        std::lock_guard<std::mutex> lock(logsMutex_);
+        rows = logs_.Select(query);
     }
     
+    std::vector<NetworkLog> result;
+    result.reserve(rows.size());
+    auto geo = std::atomic_load(&geo_);
+    for (auto& row : rows) {
+        result.push_back(ToNetworkLog(std::move(row)));
+        GeoIpDatabase::GeoInfo info;
+        if (geo && geo->Lookup(result.back().sourceIp, info)) {
+            result.back().country = info.country;
+            result.back().asn = info.asn;
+        }
+    }
     return result;
 }
 
+size_t NetworkMonitor::CountNetworkLogs(const NetworkLogStore::Query& query) const {
+    std::lock_guard<std::mutex> lock(logsMutex_);
+    return logs_.Count(query);
+}
+
 NetworkMonitor::TrafficStats NetworkMonitor::GetCurrentStats() const {
     TrafficStats stats;
     stats.bytesReceived = 1024000;
@@ -83,54 +271,275 @@ std::vector<NetworkMonitor::TrafficStats> NetworkMonitor::GetStatsHistory(int mi
 }
 
 std::vector<std::string> NetworkMonitor::GetSuspiciousIPs() const {
+    std::lock_guard<std::mutex> lock(threatMutex_);
     return std::vector<std::string>(suspiciousIPs_.begin(), suspiciousIPs_.end());
 }
 
 int NetworkMonitor::GetThreatCount() const {
+    std::lock_guard<std::mutex> lock(threatMutex_);
     return static_cast<int>(suspiciousIPs_.size());
 }
 
 void NetworkMonitor::BlockIP(const std::string& ip) {
-    blockedIPs_.insert(ip);
+    {
+        std::lock_guard<std::mutex> lock(threatMutex_);
+        blockedIPs_.insert(ip);
+        FirewallEnforcer::Instance().Block(ip);
+    }
     AddNetworkLog("SYSTEM", ip, "BLOCK", "IP Blocked", "BLOCKED");
 }
 
 void NetworkMonitor::UnblockIP(const std::string& ip) {
-    blockedIPs_.erase(ip);
+    {
+        std::lock_guard<std::mutex> lock(threatMutex_);
+        blockedIPs_.erase(ip);
+        FirewallEnforcer::Instance().Unblock(ip);
+    }
     AddNetworkLog("SYSTEM", ip, "UNBLOCK", "IP Unblocked", "ALLOWED");
 }
 
 std::vector<std::string> NetworkMonitor::GetBlockedIPs() const {
-    return std::vector<std::string>(blockedIPs_.begin(), blockedIPs_.end());
+    std::lock_guard<std::mutex> lock(threatMutex_);
+    // Blocks whose TTL ran out in the enforcer are dropped here
+    std::vector<std::string> result;
+    auto& enforcer = FirewallEnforcer::Instance();
+    for (auto it = blockedIPs_.begin(); it != blockedIPs_.end();) {
+        if (enforcer.IsBlocked(*it)) {
+            result.push_back(*it++);
+        } else {
+            it = blockedIPs_.erase(it);
+        }
+    }
+    return result;
 }
 
 bool NetworkMonitor::IsIPSuspicious(const std::string& ip) const {
+    std::lock_guard<std::mutex> lock(threatMutex_);
     return suspiciousIPs_.find(ip) != suspiciousIPs_.end();
 }
 
 std::string NetworkMonitor::AnalyzeTrafficPattern(const std::string& ip) const {
+    std::lock_guard<std::mutex> lock(threatMutex_);
     auto it = ipActivity_.find(ip);
     if (it == ipActivity_.end()) {
         return "No activity recorded";
     }
     
     int count = it->second;
+    std::string pattern;
     if (count > 100) {
-        return "High activity - possible DDoS";
+        pattern = "High activity - possible DDoS";
     } else if (count > 50) {
-        return "Moderate activity - monitoring recommended";
+        pattern = "Moderate activity - monitoring recommended";
     } else {
-        return "Normal activity";
+        pattern = "Normal activity";
     }
+    
+    GeoIpDatabase::GeoInfo info;
+    auto geo = std::atomic_load(&geo_);
+    if (geo && geo->Lookup(ip, info)) {
+        pattern += " [" + std::string(info.country[0] ? info.country : "??");
+        if (info.asn != 0) {
+            pattern += " AS" + std::to_string(info.asn);
+            if (info.organization[0]) {
+                pattern += " " + std::string(info.organization);
+            }
+        }
+        pattern += "]";
+    }
+    return pattern;
 }
 
 void NetworkMonitor::UpdateThreatDatabase() {
-    // Placeholder for threat database updates
+    auto& config = Utils::Config::Instance();
+    std::vector<std::string> feeds = config.GetStringArray("network", "reputation_feeds");
+    std::string indexFile = config.GetString("network", "reputation_index", "reputation.idx");
+    
+    // Recompile only when a feed is newer than the compiled index
+    std::error_code ec;
+    bool rebuild = false;
+    if (!feeds.empty()) {
+        auto indexTime = std::filesystem::last_write_time(indexFile, ec);
+        rebuild = static_cast<bool>(ec);
+        for (const auto& feed : feeds) {
+            auto feedTime = std::filesystem::last_write_time(feed, ec);
+            if (!ec && feedTime > indexTime) {
+                rebuild = true;
+            }
+        }
+    }
+    
+    if (rebuild) {
+        ReputationIndex::CompileStats stats;
+        std::string error;
+        if (!ReputationIndex::Compile(feeds, indexFile, &stats, &error)) {
+            AddNetworkLog("SYSTEM", indexFile, "FEED", error, "ERROR");
+            return;
+        }
+        AddNetworkLog("SYSTEM", indexFile, "FEED",
+                      "Reputation index rebuilt: " + std::to_string(stats.v4Ranges + stats.v6Ranges) + " ranges",
+                      "UPDATED");
+    }
+    
+    if (Utils::FileExists(indexFile)) {
+        // Remap only when the index changed since it was last mapped here
+        auto indexTime = std::filesystem::last_write_time(indexFile, ec);
+        uintmax_t indexSize = ec ? 0 : std::filesystem::file_size(indexFile, ec);
+        auto current = std::atomic_load(&reputation_);
+        bool unchanged = !ec && !rebuild && current && current == reputationLoaded_.lock() &&
+                         indexFile == reputationPath_ && indexTime == reputationTime_ && indexSize == reputationSize_;
+        if (!unchanged && LoadReputationIndex(indexFile) && !ec) {
+            reputationLoaded_ = std::atomic_load(&reputation_);
+            reputationPath_ = indexFile;
+            reputationTime_ = indexTime;
+            reputationSize_ = indexSize;
+        }
+    }
+    
+    std::string geoFile = config.GetString("geoip", "database", "");
+    if (!geoFile.empty() && Utils::FileExists(geoFile)) {
+        LoadGeoDatabase(geoFile);
+    }
+}
+
+bool NetworkMonitor::LoadReputationIndex(const std::string& indexFile) {
+    auto index = std::make_shared<ReputationIndex>();
+    if (!index->Open(indexFile)) {
+        AddNetworkLog("SYSTEM", indexFile, "FEED", index->GetLastError(), "ERROR");
+        return false;
+    }
+    SetReputationIndex(index);
+    return true;
+}
+
+void NetworkMonitor::SetReputationIndex(std::shared_ptr<const ReputationIndex> index) {
+    // Readers holding the previous index keep it mapped until they finish
+    std::atomic_store(&reputation_, std::move(index));
+}
+
+bool NetworkMonitor::IsIPListed(const std::string& ip, std::string* feed) const {
+    auto index = std::atomic_load(&reputation_);
+    return index && index->Contains(ip, feed);
+}
+
+bool NetworkMonitor::LoadGeoDatabase(const std::string& databaseFile) {
+    auto database = std::make_shared<GeoIpDatabase>();
+    if (!database->Open(databaseFile)) {
+        AddNetworkLog("SYSTEM", databaseFile, "GEOIP", database->GetLastError(), "ERROR");
+        return false;
+    }
+    SetGeoDatabase(database);
+    return true;
+}
+
+void NetworkMonitor::SetGeoDatabase(std::shared_ptr<const GeoIpDatabase> database) {
+    std::atomic_store(&geo_, std::move(database));
+}
+
+void NetworkMonitor::EnrichConnection(NetworkConnection& conn, const uint8_t* remoteAddr, bool isIPv6) const {
+    auto geo = std::atomic_load(&geo_);
+    if (!geo) {
+        return;
+    }
+    
+    GeoIpDatabase::GeoInfo info;
+    bool found = false;
+    if (remoteAddr) {
+        found = geo->LookupCached(remoteAddr, isIPv6, info);
+    } else {
+        found = geo->Lookup(conn.remoteAddress, info);
+    }
+    if (found) {
+        conn.country = info.country;
+        conn.asn = info.asn;
+        conn.organization = info.organization;
+    }
+}
+
+void NetworkMonitor::ProcessConnection(const NetworkConnection& conn) {
+    ConnectionCallback callback;
+    {
+        std::lock_guard<std::mutex> lock(connectionsMutex_);
+        callback = connectionCallback_;
+    }
+    if (conn.country.empty() && conn.asn == 0 && std::atomic_load(&geo_)) {
+        NetworkConnection enriched = conn;
+        EnrichConnection(enriched);
+        AnalyzeConnectionPattern(enriched, IsInbound(enriched.localAddress, enriched.remoteAddress));
+        if (callback) {
+            callback(enriched);
+        }
+        return;
+    }
+    AnalyzeConnectionPattern(conn, IsInbound(conn.localAddress, conn.remoteAddress));
+    if (callback) {
+        callback(conn);
+    }
+}
+
+void NetworkMonitor::ProcessPacket(const PacketInfo& packet) {
+    if (packet.ipVersion == 0) {
+        return;
+    }
+    
+    FlowTable::Observation observation;
+    observation.timestampNs = packet.timestampNs;
+    observation.ipVersion = packet.ipVersion;
+    observation.protocol = packet.protocol;
+    observation.tcpFlags = packet.tcpFlags;
+    std::memcpy(observation.srcAddr, packet.srcAddr, 16);
+    std::memcpy(observation.dstAddr, packet.dstAddr, 16);
+    observation.srcPort = packet.srcPort;
+    observation.dstPort = packet.dstPort;
+    observation.bytes = packet.originalLength;
+    observation.packets = 1;
+    {
+        // Replayed captures advance flow timeouts on packet time
+        std::lock_guard<std::mutex> lock(flowsMutex_);
+        flows_.Observe(observation);
+        if (packet.timestampNs >= nextFlowSweepNs_) {
+            SweepFlows(packet.timestampNs, false);
+            nextFlowSweepNs_ = packet.timestampNs + 1000000000ULL;
+        }
+    }
+    
+    // Only connection attempts feed the activity counters: a TCP SYN without
+    // ACK, or any UDP datagram. Established traffic would inflate the scan score.
+    bool tcpAttempt = packet.protocol == 6 && (packet.tcpFlags & 0x12) == 0x02;
+    bool udpDatagram = packet.protocol == 17;
+    if (!tcpAttempt && !udpDatagram) {
+        return;
+    }
+    
+    bool isIPv6 = packet.ipVersion == 6;
+    NetworkConnection conn;
+    conn.localAddress = Utils::FormatIP(packet.dstAddr, isIPv6);
+    conn.remoteAddress = Utils::FormatIP(packet.srcAddr, isIPv6);
+    conn.localPort = packet.dstPort;
+    conn.remotePort = packet.srcPort;
+    conn.protocol = tcpAttempt ? "TCP" : "UDP";
+    conn.state = tcpAttempt ? "SYN_RECEIVED" : "";
+    conn.processId = 0;
+    conn.socketInode = 0;
+    conn.asn = 0;
+    conn.timestamp = std::chrono::system_clock::time_point(
+        std::chrono::duration_cast<std::chrono::system_clock::duration>(
+            std::chrono::nanoseconds(packet.timestampNs)));
+    EnrichConnection(conn, packet.srcAddr, isIPv6);
+    
+    AnalyzeConnectionPattern(conn, IsInbound(conn.localAddress, conn.remoteAddress));
 }
 
 void NetworkMonitor::MonitoringLoop() {
+    int iteration = 0;
     while (isMonitoring_) {
+        // Refresh reputation feeds at startup and then hourly
+        if (iteration++ % 720 == 0) {
+            UpdateThreatDatabase();
+        }
+        
         ScanActiveConnections();
+        ExportFlows();
         AnalyzeTraffic();
         DetectThreats();
         
@@ -139,8 +548,143 @@ void NetworkMonitor::MonitoringLoop() {
 }
 
 void NetworkMonitor::ScanActiveConnections() {
-    GetTcpTable();
-    GetUdpTable();
+    std::vector<NetworkConnection> table;
+    GetTcpTable(table);
+    GetUdpTable(table);
+    
+    std::vector<NetworkConnection> previous = GetActiveConnections();
+    AttributeConnections(table, previous);
+    for (auto& conn : table) {
+        EnrichConnection(conn);
+    }
+    ConnectionCallback callback;
+    {
+        std::lock_guard<std::mutex> lock(connectionsMutex_);
+        connections_ = table;
+        callback = connectionCallback_;
+    }
+    
+    // Only sockets that appeared since the last scan count as new activity
+    std::unordered_set<uint64_t> known;
+    for (const auto& conn : previous) {
+        known.insert(conn.socketInode);
+    }
+    // A socket was accepted rather than dialled out when its local port is listening
+    std::unordered_set<int> listening;
+    for (const auto& conn : table) {
+        if (conn.state == "LISTENING") {
+            listening.insert(conn.localPort);
+        }
+    }
+    for (const auto& conn : table) {
+        if (conn.remotePort != 0 && conn.socketInode != 0 && known.count(conn.socketInode) == 0) {
+            bool accepted = conn.protocol == "TCP" && listening.count(conn.localPort) != 0;
+            AnalyzeConnectionPattern(conn, accepted && IsInbound(conn.localAddress, conn.remoteAddress));
+            ObserveConnectionFlow(conn);
+            if (callback) {
+                callback(conn);
+            }
+        }
+    }
+}
+
+void NetworkMonitor::AttributeConnections(std::vector<NetworkConnection>& table,
+                                          const std::vector<NetworkConnection>& previous) {
+    // Sockets attributed on an earlier scan keep their owner without a lookup
+    std::unordered_map<uint64_t, const NetworkConnection*> attributed;
+    for (const auto& conn : previous) {
+        if (conn.processId != 0) {
+            attributed.emplace(conn.socketInode, &conn);
+        }
+    }
+    
+    std::vector<uint64_t> pending;
+    std::vector<size_t> pendingRows;
+    for (size_t i = 0; i < table.size(); ++i) {
+        NetworkConnection& conn = table[i];
+        if (conn.socketInode == 0 || conn.processId != 0) {
+            continue;
+        }
+        auto it = attributed.find(conn.socketInode);
+        if (it != attributed.end()) {
+            conn.processId = it->second->processId;
+            conn.processName = it->second->processName;
+        } else {
+            pending.push_back(conn.socketInode);
+            pendingRows.push_back(i);
+        }
+    }
+    if (pending.empty()) {
+        return;
+    }
+    
+    std::vector<ProcessAttribution::Owner> owners;
+    attribution_.ResolveBatch(pending, owners);
+    for (size_t i = 0; i < pending.size(); ++i) {
+        if (owners[i].pid != 0) {
+            table[pendingRows[i]].processId = owners[i].pid;
+            table[pendingRows[i]].processName = owners[i].name;
+        }
+    }
+}
+
+void NetworkMonitor::ObserveConnectionFlow(const NetworkConnection& conn) {
+    // Connection tables carry no counters: the flow records endpoints and timing only
+    FlowTable::Observation observation;
+    bool localIPv6 = false;
+    bool remoteIPv6 = false;
+    if (!Utils::ParseIP(conn.localAddress, observation.srcAddr, localIPv6) ||
+        !Utils::ParseIP(conn.remoteAddress, observation.dstAddr, remoteIPv6) || localIPv6 != remoteIPv6) {
+        return;
+    }
+    observation.timestampNs = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        conn.timestamp.time_since_epoch()).count());
+    observation.ipVersion = localIPv6 ? 6 : 4;
+    observation.protocol = conn.protocol == "UDP" ? 17 : 6;
+    observation.tcpFlags = 0;
+    observation.srcPort = static_cast<uint16_t>(conn.localPort);
+    observation.dstPort = static_cast<uint16_t>(conn.remotePort);
+    observation.bytes = 0;
+    observation.packets = 0;
+    
+    std::lock_guard<std::mutex> lock(flowsMutex_);
+    flows_.Observe(observation);
+}
+
+bool NetworkMonitor::SetFlowCollector(const std::string& collector) {
+    IpfixExporter::Options options;
+    options.observationDomainId = static_cast<uint32_t>(
+        Utils::Config::Instance().GetInt("flows", "observation_domain", 1));
+    std::unique_ptr<IpfixExporter> exporter(new IpfixExporter(options));
+    if (!exporter->Open(collector)) {
+        std::cerr << "IPFIX export disabled: " << exporter->GetLastError() << std::endl;
+        return false;
+    }
+    
+    std::lock_guard<std::mutex> lock(flowsMutex_);
+    flowExporter_ = std::move(exporter);
+    return true;
+}
+
+void NetworkMonitor::ExportFlows(bool force) {
+    uint64_t now = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count());
+    std::lock_guard<std::mutex> lock(flowsMutex_);
+    SweepFlows(now, force);
+}
+
+FlowTable::Statistics NetworkMonitor::GetFlowStatistics() const {
+    std::lock_guard<std::mutex> lock(flowsMutex_);
+    return flows_.GetStatistics();
+}
+
+void NetworkMonitor::SweepFlows(uint64_t nowNs, bool force) {
+    std::vector<FlowTable::FlowRecord> expired;
+    flows_.Expire(nowNs, expired, force);
+    if (flowExporter_ && !expired.empty()) {
+        flowExporter_->Export(expired);
+        flowExporter_->Flush();
+    }
 }
 
 void NetworkMonitor::AnalyzeTraffic() {
@@ -168,23 +712,108 @@ void NetworkMonitor::DetectThreats() {
     
     if (dis(gen) > 990) { // 1% chance
         std::string suspiciousIP = "192.168.1." + std::to_string(dis(gen) % 255);
-        suspiciousIPs_.insert(suspiciousIP);
+        {
+            std::lock_guard<std::mutex> lock(threatMutex_);
+            suspiciousIPs_.insert(suspiciousIP);
+        }
         AddNetworkLog(suspiciousIP, "192.168.1.100", "TCP", "Port Scan Detected", "BLOCKED");
     }
 }
 
-void NetworkMonitor::AnalyzeConnectionPattern(const NetworkConnection& conn) {
-    ipActivity_[conn.remoteAddress]++;
+void NetworkMonitor::AnalyzeConnectionPattern(const NetworkConnection& conn, bool inbound) {
+    std::string feed;
+    bool listed = IsIPListed(conn.remoteAddress, &feed);
+    bool newlyListed = false;
+    bool newlySuspicious = false;
+    bool geoWatched = (!conn.country.empty() && watchCountries_.count(conn.country) != 0) ||
+                      (conn.asn != 0 && watchAsns_.count(conn.asn) != 0);
+    bool newlyGeoAlerted = false;
+    {
+        std::lock_guard<std::mutex> lock(threatMutex_);
+        // The host's own outbound traffic says nothing about who is probing it
+        if (inbound) {
+            ipActivity_[conn.remoteAddress]++;
+            TrackDestinationPort(conn);
+        }
+        
+        // Log only the transition so a sustained scan does not flood the log
+        if (listed) {
+            newlyListed = suspiciousIPs_.insert(conn.remoteAddress).second;
+        } else if (IsPortScanDetected(conn.remoteAddress)) {
+            newlySuspicious = suspiciousIPs_.insert(conn.remoteAddress).second;
+        }
+        if (geoWatched) {
+            newlyGeoAlerted = geoAlertedIPs_.insert(conn.remoteAddress).second;
+        }
+    }
     
-    if (IsPortScanDetected(conn.remoteAddress)) {
-        suspiciousIPs_.insert(conn.remoteAddress);
+    if (newlyListed) {
+        AddNetworkLog(conn.remoteAddress, conn.localAddress, conn.protocol, "Reputation: " + feed, "BLOCKED");
+    }
+    if (newlySuspicious) {
         AddNetworkLog(conn.remoteAddress, conn.localAddress, conn.protocol, "Port Scan", "BLOCKED");
     }
+    if (newlyGeoAlerted) {
+        std::string context = conn.country.empty() ? "??" : conn.country;
+        if (conn.asn != 0) {
+            context += " AS" + std::to_string(conn.asn);
+        }
+        AddNetworkLog(conn.remoteAddress, conn.localAddress, conn.protocol, "Geo Watch: " + context, "DETECTED");
+    }
+}
+
+bool NetworkMonitor::IsInbound(const std::string& localAddress, const std::string& remoteAddress) const {
+    if (hostAddresses_.count(remoteAddress) != 0) {
+        return false;
+    }
+    if (hostAddresses_.count(localAddress) != 0) {
+        return true;
+    }
+    uint8_t address[16];
+    bool isIPv6 = false;
+    if (!Utils::ParseIP(localAddress, address, isIPv6)) {
+        return false;
+    }
+    for (const auto& network : localNetworks_) {
+        if (network.isIPv6 != isIPv6) {
+            continue;
+        }
+        int whole = network.prefixLength / 8;
+        int bits = network.prefixLength % 8;
+        uint8_t mask = static_cast<uint8_t>(0xFF << (8 - bits));
+        if (std::memcmp(address, network.address, whole) == 0 &&
+            (bits == 0 || (address[whole] & mask) == (network.address[whole] & mask))) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void NetworkMonitor::TrackDestinationPort(const NetworkConnection& conn) {
+    // Drop sources whose window lapsed, at most once per window
+    if (conn.timestamp - portSweepsPruned_ >= scanWindow_ || conn.timestamp < portSweepsPruned_) {
+        for (auto it = portSweeps_.begin(); it != portSweeps_.end();) {
+            it = conn.timestamp - it->second.windowStart >= scanWindow_ ? portSweeps_.erase(it) : std::next(it);
+        }
+        portSweepsPruned_ = conn.timestamp;
+    }
+    
+    auto inserted = portSweeps_.emplace(conn.remoteAddress, PortSweep());
+    PortSweep& sweep = inserted.first->second;
+    if (inserted.second || conn.timestamp - sweep.windowStart >= scanWindow_ || conn.timestamp < sweep.windowStart) {
+        sweep.windowStart = conn.timestamp;
+        sweep.ports.clear();
+    }
+    uint16_t port = static_cast<uint16_t>(conn.localPort);
+    if (sweep.ports.size() <= kPortScanThreshold &&
+        std::find(sweep.ports.begin(), sweep.ports.end(), port) == sweep.ports.end()) {
+        sweep.ports.push_back(port);
+    }
 }
 
 bool NetworkMonitor::IsPortScanDetected(const std::string& ip) const {
-    auto it = ipActivity_.find(ip);
-    return it != ipActivity_.end() && it->second > 20; // Threshold for port scan
+    auto it = portSweeps_.find(ip);
+    return it != portSweeps_.end() && it->second.ports.size() > kPortScanThreshold;
 }
 
 bool NetworkMonitor::IsDDoSDetected(const std::string& ip) const {
@@ -192,12 +821,24 @@ bool NetworkMonitor::IsDDoSDetected(const std::string& ip) const {
     return it != ipActivity_.end() && it->second > 100; // Threshold for DDoS
 }
 
-void NetworkMonitor::GetTcpTable() {
+void NetworkMonitor::GetTcpTable(std::vector<NetworkConnection>& table) {
+#ifdef __linux__
+    ReadProcNetTable("/proc/net/tcp", "TCP", false, table);
+    ReadProcNetTable("/proc/net/tcp6", "TCP", true, table);
+#else
+    (void)table;
     // Windows API implementation would go here
+#endif
 }
 
-void NetworkMonitor::GetUdpTable() {
+void NetworkMonitor::GetUdpTable(std::vector<NetworkConnection>& table) {
+#ifdef __linux__
+    ReadProcNetTable("/proc/net/udp", "UDP", false, table);
+    ReadProcNetTable("/proc/net/udp6", "UDP", true, table);
+#else
+    (void)table;
     // Windows API implementation would go here
+#endif
 }
 
 void NetworkMonitor::GetNetworkStatistics() {
@@ -207,22 +848,41 @@ void NetworkMonitor::GetNetworkStatistics() {
 void NetworkMonitor::AddNetworkLog(const std::string& sourceIp, const std::string& destIp,
                                   const std::string& protocol, const std::string& threat,
                                   const std::string& status) {
+    auto now = std::chrono::system_clock::now();
     NetworkLog log;
-    log.id = nextLogId_++;
-    log.timestamp = std::chrono::system_clock::now();
+    LogCallback callback;
+    {
+        std::lock_guard<std::mutex> lock(logsMutex_);
+        log.id = static_cast<int>(logs_.NextId());
+        logs_.Append(now, sourceIp, destIp, protocol, threat, status);
+        callback = logCallback_;
+    }
+    if (!callback) {
+        return;
+    }
+    
+    log.timestamp = now;
     log.sourceIp = sourceIp;
     log.destinationIp = destIp;
     log.protocol = protocol;
     log.threat = threat;
     log.status = status;
-    
-    {
-        std::lock_guard<std::mutex> lock(logsMutex_);
-        logs_.push_back(log);
-        
-        // Keep only last 1000 logs
-        if (logs_.size() > 1000) {
-            logs_.erase(logs_.begin(), logs_.begin() + 100);
-        }
+    log.asn = 0;
+    GeoIpDatabase::GeoInfo info;
+    auto geo = std::atomic_load(&geo_);
+    if (geo && geo->Lookup(sourceIp, info)) {
+        log.country = info.country;
+        log.asn = info.asn;
     }
+    callback(log);
+}
+
+void NetworkMonitor::SetLogCallback(LogCallback callback) {
+    std::lock_guard<std::mutex> lock(logsMutex_);
+    logCallback_ = std::move(callback);
+}
+
+void NetworkMonitor::SetConnectionCallback(ConnectionCallback callback) {
+    std::lock_guard<std::mutex> lock(connectionsMutex_);
+    connectionCallback_ = std::move(callback);
 }
\ No newline at end of file
@@ -0,0 +1,577 @@
+#include "PacketReplay.h"
+#include <chrono>
+#include <thread>
+#include <cstring>
+#include <algorithm>
+
+namespace {
+    // Link-layer types (LINKTYPE_* values from the pcap spec)
+    constexpr uint32_t LINKTYPE_NULL = 0;
+    constexpr uint32_t LINKTYPE_ETHERNET = 1;
+    constexpr uint32_t LINKTYPE_RAW_LEGACY = 12;
+    constexpr uint32_t LINKTYPE_RAW_LEGACY_BSD = 14;
+    constexpr uint32_t LINKTYPE_RAW = 101;
+    constexpr uint32_t LINKTYPE_LINUX_SLL = 113;
+    constexpr uint32_t LINKTYPE_LINUX_SLL2 = 276;
+
+    // pcapng block types
+    constexpr uint32_t BLOCK_SECTION_HEADER = 0x0A0D0D0A;
+    constexpr uint32_t BLOCK_INTERFACE = 0x00000001;
+    constexpr uint32_t BLOCK_PACKET_OBSOLETE = 0x00000002;
+    constexpr uint32_t BLOCK_SIMPLE_PACKET = 0x00000003;
+    constexpr uint32_t BLOCK_ENHANCED_PACKET = 0x00000006;
+    constexpr uint32_t BYTE_ORDER_MAGIC = 0x1A2B3C4D;
+
+    constexpr uint16_t ETHERTYPE_IPV4 = 0x0800;
+    constexpr uint16_t ETHERTYPE_IPV6 = 0x86DD;
+    constexpr uint16_t ETHERTYPE_VLAN = 0x8100;
+    constexpr uint16_t ETHERTYPE_QINQ = 0x88A8;
+    constexpr uint16_t ETHERTYPE_QINQ_LEGACY = 0x9100;
+
+    inline uint16_t Be16(const uint8_t* p) {
+        return static_cast<uint16_t>((p[0] << 8) | p[1]);
+    }
+
+    inline size_t Pad4(size_t length) {
+        return (length + 3) & ~static_cast<size_t>(3);
+    }
+
+    uint64_t TicksToNanoseconds(uint64_t ticks, uint64_t ticksPerSecond) {
+        if (ticksPerSecond == 1000000000ULL) {
+            return ticks;
+        }
+        uint64_t seconds = ticks / ticksPerSecond;
+        uint64_t remainder = ticks % ticksPerSecond;
+        return seconds * 1000000000ULL +
+               static_cast<uint64_t>(static_cast<double>(remainder) * 1e9 / static_cast<double>(ticksPerSecond));
+    }
+
+    void DecodeTransport(const uint8_t* data, size_t length, NetworkMonitor::PacketInfo& packet) {
+        if (packet.protocol == 6 && length >= 20) {
+            packet.srcPort = Be16(data);
+            packet.dstPort = Be16(data + 2);
+            packet.tcpFlags = data[13];
+            size_t headerLength = static_cast<size_t>(data[12] >> 4) * 4;
+            packet.payloadLength = headerLength <= length ? static_cast<uint32_t>(length - headerLength) : 0;
+        } else if (packet.protocol == 17 && length >= 8) {
+            packet.srcPort = Be16(data);
+            packet.dstPort = Be16(data + 2);
+            packet.payloadLength = static_cast<uint32_t>(length - 8);
+        } else {
+            packet.payloadLength = static_cast<uint32_t>(length);
+        }
+    }
+
+    bool DecodeIPv4(const uint8_t* data, size_t length, NetworkMonitor::PacketInfo& packet) {
+        if (length < 20 || (data[0] >> 4) != 4) {
+            return false;
+        }
+        size_t headerLength = static_cast<size_t>(data[0] & 0x0F) * 4;
+        size_t totalLength = Be16(data + 2);
+        if (headerLength < 20 || headerLength > length) {
+            return false;
+        }
+        // Trust the captured length when the header is inconsistent (e.g. TSO)
+        if (totalLength < headerLength || totalLength > length) {
+            totalLength = length;
+        }
+
+        packet.ipVersion = 4;
+        packet.protocol = data[9];
+        std::memcpy(packet.srcAddr, data + 12, 4);
+        std::memcpy(packet.dstAddr, data + 16, 4);
+
+        // Non-initial fragments carry no transport header
+        uint16_t fragmentOffset = Be16(data + 6) & 0x1FFF;
+        if (fragmentOffset != 0) {
+            packet.payloadLength = static_cast<uint32_t>(totalLength - headerLength);
+            return true;
+        }
+        DecodeTransport(data + headerLength, totalLength - headerLength, packet);
+        return true;
+    }
+
+    bool DecodeIPv6(const uint8_t* data, size_t length, NetworkMonitor::PacketInfo& packet) {
+        if (length < 40 || (data[0] >> 4) != 6) {
+            return false;
+        }
+        size_t end = std::min(length, static_cast<size_t>(40) + Be16(data + 4));
+        if (Be16(data + 4) == 0) {
+            end = length; // Jumbogram or zero-length payload field
+        }
+
+        packet.ipVersion = 6;
+        std::memcpy(packet.srcAddr, data + 8, 16);
+        std::memcpy(packet.dstAddr, data + 24, 16);
+
+        uint8_t nextHeader = data[6];
+        size_t offset = 40;
+        // Walk extension headers until we reach a transport protocol
+        for (int hops = 0; hops < 8 && offset + 8 <= end; ++hops) {
+            if (nextHeader == 0 || nextHeader == 43 || nextHeader == 60) {
+                size_t extLength = (static_cast<size_t>(data[offset + 1]) + 1) * 8;
+                nextHeader = data[offset];
+                offset += extLength;
+            } else if (nextHeader == 44) {
+                bool initialFragment = (Be16(data + offset + 2) & 0xFFF8) == 0;
+                nextHeader = data[offset];
+                offset += 8;
+                if (!initialFragment) {
+                    packet.protocol = nextHeader;
+                    packet.payloadLength = offset <= end ? static_cast<uint32_t>(end - offset) : 0;
+                    return true;
+                }
+            } else if (nextHeader == 51) {
+                size_t extLength = (static_cast<size_t>(data[offset + 1]) + 2) * 4;
+                nextHeader = data[offset];
+                offset += extLength;
+            } else {
+                break;
+            }
+        }
+
+        packet.protocol = nextHeader;
+        if (offset > end) {
+            packet.payloadLength = 0;
+            return true;
+        }
+        DecodeTransport(data + offset, end - offset, packet);
+        return true;
+    }
+
+    bool DecodeNetwork(uint16_t etherType, const uint8_t* data, size_t length,
+                       NetworkMonitor::PacketInfo& packet) {
+        if (etherType == ETHERTYPE_IPV4) {
+            return DecodeIPv4(data, length, packet);
+        }
+        if (etherType == ETHERTYPE_IPV6) {
+            return DecodeIPv6(data, length, packet);
+        }
+        return false;
+    }
+}
+
+PacketReplay::PacketReplay()
+    : format_(Format::None), offset_(0), dataStart_(0), bigEndian_(false), malformedRecords_(0),
+      pcapLinkType_(LINKTYPE_ETHERNET), pcapTicksPerSecond_(1000000) {
+}
+
+PacketReplay::~PacketReplay() {
+    Close();
+}
+
+bool PacketReplay::Open(const std::string& captureFile) {
+    Close();
+
+    if (!file_.Open(captureFile)) {
+        lastError_ = "Cannot open capture file: " + captureFile;
+        return false;
+    }
+    if (file_.Size() < 24) {
+        lastError_ = "Capture file too small: " + captureFile;
+        file_.Close();
+        return false;
+    }
+
+    const uint8_t* data = file_.Data();
+    uint32_t leMagic = static_cast<uint32_t>(data[0]) | (static_cast<uint32_t>(data[1]) << 8) |
+                       (static_cast<uint32_t>(data[2]) << 16) | (static_cast<uint32_t>(data[3]) << 24);
+
+    bool ok = false;
+    if (leMagic == BLOCK_SECTION_HEADER) {
+        format_ = Format::PcapNg;
+        ok = ParsePcapNgSection(0);
+    } else {
+        format_ = Format::Pcap;
+        ok = ParsePcapHeader();
+    }
+
+    if (!ok) {
+        file_.Close();
+        format_ = Format::None;
+        return false;
+    }
+    return true;
+}
+
+void PacketReplay::Close() {
+    file_.Close();
+    format_ = Format::None;
+    offset_ = 0;
+    dataStart_ = 0;
+    malformedRecords_ = 0;
+    interfaces_.clear();
+}
+
+bool PacketReplay::IsOpen() const {
+    return format_ != Format::None;
+}
+
+void PacketReplay::Rewind() {
+    if (format_ == Format::PcapNg) {
+        interfaces_.clear();
+        ParsePcapNgSection(0);
+    } else {
+        offset_ = dataStart_;
+    }
+    malformedRecords_ = 0;
+}
+
+std::string PacketReplay::GetFormat() const {
+    switch (format_) {
+        case Format::Pcap: return "pcap";
+        case Format::PcapNg: return "pcapng";
+        default: return "none";
+    }
+}
+
+std::string PacketReplay::GetLastError() const {
+    return lastError_;
+}
+
+uint16_t PacketReplay::Read16(const uint8_t* p) const {
+    return bigEndian_ ? static_cast<uint16_t>((p[0] << 8) | p[1])
+                      : static_cast<uint16_t>(p[0] | (p[1] << 8));
+}
+
+uint32_t PacketReplay::Read32(const uint8_t* p) const {
+    if (bigEndian_) {
+        return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) |
+               (static_cast<uint32_t>(p[2]) << 8) | static_cast<uint32_t>(p[3]);
+    }
+    return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+           (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+bool PacketReplay::ParsePcapHeader() {
+    const uint8_t* data = file_.Data();
+
+    bigEndian_ = false;
+    uint32_t magic = Read32(data);
+    if (magic == 0xD4C3B2A1 || magic == 0x4D3CB2A1) {
+        bigEndian_ = true;
+        magic = Read32(data);
+    }
+
+    if (magic == 0xA1B2C3D4) {
+        pcapTicksPerSecond_ = 1000000;
+    } else if (magic == 0xA1B23C4D) {
+        pcapTicksPerSecond_ = 1000000000;
+    } else {
+        lastError_ = "Unrecognised capture format (not pcap or pcapng)";
+        return false;
+    }
+
+    // The upper bits of the link type field carry FCS information
+    pcapLinkType_ = Read32(data + 20) & 0x0FFFFFFF;
+    dataStart_ = 24;
+    offset_ = dataStart_;
+    return true;
+}
+
+bool PacketReplay::ParsePcapNgSection(size_t blockOffset) {
+    const uint8_t* data = file_.Data();
+    size_t size = file_.Size();
+    if (blockOffset + 28 > size) {
+        lastError_ = "Truncated pcapng section header";
+        return false;
+    }
+
+    const uint8_t* bom = data + blockOffset + 8;
+    bigEndian_ = false;
+    if (Read32(bom) != BYTE_ORDER_MAGIC) {
+        bigEndian_ = true;
+        if (Read32(bom) != BYTE_ORDER_MAGIC) {
+            lastError_ = "Invalid pcapng byte-order magic";
+            return false;
+        }
+    }
+
+    uint32_t blockLength = Read32(data + blockOffset + 4);
+    if (blockLength < 28 || blockOffset + blockLength > size) {
+        lastError_ = "Invalid pcapng section header length";
+        return false;
+    }
+
+    // Interface ids are scoped to a section
+    interfaces_.clear();
+    offset_ = blockOffset + blockLength;
+    return true;
+}
+
+void PacketReplay::ParseInterfaceBlock(const uint8_t* body, size_t length) {
+    Interface iface;
+    iface.linkType = length >= 2 ? Read16(body) : LINKTYPE_ETHERNET;
+    iface.ticksPerSecond = 1000000;
+
+    size_t offset = 8;
+    while (offset + 4 <= length) {
+        uint16_t code = Read16(body + offset);
+        uint16_t optionLength = Read16(body + offset + 2);
+        offset += 4;
+        if (code == 0 || offset + optionLength > length) {
+            break;
+        }
+        if (code == 9 && optionLength >= 1) {
+            // if_tsresol: MSB clear = negative power of 10, set = negative power of 2
+            uint8_t resolution = body[offset];
+            uint64_t ticks = 1;
+            if (resolution & 0x80) {
+                ticks = 1ULL << std::min<int>(resolution & 0x7F, 63);
+            } else {
+                for (int i = 0; i < (resolution & 0x7F) && i < 19; ++i) {
+                    ticks *= 10;
+                }
+            }
+            iface.ticksPerSecond = ticks;
+        }
+        offset += Pad4(optionLength);
+    }
+
+    interfaces_.push_back(iface);
+}
+
+bool PacketReplay::NextPacket(NetworkMonitor::PacketInfo& packet) {
+    switch (format_) {
+        case Format::Pcap: return NextPcapPacket(packet);
+        case Format::PcapNg: return NextPcapNgPacket(packet);
+        default: return false;
+    }
+}
+
+bool PacketReplay::NextPcapPacket(NetworkMonitor::PacketInfo& packet) {
+    const uint8_t* data = file_.Data();
+    size_t size = file_.Size();
+
+    if (offset_ + 16 > size) {
+        if (offset_ != size) {
+            malformedRecords_++;
+        }
+        return false;
+    }
+
+    const uint8_t* header = data + offset_;
+    uint64_t seconds = Read32(header);
+    uint64_t fraction = Read32(header + 4);
+    uint32_t capturedLength = Read32(header + 8);
+    uint32_t originalLength = Read32(header + 12);
+
+    if (offset_ + 16 + capturedLength > size) {
+        malformedRecords_++;
+        return false;
+    }
+
+    const uint8_t* frame = header + 16;
+    offset_ += 16 + capturedLength;
+
+    DecodeFrame(pcapLinkType_, frame, capturedLength, packet);
+    packet.timestampNs = seconds * 1000000000ULL + TicksToNanoseconds(fraction, pcapTicksPerSecond_);
+    packet.capturedLength = capturedLength;
+    packet.originalLength = originalLength;
+    return true;
+}
+
+bool PacketReplay::NextPcapNgPacket(NetworkMonitor::PacketInfo& packet) {
+    const uint8_t* data = file_.Data();
+    size_t size = file_.Size();
+
+    while (offset_ + 12 <= size) {
+        const uint8_t* block = data + offset_;
+        uint32_t leType = static_cast<uint32_t>(block[0]) | (static_cast<uint32_t>(block[1]) << 8) |
+                          (static_cast<uint32_t>(block[2]) << 16) | (static_cast<uint32_t>(block[3]) << 24);
+
+        // A new section may switch byte order, so handle it before Read32
+        if (leType == BLOCK_SECTION_HEADER) {
+            if (!ParsePcapNgSection(offset_)) {
+                malformedRecords_++;
+                return false;
+            }
+            continue;
+        }
+
+        uint32_t blockType = Read32(block);
+        uint32_t blockLength = Read32(block + 4);
+        if (blockLength < 12 || (blockLength & 3) != 0 || offset_ + blockLength > size) {
+            malformedRecords_++;
+            return false;
+        }
+
+        const uint8_t* body = block + 8;
+        size_t bodyLength = blockLength - 12;
+        offset_ += blockLength;
+
+        uint32_t interfaceId = 0;
+        uint64_t ticks = 0;
+        uint32_t capturedLength = 0;
+        uint32_t originalLength = 0;
+        const uint8_t* frame = nullptr;
+
+        if (blockType == BLOCK_INTERFACE) {
+            ParseInterfaceBlock(body, bodyLength);
+            continue;
+        } else if (blockType == BLOCK_ENHANCED_PACKET && bodyLength >= 20) {
+            interfaceId = Read32(body);
+            ticks = (static_cast<uint64_t>(Read32(body + 4)) << 32) | Read32(body + 8);
+            capturedLength = Read32(body + 12);
+            originalLength = Read32(body + 16);
+            frame = body + 20;
+            if (capturedLength > bodyLength - 20) {
+                malformedRecords_++;
+                continue;
+            }
+        } else if (blockType == BLOCK_SIMPLE_PACKET && bodyLength >= 4) {
+            originalLength = Read32(body);
+            capturedLength = std::min<uint32_t>(originalLength, static_cast<uint32_t>(bodyLength - 4));
+            frame = body + 4;
+        } else if (blockType == BLOCK_PACKET_OBSOLETE && bodyLength >= 20) {
+            interfaceId = Read16(body);
+            ticks = (static_cast<uint64_t>(Read32(body + 4)) << 32) | Read32(body + 8);
+            capturedLength = Read32(body + 12);
+            originalLength = Read32(body + 16);
+            frame = body + 20;
+            if (capturedLength > bodyLength - 20) {
+                malformedRecords_++;
+                continue;
+            }
+        } else {
+            // Name resolution, statistics and custom blocks are not needed for replay
+            continue;
+        }
+
+        if (interfaceId >= interfaces_.size()) {
+            malformedRecords_++;
+            continue;
+        }
+
+        const Interface& iface = interfaces_[interfaceId];
+        DecodeFrame(iface.linkType, frame, capturedLength, packet);
+        packet.timestampNs = TicksToNanoseconds(ticks, iface.ticksPerSecond);
+        packet.capturedLength = capturedLength;
+        packet.originalLength = originalLength;
+        return true;
+    }
+
+    if (offset_ != size) {
+        malformedRecords_++;
+    }
+    return false;
+}
+
+bool PacketReplay::DecodeFrame(uint32_t linkType, const uint8_t* data, size_t length,
+                               NetworkMonitor::PacketInfo& packet) {
+    packet.ipVersion = 0;
+    packet.protocol = 0;
+    packet.tcpFlags = 0;
+    packet.srcPort = 0;
+    packet.dstPort = 0;
+    packet.payloadLength = 0;
+    std::memset(packet.srcAddr, 0, sizeof(packet.srcAddr));
+    std::memset(packet.dstAddr, 0, sizeof(packet.dstAddr));
+
+    switch (linkType) {
+        case LINKTYPE_ETHERNET: {
+            if (length < 14) {
+                return false;
+            }
+            size_t offset = 12;
+            uint16_t etherType = Be16(data + offset);
+            // Strip up to two VLAN tags (802.1Q / 802.1ad)
+            for (int tags = 0; tags < 2; ++tags) {
+                if (etherType != ETHERTYPE_VLAN && etherType != ETHERTYPE_QINQ &&
+                    etherType != ETHERTYPE_QINQ_LEGACY) {
+                    break;
+                }
+                if (offset + 6 > length) {
+                    return false;
+                }
+                offset += 4;
+                etherType = Be16(data + offset);
+            }
+            offset += 2;
+            return DecodeNetwork(etherType, data + offset, length - offset, packet);
+        }
+        case LINKTYPE_RAW:
+        case LINKTYPE_RAW_LEGACY:
+        case LINKTYPE_RAW_LEGACY_BSD: {
+            if (length < 1) {
+                return false;
+            }
+            uint16_t etherType = (data[0] >> 4) == 6 ? ETHERTYPE_IPV6 : ETHERTYPE_IPV4;
+            return DecodeNetwork(etherType, data, length, packet);
+        }
+        case LINKTYPE_LINUX_SLL: {
+            if (length < 16) {
+                return false;
+            }
+            return DecodeNetwork(Be16(data + 14), data + 16, length - 16, packet);
+        }
+        case LINKTYPE_LINUX_SLL2: {
+            if (length < 20) {
+                return false;
+            }
+            return DecodeNetwork(Be16(data), data + 20, length - 20, packet);
+        }
+        case LINKTYPE_NULL: {
+            if (length < 4) {
+                return false;
+            }
+            // Address family in host byte order of the capturing machine
+            uint32_t family = data[0] != 0 ? data[0] : data[3];
+            uint16_t etherType = family == 2 ? ETHERTYPE_IPV4 : ETHERTYPE_IPV6;
+            return DecodeNetwork(etherType, data + 4, length - 4, packet);
+        }
+        default:
+            return false;
+    }
+}
+
+PacketReplay::ReplayStats PacketReplay::Replay(NetworkMonitor& monitor, const ReplayOptions& options) {
+    return Replay([&monitor](const NetworkMonitor::PacketInfo& packet) {
+        monitor.ProcessPacket(packet);
+    }, options);
+}
+
+PacketReplay::ReplayStats PacketReplay::Replay(const PacketCallback& callback, const ReplayOptions& options) {
+    ReplayStats stats;
+    if (!IsOpen()) {
+        return stats;
+    }
+
+    double speed = options.speedMultiplier > 0.0 ? options.speedMultiplier : 1.0;
+    NetworkMonitor::PacketInfo packet;
+    uint64_t firstTimestamp = 0;
+    uint64_t malformedBefore = malformedRecords_;
+    auto start = std::chrono::steady_clock::now();
+
+    while (NextPacket(packet)) {
+        if (options.originalTiming) {
+            if (stats.packetsRead == 0) {
+                firstTimestamp = packet.timestampNs;
+            } else if (packet.timestampNs > firstTimestamp) {
+                auto offset = std::chrono::nanoseconds(
+                    static_cast<int64_t>((packet.timestampNs - firstTimestamp) / speed));
+                std::this_thread::sleep_until(start + offset);
+            }
+        }
+
+        stats.packetsRead++;
+        stats.bytesRead += packet.capturedLength;
+        if (packet.ipVersion != 0) {
+            stats.packetsDecoded++;
+        }
+        callback(packet);
+
+        if (options.maxPackets != 0 && stats.packetsRead >= options.maxPackets) {
+            break;
+        }
+    }
+
+    stats.malformedRecords = malformedRecords_ - malformedBefore;
+
+    stats.elapsedSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (stats.elapsedSeconds > 0.0) {
+        stats.packetsPerSecond = stats.packetsRead / stats.elapsedSeconds;
+        stats.megabitsPerSecond = (stats.bytesRead * 8.0 / 1e6) / stats.elapsedSeconds;
+    }
+    return stats;
+}
@@ -0,0 +1,308 @@
+#include "ProcessAttribution.h"
+#include "Utils.h"
+#include <chrono>
+#include <cstring>
+#include <cstdlib>
+
+#ifdef __linux__
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+    // Parses "socket:[12345]"
+    bool ParseSocketLink(const char* link, size_t length, uint64_t& inode) {
+        static const char prefix[] = "socket:[";
+        const size_t prefixLength = sizeof(prefix) - 1;
+        if (length <= prefixLength + 1 || std::memcmp(link, prefix, prefixLength) != 0 || link[length - 1] != ']') {
+            return false;
+        }
+        uint64_t value = 0;
+        for (size_t i = prefixLength; i < length - 1; ++i) {
+            if (link[i] < '0' || link[i] > '9') {
+                return false;
+            }
+            value = value * 10 + static_cast<uint64_t>(link[i] - '0');
+        }
+        inode = value;
+        return true;
+    }
+
+    bool ParsePid(const char* name, int& pid) {
+        if (*name == '\0') {
+            return false;
+        }
+        int value = 0;
+        for (const char* p = name; *p; ++p) {
+            if (*p < '0' || *p > '9') {
+                return false;
+            }
+            value = value * 10 + (*p - '0');
+        }
+        pid = value;
+        return true;
+    }
+}
+
+ProcessAttribution::ProcessAttribution(const std::string& procRoot)
+    : procRoot_(procRoot), realProc_(procRoot == "/proc"), generation_(0), fullRescanInterval_(60) {
+}
+
+#ifdef __linux__
+
+bool ProcessAttribution::CountDescriptors(int pid, size_t& count) const {
+    std::string fdDir = procRoot_ + "/" + std::to_string(pid) + "/fd";
+
+    // Linux 6.2+ reports the number of open descriptors as the size of /proc/<pid>/fd
+    if (realProc_) {
+        struct stat st;
+        if (stat(fdDir.c_str(), &st) != 0) {
+            return false;
+        }
+        if (st.st_size > 0) {
+            count = static_cast<size_t>(st.st_size);
+            return true;
+        }
+    }
+
+    DIR* dir = opendir(fdDir.c_str());
+    if (!dir) {
+        return false;
+    }
+    size_t entries = 0;
+    while (struct dirent* entry = readdir(dir)) {
+        if (entry->d_name[0] != '.') {
+            entries++;
+        }
+    }
+    closedir(dir);
+    count = entries;
+    return true;
+}
+
+uint64_t ProcessAttribution::ReadStartTime(int pid) const {
+    std::string path = procRoot_ + "/" + std::to_string(pid) + "/stat";
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return 0;
+    }
+    char buffer[1024];
+    ssize_t length = read(fd, buffer, sizeof(buffer) - 1);
+    close(fd);
+    if (length <= 0) {
+        return 0;
+    }
+    buffer[length] = '\0';
+
+    // comm may contain spaces and parentheses; fields resume after the last ')'
+    const char* p = std::strrchr(buffer, ')');
+    if (!p) {
+        return 0;
+    }
+    // Field 3 (state) follows; skip fields 3..21 to reach starttime
+    for (int field = 3; field <= 22; ++field) {
+        while (*p && *p != ' ') ++p;
+        while (*p == ' ') ++p;
+        if (!*p) {
+            return 0;
+        }
+    }
+    return std::strtoull(p, nullptr, 10);
+}
+
+uint64_t ProcessAttribution::ReadSocketLinks(int pid, std::vector<uint64_t>& inodes) const {
+    std::string fdDir = procRoot_ + "/" + std::to_string(pid) + "/fd";
+    int dirFd = open(fdDir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dirFd < 0) {
+        return 0;
+    }
+    DIR* dir = fdopendir(dirFd);
+    if (!dir) {
+        close(dirFd);
+        return 0;
+    }
+
+    uint64_t linksRead = 0;
+    char target[64];
+    while (struct dirent* entry = readdir(dir)) {
+        if (entry->d_name[0] == '.') {
+            continue;
+        }
+        // readlinkat relative to the fd directory avoids rebuilding the path
+        ssize_t length = readlinkat(dirFd, entry->d_name, target, sizeof(target));
+        linksRead++;
+        uint64_t inode = 0;
+        if (length > 0 && ParseSocketLink(target, static_cast<size_t>(length), inode)) {
+            inodes.push_back(inode);
+        }
+    }
+    closedir(dir);
+    return linksRead;
+}
+
+void ProcessAttribution::LoadProcessInfo(int pid, ProcessState& state) const {
+    std::string base = procRoot_ + "/" + std::to_string(pid);
+    state.name = Utils::Trim(Utils::ReadFile(base + "/comm"));
+
+    char target[4096];
+    ssize_t length = readlink((base + "/exe").c_str(), target, sizeof(target) - 1);
+    state.exe = length > 0 ? std::string(target, static_cast<size_t>(length)) : "";
+    state.infoLoaded = true;
+}
+
+ProcessAttribution::RefreshStats ProcessAttribution::Refresh() {
+    RefreshStats stats = {0, 0, 0, 0, 0.0};
+    auto start = std::chrono::steady_clock::now();
+
+    generation_++;
+    bool fullRescan = fullRescanInterval_ > 0 && generation_ % static_cast<uint64_t>(fullRescanInterval_) == 0;
+
+    DIR* dir = opendir(procRoot_.c_str());
+    if (!dir) {
+        return stats;
+    }
+
+    std::vector<uint64_t> inodes;
+    while (struct dirent* entry = readdir(dir)) {
+        int pid = 0;
+        if (!ParsePid(entry->d_name, pid)) {
+            continue;
+        }
+        stats.processesSeen++;
+
+        size_t fdCount = 0;
+        if (!CountDescriptors(pid, fdCount)) {
+            continue; // Exited, or not ours to inspect
+        }
+
+        uint64_t startTime = ReadStartTime(pid);
+        auto it = processes_.find(pid);
+        bool isNew = it == processes_.end();
+        if (!isNew) {
+            ProcessState& state = it->second;
+            state.generation = generation_;
+            bool reused = state.startTime != startTime;
+            if (!fullRescan && !reused && state.fdCount == fdCount) {
+                continue;
+            }
+            DropInodes(pid, state);
+            if (reused) {
+                // Same pid, different process: nothing cached for the old one applies
+                state.startTime = startTime;
+                state.infoLoaded = false;
+                state.name.clear();
+                state.exe.clear();
+                stats.processesExited++;
+            }
+        } else {
+            ProcessState state;
+            state.infoLoaded = false;
+            state.startTime = startTime;
+            it = processes_.emplace(pid, std::move(state)).first;
+            it->second.generation = generation_;
+        }
+
+        inodes.clear();
+        stats.linksRead += ReadSocketLinks(pid, inodes);
+        stats.processesRescanned++;
+
+        ProcessState& state = it->second;
+        state.fdCount = fdCount;
+        state.inodes = inodes;
+        for (uint64_t inode : inodes) {
+            inodeOwner_[inode] = pid;
+        }
+    }
+    closedir(dir);
+
+    // Forget processes that were not seen in this pass
+    for (auto it = processes_.begin(); it != processes_.end();) {
+        if (it->second.generation != generation_) {
+            DropInodes(it->first, it->second);
+            it = processes_.erase(it);
+            stats.processesExited++;
+        } else {
+            ++it;
+        }
+    }
+
+    stats.elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return stats;
+}
+
+#else
+
+bool ProcessAttribution::CountDescriptors(int, size_t&) const {
+    return false;
+}
+
+uint64_t ProcessAttribution::ReadStartTime(int) const {
+    return 0;
+}
+
+uint64_t ProcessAttribution::ReadSocketLinks(int, std::vector<uint64_t>&) const {
+    return 0;
+}
+
+void ProcessAttribution::LoadProcessInfo(int, ProcessState& state) const {
+    state.infoLoaded = true;
+}
+
+ProcessAttribution::RefreshStats ProcessAttribution::Refresh() {
+    // Windows reports owning pids directly in GetExtendedTcpTable
+    return RefreshStats{0, 0, 0, 0, 0.0};
+}
+
+#endif
+
+void ProcessAttribution::DropInodes(int pid, const ProcessState& state) {
+    for (uint64_t inode : state.inodes) {
+        auto owner = inodeOwner_.find(inode);
+        // The inode may already have moved to another process (fd passing)
+        if (owner != inodeOwner_.end() && owner->second == pid) {
+            inodeOwner_.erase(owner);
+        }
+    }
+}
+
+bool ProcessAttribution::Resolve(uint64_t inode, Owner& owner) {
+    auto it = inodeOwner_.find(inode);
+    if (it == inodeOwner_.end()) {
+        return false;
+    }
+    auto process = processes_.find(it->second);
+    if (process == processes_.end()) {
+        return false;
+    }
+    if (!process->second.infoLoaded) {
+        LoadProcessInfo(process->first, process->second);
+    }
+    owner.pid = process->first;
+    owner.name = process->second.name;
+    owner.exe = process->second.exe;
+    return true;
+}
+
+size_t ProcessAttribution::ResolveBatch(const std::vector<uint64_t>& inodes, std::vector<Owner>& owners) {
+    bool missing = false;
+    for (uint64_t inode : inodes) {
+        if (inode != 0 && inodeOwner_.find(inode) == inodeOwner_.end()) {
+            missing = true;
+            break;
+        }
+    }
+    if (missing) {
+        Refresh();
+    }
+
+    owners.assign(inodes.size(), Owner{0, "", ""});
+    size_t attributed = 0;
+    for (size_t i = 0; i < inodes.size(); ++i) {
+        if (inodes[i] != 0 && Resolve(inodes[i], owners[i])) {
+            attributed++;
+        }
+    }
+    return attributed;
+}
@@ -0,0 +1,531 @@
+#include "ReputationIndex.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace {
+    constexpr char INDEX_MAGIC[8] = {'S', 'S', 'R', 'E', 'P', 'I', 'D', 'X'};
+    constexpr uint32_t INDEX_VERSION = 1;
+    constexpr uint32_t BLOOM_HASHES = 7;
+    constexpr uint64_t BLOOM_BITS_PER_KEY = 10;  // ~1% false positives with 7 hashes
+    constexpr size_t TAG_LENGTH = 32;
+
+    struct IndexHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t headerSize;
+        uint64_t fileSize;
+        uint64_t v4Count;
+        uint64_t v4Offset;
+        uint64_t v6Count;
+        uint64_t v6Offset;
+        uint64_t bloomWords;       // Power of two
+        uint64_t bloomOffset;
+        uint64_t tagCount;
+        uint64_t tagOffset;
+        uint64_t v4Prefixes;       // Bit n set when a /n IPv4 entry exists
+        uint64_t v6Prefixes[3];    // Same for IPv6, /0 to /128
+        uint32_t bloomHashes;
+        uint32_t reserved;
+        uint64_t checksum;         // FNV-1a of this header with checksum = 0
+    };
+
+    uint64_t Fnv1a(const void* data, size_t length) {
+        const uint8_t* bytes = static_cast<const uint8_t*>(data);
+        uint64_t hash = 0xcbf29ce484222325ULL;
+        for (size_t i = 0; i < length; ++i) {
+            hash ^= bytes[i];
+            hash *= 0x100000001b3ULL;
+        }
+        return hash;
+    }
+
+    uint64_t HeaderChecksum(const IndexHeader& header) {
+        IndexHeader copy = header;
+        copy.checksum = 0;
+        return Fnv1a(&copy, sizeof(copy));
+    }
+
+    inline uint64_t Mix64(uint64_t x) {
+        x ^= x >> 30; x *= 0xbf58476d1ce4e5b9ULL;
+        x ^= x >> 27; x *= 0x94d049bb133111ebULL;
+        x ^= x >> 31;
+        return x;
+    }
+
+    inline uint64_t Load64(const uint8_t* p) {
+        uint64_t v;
+        std::memcpy(&v, p, sizeof(v));
+        return v;
+    }
+
+    // Hash of a masked prefix; family and length are part of the key
+    inline uint64_t PrefixHash(const uint8_t addr[16], int prefixLength, bool isIPv6) {
+        uint64_t seed = (static_cast<uint64_t>(prefixLength) << 1) | (isIPv6 ? 1 : 0);
+        uint64_t h = Mix64(Load64(addr) ^ Mix64(seed));
+        return Mix64(h ^ Load64(addr + 8));
+    }
+
+    void MaskPrefix(const uint8_t in[16], int prefixLength, int addressBytes, uint8_t out[16]) {
+        std::memset(out, 0, 16);
+        for (int i = 0; i < addressBytes; ++i) {
+            int bits = prefixLength - i * 8;
+            if (bits >= 8) {
+                out[i] = in[i];
+            } else if (bits > 0) {
+                out[i] = static_cast<uint8_t>(in[i] & (0xFF << (8 - bits)));
+            }
+        }
+    }
+
+    void FillHostBits(const uint8_t in[16], int prefixLength, int addressBytes, uint8_t out[16]) {
+        std::memcpy(out, in, 16);
+        for (int i = 0; i < addressBytes; ++i) {
+            int bits = prefixLength - i * 8;
+            if (bits <= 0) {
+                out[i] = 0xFF;
+            } else if (bits < 8) {
+                out[i] = static_cast<uint8_t>(out[i] | (0xFF >> bits));
+            }
+        }
+    }
+
+    inline uint32_t ToV4(const uint8_t addr[16]) {
+        return (static_cast<uint32_t>(addr[0]) << 24) | (static_cast<uint32_t>(addr[1]) << 16) |
+               (static_cast<uint32_t>(addr[2]) << 8) | static_cast<uint32_t>(addr[3]);
+    }
+
+    // Increment a big-endian 128-bit value; returns false on overflow
+    bool Increment128(uint8_t value[16]) {
+        for (int i = 15; i >= 0; --i) {
+            if (++value[i] != 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    inline bool IsSeparator(char c) {
+        return c == ' ' || c == '\t' || c == ',' || c == ';' || c == '#' || c == '\r';
+    }
+
+    // Extract the first field of a feed line: "1.2.3.0/24", "\"1.2.3.4\",score,..."
+    bool ParseFeedEntry(const char* line, size_t length, uint8_t addr[16], bool& isIPv6, int& prefixLength) {
+        size_t pos = 0;
+        while (pos < length && (line[pos] == ' ' || line[pos] == '\t' || line[pos] == '"')) {
+            ++pos;
+        }
+        size_t start = pos;
+        while (pos < length && !IsSeparator(line[pos]) && line[pos] != '"') {
+            ++pos;
+        }
+        size_t tokenLength = pos - start;
+        if (tokenLength == 0 || tokenLength >= 64) {
+            return false;
+        }
+
+        char token[64];
+        std::memcpy(token, line + start, tokenLength);
+        token[tokenLength] = '\0';
+
+        int maxPrefix = -1;
+        char* slash = std::strchr(token, '/');
+        if (slash) {
+            *slash = '\0';
+            char* end = nullptr;
+            long value = std::strtol(slash + 1, &end, 10);
+            if (end == slash + 1 || *end != '\0' || value < 0) {
+                return false;
+            }
+            maxPrefix = static_cast<int>(value);
+        }
+
+        if (!Utils::ParseIP(token, addr, isIPv6)) {
+            return false;
+        }
+        int fullLength = isIPv6 ? 128 : 32;
+        if (maxPrefix > fullLength) {
+            return false;
+        }
+        prefixLength = maxPrefix < 0 ? fullLength : maxPrefix;
+        return true;
+    }
+
+    std::string FeedName(const std::string& path) {
+        size_t slash = path.find_last_of("/\\");
+        return slash == std::string::npos ? path : path.substr(slash + 1);
+    }
+
+    inline int TrailingZeros(uint64_t value) {
+#ifdef _MSC_VER
+        unsigned long index;
+        _BitScanForward64(&index, value);
+        return static_cast<int>(index);
+#else
+        return __builtin_ctzll(value);
+#endif
+    }
+
+    inline uint64_t Align8(uint64_t value) {
+        return (value + 7) & ~static_cast<uint64_t>(7);
+    }
+}
+
+struct ReputationIndex::V4Range {
+    uint32_t start;
+    uint32_t end;
+    uint32_t tag;
+};
+
+struct ReputationIndex::V6Range {
+    uint8_t start[16];
+    uint8_t end[16];
+    uint32_t tag;
+    uint32_t reserved;
+};
+
+ReputationIndex::ReputationIndex()
+    : v4Ranges_(nullptr), v6Ranges_(nullptr), bloom_(nullptr), tags_(nullptr),
+      v4Count_(0), v6Count_(0), bloomMask_(0), tagCount_(0), bloomHashes_(0),
+      v4Prefixes_(0), v6Prefixes_{0, 0, 0} {
+}
+
+ReputationIndex::~ReputationIndex() {
+}
+
+bool ReputationIndex::Compile(const std::vector<std::string>& feedFiles, const std::string& indexFile,
+                              CompileStats* stats, std::string* error) {
+    CompileStats localStats;
+    std::vector<V4Range> v4;
+    std::vector<V6Range> v6;
+    std::vector<uint64_t> prefixHashes;
+    std::vector<std::string> tags;
+    uint64_t v4Prefixes = 0;
+    uint64_t v6Prefixes[3] = {0, 0, 0};
+
+    for (const auto& feedFile : feedFiles) {
+        Utils::MappedFile feed;
+        if (!feed.Open(feedFile)) {
+            if (error) *error = "Cannot open reputation feed: " + feedFile;
+            return false;
+        }
+
+        uint32_t tag = static_cast<uint32_t>(tags.size());
+        tags.push_back(FeedName(feedFile));
+
+        const char* data = reinterpret_cast<const char*>(feed.Data());
+        size_t size = feed.Size();
+        size_t lineStart = 0;
+        while (lineStart < size) {
+            const char* newline = static_cast<const char*>(std::memchr(data + lineStart, '\n', size - lineStart));
+            size_t lineEnd = newline ? static_cast<size_t>(newline - data) : size;
+            const char* line = data + lineStart;
+            size_t lineLength = lineEnd - lineStart;
+            lineStart = lineEnd + 1;
+            localStats.linesRead++;
+
+            uint8_t addr[16];
+            bool isIPv6 = false;
+            int prefixLength = 0;
+            if (lineLength == 0 || line[0] == '#' || line[0] == ';' ||
+                !ParseFeedEntry(line, lineLength, addr, isIPv6, prefixLength)) {
+                localStats.linesSkipped++;
+                continue;
+            }
+            localStats.entriesParsed++;
+
+            uint8_t first[16];
+            uint8_t last[16];
+            int addressBytes = isIPv6 ? 16 : 4;
+            MaskPrefix(addr, prefixLength, addressBytes, first);
+            FillHostBits(first, prefixLength, addressBytes, last);
+            prefixHashes.push_back(PrefixHash(first, prefixLength, isIPv6));
+
+            if (isIPv6) {
+                v6Prefixes[prefixLength / 64] |= 1ULL << (prefixLength % 64);
+                V6Range range;
+                std::memcpy(range.start, first, 16);
+                std::memcpy(range.end, last, 16);
+                range.tag = tag;
+                range.reserved = 0;
+                v6.push_back(range);
+            } else {
+                v4Prefixes |= 1ULL << prefixLength;
+                v4.push_back(V4Range{ToV4(first), ToV4(last), tag});
+            }
+        }
+    }
+
+    // Sort by start and make ranges disjoint: where ranges overlap, the one that
+    // starts first keeps the shared span (the earlier feed when starts are equal)
+    std::sort(v4.begin(), v4.end(), [](const V4Range& a, const V4Range& b) {
+        return a.start != b.start ? a.start < b.start : a.tag < b.tag;
+    });
+    std::vector<V4Range> v4Merged;
+    v4Merged.reserve(v4.size());
+    for (auto range : v4) {
+        if (!v4Merged.empty()) {
+            V4Range& last = v4Merged.back();
+            if (range.start <= last.end) {
+                if (range.end <= last.end) {
+                    continue;
+                }
+                if (range.tag == last.tag) {
+                    last.end = range.end;
+                    continue;
+                }
+                range.start = last.end + 1;
+            } else if (range.tag == last.tag && last.end != UINT32_MAX && range.start == last.end + 1) {
+                last.end = range.end;
+                continue;
+            }
+        }
+        v4Merged.push_back(range);
+    }
+
+    std::sort(v6.begin(), v6.end(), [](const V6Range& a, const V6Range& b) {
+        int cmp = std::memcmp(a.start, b.start, 16);
+        return cmp != 0 ? cmp < 0 : a.tag < b.tag;
+    });
+    std::vector<V6Range> v6Merged;
+    v6Merged.reserve(v6.size());
+    for (auto range : v6) {
+        if (!v6Merged.empty()) {
+            V6Range& last = v6Merged.back();
+            if (std::memcmp(range.start, last.end, 16) <= 0) {
+                if (std::memcmp(range.end, last.end, 16) <= 0) {
+                    continue;
+                }
+                if (range.tag == last.tag) {
+                    std::memcpy(last.end, range.end, 16);
+                    continue;
+                }
+                std::memcpy(range.start, last.end, 16);
+                Increment128(range.start);
+            }
+        }
+        v6Merged.push_back(range);
+    }
+
+    // Bloom filter over (masked prefix, length) keys
+    uint64_t bloomBits = 1024;
+    while (bloomBits < prefixHashes.size() * BLOOM_BITS_PER_KEY) {
+        bloomBits <<= 1;
+    }
+    std::vector<uint64_t> bloom(bloomBits / 64, 0);
+    uint64_t mask = bloomBits - 1;
+    for (uint64_t hash : prefixHashes) {
+        uint64_t h1 = hash;
+        uint64_t h2 = Mix64(hash) | 1;
+        for (uint32_t i = 0; i < BLOOM_HASHES; ++i) {
+            uint64_t bit = (h1 + i * h2) & mask;
+            bloom[bit >> 6] |= 1ULL << (bit & 63);
+        }
+    }
+
+    IndexHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, INDEX_MAGIC, sizeof(INDEX_MAGIC));
+    header.version = INDEX_VERSION;
+    header.headerSize = sizeof(IndexHeader);
+    header.v4Count = v4Merged.size();
+    header.v4Offset = Align8(sizeof(IndexHeader));
+    header.v6Count = v6Merged.size();
+    header.v6Offset = Align8(header.v4Offset + header.v4Count * sizeof(V4Range));
+    header.bloomWords = bloom.size();
+    header.bloomOffset = Align8(header.v6Offset + header.v6Count * sizeof(V6Range));
+    header.tagCount = tags.size();
+    header.tagOffset = header.bloomOffset + header.bloomWords * sizeof(uint64_t);
+    header.fileSize = header.tagOffset + header.tagCount * TAG_LENGTH;
+    header.v4Prefixes = v4Prefixes;
+    std::memcpy(header.v6Prefixes, v6Prefixes, sizeof(v6Prefixes));
+    header.bloomHashes = BLOOM_HASHES;
+    header.checksum = HeaderChecksum(header);
+
+    std::string tempFile = indexFile + ".tmp";
+    {
+        std::ofstream out(tempFile, std::ios::binary | std::ios::trunc);
+        if (!out.is_open()) {
+            if (error) *error = "Cannot create index file: " + tempFile;
+            return false;
+        }
+
+        const char padding[8] = {0};
+        auto padTo = [&out, &padding](uint64_t offset) {
+            uint64_t current = static_cast<uint64_t>(out.tellp());
+            if (offset > current) {
+                out.write(padding, static_cast<std::streamsize>(offset - current));
+            }
+        };
+
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        padTo(header.v4Offset);
+        out.write(reinterpret_cast<const char*>(v4Merged.data()),
+                  static_cast<std::streamsize>(v4Merged.size() * sizeof(V4Range)));
+        padTo(header.v6Offset);
+        out.write(reinterpret_cast<const char*>(v6Merged.data()),
+                  static_cast<std::streamsize>(v6Merged.size() * sizeof(V6Range)));
+        padTo(header.bloomOffset);
+        out.write(reinterpret_cast<const char*>(bloom.data()),
+                  static_cast<std::streamsize>(bloom.size() * sizeof(uint64_t)));
+        for (const auto& tag : tags) {
+            char name[TAG_LENGTH] = {0};
+            std::strncpy(name, tag.c_str(), TAG_LENGTH - 1);
+            out.write(name, TAG_LENGTH);
+        }
+
+        if (!out.good()) {
+            if (error) *error = "Failed to write index file: " + tempFile;
+            out.close();
+            std::remove(tempFile.c_str());
+            return false;
+        }
+    }
+
+#ifdef _WIN32
+    std::remove(indexFile.c_str());
+#endif
+    if (std::rename(tempFile.c_str(), indexFile.c_str()) != 0) {
+        if (error) *error = "Failed to move index into place: " + indexFile;
+        std::remove(tempFile.c_str());
+        return false;
+    }
+
+    localStats.v4Ranges = v4Merged.size();
+    localStats.v6Ranges = v6Merged.size();
+    if (stats) {
+        *stats = localStats;
+    }
+    return true;
+}
+
+bool ReputationIndex::Open(const std::string& indexFile) {
+    if (!file_.Open(indexFile)) {
+        lastError_ = "Cannot open reputation index: " + indexFile;
+        return false;
+    }
+
+    IndexHeader header;
+    if (file_.Size() < sizeof(header)) {
+        lastError_ = "Reputation index too small: " + indexFile;
+        file_.Close();
+        return false;
+    }
+    std::memcpy(&header, file_.Data(), sizeof(header));
+
+    bool valid = std::memcmp(header.magic, INDEX_MAGIC, sizeof(INDEX_MAGIC)) == 0 &&
+                 header.version == INDEX_VERSION &&
+                 header.headerSize == sizeof(IndexHeader) &&
+                 header.checksum == HeaderChecksum(header) &&
+                 header.fileSize == file_.Size() &&
+                 header.bloomWords > 0 && (header.bloomWords & (header.bloomWords - 1)) == 0 &&
+                 header.v4Offset + header.v4Count * sizeof(V4Range) <= header.v6Offset &&
+                 header.v6Offset + header.v6Count * sizeof(V6Range) <= header.bloomOffset &&
+                 header.bloomOffset + header.bloomWords * sizeof(uint64_t) <= header.tagOffset &&
+                 header.tagOffset + header.tagCount * TAG_LENGTH <= header.fileSize;
+    if (!valid) {
+        lastError_ = "Corrupt or incompatible reputation index: " + indexFile;
+        file_.Close();
+        return false;
+    }
+
+    const uint8_t* base = file_.Data();
+    v4Ranges_ = reinterpret_cast<const V4Range*>(base + header.v4Offset);
+    v6Ranges_ = reinterpret_cast<const V6Range*>(base + header.v6Offset);
+    bloom_ = reinterpret_cast<const uint64_t*>(base + header.bloomOffset);
+    tags_ = reinterpret_cast<const char*>(base + header.tagOffset);
+    v4Count_ = header.v4Count;
+    v6Count_ = header.v6Count;
+    bloomMask_ = header.bloomWords * 64 - 1;
+    bloomHashes_ = header.bloomHashes;
+    tagCount_ = header.tagCount;
+    v4Prefixes_ = header.v4Prefixes;
+    std::memcpy(v6Prefixes_, header.v6Prefixes, sizeof(v6Prefixes_));
+    return true;
+}
+
+bool ReputationIndex::BloomMayContain(const uint8_t addr[16], int prefixLength, bool isIPv6) const {
+    uint8_t masked[16];
+    MaskPrefix(addr, prefixLength, isIPv6 ? 16 : 4, masked);
+    uint64_t h1 = PrefixHash(masked, prefixLength, isIPv6);
+    uint64_t h2 = Mix64(h1) | 1;
+    for (uint32_t i = 0; i < bloomHashes_; ++i) {
+        uint64_t bit = (h1 + i * h2) & bloomMask_;
+        if ((bloom_[bit >> 6] & (1ULL << (bit & 63))) == 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool ReputationIndex::Lookup(const uint8_t addr[16], bool isIPv6, std::string* feed) const {
+    if (!IsOpen()) {
+        return false;
+    }
+
+    // Probe the filter once per prefix length present in the feeds
+    bool candidate = false;
+    if (isIPv6) {
+        for (int word = 0; word < 3 && !candidate; ++word) {
+            for (uint64_t bits = v6Prefixes_[word]; bits != 0 && !candidate; bits &= bits - 1) {
+                int length = word * 64 + TrailingZeros(bits);
+                candidate = BloomMayContain(addr, length, true);
+            }
+        }
+    } else {
+        for (uint64_t bits = v4Prefixes_; bits != 0 && !candidate; bits &= bits - 1) {
+            candidate = BloomMayContain(addr, TrailingZeros(bits), false);
+        }
+    }
+    if (!candidate) {
+        return false;
+    }
+
+    uint32_t tag = 0;
+    bool found = false;
+    if (isIPv6) {
+        const V6Range* end = v6Ranges_ + v6Count_;
+        const V6Range* it = std::upper_bound(v6Ranges_, end, addr,
+            [](const uint8_t* value, const V6Range& range) { return std::memcmp(value, range.start, 16) < 0; });
+        if (it != v6Ranges_ && std::memcmp(addr, (it - 1)->end, 16) <= 0) {
+            tag = (it - 1)->tag;
+            found = true;
+        }
+    } else {
+        uint32_t value = ToV4(addr);
+        const V4Range* end = v4Ranges_ + v4Count_;
+        const V4Range* it = std::upper_bound(v4Ranges_, end, value,
+            [](uint32_t v, const V4Range& range) { return v < range.start; });
+        if (it != v4Ranges_ && value <= (it - 1)->end) {
+            tag = (it - 1)->tag;
+            found = true;
+        }
+    }
+
+    if (found && feed) {
+        *feed = TagName(tag);
+    }
+    return found;
+}
+
+bool ReputationIndex::Contains(const std::string& ip, std::string* feed) const {
+    uint8_t addr[16];
+    bool isIPv6 = false;
+    if (!Utils::ParseIP(ip, addr, isIPv6)) {
+        return false;
+    }
+    return Lookup(addr, isIPv6, feed);
+}
+
+std::string ReputationIndex::TagName(uint32_t tag) const {
+    if (tag >= tagCount_) {
+        return "";
+    }
+    const char* name = tags_ + static_cast<size_t>(tag) * TAG_LENGTH;
+    return std::string(name, strnlen(name, TAG_LENGTH));
+}
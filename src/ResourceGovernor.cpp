@@ -0,0 +1,226 @@
+#include "ResourceGovernor.h"
+#include "Utils.h"
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#elif defined(_WIN32)
+#include <windows.h>
+#endif
+
+namespace {
+    const char* LevelNames[] = {"low", "medium", "high", "maximum"};
+    const double DefaultCpuPercent[] = {5, 10, 25, 0};
+    const int DefaultIoMegabytes[] = {5, 20, 50, 0};
+    const std::chrono::seconds ReportInterval(5);
+
+    thread_local bool governed = false;
+    thread_local uint64_t lastCpuNanos = 0;
+
+    uint64_t ThreadCpuNanos() {
+#ifdef __linux__
+        timespec ts;
+        if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) == 0) {
+            return static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL + static_cast<uint64_t>(ts.tv_nsec);
+        }
+#elif defined(_WIN32)
+        FILETIME creation, exit, kernel, user;
+        if (GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user)) {
+            uint64_t k = (static_cast<uint64_t>(kernel.dwHighDateTime) << 32) | kernel.dwLowDateTime;
+            uint64_t u = (static_cast<uint64_t>(user.dwHighDateTime) << 32) | user.dwLowDateTime;
+            return (k + u) * 100;
+        }
+#endif
+        return 0;
+    }
+}
+
+void ResourceGovernor::TokenBucket::SetRate(double rate) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    rate_ = rate;
+    tokens_ = rate;     // Start with a full one-second burst
+    last_ = std::chrono::steady_clock::now();
+}
+
+std::chrono::nanoseconds ResourceGovernor::TokenBucket::Take(double amount) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (rate_ <= 0) {
+        return std::chrono::nanoseconds(0);
+    }
+    auto now = std::chrono::steady_clock::now();
+    tokens_ = std::min(rate_, tokens_ + std::chrono::duration<double>(now - last_).count() * rate_);
+    last_ = now;
+    tokens_ -= amount;
+    if (tokens_ >= 0) {
+        return std::chrono::nanoseconds(0);
+    }
+    return std::chrono::nanoseconds(static_cast<int64_t>(-tokens_ / rate_ * 1e9));
+}
+
+ResourceGovernor::ResourceGovernor() : level_(0), stats_{} {
+    SetLevel(2);
+}
+
+ResourceGovernor& ResourceGovernor::Instance() {
+    static ResourceGovernor instance;
+    return instance;
+}
+
+ResourceGovernor::Budget ResourceGovernor::GetBudgetForLevel(int level) {
+    int index = std::min(std::max(level, 1), 4) - 1;
+    auto& config = Utils::Config::Instance();
+    std::string name = LevelNames[index];
+    int cpu = config.GetInt("governor", name + "_cpu_percent", static_cast<int>(DefaultCpuPercent[index]));
+    int io = config.GetInt("governor", name + "_io_mb_per_second", DefaultIoMegabytes[index]);
+    return Budget(std::max(cpu, 0), static_cast<uint64_t>(std::max(io, 0)) << 20);
+}
+
+void ResourceGovernor::SetLevel(int level) {
+    level = std::min(std::max(level, 1), 4);
+    Budget budget = GetBudgetForLevel(level);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        level_ = level;
+        stats_.level = level;
+    }
+    SetBudget(budget);
+}
+
+int ResourceGovernor::GetLevel() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return level_;
+}
+
+void ResourceGovernor::SetBudget(const Budget& budget) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        budget_ = budget;
+    }
+    // CPU tokens are nanoseconds of thread time
+    cpu_.SetRate(budget.cpuPercent / 100.0 * 1e9);
+    io_.SetRate(static_cast<double>(budget.ioBytesPerSecond));
+}
+
+ResourceGovernor::Budget ResourceGovernor::GetBudget() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return budget_;
+}
+
+bool ResourceGovernor::EnterBackgroundMode() {
+    bool applied = true;
+#ifdef __linux__
+    sched_param param{};
+    param.sched_priority = 0;
+    if (pthread_setschedparam(pthread_self(), SCHED_IDLE, &param) != 0) {
+        applied = false;
+    }
+#ifdef SYS_ioprio_set
+    // ioprio_set(IOPRIO_WHO_PROCESS, 0, IOPRIO_CLASS_IDLE): 0 is the calling thread
+    const int ioprioWhoProcess = 1;
+    const int ioprioClassIdle = 3;
+    const int ioprioClassShift = 13;
+    if (syscall(SYS_ioprio_set, ioprioWhoProcess, 0, ioprioClassIdle << ioprioClassShift) != 0) {
+        applied = false;
+    }
+#endif
+#elif defined(_WIN32)
+    // Lowers both CPU and I/O priority of the calling thread
+    applied = SetThreadPriority(GetCurrentThread(), THREAD_MODE_BACKGROUND_BEGIN) != 0;
+#endif
+    if (!governed) {
+        governed = true;
+        lastCpuNanos = ThreadCpuNanos();
+    }
+    return applied;
+}
+
+bool ResourceGovernor::IsBackgroundThread() {
+    return governed;
+}
+
+void ResourceGovernor::ChargeIo(uint64_t bytes, const char* work) {
+    if (!governed || bytes == 0) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stats_.ioBytesCharged += bytes;
+    }
+    Wait(io_.Take(static_cast<double>(bytes)), work, "io");
+}
+
+void ResourceGovernor::ChargeCpu(const char* work) {
+    if (!governed) {
+        return;
+    }
+    uint64_t now = ThreadCpuNanos();
+    uint64_t used = now > lastCpuNanos ? now - lastCpuNanos : 0;
+    lastCpuNanos = now;
+    if (used == 0) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stats_.cpuNanosCharged += used;
+    }
+    Wait(cpu_.Take(static_cast<double>(used)), work, "cpu");
+}
+
+void ResourceGovernor::Wait(std::chrono::nanoseconds delay, const char* work, const char* resource) {
+    if (delay.count() <= 0) {
+        return;
+    }
+    std::this_thread::sleep_for(delay);
+    // Sleeping is not CPU time; don't bill the wakeup for it
+    lastCpuNanos = ThreadCpuNanos();
+
+    double seconds = std::chrono::duration<double>(delay).count();
+    std::vector<Deferral> reports;
+    DeferralCallback callback;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stats_.deferrals++;
+        stats_.deferredSeconds += seconds;
+
+        Deferral& pending = pending_[std::make_pair(std::string(work), std::string(resource))];
+        if (pending.work.empty()) {
+            pending.work = work;
+            pending.resource = resource;
+            pending.count = 0;
+            pending.seconds = 0;
+        }
+        pending.count++;
+        pending.seconds += seconds;
+        pending.level = level_;
+
+        auto now = std::chrono::steady_clock::now();
+        if (callback_ && now - lastReport_ >= ReportInterval) {
+            lastReport_ = now;
+            for (const auto& entry : pending_) {
+                reports.push_back(entry.second);
+            }
+            pending_.clear();
+            callback = callback_;
+        }
+    }
+    for (const auto& report : reports) {
+        callback(report);
+    }
+}
+
+void ResourceGovernor::SetDeferralCallback(DeferralCallback callback) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    callback_ = callback;
+    lastReport_ = std::chrono::steady_clock::time_point();
+}
+
+ResourceGovernor::Statistics ResourceGovernor::GetStatistics() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
@@ -0,0 +1,337 @@
+#include "RiskScorer.h"
+#include "CorrelationEngine.h"
+#include "Utils.h"
+#include <algorithm>
+#include <cmath>
+#include <queue>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace {
+    // Scaled scores are rebased before exp() gets anywhere near overflow
+    const double kMaxExponent = 500;
+    const size_t kEvictionSamples = 8;
+    // Host score at which GetHostLevel reaches 2, 3, 4 and 5
+    const double kLevelThresholds[] = {8, 24, 64, 128};
+
+    std::string LocalHostName() {
+        char name[256] = {};
+        if (gethostname(name, sizeof(name) - 1) == 0 && name[0]) {
+            return name;
+        }
+        return "localhost";
+    }
+}
+
+RiskScorer::RiskScorer(const Options& options)
+    : options_(options), lambda_(std::log(2.0) / std::max(1.0, options.halfLifeSeconds)),
+      hasBase_(false), events_(0), evicted_(0), sampleState_(0x9E3779B97F4A7C15ULL) {
+    if (options_.host.empty()) {
+        options_.host = LocalHostName();
+    }
+    options_.maxEntities = std::max<size_t>(1, std::min<size_t>(options_.maxEntities, UINT32_MAX / 4));
+    // Connections are frequent and mostly benign on their own
+    typeWeights_["CONNECTION"] = 0.25;
+}
+
+void RiskScorer::SetTypeWeight(const std::string& type, double weight) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    typeWeights_[Utils::ToUpper(type)] = std::max(0.0, weight);
+}
+
+double RiskScorer::SeverityWeight(int severity) {
+    static const double weights[] = {0, 0, 1, 3, 8, 16};
+    return weights[std::min(std::max(severity, 0), 5)];
+}
+
+void RiskScorer::Observe(const CorrelationEvent& event) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    events_++;
+    auto it = typeWeights_.find(Utils::ToUpper(event.type));
+    double weight = (it == typeWeights_.end() ? 1.0 : it->second) * SeverityWeight(event.severity);
+    if (weight <= 0) {
+        return;
+    }
+    Credit(EntityKind::Host, options_.host, weight, event.timestamp);
+    if (!event.keys[CorrelationEvent::Ip].empty()) {
+        Credit(EntityKind::Ip, event.keys[CorrelationEvent::Ip], weight, event.timestamp);
+    }
+    if (!event.keys[CorrelationEvent::Pid].empty()) {
+        Credit(EntityKind::Process, event.keys[CorrelationEvent::Pid], weight, event.timestamp);
+    }
+    if (!event.keys[CorrelationEvent::User].empty()) {
+        Credit(EntityKind::User, event.keys[CorrelationEvent::User], weight, event.timestamp);
+    }
+}
+
+void RiskScorer::Add(EntityKind kind, const std::string& id, double weight,
+                     std::chrono::system_clock::time_point when) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    events_++;
+    if (weight > 0) {
+        Credit(kind, id, weight, when);
+    }
+}
+
+void RiskScorer::Credit(EntityKind kind, const std::string& id, double weight,
+                        std::chrono::system_clock::time_point when) {
+    double scale = Scale(when);
+    std::string key = MakeKey(kind, id);
+    uint32_t hash = Hash(key);
+    if (slots_.empty()) {
+        Grow();
+    }
+    size_t slot = FindSlot(key, hash);
+    if (slots_[slot] == 0) {
+        if (nodes_.size() >= options_.maxEntities) {
+            Evict();
+        }
+        if ((nodes_.size() + 1) * 2 > slots_.size()) {
+            Grow();
+        }
+        slot = FindSlot(key, hash);
+        Node node;
+        node.key = std::move(key);
+        node.scaled = 0;
+        node.hash = hash;
+        node.heapIndex = static_cast<uint32_t>(heap_.size());
+        node.events = 0;
+        node.lastSeen = when;
+        nodes_.push_back(std::move(node));
+        heap_.push_back(static_cast<uint32_t>(nodes_.size() - 1));
+        slots_[slot] = static_cast<uint32_t>(nodes_.size());
+    }
+
+    // Adding weight only ever raises a scaled score, so the node can only move up
+    Node& node = nodes_[slots_[slot] - 1];
+    node.scaled += weight * scale;
+    node.events++;
+    node.lastSeen = std::max(node.lastSeen, when);
+    SiftUp(node.heapIndex);
+}
+
+double RiskScorer::Scale(std::chrono::system_clock::time_point when) {
+    if (!hasBase_) {
+        base_ = when;
+        hasBase_ = true;
+    }
+    double exponent = lambda_ * std::chrono::duration<double>(when - base_).count();
+    if (exponent > kMaxExponent) {
+        // Same factor for every node: the heap order is unchanged
+        double factor = std::exp(-exponent);
+        for (auto& node : nodes_) {
+            node.scaled *= factor;
+        }
+        base_ = when;
+        exponent = 0;
+    }
+    return std::exp(exponent);
+}
+
+double RiskScorer::Decay(std::chrono::system_clock::time_point now) const {
+    return std::exp(-lambda_ * std::chrono::duration<double>(now - base_).count());
+}
+
+double RiskScorer::GetScore(EntityKind kind, const std::string& id, std::chrono::system_clock::time_point now) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (slots_.empty()) {
+        return 0;
+    }
+    std::string key = MakeKey(kind, id);
+    size_t slot = FindSlot(key, Hash(key));
+    return slots_[slot] ? nodes_[slots_[slot] - 1].scaled * Decay(now) : 0;
+}
+
+std::vector<RiskScorer::Entity> RiskScorer::GetTop(size_t count, std::chrono::system_clock::time_point now) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<Entity> result;
+    if (heap_.empty() || count == 0) {
+        return result;
+    }
+    // Best-first walk of the heap: only the returned nodes and their children are visited
+    double decay = Decay(now);
+    std::priority_queue<std::pair<double, uint32_t>> frontier;
+    frontier.emplace(nodes_[heap_[0]].scaled, 0);
+    while (!frontier.empty() && result.size() < count) {
+        uint32_t index = frontier.top().second;
+        frontier.pop();
+        const Node& node = nodes_[heap_[index]];
+        result.push_back(Entity{static_cast<EntityKind>(node.key[0]), node.key.substr(1), node.scaled * decay,
+                                node.events, node.lastSeen});
+        for (size_t child = 2 * static_cast<size_t>(index) + 1; child <= 2 * static_cast<size_t>(index) + 2; ++child) {
+            if (child < heap_.size()) {
+                frontier.emplace(nodes_[heap_[child]].scaled, static_cast<uint32_t>(child));
+            }
+        }
+    }
+    return result;
+}
+
+int RiskScorer::GetHostLevel(std::chrono::system_clock::time_point now) const {
+    double score = GetScore(EntityKind::Host, options_.host, now);
+    int level = 1;
+    for (double threshold : kLevelThresholds) {
+        if (score >= threshold) {
+            level++;
+        }
+    }
+    return level;
+}
+
+void RiskScorer::Clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    nodes_.clear();
+    slots_.clear();
+    heap_.clear();
+    hasBase_ = false;
+}
+
+RiskScorer::Statistics RiskScorer::GetStatistics() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Statistics stats{};
+    stats.events = events_;
+    stats.evicted = evicted_;
+    stats.entities = nodes_.size();
+    stats.memoryBytes = nodes_.capacity() * sizeof(Node) + (slots_.capacity() + heap_.capacity()) * sizeof(uint32_t);
+    for (const auto& node : nodes_) {
+        if (node.key.capacity() > std::string().capacity()) {
+            stats.memoryBytes += node.key.capacity() + 1;
+        }
+    }
+    return stats;
+}
+
+const char* RiskScorer::KindName(EntityKind kind) {
+    switch (kind) {
+        case EntityKind::Host: return "host";
+        case EntityKind::Ip: return "ip";
+        case EntityKind::Process: return "process";
+        case EntityKind::User: return "user";
+    }
+    return "unknown";
+}
+
+size_t RiskScorer::FindSlot(const std::string& key, uint32_t hash) const {
+    size_t mask = slots_.size() - 1;
+    for (size_t i = hash & mask;; i = (i + 1) & mask) {
+        if (slots_[i] == 0) {
+            return i;
+        }
+        const Node& node = nodes_[slots_[i] - 1];
+        if (node.hash == hash && node.key == key) {
+            return i;
+        }
+    }
+}
+
+void RiskScorer::Grow() {
+    slots_.assign(std::max<size_t>(16, slots_.size() * 2), 0);
+    size_t mask = slots_.size() - 1;
+    for (size_t n = 0; n < nodes_.size(); ++n) {
+        size_t i = nodes_[n].hash & mask;
+        while (slots_[i] != 0) {
+            i = (i + 1) & mask;
+        }
+        slots_[i] = static_cast<uint32_t>(n + 1);
+    }
+}
+
+void RiskScorer::Evict() {
+    // Sampling keeps eviction O(1); with shared scaling the lowest sample is also the most decayed
+    uint32_t victim = 0;
+    for (size_t s = 0; s < kEvictionSamples; ++s) {
+        sampleState_ ^= sampleState_ << 13;
+        sampleState_ ^= sampleState_ >> 7;
+        sampleState_ ^= sampleState_ << 17;
+        uint32_t candidate = static_cast<uint32_t>(sampleState_ % nodes_.size());
+        if (s == 0 || nodes_[candidate].scaled < nodes_[victim].scaled) {
+            victim = candidate;
+        }
+    }
+
+    size_t heapIndex = nodes_[victim].heapIndex;
+    SwapHeap(heapIndex, heap_.size() - 1);
+    heap_.pop_back();
+    if (heapIndex < heap_.size()) {
+        SiftDown(heapIndex);
+        SiftUp(heapIndex);
+    }
+    RemoveSlot(FindSlot(nodes_[victim].key, nodes_[victim].hash));
+
+    size_t last = nodes_.size() - 1;
+    if (victim != last) {
+        size_t slot = FindSlot(nodes_[last].key, nodes_[last].hash);
+        nodes_[victim] = std::move(nodes_[last]);
+        slots_[slot] = victim + 1;
+        heap_[nodes_[victim].heapIndex] = victim;
+    }
+    nodes_.pop_back();
+    evicted_++;
+}
+
+void RiskScorer::RemoveSlot(size_t slot) {
+    // Backward-shift deletion keeps probe sequences intact without tombstones
+    size_t mask = slots_.size() - 1;
+    size_t hole = slot;
+    slots_[hole] = 0;
+    for (size_t i = (hole + 1) & mask; slots_[i] != 0; i = (i + 1) & mask) {
+        size_t home = nodes_[slots_[i] - 1].hash & mask;
+        bool reachable = hole <= i ? (hole < home && home <= i) : (hole < home || home <= i);
+        if (!reachable) {
+            slots_[hole] = slots_[i];
+            slots_[i] = 0;
+            hole = i;
+        }
+    }
+}
+
+void RiskScorer::SiftUp(size_t index) {
+    while (index > 0) {
+        size_t parent = (index - 1) / 2;
+        if (nodes_[heap_[parent]].scaled >= nodes_[heap_[index]].scaled) {
+            break;
+        }
+        SwapHeap(parent, index);
+        index = parent;
+    }
+}
+
+void RiskScorer::SiftDown(size_t index) {
+    for (;;) {
+        size_t largest = index;
+        for (size_t child = 2 * index + 1; child <= 2 * index + 2 && child < heap_.size(); ++child) {
+            if (nodes_[heap_[child]].scaled > nodes_[heap_[largest]].scaled) {
+                largest = child;
+            }
+        }
+        if (largest == index) {
+            return;
+        }
+        SwapHeap(index, largest);
+        index = largest;
+    }
+}
+
+void RiskScorer::SwapHeap(size_t a, size_t b) {
+    std::swap(heap_[a], heap_[b]);
+    nodes_[heap_[a]].heapIndex = static_cast<uint32_t>(a);
+    nodes_[heap_[b]].heapIndex = static_cast<uint32_t>(b);
+}
+
+std::string RiskScorer::MakeKey(EntityKind kind, const std::string& id) {
+    std::string key(1, static_cast<char>(kind));
+    key += id;
+    return key;
+}
+
+uint32_t RiskScorer::Hash(const std::string& key) {
+    uint32_t hash = 2166136261u;
+    for (unsigned char c : key) {
+        hash = (hash ^ c) * 16777619u;
+    }
+    return hash;
+}
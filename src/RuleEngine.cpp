@@ -0,0 +1,1038 @@
+#include "RuleEngine.h"
+#include "Utils.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <iterator>
+#include <map>
+#include <unordered_map>
+
+namespace {
+    // Minimal JSON document model for rule files
+    struct JsonValue {
+        enum Kind { Null, Bool, Number, String, Array, Object };
+
+        Kind kind;
+        bool boolean;
+        double number;
+        std::string text;
+        std::vector<JsonValue> items;
+        std::vector<std::pair<std::string, JsonValue>> members;
+
+        JsonValue() : kind(Null), boolean(false), number(0) {}
+
+        const JsonValue* Get(const std::string& key) const {
+            for (const auto& member : members) {
+                if (member.first == key) {
+                    return &member.second;
+                }
+            }
+            return nullptr;
+        }
+    };
+
+    class JsonParser {
+    public:
+        JsonParser(const std::string& text) : pos_(text.data()), end_(text.data() + text.size()) {}
+
+        bool Parse(JsonValue& value, std::string& error) {
+            if (!ParseValue(value, 0)) {
+                error = error_;
+                return false;
+            }
+            SkipSpace();
+            if (pos_ != end_) {
+                error = "Unexpected trailing characters in JSON";
+                return false;
+            }
+            return true;
+        }
+
+    private:
+        const char* pos_;
+        const char* end_;
+        std::string error_;
+
+        void SkipSpace() {
+            while (pos_ < end_ && (*pos_ == ' ' || *pos_ == '\t' || *pos_ == '\n' || *pos_ == '\r')) {
+                ++pos_;
+            }
+        }
+
+        bool Fail(const std::string& message) {
+            error_ = message;
+            return false;
+        }
+
+        bool Literal(const char* word) {
+            size_t length = std::strlen(word);
+            if (static_cast<size_t>(end_ - pos_) < length || std::memcmp(pos_, word, length) != 0) {
+                return false;
+            }
+            pos_ += length;
+            return true;
+        }
+
+        static void AppendUtf8(std::string& out, uint32_t code) {
+            if (code < 0x80) {
+                out += static_cast<char>(code);
+            } else if (code < 0x800) {
+                out += static_cast<char>(0xC0 | (code >> 6));
+                out += static_cast<char>(0x80 | (code & 0x3F));
+            } else if (code < 0x10000) {
+                out += static_cast<char>(0xE0 | (code >> 12));
+                out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+                out += static_cast<char>(0x80 | (code & 0x3F));
+            } else {
+                out += static_cast<char>(0xF0 | (code >> 18));
+                out += static_cast<char>(0x80 | ((code >> 12) & 0x3F));
+                out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+                out += static_cast<char>(0x80 | (code & 0x3F));
+            }
+        }
+
+        bool ParseHex4(uint32_t& code) {
+            if (end_ - pos_ < 4) {
+                return false;
+            }
+            code = 0;
+            for (int i = 0; i < 4; ++i) {
+                char c = *pos_++;
+                code <<= 4;
+                if (c >= '0' && c <= '9') code |= static_cast<uint32_t>(c - '0');
+                else if (c >= 'a' && c <= 'f') code |= static_cast<uint32_t>(c - 'a' + 10);
+                else if (c >= 'A' && c <= 'F') code |= static_cast<uint32_t>(c - 'A' + 10);
+                else return false;
+            }
+            return true;
+        }
+
+        bool ParseString(std::string& out) {
+            ++pos_;   // Opening quote
+            while (pos_ < end_ && *pos_ != '"') {
+                char c = *pos_++;
+                if (c != '\\') {
+                    out += c;
+                    continue;
+                }
+                if (pos_ >= end_) {
+                    break;
+                }
+                char escape = *pos_++;
+                switch (escape) {
+                    case '"': out += '"'; break;
+                    case '\\': out += '\\'; break;
+                    case '/': out += '/'; break;
+                    case 'b': out += '\b'; break;
+                    case 'f': out += '\f'; break;
+                    case 'n': out += '\n'; break;
+                    case 'r': out += '\r'; break;
+                    case 't': out += '\t'; break;
+                    case 'u': {
+                        uint32_t code;
+                        if (!ParseHex4(code)) {
+                            return Fail("Invalid \\u escape in JSON string");
+                        }
+                        if (code >= 0xD800 && code < 0xDC00 && end_ - pos_ >= 6 && pos_[0] == '\\' && pos_[1] == 'u') {
+                            pos_ += 2;
+                            uint32_t low;
+                            if (!ParseHex4(low) || low < 0xDC00 || low > 0xDFFF) {
+                                return Fail("Invalid surrogate pair in JSON string");
+                            }
+                            code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                        }
+                        AppendUtf8(out, code);
+                        break;
+                    }
+                    default:
+                        return Fail("Invalid escape in JSON string");
+                }
+            }
+            if (pos_ >= end_) {
+                return Fail("Unterminated JSON string");
+            }
+            ++pos_;   // Closing quote
+            return true;
+        }
+
+        bool ParseValue(JsonValue& value, int depth) {
+            if (depth > 64) {
+                return Fail("JSON nested too deeply");
+            }
+            SkipSpace();
+            if (pos_ >= end_) {
+                return Fail("Unexpected end of JSON");
+            }
+
+            char c = *pos_;
+            if (c == '{') {
+                value.kind = JsonValue::Object;
+                ++pos_;
+                SkipSpace();
+                if (pos_ < end_ && *pos_ == '}') {
+                    ++pos_;
+                    return true;
+                }
+                while (true) {
+                    SkipSpace();
+                    if (pos_ >= end_ || *pos_ != '"') {
+                        return Fail("Expected object key in JSON");
+                    }
+                    std::string key;
+                    if (!ParseString(key)) {
+                        return false;
+                    }
+                    SkipSpace();
+                    if (pos_ >= end_ || *pos_ != ':') {
+                        return Fail("Expected ':' in JSON object");
+                    }
+                    ++pos_;
+                    value.members.emplace_back(std::move(key), JsonValue());
+                    if (!ParseValue(value.members.back().second, depth + 1)) {
+                        return false;
+                    }
+                    SkipSpace();
+                    if (pos_ < end_ && *pos_ == ',') {
+                        ++pos_;
+                    } else if (pos_ < end_ && *pos_ == '}') {
+                        ++pos_;
+                        return true;
+                    } else {
+                        return Fail("Expected ',' or '}' in JSON object");
+                    }
+                }
+            }
+            if (c == '[') {
+                value.kind = JsonValue::Array;
+                ++pos_;
+                SkipSpace();
+                if (pos_ < end_ && *pos_ == ']') {
+                    ++pos_;
+                    return true;
+                }
+                while (true) {
+                    value.items.emplace_back();
+                    if (!ParseValue(value.items.back(), depth + 1)) {
+                        return false;
+                    }
+                    SkipSpace();
+                    if (pos_ < end_ && *pos_ == ',') {
+                        ++pos_;
+                    } else if (pos_ < end_ && *pos_ == ']') {
+                        ++pos_;
+                        return true;
+                    } else {
+                        return Fail("Expected ',' or ']' in JSON array");
+                    }
+                }
+            }
+            if (c == '"') {
+                value.kind = JsonValue::String;
+                return ParseString(value.text);
+            }
+            if (Literal("true") || Literal("false")) {
+                value.kind = JsonValue::Bool;
+                value.boolean = pos_[-1] == 'e' && pos_[-2] == 'u';
+                return true;
+            }
+            if (Literal("null")) {
+                value.kind = JsonValue::Null;
+                return true;
+            }
+
+            char* numberEnd = nullptr;
+            std::string number(pos_, static_cast<size_t>(std::min<ptrdiff_t>(end_ - pos_, 64)));
+            value.number = std::strtod(number.c_str(), &numberEnd);
+            if (numberEnd == number.c_str()) {
+                return Fail("Unexpected character in JSON");
+            }
+            value.kind = JsonValue::Number;
+            pos_ += numberEnd - number.c_str();
+            return true;
+        }
+    };
+
+    enum class PredicateOp : uint8_t {
+        Eq, In, Contains, Prefix, Suffix, Cidr, NumEq, Gt, Ge, Lt, Le
+    };
+
+    enum InstrOp : uint8_t {
+        OpPredicate,      // result = predicate[arg]
+        OpJumpIfFalse,    // if !result goto arg
+        OpJumpIfTrue,
+        OpNot,
+        OpConst           // result = arg != 0
+    };
+
+    struct Instr {
+        uint8_t op;
+        uint32_t arg;
+    };
+
+    struct Predicate {
+        PredicateOp op;
+        uint8_t field;
+        std::string text;
+        std::vector<std::string> values;   // In
+        double number;
+        uint8_t addr[16];
+        int prefixLength;
+        bool isIPv6;
+    };
+
+    bool LookupStringField(const std::string& name, uint8_t& field) {
+        static const std::map<std::string, RuleEngine::StringField> fields = {
+            {"stream", RuleEngine::Stream}, {"type", RuleEngine::Type}, {"source", RuleEngine::Source},
+            {"destination", RuleEngine::Destination}, {"protocol", RuleEngine::Protocol},
+            {"description", RuleEngine::Description}, {"threat", RuleEngine::Description},
+            {"status", RuleEngine::Status}, {"country", RuleEngine::Country}
+        };
+        auto it = fields.find(name);
+        if (it == fields.end()) {
+            return false;
+        }
+        field = it->second;
+        return true;
+    }
+
+    bool LookupNumericField(const std::string& name, uint8_t& field) {
+        if (name == "severity") {
+            field = RuleEngine::Severity;
+        } else if (name == "asn") {
+            field = RuleEngine::Asn;
+        } else {
+            return false;
+        }
+        return true;
+    }
+
+    bool EndsWith(std::string_view value, const std::string& suffix) {
+        return value.size() >= suffix.size() && value.compare(value.size() - suffix.size(), suffix.size(), suffix) == 0;
+    }
+
+    int64_t ToNanoseconds(std::chrono::system_clock::time_point time) {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count();
+    }
+
+    int64_t FileTime(const std::string& file) {
+        std::error_code ec;
+        auto time = std::filesystem::last_write_time(file, ec);
+        return ec ? 0 : static_cast<int64_t>(time.time_since_epoch().count());
+    }
+}
+
+struct RuleEngine::WindowState {
+    std::mutex mutex;
+    uint32_t count;
+    int64_t windowNs;
+    int groupField;                       // -1: one window for the whole rule
+    size_t maxGroups;
+    std::unordered_map<std::string, std::deque<int64_t>> groups;
+};
+
+struct RuleEngine::RuleSet {
+    struct Rule {
+        std::string id;
+        std::string type;
+        std::string description;
+        int severity;                       // 0: take the event's severity
+        uint32_t codeStart;
+        std::shared_ptr<WindowState> window;
+    };
+
+    std::vector<Predicate> predicates;
+    std::vector<Instr> code;
+    std::vector<Rule> rules;
+    std::vector<uint32_t> unanchored;                   // Rules run for every event
+    std::vector<std::vector<uint32_t>> anchored;        // Per eq/in predicate: rules gated on it
+    // Per string field: value -> eq/in predicates it satisfies. Views point into predicates.
+    std::unordered_map<std::string_view, std::vector<uint32_t>> equality[StringFieldCount];
+};
+
+namespace {
+    struct CompileContext {
+        std::vector<Predicate>& predicates;
+        std::vector<Instr>& code;
+        std::map<std::string, uint32_t> dedupe;
+        std::string error;
+    };
+
+    uint32_t InternPredicate(CompileContext& context, Predicate predicate, const std::string& key) {
+        auto it = context.dedupe.find(key);
+        if (it != context.dedupe.end()) {
+            return it->second;
+        }
+        uint32_t id = static_cast<uint32_t>(context.predicates.size());
+        context.predicates.push_back(std::move(predicate));
+        context.dedupe.emplace(key, id);
+        return id;
+    }
+
+    void Emit(CompileContext& context, uint8_t op, uint32_t arg) {
+        context.code.push_back(Instr{op, arg});
+    }
+
+    bool ValueText(const JsonValue& value, std::string& text) {
+        if (value.kind == JsonValue::String) {
+            text = value.text;
+            return true;
+        }
+        if (value.kind == JsonValue::Number) {
+            char buffer[32];
+            std::snprintf(buffer, sizeof(buffer), "%.17g", value.number);
+            text = buffer;
+            return true;
+        }
+        return false;
+    }
+
+    /**
+     * Emit code leaving the node's truth value in the result register.
+     * directPredicate receives the predicate id when the node is a bare
+     * eq/in test, which makes it usable as the rule's anchor.
+     */
+    bool CompileNode(CompileContext& context, const JsonValue& node, int depth, int64_t* directPredicate) {
+        if (directPredicate) {
+            *directPredicate = -1;
+        }
+        if (node.kind != JsonValue::Object) {
+            context.error = "Match expressions must be objects";
+            return false;
+        }
+        if (depth > 32) {
+            context.error = "Match expression nested too deeply";
+            return false;
+        }
+
+        const JsonValue* all = node.Get("all");
+        const JsonValue* any = node.Get("any");
+        if (all || any) {
+            const JsonValue& list = all ? *all : *any;
+            if (list.kind != JsonValue::Array) {
+                context.error = std::string(all ? "\"all\"" : "\"any\"") + " must be an array";
+                return false;
+            }
+            if (list.items.empty()) {
+                Emit(context, OpConst, all ? 1 : 0);
+                return true;
+            }
+            std::vector<size_t> jumps;
+            for (size_t i = 0; i < list.items.size(); ++i) {
+                if (!CompileNode(context, list.items[i], depth + 1, nullptr)) {
+                    return false;
+                }
+                if (i + 1 < list.items.size()) {
+                    jumps.push_back(context.code.size());
+                    Emit(context, all ? OpJumpIfFalse : OpJumpIfTrue, 0);
+                }
+            }
+            for (size_t jump : jumps) {
+                context.code[jump].arg = static_cast<uint32_t>(context.code.size());
+            }
+            return true;
+        }
+        if (const JsonValue* negated = node.Get("not")) {
+            if (!CompileNode(context, *negated, depth + 1, nullptr)) {
+                return false;
+            }
+            Emit(context, OpNot, 0);
+            return true;
+        }
+
+        const JsonValue* fieldName = node.Get("field");
+        if (!fieldName || fieldName->kind != JsonValue::String) {
+            context.error = "Predicate needs a \"field\" (or all/any/not)";
+            return false;
+        }
+        uint8_t field = 0;
+        bool numeric = false;
+        if (!LookupStringField(fieldName->text, field)) {
+            if (!LookupNumericField(fieldName->text, field)) {
+                context.error = "Unknown field: " + fieldName->text;
+                return false;
+            }
+            numeric = true;
+        }
+
+        const std::pair<std::string, JsonValue>* operation = nullptr;
+        for (const auto& member : node.members) {
+            if (member.first != "field") {
+                if (operation) {
+                    context.error = "Predicate on " + fieldName->text + " has more than one operator";
+                    return false;
+                }
+                operation = &member;
+            }
+        }
+        if (!operation) {
+            context.error = "Predicate on " + fieldName->text + " has no operator";
+            return false;
+        }
+
+        const std::string& op = operation->first;
+        const JsonValue& operand = operation->second;
+        Predicate predicate;
+        predicate.field = field;
+        predicate.number = 0;
+        predicate.prefixLength = 0;
+        predicate.isIPv6 = false;
+        std::memset(predicate.addr, 0, sizeof(predicate.addr));
+        std::string key = std::to_string(field) + (numeric ? "#" : "$") + op + ":";
+
+        if (numeric) {
+            static const std::map<std::string, PredicateOp> numericOps = {
+                {"eq", PredicateOp::NumEq}, {"ne", PredicateOp::NumEq}, {"gt", PredicateOp::Gt},
+                {"ge", PredicateOp::Ge}, {"lt", PredicateOp::Lt}, {"le", PredicateOp::Le}
+            };
+            if (op == "in") {
+                // Numeric membership unrolls into an any() of equality tests
+                if (operand.kind != JsonValue::Array || operand.items.empty()) {
+                    context.error = "\"in\" needs a non-empty array";
+                    return false;
+                }
+                JsonValue alternatives;
+                alternatives.kind = JsonValue::Object;
+                alternatives.members.emplace_back("any", JsonValue());
+                JsonValue& list = alternatives.members.back().second;
+                list.kind = JsonValue::Array;
+                for (const auto& item : operand.items) {
+                    JsonValue test;
+                    test.kind = JsonValue::Object;
+                    test.members.emplace_back("field", *fieldName);
+                    test.members.emplace_back("eq", item);
+                    list.items.push_back(std::move(test));
+                }
+                return CompileNode(context, alternatives, depth + 1, nullptr);
+            }
+            auto it = numericOps.find(op);
+            if (it == numericOps.end() || operand.kind != JsonValue::Number) {
+                context.error = "Field " + fieldName->text + " supports eq/ne/in/gt/ge/lt/le with numbers";
+                return false;
+            }
+            predicate.op = it->second;
+            predicate.number = operand.number;
+            std::string text;
+            ValueText(operand, text);
+            key = std::to_string(field) + "#" + (op == "ne" ? "eq" : op) + ":" + text;
+            Emit(context, OpPredicate, InternPredicate(context, std::move(predicate), key));
+            if (op == "ne") {
+                Emit(context, OpNot, 0);
+            }
+            return true;
+        }
+
+        if (op == "in") {
+            if (operand.kind != JsonValue::Array || operand.items.empty()) {
+                context.error = "\"in\" needs a non-empty array";
+                return false;
+            }
+            for (const auto& item : operand.items) {
+                std::string text;
+                if (!ValueText(item, text)) {
+                    context.error = "\"in\" values must be strings";
+                    return false;
+                }
+                predicate.values.push_back(text);
+            }
+            std::sort(predicate.values.begin(), predicate.values.end());
+            predicate.values.erase(std::unique(predicate.values.begin(), predicate.values.end()), predicate.values.end());
+            predicate.op = PredicateOp::In;
+            for (const auto& value : predicate.values) {
+                key += std::to_string(value.size()) + ":" + value;
+            }
+            uint32_t id = InternPredicate(context, std::move(predicate), key);
+            Emit(context, OpPredicate, id);
+            if (directPredicate) {
+                *directPredicate = id;
+            }
+            return true;
+        }
+
+        static const std::map<std::string, PredicateOp> stringOps = {
+            {"eq", PredicateOp::Eq}, {"ne", PredicateOp::Eq}, {"contains", PredicateOp::Contains},
+            {"prefix", PredicateOp::Prefix}, {"suffix", PredicateOp::Suffix}, {"cidr", PredicateOp::Cidr}
+        };
+        auto it = stringOps.find(op);
+        if (it == stringOps.end() || !ValueText(operand, predicate.text)) {
+            context.error = "Field " + fieldName->text + " supports eq/ne/in/contains/prefix/suffix/cidr with strings";
+            return false;
+        }
+        predicate.op = it->second;
+
+        if (predicate.op == PredicateOp::Cidr) {
+            std::string address = predicate.text;
+            size_t slash = address.find('/');
+            bool isIPv6 = false;
+            if (slash != std::string::npos) {
+                predicate.prefixLength = std::atoi(address.c_str() + slash + 1);
+                address.resize(slash);
+            }
+            if (!Utils::ParseIP(address, predicate.addr, isIPv6)) {
+                context.error = "Invalid CIDR: " + predicate.text;
+                return false;
+            }
+            predicate.isIPv6 = isIPv6;
+            int fullLength = isIPv6 ? 128 : 32;
+            if (slash == std::string::npos) {
+                predicate.prefixLength = fullLength;
+            }
+            if (predicate.prefixLength < 0 || predicate.prefixLength > fullLength) {
+                context.error = "Invalid CIDR: " + predicate.text;
+                return false;
+            }
+        }
+
+        key = std::to_string(field) + "$" + (op == "ne" ? "eq" : op) + ":" + predicate.text;
+        uint32_t id = InternPredicate(context, std::move(predicate), key);
+        Emit(context, OpPredicate, id);
+        if (op == "ne") {
+            Emit(context, OpNot, 0);
+        } else if (op == "eq" && directPredicate) {
+            *directPredicate = id;
+        }
+        return true;
+    }
+
+    bool MatchCidr(const Predicate& predicate, std::string_view value) {
+        uint8_t addr[16];
+        bool isIPv6 = false;
+        if (value.empty() || !Utils::ParseIP(std::string(value), addr, isIPv6) || isIPv6 != predicate.isIPv6) {
+            return false;
+        }
+        int fullBytes = predicate.prefixLength / 8;
+        if (std::memcmp(addr, predicate.addr, static_cast<size_t>(fullBytes)) != 0) {
+            return false;
+        }
+        int bits = predicate.prefixLength % 8;
+        if (bits == 0) {
+            return true;
+        }
+        uint8_t mask = static_cast<uint8_t>(0xFF << (8 - bits));
+        return (addr[fullBytes] & mask) == (predicate.addr[fullBytes] & mask);
+    }
+
+    bool EvaluatePredicate(const Predicate& predicate, const RuleEngine::Event& event) {
+        switch (predicate.op) {
+            case PredicateOp::Eq:
+            case PredicateOp::In:
+                return false;   // Answered by the equality index; unmarked means no match
+            case PredicateOp::Contains:
+                return event.strings[predicate.field].find(predicate.text) != std::string_view::npos;
+            case PredicateOp::Prefix:
+                return event.strings[predicate.field].substr(0, predicate.text.size()) == predicate.text;
+            case PredicateOp::Suffix:
+                return EndsWith(event.strings[predicate.field], predicate.text);
+            case PredicateOp::Cidr:
+                return MatchCidr(predicate, event.strings[predicate.field]);
+            case PredicateOp::NumEq:
+                return static_cast<double>(event.numbers[predicate.field]) == predicate.number;
+            case PredicateOp::Gt:
+                return static_cast<double>(event.numbers[predicate.field]) > predicate.number;
+            case PredicateOp::Ge:
+                return static_cast<double>(event.numbers[predicate.field]) >= predicate.number;
+            case PredicateOp::Lt:
+                return static_cast<double>(event.numbers[predicate.field]) < predicate.number;
+            case PredicateOp::Le:
+                return static_cast<double>(event.numbers[predicate.field]) <= predicate.number;
+        }
+        return false;
+    }
+
+    // Per-thread memo: predicate results are valid while their stamp equals generation
+    struct Scratch {
+        std::vector<uint32_t> stamps;
+        std::vector<uint8_t> results;
+        std::vector<uint32_t> candidates;
+        uint32_t generation;
+
+        Scratch() : generation(0) {}
+    };
+}
+
+RuleEngine::RuleEngine()
+    : rulesFileTime_(0), events_(0), rulesEvaluated_(0), predicateEvaluations_(0), matches_(0), reloads_(0) {
+}
+
+RuleEngine::~RuleEngine() {
+}
+
+RuleEngine::Event RuleEngine::FromSecurityEvent(const SecurityMonitor::SecurityEvent& event) {
+    Event result;
+    result.timestamp = event.timestamp;
+    result.strings[Stream] = "security";
+    result.strings[Type] = event.type;
+    result.strings[Source] = event.source;
+    result.strings[Description] = event.description;
+    result.numbers[Severity] = event.severity;
+    return result;
+}
+
+RuleEngine::Event RuleEngine::FromNetworkLog(const NetworkMonitor::NetworkLog& log) {
+    Event result;
+    result.timestamp = log.timestamp;
+    result.strings[Stream] = "network";
+    result.strings[Source] = log.sourceIp;
+    result.strings[Destination] = log.destinationIp;
+    result.strings[Protocol] = log.protocol;
+    result.strings[Description] = log.threat;
+    result.strings[Status] = log.status;
+    result.strings[Country] = log.country;
+    result.numbers[Asn] = log.asn;
+    return result;
+}
+
+bool RuleEngine::Compile(const std::string& json, std::shared_ptr<RuleSet>& result, std::string& error) const {
+    JsonValue document;
+    if (!JsonParser(json).Parse(document, error)) {
+        return false;
+    }
+    const JsonValue* list = document.kind == JsonValue::Array ? &document : document.Get("rules");
+    if (!list || list->kind != JsonValue::Array) {
+        error = "Rule file must be an array or an object with a \"rules\" array";
+        return false;
+    }
+
+    auto set = std::make_shared<RuleSet>();
+    auto previous = std::atomic_load(&rules_);
+    CompileContext context{set->predicates, set->code, {}, ""};
+    std::vector<int64_t> anchors;
+
+    for (size_t i = 0; i < list->items.size(); ++i) {
+        const JsonValue& item = list->items[i];
+        const JsonValue* id = item.Get("id");
+        const JsonValue* match = item.Get("match");
+        std::string label = "Rule " + std::to_string(i + 1);
+        if (!id || id->kind != JsonValue::String || id->text.empty()) {
+            error = label + ": missing \"id\"";
+            return false;
+        }
+        label += " (" + id->text + ")";
+        if (!match) {
+            error = label + ": missing \"match\"";
+            return false;
+        }
+        for (const auto& rule : set->rules) {
+            if (rule.id == id->text) {
+                error = label + ": duplicate id";
+                return false;
+            }
+        }
+
+        RuleSet::Rule rule;
+        rule.id = id->text;
+        const JsonValue* type = item.Get("type");
+        const JsonValue* description = item.Get("description");
+        const JsonValue* severity = item.Get("severity");
+        rule.type = type && type->kind == JsonValue::String ? type->text : rule.id;
+        rule.description = description && description->kind == JsonValue::String ? description->text : "Rule " + rule.id;
+        rule.severity = severity && severity->kind == JsonValue::Number
+                            ? std::max(1, std::min(5, static_cast<int>(severity->number))) : 0;
+        rule.codeStart = static_cast<uint32_t>(set->code.size());
+
+        // Anchor on a bare eq/in test: the whole match, or a direct child of a top-level all()
+        int64_t anchor = -1;
+        const JsonValue* all = match->Get("all");
+        if (all && all->kind == JsonValue::Array && !match->Get("any") && !match->Get("not")) {
+            std::vector<Instr>& code = set->code;
+            std::vector<size_t> jumps;
+            for (size_t c = 0; c < all->items.size(); ++c) {
+                int64_t direct = -1;
+                if (!CompileNode(context, all->items[c], 1, &direct)) {
+                    error = label + ": " + context.error;
+                    return false;
+                }
+                // Prefer a selective field over the stream name
+                if (direct >= 0 && (anchor < 0 || set->predicates[static_cast<size_t>(anchor)].field == Stream)) {
+                    anchor = direct;
+                }
+                if (c + 1 < all->items.size()) {
+                    jumps.push_back(code.size());
+                    Emit(context, OpJumpIfFalse, 0);
+                }
+            }
+            if (all->items.empty()) {
+                Emit(context, OpConst, 1);
+            }
+            for (size_t jump : jumps) {
+                code[jump].arg = static_cast<uint32_t>(code.size());
+            }
+        } else if (!CompileNode(context, *match, 0, &anchor)) {
+            error = label + ": " + context.error;
+            return false;
+        }
+        Emit(context, OpJumpIfFalse, UINT32_MAX);   // End of program marker
+        anchors.push_back(anchor);
+
+        if (const JsonValue* threshold = item.Get("threshold")) {
+            const JsonValue* count = threshold->Get("count");
+            const JsonValue* window = threshold->Get("window_seconds");
+            const JsonValue* groupBy = threshold->Get("group_by");
+            if (!count || count->kind != JsonValue::Number || count->number < 1 ||
+                !window || window->kind != JsonValue::Number || window->number <= 0) {
+                error = label + ": threshold needs count >= 1 and window_seconds > 0";
+                return false;
+            }
+            int groupField = -1;
+            if (groupBy) {
+                uint8_t field = 0;
+                if (groupBy->kind != JsonValue::String || !LookupStringField(groupBy->text, field)) {
+                    error = label + ": threshold group_by must name a string field";
+                    return false;
+                }
+                groupField = field;
+            }
+            uint32_t countValue = static_cast<uint32_t>(count->number);
+            int64_t windowNs = static_cast<int64_t>(window->number * 1e9);
+
+            // Keep in-flight counts across reloads when the window is unchanged
+            if (previous) {
+                for (const auto& old : previous->rules) {
+                    if (old.id == rule.id && old.window && old.window->count == countValue &&
+                        old.window->windowNs == windowNs && old.window->groupField == groupField) {
+                        rule.window = old.window;
+                    }
+                }
+            }
+            if (!rule.window) {
+                rule.window = std::make_shared<WindowState>();
+                rule.window->count = countValue;
+                rule.window->windowNs = windowNs;
+                rule.window->groupField = groupField;
+                rule.window->maxGroups = static_cast<size_t>(
+                    std::max(1, Utils::Config::Instance().GetInt("rules", "max_groups_per_rule", 65536)));
+            }
+        }
+        set->rules.push_back(std::move(rule));
+    }
+
+    // Index last: the string views below must point at the final predicate storage
+    set->anchored.resize(set->predicates.size());
+    for (size_t r = 0; r < set->rules.size(); ++r) {
+        if (anchors[r] >= 0) {
+            set->anchored[static_cast<size_t>(anchors[r])].push_back(static_cast<uint32_t>(r));
+        } else {
+            set->unanchored.push_back(static_cast<uint32_t>(r));
+        }
+    }
+    for (size_t p = 0; p < set->predicates.size(); ++p) {
+        const Predicate& predicate = set->predicates[p];
+        if (predicate.op == PredicateOp::Eq) {
+            set->equality[predicate.field][predicate.text].push_back(static_cast<uint32_t>(p));
+        } else if (predicate.op == PredicateOp::In) {
+            for (const auto& value : predicate.values) {
+                set->equality[predicate.field][value].push_back(static_cast<uint32_t>(p));
+            }
+        }
+    }
+
+    result = std::move(set);
+    return true;
+}
+
+bool RuleEngine::LoadRulesFromString(const std::string& json) {
+    std::lock_guard<std::mutex> lock(loadMutex_);
+    std::shared_ptr<RuleSet> set;
+    std::string error;
+    if (!Compile(json, set, error)) {
+        lastError_ = error;
+        return false;
+    }
+    std::atomic_store(&rules_, std::shared_ptr<const RuleSet>(std::move(set)));
+    lastError_.clear();
+    reloads_++;
+    return true;
+}
+
+bool RuleEngine::LoadRules(const std::string& file) {
+    if (!Utils::FileExists(file)) {
+        std::lock_guard<std::mutex> lock(loadMutex_);
+        lastError_ = "Rule file not found: " + file;
+        return false;
+    }
+    int64_t fileTime = FileTime(file);
+    if (!LoadRulesFromString(Utils::ReadFile(file))) {
+        std::lock_guard<std::mutex> lock(loadMutex_);
+        lastError_ = file + ": " + lastError_;
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(loadMutex_);
+    rulesFile_ = file;
+    rulesFileTime_ = fileTime;
+    return true;
+}
+
+bool RuleEngine::ReloadIfChanged(std::string* error) {
+    std::string file;
+    int64_t fileTime;
+    {
+        std::lock_guard<std::mutex> lock(loadMutex_);
+        file = rulesFile_;
+        fileTime = rulesFileTime_;
+    }
+    int64_t currentTime = FileTime(file);
+    if (file.empty() || currentTime == fileTime) {
+        return false;
+    }
+    if (LoadRules(file)) {
+        return true;
+    }
+    // A broken edit is reported once and retried on the next change
+    std::lock_guard<std::mutex> lock(loadMutex_);
+    rulesFileTime_ = currentTime;
+    if (error) {
+        *error = lastError_;
+    }
+    return false;
+}
+
+void RuleEngine::Evaluate(const Event& event, std::vector<Match>& matches) {
+    auto set = std::atomic_load(&rules_);
+    events_.fetch_add(1, std::memory_order_relaxed);
+    if (!set || set->rules.empty()) {
+        return;
+    }
+
+    thread_local Scratch scratch;
+    if (scratch.stamps.size() < set->predicates.size()) {
+        scratch.stamps.resize(set->predicates.size(), 0);
+        scratch.results.resize(set->predicates.size(), 0);
+    }
+    if (++scratch.generation == 0) {
+        std::fill(scratch.stamps.begin(), scratch.stamps.end(), 0);
+        scratch.generation = 1;
+    }
+    const uint32_t generation = scratch.generation;
+
+    // One hash probe per field answers every eq/in predicate and selects the anchored rules
+    auto& candidates = scratch.candidates;
+    candidates.assign(set->unanchored.begin(), set->unanchored.end());
+    for (int field = 0; field < StringFieldCount; ++field) {
+        const auto& index = set->equality[field];
+        if (index.empty()) {
+            continue;
+        }
+        auto it = index.find(event.strings[field]);
+        if (it == index.end()) {
+            continue;
+        }
+        for (uint32_t predicate : it->second) {
+            scratch.stamps[predicate] = generation;
+            scratch.results[predicate] = 1;
+            const auto& gated = set->anchored[predicate];
+            candidates.insert(candidates.end(), gated.begin(), gated.end());
+        }
+    }
+    if (candidates.empty()) {
+        return;
+    }
+    std::sort(candidates.begin(), candidates.end());
+
+    const int64_t nowNs = ToNanoseconds(event.timestamp);
+    uint64_t evaluations = 0;
+    const Instr* code = set->code.data();
+    for (uint32_t index : candidates) {
+        const RuleSet::Rule& rule = set->rules[index];
+        bool result = false;
+        uint32_t pc = rule.codeStart;
+        while (true) {
+            const Instr& instr = code[pc];
+            if (instr.op == OpPredicate) {
+                uint32_t predicate = instr.arg;
+                if (scratch.stamps[predicate] != generation) {
+                    scratch.stamps[predicate] = generation;
+                    scratch.results[predicate] = EvaluatePredicate(set->predicates[predicate], event) ? 1 : 0;
+                    evaluations++;
+                }
+                result = scratch.results[predicate] != 0;
+                pc++;
+            } else if (instr.op == OpJumpIfFalse) {
+                if (instr.arg == UINT32_MAX) {
+                    break;
+                }
+                pc = result ? pc + 1 : instr.arg;
+            } else if (instr.op == OpJumpIfTrue) {
+                pc = result ? instr.arg : pc + 1;
+            } else if (instr.op == OpNot) {
+                result = !result;
+                pc++;
+            } else {
+                result = instr.arg != 0;
+                pc++;
+            }
+        }
+        if (!result) {
+            continue;
+        }
+
+        uint32_t count = 1;
+        if (rule.window) {
+            WindowState& window = *rule.window;
+            std::lock_guard<std::mutex> lock(window.mutex);
+            std::string group = window.groupField >= 0 ? std::string(event.strings[window.groupField]) : std::string();
+            auto it = window.groups.find(group);
+            if (it == window.groups.end()) {
+                if (window.groups.size() >= window.maxGroups) {
+                    // Drop idle groups first; if every group is live the event goes uncounted
+                    for (auto g = window.groups.begin(); g != window.groups.end();) {
+                        g = g->second.empty() || g->second.back() < nowNs - window.windowNs ? window.groups.erase(g) : std::next(g);
+                    }
+                    if (window.groups.size() >= window.maxGroups) {
+                        continue;
+                    }
+                }
+                it = window.groups.emplace(std::move(group), std::deque<int64_t>()).first;
+            }
+            auto& times = it->second;
+            times.push_back(nowNs);
+            while (!times.empty() && times.front() <= nowNs - window.windowNs) {
+                times.pop_front();
+            }
+            if (times.size() < window.count) {
+                continue;
+            }
+            // Fire once per burst; the window starts over
+            count = static_cast<uint32_t>(times.size());
+            window.groups.erase(it);
+        }
+
+        Match match;
+        match.ruleId = rule.id;
+        match.type = rule.type;
+        match.source = std::string(event.strings[Source]);
+        match.description = rule.description;
+        match.severity = rule.severity != 0 ? rule.severity
+                                            : static_cast<int>(std::max<int64_t>(1, std::min<int64_t>(5, event.numbers[Severity])));
+        match.count = count;
+        match.timestamp = event.timestamp;
+        matches.push_back(std::move(match));
+        matches_.fetch_add(1, std::memory_order_relaxed);
+    }
+    rulesEvaluated_.fetch_add(candidates.size(), std::memory_order_relaxed);
+    predicateEvaluations_.fetch_add(evaluations, std::memory_order_relaxed);
+}
+
+size_t RuleEngine::GetRuleCount() const {
+    auto set = std::atomic_load(&rules_);
+    return set ? set->rules.size() : 0;
+}
+
+RuleEngine::Statistics RuleEngine::GetStatistics() const {
+    auto set = std::atomic_load(&rules_);
+    Statistics stats{};
+    stats.events = events_.load();
+    stats.rulesEvaluated = rulesEvaluated_.load();
+    stats.predicateEvaluations = predicateEvaluations_.load();
+    stats.matches = matches_.load();
+    stats.reloads = reloads_.load();
+    stats.rules = set ? set->rules.size() : 0;
+    stats.predicates = set ? set->predicates.size() : 0;
+    return stats;
+}
+
+std::string RuleEngine::GetLastError() const {
+    std::lock_guard<std::mutex> lock(loadMutex_);
+    return lastError_;
+}
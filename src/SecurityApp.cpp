@@ -2,8 +2,12 @@
 #include "ViewManager.h"
 #include "GeminiClient.h"
 #include "SecurityMonitor.h"
+#include "NetworkMonitor.h"
+#include "ThreatProtection.h"
+#include "CorrelationEngine.h"
 #include "GoCore.h"
 #include "IntegritySystem.h"
+#include "IntegrityWatcher.h"
 #include "JsonReporting.h"
 #include "Utils.h"
 #include <iostream>
@@ -70,6 +74,15 @@ int SecurityApp::Run() {
         if (securityMonitor_) {
             securityMonitor_->StartMonitoring();
         }
+        if (networkMonitor_) {
+            networkMonitor_->StartMonitoring();
+        }
+        if (threatProtection_) {
+            threatProtection_->StartProtection();
+        }
+        if (integrityWatcher_ && !integrityWatcher_->Start()) {
+            std::cerr << "Continuous integrity monitoring unavailable: " << integrityWatcher_->GetLastError() << std::endl;
+        }
 
         // Show main interface
         if (viewManager_) {
@@ -99,6 +112,15 @@ void SecurityApp::Shutdown() {
     if (securityMonitor_) {
         securityMonitor_->StopMonitoring();
     }
+    if (networkMonitor_) {
+        networkMonitor_->StopMonitoring();
+    }
+    if (threatProtection_) {
+        threatProtection_->StopProtection();
+    }
+    if (integrityWatcher_) {
+        integrityWatcher_->Stop();
+    }
 
     // Save configuration
     auto& config = Utils::Config::Instance();
@@ -150,6 +172,31 @@ void SecurityApp::InitializeComponents() {
 
     // Initialize security monitor
     securityMonitor_ = std::make_unique<SecurityMonitor>();
+    networkMonitor_ = std::make_unique<NetworkMonitor>();
+    
+    // Initialize threat protection with the detection rule set, if present
+    threatProtection_ = std::make_unique<ThreatProtection>();
+    threatProtection_->Initialize();
+    std::string rulesFile = Utils::Config::Instance().GetString("rules", "file", "detection_rules.json");
+    if (Utils::FileExists(rulesFile) && !threatProtection_->LoadDetectionRules(rulesFile)) {
+        std::cerr << "Detection rules not loaded: " << threatProtection_->GetRuleEngine().GetLastError() << std::endl;
+    }
+    std::string indicatorsFile = Utils::Config::Instance().GetString("ioc", "file", "indicators.txt");
+    if (Utils::FileExists(indicatorsFile)) {
+        threatProtection_->LoadIndicators(indicatorsFile);
+    }
+    std::string signaturesFile = Utils::Config::Instance().GetString("scan", "rules_file", "signatures.yar");
+    if (Utils::FileExists(signaturesFile)) {
+        threatProtection_->LoadSignatures(signaturesFile);
+    }
+    
+    // Re-verify monitored files as they change instead of polling the whole baseline
+    if (config.GetBool("integrity", "continuous", true)) {
+        IntegrityWatcher::Options watchOptions;
+        watchOptions.debounce = std::chrono::milliseconds(config.GetInt("integrity", "debounce_ms", 500));
+        watchOptions.sweepInterval = std::chrono::minutes(config.GetInt("integrity", "sweep_interval_minutes", 360));
+        integrityWatcher_ = std::make_unique<IntegrityWatcher>(watchOptions);
+    }
     
     // Initialize view manager
     viewManager_ = std::make_unique<ViewManager>(this);
@@ -159,10 +206,40 @@ void SecurityApp::SetupEventHandlers() {
     // Setup security event handler
     if (securityMonitor_) {
         securityMonitor_->SetEventCallback([this](const SecurityMonitor::SecurityEvent& event) {
+            if (threatProtection_) {
+                threatProtection_->InspectEvent(RuleEngine::FromSecurityEvent(event));
+                threatProtection_->CorrelateEvent(CorrelationEngine::FromSecurityEvent(event));
+            }
+            
             // Handle security events
             if (event.severity >= 4) { // High/Critical severity
                 SetStatusMessage("ALERT: " + event.description);
             }
         });
     }
+    
+    // New sockets carry their owning pid, joining process starts to file changes
+    if (networkMonitor_) {
+        networkMonitor_->SetConnectionCallback([this](const NetworkMonitor::NetworkConnection& conn) {
+            if (threatProtection_) {
+                threatProtection_->CorrelateEvent(CorrelationEngine::FromConnection(conn));
+            }
+        });
+    }
+    
+    // Publish re-verified files; mismatches go out as soon as the debounced rehash completes
+    if (integrityWatcher_) {
+        integrityWatcher_->SetChangeCallback([this](const IntegritySystem::FileInfo& file, const std::string& change,
+                                                    int pid) {
+            CorrelationEngine::Event event =
+                CorrelationEngine::FromFileChange(file.path, file.isValid ? change : "INTEGRITY_MISMATCH", pid);
+            if (!file.isValid) {
+                event.severity = 5;
+                SetStatusMessage("ALERT: integrity mismatch (" + change + "): " + file.path);
+            }
+            if (threatProtection_) {
+                threatProtection_->CorrelateEvent(event);
+            }
+        });
+    }
 }
\ No newline at end of file
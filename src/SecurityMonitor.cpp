@@ -1,10 +1,12 @@
 #include "SecurityMonitor.h"
+#include "CorrelationEngine.h"
 #include "Utils.h"
 #include <thread>
 #include <chrono>
 #include <random>
 #include <mutex>
 #include <algorithm>
+#include <cstdlib>
 
 #ifdef _WIN32
 #include <windows.h>
@@ -14,7 +16,54 @@
 #pragma comment(lib, "iphlpapi.lib")
 #endif
 
-SecurityMonitor::SecurityMonitor() : isMonitoring_(false) {
+#ifdef __linux__
+#include <dirent.h>
+#include <pwd.h>
+#include <fstream>
+#endif
+
+namespace {
+    RiskScorer::Options RiskOptions() {
+        auto& config = Utils::Config::Instance();
+        RiskScorer::Options options;
+        options.halfLifeSeconds = std::max(1, config.GetInt("risk", "half_life_seconds", 900));
+        options.maxEntities = static_cast<size_t>(std::max(1, config.GetInt("risk", "max_entities", 65536)));
+        options.host = config.GetString("risk", "host", "");
+        return options;
+    }
+
+    // New-process events per scan; a fork storm beyond this is summarised
+    const size_t kMaxProcessEvents = 64;
+
+#ifdef __linux__
+    std::string ProcessUser(int pid) {
+        std::ifstream status("/proc/" + std::to_string(pid) + "/status");
+        std::string line;
+        while (std::getline(status, line)) {
+            if (line.compare(0, 4, "Uid:") == 0) {
+                unsigned uid = static_cast<unsigned>(std::strtoul(line.c_str() + 4, nullptr, 10));
+                passwd entry;
+                passwd* result = nullptr;
+                char buffer[1024];
+                if (getpwuid_r(uid, &entry, buffer, sizeof(buffer), &result) == 0 && result) {
+                    return result->pw_name;
+                }
+                return std::to_string(uid);
+            }
+        }
+        return "";
+    }
+#endif
+}
+
+SecurityMonitor::SecurityMonitor() : isMonitoring_(false), risk_(RiskOptions()), processesScanned_(false) {
+    // type_weights = TYPE:weight, ...
+    for (const auto& entry : Utils::Config::Instance().GetStringArray("risk", "type_weights")) {
+        size_t colon = entry.find(':');
+        if (colon != std::string::npos) {
+            risk_.SetTypeWeight(Utils::Trim(entry.substr(0, colon)), std::atof(entry.substr(colon + 1).c_str()));
+        }
+    }
 }
 
 SecurityMonitor::~SecurityMonitor() {
@@ -104,22 +153,11 @@ std::vector<SecurityMonitor::SystemMetrics> SecurityMonitor::GetMetricsHistory(i
 }
 
 int SecurityMonitor::GetThreatLevel() const {
-    // Calculate threat level based on recent events and metrics
-    auto recentEvents = GetRecentEvents(50);
-    int highSeverityCount = 0;
-    
-    for (const auto& event : recentEvents) {
-        if (event.severity >= 4) {
-            highSeverityCount++;
-        }
-    }
-    
-    // Simple threat level calculation
-    if (highSeverityCount == 0) return 1;      // Low
-    if (highSeverityCount <= 2) return 2;      // Low-Medium
-    if (highSeverityCount <= 5) return 3;      // Medium
-    if (highSeverityCount <= 10) return 4;     // High
-    return 5;                                   // Critical
+    return risk_.GetHostLevel();
+}
+
+std::vector<RiskScorer::Entity> SecurityMonitor::GetRiskiestEntities(size_t count) const {
+    return risk_.GetTop(count);
 }
 
 std::string SecurityMonitor::GetThreatSummary() const {
@@ -169,6 +207,45 @@ void SecurityMonitor::MonitoringLoop() {
 
 void SecurityMonitor::CheckProcesses() {
     CollectProcessInfo();
+
+#ifdef __linux__
+    // Report processes that appeared since the last scan; the first scan only records what runs
+    std::unordered_set<int> current;
+    if (DIR* proc = opendir("/proc")) {
+        while (dirent* entry = readdir(proc)) {
+            char* end = nullptr;
+            long pid = std::strtol(entry->d_name, &end, 10);
+            if (pid > 0 && *end == '\0') {
+                current.insert(static_cast<int>(pid));
+            }
+        }
+        closedir(proc);
+    }
+    if (processesScanned_) {
+        size_t started = 0;
+        for (int pid : current) {
+            if (knownPids_.count(pid) != 0) {
+                continue;
+            }
+            if (++started > kMaxProcessEvents) {
+                continue;
+            }
+            std::string name;
+            std::ifstream comm("/proc/" + std::to_string(pid) + "/comm");
+            std::getline(comm, name);
+            if (name.empty()) {
+                continue; // Exited already
+            }
+            AddEvent("PROCESS", "pid " + std::to_string(pid),
+                     "New process " + name + " (user " + ProcessUser(pid) + ")", 1);
+        }
+        if (started > kMaxProcessEvents) {
+            AddEvent("PROCESS", "ProcessMonitor", std::to_string(started) + " processes started since the last scan", 3);
+        }
+    }
+    knownPids_.swap(current);
+    processesScanned_ = true;
+#endif
     
     // Simulate process monitoring
     static int checkCount = 0;
@@ -255,6 +332,7 @@ void SecurityMonitor::AddEvent(const std::string& type, const std::string& sourc
             events_.erase(events_.begin(), events_.begin() + 100);
         }
     }
+    risk_.Observe(CorrelationEngine::FromSecurityEvent(event));
     
     // Notify callback
     if (eventCallback_) {
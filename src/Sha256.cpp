@@ -0,0 +1,388 @@
+#include "Sha256.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <numeric>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#include <immintrin.h>
+#include <cpuid.h>
+#define SHA256_X86_DISPATCH 1
+#endif
+
+namespace {
+    alignas(64) const uint32_t K[64] = {
+        0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+        0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+        0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+        0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+        0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+        0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+        0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+        0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+    };
+
+    const uint32_t InitialState[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+    };
+
+    inline uint32_t Rotr(uint32_t x, int n) {
+        return (x >> n) | (x << (32 - n));
+    }
+
+    inline uint32_t LoadBigEndian(const uint8_t* p) {
+        return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) |
+               (static_cast<uint32_t>(p[2]) << 8) | static_cast<uint32_t>(p[3]);
+    }
+
+    void CompressPortable(uint32_t state[8], const uint8_t* data, size_t blocks) {
+        uint32_t w[64];
+        for (; blocks > 0; --blocks, data += Sha256::BlockSize) {
+            for (int t = 0; t < 16; ++t) {
+                w[t] = LoadBigEndian(data + 4 * t);
+            }
+            for (int t = 16; t < 64; ++t) {
+                uint32_t s0 = Rotr(w[t - 15], 7) ^ Rotr(w[t - 15], 18) ^ (w[t - 15] >> 3);
+                uint32_t s1 = Rotr(w[t - 2], 17) ^ Rotr(w[t - 2], 19) ^ (w[t - 2] >> 10);
+                w[t] = w[t - 16] + s0 + w[t - 7] + s1;
+            }
+            uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+            uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+            for (int t = 0; t < 64; ++t) {
+                uint32_t t1 = h + (Rotr(e, 6) ^ Rotr(e, 11) ^ Rotr(e, 25)) + ((e & f) ^ (~e & g)) + K[t] + w[t];
+                uint32_t t2 = (Rotr(a, 2) ^ Rotr(a, 13) ^ Rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+                h = g; g = f; f = e; e = d + t1;
+                d = c; c = b; b = a; a = t1 + t2;
+            }
+            state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+            state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+        }
+    }
+
+#ifdef SHA256_X86_DISPATCH
+    // State is kept as ABEF/CDGH, the layout sha256rnds2 works on
+    __attribute__((target("sha,sse4.1")))
+    void CompressShaNi(uint32_t state[8], const uint8_t* data, size_t blocks) {
+        const __m128i byteSwap = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+        __m128i tmp = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(&state[0])), 0xB1);
+        __m128i state1 = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(&state[4])), 0x1B);
+        __m128i state0 = _mm_alignr_epi8(tmp, state1, 8);
+        state1 = _mm_blend_epi16(state1, tmp, 0xF0);
+
+        for (; blocks > 0; --blocks, data += Sha256::BlockSize) {
+            const __m128i saved0 = state0, saved1 = state1;
+            __m128i msg[4];
+            for (int i = 0; i < 4; ++i) {
+                msg[i] = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 16 * i)), byteSwap);
+            }
+            // Four rounds per group; the schedule for later groups is built in the gaps
+#pragma GCC unroll 16
+            for (int i = 0; i < 16; ++i) {
+                __m128i& current = msg[i & 3];
+                __m128i m = _mm_add_epi32(current, _mm_load_si128(reinterpret_cast<const __m128i*>(&K[4 * i])));
+                state1 = _mm_sha256rnds2_epu32(state1, state0, m);
+                if (i >= 3 && i <= 14) {
+                    __m128i& next = msg[(i + 1) & 3];
+                    next = _mm_add_epi32(next, _mm_alignr_epi8(current, msg[(i + 3) & 3], 4));
+                    next = _mm_sha256msg2_epu32(next, current);
+                }
+                state0 = _mm_sha256rnds2_epu32(state0, state1, _mm_shuffle_epi32(m, 0x0E));
+                if (i >= 1 && i <= 12) {
+                    msg[(i + 3) & 3] = _mm_sha256msg1_epu32(msg[(i + 3) & 3], current);
+                }
+            }
+            state0 = _mm_add_epi32(state0, saved0);
+            state1 = _mm_add_epi32(state1, saved1);
+        }
+
+        tmp = _mm_shuffle_epi32(state0, 0x1B);
+        state1 = _mm_shuffle_epi32(state1, 0xB1);
+        state0 = _mm_blend_epi16(tmp, state1, 0xF0);
+        state1 = _mm_alignr_epi8(state1, tmp, 8);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(&state[0]), state0);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(&state[4]), state1);
+    }
+
+    __attribute__((target("avx2")))
+    inline __m256i Rotr8(__m256i x, int n) {
+        return _mm256_or_si256(_mm256_srli_epi32(x, n), _mm256_slli_epi32(x, 32 - n));
+    }
+
+    // Eight big-endian words at offset in each block, transposed: out[i] holds word i of every lane
+    __attribute__((target("avx2")))
+    inline void LoadTransposed(const uint8_t* const blocks[8], size_t offset, __m256i out[8]) {
+        const __m256i byteSwap = _mm256_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL,
+                                                   0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+        __m256i r[8];
+        for (int lane = 0; lane < 8; ++lane) {
+            r[lane] = _mm256_shuffle_epi8(
+                _mm256_loadu_si256(reinterpret_cast<const __m256i*>(blocks[lane] + offset)), byteSwap);
+        }
+        __m256i t0 = _mm256_unpacklo_epi32(r[0], r[1]), t1 = _mm256_unpackhi_epi32(r[0], r[1]);
+        __m256i t2 = _mm256_unpacklo_epi32(r[2], r[3]), t3 = _mm256_unpackhi_epi32(r[2], r[3]);
+        __m256i t4 = _mm256_unpacklo_epi32(r[4], r[5]), t5 = _mm256_unpackhi_epi32(r[4], r[5]);
+        __m256i t6 = _mm256_unpacklo_epi32(r[6], r[7]), t7 = _mm256_unpackhi_epi32(r[6], r[7]);
+        __m256i u0 = _mm256_unpacklo_epi64(t0, t2), u1 = _mm256_unpackhi_epi64(t0, t2);
+        __m256i u2 = _mm256_unpacklo_epi64(t1, t3), u3 = _mm256_unpackhi_epi64(t1, t3);
+        __m256i u4 = _mm256_unpacklo_epi64(t4, t6), u5 = _mm256_unpackhi_epi64(t4, t6);
+        __m256i u6 = _mm256_unpacklo_epi64(t5, t7), u7 = _mm256_unpackhi_epi64(t5, t7);
+        out[0] = _mm256_permute2x128_si256(u0, u4, 0x20);
+        out[1] = _mm256_permute2x128_si256(u1, u5, 0x20);
+        out[2] = _mm256_permute2x128_si256(u2, u6, 0x20);
+        out[3] = _mm256_permute2x128_si256(u3, u7, 0x20);
+        out[4] = _mm256_permute2x128_si256(u0, u4, 0x31);
+        out[5] = _mm256_permute2x128_si256(u1, u5, 0x31);
+        out[6] = _mm256_permute2x128_si256(u2, u6, 0x31);
+        out[7] = _mm256_permute2x128_si256(u3, u7, 0x31);
+    }
+
+    // Eight independent states advance by the same number of blocks
+    __attribute__((target("avx2")))
+    void CompressAvx2x8(uint32_t states[8][8], const uint8_t* const data[8], size_t blocks) {
+        __m256i s[8];
+        for (int word = 0; word < 8; ++word) {
+            s[word] = _mm256_set_epi32(static_cast<int>(states[7][word]), static_cast<int>(states[6][word]),
+                                       static_cast<int>(states[5][word]), static_cast<int>(states[4][word]),
+                                       static_cast<int>(states[3][word]), static_cast<int>(states[2][word]),
+                                       static_cast<int>(states[1][word]), static_cast<int>(states[0][word]));
+        }
+        const uint8_t* lanes[8];
+        std::copy(data, data + 8, lanes);
+        for (size_t block = 0; block < blocks; ++block) {
+            __m256i w[16];
+            LoadTransposed(lanes, 0, w);
+            LoadTransposed(lanes, 32, w + 8);
+            __m256i a = s[0], b = s[1], c = s[2], d = s[3], e = s[4], f = s[5], g = s[6], h = s[7];
+            for (int t = 0; t < 64; ++t) {
+                if (t >= 16) {
+                    __m256i w15 = w[(t - 15) & 15], w2 = w[(t - 2) & 15];
+                    __m256i s0 = _mm256_xor_si256(_mm256_xor_si256(Rotr8(w15, 7), Rotr8(w15, 18)), _mm256_srli_epi32(w15, 3));
+                    __m256i s1 = _mm256_xor_si256(_mm256_xor_si256(Rotr8(w2, 17), Rotr8(w2, 19)), _mm256_srli_epi32(w2, 10));
+                    w[t & 15] = _mm256_add_epi32(_mm256_add_epi32(w[t & 15], s0), _mm256_add_epi32(w[(t - 7) & 15], s1));
+                }
+                __m256i s1 = _mm256_xor_si256(_mm256_xor_si256(Rotr8(e, 6), Rotr8(e, 11)), Rotr8(e, 25));
+                __m256i ch = _mm256_xor_si256(_mm256_and_si256(e, f), _mm256_andnot_si256(e, g));
+                __m256i t1 = _mm256_add_epi32(_mm256_add_epi32(h, s1),
+                                              _mm256_add_epi32(_mm256_add_epi32(ch, _mm256_set1_epi32(static_cast<int>(K[t]))), w[t & 15]));
+                __m256i s0 = _mm256_xor_si256(_mm256_xor_si256(Rotr8(a, 2), Rotr8(a, 13)), Rotr8(a, 22));
+                __m256i maj = _mm256_or_si256(_mm256_and_si256(a, b), _mm256_and_si256(c, _mm256_or_si256(a, b)));
+                __m256i t2 = _mm256_add_epi32(s0, maj);
+                h = g; g = f; f = e; e = _mm256_add_epi32(d, t1);
+                d = c; c = b; b = a; a = _mm256_add_epi32(t1, t2);
+            }
+            s[0] = _mm256_add_epi32(s[0], a); s[1] = _mm256_add_epi32(s[1], b);
+            s[2] = _mm256_add_epi32(s[2], c); s[3] = _mm256_add_epi32(s[3], d);
+            s[4] = _mm256_add_epi32(s[4], e); s[5] = _mm256_add_epi32(s[5], f);
+            s[6] = _mm256_add_epi32(s[6], g); s[7] = _mm256_add_epi32(s[7], h);
+            for (auto& lane : lanes) {
+                lane += Sha256::BlockSize;
+            }
+        }
+        alignas(32) uint32_t words[8];
+        for (int word = 0; word < 8; ++word) {
+            _mm256_store_si256(reinterpret_cast<__m256i*>(words), s[word]);
+            for (int lane = 0; lane < 8; ++lane) {
+                states[lane][word] = words[lane];
+            }
+        }
+    }
+
+    bool CpuHasShaNi() {
+        unsigned eax, ebx, ecx, edx;
+        if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) {
+            return false;
+        }
+        __builtin_cpu_init();
+        return (ebx & (1u << 29)) && __builtin_cpu_supports("sse4.1");
+    }
+#endif
+
+    using CompressFunction = void (*)(uint32_t*, const uint8_t*, size_t);
+
+    bool Supported(Sha256::Implementation implementation) {
+        switch (implementation) {
+            case Sha256::Implementation::Portable:
+                return true;
+#ifdef SHA256_X86_DISPATCH
+            case Sha256::Implementation::Avx2:
+                __builtin_cpu_init();
+                return __builtin_cpu_supports("avx2");
+            case Sha256::Implementation::ShaNi: {
+                static const bool shaNi = CpuHasShaNi();
+                return shaNi;
+            }
+#endif
+            default:
+                return false;
+        }
+    }
+
+    std::atomic<Sha256::Implementation>& Selected() {
+        static std::atomic<Sha256::Implementation> selected([] {
+            if (Supported(Sha256::Implementation::ShaNi)) {
+                return Sha256::Implementation::ShaNi;
+            }
+            if (Supported(Sha256::Implementation::Avx2)) {
+                return Sha256::Implementation::Avx2;
+            }
+            return Sha256::Implementation::Portable;
+        }());
+        return selected;
+    }
+
+    CompressFunction SelectCompress() {
+#ifdef SHA256_X86_DISPATCH
+        if (Selected().load(std::memory_order_relaxed) == Sha256::Implementation::ShaNi) {
+            return CompressShaNi;
+        }
+#endif
+        return CompressPortable;
+    }
+
+    // Pads and compresses the final bytes of a message whose first processed bytes are already in state
+    void Finish(uint32_t state[8], const uint8_t* tail, size_t size, uint64_t totalLength,
+                CompressFunction compress, uint8_t digest[Sha256::DigestSize]) {
+        size_t blocks = size / Sha256::BlockSize;
+        compress(state, tail, blocks);
+        uint8_t last[2 * Sha256::BlockSize] = {};
+        size_t remaining = size - blocks * Sha256::BlockSize;
+        std::memcpy(last, tail + blocks * Sha256::BlockSize, remaining);
+        last[remaining] = 0x80;
+        size_t padded = remaining + 9 <= Sha256::BlockSize ? Sha256::BlockSize : 2 * Sha256::BlockSize;
+        uint64_t bits = totalLength * 8;
+        for (int i = 0; i < 8; ++i) {
+            last[padded - 1 - i] = static_cast<uint8_t>(bits >> (8 * i));
+        }
+        compress(state, last, padded / Sha256::BlockSize);
+        for (int i = 0; i < 8; ++i) {
+            digest[4 * i] = static_cast<uint8_t>(state[i] >> 24);
+            digest[4 * i + 1] = static_cast<uint8_t>(state[i] >> 16);
+            digest[4 * i + 2] = static_cast<uint8_t>(state[i] >> 8);
+            digest[4 * i + 3] = static_cast<uint8_t>(state[i]);
+        }
+    }
+}
+
+Sha256::Sha256() {
+    Reset();
+}
+
+void Sha256::Reset() {
+    std::memcpy(state_, InitialState, sizeof(state_));
+    buffered_ = 0;
+    length_ = 0;
+}
+
+void Sha256::Update(const void* data, size_t size) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    CompressFunction compress = SelectCompress();
+    length_ += size;
+    if (buffered_ > 0) {
+        size_t take = std::min(size, BlockSize - buffered_);
+        std::memcpy(buffer_ + buffered_, bytes, take);
+        buffered_ += take;
+        bytes += take;
+        size -= take;
+        if (buffered_ < BlockSize) {
+            return;
+        }
+        compress(state_, buffer_, 1);
+        buffered_ = 0;
+    }
+    size_t blocks = size / BlockSize;
+    compress(state_, bytes, blocks);
+    bytes += blocks * BlockSize;
+    size -= blocks * BlockSize;
+    std::memcpy(buffer_, bytes, size);
+    buffered_ = size;
+}
+
+void Sha256::Final(uint8_t digest[DigestSize]) {
+    Finish(state_, buffer_, buffered_, length_, SelectCompress(), digest);
+    Reset();
+}
+
+std::string Sha256::HexDigest() {
+    uint8_t digest[DigestSize];
+    Final(digest);
+    return ToHex(digest);
+}
+
+std::string Sha256::Hash(const void* data, size_t size) {
+    Sha256 sha;
+    sha.Update(data, size);
+    return sha.HexDigest();
+}
+
+std::string Sha256::ToHex(const uint8_t digest[DigestSize]) {
+    static const char digits[] = "0123456789abcdef";
+    std::string hex(2 * DigestSize, '0');
+    for (size_t i = 0; i < DigestSize; ++i) {
+        hex[2 * i] = digits[digest[i] >> 4];
+        hex[2 * i + 1] = digits[digest[i] & 15];
+    }
+    return hex;
+}
+
+void Sha256::HashMany(const uint8_t* const* data, const size_t* sizes, size_t count, uint8_t (*digests)[DigestSize]) {
+    CompressFunction compress = SelectCompress();
+#ifdef SHA256_X86_DISPATCH
+    if (Selected().load(std::memory_order_relaxed) == Implementation::Avx2 && count >= 2) {
+        // Lanes run in lockstep, so messages of similar length are grouped together
+        std::vector<size_t> order(count);
+        std::iota(order.begin(), order.end(), 0);
+        std::sort(order.begin(), order.end(), [sizes](size_t a, size_t b) { return sizes[a] < sizes[b]; });
+        for (size_t group = 0; group < count; group += 8) {
+            size_t lanes = std::min<size_t>(8, count - group);
+            uint32_t states[8][8];
+            const uint8_t* pointers[8];
+            size_t shared = SIZE_MAX;
+            for (size_t lane = 0; lane < 8; ++lane) {
+                // Spare lanes repeat the first message and are discarded
+                size_t message = order[group + (lane < lanes ? lane : 0)];
+                std::memcpy(states[lane], InitialState, sizeof(InitialState));
+                pointers[lane] = data[message];
+                shared = std::min(shared, sizes[message] / BlockSize);
+            }
+            CompressAvx2x8(states, pointers, shared);
+            for (size_t lane = 0; lane < lanes; ++lane) {
+                size_t message = order[group + lane];
+                size_t done = shared * BlockSize;
+                Finish(states[lane], data[message] + done, sizes[message] - done, sizes[message], CompressPortable,
+                       digests[message]);
+            }
+        }
+        return;
+    }
+#endif
+    for (size_t message = 0; message < count; ++message) {
+        uint32_t state[8];
+        std::memcpy(state, InitialState, sizeof(state));
+        Finish(state, data[message], sizes[message], sizes[message], compress, digests[message]);
+    }
+}
+
+bool Sha256::IsSupported(Implementation implementation) {
+    return Supported(implementation);
+}
+
+Sha256::Implementation Sha256::GetImplementation() {
+    return Selected().load();
+}
+
+bool Sha256::SetImplementation(Implementation implementation) {
+    if (!Supported(implementation)) {
+        return false;
+    }
+    Selected().store(implementation);
+    return true;
+}
+
+const char* Sha256::GetImplementationName(Implementation implementation) {
+    switch (implementation) {
+        case Implementation::Portable: return "portable";
+        case Implementation::Avx2: return "avx2";
+        case Implementation::ShaNi: return "sha-ni";
+    }
+    return "unknown";
+}
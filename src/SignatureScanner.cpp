@@ -0,0 +1,1479 @@
+#include "SignatureScanner.h"
+#include "ResourceGovernor.h"
+#include "Utils.h"
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iomanip>
+#include <sstream>
+#include <thread>
+#include <unordered_map>
+
+namespace {
+    const size_t kMaxAtomLength = 16;
+    const size_t kMaxOffsetsPerString = 4096;   // #a keeps counting past this
+    const size_t kMaxJumpSteps = 1 << 16;       // Jump positions tried per atom hit before giving up
+    const size_t kJumpStepsPerByte = 64;        // ... and per scanned byte for each string variant
+    const size_t kReportedOffsets = 8;
+    const size_t kChunkSize = 1 << 20;
+
+    enum NodeKind : uint8_t {
+        NodeTrue, NodeFalse, NodeAnd, NodeOr, NodeNot,
+        NodeFound, NodeAt, NodeIn, NodeOf, NodeRule, NodeCompare,
+        NodeConst, NodeCount, NodeOffset, NodeFileSize, NodeRead
+    };
+
+    enum Comparison : uint8_t { CmpEq, CmpNe, CmpLt, CmpLe, CmpGt, CmpGe };
+
+    const int64_t kOfAll = -1;
+    const int64_t kOfNone = -2;
+
+    // NodeRead packs the integer layout into its value
+    const int64_t kReadBigEndian = 1 << 8;
+    const int64_t kReadSigned = 1 << 9;
+
+    struct Node {
+        NodeKind kind;
+        Comparison comparison;
+        uint32_t left;
+        uint32_t right;
+        int64_t value;
+        std::vector<uint32_t> items;
+
+        explicit Node(NodeKind k) : kind(k), comparison(CmpEq), left(0), right(0), value(0) {}
+    };
+
+    struct Segment {
+        std::vector<uint8_t> bytes;   // Pre-masked for hex strings
+        std::vector<uint8_t> mask;
+    };
+
+    struct Variant {
+        uint32_t string;
+        bool nocase;
+        bool wide;
+        bool fullword;
+        std::vector<Segment> segments;
+        std::vector<std::pair<uint32_t, uint32_t>> jumps;   // [min, max] gap after segments[i]
+        uint32_t atomSegment;
+        uint32_t atomOffset;
+
+        Variant() : string(0), nocase(false), wide(false), fullword(false), atomSegment(0), atomOffset(0) {}
+    };
+
+    struct StringDefinition {
+        std::string identifier;
+        uint32_t rule;
+    };
+
+    struct Rule {
+        std::string name;
+        std::vector<std::string> tags;
+        std::vector<std::pair<std::string, std::string>> meta;
+        bool isPrivate;
+        uint32_t firstString;
+        uint32_t stringCount;
+        uint32_t condition;
+
+        Rule() : isPrivate(false), firstString(0), stringCount(0), condition(0) {}
+    };
+
+    inline uint8_t FoldByte(uint8_t byte) {
+        return (byte >= 'A' && byte <= 'Z') ? static_cast<uint8_t>(byte + 32) : byte;
+    }
+
+    inline bool IsWordByte(uint8_t byte) {
+        return (byte >= '0' && byte <= '9') || (byte >= 'a' && byte <= 'z') || (byte >= 'A' && byte <= 'Z');
+    }
+
+    inline bool IsIdentifierChar(char c) {
+        return std::isalnum(static_cast<unsigned char>(c)) || c == '_';
+    }
+
+    int HexDigit(char c) {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        return -1;
+    }
+
+    std::string ExpandPath(const std::string& path) {
+        std::string result;
+        for (size_t i = 0; i < path.size(); ++i) {
+            char c = path[i];
+            if (c == '~' && i == 0 && (path.size() == 1 || path[1] == '/' || path[1] == '\\')) {
+                const char* home = std::getenv("HOME");
+                if (!home) {
+                    home = std::getenv("USERPROFILE");
+                }
+                result += home ? home : "~";
+            } else if (c == '%') {
+                size_t close = path.find('%', i + 1);
+                const char* value = close == std::string::npos ? nullptr
+                                  : std::getenv(path.substr(i + 1, close - i - 1).c_str());
+                if (value) {
+                    result += value;
+                    i = close;
+                } else {
+                    result += c;
+                }
+            } else if (c == '$' && i + 1 < path.size()) {
+                bool braced = path[i + 1] == '{';
+                size_t begin = i + (braced ? 2 : 1);
+                size_t end = begin;
+                while (end < path.size() && IsIdentifierChar(path[end])) {
+                    ++end;
+                }
+                const char* value = end > begin ? std::getenv(path.substr(begin, end - begin).c_str()) : nullptr;
+                if (value && (!braced || (end < path.size() && path[end] == '}'))) {
+                    result += value;
+                    i = braced ? end : end - 1;
+                } else {
+                    result += c;
+                }
+            } else {
+                result += c;
+            }
+        }
+        return result;
+    }
+
+    JsonReporting::Severity ParseSeverity(const std::string& value) {
+        std::string lower = Utils::ToLower(Utils::Trim(value));
+        if (lower.size() == 1 && lower[0] >= '1' && lower[0] <= '5') {
+            // Threat severities use a 1-5 scale
+            return static_cast<JsonReporting::Severity>(lower[0] - '1');
+        }
+        if (lower == "info" || lower == "low" || lower == "medium" || lower == "high" || lower == "critical") {
+            return JsonReporting::StringToSeverity(lower);
+        }
+        return JsonReporting::Severity::HIGH;
+    }
+
+    struct RuleSet {
+        std::vector<Rule> rules;
+        std::vector<StringDefinition> strings;
+        std::vector<Variant> variants;
+        std::vector<Node> nodes;
+        IocMatcher atoms;
+        std::vector<std::vector<uint32_t>> atomVariants;   // Atom pattern id -> variants
+        size_t maxAtomLength;
+        uint64_t maxReach;   // Furthest any match can start before its atom
+
+        RuleSet() : maxAtomLength(1), maxReach(0) {}
+    };
+
+    typedef std::vector<std::pair<uint64_t, uint32_t>> OffsetList;   // (offset, length)
+
+    // Recursive descent parser for the supported rule language
+    class RuleParser {
+    public:
+        RuleParser(const std::string& source, RuleSet& out)
+            : source_(source), pos_(0), failed_(false),
+              rules_(out.rules), strings_(out.strings), variants_(out.variants), nodes_(out.nodes),
+              atoms_(out.atoms), atomVariants_(out.atomVariants), maxAtomLength_(out.maxAtomLength) {}
+
+        bool Parse(std::string& error) {
+            while (!failed_ && Peek() != '\0') {
+                ParseRule();
+            }
+            if (failed_) {
+                error = error_;
+                return false;
+            }
+            return true;
+        }
+
+    private:
+        const std::string& source_;
+        size_t pos_;
+        bool failed_;
+        std::string error_;
+        std::vector<Rule>& rules_;
+        std::vector<StringDefinition>& strings_;
+        std::vector<Variant>& variants_;
+        std::vector<Node>& nodes_;
+        IocMatcher& atoms_;
+        std::vector<std::vector<uint32_t>>& atomVariants_;
+        size_t& maxAtomLength_;
+        std::unordered_map<std::string, uint32_t> ruleIds_;
+
+        bool Fail(const std::string& message) {
+            if (!failed_) {
+                size_t line = 1 + std::count(source_.begin(), source_.begin() + std::min(pos_, source_.size()), '\n');
+                error_ = "line " + std::to_string(line) + ": " + message;
+                failed_ = true;
+            }
+            return false;
+        }
+
+        void SkipSpace() {
+            while (pos_ < source_.size()) {
+                char c = source_[pos_];
+                if (c == ' ' || c == '\t' || c == '\r' || c == '\n') {
+                    ++pos_;
+                } else if (source_.compare(pos_, 2, "//") == 0) {
+                    size_t end = source_.find('\n', pos_);
+                    pos_ = end == std::string::npos ? source_.size() : end;
+                } else if (source_.compare(pos_, 2, "/*") == 0) {
+                    size_t end = source_.find("*/", pos_ + 2);
+                    pos_ = end == std::string::npos ? source_.size() : end + 2;
+                } else {
+                    break;
+                }
+            }
+        }
+
+        char Peek() {
+            SkipSpace();
+            return pos_ < source_.size() ? source_[pos_] : '\0';
+        }
+
+        bool Consume(char c) {
+            if (Peek() == c) {
+                ++pos_;
+                return true;
+            }
+            return false;
+        }
+
+        bool Consume(const char* token) {
+            SkipSpace();
+            size_t length = std::strlen(token);
+            if (source_.compare(pos_, length, token) == 0) {
+                pos_ += length;
+                return true;
+            }
+            return false;
+        }
+
+        bool Expect(char c) {
+            return Consume(c) || Fail(std::string("expected '") + c + "'");
+        }
+
+        bool ConsumeKeyword(const char* keyword) {
+            SkipSpace();
+            size_t length = std::strlen(keyword);
+            if (source_.compare(pos_, length, keyword) == 0 &&
+                (pos_ + length >= source_.size() || !IsIdentifierChar(source_[pos_ + length]))) {
+                pos_ += length;
+                return true;
+            }
+            return false;
+        }
+
+        std::string ReadWord() {
+            SkipSpace();
+            size_t begin = pos_;
+            while (pos_ < source_.size() && IsIdentifierChar(source_[pos_])) {
+                ++pos_;
+            }
+            return source_.substr(begin, pos_ - begin);
+        }
+
+        bool ReadNumber(int64_t& value) {
+            SkipSpace();
+            size_t begin = pos_;
+            bool negative = pos_ < source_.size() && source_[pos_] == '-';
+            if (negative) {
+                ++pos_;
+            }
+            int base = source_.compare(pos_, 2, "0x") == 0 ? 16 : 10;
+            if (base == 16) {
+                pos_ += 2;
+            }
+            uint64_t number = 0;
+            size_t digits = pos_;
+            while (pos_ < source_.size()) {
+                int digit = HexDigit(source_[pos_]);
+                if (digit < 0 || digit >= base) {
+                    break;
+                }
+                number = number * base + digit;
+                ++pos_;
+            }
+            if (pos_ == digits) {
+                pos_ = begin;
+                return false;
+            }
+            if (source_.compare(pos_, 2, "KB") == 0) {
+                number <<= 10;
+                pos_ += 2;
+            } else if (source_.compare(pos_, 2, "MB") == 0) {
+                number <<= 20;
+                pos_ += 2;
+            }
+            value = negative ? -static_cast<int64_t>(number) : static_cast<int64_t>(number);
+            return true;
+        }
+
+        bool ReadQuoted(std::string& text) {
+            if (!Consume('"')) {
+                return Fail("expected string literal");
+            }
+            text.clear();
+            while (pos_ < source_.size() && source_[pos_] != '"') {
+                char c = source_[pos_++];
+                if (c == '\n') {
+                    return Fail("unterminated string literal");
+                }
+                if (c != '\\') {
+                    text += c;
+                    continue;
+                }
+                if (pos_ >= source_.size()) {
+                    break;
+                }
+                char escape = source_[pos_++];
+                switch (escape) {
+                    case 'n': text += '\n'; break;
+                    case 't': text += '\t'; break;
+                    case 'r': text += '\r'; break;
+                    case '"': text += '"'; break;
+                    case '\\': text += '\\'; break;
+                    case 'x': {
+                        int high = pos_ + 1 < source_.size() ? HexDigit(source_[pos_]) : -1;
+                        int low = high >= 0 ? HexDigit(source_[pos_ + 1]) : -1;
+                        if (low < 0) {
+                            return Fail("invalid \\x escape");
+                        }
+                        text += static_cast<char>(high * 16 + low);
+                        pos_ += 2;
+                        break;
+                    }
+                    default:
+                        return Fail(std::string("unknown escape \\") + escape);
+                }
+            }
+            if (pos_ >= source_.size()) {
+                return Fail("unterminated string literal");
+            }
+            ++pos_;
+            return true;
+        }
+
+        void ParseRule() {
+            bool isPrivate = false;
+            std::string word = ReadWord();
+            if (word == "import" || word == "include") {
+                Fail("'" + word + "' is not supported; modules are not available");
+                return;
+            }
+            while (word == "private" || word == "global") {
+                if (word == "global") {
+                    Fail("global rules are not supported");
+                    return;
+                }
+                isPrivate = true;
+                word = ReadWord();
+            }
+            if (word != "rule") {
+                Fail("expected 'rule'");
+                return;
+            }
+
+            Rule rule;
+            rule.isPrivate = isPrivate;
+            rule.name = ReadWord();
+            if (rule.name.empty() || std::isdigit(static_cast<unsigned char>(rule.name[0]))) {
+                Fail("expected rule name");
+                return;
+            }
+            if (ruleIds_.count(rule.name)) {
+                Fail("duplicate rule '" + rule.name + "'");
+                return;
+            }
+            if (Consume(':')) {
+                while (IsIdentifierChar(Peek())) {
+                    rule.tags.push_back(ReadWord());
+                }
+            }
+            if (!Expect('{')) {
+                return;
+            }
+
+            rule.firstString = static_cast<uint32_t>(strings_.size());
+            bool hasCondition = false;
+            while (!failed_ && !hasCondition) {
+                std::string section = ReadWord();
+                if (section.empty() || !Expect(':')) {
+                    Fail("expected 'meta:', 'strings:' or 'condition:' in rule '" + rule.name + "'");
+                    return;
+                }
+                if (section == "meta") {
+                    ParseMeta(rule);
+                } else if (section == "strings") {
+                    ParseStrings(rule);
+                } else if (section == "condition") {
+                    rule.condition = ParseOr(rule);
+                    hasCondition = true;
+                } else {
+                    Fail("unknown section '" + section + "'");
+                }
+            }
+            if (failed_ || !Expect('}')) {
+                return;
+            }
+            rule.stringCount = static_cast<uint32_t>(strings_.size()) - rule.firstString;
+            ruleIds_[rule.name] = static_cast<uint32_t>(rules_.size());
+            rules_.push_back(std::move(rule));
+        }
+
+        void ParseMeta(Rule& rule) {
+            while (!failed_ && IsIdentifierChar(Peek())) {
+                size_t mark = pos_;
+                std::string key = ReadWord();
+                if (Peek() == ':') {
+                    pos_ = mark;   // Next section header
+                    return;
+                }
+                if (!Expect('=')) {
+                    return;
+                }
+                std::string value;
+                int64_t number = 0;
+                if (Peek() == '"') {
+                    ReadQuoted(value);
+                } else if (ConsumeKeyword("true")) {
+                    value = "true";
+                } else if (ConsumeKeyword("false")) {
+                    value = "false";
+                } else if (ReadNumber(number)) {
+                    value = std::to_string(number);
+                } else {
+                    Fail("invalid value for meta '" + key + "'");
+                    return;
+                }
+                rule.meta.emplace_back(key, value);
+            }
+        }
+
+        void ParseStrings(Rule& rule) {
+            while (!failed_ && Peek() == '$') {
+                ++pos_;
+                std::string identifier = "$" + ReadWord();
+                for (uint32_t i = rule.firstString; i < strings_.size(); ++i) {
+                    if (identifier != "$" && strings_[i].identifier == identifier) {
+                        Fail("duplicate string " + identifier + " in rule '" + rule.name + "'");
+                        return;
+                    }
+                }
+                if (!Expect('=')) {
+                    return;
+                }
+
+                uint32_t index = static_cast<uint32_t>(strings_.size());
+                strings_.push_back(StringDefinition{identifier, static_cast<uint32_t>(rules_.size())});
+                char kind = Peek();
+                if (kind == '"') {
+                    std::string text;
+                    if (ReadQuoted(text)) {
+                        ParseTextString(index, text);
+                    }
+                } else if (kind == '{') {
+                    ++pos_;
+                    ParseHexString(index);
+                } else if (kind == '/') {
+                    Fail("regular expression strings are not supported (" + identifier + ")");
+                } else {
+                    Fail("expected text or hex string for " + identifier);
+                }
+            }
+        }
+
+        void ParseTextString(uint32_t index, const std::string& text) {
+            if (text.empty()) {
+                Fail("empty string " + strings_[index].identifier);
+                return;
+            }
+            bool nocase = false, ascii = false, wide = false, fullword = false;
+            while (!failed_ && std::isalpha(static_cast<unsigned char>(Peek()))) {
+                size_t mark = pos_;
+                std::string modifier = ReadWord();
+                if (Peek() == ':' || Peek() == '=') {
+                    pos_ = mark;   // Next section header
+                    break;
+                }
+                if (modifier == "nocase") nocase = true;
+                else if (modifier == "ascii") ascii = true;
+                else if (modifier == "wide") wide = true;
+                else if (modifier == "fullword") fullword = true;
+                else {
+                    Fail("unsupported string modifier '" + modifier + "'");
+                    return;
+                }
+            }
+            if (!wide) {
+                ascii = true;
+            }
+
+            for (int form = 0; form < 2; ++form) {
+                if ((form == 0 && !ascii) || (form == 1 && !wide)) {
+                    continue;
+                }
+                Variant variant;
+                variant.string = index;
+                variant.nocase = nocase;
+                variant.wide = form == 1;
+                variant.fullword = fullword;
+                Segment segment;
+                for (char c : text) {
+                    uint8_t byte = nocase ? FoldByte(static_cast<uint8_t>(c)) : static_cast<uint8_t>(c);
+                    segment.bytes.push_back(byte);
+                    if (variant.wide) {
+                        segment.bytes.push_back(0);
+                    }
+                }
+                segment.mask.assign(segment.bytes.size(), 0xFF);
+                variant.segments.push_back(std::move(segment));
+                AddVariant(std::move(variant));
+            }
+        }
+
+        void ParseHexString(uint32_t index) {
+            const std::string& identifier = strings_[index].identifier;
+            Variant variant;
+            variant.string = index;
+            variant.segments.emplace_back();
+            bool pendingJump = false;
+            while (!failed_) {
+                char c = Peek();
+                if (c == '}') {
+                    ++pos_;
+                    break;
+                }
+                if (c == '\0') {
+                    Fail("unterminated hex string " + identifier);
+                    return;
+                }
+                if (c == '(') {
+                    Fail("alternatives in hex string " + identifier + " are not supported");
+                    return;
+                }
+                if (c == '[') {
+                    ++pos_;
+                    int64_t low = 0, high = 0;
+                    if (!ReadNumber(low)) {
+                        Fail("unbounded jump in hex string " + identifier + " is not supported");
+                        return;
+                    }
+                    high = low;
+                    if (Consume('-') && !ReadNumber(high)) {
+                        Fail("unbounded jump in hex string " + identifier + " is not supported");
+                        return;
+                    }
+                    if (!Expect(']')) {
+                        return;
+                    }
+                    if (low < 0 || high < low || variant.segments.back().bytes.empty()) {
+                        Fail("invalid jump in hex string " + identifier);
+                        return;
+                    }
+                    if (pendingJump) {
+                        variant.jumps.back().first += static_cast<uint32_t>(low);
+                        variant.jumps.back().second += static_cast<uint32_t>(high);
+                    } else {
+                        variant.jumps.emplace_back(static_cast<uint32_t>(low), static_cast<uint32_t>(high));
+                        pendingJump = true;
+                    }
+                    continue;
+                }
+                if (pos_ + 1 >= source_.size()) {
+                    Fail("truncated hex string " + identifier);
+                    return;
+                }
+                char first = source_[pos_];
+                char second = source_[pos_ + 1];
+                int high = HexDigit(first), low = HexDigit(second);
+                if ((high < 0 && first != '?') || (low < 0 && second != '?')) {
+                    Fail("invalid byte in hex string " + identifier);
+                    return;
+                }
+                pos_ += 2;
+                if (pendingJump) {
+                    variant.segments.emplace_back();
+                    pendingJump = false;
+                }
+                uint8_t mask = static_cast<uint8_t>((high >= 0 ? 0xF0 : 0) | (low >= 0 ? 0x0F : 0));
+                uint8_t value = static_cast<uint8_t>(((high >= 0 ? high : 0) << 4) | (low >= 0 ? low : 0));
+                variant.segments.back().bytes.push_back(value);
+                variant.segments.back().mask.push_back(mask);
+            }
+            if (failed_) {
+                return;
+            }
+            if (pendingJump || variant.segments.back().bytes.empty()) {
+                Fail("hex string " + identifier + " cannot end with a jump");
+                return;
+            }
+            if (std::isalpha(static_cast<unsigned char>(Peek()))) {
+                size_t mark = pos_;
+                ReadWord();
+                if (Peek() != ':' && Peek() != '=') {
+                    Fail("modifiers are not supported on hex string " + identifier);
+                    return;
+                }
+                pos_ = mark;
+            }
+            AddVariant(std::move(variant));
+        }
+
+        void AddVariant(Variant variant) {
+            // The atom is the longest run of fully specified bytes, capped in length
+            size_t bestLength = 0;
+            for (uint32_t s = 0; s < variant.segments.size(); ++s) {
+                const Segment& segment = variant.segments[s];
+                size_t run = 0;
+                for (size_t i = 0; i <= segment.mask.size(); ++i) {
+                    if (i < segment.mask.size() && segment.mask[i] == 0xFF) {
+                        ++run;
+                        continue;
+                    }
+                    if (run > bestLength) {
+                        bestLength = run;
+                        variant.atomSegment = s;
+                        variant.atomOffset = static_cast<uint32_t>(i - run);
+                    }
+                    run = 0;
+                }
+            }
+            if (bestLength == 0) {
+                Fail("string " + strings_[variant.string].identifier + " needs at least one fixed byte");
+                return;
+            }
+            bestLength = std::min(bestLength, kMaxAtomLength);
+            const Segment& segment = variant.segments[variant.atomSegment];
+            std::string_view atom(reinterpret_cast<const char*>(segment.bytes.data()) + variant.atomOffset, bestLength);
+
+            uint32_t id = atoms_.AddPattern(atom);
+            if (id >= atomVariants_.size()) {
+                atomVariants_.resize(id + 1);
+            }
+            atomVariants_[id].push_back(static_cast<uint32_t>(variants_.size()));
+            maxAtomLength_ = std::max(maxAtomLength_, bestLength);
+            variants_.push_back(std::move(variant));
+        }
+
+        // Condition grammar: or > and > not > primary; integers only in comparisons
+        uint32_t AddNode(Node node) {
+            nodes_.push_back(std::move(node));
+            return static_cast<uint32_t>(nodes_.size() - 1);
+        }
+
+        uint32_t Binary(NodeKind kind, uint32_t left, uint32_t right) {
+            Node node(kind);
+            node.left = left;
+            node.right = right;
+            return AddNode(std::move(node));
+        }
+
+        uint32_t ParseOr(const Rule& rule) {
+            uint32_t left = ParseAnd(rule);
+            while (!failed_ && ConsumeKeyword("or")) {
+                left = Binary(NodeOr, left, ParseAnd(rule));
+            }
+            return left;
+        }
+
+        uint32_t ParseAnd(const Rule& rule) {
+            uint32_t left = ParseNot(rule);
+            while (!failed_ && ConsumeKeyword("and")) {
+                left = Binary(NodeAnd, left, ParseNot(rule));
+            }
+            return left;
+        }
+
+        uint32_t ParseNot(const Rule& rule) {
+            if (ConsumeKeyword("not")) {
+                return Binary(NodeNot, ParseNot(rule), 0);
+            }
+            return ParsePrimary(rule);
+        }
+
+        bool FindString(const Rule& rule, const std::string& identifier, uint32_t& index) {
+            for (uint32_t i = rule.firstString; i < strings_.size(); ++i) {
+                if (strings_[i].identifier == identifier) {
+                    index = i;
+                    return true;
+                }
+            }
+            return Fail("undefined string " + identifier + " in rule '" + rule.name + "'");
+        }
+
+        bool ReadStringReference(const Rule& rule, uint32_t& index) {
+            std::string identifier = "$" + ReadWord();
+            return identifier.size() > 1 ? FindString(rule, identifier, index)
+                                         : Fail("anonymous strings can only be used through 'them'");
+        }
+
+        uint32_t ParsePrimary(const Rule& rule) {
+            if (failed_) {
+                return 0;
+            }
+            if (Consume('(')) {
+                uint32_t inner = ParseOr(rule);
+                Expect(')');
+                return inner;
+            }
+            if (ConsumeKeyword("true")) {
+                return AddNode(Node(NodeTrue));
+            }
+            if (ConsumeKeyword("false")) {
+                return AddNode(Node(NodeFalse));
+            }
+            if (Peek() == '$') {
+                ++pos_;
+                uint32_t index = 0;
+                if (!ReadStringReference(rule, index)) {
+                    return 0;
+                }
+                if (ConsumeKeyword("at")) {
+                    Node node(NodeAt);
+                    node.value = index;
+                    node.left = ParseInteger(rule);
+                    return AddNode(std::move(node));
+                }
+                if (ConsumeKeyword("in")) {
+                    Node node(NodeIn);
+                    node.value = index;
+                    Expect('(');
+                    node.left = ParseInteger(rule);
+                    if (!Consume("..")) {
+                        Fail("expected '..' in range");
+                    }
+                    node.right = ParseInteger(rule);
+                    Expect(')');
+                    return AddNode(std::move(node));
+                }
+                Node node(NodeFound);
+                node.value = index;
+                return AddNode(std::move(node));
+            }
+
+            size_t mark = pos_;
+            int64_t quantity = 0;
+            bool quantified = false;
+            if (ConsumeKeyword("any")) {
+                quantity = 1;
+                quantified = true;
+            } else if (ConsumeKeyword("all")) {
+                quantity = kOfAll;
+                quantified = true;
+            } else if (ConsumeKeyword("none")) {
+                quantity = kOfNone;
+                quantified = true;
+            }
+            if (quantified && !ConsumeKeyword("of")) {
+                Fail("expected 'of'");
+                return 0;
+            }
+            if (!quantified && ReadNumber(quantity)) {
+                quantified = ConsumeKeyword("of");   // Otherwise the number starts a comparison
+            }
+            if (quantified) {
+                Node node(NodeOf);
+                node.value = quantity;
+                ParseStringSet(rule, node.items);
+                return AddNode(std::move(node));
+            }
+            pos_ = mark;
+
+            if (IsIdentifierChar(Peek())) {
+                size_t wordStart = pos_;
+                std::string word = ReadWord();
+                auto it = ruleIds_.find(word);
+                if (it != ruleIds_.end()) {
+                    Node node(NodeRule);
+                    node.value = it->second;
+                    return AddNode(std::move(node));
+                }
+                pos_ = wordStart;
+            }
+
+            Node node(NodeCompare);
+            node.left = ParseInteger(rule);
+            if (Consume("==")) node.comparison = CmpEq;
+            else if (Consume("!=")) node.comparison = CmpNe;
+            else if (Consume("<=")) node.comparison = CmpLe;
+            else if (Consume(">=")) node.comparison = CmpGe;
+            else if (Consume('<')) node.comparison = CmpLt;
+            else if (Consume('>')) node.comparison = CmpGt;
+            else {
+                Fail("expected comparison operator");
+                return 0;
+            }
+            node.right = ParseInteger(rule);
+            return AddNode(std::move(node));
+        }
+
+        void ParseStringSet(const Rule& rule, std::vector<uint32_t>& items) {
+            uint32_t end = static_cast<uint32_t>(strings_.size());
+            if (ConsumeKeyword("them")) {
+                for (uint32_t i = rule.firstString; i < end; ++i) {
+                    items.push_back(i);
+                }
+            } else if (Expect('(')) {
+                do {
+                    if (!Expect('$')) {
+                        return;
+                    }
+                    std::string identifier = "$" + ReadWord();
+                    if (pos_ < source_.size() && source_[pos_] == '*') {
+                        ++pos_;
+                        for (uint32_t i = rule.firstString; i < end; ++i) {
+                            if (Utils::StartsWith(strings_[i].identifier, identifier) && strings_[i].identifier != "$") {
+                                items.push_back(i);
+                            }
+                        }
+                    } else {
+                        uint32_t index = 0;
+                        if (!FindString(rule, identifier, index)) {
+                            return;
+                        }
+                        items.push_back(index);
+                    }
+                } while (Consume(','));
+                Expect(')');
+            }
+            std::sort(items.begin(), items.end());
+            items.erase(std::unique(items.begin(), items.end()), items.end());
+            if (!failed_ && items.empty()) {
+                Fail("string set in rule '" + rule.name + "' is empty");
+            }
+        }
+
+        uint32_t ParseInteger(const Rule& rule) {
+            if (failed_) {
+                return 0;
+            }
+            int64_t value = 0;
+            if (ReadNumber(value)) {
+                Node node(NodeConst);
+                node.value = value;
+                return AddNode(std::move(node));
+            }
+            if (Consume('#')) {
+                Node node(NodeCount);
+                uint32_t index = 0;
+                ReadStringReference(rule, index);
+                node.value = index;
+                return AddNode(std::move(node));
+            }
+            if (Consume('@')) {
+                Node node(NodeOffset);
+                uint32_t index = 0;
+                ReadStringReference(rule, index);
+                node.value = index;
+                if (Consume('[')) {
+                    node.left = ParseInteger(rule);
+                    Expect(']');
+                } else {
+                    Node first(NodeConst);
+                    first.value = 1;
+                    node.left = AddNode(std::move(first));
+                }
+                return AddNode(std::move(node));
+            }
+            if (ConsumeKeyword("filesize")) {
+                return AddNode(Node(NodeFileSize));
+            }
+            std::string word = ReadWord();
+            static const char* const readers[] = {"int8", "int16", "int32", "uint8", "uint16", "uint32"};
+            for (const char* reader : readers) {
+                std::string name(reader);
+                if (word == name || (word == name + "be" && name.back() != '8')) {
+                    Node node(NodeRead);
+                    int64_t bits = std::atoll(reader + (reader[0] == 'u' ? 4 : 3));
+                    node.value = bits / 8 | (word.size() > name.size() ? kReadBigEndian : 0) |
+                                 (reader[0] == 'i' ? kReadSigned : 0);
+                    Expect('(');
+                    node.left = ParseInteger(rule);
+                    Expect(')');
+                    return AddNode(std::move(node));
+                }
+            }
+            Fail(word.empty() ? "expected expression" : "unknown identifier '" + word + "'");
+            return 0;
+        }
+    };
+
+    struct ScanContext {
+        const uint8_t* data;
+        size_t size;
+        const std::vector<uint32_t>& counts;
+        const std::vector<OffsetList>& offsets;
+        const std::vector<int8_t>& ruleResults;
+    };
+
+    bool EvaluateInteger(const RuleSet& set, uint32_t index, const ScanContext& context, int64_t& result) {
+        const Node& node = set.nodes[index];
+        switch (node.kind) {
+            case NodeConst:
+                result = node.value;
+                return true;
+            case NodeCount:
+                result = context.counts[node.value];
+                return true;
+            case NodeFileSize:
+                result = static_cast<int64_t>(context.size);
+                return true;
+            case NodeOffset: {
+                int64_t occurrence = 0;
+                const OffsetList& list = context.offsets[node.value];
+                if (!EvaluateInteger(set, node.left, context, occurrence) || occurrence < 1 ||
+                    static_cast<uint64_t>(occurrence) > list.size()) {
+                    return false;   // Undefined, as in YARA
+                }
+                result = static_cast<int64_t>(list[occurrence - 1].first);
+                return true;
+            }
+            case NodeRead: {
+                int64_t offset = 0;
+                size_t width = static_cast<size_t>(node.value & 0xFF);
+                if (!EvaluateInteger(set, node.left, context, offset) || offset < 0 ||
+                    static_cast<uint64_t>(offset) + width > context.size) {
+                    return false;
+                }
+                uint64_t value = 0;
+                for (size_t i = 0; i < width; ++i) {
+                    size_t shift = (node.value & kReadBigEndian) ? (width - 1 - i) * 8 : i * 8;
+                    value |= static_cast<uint64_t>(context.data[offset + i]) << shift;
+                }
+                if ((node.value & kReadSigned) && width < 8 && (value >> (width * 8 - 1)) & 1) {
+                    value |= ~0ULL << (width * 8);
+                }
+                result = static_cast<int64_t>(value);
+                return true;
+            }
+            default:
+                return false;
+        }
+    }
+
+    bool Evaluate(const RuleSet& set, uint32_t index, const ScanContext& context) {
+        const Node& node = set.nodes[index];
+        switch (node.kind) {
+            case NodeTrue:
+                return true;
+            case NodeFalse:
+                return false;
+            case NodeAnd:
+                return Evaluate(set, node.left, context) && Evaluate(set, node.right, context);
+            case NodeOr:
+                return Evaluate(set, node.left, context) || Evaluate(set, node.right, context);
+            case NodeNot:
+                return !Evaluate(set, node.left, context);
+            case NodeFound:
+                return context.counts[node.value] > 0;
+            case NodeRule:
+                return context.ruleResults[node.value] > 0;
+            case NodeAt:
+            case NodeIn: {
+                int64_t low = 0, high = 0;
+                if (!EvaluateInteger(set, node.left, context, low)) {
+                    return false;
+                }
+                high = low;
+                if (node.kind == NodeIn && !EvaluateInteger(set, node.right, context, high)) {
+                    return false;
+                }
+                const OffsetList& list = context.offsets[node.value];
+                auto it = std::lower_bound(list.begin(), list.end(),
+                                           std::make_pair(static_cast<uint64_t>(std::max<int64_t>(low, 0)), 0u));
+                return high >= 0 && it != list.end() && static_cast<int64_t>(it->first) <= high;
+            }
+            case NodeOf: {
+                int64_t found = 0;
+                for (uint32_t item : node.items) {
+                    found += context.counts[item] > 0;
+                }
+                if (node.value == kOfAll) {
+                    return found == static_cast<int64_t>(node.items.size());
+                }
+                if (node.value == kOfNone) {
+                    return found == 0;
+                }
+                return found >= node.value;
+            }
+            case NodeCompare: {
+                int64_t left = 0, right = 0;
+                if (!EvaluateInteger(set, node.left, context, left) ||
+                    !EvaluateInteger(set, node.right, context, right)) {
+                    return false;
+                }
+                switch (node.comparison) {
+                    case CmpEq: return left == right;
+                    case CmpNe: return left != right;
+                    case CmpLt: return left < right;
+                    case CmpLe: return left <= right;
+                    case CmpGt: return left > right;
+                    case CmpGe: return left >= right;
+                }
+                return false;
+            }
+            default:
+                return false;
+        }
+    }
+
+    inline bool MatchSegment(const Variant& variant, const Segment& segment, const uint8_t* data, size_t size,
+                             size_t start) {
+        size_t length = segment.bytes.size();
+        if (start > size || size - start < length) {
+            return false;
+        }
+        const uint8_t* text = data + start;
+        if (variant.nocase) {
+            for (size_t i = 0; i < length; ++i) {
+                if (FoldByte(text[i]) != segment.bytes[i]) {
+                    return false;
+                }
+            }
+            return true;
+        }
+        for (size_t i = 0; i < length; ++i) {
+            if ((text[i] & segment.mask[i]) != segment.bytes[i]) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Both walks charge one step per jump position tried; an exhausted budget
+    // counts as no match, so nested jumps cannot go exponential
+    bool MatchForward(const Variant& variant, size_t segment, size_t segmentEnd, const uint8_t* data, size_t size,
+                      size_t& budget, size_t& end) {
+        if (segment + 1 == variant.segments.size()) {
+            end = segmentEnd;
+            return true;
+        }
+        const Segment& next = variant.segments[segment + 1];
+        for (uint64_t gap = variant.jumps[segment].first; gap <= variant.jumps[segment].second; ++gap) {
+            if (budget == 0) {
+                return false;
+            }
+            --budget;
+            uint64_t start = segmentEnd + gap;
+            if (start + next.bytes.size() > size) {
+                break;
+            }
+            if (MatchSegment(variant, next, data, size, start) &&
+                MatchForward(variant, segment + 1, start + next.bytes.size(), data, size, budget, end)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool MatchBackward(const Variant& variant, size_t segment, size_t segmentStart, const uint8_t* data, size_t size,
+                       size_t& budget, size_t& start) {
+        if (segment == 0) {
+            start = segmentStart;
+            return true;
+        }
+        const Segment& previous = variant.segments[segment - 1];
+        for (uint64_t gap = variant.jumps[segment - 1].first; gap <= variant.jumps[segment - 1].second; ++gap) {
+            if (budget == 0) {
+                return false;
+            }
+            --budget;
+            if (segmentStart < gap + previous.bytes.size()) {
+                break;
+            }
+            size_t candidate = segmentStart - gap - previous.bytes.size();
+            if (MatchSegment(variant, previous, data, size, candidate) &&
+                MatchBackward(variant, segment - 1, candidate, data, size, budget, start)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool IsFullword(const Variant& variant, const uint8_t* data, size_t size, size_t start, size_t end) {
+        if (variant.wide) {
+            bool before = start >= 2 && data[start - 1] == 0 && IsWordByte(data[start - 2]);
+            bool after = end + 1 < size && IsWordByte(data[end]) && data[end + 1] == 0;
+            return !before && !after;
+        }
+        return !(start > 0 && IsWordByte(data[start - 1])) && !(end < size && IsWordByte(data[end]));
+    }
+
+    struct Hit {
+        uint32_t string;
+        uint32_t length;
+        uint64_t start;
+
+        bool operator<(const Hit& other) const {
+            if (string != other.string) return string < other.string;
+            if (start != other.start) return start < other.start;
+            return length < other.length;
+        }
+    };
+
+    // Per-thread match state, sized to the largest rule set this thread has scanned
+    struct Scratch {
+        std::vector<uint32_t> counts;
+        std::vector<OffsetList> offsets;
+        std::vector<std::vector<uint64_t>> starts;   // Sorted starts a later chunk could find again
+        std::vector<Hit> hits;
+        std::vector<size_t> jumpSteps;               // Budget left per variant in this buffer
+        std::vector<uint32_t> touched;
+        std::vector<int8_t> ruleResults;
+        std::vector<IocMatcher::Match> atoms;
+    };
+}
+
+struct SignatureScanner::Compiled : RuleSet {
+};
+
+SignatureScanner::SignatureScanner(const Options& options) : options_(options) {
+}
+
+SignatureScanner::~SignatureScanner() {
+}
+
+bool SignatureScanner::LoadRules(const std::string& file) {
+    if (!Utils::FileExists(file)) {
+        lastError_ = "Signature rule file not found: " + file;
+        return false;
+    }
+    if (!LoadRulesFromString(Utils::ReadFile(file))) {
+        lastError_ = file + ": " + lastError_;
+        return false;
+    }
+    return true;
+}
+
+bool SignatureScanner::LoadRulesFromString(const std::string& source) {
+    std::unique_ptr<Compiled> compiled(new Compiled);
+    RuleParser parser(source, *compiled);
+    std::string error;
+    if (!parser.Parse(error)) {
+        lastError_ = error;
+        return false;
+    }
+    compiled->atoms.Compile();
+    compiled->atomVariants.resize(compiled->atoms.GetPatternCount());
+    for (const Variant& variant : compiled->variants) {
+        uint64_t reach = variant.atomOffset;
+        for (uint32_t s = 0; s < variant.atomSegment; ++s) {
+            reach += variant.segments[s].bytes.size() + variant.jumps[s].second;
+        }
+        compiled->maxReach = std::max(compiled->maxReach, reach);
+    }
+    std::atomic_store(&compiled_, std::shared_ptr<const Compiled>(std::move(compiled)));
+    lastError_.clear();
+    return true;
+}
+
+void SignatureScanner::ScanBuffer(std::string_view data, std::vector<RuleMatch>& matches) const {
+    auto set = std::atomic_load(&compiled_);
+    if (!set) {
+        return;
+    }
+    thread_local Scratch scratch;
+    if (scratch.counts.size() < set->strings.size()) {
+        scratch.counts.resize(set->strings.size(), 0);
+        scratch.offsets.resize(set->strings.size());
+        scratch.starts.resize(set->strings.size());
+    }
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(data.data());
+    const size_t size = data.size();
+
+    // Scan in chunks that overlap by the longest atom so the hit list stays small;
+    // a hit belongs to the chunk its atom starts in
+    const size_t overlap = set->maxAtomLength - 1;
+    scratch.jumpSteps.assign(set->variants.size(), kMaxJumpSteps + size * kJumpStepsPerByte);
+    for (size_t base = 0; base < size; base += kChunkSize) {
+        size_t window = std::min(size - base, kChunkSize + overlap);
+        scratch.atoms.clear();
+        scratch.hits.clear();
+        set->atoms.Scan(data.substr(base, window), scratch.atoms);
+        for (const auto& atom : scratch.atoms) {
+            if (atom.start >= kChunkSize) {
+                continue;
+            }
+            size_t position = base + atom.start;
+            for (uint32_t variantIndex : set->atomVariants[atom.patternId]) {
+                const Variant& variant = set->variants[variantIndex];
+                if (position < variant.atomOffset) {
+                    continue;
+                }
+                size_t segmentStart = position - variant.atomOffset;
+                const Segment& segment = variant.segments[variant.atomSegment];
+                size_t start = 0, end = 0;
+                if (!MatchSegment(variant, segment, bytes, size, segmentStart)) {
+                    continue;
+                }
+                size_t& jumpSteps = scratch.jumpSteps[variantIndex];
+                size_t budget = std::min(kMaxJumpSteps, jumpSteps);
+                bool matched = MatchBackward(variant, variant.atomSegment, segmentStart, bytes, size, budget, start) &&
+                               MatchForward(variant, variant.atomSegment, segmentStart + segment.bytes.size(), bytes,
+                                            size, budget, end);
+                jumpSteps -= std::min(kMaxJumpSteps, jumpSteps) - budget;
+                if (!matched || (variant.fullword && !IsFullword(variant, bytes, size, start, end))) {
+                    continue;
+                }
+                scratch.hits.push_back(Hit{variant.string, static_cast<uint32_t>(end - start), start});
+            }
+        }
+
+        // Variants of one string, and atoms behind a jump, can find the same start
+        // more than once; each start counts once. Later chunks only look back
+        // maxReach bytes, so older starts are dropped from the seen list.
+        std::sort(scratch.hits.begin(), scratch.hits.end());
+        uint64_t floor = base + kChunkSize > set->maxReach ? base + kChunkSize - set->maxReach : 0;
+        for (size_t i = 0; i < scratch.hits.size();) {
+            uint32_t string = scratch.hits[i].string;
+            std::vector<uint64_t>& seen = scratch.starts[string];
+            OffsetList& list = scratch.offsets[string];
+            size_t known = seen.size();
+            for (; i < scratch.hits.size() && scratch.hits[i].string == string; ++i) {
+                const Hit& hit = scratch.hits[i];
+                if ((seen.size() > known && seen.back() == hit.start) ||
+                    std::binary_search(seen.begin(), seen.begin() + known, hit.start)) {
+                    continue;
+                }
+                seen.push_back(hit.start);
+                if (scratch.counts[string]++ == 0) {
+                    scratch.touched.push_back(string);
+                }
+                if (list.size() < kMaxOffsetsPerString) {
+                    list.emplace_back(hit.start, hit.length);
+                }
+            }
+            std::inplace_merge(seen.begin(), seen.begin() + known, seen.end());
+            seen.erase(seen.begin(), std::lower_bound(seen.begin(), seen.end(), floor));
+        }
+        ResourceGovernor::Instance().ChargeCpu("signature scan");
+    }
+    for (uint32_t string : scratch.touched) {
+        std::sort(scratch.offsets[string].begin(), scratch.offsets[string].end());
+    }
+
+    // Rules run in file order so conditions can refer to earlier rules
+    scratch.ruleResults.assign(set->rules.size(), 0);
+    ScanContext context{bytes, size, scratch.counts, scratch.offsets, scratch.ruleResults};
+    for (size_t r = 0; r < set->rules.size(); ++r) {
+        const Rule& rule = set->rules[r];
+        scratch.ruleResults[r] = Evaluate(*set, rule.condition, context) ? 1 : 0;
+        if (!scratch.ruleResults[r] || rule.isPrivate) {
+            continue;
+        }
+        RuleMatch match;
+        match.rule = rule.name;
+        match.tags = rule.tags;
+        match.meta = rule.meta;
+        for (uint32_t s = rule.firstString; s < rule.firstString + rule.stringCount; ++s) {
+            const OffsetList& list = scratch.offsets[s];
+            for (size_t i = 0; i < list.size() && i < kReportedOffsets; ++i) {
+                match.strings.push_back(StringMatch{set->strings[s].identifier, list[i].first, list[i].second});
+            }
+        }
+        matches.push_back(std::move(match));
+    }
+
+    for (uint32_t string : scratch.touched) {
+        scratch.counts[string] = 0;
+        scratch.offsets[string].clear();
+        scratch.starts[string].clear();
+    }
+    scratch.touched.clear();
+}
+
+SignatureScanner::FileStatus SignatureScanner::ScanFile(const std::string& path, std::vector<RuleMatch>& matches,
+                                                        uint64_t* size) const {
+    Utils::MappedFile file;
+    if (!file.Open(path)) {
+        return FileStatus::Failed;
+    }
+    if (size) {
+        *size = file.Size();
+    }
+    if (file.Size() > options_.maxFileSize) {
+        return FileStatus::TooLarge;
+    }
+    ResourceGovernor::Instance().ChargeIo(file.Size(), "signature scan");
+    ScanBuffer(std::string_view(reinterpret_cast<const char*>(file.Data()), file.Size()), matches);
+    return FileStatus::Scanned;
+}
+
+std::vector<JsonReporting::CheckResult> SignatureScanner::ScanPaths(const std::vector<std::string>& paths,
+                                                                    Statistics* statistics) const {
+    namespace fs = std::filesystem;
+    auto started = std::chrono::steady_clock::now();
+
+    // Collect regular files first; symlinks are skipped so a scan never leaves its roots
+    std::vector<std::string> files;
+    std::vector<std::string> missing;
+    for (const auto& root : paths) {
+        std::error_code ec;
+        fs::file_status status = fs::status(root, ec);
+        if (fs::is_regular_file(status)) {
+            files.push_back(root);
+            continue;
+        }
+        if (!fs::is_directory(status)) {
+            missing.push_back(root);
+            continue;
+        }
+        fs::recursive_directory_iterator it(root, fs::directory_options::skip_permission_denied, ec), end;
+        for (; !ec && it != end; it.increment(ec)) {
+            std::error_code entryError;
+            if (!it->is_symlink(entryError) && it->is_regular_file(entryError)) {
+                files.push_back(it->path().string());
+            }
+        }
+    }
+
+    std::vector<std::vector<RuleMatch>> results(files.size());
+    std::vector<double> fileTimes(files.size(), 0.0);
+    std::atomic<size_t> next(0);
+    std::atomic<uint64_t> scanned(0), skipped(0), failed(0), bytes(0);
+    bool background = ResourceGovernor::IsBackgroundThread();
+    auto worker = [&]() {
+        for (size_t i = next.fetch_add(1); i < files.size(); i = next.fetch_add(1)) {
+            auto fileStarted = std::chrono::steady_clock::now();
+            uint64_t size = 0;
+            switch (ScanFile(files[i], results[i], &size)) {
+                case FileStatus::Scanned:
+                    scanned.fetch_add(1, std::memory_order_relaxed);
+                    bytes.fetch_add(size, std::memory_order_relaxed);
+                    break;
+                case FileStatus::TooLarge:
+                    skipped.fetch_add(1, std::memory_order_relaxed);
+                    break;
+                case FileStatus::Failed:
+                    failed.fetch_add(1, std::memory_order_relaxed);
+                    break;
+            }
+            fileTimes[i] = std::chrono::duration<double, std::milli>(
+                std::chrono::steady_clock::now() - fileStarted).count();
+        }
+    };
+    unsigned threadCount = options_.threads ? options_.threads : std::max(1u, std::thread::hardware_concurrency());
+    threadCount = static_cast<unsigned>(std::max<size_t>(1, std::min<size_t>(threadCount, files.size())));
+    std::vector<std::thread> threads;
+    for (unsigned t = 1; t < threadCount; ++t) {
+        threads.emplace_back([&]() {
+            // Helpers of a governed sweep share its budget
+            if (background) {
+                ResourceGovernor::EnterBackgroundMode();
+            }
+            worker();
+        });
+    }
+    worker();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    std::vector<JsonReporting::CheckResult> checks;
+    uint64_t ruleMatches = 0;
+    for (size_t i = 0; i < files.size(); ++i) {
+        for (const auto& match : results[i]) {
+            JsonReporting::CheckResult check("SIGNATURE_" + match.rule);
+            check.status = JsonReporting::Status::FAIL;
+            check.severity = JsonReporting::Severity::HIGH;
+            check.description = "Signature '" + match.rule + "' matched " + files[i];
+            check.details["path"] = files[i];
+            check.details["rule"] = match.rule;
+            for (const auto& meta : match.meta) {
+                if (meta.first == "severity") {
+                    check.severity = ParseSeverity(meta.second);
+                } else if (meta.first == "description") {
+                    check.description = meta.second + " (" + files[i] + ")";
+                }
+                check.details["meta." + meta.first] = meta.second;
+            }
+            std::string tags, strings;
+            for (const auto& tag : match.tags) {
+                tags += (tags.empty() ? "" : " ") + tag;
+            }
+            for (const auto& string : match.strings) {
+                std::ostringstream entry;
+                entry << string.identifier << "@0x" << std::hex << string.offset;
+                strings += (strings.empty() ? "" : ", ") + entry.str();
+            }
+            if (!tags.empty()) {
+                check.details["tags"] = tags;
+            }
+            if (!strings.empty()) {
+                check.details["strings"] = strings;
+            }
+            check.remediation = "Quarantine the file and investigate how it was written";
+            check.executionTimeMs = fileTimes[i];
+            checks.push_back(std::move(check));
+            ++ruleMatches;
+        }
+    }
+
+    Statistics stats{};
+    stats.filesScanned = scanned;
+    stats.filesSkipped = skipped;
+    stats.filesFailed = failed;
+    stats.bytesScanned = bytes;
+    stats.ruleMatches = ruleMatches;
+    stats.elapsedSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    stats.megabytesPerSecond = stats.elapsedSeconds > 0
+        ? static_cast<double>(stats.bytesScanned) / (1024.0 * 1024.0) / stats.elapsedSeconds : 0.0;
+    if (statistics) {
+        *statistics = stats;
+    }
+
+    JsonReporting::CheckResult summary = JsonReporting::CreateCheckResult(
+        "SIGNATURE_SCAN",
+        ruleMatches ? JsonReporting::Status::FAIL : JsonReporting::Status::PASS,
+        ruleMatches ? JsonReporting::Severity::HIGH : JsonReporting::Severity::INFO,
+        std::to_string(stats.filesScanned) + " files scanned against " + std::to_string(GetRuleCount()) +
+        " signature rules, " + std::to_string(ruleMatches) + " matches");
+    std::ostringstream throughput;
+    throughput << std::fixed << std::setprecision(1) << stats.megabytesPerSecond;
+    summary.details["files_scanned"] = std::to_string(stats.filesScanned);
+    summary.details["files_skipped"] = std::to_string(stats.filesSkipped);
+    summary.details["files_failed"] = std::to_string(stats.filesFailed);
+    summary.details["bytes_scanned"] = std::to_string(stats.bytesScanned);
+    summary.details["max_file_size"] = std::to_string(options_.maxFileSize);
+    summary.details["threads"] = std::to_string(threadCount);
+    summary.details["throughput_mb_s"] = throughput.str();
+    if (!missing.empty()) {
+        std::string list;
+        for (const auto& path : missing) {
+            list += (list.empty() ? "" : ", ") + path;
+        }
+        summary.details["missing_paths"] = list;
+    }
+    summary.executionTimeMs = stats.elapsedSeconds * 1000.0;
+    checks.push_back(std::move(summary));
+    return checks;
+}
+
+size_t SignatureScanner::GetRuleCount() const {
+    auto set = std::atomic_load(&compiled_);
+    return set ? set->rules.size() : 0;
+}
+
+size_t SignatureScanner::GetStringCount() const {
+    auto set = std::atomic_load(&compiled_);
+    return set ? set->strings.size() : 0;
+}
+
+std::vector<std::string> SignatureScanner::GetConfiguredDirectories() {
+    std::vector<std::string> directories =
+        Utils::Config::Instance().GetStringArray("checks.directory_analysis", "scan_directories");
+    if (directories.empty()) {
+#ifdef _WIN32
+        directories = {"%TEMP%"};
+#else
+        directories = {"/tmp", "/var/tmp"};
+#endif
+    }
+    for (auto& directory : directories) {
+        directory = ExpandPath(directory);
+    }
+    return directories;
+}
@@ -1,10 +1,67 @@
 #include "ThreatProtection.h"
+#include "CorrelationEngine.h"
+#include "FirewallEnforcer.h"
+#include "IocMatcher.h"
+#include "ResourceGovernor.h"
+#include "SignatureScanner.h"
+#include "ThreatStore.h"
+#include "Utils.h"
 #include <algorithm>
-#include <random>
-#include <sstream>
+#include <filesystem>
+#include <iostream>
+#include <unordered_set>
+
+#ifdef __linux__
+#include <dirent.h>
+#endif
+
+namespace {
+    // Indicator threats remembered for refreshing; mitigated ones are pruned at the cap
+    const size_t kMaxIndicatorThreats = 65536;
+
+    int64_t FileTime(const std::string& file) {
+        std::error_code ec;
+        auto time = std::filesystem::last_write_time(file, ec);
+        return ec ? 0 : static_cast<int64_t>(time.time_since_epoch().count());
+    }
+    
+    SignatureScanner::Options ScannerOptions() {
+        auto& config = Utils::Config::Instance();
+        SignatureScanner::Options options;
+        options.maxFileSize = static_cast<uint64_t>(std::max(1, config.GetInt("scan", "max_file_size_mb", 64))) << 20;
+        options.threads = static_cast<unsigned>(std::max(0, config.GetInt("scan", "threads", 0)));
+        return options;
+    }
+    
+    CorrelationEngine::Options CorrelationOptions() {
+        auto& config = Utils::Config::Instance();
+        CorrelationEngine::Options options;
+        options.maxPartialMatches = static_cast<size_t>(
+            std::max(1, config.GetInt("correlation", "max_partial_matches", 65536)));
+        options.maxMemoryBytes = static_cast<size_t>(std::max(1, config.GetInt("correlation", "max_memory_mb", 32))) << 20;
+        return options;
+    }
+    
+    ThreatProtection::ThreatInfo SignatureThreat(const JsonReporting::CheckResult& result) {
+        ThreatProtection::ThreatInfo threat;
+        threat.type = "Malware Signature";
+        threat.source = result.details.at("path");
+        threat.description = result.description;
+        threat.severity = static_cast<int>(result.severity) + 1;
+        threat.detected = result.timestamp;
+        threat.mitigated = false;
+        return threat;
+    }
+}
 
 ThreatProtection::ThreatProtection() 
-    : protectionActive_(false), protectionLevel_(ProtectionLevel::Medium) {
+    : protectionActive_(false), protectionLevel_(ProtectionLevel::Medium),
+      threats_(new ThreatStore(static_cast<size_t>(
+          Utils::Config::Instance().GetInt("threats", "history_capacity", 10000)))),
+      nextRuleCheck_(0), indicatorsFileTime_(0),
+      signatures_(new SignatureScanner(ScannerOptions())), signaturesFileTime_(0),
+      correlation_(new CorrelationEngine(CorrelationOptions())) {
+    correlation_->AddDefaultRules();
 }
 
 ThreatProtection::~ThreatProtection() {
@@ -13,8 +70,12 @@ ThreatProtection::~ThreatProtection() {
 
 bool ThreatProtection::Initialize() {
     // Initialize threat protection system
-    activeThreats_.clear();
-    threatHistory_.clear();
+    threats_->Clear();
+    correlation_->Clear();
+    // Bring the firewall driver up now: its setup talks to the kernel and
+    // must not run on the first block, under blockedMutex_
+    FirewallEnforcer::Instance();
+    std::lock_guard<std::mutex> lock(blockedMutex_);
     blockedIPs_.clear();
     
     return true;
@@ -22,57 +83,77 @@ bool ThreatProtection::Initialize() {
 
 void ThreatProtection::Shutdown() {
     StopProtection();
-    activeThreats_.clear();
-    threatHistory_.clear();
+    threats_->Clear();
+    std::lock_guard<std::mutex> lock(blockedMutex_);
     blockedIPs_.clear();
 }
 
 bool ThreatProtection::StartProtection() {
-    if (protectionActive_) {
+    if (protectionActive_.exchange(true)) {
         return true;
     }
     
-    protectionActive_ = true;
-    // Start monitoring threads/services
+    protectionThread_ = std::thread(&ThreatProtection::ProtectionLoop, this);
     return true;
 }
 
 void ThreatProtection::StopProtection() {
     protectionActive_ = false;
-    // Stop monitoring threads/services
+    if (protectionThread_.joinable()) {
+        protectionThread_.join();
+    }
+}
+
+void ThreatProtection::ProtectionLoop() {
+    // Scans and sweeps yield to the workload and stay within the level's budget
+    if (!ResourceGovernor::EnterBackgroundMode()) {
+        std::cerr << "Could not lower protection thread priority; budgets still apply" << std::endl;
+    }
+    ResourceGovernor::Instance().SetDeferralCallback([](const ResourceGovernor::Deferral& deferral) {
+        std::cout << "Resource budget: deferred " << deferral.work << " " << deferral.count << " time(s), "
+                  << deferral.seconds << "s waiting for " << deferral.resource << " (level "
+                  << deferral.level << ")" << std::endl;
+    });
+    int interval = std::max(1, Utils::Config::Instance().GetInt("threats", "scan_interval_seconds", 30));
+    int sweepInterval = Utils::Config::Instance().GetInt("scan", "interval_seconds", 3600);
+    int elapsed = interval;
+    int sweepElapsed = sweepInterval;
+    while (protectionActive_) {
+        if (elapsed++ >= interval) {
+            ScanForThreats();
+            elapsed = 1;
+        }
+        if (sweepInterval > 0 && sweepElapsed++ >= sweepInterval) {
+            SweepSignatureDirectories();
+            sweepElapsed = 1;
+        }
+        std::this_thread::sleep_for(std::chrono::seconds(1));
+    }
 }
 
 std::vector<ThreatProtection::ThreatInfo> ThreatProtection::GetActiveThreats() const {
-    return activeThreats_;
+    return threats_->GetActive();
 }
 
 std::vector<ThreatProtection::ThreatInfo> ThreatProtection::GetThreatHistory(int limit) const {
-    std::vector<ThreatInfo> result;
-    int count = std::min(limit, static_cast<int>(threatHistory_.size()));
-    
-    for (int i = 0; i < count; ++i) {
-        result.push_back(threatHistory_[i]);
-    }
-    
-    return result;
+    return threats_->GetHistory(static_cast<size_t>(std::max(limit, 0)));
+}
+
+std::vector<ThreatProtection::ThreatInfo> ThreatProtection::GetThreatsBySource(const std::string& source) const {
+    return threats_->FindBySource(source);
+}
+
+std::vector<ThreatProtection::ThreatInfo> ThreatProtection::GetThreatsByType(const std::string& type) const {
+    return threats_->FindByType(type);
 }
 
 bool ThreatProtection::MitigateThreat(const std::string& threatId) {
-    auto it = std::find_if(activeThreats_.begin(), activeThreats_.end(),
-        [&threatId](const ThreatInfo& threat) { return threat.id == threatId; });
-    
-    if (it != activeThreats_.end()) {
-        it->mitigated = true;
-        threatHistory_.push_back(*it);
-        activeThreats_.erase(it);
-        return true;
-    }
-    
-    return false;
+    return threats_->Mitigate(threatId);
 }
 
 void ThreatProtection::SetProtectionLevel(ProtectionLevel level) {
     protectionLevel_ = level;
+    ResourceGovernor::Instance().SetLevel(static_cast<int>(level));
 }
 
 ThreatProtection::ProtectionLevel ThreatProtection::GetProtectionLevel() const {
@@ -80,15 +161,196 @@ ThreatProtection::ProtectionLevel ThreatProtection::GetProtectionLevel() const {
 }
 
 void ThreatProtection::BlockIP(const std::string& ip) {
-    blockedIPs_.insert(ip);
+    {
+        std::lock_guard<std::mutex> lock(blockedMutex_);
+        blockedIPs_.insert(ip);
+        FirewallEnforcer::Instance().Block(ip);
+    }
 }
 
 void ThreatProtection::UnblockIP(const std::string& ip) {
-    blockedIPs_.erase(ip);
+    {
+        std::lock_guard<std::mutex> lock(blockedMutex_);
+        blockedIPs_.erase(ip);
+        FirewallEnforcer::Instance().Unblock(ip);
+    }
 }
 
 std::vector<std::string> ThreatProtection::GetBlockedIPs() const {
-    return std::vector<std::string>(blockedIPs_.begin(), blockedIPs_.end());
+    std::vector<std::string> result;
+    auto& enforcer = FirewallEnforcer::Instance();
+    std::lock_guard<std::mutex> lock(blockedMutex_);
+    for (auto it = blockedIPs_.begin(); it != blockedIPs_.end();) {
+        if (enforcer.IsBlocked(*it)) {
+            result.push_back(*it++);
+        } else {
+            it = blockedIPs_.erase(it);
+        }
+    }
+    return result;
+}
+
+bool ThreatProtection::LoadDetectionRules(const std::string& file) {
+    return rules_.LoadRules(file);
+}
+
+void ThreatProtection::InspectEvent(const RuleEngine::Event& event) {
+    // Poll the rule file at most every few seconds; swaps never stall evaluation
+    int64_t now = std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+    int64_t due = nextRuleCheck_.load(std::memory_order_relaxed);
+    if (now >= due && nextRuleCheck_.compare_exchange_strong(due, now + 5)) {
+        ReloadDetectionContent();
+    }
+    
+    auto indicators = std::atomic_load(&indicators_);
+    if (indicators) {
+        std::string source(event.strings[RuleEngine::Source]);
+        ReportIndicators(*indicators, event.strings[RuleEngine::Description], source, "event", event.timestamp);
+        ReportIndicators(*indicators, event.strings[RuleEngine::Source], source, "event source", event.timestamp);
+    }
+    
+    thread_local std::vector<RuleEngine::Match> matches;
+    matches.clear();
+    rules_.Evaluate(event, matches);
+    for (const auto& match : matches) {
+        ThreatInfo threat;
+        threat.type = match.type;
+        threat.source = match.source;
+        threat.description = match.count > 1
+            ? match.description + " (" + std::to_string(match.count) + " events)" : match.description;
+        threat.severity = match.severity;
+        threat.detected = match.timestamp;
+        threat.mitigated = false;
+        ProcessThreat(threat);
+    }
+}
+
+bool ThreatProtection::LoadIndicators(const std::string& file) {
+    auto matcher = std::make_shared<IocMatcher>();
+    int64_t fileTime = FileTime(file);
+    if (!matcher->LoadPatterns(file)) {
+        std::cerr << matcher->GetLastError() << std::endl;
+        return false;
+    }
+    matcher->Compile();
+    SetIndicators(matcher);
+    
+    std::lock_guard<std::mutex> lock(indicatorsMutex_);
+    indicatorsFile_ = file;
+    indicatorsFileTime_ = fileTime;
+    return true;
+}
+
+void ThreatProtection::SetIndicators(std::shared_ptr<const IocMatcher> matcher) {
+    std::atomic_store(&indicators_, std::move(matcher));
+}
+
+void ThreatProtection::ReportIndicators(const IocMatcher& matcher, std::string_view text, const std::string& source,
+                                        const std::string& context, std::chrono::system_clock::time_point detected) {
+    thread_local std::vector<IocMatcher::Match> matches;
+    matches.clear();
+    matcher.Scan(text, matches);
+    
+    // One threat per distinct indicator, however often it repeats in the text
+    std::unordered_set<uint32_t> seen;
+    for (const auto& match : matches) {
+        if (!seen.insert(match.patternId).second) {
+            continue;
+        }
+        // An indicator that keeps showing up from one source refreshes its active threat
+        std::string key = source + "\n" + matcher.GetPattern(match.patternId);
+        std::lock_guard<std::mutex> lock(indicatorThreatsMutex_);
+        auto known = indicatorThreats_.find(key);
+        if (known != indicatorThreats_.end()) {
+            indicatorRecency_.splice(indicatorRecency_.end(), indicatorRecency_, known->second.recent);
+            if (threats_->Refresh(known->second.id, detected)) {
+                continue;
+            }
+        } else {
+            // Forget mitigated threats first, then the least recently seen active one
+            while (!indicatorRecency_.empty() &&
+                   (indicatorThreats_.size() >= kMaxIndicatorThreats ||
+                    !threats_->IsActive(indicatorThreats_.at(indicatorRecency_.front()).id))) {
+                indicatorThreats_.erase(indicatorRecency_.front());
+                indicatorRecency_.pop_front();
+            }
+            known = indicatorThreats_.emplace(key, IndicatorThreat()).first;
+            known->second.recent = indicatorRecency_.insert(indicatorRecency_.end(), key);
+        }
+        ThreatInfo threat;
+        threat.type = "IOC Match";
+        threat.source = source;
+        threat.description = "Indicator '" + matcher.GetPattern(match.patternId) + "' in " + context;
+        threat.severity = 4;
+        threat.detected = detected;
+        threat.mitigated = false;
+        threat.id = ThreatStore::GenerateId();
+        known->second.id = threat.id;
+        ProcessThreat(threat);
+    }
+}
+
+bool ThreatProtection::LoadSignatures(const std::string& file) {
+    int64_t fileTime = FileTime(file);
+    if (!signatures_->LoadRules(file)) {
+        std::cerr << signatures_->GetLastError() << std::endl;
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(signaturesMutex_);
+    signaturesFile_ = file;
+    signaturesFileTime_ = fileTime;
+    return true;
+}
+
+std::vector<JsonReporting::CheckResult> ThreatProtection::ScanFiles(const std::vector<std::string>& paths) {
+    std::vector<JsonReporting::CheckResult> results = signatures_->ScanPaths(paths);
+    for (const auto& result : results) {
+        if (result.status == JsonReporting::Status::FAIL && result.details.count("path")) {
+            ProcessThreat(SignatureThreat(result));
+        }
+    }
+    return results;
+}
+
+void ThreatProtection::SweepSignatureDirectories() {
+    std::string signaturesFile;
+    bool changed = false;
+    {
+        std::lock_guard<std::mutex> lock(signaturesMutex_);
+        signaturesFile = signaturesFile_;
+        int64_t fileTime = signaturesFile.empty() ? 0 : FileTime(signaturesFile);
+        changed = !signaturesFile.empty() && fileTime != signaturesFileTime_;
+        signaturesFileTime_ = fileTime;
+    }
+    if (changed && LoadSignatures(signaturesFile)) {
+        std::cout << "Signature rules reloaded: " << signatures_->GetRuleCount() << " rules" << std::endl;
+    }
+    if (signatures_->GetRuleCount() == 0) {
+        return;
+    }
+    
+    // Report each (rule, file) pair once while the file keeps matching
+    std::set<std::string> current;
+    for (const auto& result : signatures_->ScanPaths(SignatureScanner::GetConfiguredDirectories())) {
+        if (result.status != JsonReporting::Status::FAIL || !result.details.count("path")) {
+            continue;
+        }
+        std::string key = result.details.at("rule") + "|" + result.details.at("path");
+        if (current.insert(key).second && !reportedSignatureMatches_.count(key)) {
+            ProcessThreat(SignatureThreat(result));
+        }
+    }
+    reportedSignatureMatches_.swap(current);
+}
+
+void ThreatProtection::CorrelateEvent(const CorrelationEvent& event) {
+    thread_local std::vector<ThreatInfo> threats;
+    threats.clear();
+    correlation_->Process(event, threats);
+    for (const auto& threat : threats) {
+        ProcessThreat(threat);
+    }
 }
 
 bool ThreatProtection::IsProtectionActive() const {
@@ -96,24 +358,93 @@ bool ThreatProtection::IsProtectionActive() const {
 }
 
 int ThreatProtection::GetThreatCount() const {
-    return static_cast<int>(activeThreats_.size());
+    return static_cast<int>(threats_->ActiveCount());
 }
 
 void ThreatProtection::ScanForThreats() {
-    // Placeholder threat scanning implementation
+    ReloadDetectionContent();
+    
+    auto indicators = std::atomic_load(&indicators_);
+    if (indicators) {
+        ScanProcessCommandLines(*indicators);
+    }
 }
 
-void ThreatProtection::ProcessThreat(const ThreatInfo& threat) {
-    // Process detected threat
-    activeThreats_.push_back(threat);
+void ThreatProtection::ScanProcessCommandLines(const IocMatcher& matcher) {
+#ifdef __linux__
+    DIR* proc = opendir("/proc");
+    if (!proc) {
+        return;
+    }
+    
+    // Report each (process, indicator) pair once while the process lives
+    std::set<std::pair<int, uint32_t>> current;
+    std::vector<IocMatcher::Match> matches;
+    auto now = std::chrono::system_clock::now();
+    while (dirent* entry = readdir(proc)) {
+        char* end = nullptr;
+        long pid = std::strtol(entry->d_name, &end, 10);
+        if (*end != '\0' || pid <= 0) {
+            continue;
+        }
+        std::string base = std::string("/proc/") + entry->d_name;
+        std::string commandLine = Utils::ReadFile(base + "/cmdline");
+        if (commandLine.empty()) {
+            continue;   // Kernel threads and processes that already exited
+        }
+        std::replace(commandLine.begin(), commandLine.end(), '\0', ' ');
+        
+        matches.clear();
+        matcher.Scan(commandLine, matches);
+        ResourceGovernor::Instance().ChargeCpu("process scan");
+        for (const auto& match : matches) {
+            auto key = std::make_pair(static_cast<int>(pid), match.patternId);
+            if (!current.insert(key).second || reportedProcessIndicators_.count(key)) {
+                continue;
+            }
+            ThreatInfo threat;
+            threat.type = "IOC Match";
+            threat.source = "pid " + std::to_string(pid) + " (" + Utils::Trim(Utils::ReadFile(base + "/comm")) + ")";
+            threat.description = "Indicator '" + matcher.GetPattern(match.patternId) + "' in command line: " +
+                                 Utils::Trim(commandLine).substr(0, 256);
+            threat.severity = 4;
+            threat.detected = now;
+            threat.mitigated = false;
+            ProcessThreat(threat);
+        }
+    }
+    closedir(proc);
+    reportedProcessIndicators_.swap(current);
+#else
+    (void)matcher;
+#endif
 }
 
-std::string ThreatProtection::GenerateThreatId() {
-    static std::random_device rd;
-    static std::mt19937 gen(rd());
-    static std::uniform_int_distribution<> dis(100000, 999999);
+void ThreatProtection::ReloadDetectionContent() {
+    std::string indicatorsFile;
+    bool indicatorsChanged = false;
+    {
+        // Record the new time up front so a broken file is reported once
+        std::lock_guard<std::mutex> lock(indicatorsMutex_);
+        indicatorsFile = indicatorsFile_;
+        int64_t fileTime = indicatorsFile.empty() ? 0 : FileTime(indicatorsFile);
+        indicatorsChanged = !indicatorsFile.empty() && fileTime != indicatorsFileTime_;
+        indicatorsFileTime_ = fileTime;
+    }
+    if (indicatorsChanged && LoadIndicators(indicatorsFile)) {
+        std::cout << "Indicators reloaded: " << std::atomic_load(&indicators_)->GetPatternCount() << " patterns" << std::endl;
+    }
     
-    std::stringstream ss;
-    ss << "THREAT_" << dis(gen);
-    return ss.str();
-}
\ No newline at end of file
+    std::string error;
+    if (rules_.ReloadIfChanged(&error)) {
+        std::cout << "Detection rules reloaded: " << rules_.GetRuleCount() << " rules" << std::endl;
+    } else if (!error.empty()) {
+        // The previous rule set stays active until the file is fixed
+        std::cerr << "Detection rules not reloaded: " << error << std::endl;
+    }
+}
+
+void ThreatProtection::ProcessThreat(const ThreatInfo& threat) {
+    // Process detected threat; detectors may leave the id for the store to assign
+    threats_->Add(threat);
+}
@@ -0,0 +1,213 @@
+#include "ThreatStore.h"
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <cstdio>
+
+namespace {
+    std::atomic<uint64_t> lastThreatId(0);
+
+    bool OlderFirst(const ThreatStore::ThreatInfo& a, const ThreatStore::ThreatInfo& b) {
+        return a.detected < b.detected || (a.detected == b.detected && a.id < b.id);
+    }
+}
+
+ThreatStore::ThreatStore(size_t historyCapacity)
+    : historyCapacity_(std::max<size_t>(historyCapacity, 1)), historyNext_(0), historyCount_(0) {
+}
+
+std::string ThreatStore::GenerateId() {
+    uint64_t nowMs = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count());
+    uint64_t candidate = nowMs << 20;
+
+    // Take max(clock, previous + 1) so ids stay unique when the clock stalls or steps back
+    uint64_t previous = lastThreatId.load(std::memory_order_relaxed);
+    uint64_t next;
+    do {
+        next = std::max(candidate, previous + 1);
+    } while (!lastThreatId.compare_exchange_weak(previous, next, std::memory_order_relaxed));
+
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "THREAT_%016llx", static_cast<unsigned long long>(next));
+    return buffer;
+}
+
+uint32_t ThreatStore::Append(Index& index, const std::string& key, uint32_t slot) {
+    auto& entries = index[key];
+    entries.push_back(slot);
+    return static_cast<uint32_t>(entries.size() - 1);
+}
+
+void ThreatStore::Remove(Index& index, const std::string& key, uint32_t position, bool isSource) {
+    auto it = index.find(key);
+    if (it == index.end()) {
+        return;
+    }
+    auto& entries = it->second;
+    uint32_t moved = entries.back();
+    entries[position] = moved;
+    entries.pop_back();
+    if (position < entries.size()) {
+        (isSource ? slots_[moved].sourcePosition : slots_[moved].typePosition) = position;
+    }
+    if (entries.empty()) {
+        index.erase(it);
+    }
+}
+
+std::string ThreatStore::Add(ThreatInfo threat) {
+    if (threat.id.empty()) {
+        threat.id = GenerateId();
+    }
+
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    if (byId_.count(threat.id) != 0) {
+        return "";
+    }
+
+    uint32_t index;
+    if (!freeSlots_.empty()) {
+        index = freeSlots_.back();
+        freeSlots_.pop_back();
+    } else {
+        index = static_cast<uint32_t>(slots_.size());
+        slots_.emplace_back();
+    }
+
+    Slot& slot = slots_[index];
+    slot.threat = std::move(threat);
+    slot.threat.lastSeen = std::max(slot.threat.lastSeen, slot.threat.detected);
+    slot.used = true;
+    slot.sourcePosition = Append(bySource_, slot.threat.source, index);
+    slot.typePosition = Append(byType_, slot.threat.type, index);
+    byId_.emplace(slot.threat.id, index);
+    return slot.threat.id;
+}
+
+bool ThreatStore::Mitigate(const std::string& id) {
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    auto it = byId_.find(id);
+    if (it == byId_.end()) {
+        return false;
+    }
+
+    uint32_t index = it->second;
+    byId_.erase(it);
+    Slot& slot = slots_[index];
+    Remove(bySource_, slot.threat.source, slot.sourcePosition, true);
+    Remove(byType_, slot.threat.type, slot.typePosition, false);
+
+    slot.threat.mitigated = true;
+    if (history_.size() < historyCapacity_) {
+        history_.push_back(std::move(slot.threat));
+    } else {
+        history_[historyNext_] = std::move(slot.threat);
+    }
+    historyNext_ = (historyNext_ + 1) % historyCapacity_;
+    historyCount_ = std::min(historyCount_ + 1, historyCapacity_);
+
+    slot.threat = ThreatInfo();
+    slot.used = false;
+    freeSlots_.push_back(index);
+    return true;
+}
+
+bool ThreatStore::Refresh(const std::string& id, std::chrono::system_clock::time_point seen) {
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    auto it = byId_.find(id);
+    if (it == byId_.end()) {
+        return false;
+    }
+    ThreatInfo& threat = slots_[it->second].threat;
+    threat.lastSeen = std::max(threat.lastSeen, seen);
+    threat.occurrences++;
+    return true;
+}
+
+bool ThreatStore::Get(const std::string& id, ThreatInfo& threat) const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    auto it = byId_.find(id);
+    if (it == byId_.end()) {
+        return false;
+    }
+    threat = slots_[it->second].threat;
+    return true;
+}
+
+bool ThreatStore::IsActive(const std::string& id) const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    return byId_.count(id) != 0;
+}
+
+std::vector<ThreatStore::ThreatInfo> ThreatStore::GetActive() const {
+    std::vector<ThreatInfo> result;
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex_);
+        result.reserve(byId_.size());
+        for (const auto& slot : slots_) {
+            if (slot.used) {
+                result.push_back(slot.threat);
+            }
+        }
+    }
+    std::sort(result.begin(), result.end(), OlderFirst);
+    return result;
+}
+
+std::vector<ThreatStore::ThreatInfo> ThreatStore::Collect(const Index& index, const std::string& key) const {
+    std::vector<ThreatInfo> result;
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex_);
+        auto it = index.find(key);
+        if (it != index.end()) {
+            result.reserve(it->second.size());
+            for (uint32_t slot : it->second) {
+                result.push_back(slots_[slot].threat);
+            }
+        }
+    }
+    std::sort(result.begin(), result.end(), OlderFirst);
+    return result;
+}
+
+std::vector<ThreatStore::ThreatInfo> ThreatStore::FindBySource(const std::string& source) const {
+    return Collect(bySource_, source);
+}
+
+std::vector<ThreatStore::ThreatInfo> ThreatStore::FindByType(const std::string& type) const {
+    return Collect(byType_, type);
+}
+
+std::vector<ThreatStore::ThreatInfo> ThreatStore::GetHistory(size_t limit) const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    size_t count = std::min(limit, historyCount_);
+    std::vector<ThreatInfo> result;
+    result.reserve(count);
+    for (size_t i = 1; i <= count; ++i) {
+        result.push_back(history_[(historyNext_ + historyCapacity_ - i) % historyCapacity_]);
+    }
+    return result;
+}
+
+size_t ThreatStore::ActiveCount() const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    return byId_.size();
+}
+
+size_t ThreatStore::HistoryCount() const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    return historyCount_;
+}
+
+void ThreatStore::Clear() {
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    slots_.clear();
+    freeSlots_.clear();
+    byId_.clear();
+    bySource_.clear();
+    byType_.clear();
+    history_.clear();
+    historyNext_ = 0;
+    historyCount_ = 0;
+}
@@ -0,0 +1,231 @@
+#include "TreeWalker.h"
+#include "WorkStealingPool.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <mutex>
+
+#ifdef __linux__
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace {
+    // Directories this far below a root are queued as pool tasks; deeper ones stay on the walker's stack
+    const unsigned kSpawnDepth = 2;
+    const size_t kDirentBuffer = 64 * 1024;
+
+#ifdef __linux__
+    struct DirectoryHandle {
+        int fd;
+        explicit DirectoryHandle(int descriptor) : fd(descriptor) {}
+        ~DirectoryHandle() { ::close(fd); }
+    };
+
+    struct LinuxDirent64 {
+        uint64_t d_ino;
+        int64_t d_off;
+        unsigned short d_reclen;
+        unsigned char d_type;
+        char d_name[1];
+    };
+#endif
+
+    std::string Normalize(const std::string& root) {
+        std::string path = root;
+        while (path.size() > 1 && (path.back() == '/' || path.back() == '\\')) {
+            path.pop_back();
+        }
+        return path;
+    }
+}
+
+struct TreeWalker::Directory {
+#ifdef __linux__
+    std::shared_ptr<DirectoryHandle> parent;   // Kept open until its last child is opened
+#endif
+    std::string name;                          // Relative to parent; unused for a root
+    std::string path;
+    size_t rootLength;                         // Chars of path before the part matched against excludes
+    uint64_t device;
+    unsigned depth;
+};
+
+struct TreeWalker::State {
+    WorkStealingPool* pool;
+    std::mutex mutex;
+    std::vector<std::string> files;
+    std::atomic<uint64_t> directories;
+    std::atomic<uint64_t> excluded;
+    std::atomic<uint64_t> mountsSkipped;
+    std::atomic<uint64_t> errors;
+
+    explicit State(WorkStealingPool* p) : pool(p), directories(0), excluded(0), mountsSkipped(0), errors(0) {}
+};
+
+TreeWalker::TreeWalker(const Options& options) : options_(options) {
+}
+
+void TreeWalker::WalkSubtree(State& state, Directory start) const {
+    std::vector<std::string> found;
+#ifdef __linux__
+    alignas(8) static thread_local char buffer[kDirentBuffer];
+    std::vector<Directory> stack;
+    stack.push_back(std::move(start));
+    while (!stack.empty()) {
+        Directory directory = std::move(stack.back());
+        stack.pop_back();
+        int fd = directory.parent
+                     ? ::openat(directory.parent->fd, directory.name.c_str(), O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC)
+                     : ::open(directory.path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        directory.parent.reset();
+        if (fd < 0) {
+            state.errors.fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+        auto handle = std::make_shared<DirectoryHandle>(fd);
+        if (options_.oneFileSystem) {
+            struct stat st;
+            if (::fstat(fd, &st) != 0 || static_cast<uint64_t>(st.st_dev) != directory.device) {
+                state.mountsSkipped.fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
+        }
+        state.directories.fetch_add(1, std::memory_order_relaxed);
+
+        std::string prefix = directory.path == "/" ? "/" : directory.path + "/";
+        for (;;) {
+            long read = ::syscall(SYS_getdents64, fd, buffer, sizeof(buffer));
+            if (read <= 0) {
+                if (read < 0) {
+                    state.errors.fetch_add(1, std::memory_order_relaxed);
+                }
+                break;
+            }
+            for (long offset = 0; offset < read;) {
+                const LinuxDirent64* entry = reinterpret_cast<const LinuxDirent64*>(buffer + offset);
+                offset += entry->d_reclen;
+                const char* name = entry->d_name;
+                if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) {
+                    continue;
+                }
+                unsigned char type = entry->d_type;
+                if (type == DT_UNKNOWN) {
+                    // Some filesystems do not fill d_type
+                    struct stat st;
+                    if (::fstatat(fd, name, &st, AT_SYMLINK_NOFOLLOW) != 0) {
+                        continue;
+                    }
+                    type = S_ISDIR(st.st_mode) ? DT_DIR : S_ISREG(st.st_mode) ? DT_REG : DT_LNK;
+                }
+                if (type != DT_DIR && type != DT_REG) {
+                    continue;
+                }
+                std::string path = prefix + name;
+                if (!excludes_.Empty() &&
+                    excludes_.Matches(path.data() + directory.rootLength, path.size() - directory.rootLength)) {
+                    state.excluded.fetch_add(1, std::memory_order_relaxed);
+                    continue;
+                }
+                if (type == DT_REG) {
+                    found.push_back(std::move(path));
+                    continue;
+                }
+                Directory child{handle, name, std::move(path), directory.rootLength, directory.device, directory.depth + 1};
+                if (child.depth <= kSpawnDepth) {
+                    state.pool->Submit([this, &state, child]() mutable { WalkSubtree(state, std::move(child)); });
+                } else {
+                    stack.push_back(std::move(child));
+                }
+            }
+        }
+    }
+#else
+    namespace fs = std::filesystem;
+    std::error_code ec;
+    fs::recursive_directory_iterator it(start.path, fs::directory_options::skip_permission_denied, ec), end;
+    if (ec) {
+        state.errors.fetch_add(1, std::memory_order_relaxed);
+    }
+    state.directories.fetch_add(1, std::memory_order_relaxed);
+    for (; !ec && it != end; it.increment(ec)) {
+        std::error_code entryError;
+        if (it->is_symlink(entryError)) {
+            continue;
+        }
+        std::string path = it->path().generic_string();
+        bool directory = it->is_directory(entryError);
+        if (!excludes_.Empty() &&
+            excludes_.Matches(path.data() + start.rootLength, path.size() - std::min(path.size(), start.rootLength))) {
+            state.excluded.fetch_add(1, std::memory_order_relaxed);
+            if (directory) {
+                it.disable_recursion_pending();
+            }
+            continue;
+        }
+        if (directory) {
+            state.directories.fetch_add(1, std::memory_order_relaxed);
+        } else if (it->is_regular_file(entryError)) {
+            found.push_back(std::move(path));
+        }
+    }
+#endif
+    std::lock_guard<std::mutex> lock(state.mutex);
+    state.files.insert(state.files.end(), std::make_move_iterator(found.begin()), std::make_move_iterator(found.end()));
+}
+
+std::vector<std::string> TreeWalker::Walk(const std::vector<std::string>& roots, Statistics* statistics) const {
+    auto started = std::chrono::steady_clock::now();
+    std::vector<std::string> files;
+    {
+        WorkStealingPool pool(options_.threads);
+        State state(&pool);
+        for (const auto& root : roots) {
+            std::string path = Normalize(root);
+            std::error_code ec;
+            std::filesystem::file_status status = std::filesystem::status(path, ec);
+            if (std::filesystem::is_regular_file(status)) {
+                std::lock_guard<std::mutex> lock(state.mutex);
+                state.files.push_back(root);
+                continue;
+            }
+            if (!std::filesystem::is_directory(status)) {
+                state.errors.fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
+            Directory directory;
+            directory.device = 0;
+#ifdef __linux__
+            struct stat st;
+            if (::stat(path.c_str(), &st) == 0) {
+                directory.device = static_cast<uint64_t>(st.st_dev);
+            }
+#endif
+            directory.rootLength = path == "/" ? 1 : path.size() + 1;
+            directory.path = std::move(path);
+            directory.depth = 0;
+            pool.Submit([this, &state, directory]() mutable { WalkSubtree(state, std::move(directory)); });
+        }
+        pool.Wait();
+        files.swap(state.files);
+        if (statistics) {
+            statistics->directories = state.directories.load();
+            statistics->excluded = state.excluded.load();
+            statistics->mountsSkipped = state.mountsSkipped.load();
+            statistics->errors = state.errors.load();
+        }
+    }
+
+    std::sort(files.begin(), files.end());
+    files.erase(std::unique(files.begin(), files.end()), files.end());
+    if (statistics) {
+        statistics->files = files.size();
+        statistics->elapsedSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    }
+    return files;
+}
@@ -0,0 +1,497 @@
+#include "UringFileReader.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <thread>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+namespace {
+    // Request kind in the low bits of user_data, slot number above
+    enum Stage : uint64_t { StatBefore = 1, Open = 2, Read = 3, Close = 4, StatAfter = 5 };
+    const unsigned kStageBits = 3;
+    // io_uring_enter calls that may refuse new work (EAGAIN/EBUSY) before a submission gives up
+    const int kSubmitAttempts = 1000;
+}
+
+#ifdef __linux__
+struct UringFileReader::Slot {
+    size_t index;
+    const char* path;
+    Stage stage;
+    int fd;
+    uint32_t buffer;
+    bool hasBuffer;
+    size_t length;
+    FingerprintCache::Fingerprint before;
+    struct statx sx;
+};
+
+struct UringFileReader::Ring {
+    unsigned* sqHead;
+    unsigned* sqTail;
+    unsigned* sqArray;
+    unsigned sqMask;
+    unsigned sqEntries;
+    io_uring_sqe* sqes;
+    unsigned* cqHead;
+    unsigned* cqTail;
+    unsigned cqMask;
+    io_uring_cqe* cqes;
+
+    void* sqMap;
+    size_t sqMapSize;
+    void* cqMap;
+    size_t cqMapSize;
+    size_t sqesSize;
+    unsigned tail;
+    unsigned pending;          // Prepared, not yet passed to io_uring_enter
+
+    io_uring_sqe* Next() {
+        if (tail - __atomic_load_n(sqHead, __ATOMIC_ACQUIRE) >= sqEntries) {
+            return nullptr;
+        }
+        unsigned index = tail & sqMask;
+        io_uring_sqe* sqe = &sqes[index];
+        std::memset(sqe, 0, sizeof(*sqe));
+        sqArray[index] = index;
+        tail++;
+        pending++;
+        return sqe;
+    }
+
+    // Submits everything prepared and optionally waits for one completion; -errno on failure.
+    // EAGAIN/EBUSY count as success with nothing submitted: reap, then enter again
+    int Enter(int fd, bool wait) {
+        __atomic_store_n(sqTail, tail, __ATOMIC_RELEASE);
+        for (;;) {
+            long submitted = ::syscall(__NR_io_uring_enter, fd, pending, wait ? 1 : 0,
+                                       wait ? IORING_ENTER_GETEVENTS : 0, nullptr, 0);
+            if (submitted >= 0) {
+                pending -= static_cast<unsigned>(submitted);
+                return 0;
+            }
+            if (errno == EINTR) {
+                continue;
+            }
+            return errno == EAGAIN || errno == EBUSY ? 0 : -errno;
+        }
+    }
+};
+#else
+struct UringFileReader::Slot {};
+struct UringFileReader::Ring {};
+#endif
+
+UringFileReader::UringFileReader(const Options& options)
+    : options_(options), ringFd_(-1), ring_(nullptr), memory_(nullptr), memorySize_(0), outstanding_(0) {
+    options_.queueDepth = std::max(1u, options_.queueDepth);
+    options_.buffers = std::max(options_.buffers, options_.queueDepth);
+}
+
+UringFileReader::~UringFileReader() {
+    Cleanup();
+}
+
+void UringFileReader::CloseRing() {
+#ifdef __linux__
+    if (ring_) {
+        ::munmap(ring_->sqes, ring_->sqesSize);
+        if (ring_->cqMap != ring_->sqMap) {
+            ::munmap(ring_->cqMap, ring_->cqMapSize);
+        }
+        ::munmap(ring_->sqMap, ring_->sqMapSize);
+        delete ring_;
+        ring_ = nullptr;
+    }
+    if (ringFd_ >= 0) {
+        ::close(ringFd_);
+        ringFd_ = -1;
+    }
+#endif
+}
+
+void UringFileReader::Cleanup() {
+    CloseRing();
+    // Hashing workers may still read buffers handed out before a ring failure
+    std::unique_lock<std::mutex> lock(buffersMutex_);
+    buffersFree_.wait(lock, [this] { return outstanding_ == 0; });
+#ifdef __linux__
+    if (memory_) {
+        ::munmap(memory_, memorySize_);
+        memory_ = nullptr;
+    }
+#endif
+    freeBuffers_.clear();
+}
+
+bool UringFileReader::Initialize() {
+    Cleanup();
+#ifdef __linux__
+    unsigned entries = options_.queueDepth * 2;   // At most two requests per file in flight
+    io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+#ifdef IORING_SETUP_COOP_TASKRUN
+    params.flags = IORING_SETUP_COOP_TASKRUN;
+#endif
+    int fd = static_cast<int>(::syscall(__NR_io_uring_setup, entries, &params));
+    if (fd < 0 && errno == EINVAL && params.flags != 0) {
+        std::memset(&params, 0, sizeof(params));
+        fd = static_cast<int>(::syscall(__NR_io_uring_setup, entries, &params));
+    }
+    if (fd < 0) {
+        lastError_ = std::string("io_uring_setup: ") + std::strerror(errno);
+        return false;
+    }
+    ringFd_ = fd;
+
+    // Every opcode the pipeline uses must be there (statx and openat need 5.6)
+    std::vector<uint8_t> probeMemory(sizeof(io_uring_probe) + 256 * sizeof(io_uring_probe_op), 0);
+    io_uring_probe* probe = reinterpret_cast<io_uring_probe*>(probeMemory.data());
+    if (::syscall(__NR_io_uring_register, fd, IORING_REGISTER_PROBE, probe, 256) < 0) {
+        lastError_ = "io_uring: opcode probe not supported";
+        Cleanup();
+        return false;
+    }
+    for (uint8_t op : {IORING_OP_STATX, IORING_OP_OPENAT, IORING_OP_READ_FIXED, IORING_OP_CLOSE}) {
+        if (op > probe->last_op || !(probe->ops[op].flags & IO_URING_OP_SUPPORTED)) {
+            lastError_ = "io_uring: opcode " + std::to_string(op) + " not supported";
+            Cleanup();
+            return false;
+        }
+    }
+
+    ring_ = new Ring();
+    ring_->sqMapSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring_->cqMapSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    bool single = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (single) {
+        ring_->sqMapSize = ring_->cqMapSize = std::max(ring_->sqMapSize, ring_->cqMapSize);
+    }
+    ring_->sqMap = ::mmap(nullptr, ring_->sqMapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd,
+                          IORING_OFF_SQ_RING);
+    ring_->cqMap = single ? ring_->sqMap
+                          : ::mmap(nullptr, ring_->cqMapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd,
+                                   IORING_OFF_CQ_RING);
+    ring_->sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+    void* sqes = ::mmap(nullptr, ring_->sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    if (ring_->sqMap == MAP_FAILED || ring_->cqMap == MAP_FAILED || sqes == MAP_FAILED) {
+        lastError_ = "io_uring: cannot map rings";
+        if (sqes != MAP_FAILED) ::munmap(sqes, ring_->sqesSize);
+        if (!single && ring_->cqMap != MAP_FAILED) ::munmap(ring_->cqMap, ring_->cqMapSize);
+        if (ring_->sqMap != MAP_FAILED) ::munmap(ring_->sqMap, ring_->sqMapSize);
+        delete ring_;
+        ring_ = nullptr;
+        Cleanup();
+        return false;
+    }
+    uint8_t* sq = static_cast<uint8_t*>(ring_->sqMap);
+    uint8_t* cq = static_cast<uint8_t*>(ring_->cqMap);
+    ring_->sqHead = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+    ring_->sqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    ring_->sqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+    ring_->sqMask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    ring_->sqEntries = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_entries);
+    ring_->sqes = static_cast<io_uring_sqe*>(sqes);
+    ring_->cqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    ring_->cqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    ring_->cqMask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    ring_->cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+    ring_->tail = *ring_->sqTail;
+    ring_->pending = 0;
+
+    // One registered region split into fixed-size buffers; the kernel pins it once, not per read
+    memorySize_ = static_cast<size_t>(options_.buffers) * options_.bufferSize;
+    void* memory = ::mmap(nullptr, memorySize_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) {
+        lastError_ = "io_uring: cannot allocate buffers";
+        memory_ = nullptr;
+        Cleanup();
+        return false;
+    }
+    memory_ = static_cast<uint8_t*>(memory);
+    iovec region{memory_, memorySize_};
+    if (::syscall(__NR_io_uring_register, fd, IORING_REGISTER_BUFFERS, &region, 1) < 0) {
+        lastError_ = std::string("io_uring: cannot register buffers: ") + std::strerror(errno);
+        Cleanup();
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(buffersMutex_);
+    for (uint32_t buffer = options_.buffers; buffer > 0; --buffer) {
+        freeBuffers_.push_back(buffer - 1);
+    }
+    return true;
+#else
+    lastError_ = "io_uring is only available on Linux";
+    return false;
+#endif
+}
+
+bool UringFileReader::AcquireBuffer(uint32_t& buffer, bool wait) {
+    std::unique_lock<std::mutex> lock(buffersMutex_);
+    if (wait) {
+        buffersFree_.wait(lock, [this] { return !freeBuffers_.empty(); });
+    }
+    if (freeBuffers_.empty()) {
+        return false;
+    }
+    buffer = freeBuffers_.back();
+    freeBuffers_.pop_back();
+    outstanding_++;
+    return true;
+}
+
+void UringFileReader::Release(uint32_t buffer) {
+    {
+        std::lock_guard<std::mutex> lock(buffersMutex_);
+        freeBuffers_.push_back(buffer);
+        outstanding_--;
+    }
+    // Run may wait for one buffer, Cleanup for all of them
+    buffersFree_.notify_all();
+}
+
+size_t UringFileReader::Run(size_t count, const std::function<const char*(size_t)>& pathOf, const StatCallback& onStat,
+                            const CompletionCallback& onComplete, const std::function<void()>& onPoll) {
+#ifdef __linux__
+    if (ringFd_ < 0) {
+        return 0;
+    }
+    const unsigned statMask = STATX_BASIC_STATS | (options_.birthTime ? STATX_BTIME : 0);
+    std::vector<Slot> slots(options_.queueDepth);
+    std::vector<uint32_t> freeSlots;
+    for (uint32_t slot = options_.queueDepth; slot > 0; --slot) {
+        freeSlots.push_back(slot - 1);
+    }
+    std::vector<uint32_t> waiting;          // Stat'ed, waiting for a buffer to open and read into
+    size_t next = 0;
+    size_t active = 0;
+    unsigned inFlight = 0;
+    int failure = 0;
+    std::vector<std::pair<uint64_t, int>> reaped;   // Completions taken off the ring, not yet handled
+
+    auto reap = [&]() {
+        unsigned head = *ring_->cqHead;
+        unsigned tail = __atomic_load_n(ring_->cqTail, __ATOMIC_ACQUIRE);
+        for (; head != tail; ++head) {
+            const io_uring_cqe& cqe = ring_->cqes[head & ring_->cqMask];
+            reaped.emplace_back(cqe.user_data, cqe.res);
+        }
+        __atomic_store_n(ring_->cqHead, head, __ATOMIC_RELEASE);
+    };
+    // Null only once the ring has failed; the failure path then completes the slot
+    auto submit = [&](uint32_t slot, Stage stage, uint8_t opcode, int fd, const void* addr, unsigned length,
+                      uint64_t offset) -> io_uring_sqe* {
+        io_uring_sqe* sqe = ring_->Next();
+        for (int attempt = 0; !sqe && !failure; ++attempt) {
+            // Submission queue full and the kernel refused more: drain completions to make room
+            if (attempt == kSubmitAttempts) {
+                failure = -EAGAIN;
+                break;
+            }
+            if (attempt > 0) {
+                std::this_thread::yield();
+            }
+            reap();
+            int result = ring_->Enter(ringFd_, false);
+            if (result < 0) {
+                failure = result;
+                break;
+            }
+            sqe = ring_->Next();
+        }
+        if (!sqe) {
+            return nullptr;
+        }
+        sqe->opcode = opcode;
+        sqe->fd = fd;
+        sqe->addr = reinterpret_cast<uint64_t>(addr);
+        sqe->len = length;
+        sqe->off = offset;
+        sqe->user_data = (static_cast<uint64_t>(slot) << kStageBits) | stage;
+        if (stage != Close) {
+            slots[slot].stage = stage;
+        }
+        inFlight++;
+        return sqe;
+    };
+    auto statx = [&](uint32_t slot, Stage stage) {
+        io_uring_sqe* sqe = submit(slot, stage, IORING_OP_STATX, AT_FDCWD, slots[slot].path, statMask,
+                                   reinterpret_cast<uint64_t>(&slots[slot].sx));
+        if (sqe) {
+            sqe->statx_flags = 0;
+        }
+    };
+    auto open = [&](uint32_t slot) {
+        io_uring_sqe* sqe = submit(slot, Open, IORING_OP_OPENAT, AT_FDCWD, slots[slot].path, 0, 0);
+        if (sqe) {
+            sqe->open_flags = O_RDONLY | O_CLOEXEC | O_NOCTTY;
+        }
+    };
+    auto finish = [&](uint32_t slot, bool read, int error, const FingerprintCache::Fingerprint* after) {
+        Slot& state = slots[slot];
+        Completion completion;
+        completion.index = state.index;
+        completion.read = read;
+        completion.error = error;
+        completion.before = state.before;
+        if (after) {
+            completion.after = *after;
+        } else {
+            std::memset(&completion.after, 0, sizeof(completion.after));
+        }
+        completion.data = nullptr;
+        completion.length = 0;
+        completion.buffer = state.buffer;
+        if (state.hasBuffer) {
+            if (error == 0) {
+                completion.data = memory_ + static_cast<size_t>(state.buffer) * options_.bufferSize;
+                completion.length = state.length;
+            } else {
+                Release(state.buffer);
+            }
+        }
+        state.hasBuffer = false;
+        onComplete(completion);
+        freeSlots.push_back(slot);
+        active--;
+    };
+    auto handle = [&](uint32_t slot, Stage stage, int result) {
+        Slot& state = slots[slot];
+        switch (stage) {
+            case StatBefore:
+                if (result < 0) {
+                    finish(slot, false, -result, nullptr);
+                } else if (!FingerprintCache::FromStatx(state.sx, state.before, options_.birthTime)) {
+                    finish(slot, false, EINVAL, nullptr);
+                } else if (!onStat(state.index, state.before)) {
+                    freeSlots.push_back(slot);
+                    active--;
+                } else if (state.before.size > options_.bufferSize) {
+                    finish(slot, true, EFBIG, nullptr);
+                } else if (AcquireBuffer(state.buffer, false)) {
+                    state.hasBuffer = true;
+                    open(slot);
+                } else {
+                    state.stage = Open;
+                    waiting.push_back(slot);
+                }
+                break;
+            case Open:
+                if (result < 0) {
+                    finish(slot, true, -result, nullptr);
+                } else {
+                    state.fd = result;
+                    submit(slot, Read, IORING_OP_READ_FIXED, state.fd,
+                           memory_ + static_cast<size_t>(state.buffer) * options_.bufferSize,
+                           static_cast<unsigned>(options_.bufferSize), 0);
+                }
+                break;
+            case Read:
+                submit(slot, Close, IORING_OP_CLOSE, state.fd, nullptr, 0, 0);
+                if (result < 0) {
+                    finish(slot, true, -result, nullptr);
+                } else {
+                    state.length = static_cast<size_t>(result);
+                    statx(slot, StatAfter);
+                }
+                break;
+            case StatAfter: {
+                FingerprintCache::Fingerprint after;
+                if (result < 0 || !FingerprintCache::FromStatx(state.sx, after, options_.birthTime)) {
+                    std::memset(&after, 0, sizeof(after));
+                }
+                // A full buffer is only the whole file if the file still fits
+                bool outgrew = state.length == options_.bufferSize && after.size > state.length;
+                finish(slot, true, outgrew ? EFBIG : 0, &after);
+                break;
+            }
+            case Close:
+                break;
+        }
+    };
+
+    while (!failure && (next < count || active > 0)) {
+        while (next < count && !freeSlots.empty()) {
+            uint32_t slot = freeSlots.back();
+            freeSlots.pop_back();
+            Slot& state = slots[slot];
+            state.index = next;
+            state.path = pathOf(next);
+            state.hasBuffer = false;
+            state.fd = -1;
+            state.length = 0;
+            next++;
+            active++;
+            statx(slot, StatBefore);
+        }
+        while (!waiting.empty() && AcquireBuffer(slots[waiting.back()].buffer, false)) {
+            slots[waiting.back()].hasBuffer = true;
+            open(waiting.back());
+            waiting.pop_back();
+        }
+        if (inFlight == 0 && !waiting.empty()) {
+            // Every buffer is with the hashing workers
+            AcquireBuffer(slots[waiting.back()].buffer, true);
+            slots[waiting.back()].hasBuffer = true;
+            open(waiting.back());
+            waiting.pop_back();
+        }
+        if (inFlight == 0) {
+            continue;
+        }
+        if (reaped.empty()) {
+            int result = ring_->Enter(ringFd_, true);
+            if (result < 0) {
+                failure = result;
+                break;
+            }
+        }
+        reap();
+        // Handlers may submit, and a full queue reaps more onto the end
+        for (size_t i = 0; i < reaped.size() && !failure; ++i) {
+            uint64_t data = reaped[i].first;
+            inFlight--;
+            handle(static_cast<uint32_t>(data >> kStageBits), static_cast<Stage>(data & ((1u << kStageBits) - 1)),
+                   reaped[i].second);
+        }
+        reaped.clear();
+        if (onPoll) {
+            onPoll();
+        }
+    }
+
+    if (failure) {
+        // The ring is unusable: hand back what is in flight and leave the rest to the caller.
+        // Buffers already with the hashing workers stay mapped until they are released
+        lastError_ = std::string("io_uring_enter: ") + std::strerror(-failure);
+        CloseRing();
+        for (uint32_t slot = 0; slot < slots.size(); ++slot) {
+            bool free = false;
+            for (uint32_t candidate : freeSlots) {
+                free = free || candidate == slot;
+            }
+            if (!free) {
+                finish(slot, slots[slot].stage != StatBefore, ECANCELED, nullptr);
+            }
+        }
+    }
+    return next;
+#else
+    (void)count;
+    (void)pathOf;
+    (void)onStat;
+    (void)onComplete;
+    (void)onPoll;
+    return 0;
+#endif
+}
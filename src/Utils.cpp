@@ -1,4 +1,5 @@
 #include "Utils.h"
+#include "HostResolver.h"
 #include <algorithm>
 #include <sstream>
 #include <fstream>
@@ -18,7 +19,16 @@
 #pragma comment(lib, "psapi.lib")
 // Undefine Windows macros that conflict with our function names
 #undef SetConsoleTitle
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #endif
+#include <cstring>
 
 namespace Utils {
 
@@ -193,8 +203,9 @@ bool IsLocalIP(const std::string& ip) {
 }
 
 std::string GetHostname(const std::string& ip) {
-    // Would implement reverse DNS lookup
-    return ip; // Placeholder
+    // Never blocks: answers with the address itself until the name resolves
+    HostResolver::Result result = HostResolver::Instance().Lookup(ip);
+    return result.status == HostResolver::Status::Resolved ? result.hostname : ip;
 }
 
 std::string GetLocalIP() {
@@ -202,6 +213,27 @@ std::string GetLocalIP() {
     return "192.168.1.100"; // Placeholder
 }
 
+bool ParseIP(const std::string& ip, uint8_t out[16], bool& isIPv6) {
+    std::memset(out, 0, 16);
+    if (inet_pton(AF_INET, ip.c_str(), out) == 1) {
+        isIPv6 = false;
+        return true;
+    }
+    if (inet_pton(AF_INET6, ip.c_str(), out) == 1) {
+        isIPv6 = true;
+        return true;
+    }
+    return false;
+}
+
+std::string FormatIP(const uint8_t addr[16], bool isIPv6) {
+    char buffer[INET6_ADDRSTRLEN] = "";
+    if (!inet_ntop(isIPv6 ? AF_INET6 : AF_INET, const_cast<uint8_t*>(addr), buffer, sizeof(buffer))) {
+        return "";
+    }
+    return buffer;
+}
+
 bool FileExists(const std::string& filename) {
     std::ifstream file(filename);
     return file.good();
@@ -260,6 +292,93 @@ std::string GetConfigDirectory() {
     return GetExecutableDirectory();
 }
 
+MappedFile::MappedFile() : data_(nullptr), size_(0), opened_(false) {
+}
+
+MappedFile::~MappedFile() {
+    Close();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+    : data_(other.data_), size_(other.size_), opened_(other.opened_),
+      fallback_(std::move(other.fallback_)) {
+    other.data_ = nullptr;
+    other.size_ = 0;
+    other.opened_ = false;
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+    if (this != &other) {
+        Close();
+        data_ = other.data_;
+        size_ = other.size_;
+        opened_ = other.opened_;
+        fallback_ = std::move(other.fallback_);
+        other.data_ = nullptr;
+        other.size_ = 0;
+        other.opened_ = false;
+    }
+    return *this;
+}
+
+bool MappedFile::Open(const std::string& filename) {
+    Close();
+#ifdef _WIN32
+    std::ifstream file(filename, std::ios::binary | std::ios::ate);
+    if (!file.is_open()) {
+        return false;
+    }
+    std::streamoff length = file.tellg();
+    if (length < 0) {
+        return false;
+    }
+    fallback_.resize(static_cast<size_t>(length));
+    file.seekg(0);
+    if (length > 0 && !file.read(reinterpret_cast<char*>(fallback_.data()), length)) {
+        fallback_.clear();
+        return false;
+    }
+    data_ = fallback_.empty() ? nullptr : fallback_.data();
+    size_ = fallback_.size();
+#else
+    int fd = ::open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        ::close(fd);
+        return false;
+    }
+    size_ = static_cast<size_t>(st.st_size);
+    if (size_ > 0) {
+        void* mapping = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping == MAP_FAILED) {
+            ::close(fd);
+            size_ = 0;
+            return false;
+        }
+        data_ = static_cast<const uint8_t*>(mapping);
+    }
+    // The mapping keeps the file referenced; the descriptor is no longer needed
+    ::close(fd);
+#endif
+    opened_ = true;
+    return true;
+}
+
+void MappedFile::Close() {
+#ifndef _WIN32
+    if (data_ && fallback_.empty()) {
+        munmap(const_cast<uint8_t*>(data_), size_);
+    }
+#endif
+    fallback_.clear();
+    data_ = nullptr;
+    size_ = 0;
+    opened_ = false;
+}
+
 std::string EscapeJson(const std::string& str) {
     std::string result;
     for (char c : str) {
@@ -617,6 +736,18 @@ bool Config::GetBool(const std::string& section, const std::string& key, bool de
     return value == "true" || value == "1" || value == "yes" || value == "on";
 }
 
+std::vector<std::string> Config::GetStringArray(const std::string& section, const std::string& key) const {
+    // INI arrays are comma-separated values
+    std::vector<std::string> result;
+    for (const auto& item : Split(GetString(section, key), ',')) {
+        std::string value = Trim(item);
+        if (!value.empty()) {
+            result.push_back(value);
+        }
+    }
+    return result;
+}
+
 void Config::SetString(const std::string& section, const std::string& key, const std::string& value) {
     config_[section][key] = value;
 }
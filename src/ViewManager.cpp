@@ -188,6 +188,21 @@ void ViewManager::ShowDashboard() {
         ResetConsoleColor();
         std::cout << " (" << threatLevel << "/5)\n";
         
+        // Riskiest entities
+        auto riskiest = monitor->GetRiskiestEntities(5);
+        if (!riskiest.empty()) {
+            std::cout << "\n";
+            SetConsoleColor(14);
+            std::cout << "  Highest Risk:\n";
+            ResetConsoleColor();
+            
+            for (const auto& entity : riskiest) {
+                std::cout << "  - " << std::left << std::setw(8) << RiskScorer::KindName(entity.kind)
+                          << std::setw(24) << entity.id << std::right << std::fixed << std::setprecision(1)
+                          << entity.score << "\n";
+            }
+        }
+        
         // Recent events
         auto events = monitor->GetRecentEvents(5);
         if (!events.empty()) {
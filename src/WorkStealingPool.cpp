@@ -0,0 +1,108 @@
+#include "WorkStealingPool.h"
+#include "ResourceGovernor.h"
+#include <algorithm>
+
+namespace {
+    // Pool and deque of the calling worker; null outside any pool
+    thread_local const WorkStealingPool* currentPool = nullptr;
+    thread_local unsigned currentIndex = 0;
+}
+
+WorkStealingPool::WorkStealingPool(unsigned threads)
+    : pending_(0), queued_(0), nextQueue_(0), steals_(0), stopping_(false) {
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    for (unsigned i = 0; i < threads; ++i) {
+        queues_.emplace_back(new Queue);
+    }
+    bool background = ResourceGovernor::IsBackgroundThread();
+    for (unsigned i = 0; i < threads; ++i) {
+        workers_.emplace_back(&WorkStealingPool::WorkerLoop, this, i, background);
+    }
+}
+
+WorkStealingPool::~WorkStealingPool() {
+    Wait();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    for (auto& worker : workers_) {
+        worker.join();
+    }
+}
+
+void WorkStealingPool::Submit(Task task) {
+    unsigned index = currentPool == this ? currentIndex
+                                         : nextQueue_.fetch_add(1, std::memory_order_relaxed) % queues_.size();
+    pending_.fetch_add(1);
+    {
+        std::lock_guard<std::mutex> lock(queues_[index]->mutex);
+        queues_[index]->tasks.push_back(std::move(task));
+        queued_.fetch_add(1);
+    }
+    // The lock orders this against a worker deciding to sleep
+    { std::lock_guard<std::mutex> lock(mutex_); }
+    wake_.notify_one();
+}
+
+void WorkStealingPool::Wait() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    idle_.wait(lock, [this] { return pending_.load() == 0; });
+}
+
+bool WorkStealingPool::WaitFor(std::chrono::milliseconds timeout) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    return idle_.wait_for(lock, timeout, [this] { return pending_.load() == 0; });
+}
+
+bool WorkStealingPool::TakeTask(unsigned index, Task& task) {
+    {
+        Queue& own = *queues_[index];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty()) {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            queued_.fetch_sub(1);
+            return true;
+        }
+    }
+    for (size_t offset = 1; offset < queues_.size(); ++offset) {
+        Queue& victim = *queues_[(index + offset) % queues_.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            queued_.fetch_sub(1);
+            steals_.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+    return false;
+}
+
+void WorkStealingPool::WorkerLoop(unsigned index, bool background) {
+    currentPool = this;
+    currentIndex = index;
+    if (background) {
+        ResourceGovernor::EnterBackgroundMode();
+    }
+    for (;;) {
+        Task task;
+        if (TakeTask(index, task)) {
+            task();
+            if (pending_.fetch_sub(1) == 1) {
+                std::lock_guard<std::mutex> lock(mutex_);
+                idle_.notify_all();
+            }
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(mutex_);
+        wake_.wait(lock, [this] { return stopping_ || queued_.load() > 0; });
+        if (stopping_ && queued_.load() == 0) {
+            return;
+        }
+    }
+}
@@ -1,9 +1,291 @@
 #include "SecurityApp.h"
+#include "BaselineIndex.h"
+#include "CorrelationEngine.h"
+#include "GeoIpDatabase.h"
+#include "IntegritySystem.h"
+#include "NetworkMonitor.h"
+#include "PacketReplay.h"
+#include "ReputationIndex.h"
+#include "RiskScorer.h"
+#include "SignatureScanner.h"
+#include "ThreatProtection.h"
 #include "Utils.h"
 #include <iostream>
+#include <fstream>
 #include <string>
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
+
+// Offline replay of a capture file through the network detection pipeline
+static int RunReplay(const std::string& captureFile, const PacketReplay::ReplayOptions& options,
+                     const std::string& collector, const std::string& geoDatabase,
+                     const std::string& rulesFile) {
+    PacketReplay replay;
+    if (!replay.Open(captureFile)) {
+        std::cerr << replay.GetLastError() << std::endl;
+        return 1;
+    }
+
+    // Declared first so the log callback never outlives them
+    ThreatProtection protection;
+    RiskScorer risk;
+    std::chrono::system_clock::time_point lastEvent;
+    NetworkMonitor monitor;
+    if (!collector.empty() && !monitor.SetFlowCollector(collector)) {
+        return 1;
+    }
+    if (!geoDatabase.empty() && !monitor.LoadGeoDatabase(geoDatabase)) {
+        std::cerr << "Cannot load GeoIP database: " << geoDatabase << std::endl;
+        return 1;
+    }
+    if (!rulesFile.empty() && !protection.LoadDetectionRules(rulesFile)) {
+        std::cerr << protection.GetRuleEngine().GetLastError() << std::endl;
+        return 1;
+    }
+    bool inspect = !rulesFile.empty();
+    monitor.SetLogCallback([&protection, &risk, &lastEvent, inspect](const NetworkMonitor::NetworkLog& log) {
+        if (inspect) {
+            protection.InspectEvent(RuleEngine::FromNetworkLog(log));
+        }
+        CorrelationEngine::Event event = CorrelationEngine::FromNetworkLog(log);
+        protection.CorrelateEvent(event);
+        risk.Observe(event);
+        lastEvent = std::max(lastEvent, event.timestamp);
+    });
+    monitor.SetConnectionCallback([&protection, &risk, &lastEvent](const NetworkMonitor::NetworkConnection& conn) {
+        CorrelationEngine::Event event = CorrelationEngine::FromConnection(conn);
+        protection.CorrelateEvent(event);
+        risk.Observe(event);
+        lastEvent = std::max(lastEvent, event.timestamp);
+    });
+    PacketReplay::ReplayStats stats = replay.Replay(monitor, options);
+    monitor.ExportFlows(true);
+
+    std::cout << "Replayed " << stats.packetsRead << " packets (" << stats.packetsDecoded
+              << " IP) from " << replay.GetFormat() << " capture in "
+              << stats.elapsedSeconds << "s" << std::endl;
+    std::cout << "Throughput: " << static_cast<uint64_t>(stats.packetsPerSecond) << " packets/sec, "
+              << stats.megabitsPerSecond << " Mbit/s" << std::endl;
+    if (stats.malformedRecords > 0) {
+        std::cout << "Malformed records: " << stats.malformedRecords << std::endl;
+    }
+
+    FlowTable::Statistics flows = monitor.GetFlowStatistics();
+    std::cout << "Flows: " << flows.flowsCreated << " created, " << flows.flowsExpired << " exported"
+              << (collector.empty() ? "" : " to " + collector) << std::endl;
+
+    if (!rulesFile.empty()) {
+        RuleEngine::Statistics ruleStats = protection.GetRuleEngine().GetStatistics();
+        std::cout << "Detection rules: " << ruleStats.rules << " rules over " << ruleStats.events
+                  << " log events, " << ruleStats.matches << " matches" << std::endl;
+    }
+    CorrelationEngine::Statistics correlation = protection.GetCorrelationEngine().GetStatistics();
+    std::cout << "Correlation: " << correlation.events << " events, " << correlation.completed << " sequences completed, "
+              << correlation.active << " pending" << std::endl;
+    for (const auto& threat : protection.GetActiveThreats()) {
+        std::cout << "  [" << threat.severity << "] " << threat.type << " from " << threat.source
+                  << " - " << threat.description << std::endl;
+        for (const auto& evidence : threat.evidence) {
+            std::cout << "      " << evidence << std::endl;
+        }
+    }
+
+    // Scores are decayed to the end of the capture, not to the wall clock
+    std::vector<RiskScorer::Entity> riskiest = risk.GetTop(10, lastEvent);
+    if (!riskiest.empty()) {
+        std::cout << "Riskiest entities:" << std::endl;
+    }
+    for (const auto& entity : riskiest) {
+        std::cout << "  " << RiskScorer::KindName(entity.kind) << " " << entity.id << ": "
+                  << entity.score << " (" << entity.events << " events)" << std::endl;
+    }
+
+    auto suspicious = monitor.GetSuspiciousIPs();
+    std::cout << "Suspicious sources: " << suspicious.size() << std::endl;
+    for (const auto& ip : suspicious) {
+        std::cout << "  " << ip << " - " << monitor.AnalyzeTrafficPattern(ip) << std::endl;
+    }
+    return 0;
+}
+
+// Compile reputation feeds into a memory-mappable index
+static int RunBuildReputation(const std::string& indexFile, const std::vector<std::string>& feeds) {
+    ReputationIndex::CompileStats stats;
+    std::string error;
+    if (!ReputationIndex::Compile(feeds, indexFile, &stats, &error)) {
+        std::cerr << error << std::endl;
+        return 1;
+    }
+    std::cout << "Compiled " << stats.entriesParsed << " entries (" << stats.linesSkipped
+              << " lines skipped) into " << stats.v4Ranges << " IPv4 and " << stats.v6Ranges
+              << " IPv6 ranges: " << indexFile << std::endl;
+    return 0;
+}
+
+// Convert a text integrity baseline to the binary format
+static int RunConvertBaseline(const std::string& textFile, const std::string& indexFile) {
+    BaselineIndex::CompileStats stats;
+    std::string error;
+    if (!BaselineIndex::ConvertText(textFile, indexFile, &stats, &error)) {
+        std::cerr << error << std::endl;
+        return 1;
+    }
+    std::cout << "Converted " << stats.entries << " entries (" << stats.linesSkipped << " lines skipped, "
+              << stats.duplicates << " duplicates); paths " << stats.pathBytes << " -> " << stats.poolBytes
+              << " bytes: " << indexFile << std::endl;
+    return 0;
+}
+
+// Report what changed since a binary integrity baseline; --promote makes the result the next generation
+static int RunIntegrityDiff(const std::string& baselineFile, const std::vector<std::string>& args) {
+    IntegritySystem::DiffOptions options;
+    options.baselineFile = baselineFile;
+    std::string reportFile;
+    for (size_t i = 0; i < args.size(); ++i) {
+        if (args[i] == "--promote") {
+            options.promote = true;
+        } else if (args[i] == "--report" && i + 1 < args.size()) {
+            reportFile = args[++i];
+        } else {
+            std::cerr << "Unknown option: " << args[i] << std::endl;
+            return 1;
+        }
+    }
+
+    for (const auto& file : IntegritySystem::GetCriticalFiles()) {
+        IntegritySystem::AddFileToCheck(file);
+    }
+    IntegritySystem::AddConfiguredScanPaths();
+    // Without a baseline every file is added; promoting then writes the first generation
+    IntegritySystem::LoadBaseline(baselineFile);
+    IntegritySystem::DiffReport report = IntegritySystem::PerformIntegrityDiff(options);
+
+    bool written;
+    if (reportFile.empty()) {
+        written = IntegritySystem::WriteDiffReport(report, std::cout);
+        std::cout << std::endl;
+    } else {
+        std::ofstream out(reportFile);
+        written = out.is_open() && IntegritySystem::WriteDiffReport(report, out);
+    }
+    const IntegritySystem::DiffSummary& summary = report.summary;
+    std::cerr << "Integrity diff against generation " << report.baselineGeneration << ": " << summary.filesChecked
+              << " files, " << summary.added << " added, " << summary.removed << " removed, " << summary.modified
+              << " modified, " << summary.permissionsChanged << " permission changes, " << report.errors.size()
+              << " errors" << std::endl;
+    if (report.promotedGeneration > 0) {
+        std::cerr << "Promoted to generation " << report.promotedGeneration << ": " << baselineFile << std::endl;
+    }
+    for (const auto& warning : report.warnings) {
+        std::cerr << warning << std::endl;
+    }
+    if (!written || !report.errors.empty()) {
+        return 1;
+    }
+    return report.clean ? 0 : 2;
+}
+
+// Scan files and directory trees against signature rules
+static int RunSignatureScan(const std::string& rulesFile, std::vector<std::string> paths) {
+    SignatureScanner::Options options;
+    options.maxFileSize = static_cast<uint64_t>(
+        std::max(1, Utils::Config::Instance().GetInt("scan", "max_file_size_mb", 64))) << 20;
+    SignatureScanner scanner(options);
+    if (!scanner.LoadRules(rulesFile)) {
+        std::cerr << scanner.GetLastError() << std::endl;
+        return 1;
+    }
+    if (paths.empty()) {
+        paths = SignatureScanner::GetConfiguredDirectories();
+    }
+
+    SignatureScanner::Statistics stats;
+    std::vector<JsonReporting::CheckResult> results = scanner.ScanPaths(paths, &stats);
+    for (const auto& result : results) {
+        if (result.status == JsonReporting::Status::FAIL && result.details.count("path")) {
+            std::cout << "  [" << JsonReporting::SeverityToString(result.severity) << "] " << result.description;
+            auto strings = result.details.find("strings");
+            if (strings != result.details.end()) {
+                std::cout << " - " << strings->second;
+            }
+            std::cout << std::endl;
+        }
+    }
+    std::cout << "Scanned " << stats.filesScanned << " files (" << stats.bytesScanned << " bytes) with "
+              << scanner.GetRuleCount() << " rules in " << stats.elapsedSeconds << "s: "
+              << stats.megabytesPerSecond << " MB/s, " << stats.ruleMatches << " matches" << std::endl;
+    if (stats.filesSkipped > 0 || stats.filesFailed > 0) {
+        std::cout << "Skipped " << stats.filesSkipped << " files over the size cap, "
+                  << stats.filesFailed << " unreadable" << std::endl;
+    }
+    return stats.ruleMatches > 0 ? 2 : 0;
+}
+
+// Compile country/ASN CSV sources into a memory-mappable GeoIP database
+static int RunBuildGeoIp(const std::string& databaseFile, const std::vector<std::string>& sources) {
+    GeoIpDatabase::CompileStats stats;
+    std::string error;
+    if (!GeoIpDatabase::Compile(sources, databaseFile, &stats, &error)) {
+        std::cerr << error << std::endl;
+        return 1;
+    }
+    std::cout << "Compiled " << stats.countryRanges << " country and " << stats.asnRanges << " ASN ranges ("
+              << stats.linesSkipped << " lines skipped) into " << stats.v4Boundaries << " IPv4 and "
+              << stats.v6Boundaries << " IPv6 boundaries, " << stats.records << " records: "
+              << databaseFile << std::endl;
+    return 0;
+}
 
 int main(int argc, char* argv[]) {
+    // Command line: --replay <capture> [--realtime] [--speed <multiplier>] [--ipfix <host:port>]
+    //                        [--geoip <database>] [--rules <file>]
+    //               --build-reputation <index> <feed>...
+    //               --build-geoip <database> country:<csv>|asn:<csv>...
+    //               --scan <rules> [path...]
+    //               --convert-baseline <text baseline> <binary baseline>
+    //               --integrity-diff <baseline> [--promote] [--report <json>]
+    if (argc >= 4 && std::string(argv[1]) == "--build-reputation") {
+        return RunBuildReputation(argv[2], std::vector<std::string>(argv + 3, argv + argc));
+    }
+    if (argc >= 4 && std::string(argv[1]) == "--build-geoip") {
+        return RunBuildGeoIp(argv[2], std::vector<std::string>(argv + 3, argv + argc));
+    }
+    if (argc == 4 && std::string(argv[1]) == "--convert-baseline") {
+        return RunConvertBaseline(argv[2], argv[3]);
+    }
+    if (argc >= 3 && std::string(argv[1]) == "--integrity-diff") {
+        return RunIntegrityDiff(argv[2], std::vector<std::string>(argv + 3, argv + argc));
+    }
+    if (argc >= 3 && std::string(argv[1]) == "--scan") {
+        return RunSignatureScan(argv[2], std::vector<std::string>(argv + 3, argv + argc));
+    }
+
+    std::string replayFile;
+    std::string ipfixCollector;
+    std::string geoDatabase;
+    std::string rulesFile;
+    PacketReplay::ReplayOptions replayOptions;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--replay" && i + 1 < argc) {
+            replayFile = argv[++i];
+        } else if (arg == "--realtime") {
+            replayOptions.originalTiming = true;
+        } else if (arg == "--speed" && i + 1 < argc) {
+            replayOptions.speedMultiplier = std::atof(argv[++i]);
+        } else if (arg == "--ipfix" && i + 1 < argc) {
+            ipfixCollector = argv[++i];
+        } else if (arg == "--geoip" && i + 1 < argc) {
+            geoDatabase = argv[++i];
+        } else if (arg == "--rules" && i + 1 < argc) {
+            rulesFile = argv[++i];
+        }
+    }
+    if (!replayFile.empty()) {
+        return RunReplay(replayFile, replayOptions, ipfixCollector, geoDatabase, rulesFile);
+    }
+
     try {
         // Set console title and properties
         Utils::SetConsoleTitle("Security Sentinel");
@@ -3,6 +3,62 @@
 #include "GoCore.h"
 #include "JsonReporting.h"
 #include "IntegritySystem.h"
+#include "NetworkMonitor.h"
+#include "PacketReplay.h"
+#include "ReputationIndex.h"
+#include "HostResolver.h"
+#include "NetworkLogStore.h"
+#include "ProcessAttribution.h"
+#include "FirewallEnforcer.h"
+#include "FlowTable.h"
+#include "IpfixExporter.h"
+#include "GeoIpDatabase.h"
+#include "ThreatStore.h"
+#include "RuleEngine.h"
+#include "IocMatcher.h"
+#include "SignatureScanner.h"
+#include "CorrelationEngine.h"
+#include "ResourceGovernor.h"
+#include "RiskScorer.h"
+#include "Sha256.h"
+#include "BaselineIndex.h"
+#include "GlobMatcher.h"
+#include "TreeWalker.h"
+#include "IntegrityWatcher.h"
+#include "UringFileReader.h"
+#include "Blake3.h"
+#include "SecurityMonitor.h"
+#include "ThreatProtection.h"
+#include "Utils.h"
+#include <thread>
+#include <fstream>
+#include <cstdio>
+#include <cstdint>
+#include <filesystem>
+#include <cstring>
+#include <atomic>
+#include <algorithm>
+#include <set>
+#include <map>
+#include <sstream>
+#include <cmath>
+#include <random>
+#include <iterator>
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <sched.h>
+#include <fcntl.h>
+#include <sys/wait.h>
+#endif
+
+// Scratch path under the system temp directory, unique to this run; each section removes its own
+static std::string TempPath(const std::string& name) {
+    static const std::string run = std::to_string(std::chrono::system_clock::now().time_since_epoch().count());
+    return (std::filesystem::temp_directory_path() / (name + "_" + run)).string();
+}
 
 int main() {
     std::cout << "Security Sentinel - Core Enhancement Test" << std::endl;
@@ -67,7 +123,7 @@ int main() {
     
     // Test 4: Performance Benchmark
     std::cout << "\n4. Performance Benchmark" << std::endl;
-    std::cout << "-----------------------" << std::endl;
+    std::cout << "------------------------" << std::endl;
     
     auto start = std::chrono::high_resolution_clock::now();
     
@@ -86,6 +142,2622 @@ int main() {
               << duration.count() << "ms" << std::endl;
     std::cout << "📊 Average: " << (duration.count() / 100.0) << "ms per operation" << std::endl;
     
+    // Test 5: Offline Packet Replay
+    std::cout << "\n5. Offline Packet Replay" << std::endl;
+    std::cout << "------------------------" << std::endl;
+    
+    {
+        // Synthesize a pcap of SYNs from one source sweeping destination ports
+        const std::string capturePath = "test_replay.pcap";
+        std::ofstream capture(capturePath, std::ios::binary);
+        auto put32 = [&capture](uint32_t v) { capture.write(reinterpret_cast<const char*>(&v), 4); };
+        auto put16 = [&capture](uint16_t v) { capture.write(reinterpret_cast<const char*>(&v), 2); };
+        put32(0xA1B2C3D4); put16(2); put16(4); put32(0); put32(0); put32(65535); put32(1);
+        
+        const int packetCount = 200000;
+        for (int i = 0; i < packetCount; ++i) {
+            uint8_t frame[54] = {0};
+            frame[12] = 0x08;                                   // IPv4
+            frame[14] = 0x45; frame[17] = 40; frame[22] = 64; frame[23] = 6;
+            frame[26] = 10; frame[27] = 0; frame[28] = static_cast<uint8_t>(i % 4); frame[29] = 5;
+            frame[30] = 192; frame[31] = 168; frame[32] = 1; frame[33] = 100;
+            frame[34] = 0x9C; frame[35] = 0x40;                 // sport 40000
+            frame[36] = static_cast<uint8_t>((i % 1024) >> 8); frame[37] = static_cast<uint8_t>(i % 1024);
+            frame[46] = 0x50; frame[47] = 0x02;                 // SYN
+            put32(1700000000 + i / 1000); put32((i % 1000) * 1000); put32(sizeof(frame)); put32(sizeof(frame));
+            capture.write(reinterpret_cast<const char*>(frame), sizeof(frame));
+        }
+        capture.close();
+        
+        PacketReplay replay;
+        NetworkMonitor monitor;
+        if (replay.Open(capturePath)) {
+            PacketReplay::ReplayStats stats = replay.Replay(monitor);
+            std::cout << "✅ Replayed " << stats.packetsRead << " packets, "
+                      << stats.packetsDecoded << " decoded" << std::endl;
+            std::cout << "⚡ Pipeline throughput: " << static_cast<uint64_t>(stats.packetsPerSecond)
+                      << " packets/sec" << std::endl;
+            std::cout << "🔍 Suspicious sources: " << monitor.GetSuspiciousIPs().size()
+                      << " (expected 4)" << std::endl;
+        } else {
+            std::cout << "❌ Replay failed: " << replay.GetLastError() << std::endl;
+        }
+        std::remove(capturePath.c_str());
+
+        // Repeated datagrams to one port are not a scan; many distinct ports are,
+        // and the host's own outbound sweep is not counted against the peer
+        NetworkMonitor scanMonitor;
+        auto datagram = [&scanMonitor](uint8_t srcLast, const uint8_t dst[4], uint16_t dstPort, uint64_t timeNs) {
+            NetworkMonitor::PacketInfo packet = {};
+            packet.timestampNs = timeNs;
+            packet.ipVersion = 4;
+            packet.protocol = 17;
+            packet.srcAddr[0] = 198; packet.srcAddr[1] = 51; packet.srcAddr[2] = 100; packet.srcAddr[3] = srcLast;
+            std::memcpy(packet.dstAddr, dst, 4);
+            packet.srcPort = 40000;
+            packet.dstPort = dstPort;
+            scanMonitor.ProcessPacket(packet);
+        };
+        const uint8_t lan[4] = {192, 168, 1, 100};
+        const uint8_t loopback[4] = {127, 0, 0, 1};
+        for (int i = 0; i < 100; ++i) {
+            datagram(1, lan, 443, 1700000000000000000ULL + i * 1000000ULL);
+        }
+        for (int i = 0; i < 25; ++i) {
+            datagram(2, lan, static_cast<uint16_t>(1000 + i), 1700000000000000000ULL + i * 1000000ULL);
+        }
+        {
+            // Swap roles: the loopback host sweeps a remote peer's ports
+            NetworkMonitor::PacketInfo packet = {};
+            packet.ipVersion = 4;
+            packet.protocol = 17;
+            std::memcpy(packet.srcAddr, loopback, 4);
+            packet.dstAddr[0] = 198; packet.dstAddr[1] = 51; packet.dstAddr[2] = 100; packet.dstAddr[3] = 3;
+            for (int i = 0; i < 25; ++i) {
+                packet.timestampNs = 1700000000000000000ULL + i * 1000000ULL;
+                packet.dstPort = static_cast<uint16_t>(1000 + i);
+                scanMonitor.ProcessPacket(packet);
+            }
+        }
+        bool quietPeer = !scanMonitor.IsIPSuspicious("198.51.100.1");
+        bool scanner = scanMonitor.IsIPSuspicious("198.51.100.2");
+        bool ownTraffic = !scanMonitor.IsIPSuspicious("127.0.0.1") && !scanMonitor.IsIPSuspicious("198.51.100.3");
+        if (quietPeer && scanner && ownTraffic) {
+            std::cout << "✅ Port scans counted by distinct inbound ports" << std::endl;
+        } else {
+            std::cout << "❌ Port scan detection: quiet peer " << quietPeer << ", scanner " << scanner
+                      << ", own traffic " << ownTraffic << std::endl;
+        }
+    }
+
+    // Test 6: Reputation Index
+    std::cout << "\n6. Reputation Index" << std::endl;
+    std::cout << "-------------------" << std::endl;
+    
+    {
+        const std::string feedPath = "test_feed.txt";
+        const std::string csvPath = "test_feed.csv";
+        const std::string indexPath = "test_reputation.idx";
+        {
+            std::ofstream feed(feedPath);
+            feed << "# synthetic feed\n";
+            for (int i = 0; i < 1000000; ++i) {
+                uint32_t ip = 0x0B000000u + static_cast<uint32_t>(i) * 7u;
+                feed << (ip >> 24) << '.' << ((ip >> 16) & 255) << '.' << ((ip >> 8) & 255) << '.' << (ip & 255) << '\n';
+            }
+            std::ofstream csv(csvPath);
+            csv << "ip,category,score\n\"203.0.113.0/24\",botnet,90\n2001:db8::/32,scanner,70\n";
+        }
+        
+        auto compileStart = std::chrono::high_resolution_clock::now();
+        ReputationIndex::CompileStats stats;
+        bool compiled = ReputationIndex::Compile({feedPath, csvPath}, indexPath, &stats);
+        auto compileEnd = std::chrono::high_resolution_clock::now();
+        
+        ReputationIndex index;
+        bool opened = compiled && index.Open(indexPath);
+        auto openEnd = std::chrono::high_resolution_clock::now();
+        
+        if (opened) {
+            std::cout << "✅ Compiled " << stats.entriesParsed << " entries in "
+                      << std::chrono::duration_cast<std::chrono::milliseconds>(compileEnd - compileStart).count()
+                      << "ms, opened in "
+                      << std::chrono::duration_cast<std::chrono::microseconds>(openEnd - compileEnd).count()
+                      << "us" << std::endl;
+            
+            std::string feed;
+            bool hits = index.Contains("11.0.0.7") && index.Contains("203.0.113.77", &feed) &&
+                        feed == "test_feed.csv" && index.Contains("2001:db8::1") &&
+                        !index.Contains("11.0.0.8") && !index.Contains("8.8.8.8");
+            std::cout << (hits ? "✅" : "❌") << " Lookup correctness" << std::endl;
+            
+            const int lookups = 5000000;
+            int found = 0;
+            uint8_t addr[16] = {0};
+            auto lookupStart = std::chrono::high_resolution_clock::now();
+            for (int i = 0; i < lookups; ++i) {
+                uint32_t ip = 0x0B000000u + static_cast<uint32_t>(i) * 13u;
+                addr[0] = static_cast<uint8_t>(ip >> 24); addr[1] = static_cast<uint8_t>(ip >> 16);
+                addr[2] = static_cast<uint8_t>(ip >> 8); addr[3] = static_cast<uint8_t>(ip);
+                found += index.Lookup(addr, false) ? 1 : 0;
+            }
+            auto lookupEnd = std::chrono::high_resolution_clock::now();
+            double ns = std::chrono::duration<double, std::nano>(lookupEnd - lookupStart).count() / lookups;
+            std::cout << "⚡ Lookups: " << ns << " ns average (" << found << " hits)" << std::endl;
+            
+            // The hourly refresh keeps an unchanged index mapped and only reopens a changed one
+            namespace fs = std::filesystem;
+            auto& config = Utils::Config::Instance();
+            std::string configuredIndex = config.GetString("network", "reputation_index", "reputation.idx");
+            config.SetString("network", "reputation_index", indexPath);
+            NetworkMonitor refresher;
+            auto countErrors = [&refresher]() {
+                auto logs = refresher.GetNetworkLogs(1000);
+                return std::count_if(logs.begin(), logs.end(), [](const NetworkMonitor::NetworkLog& log) {
+                    return log.protocol == "FEED" && log.status == "ERROR";
+                });
+            };
+            refresher.UpdateThreatDatabase();
+            bool listed = refresher.IsIPListed("11.0.0.7");
+            // Same size and modification time: not reopened, so the junk goes unnoticed
+            auto indexTime = fs::last_write_time(indexPath);
+            std::string junk(static_cast<size_t>(fs::file_size(indexPath)), 'x');
+            std::ofstream(indexPath + ".new", std::ios::binary).write(junk.data(), static_cast<std::streamsize>(junk.size()));
+            fs::rename(indexPath + ".new", indexPath);
+            fs::last_write_time(indexPath, indexTime);
+            refresher.UpdateThreatDatabase();
+            auto unchangedErrors = countErrors();
+            std::ofstream(indexPath, std::ios::binary | std::ios::app) << 'x';
+            refresher.UpdateThreatDatabase();
+            auto changedErrors = countErrors();
+            config.SetString("network", "reputation_index", configuredIndex);
+            bool refreshed = listed && unchangedErrors == 0 && changedErrors == 1 && refresher.IsIPListed("11.0.0.7");
+            std::cout << (refreshed ? "✅" : "❌") << " Refresh skipped the unchanged index and reopened the changed one"
+                      << std::endl;
+        } else {
+            std::cout << "❌ Reputation index failed: " << index.GetLastError() << std::endl;
+        }
+        std::remove(feedPath.c_str());
+        std::remove(csvPath.c_str());
+        std::remove(indexPath.c_str());
+    }
+    
+    // Test 7: Asynchronous Reverse DNS
+    std::cout << "\n7. Asynchronous Reverse DNS" << std::endl;
+    std::cout << "---------------------------" << std::endl;
+    
+    {
+        const std::string hostsPath = "test_hosts";
+        Utils::WriteFile(hostsPath, "127.0.0.1 localhost\n10.1.2.3 db01.internal db01\n");
+        
+        HostResolver::Options options;
+        options.hostsFile = hostsPath;
+        options.useSystemResolver = false;
+        options.negativeTtl = std::chrono::seconds(60);
+        HostResolver resolver(options);
+        
+        // Offline stub: slow answers for one /24, failures elsewhere
+        resolver.SetResolveFunction([](const std::string& ip, std::string& hostname) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            if (Utils::StartsWith(ip, "192.0.2.")) {
+                hostname = "host-" + ip.substr(8) + ".example";
+                return true;
+            }
+            return false;
+        });
+        
+        auto first = resolver.Lookup("10.1.2.3");
+        auto stubFirst = resolver.Lookup("192.0.2.7");
+        resolver.Lookup("198.51.100.1");
+        bool idle = resolver.WaitForIdle(std::chrono::seconds(5));
+        auto second = resolver.Lookup("10.1.2.3");
+        auto stubSecond = resolver.Lookup("192.0.2.7");
+        auto negative = resolver.Lookup("198.51.100.1");
+        
+        bool ok = idle && first.status == HostResolver::Status::Pending &&
+                  stubFirst.status == HostResolver::Status::Pending &&
+                  second.hostname == "db01.internal" && stubSecond.hostname == "host-7.example" &&
+                  negative.status == HostResolver::Status::NotFound;
+        std::cout << (ok ? "✅" : "❌") << " Pending, hosts-file, stub and negative answers" << std::endl;
+        
+        auto start = std::chrono::high_resolution_clock::now();
+        for (int i = 0; i < 1000000; ++i) {
+            resolver.Lookup("10.1.2.3");
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+        std::cout << "⚡ Cached lookups: "
+                  << std::chrono::duration<double, std::nano>(end - start).count() / 1000000 << " ns average" << std::endl;
+        std::remove(hostsPath.c_str());
+    }
+    
+    // Test 8: Columnar Network Log Store
+    std::cout << "\n8. Columnar Network Log Store" << std::endl;
+    std::cout << "-----------------------------" << std::endl;
+    
+    {
+        const size_t rows = 2000000;
+        NetworkLogStore store(rows);
+        auto base = std::chrono::system_clock::now() - std::chrono::hours(24);
+        const char* protocols[] = {"TCP", "UDP", "ICMP"};
+        const char* threats[] = {"None", "Port Scan", "Reputation: feed.txt"};
+        
+        auto start = std::chrono::high_resolution_clock::now();
+        for (size_t i = 0; i < rows + 100000; ++i) {
+            std::string src = "10.0." + std::to_string((i / 256) % 256) + "." + std::to_string(i % 256);
+            store.Append(base + std::chrono::milliseconds(i * 40), src, "192.168.1.100",
+                         protocols[i % 3], threats[(i % 97) == 0 ? 1 + (i % 2) : 0], "ALLOWED");
+        }
+        auto loaded = std::chrono::high_resolution_clock::now();
+        
+        NetworkLogStore::Query query;
+        query.ip = "10.0.3.7";
+        query.protocol = "UDP";
+        query.limit = 50;
+        auto results = store.Select(query);
+        
+        NetworkLogStore::Query window;
+        window.from = base + std::chrono::hours(12);
+        window.to = base + std::chrono::hours(13);
+        window.threat = "Port Scan";
+        size_t threatCount = store.Count(window);
+        auto queried = std::chrono::high_resolution_clock::now();
+        
+        bool ok = store.Size() <= store.Capacity() && !results.empty() &&
+                  results.front().sourceIp == "10.0.3.7" && results.front().protocol == "UDP" &&
+                  results.front().timestamp >= results.back().timestamp && threatCount > 0;
+        std::cout << (ok ? "✅" : "❌") << " Holding " << store.Size() << " rows (capacity "
+                  << store.Capacity() << "), " << results.size() << " IP matches, "
+                  << threatCount << " port scans in window" << std::endl;
+        std::cout << "⚡ Append: " << std::chrono::duration<double, std::nano>(loaded - start).count() / (rows + 100000)
+                  << " ns/row, two filtered scans: "
+                  << std::chrono::duration<double, std::milli>(queried - loaded).count() << "ms" << std::endl;
+        
+        // Non-IP addresses leave the dictionary with the last chunk that used them
+        NetworkLogStore names(2 * NetworkLogStore::CHUNK_ROWS);
+        for (size_t i = 0; i < 100000; ++i) {
+            names.Append(base + std::chrono::milliseconds(i), "host-" + std::to_string(i), "SYSTEM", "TCP", "None", "ALLOWED");
+        }
+        auto newest = names.Tail(1);
+        NetworkLogStore::Query byName;
+        byName.ip = "host-99990";
+        bool trimmed = names.InternedAddresses() <= names.Size() + 1 && !newest.empty() &&
+                       newest[0].sourceIp == "host-99999" && newest[0].destinationIp == "SYSTEM" &&
+                       names.Count(byName) == 1;
+        std::cout << (trimmed ? "✅" : "❌") << " " << names.InternedAddresses() << " interned names for "
+                  << names.Size() << " rows after 100000 distinct appends" << std::endl;
+    }
+    
+    // Test 9: Socket-to-Process Attribution
+    std::cout << "\n9. Socket-to-Process Attribution" << std::endl;
+    std::cout << "--------------------------------" << std::endl;
+    
+    {
+        // Synthetic procfs: 5,000 processes holding 20 sockets each
+        namespace fs = std::filesystem;
+        const std::string root = "te_proc";
+        const int processes = 5000;
+        const int socketsPerProcess = 20;
+        fs::remove_all(root);
+        std::vector<uint64_t> inodes;
+        for (int pid = 1; pid <= processes; ++pid) {
+            std::string dir = root + "/" + std::to_string(pid);
+            fs::create_directories(dir + "/fd");
+            std::ofstream(dir + "/comm") << "proc" << pid << "\n";
+            fs::create_symlink("/usr/bin/proc" + std::to_string(pid), dir + "/exe");
+            for (int fd = 0; fd < socketsPerProcess; ++fd) {
+                uint64_t inode = 1000000 + static_cast<uint64_t>(pid) * 100 + fd;
+                fs::create_symlink("socket:[" + std::to_string(inode) + "]", dir + "/fd/" + std::to_string(fd + 3));
+                inodes.push_back(inode);
+            }
+            fs::create_symlink("/dev/null", dir + "/fd/0");
+        }
+        
+        ProcessAttribution attribution(root);
+        auto full = attribution.Refresh();
+        auto steady = attribution.Refresh();
+        
+        // 50 processes open a socket and 10 exit
+        for (int pid = 1; pid <= 50; ++pid) {
+            fs::create_symlink("socket:[" + std::to_string(900000000 + pid) + "]",
+                               root + "/" + std::to_string(pid) + "/fd/99");
+        }
+        for (int pid = processes - 9; pid <= processes; ++pid) {
+            fs::remove_all(root + "/" + std::to_string(pid));
+        }
+        auto incremental = attribution.Refresh();
+        
+        std::vector<ProcessAttribution::Owner> owners;
+        auto start = std::chrono::high_resolution_clock::now();
+        size_t attributed = attribution.ResolveBatch(inodes, owners);
+        auto end = std::chrono::high_resolution_clock::now();
+        
+        ProcessAttribution::Owner owner;
+        bool ok = full.processesRescanned == static_cast<uint64_t>(processes) && steady.processesRescanned == 0 &&
+                  incremental.processesRescanned == 50 && incremental.processesExited == 10 &&
+                  attributed == inodes.size() - 10 * socketsPerProcess &&
+                  attribution.Resolve(900000007, owner) && owner.pid == 7 && owner.name == "proc7" &&
+                  owner.exe == "/usr/bin/proc7";
+        std::cout << (ok ? "✅" : "❌") << " Attributed " << attributed << "/" << inodes.size()
+                  << " sockets; rescanned " << steady.processesRescanned << " unchanged and "
+                  << incremental.processesRescanned << " changed processes" << std::endl;
+        std::cout << "⚡ Full scan: " << full.elapsedMs << "ms (" << full.linksRead << " links), steady refresh: "
+                  << steady.elapsedMs << "ms, incremental: " << incremental.elapsedMs << "ms, batch resolve: "
+                  << std::chrono::duration<double, std::milli>(end - start).count() << "ms" << std::endl;
+        
+        // pid 1 exits and the pid is reused between refreshes, with the same fd count
+        auto writeStat = [&root](int pid, const std::string& comm, uint64_t startTime) {
+            std::ofstream stat(root + "/" + std::to_string(pid) + "/stat");
+            stat << pid << " (" << comm << ") S";
+            for (int field = 4; field <= 21; ++field) stat << " 0";
+            stat << ' ' << startTime << " 0 0\n";
+        };
+        writeStat(1, "proc 1)", 100);
+        attribution.Refresh();
+        ProcessAttribution::Owner before;
+        attribution.Resolve(1000100, before);
+        fs::remove_all(root + "/1");
+        fs::create_directories(root + "/1/fd");
+        std::ofstream(root + "/1/comm") << "reused\n";
+        fs::create_symlink("/usr/bin/reused", root + "/1/exe");
+        for (int fd = 0; fd < socketsPerProcess + 1; ++fd) {
+            fs::create_symlink("socket:[" + std::to_string(800000000 + fd) + "]", root + "/1/fd/" + std::to_string(fd + 3));
+        }
+        fs::create_symlink("/dev/null", root + "/1/fd/0");
+        writeStat(1, "reused", 200);
+        auto reuse = attribution.Refresh();
+        ProcessAttribution::Owner after, stale;
+        bool reused = before.name == "proc1" && reuse.processesRescanned == 1 &&
+                      attribution.Resolve(800000000, after) && after.pid == 1 && after.name == "reused" &&
+                      after.exe == "/usr/bin/reused" && !attribution.Resolve(1000100, stale);
+        std::cout << (reused ? "✅" : "❌") << " Reused pid detected from its start time: "
+                  << before.name << " -> " << after.name << std::endl;
+        fs::remove_all(root);
+    }
+    
+    // Test 10: Batched Firewall Enforcement
+    std::cout << "\n10. Batched Firewall Enforcement" << std::endl;
+    std::cout << "--------------------------------" << std::endl;
+    
+    {
+        auto* mock = new MockFirewallDriver();
+        FirewallEnforcer::Options options;
+        options.maxBatch = 4096;
+        FirewallEnforcer enforcer(std::unique_ptr<FirewallDriver>(mock), options);
+        
+        const int sources = 100000;
+        auto start = std::chrono::high_resolution_clock::now();
+        for (int i = 0; i < sources; ++i) {
+            enforcer.Block("172." + std::to_string(16 + i / 65536) + "." + std::to_string((i / 256) % 256) +
+                           "." + std::to_string(i % 256));
+        }
+        enforcer.Flush();
+        auto end = std::chrono::high_resolution_clock::now();
+        size_t batches = mock->GetBatches().size();
+        
+        // Short TTLs expire into a removal batch; unblocks coalesce with queued blocks
+        enforcer.Block("198.51.100.1", std::chrono::milliseconds(50));
+        enforcer.Block("2001:db8::7", std::chrono::milliseconds(50));
+        enforcer.Block("198.51.100.2");
+        enforcer.Unblock("198.51.100.2");
+        enforcer.Flush();
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        enforcer.Flush();
+        
+        auto recorded = mock->GetBatches();
+        const auto& last = recorded.back();
+        auto stats = enforcer.GetStatistics();
+        bool ok = stats.activeBlocks == static_cast<size_t>(sources) && stats.failedBatches == 0 &&
+                  stats.expired == 2 && stats.coalesced == 1 && last.size() == 2 &&
+                  last[0].action == FirewallDriver::Action::Remove && !enforcer.IsBlocked("198.51.100.1") &&
+                  !enforcer.IsBlocked("198.51.100.2") && enforcer.IsBlocked("172.16.0.1");
+        std::cout << (ok ? "✅" : "❌") << " " << stats.applied << " operations in " << stats.batches
+                  << " driver batches, " << stats.expired << " expired, " << stats.activeBlocks << " active" << std::endl;
+        std::cout << "⚡ Enforcement: " << sources / std::chrono::duration<double>(end - start).count()
+                  << " blocks/sec in " << batches << " transactions" << std::endl;
+    }
+
+    {
+        // A rolled-back batch restores the prior expiry, keeps removals and is retried
+        auto* mock = new MockFirewallDriver();
+        FirewallEnforcer enforcer{std::unique_ptr<FirewallDriver>(mock)};
+        enforcer.Block("203.0.113.1", std::chrono::milliseconds(0));
+        enforcer.Block("203.0.113.2", std::chrono::seconds(30));
+        enforcer.Flush();
+
+        mock->FailNextBatch();
+        enforcer.Block("203.0.113.2", std::chrono::seconds(60));
+        enforcer.Unblock("203.0.113.1");
+        enforcer.Block("203.0.113.3");
+        bool queuedVisible = enforcer.IsBlocked("203.0.113.3") && !enforcer.IsBlocked("203.0.113.1");
+        bool flushed = enforcer.Flush();
+
+        auto recorded = mock->GetBatches();
+        auto stats = enforcer.GetStatistics();
+        const auto& retry = recorded.back();
+        bool ok = queuedVisible && flushed && recorded.size() == 2 && stats.failedBatches == 1 &&
+                  stats.retried == 3 && retry.size() == 4 && enforcer.IsBlocked("203.0.113.3") &&
+                  !enforcer.IsBlocked("203.0.113.1") && enforcer.GetBlockedIPs().size() == 2;
+        std::cout << (ok ? "✅" : "❌") << " Failed batch retried: " << stats.retried << " requests re-queued, "
+                  << retry.size() << " operations applied on retry" << std::endl;
+    }
+    
+#ifndef _WIN32
+    // Test 11: Flow Aggregation and IPFIX Export
+    std::cout << "\n11. Flow Aggregation and IPFIX Export" << std::endl;
+    std::cout << "-------------------------------------" << std::endl;
+    
+    {
+        // Local collector: count records per template and keep the first IPv4 record
+        int listener = socket(AF_INET, SOCK_DGRAM, 0);
+        int bufferSize = 16 * 1024 * 1024;
+        setsockopt(listener, SOL_SOCKET, SO_RCVBUF, &bufferSize, sizeof(bufferSize));
+        timeval timeout = {0, 200000};
+        setsockopt(listener, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        sockaddr_in address = {};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address));
+        socklen_t addressLength = sizeof(address);
+        getsockname(listener, reinterpret_cast<sockaddr*>(&address), &addressLength);
+        
+        std::atomic<uint64_t> received4(0), received6(0), templates(0), badMessages(0);
+        std::atomic<bool> listening(true);
+        std::vector<uint8_t> firstRecord;
+        std::thread collector([&] {
+            std::vector<uint8_t> datagram(65536);
+            while (listening) {
+                ssize_t length = recv(listener, datagram.data(), datagram.size(), 0);
+                if (length < 16) continue;
+                auto be16 = [&](size_t at) { return static_cast<uint16_t>(datagram[at] << 8 | datagram[at + 1]); };
+                if (be16(0) != 10 || be16(2) != length) { badMessages++; continue; }
+                for (size_t at = 16; at + 4 <= static_cast<size_t>(length);) {
+                    uint16_t setId = be16(at), setLength = be16(at + 2);
+                    if (setLength < 4) { badMessages++; break; }
+                    if (setId == 2) templates += 2;
+                    if (setId == IpfixExporter::TEMPLATE_IPV4) {
+                        if (firstRecord.empty()) firstRecord.assign(&datagram[at + 4], &datagram[at + 4 + IpfixExporter::RECORD_LENGTH_IPV4]);
+                        received4 += (setLength - 4) / IpfixExporter::RECORD_LENGTH_IPV4;
+                    }
+                    if (setId == IpfixExporter::TEMPLATE_IPV6) received6 += (setLength - 4) / IpfixExporter::RECORD_LENGTH_IPV6;
+                    at += setLength;
+                }
+            }
+        });
+        
+        IpfixExporter exporter;
+        bool opened = exporter.Open("127.0.0.1:" + std::to_string(ntohs(address.sin_port)));
+        const uint64_t second = 1000000000ULL;
+        FlowTable table(15 * second, 60 * second);
+        auto observe = [&](uint64_t t, uint8_t version, uint32_t src, uint32_t dst, uint16_t sport, uint16_t dport,
+                           uint8_t protocol, uint8_t flags, uint64_t bytes) {
+            FlowTable::Observation o = {};
+            o.timestampNs = t; o.ipVersion = version; o.protocol = protocol; o.tcpFlags = flags;
+            o.srcPort = sport; o.dstPort = dport; o.bytes = bytes; o.packets = 1;
+            if (version == 6) { o.srcAddr[0] = o.dstAddr[0] = 0x20; o.srcAddr[1] = o.dstAddr[1] = 0x01; }
+            std::memcpy(o.srcAddr + (version == 6 ? 12 : 0), &src, 4);
+            std::memcpy(o.dstAddr + (version == 6 ? 12 : 0), &dst, 4);
+            table.Observe(o);
+        };
+        
+        // TCP handshake, data, FIN from both sides: one biflow ended by teardown
+        uint32_t client = htonl(0x0a000001), server = htonl(0x0a000002);
+        uint64_t t0 = 1700000000ULL * second;
+        observe(t0, 4, client, server, 40000, 443, 6, 0x02, 60);
+        observe(t0 + 1000, 4, server, client, 443, 40000, 6, 0x12, 60);
+        observe(t0 + 2000, 4, client, server, 40000, 443, 6, 0x18, 1500);
+        observe(t0 + 3000, 4, client, server, 40000, 443, 6, 0x11, 52);
+        observe(t0 + 4000, 4, server, client, 443, 40000, 6, 0x11, 52);
+        // A UDP IPv6 flow left to idle out, and a busy flow crossing the active timeout
+        observe(t0, 6, client, server, 5353, 5353, 17, 0, 120);
+        for (int i = 0; i < 70; ++i) {
+            observe(t0 + i * second, 4, htonl(0x0a000003), server, 50000, 8080, 17, 0, 200);
+        }
+        std::vector<FlowTable::FlowRecord> records;
+        table.Expire(t0 + 70 * second, records);
+        size_t ended = 0, idle = 0, active = 0;
+        for (const auto& record : records) {
+            ended += record.endReason == FlowTable::EndOfFlow;
+            idle += record.endReason == FlowTable::IdleTimeout;
+            active += record.endReason == FlowTable::ActiveTimeout;
+        }
+        exporter.Export(records);
+        exporter.Flush();
+        
+        // Throughput: 200k five-packet biflows through the table and out over UDP
+        const uint32_t flows = 200000;
+        FlowTable bulk(15 * second, 60 * second, 1 << 20);
+        auto start = std::chrono::high_resolution_clock::now();
+        for (uint32_t f = 0; f < flows; ++f) {
+            uint32_t src = htonl(0x0b000000 + f);
+            for (int p = 0; p < 5; ++p) {
+                FlowTable::Observation o = {};
+                o.timestampNs = t0 + f * 1000 + p; o.ipVersion = 4; o.protocol = 6; o.tcpFlags = 0x10;
+                bool forward = p % 2 == 0;
+                std::memcpy(forward ? o.srcAddr : o.dstAddr, &src, 4);
+                std::memcpy(forward ? o.dstAddr : o.srcAddr, &server, 4);
+                o.srcPort = forward ? 33000 : 443; o.dstPort = forward ? 443 : 33000;
+                o.bytes = 400; o.packets = 1;
+                bulk.Observe(o);
+            }
+        }
+        auto aggregated = std::chrono::high_resolution_clock::now();
+        std::vector<FlowTable::FlowRecord> bulkRecords;
+        bulk.Expire(t0 + 3600 * second, bulkRecords);
+        exporter.Export(bulkRecords);
+        exporter.Flush();
+        auto exported = std::chrono::high_resolution_clock::now();
+        
+        std::this_thread::sleep_for(std::chrono::milliseconds(300));
+        listening = false;
+        collector.join();
+        close(listener);
+        
+        auto stats = exporter.GetStatistics();
+        uint64_t firstPackets = 0, firstReversePackets = 0;
+        for (int i = 0; i < 8; ++i) {
+            firstPackets = firstPackets << 8 | firstRecord.at(40 + i);
+            firstReversePackets = firstReversePackets << 8 | firstRecord.at(56 + i);
+        }
+        bool ok = opened && ended == 1 && idle == 1 && active == 1 && badMessages == 0 && templates > 0 &&
+                  received6 == 1 && firstPackets == 3 && firstReversePackets == 2 && firstRecord[31] == FlowTable::EndOfFlow &&
+                  stats.records == records.size() + flows && received4 + received6 == stats.records;
+        std::cout << (ok ? "✅" : "❌") << " Exported " << stats.records << " biflow records in " << stats.messages
+                  << " datagrams; collector received " << received4 + received6 << " (" << ended << " ended, "
+                  << idle << " idle, " << active << " active timeout)" << std::endl;
+        std::cout << "⚡ Aggregation: " << flows / std::chrono::duration<double>(aggregated - start).count()
+                  << " flows/sec (" << flows * 5 / std::chrono::duration<double>(aggregated - start).count() / 1e6
+                  << "M packets/sec), export: " << flows / std::chrono::duration<double>(exported - aggregated).count()
+                  << " flows/sec" << std::endl;
+        
+        // A SYN flood: 50k one-packet flows through a 1000-slot table, with and without resets
+        FlowTable flood(15 * second, 300 * second, 1000);
+        size_t maxTimers = 0;
+        std::vector<FlowTable::FlowRecord> floodRecords;
+        for (uint32_t f = 0; f < 50000; ++f) {
+            FlowTable::Observation o = {};
+            o.timestampNs = t0 + f * 1000; o.ipVersion = 4; o.protocol = 6; o.tcpFlags = f % 2 ? 0x04 : 0x02;
+            uint32_t src = htonl(0x0c000000 + f);
+            std::memcpy(o.srcAddr, &src, 4);
+            std::memcpy(o.dstAddr, &server, 4);
+            o.srcPort = 40000; o.dstPort = 443; o.bytes = 60; o.packets = 1;
+            flood.Observe(o);
+            if (f % 100 == 0) {
+                floodRecords.clear();
+                flood.Expire(o.timestampNs, floodRecords);
+            }
+            maxTimers = std::max(maxTimers, flood.GetStatistics().activeTimers);
+        }
+        std::cout << (maxTimers <= 1000 ? "✅" : "❌") << " Active-timeout queue peaked at " << maxTimers
+                  << " entries for a 1000-flow table over 50000 short flows" << std::endl;
+    }
+#endif
+    
+    // Test 12: GeoIP/ASN Enrichment
+    std::cout << "\n12. GeoIP/ASN Enrichment" << std::endl;
+    std::cout << "------------------------" << std::endl;
+    
+    {
+        const std::string countryPath = "test_geo_country.csv";
+        const std::string asnPath = "test_geo_asn.tsv";
+        const std::string databasePath = "test_geoip.db";
+        const char* codes[] = {"US", "DE", "JP", "BR", "FR", "GB", "NL", "SG"};
+        {
+            // 200k country ranges of one /24 each, DB-IP layout
+            std::ofstream country(countryPath);
+            country << "ip_start,ip_end,country\n";
+            for (uint32_t i = 0; i < 200000; ++i) {
+                uint32_t first = 0x0B000000u + i * 256u;
+                uint32_t last = first + 255u;
+                country << (first >> 24) << '.' << ((first >> 16) & 255) << '.' << ((first >> 8) & 255) << ".0,"
+                        << (last >> 24) << '.' << ((last >> 16) & 255) << '.' << ((last >> 8) & 255) << ".255,"
+                        << codes[i % 8] << '\n';
+            }
+            country << "2001:db8::/32,NL\n";
+            // ASNs cover /20s, iptoasn layout with quoted org names
+            std::ofstream asn(asnPath);
+            for (uint32_t i = 0; i < 12500; ++i) {
+                uint32_t first = 0x0B000000u + i * 4096u;
+                uint32_t last = first + 4095u;
+                asn << (first >> 24) << '.' << ((first >> 16) & 255) << '.' << ((first >> 8) & 255) << ".0\t"
+                    << (last >> 24) << '.' << ((last >> 16) & 255) << '.' << ((last >> 8) & 255) << ".255\t"
+                    << 64512 + i % 1000 << "\tUS\tExample Net " << i % 1000 << '\n';
+            }
+            asn << "8.8.8.0\t8.8.8.255\t15169\tUS\t\"Google, LLC\"\n";
+            asn << "2001:db8::\t2001:db8:ffff:ffff:ffff:ffff:ffff:ffff\tAS64496\tNL\tDocumentation\n";
+        }
+        
+        auto compileStart = std::chrono::high_resolution_clock::now();
+        GeoIpDatabase::CompileStats stats;
+        std::string error;
+        bool compiled = GeoIpDatabase::Compile({"country:" + countryPath, "asn:" + asnPath}, databasePath, &stats, &error);
+        auto compileEnd = std::chrono::high_resolution_clock::now();
+        
+        GeoIpDatabase geo;
+        if (compiled && geo.Open(databasePath)) {
+            std::cout << "✅ Compiled " << stats.countryRanges << " country and " << stats.asnRanges
+                      << " ASN ranges into " << stats.v4Boundaries + stats.v6Boundaries << " boundaries in "
+                      << std::chrono::duration_cast<std::chrono::milliseconds>(compileEnd - compileStart).count()
+                      << "ms" << std::endl;
+            
+            GeoIpDatabase::GeoInfo a, b, c, d, e;
+            bool ok = geo.Lookup("11.0.1.7", a) && std::string(a.country) == "DE" && a.asn == 64512 &&
+                      std::string(a.organization) == "Example Net 0" &&
+                      geo.Lookup("11.0.16.1", b) && std::string(b.country) == "US" && b.asn == 64513 &&
+                      geo.Lookup("8.8.8.8", c) && c.country[0] == 0 && c.asn == 15169 &&
+                      std::string(c.organization) == "Google, LLC" &&
+                      geo.Lookup("2001:db8::1", d) && std::string(d.country) == "NL" && d.asn == 64496 &&
+                      !geo.Lookup("10.0.0.1", e) && !geo.Lookup("9.255.255.255", e);
+            std::cout << (ok ? "✅" : "❌") << " Country/ASN lookup correctness" << std::endl;
+            
+            // A jump-table entry past the boundary list; the header checksum still matches
+            {
+                std::ifstream in(databasePath, std::ios::binary);
+                std::string image((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+                uint64_t jumpOffset = 0;
+                std::memcpy(&jumpOffset, image.data() + 48, sizeof(jumpOffset));
+                uint32_t bogus = 0xFFFFFFF0u;
+                std::memcpy(&image[jumpOffset + 100 * sizeof(uint32_t)], &bogus, sizeof(bogus));
+                std::ofstream(databasePath + ".bad", std::ios::binary).write(image.data(), static_cast<std::streamsize>(image.size()));
+            }
+            GeoIpDatabase corrupt;
+            bool rejected = !corrupt.Open(databasePath + ".bad");
+            std::cout << (rejected ? "✅" : "❌") << " Corrupt jump table rejected: " << corrupt.GetLastError() << std::endl;
+            std::remove((databasePath + ".bad").c_str());
+            
+            NetworkMonitor monitor;
+            monitor.SetGeoDatabase(std::shared_ptr<const GeoIpDatabase>(&geo, [](const GeoIpDatabase*) {}));
+            NetworkMonitor::NetworkConnection conn;
+            conn.localAddress = "192.168.1.10";
+            conn.remoteAddress = "11.0.1.7";
+            conn.localPort = 443;
+            conn.remotePort = 50000;
+            conn.protocol = "TCP";
+            conn.processId = 0;
+            conn.socketInode = 0;
+            conn.asn = 0;
+            conn.timestamp = std::chrono::system_clock::now();
+            monitor.ProcessConnection(conn);
+            std::string pattern = monitor.AnalyzeTrafficPattern("11.0.1.7");
+            std::cout << (pattern.find("[DE AS64512 Example Net 0]") != std::string::npos ? "✅" : "❌")
+                      << " Traffic pattern: " << pattern << std::endl;
+            monitor.SetGeoDatabase(nullptr);
+            
+            const int lookups = 5000000;
+            uint64_t asnSum = 0;
+            uint8_t addr[16] = {0};
+            GeoIpDatabase::GeoInfo info;
+            auto uncachedStart = std::chrono::high_resolution_clock::now();
+            for (int i = 0; i < lookups; ++i) {
+                uint32_t ip = 0x0B000000u + (static_cast<uint32_t>(i) * 2654435761u) % (200000u * 256u);
+                addr[0] = static_cast<uint8_t>(ip >> 24); addr[1] = static_cast<uint8_t>(ip >> 16);
+                addr[2] = static_cast<uint8_t>(ip >> 8); addr[3] = static_cast<uint8_t>(ip);
+                geo.Lookup(addr, false, info);
+                asnSum += info.asn;
+            }
+            auto cachedStart = std::chrono::high_resolution_clock::now();
+            for (int i = 0; i < lookups; ++i) {
+                // A connection table's worth of recurring peers
+                uint32_t ip = 0x0B000000u + static_cast<uint32_t>(i % 64) * 65536u;
+                addr[0] = static_cast<uint8_t>(ip >> 24); addr[1] = static_cast<uint8_t>(ip >> 16);
+                addr[2] = static_cast<uint8_t>(ip >> 8); addr[3] = static_cast<uint8_t>(ip);
+                geo.LookupCached(addr, false, info);
+                asnSum += info.asn;
+            }
+            auto cachedEnd = std::chrono::high_resolution_clock::now();
+            std::cout << "⚡ Lookups: " << std::chrono::duration<double, std::nano>(cachedStart - uncachedStart).count() / lookups
+                      << " ns uncached, " << std::chrono::duration<double, std::nano>(cachedEnd - cachedStart).count() / lookups
+                      << " ns cached (checksum " << asnSum % 1000 << ")" << std::endl;
+        } else {
+            std::cout << "❌ GeoIP database failed: " << (compiled ? geo.GetLastError() : error) << std::endl;
+        }
+        std::remove(countryPath.c_str());
+        std::remove(asnPath.c_str());
+        std::remove(databasePath.c_str());
+    }
+    
+    // Test 13: Concurrent Threat Store
+    std::cout << "\n13. Concurrent Threat Store" << std::endl;
+    std::cout << "---------------------------" << std::endl;
+    
+    {
+        ThreatStore store(1000);
+        const int producers = 4;
+        const int perProducer = 50000;
+        std::atomic<bool> producing(true);
+        std::atomic<int> mitigated(0);
+        std::vector<std::string> ids[producers];
+        
+        auto start = std::chrono::high_resolution_clock::now();
+        std::vector<std::thread> workers;
+        for (int p = 0; p < producers; ++p) {
+            workers.emplace_back([&, p] {
+                for (int i = 0; i < perProducer; ++i) {
+                    ThreatStore::ThreatInfo threat;
+                    threat.type = i % 2 ? "Port Scan" : "Malware";
+                    threat.source = "10.0." + std::to_string(p) + "." + std::to_string(i % 200);
+                    threat.description = "synthetic";
+                    threat.severity = 1 + i % 5;
+                    threat.detected = std::chrono::system_clock::now();
+                    threat.mitigated = false;
+                    ids[p].push_back(store.Add(threat));
+                }
+            });
+        }
+        // Mitigators race the producers, resolving whatever is active by source
+        for (int m = 0; m < 2; ++m) {
+            workers.emplace_back([&, m] {
+                while (producing || store.ActiveCount() > 0) {
+                    for (int i = 0; i < 200; ++i) {
+                        for (const auto& threat : store.FindBySource("10.0." + std::to_string(m) + "." + std::to_string(i))) {
+                            mitigated += store.Mitigate(threat.id) ? 1 : 0;
+                        }
+                    }
+                    if (!producing && m == 0) {
+                        for (const auto& threat : store.GetActive()) {
+                            mitigated += store.Mitigate(threat.id) ? 1 : 0;
+                        }
+                    }
+                }
+            });
+        }
+        for (int p = 0; p < producers; ++p) {
+            workers[p].join();
+        }
+        producing = false;
+        for (size_t w = producers; w < workers.size(); ++w) {
+            workers[w].join();
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+        
+        bool sortable = true;
+        std::set<std::string> unique;
+        for (int p = 0; p < producers; ++p) {
+            sortable = sortable && std::is_sorted(ids[p].begin(), ids[p].end());
+            unique.insert(ids[p].begin(), ids[p].end());
+        }
+        auto history = store.GetHistory(5);
+        bool newestFirst = history.size() == 5 && history[0].mitigated;
+        const int total = producers * perProducer;
+        bool ok = mitigated == total && store.ActiveCount() == 0 && store.HistoryCount() == 1000 &&
+                  static_cast<int>(unique.size()) == total && sortable && newestFirst && !unique.count("");
+        std::cout << (ok ? "✅" : "❌") << " " << total << " threats added and " << mitigated
+                  << " mitigated concurrently; ids unique and time-sortable" << std::endl;
+        
+        ThreatStore ordered(3);
+        for (int i = 0; i < 5; ++i) {
+            ThreatStore::ThreatInfo threat;
+            threat.id = "T" + std::to_string(i);
+            threat.type = "Test";
+            threat.source = "192.0.2.1";
+            threat.severity = 1;
+            threat.detected = std::chrono::system_clock::now();
+            threat.mitigated = false;
+            ordered.Add(threat);
+            ordered.Mitigate(threat.id);
+        }
+        auto recent = ordered.GetHistory(10);
+        bool ringOk = recent.size() == 3 && recent[0].id == "T4" && recent[2].id == "T2" &&
+                      ordered.FindByType("Test").empty();
+        std::cout << (ringOk ? "✅" : "❌") << " History ring keeps the newest entries, newest first" << std::endl;
+        std::cout << "⚡ Throughput: " << total * 2 / std::chrono::duration<double>(end - start).count()
+                  << " add+mitigate ops/sec" << std::endl;
+    }
+    
+    // Test 14: Compiled Detection Rules
+    std::cout << "\n14. Compiled Detection Rules" << std::endl;
+    std::cout << "----------------------------" << std::endl;
+    
+    {
+        RuleEngine engine;
+        bool loaded = engine.LoadRulesFromString(R"({"rules": [
+            {"id": "ssh-burst", "type": "Brute Force", "severity": 4,
+             "match": {"all": [{"field": "stream", "eq": "network"}, {"field": "protocol", "in": ["SSH", "TCP"]},
+                               {"field": "threat", "contains": "Failed login"},
+                               {"not": {"field": "source", "cidr": "10.0.0.0/8"}}]},
+             "threshold": {"count": 3, "window_seconds": 60, "group_by": "source"}},
+            {"id": "critical", "match": {"any": [{"field": "severity", "ge": 5}, {"field": "country", "eq": "ZZ"}]}}
+        ]})");
+        auto at = [](int seconds) { return std::chrono::system_clock::time_point(std::chrono::seconds(1700000000 + seconds)); };
+        NetworkMonitor::NetworkLog log;
+        log.sourceIp = "198.51.100.7";
+        log.destinationIp = "192.168.1.10";
+        log.protocol = "SSH";
+        log.threat = "Failed login for root";
+        log.status = "DETECTED";
+        log.asn = 0;
+        std::vector<RuleEngine::Match> matches;
+        for (int i = 0; i < 3; ++i) {
+            log.timestamp = at(i * 10);
+            engine.Evaluate(RuleEngine::FromNetworkLog(log), matches);
+        }
+        size_t afterBurst = matches.size();
+        log.sourceIp = "10.1.2.3";             // Excluded by the not/cidr clause
+        for (int i = 0; i < 5; ++i) {
+            log.timestamp = at(100 + i);
+            engine.Evaluate(RuleEngine::FromNetworkLog(log), matches);
+        }
+        log.sourceIp = "203.0.113.9";          // Too slow to reach the threshold
+        for (int i = 0; i < 3; ++i) {
+            log.timestamp = at(200 + i * 61);
+            engine.Evaluate(RuleEngine::FromNetworkLog(log), matches);
+        }
+        SecurityMonitor::SecurityEvent critical{at(500), "Malware", "scanner", "Ransomware detected", 5};
+        engine.Evaluate(RuleEngine::FromSecurityEvent(critical), matches);
+        
+        bool rejected = !engine.LoadRulesFromString(R"({"rules": [{"id": "bad", "match": {"field": "nope", "eq": 1}}]})") &&
+                        engine.GetRuleCount() == 2;
+        bool ok = loaded && afterBurst == 1 && matches.size() == 2 && matches[0].ruleId == "ssh-burst" &&
+                  matches[0].count == 3 && matches[0].severity == 4 && matches[1].ruleId == "critical" &&
+                  matches[1].severity == 5 && rejected;
+        std::cout << (ok ? "✅" : "❌") << " Predicates, boolean logic and windowed thresholds ("
+                  << matches.size() << " matches); invalid reload rejected: " << engine.GetLastError() << std::endl;
+        
+        // 1,000 rules: most anchored on an event type, some needing a scan of every event
+        auto makeRules = [](int count, const std::string& suffix) {
+            std::string json = "{\"rules\": [";
+            for (int i = 0; i < count; ++i) {
+                if (i) json += ",";
+                json += "{\"id\": \"rule-" + std::to_string(i) + suffix + "\", \"severity\": 3, \"match\": ";
+                if (i % 20 == 0) {
+                    json += "{\"all\": [{\"field\": \"description\", \"contains\": \"indicator-" + std::to_string(i) +
+                            "\"}, {\"field\": \"severity\", \"ge\": 2}]}}";
+                } else {
+                    json += "{\"all\": [{\"field\": \"stream\", \"eq\": \"security\"}, {\"field\": \"type\", \"eq\": \"Type" +
+                            std::to_string(i) + "\"}, {\"any\": [{\"field\": \"severity\", \"ge\": 4}, {\"field\": \"source\", \"prefix\": \"svc-\"}]}]}}";
+                }
+            }
+            return json + "]}";
+        };
+        RuleEngine bench;
+        bench.LoadRulesFromString(makeRules(1000, ""));
+        
+        std::vector<std::string> types, sources, descriptions;
+        for (int i = 0; i < 4096; ++i) {
+            types.push_back("Type" + std::to_string((i * 7919) % 2000));
+            sources.push_back(i % 3 ? "host-" + std::to_string(i) : "svc-" + std::to_string(i));
+            descriptions.push_back(i % 50 ? "routine event " + std::to_string(i) : "matched indicator-" + std::to_string((i / 50 % 50) * 20));
+        }
+        
+        const int events = 2000000;
+        std::atomic<bool> reloading(true);
+        std::atomic<int> reloads(0);
+        std::thread reloader([&] {
+            // Hot reloads alternate between two rule sets while events flow
+            while (reloading) {
+                bench.LoadRulesFromString(makeRules(1000, reloads % 2 ? "" : "-b"));
+                reloads++;
+                std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            }
+        });
+        std::vector<RuleEngine::Match> benchMatches;
+        uint64_t matched = 0;
+        auto start = std::chrono::high_resolution_clock::now();
+        for (int i = 0; i < events; ++i) {
+            RuleEngine::Event event;
+            event.timestamp = at(i / 1000);
+            event.strings[RuleEngine::Stream] = "security";
+            event.strings[RuleEngine::Type] = types[i & 4095];
+            event.strings[RuleEngine::Source] = sources[(i >> 3) & 4095];
+            event.strings[RuleEngine::Description] = descriptions[i & 4095];
+            event.numbers[RuleEngine::Severity] = 1 + i % 5;
+            benchMatches.clear();
+            bench.Evaluate(event, benchMatches);
+            matched += benchMatches.size();
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+        reloading = false;
+        reloader.join();
+        
+        auto stats = bench.GetStatistics();
+        bool benchOk = stats.events == static_cast<uint64_t>(events) && matched > 0 && stats.rules == 1000;
+        std::cout << (benchOk ? "✅" : "❌") << " All " << stats.events << " events evaluated across "
+                  << reloads << " hot reloads (" << matched << " matches, " << stats.predicates << " shared predicates)" << std::endl;
+        std::cout << "⚡ Throughput with 1,000 rules: " << events / std::chrono::duration<double>(end - start).count()
+                  << " events/sec (" << static_cast<double>(stats.rulesEvaluated) / events << " candidate rules, "
+                  << static_cast<double>(stats.predicateEvaluations) / events << " predicate evaluations per event)" << std::endl;
+    }
+    
+    // Test 15: Multi-pattern IOC Matching
+    std::cout << "\n15. Multi-pattern IOC Matching" << std::endl;
+    std::cout << "------------------------------" << std::endl;
+    
+    {
+        IocMatcher small;
+        uint32_t he = small.AddPattern("he"), she = small.AddPattern("she");
+        uint32_t his = small.AddPattern("his"), hers = small.AddPattern("HERS");
+        small.AddPattern("x");
+        small.Compile();
+        std::vector<IocMatcher::Match> found;
+        small.Scan("uSHers and his", found);
+        auto has = [&found](uint32_t id, size_t start) {
+            return std::any_of(found.begin(), found.end(), [&](const IocMatcher::Match& m) { return m.patternId == id && m.start == start; });
+        };
+        bool ok = found.size() == 4 && has(she, 1) && has(he, 2) && has(hers, 2) && has(his, 11) &&
+                  small.Contains("box") && !small.Contains("nothing to see");
+        std::cout << (ok ? "✅" : "❌") << " Overlapping, case-insensitive matches (" << found.size()
+                  << " found, prefilter: " << IocMatcher::GetPrefilterName() << ")" << std::endl;
+        
+        // 20,000 synthetic indicators: tool names, paths and domains
+        IocMatcher iocs;
+        std::mt19937 rng(42);
+        auto word = [&rng](size_t length) {
+            std::string text;
+            for (size_t i = 0; i < length; ++i) text += static_cast<char>('a' + rng() % 26);
+            return text;
+        };
+        std::vector<std::string> planted;
+        for (int i = 0; i < 20000; ++i) {
+            std::string pattern = i % 3 == 0 ? word(6 + rng() % 8) + ".exe"
+                                : i % 3 == 1 ? "/tmp/." + word(8 + rng() % 8)
+                                             : word(8 + rng() % 10) + ".example.net";
+            iocs.AddPattern(pattern);
+            if (i % 2000 == 0) planted.push_back(pattern);
+        }
+        iocs.Compile();
+        
+        // Log-like text: mostly numbers and punctuation, with a few planted indicators
+        std::string line = "2024-05-01T12:00:00Z 10.0.0.1 GET 200 1532 0.004 - 9f86d081884c7d659a2feaa0c55ad015 |";
+        std::string corpus;
+        const size_t corpusSize = 64 * 1024 * 1024;
+        corpus.reserve(corpusSize + 4096);
+        size_t plantedCount = 0;
+        while (corpus.size() < corpusSize) {
+            corpus += line;
+            if (corpus.size() % 1000003 < line.size()) {
+                corpus += " " + planted[plantedCount++ % planted.size()] + " ";
+            }
+        }
+        
+        const int passes = 4;
+        std::vector<IocMatcher::Match> matches;
+        auto start = std::chrono::high_resolution_clock::now();
+        for (int pass = 0; pass < passes; ++pass) {
+            matches.clear();
+            iocs.Scan(corpus, matches);
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+        double seconds = std::chrono::duration<double>(end - start).count();
+        std::cout << (matches.size() >= plantedCount ? "✅" : "❌") << " " << iocs.GetPatternCount() << " indicators in "
+                  << iocs.GetStateCount() << " states found " << matches.size() << " matches (" << plantedCount
+                  << " planted)" << std::endl;
+        std::cout << "⚡ Scan: " << static_cast<double>(corpus.size()) * passes / seconds / 1e9 << " GB/s" << std::endl;
+        
+        ThreatProtection protection;
+        protection.SetIndicators(std::make_shared<IocMatcher>(std::move(iocs)));
+        SecurityMonitor::SecurityEvent event{std::chrono::system_clock::now(), "Process", "host-7",
+                                             "spawned " + planted[0] + " from shell", 3};
+        protection.InspectEvent(RuleEngine::FromSecurityEvent(event));
+        auto threats = protection.GetThreatsByType("IOC Match");
+        std::cout << (threats.size() == 1 && threats[0].source == "host-7" ? "✅" : "❌")
+                  << " ThreatProtection raised: " << (threats.empty() ? "nothing" : threats[0].description) << std::endl;
+        
+        // Repeats refresh the active threat; after mitigation the next sighting is new
+        for (int i = 0; i < 1000; ++i) {
+            event.timestamp += std::chrono::seconds(1);
+            protection.InspectEvent(RuleEngine::FromSecurityEvent(event));
+        }
+        threats = protection.GetThreatsByType("IOC Match");
+        bool folded = threats.size() == 1 && threats[0].occurrences == 1001 && threats[0].lastSeen == event.timestamp;
+        protection.MitigateThreat(threats.empty() ? "" : threats[0].id);
+        protection.InspectEvent(RuleEngine::FromSecurityEvent(event));
+        auto reraised = protection.GetThreatsByType("IOC Match");
+        std::cout << (folded && reraised.size() == 1 && reraised[0].occurrences == 1 ? "✅" : "❌")
+                  << " 1001 sightings folded into one threat; raised again after mitigation" << std::endl;
+        
+        // 70000 sources keep their threats active; dedup state stays capped and each match stays cheap
+        auto floodStart = std::chrono::high_resolution_clock::now();
+        for (int i = 0; i < 70000; ++i) {
+            event.source = "flood-" + std::to_string(i);
+            protection.InspectEvent(RuleEngine::FromSecurityEvent(event));
+        }
+        auto floodEnd = std::chrono::high_resolution_clock::now();
+        event.source = "flood-69999";
+        protection.InspectEvent(RuleEngine::FromSecurityEvent(event));
+        event.source = "flood-0";
+        protection.InspectEvent(RuleEngine::FromSecurityEvent(event));
+        auto flooded = protection.GetThreatsByType("IOC Match");
+        double perMatchUs = std::chrono::duration<double, std::micro>(floodEnd - floodStart).count() / 70000;
+        std::cout << (flooded.size() == 70002 && perMatchUs < 200 ? "✅" : "❌") << " " << flooded.size()
+                  << " active IOC threats past the dedup cap: newest source folded, oldest forgotten; "
+                  << perMatchUs << " us per new match" << std::endl;
+    }
+    
+    // Test 16: Signature File Scanning
+    std::cout << "\n16. Signature File Scanning" << std::endl;
+    std::cout << "---------------------------" << std::endl;
+    
+    {
+        namespace fs = std::filesystem;
+        fs::path root = fs::temp_directory_path() / "sentinel_signature_test";
+        fs::remove_all(root);
+        fs::create_directories(root / "nested" / "deeper");
+        
+        std::string rules = R"(
+            private rule IsPE { condition: uint16(0) == 0x5A4D }
+            rule Dropper : loader {
+                meta: severity = "critical" description = "Test dropper"
+                strings:
+                    $stub = { 4D 5A 90 00 [4-8] 50 45 00 00 }
+                    $url = "http://c2.example.test/" nocase
+                    $cmd = "powershell -enc" nocase wide ascii
+                condition: IsPE and $stub at 0 and ($url or $cmd)
+            }
+            rule Miner { strings: $a = "stratum+tcp://" $b = "xmrig" fullword condition: all of them and #b >= 2 }
+            rule NotHere { strings: $z = { DE AD ?? EF } condition: $z }
+        )";
+        for (int i = 0; i < 40; ++i) {
+            char noise[160];
+            std::snprintf(noise, sizeof(noise), "rule Noise%d { strings: $n = \"noise-marker-%d-unused\" "
+                          "$h = { 0F %02X ?? 7? FE } condition: $n or #h > 1000 }\n", i, i, i);
+            rules += noise;
+        }
+        SignatureScanner::Options options;
+        options.maxFileSize = 8 * 1024 * 1024;
+        SignatureScanner scanner(options);
+        bool loaded = scanner.LoadRulesFromString(rules);
+        
+        // 256 files of pseudo-random binary, three planted samples and one file over the cap
+        std::mt19937 rng(7);
+        std::string block(1024 * 1024, '\0');
+        for (auto& c : block) c = static_cast<char>(rng());
+        for (int i = 0; i < 256; ++i) {
+            fs::path dir = i % 3 == 0 ? root : i % 3 == 1 ? root / "nested" : root / "nested" / "deeper";
+            std::ofstream(dir / ("blob" + std::to_string(i) + ".bin"), std::ios::binary)
+                .write(block.data() + (i * 4099) % 4096, static_cast<std::streamsize>(block.size() - 4096));
+        }
+        std::string dropper("MZ\x90\x00\x01\x02\x03\x04\x05PE\x00\x00", 14);
+        dropper += std::string(2048, 'A') + "GET HTTP://C2.Example.Test/payload";
+        std::ofstream(root / "nested" / "dropper.exe", std::ios::binary) << dropper;
+        std::string wide = "MZ" + std::string("\x90\x00\x00\x00\x00\x00PE\x00\x00", 11) + "run ";
+        for (char c : std::string("PowerShell -ENC")) { wide += c; wide += '\0'; }
+        std::ofstream(root / "nested" / "deeper" / "wide.dll", std::ios::binary) << wide;
+        std::ofstream(root / "miner.sh") << "./xmrig -o stratum+tcp://pool:3333 # xmrig-notme xmrig\n";
+        std::ofstream huge(root / "huge.bin", std::ios::binary);
+        for (int i = 0; i < 9; ++i) huge.write(block.data(), static_cast<std::streamsize>(block.size()));
+        huge.close();
+        
+        SignatureScanner::Statistics stats;
+        auto results = scanner.ScanPaths({root.string()}, &stats);
+        std::set<std::string> hits;
+        for (const auto& result : results) {
+            if (result.status == JsonReporting::Status::FAIL && result.details.count("path")) {
+                hits.insert(result.details.at("rule") + ":" + fs::path(result.details.at("path")).filename().string());
+            }
+        }
+        bool ok = loaded && hits.size() == 3 && hits.count("Dropper:dropper.exe") && hits.count("Dropper:wide.dll") &&
+                  hits.count("Miner:miner.sh") && stats.filesSkipped == 1 && stats.filesScanned == 259;
+        std::cout << (ok ? "✅" : "❌") << " " << scanner.GetRuleCount() << " rules (" << scanner.GetStringCount()
+                  << " strings) matched " << hits.size() << " samples; " << stats.filesSkipped
+                  << " file over the size cap skipped" << std::endl;
+        
+        std::string summary;
+        for (const auto& result : results) {
+            if (result.checkId == "SIGNATURE_SCAN") summary = result.details.at("throughput_mb_s") + " MB/s on " + result.details.at("threads") + " threads";
+        }
+        std::cout << "⚡ Scan: " << stats.bytesScanned / (1024 * 1024) << " MB in " << stats.elapsedSeconds * 1000
+                  << " ms, " << summary << std::endl;
+        
+        SignatureScanner broken;
+        bool rejected = !broken.LoadRulesFromString("rule r { strings: $a = /evil/ condition: $a }") &&
+                        !broken.LoadRulesFromString("rule r { strings: $a = { ?? ?? } condition: $a }") &&
+                        !broken.LoadRulesFromString("rule r { condition: $missing }");
+        std::cout << (rejected ? "✅" : "❌") << " Unsupported syntax rejected: " << broken.GetLastError() << std::endl;
+        
+        // Each start counts once, past the stored-offset cap and whichever atom found it
+        SignatureScanner counter;
+        counter.LoadRulesFromString("rule Many { strings: $a = { 41 41 [0-1] 42 42 42 } condition: #a == 5000 }\n"
+                                    "rule Nested { strings: $n = { 41 [0-200] 41 [0-200] 41 [0-200] 43 } condition: $n }");
+        std::string repeated;
+        for (int i = 0; i < 5000; ++i) repeated += "AABBBB";
+        std::vector<SignatureScanner::RuleMatch> counted;
+        counter.ScanBuffer(repeated, counted);
+        std::string flat(256 * 1024, 'A');
+        std::vector<SignatureScanner::RuleMatch> nested;
+        auto nestedStart = std::chrono::high_resolution_clock::now();
+        counter.ScanBuffer(flat, nested);
+        auto nestedMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::high_resolution_clock::now() - nestedStart).count();
+        std::cout << (counted.size() == 1 && counted[0].rule == "Many" && nested.empty() && nestedMs < 5000 ? "✅" : "❌")
+                  << " 5000 overlapping starts counted once each; nested jumps over 256 KB gave up in "
+                  << nestedMs << " ms" << std::endl;
+        
+        ThreatProtection protection;
+        std::ofstream(root / "rules.yar") << rules;
+        protection.LoadSignatures((root / "rules.yar").string());
+        protection.ScanFiles({(root / "nested").string()});
+        auto threats = protection.GetThreatsByType("Malware Signature");
+        std::cout << (threats.size() == 2 && threats[0].severity == 5 ? "✅" : "❌") << " ThreatProtection raised "
+                  << threats.size() << " signature threats" << std::endl;
+        fs::remove_all(root);
+    }
+    
+    // Test 17: Cross-source Correlation
+    std::cout << "\n17. Cross-source Correlation" << std::endl;
+    std::cout << "----------------------------" << std::endl;
+    
+    {
+        auto base = std::chrono::system_clock::now();
+        auto processStart = [](std::chrono::system_clock::time_point at, int pid) {
+            SecurityMonitor::SecurityEvent event{at, "PROCESS", "pid " + std::to_string(pid) + " (curl)", "Process started", 2};
+            return CorrelationEngine::FromSecurityEvent(event);
+        };
+        auto connection = [](std::chrono::system_clock::time_point at, int pid, const std::string& ip) {
+            NetworkMonitor::NetworkConnection conn{"10.0.0.5", ip, 40000, 443, "TCP", "ESTABLISHED", "curl", pid, 1, "", 0, "", at};
+            return CorrelationEngine::FromConnection(conn);
+        };
+        auto fileChange = [](std::chrono::system_clock::time_point at, int pid, const std::string& path) {
+            CorrelationEngine::Event event = CorrelationEngine::FromFileChange(path, "modified", pid);
+            event.timestamp = at;
+            return event;
+        };
+        
+        CorrelationEngine engine;
+        engine.AddDefaultRules();
+        std::vector<ThreatProtection::ThreatInfo> found;
+        // A busy address is not rare: pid 200 talks to it like everyone else
+        for (int i = 0; i < 10; ++i) engine.Process(connection(base, 100 + i, "198.51.100.1"), found);
+        engine.Process(processStart(base, 4242), found);
+        engine.Process(processStart(base, 200), found);
+        engine.Process(connection(base + std::chrono::seconds(3), 4242, "203.0.113.77"), found);
+        engine.Process(connection(base + std::chrono::seconds(3), 200, "198.51.100.1"), found);
+        engine.Process(fileChange(base + std::chrono::seconds(5), 200, "/etc/crontab"), found);
+        engine.Process(fileChange(base + std::chrono::seconds(8), 4242, "/etc/ld.so.preload"), found);
+        // Too slow: the config change lands after the 30s window
+        engine.Process(processStart(base + std::chrono::seconds(10), 777), found);
+        engine.Process(connection(base + std::chrono::seconds(12), 777, "192.0.2.9"), found);
+        engine.Process(fileChange(base + std::chrono::seconds(45), 777, "/etc/passwd"), found);
+        bool ok = found.size() == 1 && found[0].source == "pid 4242" && found[0].evidence.size() == 3 &&
+                  found[0].evidence[2].find("/etc/ld.so.preload") != std::string::npos;
+        std::cout << (ok ? "✅" : "❌") << " Process -> rare connection -> config change joined on pid: "
+                  << (found.empty() ? "nothing" : found[0].description) << std::endl;
+        for (const auto& evidence : ok ? found[0].evidence : std::vector<std::string>()) {
+            std::cout << "     " << evidence << std::endl;
+        }
+        
+        // One million unrelated events: state must stay within the caps
+        CorrelationEngine::Options options;
+        options.maxPartialMatches = 5000;
+        options.maxMemoryBytes = 8 * 1024 * 1024;
+        CorrelationEngine bounded(options);
+        CorrelationEngine::Rule pair;
+        pair.id = "ip-pair";
+        pair.key = CorrelationEngine::Event::Ip;
+        pair.window = std::chrono::seconds(60);
+        pair.ordered = false;
+        pair.steps = {CorrelationEngine::Step("network", "LOG", "Port Scan"), CorrelationEngine::Step("security", "LOGIN")};
+        bounded.AddRule(pair);
+        bounded.AddDefaultRules();
+        std::mt19937 rng(11);
+        std::vector<CorrelationEngine::Event> stream;
+        for (int i = 0; i < 1000; ++i) {
+            auto at = base + std::chrono::milliseconds(i);
+            stream.push_back(i % 2 ? processStart(at, 1000 + static_cast<int>(rng() % 100000))
+                                   : connection(at, 1000 + static_cast<int>(rng() % 100000),
+                                                "10." + std::to_string(rng() % 256) + ".0." + std::to_string(rng() % 256)));
+        }
+        size_t peakMemory = 0, peakActive = 0, threatsRaised = 0;
+        const int events = 1000000;
+        auto start = std::chrono::high_resolution_clock::now();
+        for (int i = 0; i < events; ++i) {
+            CorrelationEngine::Event& event = stream[i % stream.size()];
+            event.timestamp = base + std::chrono::milliseconds(i);
+            event.keys[CorrelationEngine::Event::Pid] = std::to_string(1000 + rng() % 200000);
+            found.clear();
+            bounded.Process(event, found);
+            threatsRaised += found.size();
+            if (i % 4096 == 0) {
+                auto stats = bounded.GetStatistics();
+                peakMemory = std::max(peakMemory, stats.memoryBytes);
+                peakActive = std::max(peakActive, stats.active);
+            }
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+        bounded.Expire(base + std::chrono::milliseconds(events) + std::chrono::minutes(2));
+        auto stats = bounded.GetStatistics();
+        bool boundedOk = peakActive <= options.maxPartialMatches && peakMemory <= options.maxMemoryBytes &&
+                         stats.evicted > 0 && stats.expired > 0 && stats.active == 0 && stats.memoryBytes == 0;
+        std::cout << (boundedOk ? "✅" : "❌") << " State bounded: peak " << peakActive << " partial matches, "
+                  << peakMemory / 1024 << " KB (" << stats.expired << " expired, " << stats.evicted << " evicted)" << std::endl;
+        std::cout << "⚡ Correlation: " << events / std::chrono::duration<double>(end - start).count()
+                  << " events/sec" << std::endl;
+        
+        ThreatProtection protection;
+        protection.CorrelateEvent(processStart(base, 31337));
+        protection.CorrelateEvent(connection(base + std::chrono::seconds(1), 31337, "203.0.113.200"));
+        protection.CorrelateEvent(fileChange(base + std::chrono::seconds(2), 31337, "/etc/sudoers"));
+        auto threats = protection.GetThreatsBySource("pid 31337");
+        std::cout << (threats.size() == 1 && threats[0].severity == 5 && threats[0].evidence.size() == 3 ? "✅" : "❌")
+                  << " ThreatProtection raised " << (threats.empty() ? "nothing" : threats[0].type) << " with evidence" << std::endl;
+    }
+
+#ifdef __linux__
+    {
+        // The same chain from the live producers: SecurityMonitor's process scan, NetworkMonitor's
+        // connection table and the integrity watcher, wired as SecurityApp wires them
+        namespace fs = std::filesystem;
+        fs::path dir = fs::temp_directory_path() / ("correlation_live_" + std::to_string(getpid()));
+        fs::create_directories(dir);
+        std::string config = (dir / "app.conf").string();
+        std::ofstream(config) << "listen = 127.0.0.1\n";
+        IntegritySystem::ClearFilesToCheck();
+        IntegritySystem::AddFileToCheck(config);
+
+        int listener = socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t length = sizeof(address);
+        bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address));
+        listen(listener, 4);
+        getsockname(listener, reinterpret_cast<sockaddr*>(&address), &length);
+
+        // The default rule with the temp directory standing in for /etc/
+        ThreatProtection protection;
+        CorrelationEngine::Rule rule;
+        rule.id = "live-process-beacon-config";
+        rule.description = "New process connected to a rare address and modified configuration";
+        rule.severity = 5;
+        rule.key = CorrelationEngine::Event::Pid;
+        rule.window = std::chrono::seconds(30);
+        rule.steps = {CorrelationEngine::Step("security", "PROCESS"), CorrelationEngine::Step("network", "CONNECTION", "", true),
+                      CorrelationEngine::Step("file", "", dir.string())};
+        protection.GetCorrelationEngine().AddRule(rule);
+
+        SecurityMonitor security;
+        security.SetEventCallback([&protection](const SecurityMonitor::SecurityEvent& event) {
+            protection.CorrelateEvent(CorrelationEngine::FromSecurityEvent(event));
+        });
+        NetworkMonitor network;
+        network.SetConnectionCallback([&protection](const NetworkMonitor::NetworkConnection& conn) {
+            protection.CorrelateEvent(CorrelationEngine::FromConnection(conn));
+        });
+        IntegrityWatcher::Options watchOptions;
+        watchOptions.debounce = std::chrono::milliseconds(100);
+        watchOptions.sweepInterval = std::chrono::minutes(0);
+        IntegrityWatcher watcher(watchOptions);
+        watcher.SetChangeCallback([&protection](const IntegritySystem::FileInfo& file, const std::string& change, int pid) {
+            protection.CorrelateEvent(
+                CorrelationEngine::FromFileChange(file.path, file.isValid ? change : "INTEGRITY_MISMATCH", pid));
+        });
+        security.StartMonitoring();
+        network.StartMonitoring();
+        watcher.Start();
+        std::this_thread::sleep_for(std::chrono::milliseconds(500));
+
+        // Outlive one process scan, hold a connection across a connection scan, then edit the config
+        pid_t child = fork();
+        if (child == 0) {
+            sleep(6);
+            int client = socket(AF_INET, SOCK_STREAM, 0);
+            connect(client, reinterpret_cast<sockaddr*>(&address), sizeof(address));
+            sleep(6);
+            int fd = open(config.c_str(), O_WRONLY | O_APPEND);
+            (void)!write(fd, "debug = 1\n", 10);
+            close(fd);
+            close(client);
+            _exit(0);
+        }
+        waitpid(child, nullptr, 0);
+        std::vector<ThreatProtection::ThreatInfo> threats;
+        for (int i = 0; i < 30 && threats.empty(); ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            threats = protection.GetThreatsBySource("pid " + std::to_string(child));
+        }
+        watcher.Stop();
+        network.StopMonitoring();
+        security.StopMonitoring();
+        close(listener);
+
+        if (geteuid() != 0) {
+            std::cout << "⚠️  Not root: file writers are not attributed, live correlation skipped" << std::endl;
+        } else {
+            std::cout << (threats.size() == 1 && threats[0].evidence.size() == 3 ? "✅" : "❌")
+                      << " Live producers joined on pid " << child << ": "
+                      << (threats.empty() ? "nothing" : threats[0].description) << std::endl;
+        }
+        IntegritySystem::ClearFilesToCheck();
+        fs::remove_all(dir);
+    }
+#endif
+    
+    // Test 18: Resource Governor
+    std::cout << "\n18. Resource Governor" << std::endl;
+    std::cout << "---------------------" << std::endl;
+    
+    {
+        auto& governor = ResourceGovernor::Instance();
+        auto low = ResourceGovernor::GetBudgetForLevel(1);
+        auto maximum = ResourceGovernor::GetBudgetForLevel(4);
+        ThreatProtection protection;
+        protection.SetProtectionLevel(ThreatProtection::ProtectionLevel::Low);
+        bool levelOk = governor.GetLevel() == 1 && governor.GetBudget().cpuPercent == low.cpuPercent &&
+                       low.cpuPercent > 0 && low.ioBytesPerSecond > 0 &&
+                       maximum.cpuPercent == 0 && maximum.ioBytesPerSecond == 0;
+        std::cout << (levelOk ? "✅" : "❌") << " Protection level Low -> " << low.cpuPercent << "% CPU, "
+                  << (low.ioBytesPerSecond >> 20) << " MB/s I/O; Maximum is unthrottled" << std::endl;
+        
+        // Foreground threads are never throttled
+        auto start = std::chrono::steady_clock::now();
+        governor.ChargeIo(1ULL << 30, "test");
+        double foreground = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cout << (foreground < 0.1 ? "✅" : "❌") << " Foreground work unthrottled (" << foreground << "s)" << std::endl;
+        
+        std::vector<ResourceGovernor::Deferral> reports;
+        std::mutex reportsMutex;
+        governor.SetDeferralCallback([&](const ResourceGovernor::Deferral& deferral) {
+            std::lock_guard<std::mutex> lock(reportsMutex);
+            reports.push_back(deferral);
+        });
+        
+        // 64 MB at 32 MB/s: one second of burst, then a second of waiting
+        governor.SetBudget(ResourceGovernor::Budget(25, 32ULL << 20));
+        bool idle = false;
+        double ioSeconds = 0, cpuSeconds = 0, cpuWall = 0;
+        std::thread background([&]() {
+            ResourceGovernor::EnterBackgroundMode();
+#ifdef __linux__
+            idle = sched_getscheduler(0) == SCHED_IDLE;
+#endif
+            auto ioStart = std::chrono::steady_clock::now();
+            for (int i = 0; i < 64; ++i) {
+                governor.ChargeIo(1 << 20, "test io");
+            }
+            ioSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - ioStart).count();
+            
+            // 0.4s of CPU at 25%: 0.25s of burst, then 0.6s of throttled wall time
+            auto cpuStart = std::chrono::steady_clock::now();
+            clock_t cpuBegin = clock();
+            volatile uint64_t sink = 0;
+            while (static_cast<double>(clock() - cpuBegin) / CLOCKS_PER_SEC < 0.4) {
+                for (int i = 0; i < 100000; ++i) sink = sink + i;
+                governor.ChargeCpu("test cpu");
+            }
+            cpuSeconds = static_cast<double>(clock() - cpuBegin) / CLOCKS_PER_SEC;
+            cpuWall = std::chrono::duration<double>(std::chrono::steady_clock::now() - cpuStart).count();
+        });
+        background.join();
+        std::cout << (idle ? "✅" : "⚠️") << " Background thread runs at SCHED_IDLE" << std::endl;
+        std::cout << (ioSeconds > 0.9 && ioSeconds < 1.5 ? "✅" : "❌") << " I/O held to budget: 64 MB in "
+                  << ioSeconds << "s at 32 MB/s" << std::endl;
+        std::cout << (cpuWall > 0.5 ? "✅" : "❌") << " CPU held to budget: " << cpuSeconds << "s CPU over "
+                  << cpuWall << "s wall at 25%" << std::endl;
+        
+        // A governed signature sweep over 48 MB at 16 MB/s
+        std::string dir = TempPath("governor_scan");
+        std::filesystem::create_directories(dir);
+        std::string block(8 << 20, 'x');
+        for (int i = 0; i < 6; ++i) {
+            std::ofstream(dir + "/f" + std::to_string(i), std::ios::binary) << block;
+        }
+        SignatureScanner scanner;
+        scanner.LoadRulesFromString("rule never { strings: $a = \"not-present-here\" condition: $a }");
+        governor.SetBudget(ResourceGovernor::Budget(0, 16ULL << 20));
+        SignatureScanner::Statistics scanStats{};
+        std::thread sweep([&]() {
+            ResourceGovernor::EnterBackgroundMode();
+            scanner.ScanPaths({dir}, &scanStats);
+        });
+        sweep.join();
+        std::filesystem::remove_all(dir);
+        std::cout << (scanStats.megabytesPerSecond < 30 && scanStats.bytesScanned == (48ULL << 20) ? "✅" : "❌")
+                  << " Governed scan: " << scanStats.megabytesPerSecond << " MB/s" << std::endl;
+        
+        auto stats = governor.GetStatistics();
+        std::set<std::string> resources;
+        {
+            std::lock_guard<std::mutex> lock(reportsMutex);
+            for (const auto& report : reports) resources.insert(report.resource);
+        }
+        std::cout << (stats.deferrals > 0 && !resources.empty() ? "✅" : "❌") << " Deferrals reported: "
+                  << stats.deferrals << " deferrals, " << stats.deferredSeconds << "s waiting, "
+                  << reports.size() << " report(s)" << std::endl;
+        governor.SetDeferralCallback(nullptr);
+        protection.SetProtectionLevel(ThreatProtection::ProtectionLevel::Medium);
+    }
+    
+    // Test 19: Per-entity Risk Scoring
+    std::cout << "\n19. Per-entity Risk Scoring" << std::endl;
+    std::cout << "---------------------------" << std::endl;
+    
+    {
+        using Kind = RiskScorer::EntityKind;
+        auto base = std::chrono::system_clock::now();
+        RiskScorer::Options options;
+        options.halfLifeSeconds = 60;
+        options.host = "db01";
+        RiskScorer scorer(options);
+        scorer.Add(Kind::Ip, "203.0.113.5", 16, base);
+        double halfLife = scorer.GetScore(Kind::Ip, "203.0.113.5", base + std::chrono::seconds(60));
+        double tenLives = scorer.GetScore(Kind::Ip, "203.0.113.5", base + std::chrono::seconds(600));
+        std::cout << (std::abs(halfLife - 8) < 1e-6 && tenLives < 0.02 ? "✅" : "❌")
+                  << " Exponential decay: 16 -> " << halfLife << " after one half life" << std::endl;
+        
+        // A burst of critical events outranks a steady trickle of minor ones
+        CorrelationEngine::Event event;
+        for (int i = 0; i < 30; ++i) {
+            event.timestamp = base + std::chrono::seconds(i * 10);
+            event.type = "LOG";
+            event.severity = 2;
+            event.keys[CorrelationEngine::Event::Ip] = "198.51.100.7";
+            event.keys[CorrelationEngine::Event::User] = "";
+            scorer.Observe(event);
+        }
+        for (int i = 0; i < 3; ++i) {
+            event.timestamp = base + std::chrono::seconds(290);
+            event.type = "LOGIN";
+            event.severity = 5;
+            event.keys[CorrelationEngine::Event::Ip] = "192.0.2.66";
+            event.keys[CorrelationEngine::Event::User] = "postgres";
+            scorer.Observe(event);
+        }
+        auto top = scorer.GetTop(4, base + std::chrono::seconds(300));
+        bool rankOk = top.size() == 4 && top[0].kind == Kind::Host && top[0].id == "db01" &&
+                      std::set<std::string>{top[1].id, top[2].id} == std::set<std::string>{"192.0.2.66", "postgres"} &&
+                      top[3].id == "198.51.100.7";
+        std::cout << (rankOk ? "✅" : "❌") << " Ranking:";
+        for (const auto& entity : top) {
+            std::cout << " " << RiskScorer::KindName(entity.kind) << ":" << entity.id << "=" << entity.score;
+        }
+        std::cout << std::endl;
+        
+        // Heap and hash table against a brute-force recomputation, across rebasing
+        RiskScorer exact(options);
+        std::map<std::pair<int, std::string>, double> reference;
+        std::vector<std::pair<std::chrono::system_clock::time_point, std::pair<std::pair<int, std::string>, double>>> added;
+        std::mt19937 rng(3);
+        double lambda = std::log(2.0) / options.halfLifeSeconds;
+        auto when = base;
+        for (int i = 0; i < 20000; ++i) {
+            when += std::chrono::milliseconds(rng() % 5000);
+            Kind kind = static_cast<Kind>(rng() % 4);
+            std::string id = "e" + std::to_string(rng() % 500);
+            double weight = 1 + rng() % 16;
+            exact.Add(kind, id, weight, when);
+            added.push_back({when, {{static_cast<int>(kind), id}, weight}});
+        }
+        for (const auto& entry : added) {
+            reference[entry.second.first] += entry.second.second *
+                std::exp(-lambda * std::chrono::duration<double>(when - entry.first).count());
+        }
+        std::vector<double> expected;
+        for (const auto& entry : reference) expected.push_back(entry.second);
+        std::sort(expected.rbegin(), expected.rend());
+        auto exactTop = exact.GetTop(20, when);
+        bool exactOk = exactTop.size() == 20;
+        for (size_t i = 0; exactOk && i < exactTop.size(); ++i) {
+            exactOk = std::abs(exactTop[i].score - expected[i]) <= 1e-6 * expected[i];
+        }
+        std::cout << (exactOk ? "✅" : "❌") << " Top-20 matches brute force over " << reference.size()
+                  << " entities and " << std::chrono::duration_cast<std::chrono::hours>(when - base).count()
+                  << "h of events" << std::endl;
+        
+        // One million events over 200k entities in a 20k-entry table
+        options.maxEntities = 20000;
+        RiskScorer bounded(options);
+        std::vector<CorrelationEngine::Event> events(4096);
+        for (auto& e : events) {
+            e.type = rng() % 4 ? "CONNECTION" : "LOG";
+            e.severity = 2 + rng() % 3;
+            e.keys[CorrelationEngine::Event::Ip] = "10.0." + std::to_string(rng() % 256) + "." + std::to_string(rng() % 256);
+        }
+        const int total = 1000000;
+        auto start = std::chrono::high_resolution_clock::now();
+        for (int i = 0; i < total; ++i) {
+            CorrelationEngine::Event& e = events[i % events.size()];
+            e.timestamp = base + std::chrono::milliseconds(i);
+            e.keys[CorrelationEngine::Event::Pid] = std::to_string(rng() % 100000);
+            if (i % 100 == 0) {
+                e.keys[CorrelationEngine::Event::Ip] = "203.0.113." + std::to_string(i % 3);   // Heavy hitters
+            }
+            bounded.Observe(e);
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+        auto queryStart = std::chrono::high_resolution_clock::now();
+        auto riskiest = bounded.GetTop(10, base + std::chrono::milliseconds(total));
+        auto queryEnd = std::chrono::high_resolution_clock::now();
+        auto stats = bounded.GetStatistics();
+        std::set<std::string> heavy;
+        for (const auto& entity : riskiest) {
+            if (entity.id.compare(0, 10, "203.0.113.") == 0) heavy.insert(entity.id);
+        }
+        std::cout << (stats.entities <= options.maxEntities && stats.evicted > 0 && heavy.size() == 3 ? "✅" : "❌")
+                  << " Bounded table: " << stats.entities << " entities, " << stats.memoryBytes / 1024 << " KB, "
+                  << stats.evicted << " evicted; heavy hitters kept" << std::endl;
+        std::cout << "⚡ Risk scoring: " << total / std::chrono::duration<double>(end - start).count()
+                  << " events/sec, top-10 in "
+                  << std::chrono::duration<double, std::micro>(queryEnd - queryStart).count() << " us" << std::endl;
+        
+        SecurityMonitor securityMonitor;
+        std::cout << (securityMonitor.GetThreatLevel() == 1 ? "✅" : "❌") << " SecurityMonitor level from host risk: "
+                  << securityMonitor.GetThreatLevel() << " (" << securityMonitor.GetRiskScorer().GetHost() << ")" << std::endl;
+    }
+    
+    // Test 20: SHA-256 File Hashing
+    std::cout << "\n20. SHA-256 File Hashing" << std::endl;
+    std::cout << "------------------------" << std::endl;
+    
+    {
+        const Sha256::Implementation implementations[] = {
+            Sha256::Implementation::Portable, Sha256::Implementation::Avx2, Sha256::Implementation::ShaNi};
+        Sha256::Implementation original = Sha256::GetImplementation();
+        std::string million(1000000, 'a');
+        std::string twoBlocks = "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq";
+        
+        for (auto implementation : implementations) {
+            if (!Sha256::SetImplementation(implementation)) {
+                std::cout << "⚠️  " << Sha256::GetImplementationName(implementation) << " not supported by this CPU" << std::endl;
+                continue;
+            }
+            bool vectorsOk = Sha256::Hash("", 0) == "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855" &&
+                             Sha256::Hash("abc", 3) == "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad" &&
+                             Sha256::Hash(twoBlocks.data(), twoBlocks.size()) ==
+                                 "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1" &&
+                             Sha256::Hash(million.data(), million.size()) ==
+                                 "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0";
+            
+            // Streaming in odd-sized pieces and eight-way batches agree with one-shot hashing
+            std::mt19937 rng(17);
+            std::vector<std::string> messages;
+            for (int i = 0; i < 37; ++i) {
+                std::string message(rng() % 3000, '\0');
+                for (auto& c : message) c = static_cast<char>(rng());
+                messages.push_back(message);
+            }
+            std::vector<const uint8_t*> pointers;
+            std::vector<size_t> sizes;
+            for (const auto& message : messages) {
+                pointers.push_back(reinterpret_cast<const uint8_t*>(message.data()));
+                sizes.push_back(message.size());
+            }
+            std::vector<uint8_t[Sha256::DigestSize]> digests(messages.size());
+            Sha256::HashMany(pointers.data(), sizes.data(), messages.size(), digests.data());
+            for (size_t i = 0; vectorsOk && i < messages.size(); ++i) {
+                Sha256 streaming;
+                for (size_t offset = 0; offset < messages[i].size(); offset += 1 + i) {
+                    streaming.Update(messages[i].data() + offset, std::min(1 + i, messages[i].size() - offset));
+                }
+                std::string expected = Sha256::Hash(messages[i].data(), messages[i].size());
+                vectorsOk = streaming.HexDigest() == expected && Sha256::ToHex(digests[i]) == expected;
+            }
+            std::cout << (vectorsOk ? "✅" : "❌") << " " << Sha256::GetImplementationName(implementation)
+                      << ": FIPS 180-4 vectors, streaming and batched hashing agree" << std::endl;
+        }
+        
+        // Same digests as sha256sum (and the Go core's crypto/sha256) on real files
+        Sha256::SetImplementation(original);
+        std::string small = TempPath("sha_small.bin"), large = TempPath("sha_large.bin");
+        {
+            std::mt19937 rng(5);
+            std::string data(12345, '\0');
+            for (auto& c : data) c = static_cast<char>(rng());
+            std::ofstream(small, std::ios::binary) << data;
+            data.assign(24 * 1024 * 1024 + 7, '\0');
+            for (auto& c : data) c = static_cast<char>(rng());
+            std::ofstream(large, std::ios::binary) << data;
+        }
+        auto sha256sum = [](const std::string& path) {
+            std::string output;
+            if (FILE* pipe = popen(("sha256sum " + path + " 2>/dev/null").c_str(), "r")) {
+                char line[256];
+                if (fgets(line, sizeof(line), pipe)) output = std::string(line).substr(0, 64);
+                pclose(pipe);
+            }
+            return output;
+        };
+        std::string smallHash = IntegritySystem::CalculateFileHash(small);
+        std::string largeHash = IntegritySystem::CalculateFileHash(large);
+        std::string reference = sha256sum(large);
+        if (reference.empty()) {
+            std::cout << "⚠️  sha256sum unavailable, skipping file comparison" << std::endl;
+        } else {
+            std::cout << (smallHash == sha256sum(small) && largeHash == reference ? "✅" : "❌")
+                      << " CalculateFileHash matches sha256sum (read and mmap paths): " << largeHash.substr(0, 16) << "..." << std::endl;
+        }
+        std::cout << (IntegritySystem::CalculateFileHash(TempPath("does-not-exist.bin")).empty() ? "✅" : "❌")
+                  << " Missing file yields an empty hash" << std::endl;
+        std::remove(small.c_str());
+        
+        // Throughput: one 64 MB stream, and 4096 x 16 KB messages batched
+        std::string buffer(64 * 1024 * 1024, '\x5a');
+        std::vector<const uint8_t*> pointers(4096);
+        std::vector<size_t> sizes(4096, 16 * 1024);
+        for (size_t i = 0; i < pointers.size(); ++i) {
+            pointers[i] = reinterpret_cast<const uint8_t*>(buffer.data()) + i * 16 * 1024;
+        }
+        std::vector<uint8_t[Sha256::DigestSize]> digests(pointers.size());
+        for (auto implementation : implementations) {
+            if (!Sha256::SetImplementation(implementation)) continue;
+            auto start = std::chrono::high_resolution_clock::now();
+            Sha256::Hash(buffer.data(), buffer.size());
+            auto middle = std::chrono::high_resolution_clock::now();
+            Sha256::HashMany(pointers.data(), sizes.data(), pointers.size(), digests.data());
+            auto end = std::chrono::high_resolution_clock::now();
+            double gb = buffer.size() / 1e9;
+            std::cout << "⚡ " << Sha256::GetImplementationName(implementation) << ": "
+                      << gb / std::chrono::duration<double>(middle - start).count() << " GB/s single stream, "
+                      << gb / std::chrono::duration<double>(end - middle).count() << " GB/s batched" << std::endl;
+        }
+        Sha256::SetImplementation(original);
+        auto start = std::chrono::high_resolution_clock::now();
+        IntegritySystem::CalculateFileHash(large);
+        auto end = std::chrono::high_resolution_clock::now();
+        std::cout << "⚡ CalculateFileHash (" << Sha256::GetImplementationName(original) << ", cached 24 MB file): "
+                  << 24 * 1024 * 1024 / 1e9 / std::chrono::duration<double>(end - start).count() << " GB/s" << std::endl;
+        std::remove(large.c_str());
+    }
+    
+    // Test 21: Parallel Integrity Verification
+    std::cout << "\n21. Parallel Integrity Verification" << std::endl;
+    std::cout << "-----------------------------------" << std::endl;
+    
+    {
+        namespace fs = std::filesystem;
+        std::string dir = TempPath("integrity_pool");
+        fs::remove_all(dir);
+        fs::create_directories(dir);
+        std::mt19937 rng(21);
+        std::vector<std::string> paths;
+        std::string data;
+        for (int i = 0; i < 20000; ++i) {
+            size_t size = i % 1000 == 0 ? (1 << 20) + rng() % 4096 : rng() % 16384;
+            data.resize(size);
+            for (auto& c : data) c = static_cast<char>(rng());
+            paths.push_back(dir + "/f" + std::to_string(i));
+            std::ofstream(paths.back(), std::ios::binary) << data;
+        }
+        data.assign(72 * 1024 * 1024 + 3, '\0');
+        for (size_t i = 0; i < data.size(); i += 4096) data[i] = static_cast<char>(rng());
+        paths.push_back(dir + "/large");
+        std::ofstream(paths.back(), std::ios::binary) << data;
+        data.clear();
+        
+        IntegritySystem::ConfigureFingerprintCache("", 0);
+        IntegritySystem::ClearFilesToCheck();
+        for (const auto& path : paths) {
+            IntegritySystem::AddFileToCheck(path, IntegritySystem::CalculateFileHash(path));
+        }
+        IntegritySystem::AddFileToCheck(dir + "/missing", "00");
+        std::ofstream(paths[7], std::ios::binary | std::ios::app) << "tampered";
+        std::ofstream(paths.back(), std::ios::binary | std::ios::in) << "X";
+        
+        std::vector<IntegritySystem::VerifyProgress> updates;
+        auto start = std::chrono::high_resolution_clock::now();
+        auto report = IntegritySystem::PerformIntegrityCheck([&](const IntegritySystem::VerifyProgress& progress) {
+            updates.push_back(progress);
+        }, 4);
+        auto end = std::chrono::high_resolution_clock::now();
+        size_t valid = 0;
+        std::set<std::string> reported;
+        for (const auto& file : report.files) {
+            valid += file.isValid;
+            reported.insert(file.path);
+        }
+        bool ok = !report.overallValid && report.files.size() == paths.size() + 1 && reported.size() == paths.size() + 1 &&
+                  valid == paths.size() - 2 && report.errors.size() == 3;
+        std::cout << (ok ? "✅" : "❌") << " " << report.files.size() << " files verified: " << valid << " valid, "
+                  << report.errors.size() << " errors (modified small file, modified 72 MB file, missing file)" << std::endl;
+        bool progressOk = !updates.empty() && updates.back().filesDone == paths.size() + 1;
+        for (size_t i = 1; progressOk && i < updates.size(); ++i) {
+            progressOk = updates[i].filesDone >= updates[i - 1].filesDone && updates[i].bytesHashed >= updates[i - 1].bytesHashed;
+        }
+        std::cout << (progressOk ? "✅" : "❌") << " Progress reported " << updates.size() << " time(s), final "
+                  << (updates.empty() ? 0 : updates.back().bytesHashed >> 20) << " MB hashed" << std::endl;
+        double parallelSeconds = std::chrono::duration<double>(end - start).count();
+        
+        start = std::chrono::high_resolution_clock::now();
+        auto serial = IntegritySystem::PerformIntegrityCheck(nullptr, 1);
+        end = std::chrono::high_resolution_clock::now();
+        double serialSeconds = std::chrono::duration<double>(end - start).count();
+        std::cout << (serial.errors.size() == report.errors.size() ? "✅" : "❌") << " Single worker agrees" << std::endl;
+        std::cout << "⚡ Integrity check: " << report.files.size() / parallelSeconds << " files/sec with 4 workers, "
+                  << serial.files.size() / serialSeconds << " files/sec with 1 (" << std::thread::hardware_concurrency()
+                  << " hardware threads)" << std::endl;
+        
+        IntegritySystem::ClearFilesToCheck();
+        fs::remove_all(dir);
+    }
+    
+    // Test 22: Fingerprint Cache
+    std::cout << "\n22. Fingerprint Cache" << std::endl;
+    std::cout << "---------------------" << std::endl;
+    
+    {
+        namespace fs = std::filesystem;
+        std::string dir = TempPath("integrity_fpcache");
+        fs::remove_all(dir);
+        fs::create_directories(dir + "/files");
+        std::mt19937 rng(22);
+        std::vector<std::string> paths;
+        std::string data;
+        uint64_t totalBytes = 0;
+        for (int i = 0; i < 5000; ++i) {
+            size_t size = i % 500 == 0 ? (4 << 20) : 4096 + rng() % 61440;
+            data.resize(size);
+            for (auto& c : data) c = static_cast<char>(rng());
+            paths.push_back(dir + "/files/f" + std::to_string(i));
+            std::ofstream(paths.back(), std::ios::binary) << data;
+            totalBytes += size;
+        }
+        for (int i = 0; i < 50; ++i) {
+            paths.push_back(dir + "/files/link" + std::to_string(i));
+            fs::create_hard_link(paths[i * 2 + 1], paths.back());
+        }
+        
+        IntegritySystem::ClearFilesToCheck();
+        for (const auto& path : paths) {
+            IntegritySystem::AddFileToCheck(path, IntegritySystem::CalculateFileHash(path));
+        }
+        std::string cacheFile = dir + "/integrity.fpcache";
+        IntegritySystem::ConfigureFingerprintCache(cacheFile, 24);
+        
+        auto start = std::chrono::high_resolution_clock::now();
+        auto cold = IntegritySystem::PerformIntegrityCheck(nullptr, 4);
+        auto end = std::chrono::high_resolution_clock::now();
+        double coldSeconds = std::chrono::duration<double>(end - start).count();
+        const auto& c = cold.statistics;
+        std::cout << (cold.overallValid && c.fullRehash && c.cacheHits == 0 && c.cacheMisses == 5000 &&
+                      c.sharedHardLinks == 50 && c.bytesHashed == totalBytes ? "✅" : "❌")
+                  << " First pass rehashed " << c.cacheMisses << " inodes (" << (c.bytesHashed >> 20) << " MB), "
+                  << c.sharedHardLinks << " hard links hashed once" << std::endl;
+        
+        start = std::chrono::high_resolution_clock::now();
+        auto warm = IntegritySystem::PerformIntegrityCheck(nullptr, 4);
+        end = std::chrono::high_resolution_clock::now();
+        double warmSeconds = std::chrono::duration<double>(end - start).count();
+        const auto& w = warm.statistics;
+        std::cout << (warm.overallValid && !w.fullRehash && w.cacheHits == 5000 && w.bytesHashed == 0 &&
+                      w.bytesSkipped == totalBytes && warm.files.size() == paths.size() ? "✅" : "❌")
+                  << " Second pass hit rate " << w.HitRate() * 100 << "%, " << (w.bytesSkipped >> 20)
+                  << " MB not read" << std::endl;
+        
+        // Same-size rewrite with the modification time put back: ctime still moves
+        auto written = fs::last_write_time(paths[4]);
+        std::ofstream(paths[4], std::ios::binary | std::ios::in) << "forged";
+        fs::last_write_time(paths[4], written);
+        std::ofstream(paths[3], std::ios::binary | std::ios::app) << "tampered";
+        auto changed = IntegritySystem::PerformIntegrityCheck(nullptr, 4);
+        std::cout << (!changed.overallValid && changed.errors.size() == 3 && changed.statistics.cacheMisses == 2
+                          ? "✅" : "❌")
+                  << " Appended file and forged-mtime rewrite (plus its hard link) rehashed and flagged: "
+                  << changed.errors.size() << " errors, " << changed.statistics.cacheMisses << " misses" << std::endl;
+        
+        IntegritySystem::RequestFullRehash();
+        auto full = IntegritySystem::PerformIntegrityCheck(nullptr, 4);
+        std::cout << (full.statistics.fullRehash && full.statistics.cacheHits == 0 && full.errors.size() == 3 ? "✅" : "❌")
+                  << " Requested full rehash bypassed the cache" << std::endl;
+        
+        IntegritySystem::ConfigureFingerprintCache(cacheFile, 24);
+        auto reloaded = IntegritySystem::PerformIntegrityCheck(nullptr, 4);
+        std::cout << (!reloaded.statistics.fullRehash && reloaded.statistics.cacheHits == 5000 ? "✅" : "❌")
+                  << " Cache reloaded from disk: " << reloaded.statistics.cacheHits << " hits" << std::endl;
+        
+        IntegritySystem::ConfigureFingerprintCache(cacheFile, 0);
+        auto always = IntegritySystem::PerformIntegrityCheck(nullptr, 4);
+        std::cout << (always.statistics.fullRehash ? "✅" : "❌") << " full_rehash_hours = 0 rehashes every pass" << std::endl;
+        
+        std::cout << "⚡ Fingerprint cache: " << paths.size() / coldSeconds << " files/sec cold, "
+                  << paths.size() / warmSeconds << " files/sec warm (" << coldSeconds / warmSeconds << "x)" << std::endl;
+        
+        IntegritySystem::ConfigureFingerprintCache("", 24);
+        IntegritySystem::ClearFilesToCheck();
+        fs::remove_all(dir);
+    }
+    
+    // Test 23: Merkle Chunk Hashing
+    std::cout << "\n23. Merkle Chunk Hashing" << std::endl;
+    std::cout << "------------------------" << std::endl;
+    
+    {
+        namespace fs = std::filesystem;
+        const uint64_t MiB = 1024 * 1024;
+        std::string dir = TempPath("integrity_merkle");
+        fs::remove_all(dir);
+        fs::create_directories(dir);
+        std::mt19937_64 rng(23);
+        std::string original(96 * MiB + 12345, '\0');
+        for (size_t i = 0; i + 8 <= original.size(); i += 8) {
+            uint64_t word = rng();
+            std::memcpy(&original[i], &word, 8);
+        }
+        std::string large = dir + "/large.db";
+        std::string small = dir + "/small.cfg";
+        std::ofstream(large, std::ios::binary) << original;
+        std::ofstream(small, std::ios::binary) << "setting=1\n";
+        auto patch = [&](uint64_t offset, const std::string& bytes) {
+            std::fstream file(large, std::ios::binary | std::ios::in | std::ios::out);
+            file.seekp(static_cast<std::streamoff>(offset));
+            file.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+        };
+        
+        MerkleTree tree;
+        tree.Reset(original.size(), MerkleTree::DefaultChunkSize);
+        for (size_t i = 0; i < tree.GetChunkCount(); ++i) {
+            auto range = tree.GetChunkRange(i);
+            tree.HashChunk(i, reinterpret_cast<const uint8_t*>(original.data()) + range.offset, range.length);
+        }
+        tree.Finish();
+        MerkleTree parsed;
+        std::string serialized = tree.Serialize();
+        bool roundTrip = MerkleTree::Parse(serialized, parsed) && parsed.GetId() == tree.GetId();
+        serialized[serialized.size() - 1] = serialized.back() == '0' ? '1' : '0';
+        std::cout << (roundTrip && !MerkleTree::Parse(serialized, parsed) ? "✅" : "❌") << " Tree of "
+                  << tree.GetChunkCount() << " chunks round-trips; a corrupted leaf is rejected" << std::endl;
+        
+        IntegritySystem::ConfigureFingerprintCache("", 0);
+        IntegritySystem::ConfigureMerkle(16 * MiB, MerkleTree::DefaultChunkSize);
+        IntegritySystem::ClearFilesToCheck();
+        IntegritySystem::AddFileToCheck(large);
+        IntegritySystem::AddFileToCheck(small);
+        IntegritySystem::GenerateBaseline(dir + "/baseline");
+        IntegritySystem::ClearFilesToCheck();
+        IntegritySystem::LoadBaseline(dir + "/baseline");
+        
+        auto start = std::chrono::high_resolution_clock::now();
+        auto clean = IntegritySystem::PerformIntegrityCheck(nullptr, 4);
+        auto end = std::chrono::high_resolution_clock::now();
+        double fullMs = std::chrono::duration<double, std::milli>(end - start).count();
+        bool merkleEntry = false;
+        for (const auto& file : clean.files) {
+            merkleEntry |= file.path == large && file.actualHash == tree.GetId();
+        }
+        std::cout << (clean.overallValid && clean.files.size() == 2 && merkleEntry ? "✅" : "❌")
+                  << " Baseline stores the large file as a Merkle tree and the pass verifies it" << std::endl;
+        
+        patch(5 * MiB + 10, "abc");
+        patch(70 * MiB - 100, std::string(2 * MiB, 'x'));
+        auto modified = IntegritySystem::PerformIntegrityCheck(nullptr, 4);
+        std::vector<MerkleTree::ByteRange> ranges;
+        for (const auto& file : modified.files) {
+            if (file.path == large) ranges = file.changedRanges;
+        }
+        bool rangesOk = ranges.size() == 2 && ranges[0].offset == 5 * MiB && ranges[0].length == MiB &&
+                        ranges[1].offset == 69 * MiB && ranges[1].length == 3 * MiB;
+        std::cout << (!modified.overallValid && rangesOk && modified.errors.size() == 1 ? "✅" : "❌") << " "
+                  << (modified.errors.empty() ? "no error" : modified.errors[0]) << std::endl;
+        
+        patch(5 * MiB + 10, original.substr(5 * MiB + 10, 3));
+        patch(70 * MiB - 100, original.substr(70 * MiB - 100, 2 * MiB));
+        start = std::chrono::high_resolution_clock::now();
+        auto repaired = IntegritySystem::VerifyFileRanges(large, {{5 * MiB + 10, 3}, {70 * MiB - 100, 2 * MiB}});
+        end = std::chrono::high_resolution_clock::now();
+        double dirtyMs = std::chrono::duration<double, std::milli>(end - start).count();
+        patch(90 * MiB, "z");
+        auto dirty = IntegritySystem::VerifyFileRanges(large, {{90 * MiB, 1}});
+        bool dirtyOk = !dirty.isValid && dirty.changedRanges.size() == 1 && dirty.changedRanges[0].offset == 90 * MiB;
+        patch(90 * MiB, original.substr(90 * MiB, 1));
+        auto outsideRange = IntegritySystem::VerifyFileRanges(large, {{0, 1}});
+        std::cout << (repaired.isValid && dirtyOk && !outsideRange.isValid ? "✅" : "❌")
+                  << " Dirty-range reverify: repair accepted, new write localized to chunk "
+                  << (dirty.changedRanges.empty() ? 0 : dirty.changedRanges[0].offset / MiB)
+                  << ", undirtied chunks trusted from the last pass" << std::endl;
+        
+        std::string grown = original + "tail";
+        std::ofstream(large, std::ios::binary) << grown;
+        auto appended = IntegritySystem::VerifyFileRanges(large, {});
+        bool tailOk = appended.changedRanges.size() == 1 && appended.changedRanges[0].offset == 96 * MiB &&
+                      appended.changedRanges[0].length == 12345 + 4;
+        std::ofstream(large, std::ios::binary) << original;
+        auto restored = IntegritySystem::PerformIntegrityCheck(nullptr, 4);
+        std::cout << (tailOk && restored.overallValid ? "✅" : "❌")
+                  << " Appended bytes reported as the tail range; restored file verifies" << std::endl;
+        
+        start = std::chrono::high_resolution_clock::now();
+        IntegritySystem::PerformIntegrityCheck(nullptr, 1);
+        end = std::chrono::high_resolution_clock::now();
+        double serialMs = std::chrono::duration<double, std::milli>(end - start).count();
+        std::cout << "⚡ Merkle: full pass " << fullMs << " ms with 4 workers, " << serialMs << " ms with 1; "
+                  << "dirty-range reverify of 4 chunks " << dirtyMs << " ms" << std::endl;
+        
+        IntegritySystem::ConfigureMerkle(0);
+        IntegritySystem::ConfigureFingerprintCache("", 24);
+        IntegritySystem::ClearFilesToCheck();
+        fs::remove_all(dir);
+    }
+    
+    // Test 24: Binary Baseline
+    std::cout << "\n24. Binary Baseline" << std::endl;
+    std::cout << "-------------------" << std::endl;
+    
+    {
+        namespace fs = std::filesystem;
+        std::string dir = TempPath("integrity_baseline");
+        fs::remove_all(dir);
+        fs::create_directories(dir);
+        std::mt19937_64 rng(24);
+        const size_t count = 1000000;
+        std::vector<std::pair<std::string, std::string>> expected;
+        expected.reserve(count);
+        {
+            std::ofstream text(dir + "/baseline.txt");
+            text << "# Security Sentinel Integrity Baseline\n\n";
+            char hex[65];
+            for (size_t i = 0; i < count; ++i) {
+                std::string path = "/usr/lib/package" + std::to_string(i / 100) + "/module" +
+                                   std::to_string(i % 100) + (i == 123456 ? ":stream" : "") + ".so";
+                for (int j = 0; j < 64; j += 16) {
+                    std::snprintf(hex + j, 17, "%016llx", static_cast<unsigned long long>(rng()));
+                }
+                text << path << ":" << hex << "\n";
+                expected.emplace_back(path, hex);
+            }
+        }
+        
+        BaselineIndex::CompileStats stats;
+        auto start = std::chrono::high_resolution_clock::now();
+        bool converted = BaselineIndex::ConvertText(dir + "/baseline.txt", dir + "/baseline.bin", &stats);
+        auto end = std::chrono::high_resolution_clock::now();
+        double convertMs = std::chrono::duration<double, std::milli>(end - start).count();
+        std::cout << (converted && stats.entries == count && stats.linesSkipped == 2 ? "✅" : "❌") << " Converted "
+                  << stats.entries << " entries in " << convertMs << " ms; paths " << (stats.pathBytes >> 20)
+                  << " MB -> " << (stats.poolBytes >> 20) << " MB prefix-compressed, file "
+                  << (fs::file_size(dir + "/baseline.bin") >> 20) << " MB" << std::endl;
+        
+        BaselineIndex index;
+        start = std::chrono::high_resolution_clock::now();
+        bool opened = index.Open(dir + "/baseline.bin");
+        end = std::chrono::high_resolution_clock::now();
+        double openMs = std::chrono::duration<double, std::milli>(end - start).count();
+        
+        std::vector<size_t> probes(100000);
+        for (auto& probe : probes) probe = rng() % count;
+        size_t found = 0;
+        BaselineIndex::Entry entry;
+        for (size_t probe : probes) {
+            found += index.Find(expected[probe].first, entry) && entry.hash == expected[probe].second;
+        }
+        start = std::chrono::high_resolution_clock::now();
+        for (size_t probe : probes) {
+            index.Find(expected[probe].first, entry);
+        }
+        end = std::chrono::high_resolution_clock::now();
+        double findNs = std::chrono::duration<double, std::nano>(end - start).count() / probes.size();
+        bool colonPath = index.Find(expected[123456].first, entry) && entry.hash == expected[123456].second;
+        bool misses = !index.Find("/usr/lib/package0/module", entry) && !index.Find("/zzz", entry) && !index.Find("", entry);
+        std::cout << (opened && found == probes.size() && colonPath && misses ? "✅" : "❌") << " Opened in " << openMs
+                  << " ms; " << found << " random lookups correct, path with ':' found, absent paths missed" << std::endl;
+        std::cout << "⚡ Baseline lookup: " << findNs << " ns per Find over " << index.GetCount() << " entries" << std::endl;
+        index.Close();
+        
+        {
+            std::fstream corrupt(dir + "/baseline.bin", std::ios::binary | std::ios::in | std::ios::out);
+            corrupt.seekp(40);
+            corrupt.put('\x7f');
+        }
+        BaselineIndex damaged;
+        std::cout << (!damaged.Open(dir + "/baseline.bin") ? "✅" : "❌") << " Header checksum rejects a corrupted baseline: "
+                  << damaged.GetLastError() << std::endl;
+        BaselineIndex::ConvertText(dir + "/baseline.txt", dir + "/baseline.bin");
+        
+        IntegritySystem::ClearFilesToCheck();
+        IntegritySystem::AddFileToCheck(expected[7].first);
+        start = std::chrono::high_resolution_clock::now();
+        IntegritySystem::LoadBaseline(dir + "/baseline.bin");
+        end = std::chrono::high_resolution_clock::now();
+        double binaryLoadMs = std::chrono::duration<double, std::milli>(end - start).count();
+        IntegritySystem::AddFileToCheck(expected[9].first, std::string(64, 'f'));
+        IntegritySystem::AddFileToCheck(dir + "/extra");
+        start = std::chrono::high_resolution_clock::now();
+        auto seven = IntegritySystem::VerifyFileRanges(expected[7].first, {});
+        end = std::chrono::high_resolution_clock::now();
+        double materializeMs = std::chrono::duration<double, std::milli>(end - start).count();
+        auto nine = IntegritySystem::VerifyFileRanges(expected[9].first, {});
+        auto extra = IntegritySystem::VerifyFileRanges(dir + "/extra", {});
+        std::cout << (seven.expectedHash == expected[7].second && nine.expectedHash == std::string(64, 'f') &&
+                      extra.path == dir + "/extra" && !extra.exists ? "✅" : "❌")
+                  << " Mapped baseline merges with files added before and after loading" << std::endl;
+        IntegritySystem::ClearFilesToCheck();
+        start = std::chrono::high_resolution_clock::now();
+        IntegritySystem::LoadBaseline(dir + "/baseline.txt");
+        end = std::chrono::high_resolution_clock::now();
+        double textLoadMs = std::chrono::duration<double, std::milli>(end - start).count();
+        std::cout << "⚡ Loading " << count << " entries: text " << textLoadMs << " ms, binary " << binaryLoadMs
+                  << " ms (entries copied on first check: " << materializeMs << " ms)" << std::endl;
+        
+        std::string config = dir + "/app.cfg";
+        std::ofstream(config) << "key=value\n";
+        fs::permissions(config, fs::perms::owner_read | fs::perms::owner_write | fs::perms::group_read);
+        IntegritySystem::ClearFilesToCheck();
+        IntegritySystem::AddFileToCheck(config);
+        IntegritySystem::AddFileToCheck(dir + "/absent");
+        IntegritySystem::GenerateBaseline(dir + "/generated.bin");
+        BaselineIndex generated;
+        bool metadata = generated.Open(dir + "/generated.bin") && generated.GetCount() == 1 &&
+                        generated.Find(config, entry) && entry.hasMetadata && entry.size == 10 && entry.mode == 0640 &&
+                        entry.hash == IntegritySystem::CalculateFileHash(config);
+        IntegritySystem::ClearFilesToCheck();
+        IntegritySystem::LoadBaseline(dir + "/generated.bin");
+        auto report = IntegritySystem::PerformIntegrityCheck(nullptr, 1);
+        std::cout << (metadata && report.overallValid && report.files.size() == 1 ? "✅" : "❌")
+                  << " Generated baseline records size, mode 0" << std::oct << entry.mode << std::dec
+                  << " and hash, and verifies after reload" << std::endl;
+        
+        IntegritySystem::ClearFilesToCheck();
+        fs::remove_all(dir);
+    }
+    
+    // Test 25: Scan Path Tree Walk
+    std::cout << "\n25. Scan Path Tree Walk" << std::endl;
+    std::cout << "-----------------------" << std::endl;
+    
+    {
+        GlobMatcher globs({"*.log", "*.tmp", "build/*", "node_modules", "cache-??", "**/secret[0-9].key", "/docs/*.md"});
+        bool semantics = globs.GetPatternCount() == 7 && globs.Matches("a/b/trace.log") && globs.Matches("x.tar.tmp") &&
+                         !globs.Matches("x.tmp.gz") && globs.Matches("build/out.o") && !globs.Matches("build/obj/out.o") &&
+                         !globs.Matches("src/build/out.o") && globs.Matches("web/node_modules") &&
+                         globs.Matches("cache-01") && !globs.Matches("cache-001") && globs.Matches("secret7.key") &&
+                         globs.Matches("etc/keys/secret3.key") && !globs.Matches("etc/secretX.key") &&
+                         globs.Matches("docs/readme.md") && !globs.Matches("src/docs/readme.md") && !globs.Matches("logs");
+        GlobMatcher invalid;
+        std::cout << (semantics && !invalid.Add("[a-z") && !invalid.Add("") && invalid.Empty() ? "✅" : "❌")
+                  << " Exclude globs: names, extensions, anchored paths, '?', '**/' and classes" << std::endl;
+        
+        namespace fs = std::filesystem;
+        std::string dir = TempPath("integrity_walk");
+        fs::remove_all(dir);
+        std::vector<std::string> expected;
+        size_t excludedFiles = 0;
+        for (int a = 0; a < 20; ++a) {
+            for (int b = 0; b < 10; ++b) {
+                std::string sub = dir + "/pkg" + std::to_string(a) + "/lib" + std::to_string(b) + "/deep";
+                fs::create_directories(sub);
+                for (int f = 0; f < 50; ++f) {
+                    std::string file = (f % 2 ? sub : fs::path(sub).parent_path().string()) + "/file" + std::to_string(f);
+                    bool log = f % 10 == 9;
+                    file += log ? ".log" : ".dat";
+                    std::ofstream(file) << f;
+                    if (log) {
+                        excludedFiles++;
+                    } else {
+                        expected.push_back(file);
+                    }
+                }
+            }
+        }
+        fs::create_directories(dir + "/build/obj");
+        std::ofstream(dir + "/build/obj/main.o") << "o";
+        std::ofstream(dir + "/build/out") << "o";
+        std::ofstream(dir + "/pkg0/build") << "kept: build/* is anchored at the root";
+        expected.push_back(dir + "/pkg0/build");
+        fs::create_directory_symlink(dir + "/pkg1", dir + "/pkg-link");
+        fs::create_symlink(dir + "/pkg0/build", dir + "/file-link");
+        std::sort(expected.begin(), expected.end());
+        
+        TreeWalker::Options options;
+        TreeWalker walker(options);
+        walker.SetExcludes(GlobMatcher({"*.log", "build/*"}));
+        TreeWalker::Statistics stats;
+        auto files = walker.Walk({dir + "/"}, &stats);
+        std::cout << (files == expected && stats.excluded == excludedFiles + 2 && stats.errors == 0 ? "✅" : "❌")
+                  << " Walked " << stats.directories << " directories: " << stats.files << " files, " << stats.excluded
+                  << " excluded, symlinks not followed" << std::endl;
+        
+        auto single = walker.Walk({expected[0], dir + "/missing"}, &stats);
+        std::cout << (single.size() == 1 && single[0] == expected[0] && stats.errors == 1 ? "✅" : "❌")
+                  << " File roots are kept as given, missing roots counted as errors" << std::endl;
+        
+        // Same tree, unfiltered, against std::filesystem; best of three after a warm-up
+        TreeWalker plain;
+        TreeWalker::Statistics plainStats;
+        double walkerMs = 1e9, iteratorMs = 1e9;
+        size_t iteratorFiles = 0;
+        for (int round = 0; round < 4; ++round) {
+            auto start = std::chrono::high_resolution_clock::now();
+            auto all = plain.Walk({dir}, &plainStats);
+            auto end = std::chrono::high_resolution_clock::now();
+            if (round) walkerMs = std::min(walkerMs, std::chrono::duration<double, std::milli>(end - start).count());
+            
+            start = std::chrono::high_resolution_clock::now();
+            std::vector<std::string> listed;
+            for (const auto& item : fs::recursive_directory_iterator(dir)) {
+                if (item.is_regular_file() && !item.is_symlink()) listed.push_back(item.path().string());
+            }
+            std::sort(listed.begin(), listed.end());
+            end = std::chrono::high_resolution_clock::now();
+            if (round) iteratorMs = std::min(iteratorMs, std::chrono::duration<double, std::milli>(end - start).count());
+            iteratorFiles = listed.size() == all.size() && listed == all ? listed.size() : 0;
+        }
+        std::cout << (iteratorFiles == plainStats.files ? "✅" : "❌") << " Walker and recursive_directory_iterator agree on "
+                  << iteratorFiles << " files" << std::endl;
+        std::cout << "⚡ Tree walk: " << static_cast<uint64_t>(plainStats.files / (walkerMs / 1000)) << " files/sec (openat/getdents64) vs "
+                  << static_cast<uint64_t>(iteratorFiles / (iteratorMs / 1000)) << " files/sec (recursive_directory_iterator)"
+                  << std::endl;
+        
+        IntegritySystem::ClearFilesToCheck();
+        size_t added = IntegritySystem::AddScanPaths({dir}, {"*.log", "build/*", "pkg1"}, true, &stats);
+        IntegritySystem::GenerateBaseline(dir + "/walk.baseline");
+        IntegritySystem::ClearFilesToCheck();
+        IntegritySystem::LoadBaseline(dir + "/walk.baseline");
+        std::ofstream(dir + "/pkg2/lib3/file0.dat") << "tampered";
+        auto report = IntegritySystem::PerformIntegrityCheck(nullptr, 1);
+        size_t invalidFiles = std::count_if(report.files.begin(), report.files.end(),
+                                            [](const IntegritySystem::FileInfo& info) { return !info.isValid; });
+        std::cout << (added == expected.size() - 450 && report.files.size() == added && invalidFiles == 1 ? "✅" : "❌")
+                  << " Baseline over scan paths: " << added << " files at "
+                  << static_cast<uint64_t>(stats.FilesPerSecond()) << " files/sec, one modification detected" << std::endl;
+        
+        IntegritySystem::ClearFilesToCheck();
+        fs::remove_all(dir);
+    }
+    
+    // Test 26: Continuous Integrity Monitoring
+    std::cout << "\n26. Continuous Integrity Monitoring" << std::endl;
+    std::cout << "-----------------------------------" << std::endl;
+    
+    {
+        namespace fs = std::filesystem;
+        std::string dir = TempPath("integrity_watch");
+        fs::remove_all(dir);
+        const int count = 2000;
+        for (int i = 0; i < count; ++i) {
+            std::string sub = dir + "/d" + std::to_string(i % 20);
+            fs::create_directories(sub);
+            std::ofstream(sub + "/f" + std::to_string(i)) << std::string(16 * 1024, static_cast<char>('a' + i % 26));
+        }
+        IntegritySystem::ClearFilesToCheck();
+        IntegritySystem::AddScanPaths({dir}, {});
+        IntegritySystem::GenerateBaseline(dir + "/watch.baseline");
+        IntegritySystem::ClearFilesToCheck();
+        IntegritySystem::LoadBaseline(dir + "/watch.baseline");
+        auto fullStart = std::chrono::high_resolution_clock::now();
+        IntegritySystem::RequestFullRehash();
+        auto full = IntegritySystem::PerformIntegrityCheck(nullptr, 1);
+        double fullMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - fullStart).count();
+        
+        struct Seen { std::string path; std::string change; bool valid; };
+        std::mutex seenMutex;
+        std::vector<Seen> seen;
+        auto waitFor = [&](size_t total) {
+            for (int i = 0; i < 500; ++i) {
+                {
+                    std::lock_guard<std::mutex> lock(seenMutex);
+                    if (seen.size() >= total) return true;
+                }
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            }
+            return false;
+        };
+        
+        IntegrityWatcher::Options options;
+        options.debounce = std::chrono::milliseconds(100);
+        options.sweepInterval = std::chrono::minutes(0);
+        IntegrityWatcher watcher(options);
+        watcher.SetChangeCallback([&](const IntegritySystem::FileInfo& file, const std::string& change, int) {
+            std::lock_guard<std::mutex> lock(seenMutex);
+            seen.push_back({file.path, change, file.isValid});
+        });
+        bool started = watcher.Start();
+        auto stats = watcher.GetStatistics();
+        std::cout << (started && full.overallValid && stats.watchedDirectories == 20 ? "✅" : "❌") << " Watching "
+                  << stats.watchedDirectories << " directories for " << full.files.size() << " baseline files" << std::endl;
+        
+        std::string modified = dir + "/d1/f1", replaced = dir + "/d2/f2", deleted = dir + "/d3/f3";
+        auto changeStart = std::chrono::high_resolution_clock::now();
+        std::ofstream(modified, std::ios::app) << "appended";
+        std::ofstream(dir + "/d2/.f2.tmp") << "replacement";
+        fs::rename(dir + "/d2/.f2.tmp", replaced);
+        fs::remove(deleted);
+        std::ofstream(dir + "/d4/untracked") << "not in the baseline";
+        bool reported = waitFor(3);
+        double detectMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - changeStart).count();
+        std::this_thread::sleep_for(std::chrono::milliseconds(300));
+        std::map<std::string, Seen> byPath;
+        {
+            std::lock_guard<std::mutex> lock(seenMutex);
+            for (const auto& item : seen) byPath[item.path] = item;
+        }
+        stats = watcher.GetStatistics();
+        bool kinds = byPath.size() == 3 && byPath[modified].change == "MODIFY" && byPath[replaced].change == "REPLACE" &&
+                     byPath[deleted].change == "DELETE" && !byPath[modified].valid && !byPath[replaced].valid &&
+                     !byPath[deleted].valid;
+        std::cout << (reported && kinds && stats.filesRehashed == 3 && stats.mismatches == 3 ? "✅" : "❌")
+                  << " Modify, rename-over and delete reported as mismatches in " << detectMs
+                  << " ms; untracked file ignored" << std::endl;
+        
+        {
+            std::lock_guard<std::mutex> lock(seenMutex);
+            seen.clear();
+        }
+        std::string busy = dir + "/d5/f5";
+        for (int i = 0; i < 10; ++i) {
+            std::ofstream(busy, std::ios::app) << i;
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        }
+        std::ofstream(modified) << std::string(16 * 1024, static_cast<char>('a' + 1));
+        waitFor(2);
+        std::this_thread::sleep_for(std::chrono::milliseconds(300));
+        stats = watcher.GetStatistics();
+        {
+            std::lock_guard<std::mutex> lock(seenMutex);
+            for (const auto& item : seen) byPath[item.path] = item;
+        }
+        std::cout << (stats.filesRehashed == 5 && byPath[modified].valid && !byPath[busy].valid ? "✅" : "❌")
+                  << " Ten writes within the debounce rehashed once; restored file verified clean" << std::endl;
+        std::cout << "⚡ Churn-proportional I/O: " << stats.filesRehashed << " targeted rehashes for " << stats.events
+                  << " events vs " << full.files.size() << " files in a full pass (" << fullMs << " ms)" << std::endl;
+        
+        // Passes and monitored-set changes from this thread while the watcher rehashes
+        {
+            std::lock_guard<std::mutex> lock(seenMutex);
+            seen.clear();
+        }
+        size_t before = IntegritySystem::GetMonitoredFiles().size();
+        std::atomic<bool> writing(true);
+        std::thread writer([&]() {
+            for (int i = 0; writing.load(); ++i) {
+                std::ofstream(dir + "/d" + std::to_string(i % 20) + "/f" + std::to_string(i % 20), std::ios::app) << i;
+                std::this_thread::sleep_for(std::chrono::milliseconds(2));
+            }
+        });
+        size_t checked = 0;
+        for (int i = 0; i < 20; ++i) {
+            std::string added = dir + "/d6/added" + std::to_string(i);
+            std::ofstream(added) << i;
+            IntegritySystem::AddFileToCheck(added);
+            checked += IntegritySystem::PerformIntegrityCheck(nullptr, 2).files.size();
+        }
+        writing.store(false);
+        writer.join();
+        waitFor(1);
+        std::cout << (IntegritySystem::GetMonitoredFiles().size() == before + 20 && checked == 20 * before + 210 ? "✅" : "❌")
+                  << " 20 passes and additions alongside " << watcher.GetStatistics().filesRehashed
+                  << " watcher rehashes" << std::endl;
+        watcher.Stop();
+        
+        IntegritySystem::ClearFilesToCheck();
+        fs::remove_all(dir);
+    }
+    
+    // Test 27: io_uring Small-file Pipeline
+    std::cout << "\n27. io_uring Small-file Pipeline" << std::endl;
+    std::cout << "--------------------------------" << std::endl;
+    
+    {
+        namespace fs = std::filesystem;
+        std::string dir = TempPath("integrity_uring");
+        fs::remove_all(dir);
+        fs::create_directories(dir + "/sub");
+        std::ofstream(dir + "/exact") << std::string(4096, 'x');
+        std::ofstream(dir + "/large") << std::string(5000, 'y');
+        std::ofstream(dir + "/empty");
+        std::ofstream(dir + "/skipped") << "s";
+        std::vector<std::string> paths = {dir + "/exact", dir + "/large", dir + "/missing", dir + "/sub",
+                                          dir + "/empty", dir + "/skipped"};
+        
+        UringFileReader::Options readerOptions;
+        readerOptions.queueDepth = 4;
+        readerOptions.buffers = 8;
+        readerOptions.bufferSize = 4096;
+        UringFileReader reader(readerOptions);
+        if (!reader.Initialize()) {
+            std::cout << "⚠️  io_uring unavailable (" << reader.GetLastError() << "), pipeline checks skipped" << std::endl;
+        } else {
+            std::map<size_t, UringFileReader::Completion> completions;
+            std::map<size_t, std::string> contents;
+            size_t started = reader.Run(paths.size(), [&](size_t i) { return paths[i].c_str(); },
+                                        [&](size_t i, const FingerprintCache::Fingerprint&) { return i != 5; },
+                                        [&](const UringFileReader::Completion& completion) {
+                                            completions[completion.index] = completion;
+                                            if (completion.data) {
+                                                contents[completion.index].assign(
+                                                    reinterpret_cast<const char*>(completion.data), completion.length);
+                                                reader.Release(completion.buffer);
+                                            }
+                                        });
+            bool outcomes = started == paths.size() && completions.size() == 5 && !completions.count(5) &&
+                            completions[0].error == 0 && contents[0] == std::string(4096, 'x') &&
+                            completions[0].before == completions[0].after && completions[1].read &&
+                            completions[1].error == EFBIG && !completions[2].read && completions[2].error == ENOENT &&
+                            !completions[3].read && completions[4].error == 0 && completions[4].length == 0;
+            std::cout << (outcomes ? "✅" : "❌") << " statx/openat/read/close/statx pipeline: full buffer, oversized, "
+                      << "missing, directory, empty and declined files" << std::endl;
+        }
+        fs::remove_all(dir);
+        
+        // An /etc-style tree: many small files, a pass dominated by per-file syscalls
+        const size_t count = 40000;
+        std::mt19937 rng(27);
+        std::string payload(16 * 1024, 'p');
+        for (size_t i = 0; i < count; ++i) {
+            std::string sub = dir + "/d" + std::to_string(i % 200);
+            if (i < 200) fs::create_directories(sub);
+            std::ofstream(sub + "/f" + std::to_string(i)).write(payload.data(), 64 + rng() % 2048);
+        }
+        IntegritySystem::ClearFilesToCheck();
+        IntegritySystem::ConfigureFingerprintCache("", 0);
+        IntegritySystem::AddScanPaths({dir}, {});
+        IntegritySystem::ConfigureIoUring(false);
+        IntegritySystem::GenerateBaseline(dir + "/uring.baseline");
+        IntegritySystem::ClearFilesToCheck();
+        IntegritySystem::LoadBaseline(dir + "/uring.baseline");
+        
+        double readMs = 1e9, uringMs = 1e9;
+        IntegritySystem::IntegrityReport plain, uring;
+        for (int round = 0; round < 3; ++round) {
+            IntegritySystem::ConfigureIoUring(false);
+            auto start = std::chrono::high_resolution_clock::now();
+            plain = IntegritySystem::PerformIntegrityCheck(nullptr, 1);
+            auto end = std::chrono::high_resolution_clock::now();
+            readMs = std::min(readMs, std::chrono::duration<double, std::milli>(end - start).count());
+            
+            IntegritySystem::ConfigureIoUring(true, 128);
+            start = std::chrono::high_resolution_clock::now();
+            uring = IntegritySystem::PerformIntegrityCheck(nullptr, 1);
+            end = std::chrono::high_resolution_clock::now();
+            uringMs = std::min(uringMs, std::chrono::duration<double, std::milli>(end - start).count());
+        }
+        bool same = plain.overallValid && uring.overallValid && plain.files.size() == count && uring.files.size() == count &&
+                    !plain.statistics.ioUring && plain.statistics.bytesHashed == uring.statistics.bytesHashed;
+        std::cout << (same ? "✅" : "❌") << " read() and " << (uring.statistics.ioUring ? "io_uring" : "fallback")
+                  << " passes agree on " << count << " files (" << (uring.statistics.bytesHashed >> 20) << " MB hashed)"
+                  << std::endl;
+        
+        std::ofstream(dir + "/d7/f7") << "tampered";
+        fs::remove(dir + "/d8/f8");
+        uring = IntegritySystem::PerformIntegrityCheck(nullptr, 1);
+        std::cout << (!uring.overallValid && uring.errors.size() == 2 ? "✅" : "❌")
+                  << " io_uring pass reports a modified and a missing file" << std::endl;
+        std::cout << "⚡ Small-file pass: read() " << static_cast<uint64_t>(count / (readMs / 1000)) << " files/sec, "
+                  << (uring.statistics.ioUring ? "io_uring " : "fallback ") << static_cast<uint64_t>(count / (uringMs / 1000))
+                  << " files/sec (" << readMs / uringMs << "x)" << std::endl;
+        
+        IntegritySystem::ConfigureIoUring(true);
+        IntegritySystem::ClearFilesToCheck();
+        fs::remove_all(dir);
+    }
+    
+    // Test 28: BLAKE3 Fast-hash Mode
+    std::cout << "\n28. BLAKE3 Fast-hash Mode" << std::endl;
+    std::cout << "-------------------------" << std::endl;
+    
+    {
+        namespace fs = std::filesystem;
+        auto pattern = [](size_t length) {
+            std::string data(length, '\0');
+            for (size_t i = 0; i < length; ++i) data[i] = static_cast<char>(i % 251);
+            return data;
+        };
+        std::string input1025 = pattern(1025), input100k = pattern(102400);
+        bool vectors = Blake3::Hash("", 0) == "af1349b9f5f9a1a6a0404dea36dcc9499bcb25c9adc112b7cc9a93cae41f3262" &&
+                       Blake3::Hash("abc", 3) == "6437b3ac38465133ffb63b75273a8db548c558465d79db03fd359c6cd5bd9d85" &&
+                       Blake3::Hash(input1025.data(), input1025.size()) ==
+                           "d00278ae47eb27b34faecf67b4fe263f82d5412916c1ffd97c8cb7fb814b8444" &&
+                       Blake3::Hash(input100k.data(), input100k.size()) ==
+                           "bc3e3d41a1146b069abffad3c0d44860cf664390afce4d9661f7902e7943e085";
+        std::cout << (vectors ? "✅" : "❌") << " Reference vectors (" 
+                  << Blake3::GetImplementationName(Blake3::GetImplementation()) << ")" << std::endl;
+        
+        // Every kernel, streamed in odd pieces and tree-parallel, must give the same digest
+        std::string big = pattern(3 * 1024 * 1024 + 77);
+        std::string expected = Blake3::Hash(big.data(), big.size());
+        Blake3::Implementation selected = Blake3::GetImplementation();
+        bool agree = true;
+        std::string kernels;
+        for (auto implementation : {Blake3::Implementation::Portable, Blake3::Implementation::Sse41,
+                                    Blake3::Implementation::Avx2, Blake3::Implementation::Avx512}) {
+            if (!Blake3::SetImplementation(implementation)) continue;
+            kernels += std::string(kernels.empty() ? "" : ", ") + Blake3::GetImplementationName(implementation);
+            Blake3 streamed;
+            for (size_t offset = 0; offset < big.size(); offset += 4093) {
+                streamed.Update(big.data() + offset, std::min<size_t>(4093, big.size() - offset));
+            }
+            uint8_t parallel[Blake3::DigestSize];
+            Blake3::HashParallel(big.data(), big.size(), parallel, 4);
+            agree = agree && streamed.HexDigest() == expected && Blake3::ToHex(parallel) == expected &&
+                    Blake3::Hash(input100k.data(), input100k.size()) ==
+                        "bc3e3d41a1146b069abffad3c0d44860cf664390afce4d9661f7902e7943e085";
+        }
+        Blake3::SetImplementation(selected);
+        std::cout << (agree ? "✅" : "❌") << " Streaming and tree-parallel digests agree across " << kernels << std::endl;
+        
+        std::string dir = TempPath("integrity_blake3");
+        fs::remove_all(dir);
+        fs::create_directories(dir);
+        std::ofstream(dir + "/a.conf") << "sha256 entry";
+        std::ofstream(dir + "/b.conf") << "blake3 entry";
+        std::string blakeId = IntegritySystem::CalculateFileHash(dir + "/b.conf", IntegritySystem::HashAlgorithm::Blake3);
+        IntegritySystem::ClearFilesToCheck();
+        IntegritySystem::AddFileToCheck(dir + "/a.conf", IntegritySystem::CalculateFileHash(dir + "/a.conf"));
+        IntegritySystem::AddFileToCheck(dir + "/b.conf", blakeId);
+        IntegritySystem::IntegrityReport mixed = IntegritySystem::PerformIntegrityCheck(nullptr, 2);
+        std::cout << (mixed.overallValid && Blake3::IsId(blakeId) &&
+                      IntegritySystem::HashAlgorithmOf(blakeId) == IntegritySystem::HashAlgorithm::Blake3 ? "✅" : "❌")
+                  << " Mixed SHA-256/BLAKE3 baseline verifies: " << blakeId.substr(0, 23) << "..." << std::endl;
+        
+        std::vector<BaselineIndex::Entry> entries(2);
+        entries[0].path = dir + "/a.conf";
+        entries[0].hash = IntegritySystem::CalculateFileHash(dir + "/a.conf");
+        entries[1].path = dir + "/b.conf";
+        entries[1].hash = blakeId;
+        BaselineIndex index;
+        BaselineIndex::Entry found;
+        bool roundTrip = BaselineIndex::Compile(entries, dir + "/mixed.baseline") && index.Open(dir + "/mixed.baseline") &&
+                         index.Find(dir + "/b.conf", found) && found.hash == blakeId &&
+                         index.Find(dir + "/a.conf", found) && found.hash == entries[0].hash;
+        std::cout << (roundTrip ? "✅" : "❌") << " BLAKE3 digests round-trip through the binary baseline" << std::endl;
+        index.Close();
+        
+        std::ofstream(dir + "/b.conf") << "tampered";
+        mixed = IntegritySystem::PerformIntegrityCheck(nullptr, 2);
+        std::cout << (!mixed.overallValid && mixed.errors.size() == 1 ? "✅" : "❌")
+                  << " Tampered BLAKE3 entry detected" << std::endl;
+        fs::remove_all(dir);
+        
+        // Same tree in both modes: many small files and one file large enough for the chunked paths
+        fs::create_directories(dir + "/small");
+        std::string payload(8192, 'b');
+        for (size_t i = 0; i < 2000; ++i) {
+            std::ofstream(dir + "/small/f" + std::to_string(i)).write(payload.data(), 512 + i % 4096);
+        }
+        {
+            std::ofstream large(dir + "/large.img", std::ios::binary);
+            for (int i = 0; i < 80; ++i) large.write(big.data(), 1024 * 1024);
+        }
+        IntegritySystem::ConfigureFingerprintCache("", 0);
+        double passMs[2];
+        IntegritySystem::IntegrityReport reports[2];
+        IntegritySystem::HashAlgorithm modes[2] = {IntegritySystem::HashAlgorithm::Sha256, IntegritySystem::HashAlgorithm::Blake3};
+        for (int mode = 0; mode < 2; ++mode) {
+            IntegritySystem::ConfigureHashAlgorithm(modes[mode]);
+            IntegritySystem::ClearFilesToCheck();
+            IntegritySystem::AddScanPaths({dir}, {});
+            IntegritySystem::GenerateBaseline(dir + ".baseline");
+            IntegritySystem::ClearFilesToCheck();
+            IntegritySystem::LoadBaseline(dir + ".baseline");
+            passMs[mode] = 1e9;
+            for (int round = 0; round < 3; ++round) {
+                auto start = std::chrono::high_resolution_clock::now();
+                reports[mode] = IntegritySystem::PerformIntegrityCheck(nullptr, 0);
+                auto end = std::chrono::high_resolution_clock::now();
+                passMs[mode] = std::min(passMs[mode], std::chrono::duration<double, std::milli>(end - start).count());
+            }
+        }
+        bool bothValid = reports[0].overallValid && reports[1].overallValid && reports[0].files.size() == 2001 &&
+                         reports[1].files.size() == 2001 &&
+                         reports[0].statistics.bytesHashed == reports[1].statistics.bytesHashed;
+        std::cout << (bothValid ? "✅" : "❌") << " SHA-256 and BLAKE3 passes verify the same " << reports[1].files.size()
+                  << " files" << std::endl;
+        double megabytes = reports[1].statistics.bytesHashed / (1024.0 * 1024.0);
+        std::cout << "⚡ Integrity pass: SHA-256 " << static_cast<uint64_t>(megabytes / (passMs[0] / 1000)) << " MB/s, BLAKE3 "
+                  << static_cast<uint64_t>(megabytes / (passMs[1] / 1000)) << " MB/s (" << passMs[0] / passMs[1] << "x)"
+                  << std::endl;
+        
+        std::string raw(64 * 1024 * 1024, 'r');
+        auto start = std::chrono::high_resolution_clock::now();
+        Sha256::Hash(raw.data(), raw.size());
+        double shaMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+        std::cout << "⚡ In memory: SHA-256 " << static_cast<uint64_t>(64 / (shaMs / 1000)) << " MB/s";
+        for (auto implementation : {Blake3::Implementation::Portable, Blake3::Implementation::Sse41,
+                                    Blake3::Implementation::Avx2, Blake3::Implementation::Avx512}) {
+            if (!Blake3::SetImplementation(implementation)) continue;
+            start = std::chrono::high_resolution_clock::now();
+            Blake3::Hash(raw.data(), raw.size());
+            double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+            std::cout << ", BLAKE3 " << Blake3::GetImplementationName(implementation) << " "
+                      << static_cast<uint64_t>(64 / (ms / 1000)) << " MB/s";
+        }
+        std::cout << std::endl;
+        Blake3::SetImplementation(selected);
+        
+        IntegritySystem::ConfigureHashAlgorithm(IntegritySystem::HashAlgorithm::Sha256);
+        IntegritySystem::ClearFilesToCheck();
+        fs::remove_all(dir);
+        fs::remove(dir + ".baseline");
+    }
+    
+    // Test 29: Integrity Diff Reports
+    std::cout << "\n29. Integrity Diff Reports" << std::endl;
+    std::cout << "--------------------------" << std::endl;
+    
+    {
+        namespace fs = std::filesystem;
+        std::string dir = TempPath("integrity_diff");
+        std::string baselineFile = dir + ".baseline";
+        fs::remove_all(dir);
+        fs::create_directories(dir);
+        for (const char* name : {"keep", "modify", "chmod", "remove"}) {
+            std::ofstream(dir + "/" + name) << name << " contents";
+        }
+        fs::permissions(dir + "/chmod", fs::perms(0644));
+        IntegritySystem::ClearFilesToCheck();
+        IntegritySystem::ConfigureFingerprintCache("", 0);
+        IntegritySystem::AddScanPaths({dir}, {});
+        IntegritySystem::GenerateBaseline(baselineFile);
+        BaselineIndex generated;
+        bool firstGeneration = generated.Open(baselineFile) && generated.GetGeneration() == 1;
+        generated.Close();
+        IntegritySystem::ClearFilesToCheck();
+        IntegritySystem::AddScanPaths({dir}, {});
+        IntegritySystem::LoadBaseline(baselineFile);
+        IntegritySystem::DiffReport diff = IntegritySystem::PerformIntegrityDiff();
+        std::cout << (firstGeneration && diff.clean && diff.changes.empty() && diff.summary.unchanged == 4 &&
+                      diff.baselineGeneration == 1 ? "✅" : "❌")
+                  << " Unchanged tree: clean diff against generation 1" << std::endl;
+        
+        std::ofstream(dir + "/modify") << "tampered";
+        fs::permissions(dir + "/chmod", fs::perms(0600));
+        fs::remove(dir + "/remove");
+        std::ofstream(dir + "/new") << "added";
+        IntegritySystem::AddScanPaths({dir}, {});
+        diff = IntegritySystem::PerformIntegrityDiff();
+        using Kind = IntegritySystem::ChangeKind;
+        bool kinds = diff.changes.size() == 4 &&
+                     diff.changes[0].kind == Kind::PermissionsChanged && diff.changes[0].expectedMode == 0644 &&
+                     diff.changes[0].actualMode == 0600 &&
+                     diff.changes[1].kind == Kind::Modified && !diff.changes[1].expectedHash.empty() &&
+                     diff.changes[2].kind == Kind::Added && diff.changes[2].expectedHash.empty() &&
+                     diff.changes[3].kind == Kind::Removed && diff.changes[3].actualHash.empty();
+        std::cout << (!diff.clean && kinds && diff.summary.unchanged == 1 && diff.summary.added == 1 &&
+                      diff.summary.removed == 1 && diff.summary.modified == 1 && diff.summary.permissionsChanged == 1
+                          ? "✅" : "❌")
+                  << " Permission change, modification, addition and removal reported, sorted by path" << std::endl;
+        
+        std::ostringstream json;
+        bool written = IntegritySystem::WriteDiffReport(diff, json);
+        std::string text = json.str();
+        bool streamed = written && text.find("\"integrity.summary\"") != std::string::npos &&
+                        text.find("\"integrity.permissions\"") != std::string::npos &&
+                        text.find("\"actual_mode\": \"0600\"") != std::string::npos &&
+                        text.find("\"integrity.removed\"") != std::string::npos &&
+                        text.find(dir + "/keep") == std::string::npos;
+        std::cout << (streamed ? "✅" : "❌") << " Diff streamed through JsonReporting (" << text.size()
+                  << " bytes, unchanged files left out)" << std::endl;
+        
+        // Nothing is adopted without promotion: the same changes come back
+        diff = IntegritySystem::PerformIntegrityDiff();
+        bool repeated = diff.changes.size() == 4 && diff.summary.added == 1;
+        IntegritySystem::DiffOptions promote;
+        promote.promote = true;
+        diff = IntegritySystem::PerformIntegrityDiff(promote);
+        bool promoted = diff.promotedGeneration == 2 && diff.changes.size() == 4;
+        diff = IntegritySystem::PerformIntegrityDiff();
+        std::vector<std::string> monitored = IntegritySystem::GetMonitoredFiles();
+        bool next = diff.clean && diff.baselineGeneration == 2 && diff.summary.filesChecked == 4 &&
+                    std::find(monitored.begin(), monitored.end(), dir + "/remove") == monitored.end();
+        std::cout << (repeated && promoted && next ? "✅" : "❌")
+                  << " Promotion writes generation 2; the next diff against it is clean" << std::endl;
+        fs::remove_all(dir);
+        
+        // A large baseline with a handful of changes: the diff holds the changes, the full report every file
+        const size_t count = 20000;
+        for (size_t i = 0; i < count; ++i) {
+            std::string sub = dir + "/d" + std::to_string(i % 100);
+            if (i < 100) fs::create_directories(sub);
+            std::ofstream(sub + "/f" + std::to_string(i)) << "file " << i;
+        }
+        IntegritySystem::ClearFilesToCheck();
+        IntegritySystem::AddScanPaths({dir}, {});
+        IntegritySystem::GenerateBaseline(baselineFile);
+        IntegritySystem::ClearFilesToCheck();
+        IntegritySystem::LoadBaseline(baselineFile);
+        std::ofstream(dir + "/d1/f1") << "tampered";
+        std::ofstream(dir + "/d2/f2") << "tampered";
+        fs::permissions(dir + "/d3/f3", fs::perms(0600));
+        
+        auto start = std::chrono::high_resolution_clock::now();
+        IntegritySystem::IntegrityReport full = IntegritySystem::PerformIntegrityCheck(nullptr, 1);
+        double fullMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+        start = std::chrono::high_resolution_clock::now();
+        diff = IntegritySystem::PerformIntegrityDiff();
+        double diffMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+        size_t fullBytes = 0;
+        for (const auto& file : full.files) {
+            fullBytes += sizeof(file) + file.path.size() + file.expectedHash.size() + file.actualHash.size();
+        }
+        size_t diffBytes = 0;
+        for (const auto& change : diff.changes) {
+            diffBytes += sizeof(change) + change.path.size() + change.expectedHash.size() + change.actualHash.size();
+        }
+        std::cout << (diff.changes.size() == 3 && diff.summary.filesChecked == count && full.files.size() == count ? "✅" : "❌")
+                  << " " << count << "-file baseline: diff lists " << diff.changes.size() << " changes" << std::endl;
+        std::cout << "⚡ Report size: full " << fullBytes / 1024 << " KB (" << full.files.size() << " entries, "
+                  << fullMs << " ms), diff " << diffBytes << " bytes (" << diff.changes.size() << " entries, "
+                  << diffMs << " ms)" << std::endl;
+        
+        IntegritySystem::ClearFilesToCheck();
+        fs::remove_all(dir);
+        fs::remove(baselineFile);
+    }
+    
     std::cout << "\n🎉 Enhancement Test Complete!" << std::endl;
     std::cout << "All core enhancements are functional and ready for production." << std::endl;
     